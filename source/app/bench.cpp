@@ -0,0 +1,742 @@
+/**
+ * @file bench.cpp
+ * @brief Headless Renderer Benchmark Implementation
+ */
+
+#include "bench.h"
+#include <SDL/SDL.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "rendering/math3d.h"
+#include "rendering/platform.h"
+#include "rendering/engine_config.h"
+#include "rendering/device.h"
+#include "rendering/rasterizer.h"
+#include "rendering/clip.h"
+#include "rendering/mesh.h"
+#include "rendering/texture.h"
+#include "rendering/texcache.h"
+#include "rendering/impostor.h"
+#include "rendering/entity.h"
+#include "rendering/jobs.h"
+#include "rendering/arena.h"
+#include "rendering/scenebuffer.h"
+#include "rendering/stream.h"
+#include "rendering/profile.h"
+#include "rendering/meshdraw.h"
+#include "rendering/microbench.h"
+#include "rendering/capture.h"
+#include "rendering/framedump.h"
+
+#define BENCH_DEFAULT_FRAMES    300
+#define BENCH_MAX_FRAMES        4096
+#define BENCH_WARMUP_FRAMES     8       /* Rendered but not timed */
+#define BENCH_DT                (1.0f / 60.0f)
+#define BENCH_MICRO_TOLERANCE   0.05f   /* Slower than this flags a kernel */
+#define BENCH_FRAME_TOLERANCE   0.10f   /* p50 frame time slower than this flags a scene */
+#define BENCH_GOLDEN_TOLERANCE_RB 8     /* Per 8-bit channel: one RGB565 step */
+#define BENCH_GOLDEN_TOLERANCE_G  4
+#define BENCH_BASELINE_FILE     "bench.txt"
+#define BENCH_PATH_LENGTH       256
+
+#define BENCH_GRID              10      /* Suzannes per side */
+#define BENCH_CROWD             6       /* MD2 models per side */
+#define BENCH_TOWER             16      /* Stacked planes */
+
+typedef struct {
+    const char* name;
+    bool (*build)(void);        /* Creates the scene's entities */
+    Vec3 target;                /* Camera orbits this point... */
+    float radius;               /* ...at this distance... */
+    float height;               /* ...and height above it */
+} BenchScene_t;
+
+/* Assets shared by every scene */
+static uint32_t g_bench_plane = 0xFFFFFFFF;
+static uint32_t g_bench_tile = 0xFFFFFFFF;
+static uint32_t g_bench_suzanne = 0xFFFFFFFF;
+static uint32_t g_bench_md2 = 0xFFFFFFFF;
+static uint32_t g_bench_skin = 0xFFFFFFFF;
+
+static float g_frame_ms[BENCH_MAX_FRAMES];
+
+/* Golden images and frame time baselines of one --bench run */
+typedef struct {
+    const char* dir;            /* NULL: report only */
+    bool save;                  /* Else compare */
+    bool prepass;
+    FILE* out;                  /* Baseline being saved */
+    char baseline[4096];        /* Baseline being compared, NUL-terminated */
+    uint32_t slower;
+    uint32_t mismatched;        /* Differ from, or have no, golden image */
+} BenchCheck_t;
+
+static BenchCheck_t g_check;
+
+/* A golden TIFF, header and strip */
+static uint8_t g_golden[512 + DISPLAY_WIDTH * DISPLAY_HEIGHT * 3];
+
+/* ============================================================
+ * Scenes
+ * ============================================================ */
+
+static EntityID AddMesh(uint32_t mesh_id, Vec3 position, float scale)
+{
+    EntityID e = Entity_Create("Bench");
+    Entity_AddComponent(e, COMP_MESH_RENDERER);
+    Transform_SetPosition(e, position);
+    Transform_SetScale(e, MakeVec3(scale, scale, scale));
+
+    MeshRenderer_t* mr = Entity_GetMeshRenderer(e);
+    if (mr) {
+        MeshRenderer_SetMesh(mr, mesh_id);
+        mr->visible = 1;
+        MeshDraw_SyncBounds(mr);
+    }
+    return e;
+}
+
+/* Mesh_CreatePlane() winds its top face clockwise, which the rasterizer
+ * culls from above: flipped over, the planes face the orbiting camera */
+static EntityID AddPlane(uint32_t mesh_id, Vec3 position, float scale)
+{
+    EntityID e = AddMesh(mesh_id, position, scale);
+    Transform_SetRotation(e, MakeVec3(PI, 0, 0));
+    return e;
+}
+
+static bool BuildFill(void)
+{
+    AddPlane(g_bench_plane, MakeVec3(0, 0, 0), 4.0f);
+    return true;
+}
+
+static bool BuildVertex(void)
+{
+    uint32_t mesh = (g_bench_suzanne != 0xFFFFFFFF) ? g_bench_suzanne : Mesh_CreateCube(1.0f);
+    for (int z = 0; z < BENCH_GRID; z++) {
+        for (int x = 0; x < BENCH_GRID; x++) {
+            AddMesh(mesh, MakeVec3((x - (BENCH_GRID - 1) * 0.5f) * 1.5f, 0,
+                (z - (BENCH_GRID - 1) * 0.5f) * 1.5f), 0.3f);
+        }
+    }
+    return true;
+}
+
+static bool BuildMD2(void)
+{
+    if (g_bench_md2 == 0xFFFFFFFF) return false;
+
+    int start = 0, end = 39;
+    MD2_GetAnimRange("run", &start, &end);
+    for (int z = 0; z < BENCH_CROWD; z++) {
+        for (int x = 0; x < BENCH_CROWD; x++) {
+            EntityID e = AddMesh(g_bench_md2, MakeVec3((x - (BENCH_CROWD - 1) * 0.5f) * 2.0f, 0,
+                (z - (BENCH_CROWD - 1) * 0.5f) * 2.0f), 0.05f);
+            Transform_SetRotation(e, MakeVec3(-1.57f, 0, 0));
+            Entity_AddComponent(e, COMP_ANIMATOR);
+
+            MeshRenderer_t* mr = Entity_GetMeshRenderer(e);
+            if (mr) mr->is_animated = 1;
+
+            /* Staggered so the crowd is not on one shared pose */
+            Animator_t* anim = Entity_GetAnimator(e);
+            if (anim) {
+                uint32_t length = (uint32_t)(end - start + 1);
+                anim->start_frame = start;
+                anim->end_frame = end;
+                anim->current_frame = start + (uint32_t)(x + z * BENCH_CROWD) % length;
+                anim->next_frame = (anim->current_frame < (uint32_t)end) ? anim->current_frame + 1 : start;
+                anim->is_playing = 1;
+                anim->is_looping = 1;
+                anim->playback_speed = 1.0f;
+                anim->frame_rate = MD2_GetAnimFrameRate("run");
+            }
+        }
+    }
+    return true;
+}
+
+static bool BuildOverdraw(void)
+{
+    for (int i = 0; i < BENCH_TOWER; i++) {
+        AddPlane(g_bench_tile, MakeVec3(0, i * 0.1f, 0), 1.0f);
+    }
+    return true;
+}
+
+static const BenchScene_t g_scenes[] = {
+    { "fill",     BuildFill,     { 0, 0, 0 },    1.0f, 3.0f },
+    { "vertex",   BuildVertex,   { 0, 0, 0 },   12.0f, 8.0f },
+    { "md2",      BuildMD2,      { 0, 1, 0 },    9.0f, 4.0f },
+    { "overdraw", BuildOverdraw, { 0, 0.8f, 0 }, 2.0f, 4.0f },
+};
+
+#define BENCH_SCENE_COUNT   (sizeof(g_scenes) / sizeof(g_scenes[0]))
+
+/* ============================================================
+ * Frame Loop
+ * ============================================================ */
+
+static void BenchMaterial(const DrawCmd_t* cmd, uint16_t* color, uint32_t* texture, void* user)
+{
+    (void)user;
+    *color = RGB565(0x60, 0xC0, 0x60);
+    if (cmd->flags & DRAW_FLAG_ANIMATED) *texture = g_bench_skin;
+}
+
+/* A quarter orbit over the run, from the frame index alone */
+static void CameraAt(const BenchScene_t* scene, uint32_t frame, uint32_t frames,
+    Mat4* view_proj, ClipFrustum_t* frustum)
+{
+    float angle = 0.5f * PI * (float)frame / (float)frames;
+    Vec3 eye = MakeVec3(scene->target.x + sinf(angle) * scene->radius,
+        scene->target.y + scene->height,
+        scene->target.z + cosf(angle) * scene->radius);
+
+    Mat4 view, proj;
+    Mat4_LookAt(&view, eye, scene->target, MakeVec3(0, 1, 0));
+    Mat4_Perspective(&proj, 60.0f * DEG_TO_RAD, (float)DISPLAY_WIDTH / (float)DISPLAY_HEIGHT, 0.1f, 100.0f);
+    Mat4_Multiply(view_proj, &proj, &view);
+    Clip_ExtractFrustum(view_proj, frustum);
+}
+
+/* FNV-1a of the visible image, to compare runs and builds */
+static uint64_t HashFrame(Device* device)
+{
+    uint64_t hash = 0xCBF29CE484222325ull;
+    for (int y = 0; y < device->Height(); y++) {
+        const uint16_t* row = device->ColorRow(y);
+        for (int x = 0; x < device->Width(); x++) {
+            hash = (hash ^ row[x]) * 0x100000001B3ull;
+        }
+    }
+    return hash;
+}
+
+static int CompareFloat(const void* a, const void* b)
+{
+    float fa = *(const float*)a, fb = *(const float*)b;
+    return (fa > fb) - (fa < fb);
+}
+
+typedef struct {
+    uint64_t pixels;
+    uint64_t tested;            /* Drawn plus depth rejected */
+    uint64_t triangles;
+    double total_ms;
+} BenchTotals_t;
+
+/* Counters of timed frame `step`, taken [start, end) */
+static void AddFrame(BenchTotals_t* totals, uint32_t step, uint64_t start, uint64_t end)
+{
+    RasterizerStats_t stats;
+    Rasterizer_GetStats(&stats);
+    totals->pixels += stats.pixels_drawn;
+    totals->tested += (uint64_t)stats.pixels_drawn + stats.pixels_depth_rejected;
+    totals->triangles += stats.triangles_drawn;
+
+    g_frame_ms[step] = (float)((double)(end - start) * 1000.0 / (double)Profile_TicksPerSecond());
+    totals->total_ms += g_frame_ms[step];
+}
+
+static void PrintHeader(void)
+{
+    printf("scene      mean ms   p50 ms   p99 ms    Mpix/s  tris/frame  depth  last frame\n");
+}
+
+typedef struct {
+    float mean_ms;
+    float p50_ms;
+    float p99_ms;
+} BenchResult_t;
+
+static void Report(const char* name, uint32_t frames, const BenchTotals_t* totals, Device* device,
+    BenchResult_t* result = NULL)
+{
+    uint64_t hash = HashFrame(device);
+    qsort(g_frame_ms, frames, sizeof(float), CompareFloat);
+    float p50 = g_frame_ms[(frames - 1) * 50 / 100];
+    float p99 = g_frame_ms[(frames - 1) * 99 / 100];
+    double mpix = (totals->total_ms > 0.0) ? (double)totals->pixels / (totals->total_ms * 1000.0) : 0.0;
+    double depth = (double)totals->tested / ((double)frames * DISPLAY_WIDTH * DISPLAY_HEIGHT);
+
+    printf("%-9s %8.3f %8.3f %8.3f %9.1f %10u %6.2f  %016llx\n", name,
+        totals->total_ms / frames, p50, p99, mpix, (unsigned)(totals->triangles / frames), depth,
+        (unsigned long long)hash);
+    if (result) {
+        result->mean_ms = (float)(totals->total_ms / frames);
+        result->p50_ms = p50;
+        result->p99_ms = p99;
+    }
+}
+
+/* ============================================================
+ * Golden Images And Baselines
+ * ============================================================ */
+
+static inline uint32_t Get16(const uint8_t* p) { return p[0] | ((uint32_t)p[1] << 8); }
+static inline uint32_t Get32(const uint8_t* p) { return Get16(p) | (Get16(p + 2) << 16); }
+
+typedef struct {
+    uint32_t pixels;            /* Some channel off by more than the tolerance */
+    uint32_t max_delta;
+    int first_x, first_y;
+} GoldenDiff_t;
+
+/* Compares the frame with a TIFF written by Device::WriteToFile(), with
+ * the same RGB565 to 8-bit expansion; false if the file is missing, not
+ * such a TIFF, or of another size */
+static bool CompareGolden(const char* path, Device* device, GoldenDiff_t* diff)
+{
+    memset(diff, 0, sizeof(*diff));
+    diff->first_x = diff->first_y = -1;
+
+    FILE* f = fopen(path, "rb");
+    if (!f) return false;
+    size_t size = fread(g_golden, 1, sizeof(g_golden), f);
+    fclose(f);
+    if (size < 8 || memcmp(g_golden, "II", 2) != 0 || Get16(g_golden + 2) != 42) return false;
+
+    uint32_t ifd = Get32(g_golden + 4);
+    if (ifd + 2 > size) return false;
+    uint32_t entries = Get16(g_golden + ifd);
+    uint32_t width = 0, height = 0, strip = 0, samples = 0, compression = 1;
+    for (uint32_t i = 0; i < entries && ifd + 2 + (i + 1) * 12 <= size; i++) {
+        const uint8_t* e = g_golden + ifd + 2 + i * 12;
+        uint32_t value = (Get16(e + 2) == 3) ? Get16(e + 8) : Get32(e + 8);
+        switch (Get16(e)) {
+        case 256: width = value; break;
+        case 257: height = value; break;
+        case 259: compression = value; break;
+        case 273: strip = value; break;
+        case 277: samples = value; break;
+        }
+    }
+    if (width != (uint32_t)device->Width() || height != (uint32_t)device->Height() ||
+        samples != 3 || compression != 1 || strip + width * height * 3 > size) return false;
+
+    const uint8_t* golden = g_golden + strip;
+    for (uint32_t y = 0; y < height; y++) {
+        const uint16_t* row = device->ColorRow((int)y);
+        for (uint32_t x = 0; x < width; x++, golden += 3) {
+            uint16_t p = row[x];
+            int r = (int)(((p >> 11) & 0x1F) << 3) - golden[0];
+            int g = (int)(((p >> 5) & 0x3F) << 2) - golden[1];
+            int b = (int)((p & 0x1F) << 3) - golden[2];
+            uint32_t delta = (uint32_t)abs(r);
+            if ((uint32_t)abs(g) > delta) delta = (uint32_t)abs(g);
+            if ((uint32_t)abs(b) > delta) delta = (uint32_t)abs(b);
+            if (delta > diff->max_delta) diff->max_delta = delta;
+            if (abs(r) > BENCH_GOLDEN_TOLERANCE_RB || abs(g) > BENCH_GOLDEN_TOLERANCE_G ||
+                abs(b) > BENCH_GOLDEN_TOLERANCE_RB) {
+                if (diff->pixels++ == 0) { diff->first_x = (int)x; diff->first_y = (int)y; }
+            }
+        }
+    }
+    return true;
+}
+
+/* A scene's baseline line: name frames prepass mean_ms p50_ms p99_ms */
+static bool FindBaseline(const char* baseline, const char* name, uint32_t* frames, int* prepass,
+    float* p50_ms)
+{
+    const char* p = baseline;
+    while (p && *p) {
+        char key[32];
+        unsigned f;
+        float mean, p50, p99;
+        if (sscanf(p, "%31s %u %d %f %f %f", key, &f, prepass, &mean, &p50, &p99) == 6 &&
+            strcmp(key, name) == 0) {
+            *frames = f;
+            *p50_ms = p50;
+            return true;
+        }
+        p = strchr(p, '\n');
+        if (p) p++;
+    }
+    return false;
+}
+
+/* Saves or checks the last frame and the frame times of a scene */
+static void CheckScene(const char* name, uint32_t frames, const BenchResult_t* result, Device* device)
+{
+    char path[BENCH_PATH_LENGTH];
+    snprintf(path, sizeof(path), "%s/%s.tif", g_check.dir, name);
+
+    if (g_check.save) {
+        if (!FrameDump_WriteImage(device, path, FRAMEDUMP_TIFF)) printf("          cannot write %s\n", path);
+        if (g_check.out) {
+            fprintf(g_check.out, "%s %u %d %.3f %.3f %.3f\n", name, frames, g_check.prepass ? 1 : 0,
+                result->mean_ms, result->p50_ms, result->p99_ms);
+        }
+        return;
+    }
+
+    uint32_t base_frames = 0;
+    int base_prepass = 0;
+    float base_ms = 0.0f;
+    if (!FindBaseline(g_check.baseline, name, &base_frames, &base_prepass, &base_ms)) {
+        printf("          no baseline\n");
+        g_check.mismatched++;
+        return;
+    }
+    /* The camera path depends on the frame count */
+    if (base_frames != frames || (base_prepass != 0) != g_check.prepass) {
+        printf("          baseline is of %u frames%s, not comparable\n", base_frames,
+            base_prepass ? " with prepass" : "");
+        g_check.mismatched++;
+        return;
+    }
+
+    /* The median: one preempted frame does not fail the run */
+    float change = (base_ms > 0.0f) ? result->p50_ms / base_ms - 1.0f : 0.0f;
+    bool regressed = change > BENCH_FRAME_TOLERANCE;
+    if (regressed) g_check.slower++;
+
+    GoldenDiff_t diff;
+    if (!CompareGolden(path, device, &diff)) {
+        printf("          p50 %+.1f%% vs %.3f ms%s, no golden image %s\n", change * 100.0f, base_ms,
+            regressed ? " SLOWER" : "", path);
+        g_check.mismatched++;
+        return;
+    }
+    if (diff.pixels) g_check.mismatched++;
+    printf("          p50 %+.1f%% vs %.3f ms%s, ", change * 100.0f, base_ms, regressed ? " SLOWER" : "");
+    if (diff.pixels) {
+        printf("%u pixels differ (max %u, first at %d,%d) MISMATCH\n", diff.pixels, diff.max_delta,
+            diff.first_x, diff.first_y);
+    }
+    else {
+        printf("image matches (max delta %u)\n", diff.max_delta);
+    }
+}
+
+static void RunScene(const BenchScene_t* scene, uint32_t frames, Device* device)
+{
+    Entity_Init();
+    if (!scene->build()) {
+        printf("%-9s skipped (assets missing)\n", scene->name);
+        Entity_Shutdown();
+        return;
+    }
+
+    BenchTotals_t totals;
+    memset(&totals, 0, sizeof(totals));
+
+    for (uint32_t f = 0; f < BENCH_WARMUP_FRAMES + frames; f++) {
+        uint32_t step = (f < BENCH_WARMUP_FRAMES) ? 0 : f - BENCH_WARMUP_FRAMES;
+        uint64_t start = Profile_Now();
+
+        Entity_UpdateTransforms();
+        Entity_UpdateAnimators(BENCH_DT);
+
+        Mat4 view_proj;
+        ClipFrustum_t frustum;
+        CameraAt(scene, step, frames, &view_proj, &frustum);
+
+        DrawList_t* out = SceneBuffer_BeginWrite();
+        if (out) {
+            SceneBuffer_Build(out, &view_proj, &frustum);
+            SceneBuffer_EndWrite(out);
+        }
+
+        device->Lock();
+        Rasterizer_Clear(RGB565(0x20, 0x20, 0x30));
+        const DrawList_t* draw = SceneBuffer_AcquireRead();
+        if (draw) {
+            MeshDraw_List(draw, BenchMaterial, NULL);
+            SceneBuffer_ReleaseRead(draw);
+        }
+        Rasterizer_Flush();
+        device->Unlock();
+
+        uint64_t end = Profile_Now();
+        Profile_Record("BenchFrame", start, end);
+
+        Mesh_Compact(1);
+        Texture_Compact(1);
+        if (f >= BENCH_WARMUP_FRAMES) AddFrame(&totals, step, start, end);
+    }
+
+    BenchResult_t result;
+    Report(scene->name, frames, &totals, device, &result);
+    if (g_check.dir) CheckScene(scene->name, frames, &result, device);
+    Entity_Shutdown();      /* Lets go of the scene's meshes */
+}
+
+/* ============================================================
+ * Entry
+ * ============================================================ */
+
+/* Blocking load through the streaming queue; 0xFFFFFFFF if missing */
+static uint32_t LoadNow(const char* path, uint32_t kind)
+{
+    uint32_t handle = Stream_Request(path, kind, 0xFFFFFFFF, NULL, NULL);
+    if (handle == STREAM_INVALID) return 0xFFFFFFFF;
+    while (Stream_Update()) SDL_Delay(1);
+    uint32_t id = Stream_Get(handle);
+    Stream_Release(handle);
+    return id;
+}
+
+/* Offscreen device in the window surface's format and subsystems as in
+ * the demo; with `assets`, the scenes' shared assets too */
+static Device* Setup(SDL_Surface** surface, bool assets)
+{
+    *surface = SDL_CreateRGBSurface(0, DISPLAY_WIDTH, DISPLAY_HEIGHT, 32,
+        0x00FF0000, 0x0000FF00, 0x000000FF, 0);
+    if (!*surface) {
+        printf("Offscreen surface failed: %s\n", SDL_GetError());
+        return NULL;
+    }
+    Device* device = new Device(*surface);
+
+    Profile_Init();
+    Rasterizer_Init();
+    Arena_Init();
+    Rasterizer_SetDevice(device);
+    Rasterizer_SetBinning(1);
+    Rasterizer_SetPerspectiveSpan(8);
+    Jobs_Init(0);
+    Mesh_Init();
+    Texture_Init();
+    TexCache_Init();
+    Impostor_Init();    /* Left off: the hashes cover the meshes */
+    SceneBuffer_Init();
+    Stream_Init();
+    if (!assets) return device;
+
+    g_bench_plane = Mesh_CreatePlane(10.0f, 10.0f);
+    g_bench_tile = Mesh_CreatePlane(4.0f, 4.0f);
+    g_bench_suzanne = LoadNow("data/suzanne.obj", STREAM_MESH_OBJ);
+    g_bench_md2 = LoadNow("data/md2/q2mdl-wham/tris.MD2", STREAM_MESH_MD2);
+    g_bench_skin = LoadNow("data/md2/q2mdl-wham/ctf_r.bmp", STREAM_TEXTURE_BMP);
+    Mesh_PackStatic(g_bench_plane);
+    Mesh_PackStatic(g_bench_tile);
+    if (g_bench_suzanne != 0xFFFFFFFF) Mesh_PackStatic(g_bench_suzanne);
+    if (g_bench_skin == 0xFFFFFFFF) g_bench_skin = Texture_CreateCheckerboard(0xFFFF, 0x8410, 64);
+    return device;
+}
+
+static void Teardown(Device* device, SDL_Surface* surface)
+{
+    Stream_Shutdown();
+    Jobs_Shutdown();
+    Entity_Shutdown();
+    delete device;
+    SDL_FreeSurface(surface);
+}
+
+int Bench_Main(int argc, char* args[])
+{
+    const char* only = (argc > 0) ? args[0] : "all";
+    uint32_t frames = (argc > 1) ? (uint32_t)atoi(args[1]) : BENCH_DEFAULT_FRAMES;
+    if (frames == 0) frames = BENCH_DEFAULT_FRAMES;
+    if (frames > BENCH_MAX_FRAMES) frames = BENCH_MAX_FRAMES;
+
+    bool usage = false;
+    memset(&g_check, 0, sizeof(g_check));
+    for (int i = 2; i < argc; i++) {
+        if (strcmp(args[i], "prepass") == 0) g_check.prepass = true;
+        else if ((strcmp(args[i], "save") == 0 || strcmp(args[i], "compare") == 0) && i + 1 < argc) {
+            g_check.save = strcmp(args[i], "save") == 0;
+            g_check.dir = args[++i];
+        }
+        else usage = true;
+    }
+
+    bool known = strcmp(only, "all") == 0;
+    for (uint32_t s = 0; s < BENCH_SCENE_COUNT; s++) known |= strcmp(only, g_scenes[s].name) == 0;
+    if (!known || usage) {
+        printf("Usage: --bench [all|fill|vertex|md2|overdraw] [frames] [prepass] [save|compare dir]\n");
+        return 1;
+    }
+
+    char path[BENCH_PATH_LENGTH];
+    if (g_check.dir) {
+        snprintf(path, sizeof(path), "%s/%s", g_check.dir, BENCH_BASELINE_FILE);
+        FILE* f = fopen(path, g_check.save ? "wb" : "rb");
+        if (!f) {
+            printf(g_check.save ? "Cannot write baseline: %s\n" : "No baseline: %s\n", path);
+            return 1;
+        }
+        if (g_check.save) {
+            g_check.out = f;
+        }
+        else {
+            size_t n = fread(g_check.baseline, 1, sizeof(g_check.baseline) - 1, f);
+            g_check.baseline[n] = 0;
+            fclose(f);
+        }
+    }
+
+    SDL_Surface* surface;
+    Device* device = Setup(&surface, true);
+    if (!device) {
+        if (g_check.out) fclose(g_check.out);
+        return 1;
+    }
+
+    MeshDraw_SetDepthPrepass(g_check.prepass);
+    printf("Bench: %ux%u, %u render threads, %u frames per scene%s\n",
+        DISPLAY_WIDTH, DISPLAY_HEIGHT, Jobs_GetThreadCount(), frames, g_check.prepass ? ", depth prepass" : "");
+    PrintHeader();
+    for (uint32_t s = 0; s < BENCH_SCENE_COUNT; s++) {
+        if (strcmp(only, "all") == 0 || strcmp(only, g_scenes[s].name) == 0) {
+            RunScene(&g_scenes[s], frames, device);
+        }
+    }
+
+    if (g_check.out) {
+        fclose(g_check.out);
+        printf("Baseline saved: %s\n", path);
+    }
+    if (g_check.slower) printf("%u scenes slower than the baseline\n", g_check.slower);
+    if (g_check.mismatched) printf("%u scenes do not match their golden images\n", g_check.mismatched);
+
+    Teardown(device, surface);
+    return g_check.mismatched ? 3 : (g_check.slower ? 2 : 0);
+}
+
+static void WriteFile(const char* text, uint32_t length, void* user)
+{
+    fwrite(text, 1, length, (FILE*)user);
+}
+
+int Bench_Micro(int argc, char* args[])
+{
+    const char* mode = (argc > 0) ? args[0] : NULL;
+    const char* path = (argc > 1) ? args[1] : NULL;
+    bool save = mode && strcmp(mode, "save") == 0;
+    bool compare = mode && strcmp(mode, "compare") == 0;
+    if (mode && (!path || (!save && !compare))) {
+        printf("Usage: --micro [save|compare baseline.txt]\n");
+        return 1;
+    }
+
+    /* Baseline text, NUL-terminated */
+    static char baseline[4096];
+    if (compare) {
+        FILE* f = fopen(path, "rb");
+        if (!f) {
+            printf("No baseline: %s\n", path);
+            return 1;
+        }
+        size_t n = fread(baseline, 1, sizeof(baseline) - 1, f);
+        baseline[n] = 0;
+        fclose(f);
+    }
+
+    SDL_Surface* surface;
+    Device* device = Setup(&surface, true);
+    if (!device) return 1;
+
+    MicroAssets_t assets;
+    assets.texture = g_bench_skin;
+    assets.md2_mesh = g_bench_md2;
+
+    MicroResult_t results[MICRO_MAX_RESULTS];
+    device->Lock();
+    uint32_t count = Micro_Run(&assets, results, MICRO_MAX_RESULTS);
+    device->Unlock();
+
+    printf("Micro: %llu ticks per second, best of %u repeats\n",
+        (unsigned long long)Profile_TicksPerSecond(), MICRO_REPEATS);
+    uint32_t slower = Micro_Report(results, count, compare ? baseline : NULL, BENCH_MICRO_TOLERANCE);
+
+    if (save) {
+        FILE* f = fopen(path, "wb");
+        if (f) {
+            Micro_WriteBaseline(results, count, WriteFile, f);
+            fclose(f);
+            printf("Baseline saved: %s\n", path);
+        }
+        else {
+            printf("Cannot write baseline: %s\n", path);
+        }
+    }
+    if (slower) printf("%u kernels slower than the baseline\n", slower);
+
+    Teardown(device, surface);
+    return slower ? 2 : 0;
+}
+
+/* The demo's meshes and textures in the demo's load order, so a capture
+ * taken there finds the same ids */
+static void LoadDemoAssets(void)
+{
+    uint32_t cube = Mesh_CreateCube(1.0f);
+    uint32_t plane = Mesh_CreatePlane(10.0f, 10.0f);
+    Texture_CreateCheckerboard(0xFFFF, 0x8410, 64);
+    uint32_t obj = LoadNow("data/suzanne.obj", STREAM_MESH_OBJ);
+    Mesh_PackStatic(cube);
+    Mesh_PackStatic(plane);
+    if (obj != 0xFFFFFFFF) Mesh_PackStatic(obj);
+    LoadNow("data/md2/q2mdl-wham/tris.MD2", STREAM_MESH_MD2);
+    LoadNow("data/md2/q2mdl-wham/ctf_r.bmp", STREAM_TEXTURE_BMP);
+}
+
+int Bench_Replay(int argc, char* args[])
+{
+    if (argc < 1) {
+        printf("Usage: --replay capture.scap [frames] [triangles|draws]\n");
+        return 1;
+    }
+    uint32_t frames = (argc > 1) ? (uint32_t)atoi(args[1]) : BENCH_DEFAULT_FRAMES;
+    if (frames == 0) frames = BENCH_DEFAULT_FRAMES;
+    if (frames > BENCH_MAX_FRAMES) frames = BENCH_MAX_FRAMES;
+    bool draws = (argc > 2) && strcmp(args[2], "draws") == 0;
+
+    FILE* f = fopen(args[0], "rb");
+    if (!f) {
+        printf("Cannot open capture: %s\n", args[0]);
+        return 1;
+    }
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    void* data = (size > 0) ? malloc((size_t)size) : NULL;   /* malloc is 4-byte aligned */
+    bool read = data && fread(data, 1, (size_t)size, f) == (size_t)size;
+    fclose(f);
+
+    const CaptureHeader_t* header = read ? Capture_Validate(data, (uint32_t)size) : NULL;
+    if (!header) {
+        printf("Not a capture from this build: %s\n", args[0]);
+        free(data);
+        return 1;
+    }
+
+    SDL_Surface* surface;
+    Device* device = Setup(&surface, false);
+    if (!device) {
+        free(data);
+        return 1;
+    }
+    if (draws) LoadDemoAssets();
+
+    printf("Replay: %s, %u triangles, %u draws, %u textures%s, %u frames of %s\n", args[0],
+        header->triangles, header->draws, header->textures,
+        (header->flags & CAPTURE_FLAG_TRUNCATED) ? " (truncated)" : "",
+        frames, draws ? "draws" : "triangles");
+    PrintHeader();
+
+    BenchTotals_t totals;
+    memset(&totals, 0, sizeof(totals));
+    uint32_t mode = draws ? CAPTURE_REPLAY_DRAWS : CAPTURE_REPLAY_TRIANGLES;
+    for (uint32_t i = 0; i < BENCH_WARMUP_FRAMES + frames; i++) {
+        uint64_t start = Profile_Now();
+        device->Lock();
+        Capture_Replay(data, (uint32_t)size, mode);
+        device->Unlock();
+        uint64_t end = Profile_Now();
+        if (i >= BENCH_WARMUP_FRAMES) AddFrame(&totals, i - BENCH_WARMUP_FRAMES, start, end);
+    }
+    Report("replay", frames, &totals, device);
+
+    Teardown(device, surface);
+    free(data);
+    return 0;
+}
@@ -0,0 +1,50 @@
+/**
+ * @file bench.h
+ * @brief Headless Renderer Benchmark
+ *
+ * `rasterizer --bench [scene|all] [frames] [prepass] [save|compare dir]` renders each standard scene
+ * into an offscreen surface (no window, no present, no frame cap) along
+ * a fixed camera path with a fixed time step, so two runs of the same
+ * build do the same work and produce the same images. Reports mean, p50
+ * and p99 frame times, Mpix/s and a hash of the last frame per scene.
+ * `prepass` draws every frame with the depth prepass (meshdraw.h)
+ * instead of front-to-back sorting alone; the hashes should not change.
+ *
+ * `save dir` keeps each scene's last frame as dir/<scene>.tif (the
+ * Device::WriteToFile() TIFF) and its frame times in dir/bench.txt.
+ * `compare dir` renders the same frames and checks them against those:
+ * a pixel differs when a channel is off by more than one RGB565 step,
+ * and a scene is slower when its p50 frame time grew by more than 10%.
+ * Exits with 3 when any scene differs from, or has no, golden image, else
+ * with 2 when any got slower. Goldens only compare at the frame count
+ * and prepass setting they were saved with.
+ *
+ * Scenes:
+ *   fill      one ground plane filling the screen (fill bound)
+ *   vertex    a grid of small suzannes (vertex bound)
+ *   md2       a crowd of animated, textured MD2 models
+ *   overdraw  a tower of stacked planes (depth rejection)
+ *
+ * `rasterizer --micro [save|compare baseline.txt]` runs the kernel
+ * microbenchmarks of microbench.h on the same offscreen setup; compare
+ * exits with 2 when any kernel got slower than the baseline.
+ *
+ * `rasterizer --replay capture.scap [frames] [triangles|draws]` times
+ * a frame captured with capture.h (the demo's C key, or the board) in
+ * the same way as the scenes. Triangle replay needs no assets; draw
+ * replay loads the demo's in the demo's order so the ids match.
+ */
+
+#ifndef BENCH_H
+#define BENCH_H
+
+/* Arguments after --bench; returns the process exit code */
+int Bench_Main(int argc, char* args[]);
+
+/* Arguments after --micro */
+int Bench_Micro(int argc, char* args[]);
+
+/* Arguments after --replay */
+int Bench_Replay(int argc, char* args[]);
+
+#endif /* BENCH_H */
@@ -6,15 +6,57 @@
 #include <SDL/SDL.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 #include "rendering/math3d.h"
 #include "rendering/platform.h"
 #include "rendering/engine_config.h"
 #include "rendering/device.h"
 #include "rendering/rasterizer.h"
+#include "rendering/clip.h"
+#include "rendering/spatial.h"
 #include "rendering/mesh.h"
+#include "rendering/meshbake.h"
+#include "rendering/meshlod.h"
+#include "rendering/meshcluster.h"
+#include "rendering/meshorder.h"
 #include "rendering/texture.h"
+#include "rendering/texcache.h"
+#include "rendering/impostor.h"
 #include "rendering/entity.h"
+#include "rendering/jobs.h"
+#include "rendering/systems.h"
+#include "rendering/arena.h"
+#include "rendering/memmap.h"
+#include "rendering/scenebuffer.h"
+#include "rendering/renderqueue.h"
+#include "rendering/stream.h"
+#include "rendering/profile.h"
+#include "rendering/overlay.h"
+#include "rendering/debugdraw.h"
+#include "rendering/meshdraw.h"
+#include "rendering/capture.h"
+#include "rendering/framedump.h"
+#include "rendering/framepacer.h"
+#include "rendering/dynres.h"
+#include "rendering/power.h"
+#include "rendering/staticlayer.h"
+#include "rendering/dirtyrect.h"
+#include "rendering/telemetry.h"
+#include "rendering/shadow.h"
+#include "rendering/resource.h"
+#include "bench.h"
 
  /* MSVC stdio fix for older SDL versions */
 #ifdef _MSC_VER
@@ -40,6 +82,8 @@ Vec3 g_camera_pos;
 Vec3 g_camera_rot;
 Mat4 g_view_matrix;
 Mat4 g_proj_matrix;
+Mat4 g_view_proj_matrix;
+ClipFrustum_t g_frustum;
 
 /* Entities */
 EntityID g_cube_entity = INVALID_ENTITY;
@@ -58,6 +102,19 @@ uint32_t g_md2_texture = 0xFFFFFFFF;
 /* Textures */
 uint32_t g_checker_tex = 0xFFFFFFFF;
 
+/* Materials */
+uint32_t g_glass_material = 0xFFFFFFFF;
+
+/* Baked mesh images, mapped for the lifetime of their meshes */
+typedef struct {
+    const void* data;
+    uint32_t size;
+} MappedFile_t;
+
+MappedFile_t g_obj_image = { NULL, 0 };
+MappedFile_t g_md2_image = { NULL, 0 };
+MappedFile_t g_md2_texture_image = { NULL, 0 };
+
 /* ============================================================
  * File Loading Helper
  * ============================================================ */
@@ -86,154 +143,184 @@ static void* LoadFileToMemory(const char* filename, uint32_t* out_size)
     return data;
 }
 
-/* ============================================================
- * Rendering Functions
- * ============================================================ */
+/* Read-only mapping of a whole file, the PC stand-in for XIP flash;
+ * page aligned, so baked images satisfy their alignment. Quiet when the
+ * file is missing. */
+static MappedFile_t MapFile(const char* filename)
+{
+    MappedFile_t file = { NULL, 0 };
+#ifdef _WIN32
+    HANDLE h = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (h == INVALID_HANDLE_VALUE) return file;
+    DWORD size = GetFileSize(h, NULL);
+    HANDLE mapping = (size && size != INVALID_FILE_SIZE) ? CreateFileMappingA(h, NULL, PAGE_READONLY, 0, 0, NULL) : NULL;
+    if (mapping) {
+        file.data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        file.size = file.data ? (uint32_t)size : 0;
+        CloseHandle(mapping);
+    }
+    CloseHandle(h);
+#else
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) return file;
+    struct stat st;
+    if (fstat(fd, &st) == 0 && st.st_size > 0) {
+        void* p = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p != MAP_FAILED) {
+            file.data = p;
+            file.size = (uint32_t)st.st_size;
+        }
+    }
+    close(fd);
+#endif
+    return file;
+}
 
- /* Transform a vertex from object space to screen space */
-static int TransformVertex(const Vertex_t* in, const Mat4* model, ScreenVertex_t* out)
+static void UnmapFile(MappedFile_t* file)
 {
-    /* Model -> World */
-    Vec4 world_pos = Mat4_MultiplyVec4(model, MakeVec4(in->position.x, in->position.y, in->position.z, 1.0f));
-
-    /* World -> View */
-    Vec4 view_pos = Mat4_MultiplyVec4(&g_view_matrix, world_pos);
-
-    /* Near plane clip - reject if behind camera */
-    if (view_pos.z >= -0.1f) return 0;  // Using near plane distance
-
-    /* View -> Clip */
-    Vec4 clip_pos = Mat4_MultiplyVec4(&g_proj_matrix, view_pos);
-
-    /* Clip test - check w */
-    if (clip_pos.w <= 0.0001f) return 0;
-
-    /* Perspective divide */
-    float inv_w = 1.0f / clip_pos.w;
-    float ndc_x = clip_pos.x * inv_w;
-    float ndc_y = clip_pos.y * inv_w;
-    float ndc_z = clip_pos.z * inv_w;
-
-    /* Frustum culling - allow some slack for edge triangles */
-    if (ndc_x < -1.5f || ndc_x > 1.5f) return 0;
-    if (ndc_y < -1.5f || ndc_y > 1.5f) return 0;
-    if (ndc_z < 0.0f || ndc_z > 1.0f) return 0;
-
-    /* NDC to screen */
-    float screen_x = (ndc_x * 0.5f + 0.5f) * SCREEN_WIDTH;
-    float screen_y = (1.0f - (ndc_y * 0.5f + 0.5f)) * SCREEN_HEIGHT;
-
-    out->x = (int32_t)(screen_x);
-    out->y = (int32_t)(screen_y);
-    out->z = ndc_z;
-    out->w_inv = inv_w;
-    out->u = in->texcoord.x;
-    out->v = in->texcoord.y;
-
-    /* Simple lighting based on normal.y (top = bright) */
-    float light = 0.3f + 0.7f * (in->normal.y * 0.5f + 0.5f);
-    int intensity = (int)(light * 31);
-    if (intensity > 31) intensity = 31;
-    if (intensity < 0) intensity = 0;
-    out->color = RGB565(intensity * 8, intensity * 8, intensity * 8);
+    if (!file->data) return;
+#ifdef _WIN32
+    UnmapViewOfFile(file->data);
+#else
+    munmap((void*)file->data, file->size);
+#endif
+    file->data = NULL;
+    file->size = 0;
+}
 
-    return 1;
+/* Mesh referencing a mapped baked image; 0xFFFFFFFF (and nothing left
+ * mapped) if the file is missing or stale */
+static uint32_t LoadBakedMesh(const char* filename, MappedFile_t* file)
+{
+    *file = MapFile(filename);
+    if (!file->data) return 0xFFFFFFFF;
+
+    uint32_t id = Mesh_LoadBaked(file->data, file->size);
+    if (id == 0xFFFFFFFF) {
+        printf("Ignoring stale baked mesh: %s\n", filename);
+        UnmapFile(file);
+    }
+    return id;
 }
 
-/* Render a static mesh */
-static void RenderStaticMesh(uint32_t mesh_id, const Mat4* model_matrix, uint16_t color)
+/* Texture referencing a mapped baked image, as LoadBakedMesh() */
+static uint32_t LoadBakedTexture(const char* filename, MappedFile_t* file)
 {
-    MeshSlot_t* mesh = Mesh_Get(mesh_id);
-    if (!mesh || mesh->type != 1) return;
-
-    Vertex_t* verts = Mesh_GetVertexPtr(mesh->stat.vertex_start);
-    uint16_t* indices = Mesh_GetIndexPtr(mesh->stat.index_start);
-
-    if (!verts || !indices) return;
-    if (mesh->stat.index_count == 0) return;
-
-    /* Draw triangles */
-    for (uint32_t i = 0; i < mesh->stat.index_count; i += 3) {
-        ScreenVertex_t sv0, sv1, sv2;
-
-        if (!TransformVertex(&verts[indices[i + 0]], model_matrix, &sv0)) continue;
-        if (!TransformVertex(&verts[indices[i + 1]], model_matrix, &sv1)) continue;
-        if (!TransformVertex(&verts[indices[i + 2]], model_matrix, &sv2)) continue;
-        /* Backface culling (cross product of screen edges) */
-        int32_t ax = (sv1.x - sv0.x);
-        int32_t ay = (sv1.y - sv0.y);
-        int32_t bx = (sv2.x - sv0.x);
-        int32_t by = (sv2.y - sv0.y);
-        int32_t cross = ax * by - ay * bx;
-        if (cross <= 0) continue; /* Cull back-facing
-        /* Override vertex colors with mesh color */
-        sv0.color = sv1.color = sv2.color = color;
-
-        Rasterizer_DrawTriangleSolid(&sv0, &sv1, &sv2, color);
+    *file = MapFile(filename);
+    if (!file->data) return 0xFFFFFFFF;
+
+    uint32_t id = Texture_LoadBaked(file->data, file->size);
+    if (id == 0xFFFFFFFF) {
+        printf("Ignoring stale baked texture: %s\n", filename);
+        UnmapFile(file);
     }
+    return id;
 }
 
-static void RenderMD2Mesh(uint32_t mesh_id, const Mat4* model_matrix,
-    uint16_t frame_a, uint16_t frame_b, float lerp, TextureSlot_t* texture)
+static int HasExtension(const char* name, const char* ext)
 {
-    MeshSlot_t* mesh = Mesh_Get(mesh_id);
-    if (!mesh || mesh->type != 2) return;
+    size_t len = strlen(name), n = strlen(ext);
+    if (len < n) return 0;
+    for (size_t i = 0; i < n; i++) {
+        char c = name[len - n + i];
+        if (c >= 'A' && c <= 'Z') c = (char)(c - 'A' + 'a');
+        if (c != ext[i]) return 0;
+    }
+    return 1;
+}
 
-    uint16_t* indices = Mesh_GetIndexPtr(mesh->anim.index_start);
-    if (!indices) return;
+/* Offline cooker: load an OBJ, MD2 or BMP the usual way and write its
+ * baked image. Meshes get their detail levels and static ones are then
+ * packed, clustered and put in fetch order, as the demo renders them;
+ * textures come out mipped and tiled as Texture_LoadBMP() leaves them. */
+static int CookAsset(const char* in_name, const char* out_name)
+{
+    Mesh_Init();
+    Texture_Init();
 
-    MD2UV_t* uvs = &g_md2_uv_pool[mesh->anim.uv_start];
+    uint32_t size = 0;
+    void* data = LoadFileToMemory(in_name, &size);
+    if (!data) return 1;
 
-    /* Draw triangles */
-    for (uint32_t i = 0; i < mesh->anim.index_count; i += 3) {
-        ScreenVertex_t sv[3];
-        int valid = 1;
+    int is_obj = HasExtension(in_name, ".obj");
+    int is_bmp = HasExtension(in_name, ".bmp");
+    uint32_t id = is_bmp ? Texture_LoadBMP(data, size) : is_obj ? Mesh_LoadOBJ(data, size) : Mesh_LoadMD2(data, size);
+    free(data);
+    if (id == 0xFFFFFFFF) {
+        printf("Failed to load: %s\n", in_name);
+        return 1;
+    }
+    if (!is_bmp) Mesh_GenerateLods(id, MESH_MAX_LODS);
+    if (is_obj) Mesh_PackStatic(id);
+    if (is_obj) {
+        Mesh_BuildClusters(id);
+        float acmr = Mesh_CacheMissRatio(id, 0);
+        if (Mesh_OptimizeOrder(id)) printf("Vertex order: ACMR %.2f -> %.2f\n", acmr, Mesh_CacheMissRatio(id, 0));
+    }
 
-        for (int j = 0; j < 3; j++) {
-            Vec3 pos, norm;
-            Vec2 uv_dummy;
-            Mesh_GetMD2Vertex(mesh_id, indices[i + j], frame_a, frame_b, lerp, &pos, &norm, &uv_dummy);
+    uint32_t image_size = is_bmp ? Texture_Bake(id, NULL, 0) : Mesh_Bake(id, NULL, 0);
+    void* image = malloc(image_size);
+    uint32_t baked = 0;
+    if (image) baked = is_bmp ? Texture_Bake(id, image, image_size) : Mesh_Bake(id, image, image_size);
+    if (!image || baked != image_size) {
+        free(image);
+        return 1;
+    }
 
-            // Get UV from expanded per-triangle storage
-            Vec2 uv = MakeVec2(uvs[i + j].u, uvs[i + j].v);
+    FILE* f = fopen(out_name, "wb");
+    size_t written = f ? fwrite(image, 1, image_size, f) : 0;
+    if (f) fclose(f);
+    free(image);
+    if (written != image_size) {
+        printf("Failed to write file: %s\n", out_name);
+        return 1;
+    }
+    printf("Cooked %s -> %s (%u bytes)\n", in_name, out_name, image_size);
+    return 0;
+}
 
-            Vertex_t v;
-            v.position = pos;
-            v.normal = norm;
-            v.texcoord = uv;
+static void WriteTraceFile(const char* text, uint32_t length, void* user)
+{
+    fwrite(text, 1, length, (FILE*)user);
+}
 
-            if (!TransformVertex(&v, model_matrix, &sv[j])) {
-                valid = 0;
-                break;
-            }
-        }
+/* Board telemetry (UART or a per-port SWO export, or a raw SWO capture
+ * with its ITM port) to Chrome trace JSON, see telemetry.h */
+static int DecodeTelemetry(const char* in_name, const char* out_name, int itm_port)
+{
+    uint32_t size = 0;
+    void* data = LoadFileToMemory(in_name, &size);
+    if (!data) return 1;
 
-        if (!valid) continue;
-
-        /* Backface culling */
-        int32_t ax = sv[1].x - sv[0].x;
-        int32_t ay = sv[1].y - sv[0].y;
-        int32_t bx = sv[2].x - sv[0].x;
-        int32_t by = sv[2].y - sv[0].y;
-        int32_t cross = ax * by - ay * bx;
-        if (cross <= 0) continue;
-
-        if (texture) {
-            // Convert TextureSlot_t to Texture_t for rasterizer
-            Texture_t tex;
-            tex.width = texture->width;
-            tex.height = texture->height;
-            tex.width_mask = texture->width_mask;
-            tex.height_mask = texture->height_mask;
-            tex.pixels = &g_pixel_pool[texture->pixel_start];
-
-            Rasterizer_DrawTriangle(&sv[0], &sv[1], &sv[2], &tex);
-        }
-        else {
-            Rasterizer_DrawTriangleSolid(&sv[0], &sv[1], &sv[2], COLOR_BLUE);
-        }
+    FILE* f = fopen(out_name, "wb");
+    if (!f) {
+        free(data);
+        printf("Failed to write file: %s\n", out_name);
+        return 1;
     }
+    uint32_t packets = Telemetry_Decode(data, size, itm_port, WriteTraceFile, f);
+    fclose(f);
+    free(data);
+    printf("Decoded %s -> %s (%u packets)\n", in_name, out_name, packets);
+    return packets ? 0 : 1;
+}
+
+/* ============================================================
+ * Materials
+ * ============================================================ */
+
+/* Demo look per entity; animated draws use the MD2 skin */
+static void PickMaterial(const DrawCmd_t* cmd, uint16_t* color, uint32_t* texture, void* user)
+{
+    (void)user;
+    Material_GetDraw(cmd->material_id, color, texture);
+    if (cmd->entity == g_cube_entity)  *color = COLOR_RED;
+    if (cmd->entity == g_plane_entity) *color = 0x8410; /* Gray */
+    if (cmd->entity == g_obj_entity)   *color = COLOR_GREEN;
+    if (cmd->entity == g_md2_entity)   *color = COLOR_BLUE;
+    if (cmd->flags & DRAW_FLAG_ANIMATED) *texture = g_md2_texture;
 }
+
 /* ============================================================
  * Update Camera
  * ============================================================ */
@@ -254,6 +341,262 @@ static void UpdateCamera(void)
     float near_plane = 0.1f;
     float far_plane = 100.0f;
     Mat4_Perspective(&g_proj_matrix, fov, aspect, near_plane, far_plane);
+
+    Mat4_Multiply(&g_view_proj_matrix, &g_proj_matrix, &g_view_matrix);
+    Clip_ExtractFrustum(&g_view_proj_matrix, &g_frustum);
+}
+
+/* ============================================================
+ * Simulation
+ * ============================================================ */
+
+/* Keys sampled on the main thread; the step may run on the pacer's
+ * helper thread while the previous frame is presented */
+typedef struct {
+    float dt;
+    uint8_t left, right, up, down;
+    uint8_t forward, back, strafe_left, strafe_right;
+    uint8_t rise, sink;
+} SimInput_t;
+
+static float g_rotation = 0.0f;
+
+static void SampleInput(SimInput_t* in, float dt)
+{
+    const Uint8* keys = SDL_GetKeyboardState(NULL);
+    in->dt = dt;
+    in->left = keys[SDL_SCANCODE_LEFT];
+    in->right = keys[SDL_SCANCODE_RIGHT];
+    in->up = keys[SDL_SCANCODE_UP];
+    in->down = keys[SDL_SCANCODE_DOWN];
+    in->forward = keys[SDL_SCANCODE_W];
+    in->back = keys[SDL_SCANCODE_S];
+    in->strafe_left = keys[SDL_SCANCODE_A];
+    in->strafe_right = keys[SDL_SCANCODE_D];
+    in->rise = keys[SDL_SCANCODE_SPACE];
+    in->sink = keys[SDL_SCANCODE_LCTRL];
+}
+
+/* ============================================================
+ * Entity Systems
+ * ============================================================ */
+
+static uint32_t AllSlots(void* user)
+{
+    (void)user;
+    return MAX_ENTITIES;
+}
+
+static uint32_t AllAnimators(void* user)
+{
+    (void)user;
+    return Entity_GetAnimatorCount();
+}
+
+static void RunLocalTransforms(uint32_t first, uint32_t count, float dt, void* user)
+{
+    (void)dt; (void)user;
+    Entity_UpdateLocalTransforms(first, count);
+}
+
+static void RunAnimators(uint32_t first, uint32_t count, float dt, void* user)
+{
+    (void)user;
+    Entity_UpdateAnimatorRange(first, count, dt);
+}
+
+static void RunPropagate(uint32_t first, uint32_t count, float dt, void* user)
+{
+    (void)first; (void)count; (void)dt; (void)user;
+    Entity_PropagateTransforms();
+}
+
+/* Hand the visible meshes over as a draw list, as the CM4 does on the board */
+static void RunSceneBuild(uint32_t first, uint32_t count, float dt, void* user)
+{
+    (void)first; (void)count; (void)dt; (void)user;
+    DrawList_t* out = SceneBuffer_BeginWrite();
+    if (out) {
+        SceneBuffer_Build(out, &g_view_proj_matrix, &g_frustum);
+        SceneBuffer_EndWrite(out);
+    }
+}
+
+/* Local matrices and animators share a wave; the rest follow in order */
+static void RegisterSystems(void)
+{
+    static const System_t systems[] = {
+        { "Sys_LocalTransforms", COMP_TRANSFORM, COMP_TRANSFORM, AllSlots, RunLocalTransforms, NULL },
+        { "Sys_Animators", COMP_ANIMATOR | COMP_MESH_RENDERER, COMP_ANIMATOR | COMP_MESH_RENDERER, AllAnimators,
+          RunAnimators, NULL },
+        { "Sys_Propagate", COMP_TRANSFORM | COMP_MESH_RENDERER, COMP_TRANSFORM | COMP_MESH_RENDERER, NULL,
+          RunPropagate, NULL },
+        { "Sys_SceneBuild", COMP_TRANSFORM | COMP_MESH_RENDERER | COMP_LIGHT | COMP_CAMERA, COMP_MESH_RENDERER, NULL,
+          RunSceneBuild, NULL },
+    };
+    Systems_Init();
+    for (uint32_t i = 0; i < sizeof(systems) / sizeof(systems[0]); i++) Systems_Add(&systems[i]);
+}
+
+/* Camera, entity systems and the draw list of one step */
+static void Simulate(void* user)
+{
+    const SimInput_t* in = (const SimInput_t*)user;
+    float dt = in->dt;
+    float move_speed = 5.0f * dt;
+    float rot_speed = 2.0f * dt;
+
+    /* Camera rotation */
+    if (in->left)  g_camera_rot.y -= rot_speed;
+    if (in->right) g_camera_rot.y += rot_speed;
+    if (in->up)    g_camera_rot.x -= rot_speed;
+    if (in->down)  g_camera_rot.x += rot_speed;
+
+    /* Camera movement (relative to view direction) */
+    float sin_y, cos_y;
+    Math_SinCos(g_camera_rot.y, &sin_y, &cos_y);
+
+    if (in->forward) {
+        g_camera_pos.x -= sin_y * move_speed;
+        g_camera_pos.z -= cos_y * move_speed;
+    }
+    if (in->back) {
+        g_camera_pos.x += sin_y * move_speed;
+        g_camera_pos.z += cos_y * move_speed;
+    }
+    if (in->strafe_left) {
+        g_camera_pos.x -= cos_y * move_speed;
+        g_camera_pos.z += sin_y * move_speed;
+    }
+    if (in->strafe_right) {
+        g_camera_pos.x += cos_y * move_speed;
+        g_camera_pos.z -= sin_y * move_speed;
+    }
+    if (in->rise) g_camera_pos.y += move_speed;
+    if (in->sink) g_camera_pos.y -= move_speed;
+
+    /* Update rotation */
+    g_rotation += dt;
+
+    /* Update entity transforms */
+    Transform_SetRotation(g_cube_entity, MakeVec3(g_rotation * 0.5f, g_rotation, 0));
+    Transform_SetRotation(g_obj_entity, MakeVec3(0, g_rotation * 0.3f, 0));
+
+    if (g_md2_entity != INVALID_ENTITY) {
+        //Transform_SetRotation(g_md2_entity, MakeVec3(0, g_rotation * 0.9f, 0));
+    }
+
+    /* The camera first: the scene build culls against it */
+    UpdateCamera();
+    Systems_Run(dt);
+}
+
+static void Present(void* user)
+{
+    (void)user;
+    uint64_t present_start = Profile_Now();
+    SDL_UpdateWindowSurface(gWindow);
+    Rasterizer_AddStageTime(RASTER_STAGE_PRESENT, present_start, Profile_Now());
+}
+
+/* ============================================================
+ * Scene Setup
+ * ============================================================ */
+
+/* Animated player entity around g_md2_mesh */
+static void CreateMD2Entity(void)
+{
+    g_md2_entity = Entity_Create("MD2Player");
+    Entity_AddComponent(g_md2_entity, COMP_MESH_RENDERER);
+    Entity_AddComponent(g_md2_entity, COMP_ANIMATOR);
+    Transform_SetPosition(g_md2_entity, MakeVec3(3, 0, 0));
+    Transform_SetScale(g_md2_entity, MakeVec3(0.05f, 0.05f, 0.05f));
+    Transform_SetRotation(g_md2_entity, MakeVec3(-1.8f,  4.9f, 0));
+
+    MeshRenderer_t* md2_mr = Entity_GetMeshRenderer(g_md2_entity);
+    if (md2_mr) {
+        MeshRenderer_SetMesh(md2_mr, g_md2_mesh);
+        md2_mr->visible = 1;
+        md2_mr->is_animated = 1;
+        md2_mr->anim_frame_a = 0;
+        md2_mr->anim_frame_b = 1;
+        md2_mr->anim_lerp = 0;
+        md2_mr->cast_shadows = 1;
+        MeshDraw_SyncBounds(md2_mr);
+    }
+
+    /* Set up "stand" animation */
+    Animator_t* anim = Entity_GetAnimator(g_md2_entity);
+    if (anim) {
+        int start, end;
+        if (MD2_GetAnimRange("death1", &start, &end)) {
+            anim->start_frame = start;
+            anim->end_frame = end;
+            anim->current_frame = start;
+            anim->next_frame = start + 1;
+            anim->frame_rate = MD2_GetAnimFrameRate("death1");
+        }
+        else {
+            anim->start_frame = 0;
+            anim->end_frame = 39;
+            anim->current_frame = 0;
+            anim->next_frame = 1;
+        }
+        anim->is_playing = 1;
+        anim->is_looping = 1;
+        anim->playback_speed = 1.0f;
+    }
+}
+
+/* Stream completions; they run in Stream_Update() on the main thread */
+static void OnOBJStreamed(uint32_t handle, uint32_t id, void* user)
+{
+    (void)user;
+    Stream_Release(handle);
+    if (id == 0xFFFFFFFF) {
+        printf("Note: data/suzanne.obj not loaded, keeping the cube\n");
+        return;
+    }
+    printf("Streamed OBJ mesh: %u\n", id);
+    g_obj_mesh = id;
+    DirtyRect_Invalidate();
+    Mesh_GenerateLods(g_obj_mesh, MESH_MAX_LODS);
+    Mesh_PackStatic(g_obj_mesh);
+    Mesh_BuildClusters(g_obj_mesh);
+    Mesh_OptimizeOrder(g_obj_mesh);
+
+    MeshRenderer_t* mr = Entity_GetMeshRenderer(g_obj_entity);
+    if (mr) {
+        MeshRenderer_SetMesh(mr, g_obj_mesh);
+        MeshDraw_SyncBounds(mr);
+    }
+}
+
+static void OnMD2Streamed(uint32_t handle, uint32_t id, void* user)
+{
+    (void)user;
+    Stream_Release(handle);
+    if (id == 0xFFFFFFFF) {
+        printf("Note: MD2 model not loaded\n");
+        return;
+    }
+    printf("Streamed MD2 mesh: %u\n", id);
+    g_md2_mesh = id;
+    Mesh_GenerateLods(g_md2_mesh, MESH_MAX_LODS);
+    CreateMD2Entity();
+}
+
+static void OnTextureStreamed(uint32_t handle, uint32_t id, void* user)
+{
+    (void)user;
+    Stream_Release(handle);
+    if (id == 0xFFFFFFFF) {
+        printf("Note: MD2 texture not loaded, using checkerboard\n");
+        return;
+    }
+    printf("Streamed MD2 texture: %u\n", id);
+    g_md2_texture = id;
+    DirtyRect_Invalidate();
 }
 
 /* ============================================================
@@ -285,12 +628,26 @@ static bool Init(void)
     gScreenSurface = SDL_GetWindowSurface(gWindow);
     gDevice = new Device(gScreenSurface);
 
-    /* Initialize subsystems */
+    /* Initialize subsystems; the profiler first so this is thread 0 */
+    Profile_Init();
     Rasterizer_Init();
+    Arena_Init();
     Rasterizer_SetDevice(gDevice);
+    Rasterizer_SetBinning(1);
+    Rasterizer_SetPerspectiveSpan(8);
+    DynRes_Init(0.5f, 1.0f);
+    Power_Init();
+    DirtyRect_Init(1);  /* The window surface keeps last frame's pixels */
+    Jobs_Init(0);
+    printf("Render threads: %u\n", Jobs_GetThreadCount());
     Mesh_Init();
     Texture_Init();
+    TexCache_Init();
+    Impostor_Init();
+    Impostor_SetEnabled(1);
     Entity_Init();
+    SceneBuffer_Init();
+    RegisterSystems();
 
     /* Create built-in meshes */
     g_cube_mesh = Mesh_CreateCube(1.0f);
@@ -303,42 +660,46 @@ static bool Init(void)
     g_checker_tex = Texture_CreateCheckerboard(0xFFFF, 0x8410, 64);
     printf("Created checker texture: %u\n", g_checker_tex);
 
-    /* Try to load OBJ model */
-    uint32_t obj_size = 0;
-    void* obj_data = LoadFileToMemory("data/suzanne.obj", &obj_size);
-    if (obj_data) {
-        g_obj_mesh = Mesh_LoadOBJ(obj_data, obj_size);
-        free(obj_data);
-        printf("Loaded OBJ mesh: %u\n", g_obj_mesh);
+    /* Baked images map in place; anything else streams in over the first
+     * frames, drawn with a placeholder until it is ready */
+    Stream_Init();
+
+    g_obj_mesh = LoadBakedMesh("data/suzanne.bmsh", &g_obj_image);
+    if (g_obj_mesh != 0xFFFFFFFF) {
+        printf("Mapped baked OBJ mesh: %u\n", g_obj_mesh);
     }
     else {
-        printf("Note: models/teapot.obj not found, using cube instead\n");
         g_obj_mesh = g_cube_mesh;
+        Stream_Request("data/suzanne.obj", STREAM_MESH_OBJ, g_cube_mesh, OnOBJStreamed, NULL);
     }
 
-    /* Try to load MD2 model */
-    uint32_t md2_size = 0;
-    void* md2_data = LoadFileToMemory("data/md2/q2mdl-wham/tris.MD2", &md2_size);
-    if (md2_data) {
-        g_md2_mesh = Mesh_LoadMD2(md2_data, md2_size);
-        free(md2_data);
-        printf("Loaded MD2 mesh: %u\n", g_md2_mesh);
+    /* Static meshes render from the 12-byte packed format */
+    Mesh_PackStatic(g_cube_mesh);
+    Mesh_PackStatic(g_plane_mesh);
+    if (g_obj_mesh != g_cube_mesh) Mesh_PackStatic(g_obj_mesh);
+
+    g_md2_mesh = LoadBakedMesh("data/md2/q2mdl-wham/tris.bmsh", &g_md2_image);
+    if (g_md2_mesh != 0xFFFFFFFF) {
+        printf("Mapped baked MD2 mesh: %u\n", g_md2_mesh);
     }
     else {
-        printf("Note: models/player.md2 not found\n");
+        Stream_Request("data/md2/q2mdl-wham/tris.MD2", STREAM_MESH_MD2, 0xFFFFFFFF, OnMD2Streamed, NULL);
     }
-    uint32_t tex_size = 0;
-    void* tex_data = LoadFileToMemory("data/md2/q2mdl-wham/ctf_r.bmp", &tex_size);
-    if (tex_data) {
-        g_md2_texture = Texture_LoadBMP(tex_data, tex_size);
-        free(tex_data);
-        printf("Loaded MD2 texture: %u\n", g_md2_texture);
+
+    g_md2_texture = LoadBakedTexture("data/md2/q2mdl-wham/ctf_r.btex", &g_md2_texture_image);
+    if (g_md2_texture != 0xFFFFFFFF) {
+        printf("Mapped baked MD2 texture: %u\n", g_md2_texture);
     }
     else {
-        printf("Note: models/player.pcx not found, using checkerboard\n");
         g_md2_texture = g_checker_tex;
+        Stream_Request("data/md2/q2mdl-wham/ctf_r.bmp", STREAM_TEXTURE_BMP, g_checker_tex, OnTextureStreamed, NULL);
     }
 
+#ifdef SDL_PC
+    /* Decode whatever was queued side by side; the frames only commit */
+    Stream_DecodeQueued();
+#endif
+
     /* ============================================================
      * Create Entities
      * ============================================================ */
@@ -361,10 +722,20 @@ static bool Init(void)
     Transform_SetPosition(g_plane_entity, MakeVec3(0, -1, 0));
     MeshRenderer_t* plane_mr = Entity_GetMeshRenderer(g_plane_entity);
     if (plane_mr) {
-        plane_mr->mesh_id = g_plane_mesh;
+        MeshRenderer_SetMesh(plane_mr, g_plane_mesh);
         plane_mr->visible = 1;
         plane_mr->is_animated = 0;
+        plane_mr->occluder = 1;
+        plane_mr->is_static = 1;
+        MeshDraw_SyncBounds(plane_mr);
     }
+    Shadow_SetPlane(MakeVec3(0, 1, 0), 1.0f);   /* The ground's top, y = -1 */
+
+    /* Materials: the cube goes back to "Default" (id 0) off glass; like
+     * renderers without a material, it draws opaque */
+    Resource_CreateMaterial("Default");
+    g_glass_material = Resource_CreateMaterial("Glass");
+    Material_SetFlags(g_glass_material, MAT_TRANSPARENT);
 
     /* Spinning cube */
     g_cube_entity = Entity_Create("SpinningCube");
@@ -372,9 +743,11 @@ static bool Init(void)
     Transform_SetPosition(g_cube_entity, MakeVec3(-3, 0, 0));
     MeshRenderer_t* cube_mr = Entity_GetMeshRenderer(g_cube_entity);
     if (cube_mr) {
-        cube_mr->mesh_id = g_cube_mesh;
+        MeshRenderer_SetMesh(cube_mr, g_cube_mesh);
         cube_mr->visible = 1;
         cube_mr->is_animated = 0;
+        cube_mr->occluder = 1;
+        MeshDraw_SyncBounds(cube_mr);
     }
 
     /* OBJ model entity */
@@ -384,69 +757,128 @@ static bool Init(void)
     Transform_SetScale(g_obj_entity, MakeVec3(0.5f, 0.5f, 0.5f));
     MeshRenderer_t* obj_mr = Entity_GetMeshRenderer(g_obj_entity);
     if (obj_mr) {
-        obj_mr->mesh_id = g_obj_mesh;
+        MeshRenderer_SetMesh(obj_mr, g_obj_mesh);
         obj_mr->visible = 1;
         obj_mr->is_animated = 0;
+        MeshDraw_SyncBounds(obj_mr);
     }
 
     /* MD2 animated entity */
-    if (g_md2_mesh != 0xFFFFFFFF) {
-        g_md2_entity = Entity_Create("MD2Player");
-        Entity_AddComponent(g_md2_entity, COMP_MESH_RENDERER);
-        Entity_AddComponent(g_md2_entity, COMP_ANIMATOR);
-        Transform_SetPosition(g_md2_entity, MakeVec3(3, 0, 0));
-        Transform_SetScale(g_md2_entity, MakeVec3(0.05f, 0.05f, 0.05f));
-        Transform_SetRotation(g_md2_entity, MakeVec3(-1.8f,  4.9f, 0));
-
-        MeshRenderer_t* md2_mr = Entity_GetMeshRenderer(g_md2_entity);
-        if (md2_mr) {
-            md2_mr->mesh_id = g_md2_mesh;
-            md2_mr->visible = 1;
-            md2_mr->is_animated = 1;
-            md2_mr->anim_frame_a = 0;
-            md2_mr->anim_frame_b = 1;
-            md2_mr->anim_lerp = 0;
-        }
+    if (g_md2_mesh != 0xFFFFFFFF) CreateMD2Entity();
+
+    /* Small material textures onto shared pages (texatlas.h) */
+    uint32_t atlas_pages = Resource_AtlasMaterials();
+    if (atlas_pages) printf("Atlased material textures onto %u pages\n", atlas_pages);
+
+    /* Lights: a sun angled down the scene and a warm lamp by the cube */
+    EntityID sun = Entity_Create("Sun");
+    Entity_AddComponent(sun, COMP_LIGHT);
+    Transform_SetRotation(sun, MakeVec3(-0.9f, 0.6f, 0));
+    Light_t* sun_light = Entity_GetLight(sun);
+    if (sun_light) {
+        sun_light->type = LIGHT_DIRECTIONAL;
+        sun_light->color = MakeVec3(1.0f, 0.95f, 0.85f);
+        sun_light->intensity = 0.7f;
+    }
 
-        /* Set up "stand" animation */
-        Animator_t* anim = Entity_GetAnimator(g_md2_entity);
-        if (anim) {
-            int start, end;
-            if (MD2_GetAnimRange("death1", &start, &end)) {
-                anim->start_frame = start;
-                anim->end_frame = end;
-                anim->current_frame = start;
-                anim->next_frame = start + 1;
-            }
-            else {
-                anim->start_frame = 0;
-                anim->end_frame = 39;
-                anim->current_frame = 0;
-                anim->next_frame = 1;
-            }
-            anim->is_playing = 1;
-            anim->is_looping = 1;
-            anim->playback_speed = 1.0f;
-        }
+    EntityID lamp = Entity_Create("Lamp");
+    Entity_AddComponent(lamp, COMP_LIGHT);
+    Transform_SetPosition(lamp, MakeVec3(-1.5f, 1.5f, 1.5f));
+    Light_t* lamp_light = Entity_GetLight(lamp);
+    if (lamp_light) {
+        lamp_light->type = LIGHT_POINT;
+        lamp_light->color = MakeVec3(1.0f, 0.6f, 0.3f);
+        lamp_light->intensity = 0.8f;
+        lamp_light->range = 6.0f;
     }
 
+    MemMap_Print();
+
     printf("\nEngine initialized successfully!\n");
     printf("Controls:\n");
     printf("  WASD - Move camera\n");
     printf("  Arrow keys - Rotate camera\n");
     printf("  Space/Ctrl - Move up/down\n");
+    printf("  B - Toggle tile binning\n");
+    printf("  G - Toggle the visibility buffer (binning only)\n");
+    printf("  F - Toggle bilinear filtering\n");
+    printf("  Y - Toggle the glass cube (transparent pass)\n");
+    printf("  O - Cycle stats overlay (off, stats, stats + tiles)\n");
+    printf("  P - Save profiler trace (trace.json)\n");
+    printf("  C - Capture the next frame (capture.scap, see --replay)\n");
+    printf("  E - Toggle telemetry recording (telemetry.bin, see --telemetry)\n");
+    printf("  H - Cycle heat map (off, depth tests, shaded, cost)\n");
+    printf("  M - Save the heat map (heatmap.tif)\n");
+    printf("  V - Toggle frame recording (frames_NNNNN.tif)\n");
+    printf("  T - Cycle frame rate cap (60 Hz, 30 Hz, off)\n");
+    printf("  L - Toggle simulating the next frame during present\n");
+    printf("  R - Toggle dynamic resolution (holds the frame budget)\n");
+    printf("  J - Toggle clock scaling (slower clock while frames finish early)\n");
+    printf("  X - Toggle dirty-rectangle redraw (only what changed)\n");
+    printf("  I - Toggle impostors for distant animated models\n");
+    printf("  N - Cycle debug lines (off, wireframe, wireframe + bounds)\n");
+    printf("  Z - Toggle the depth prepass (opaque depth first, then shade once)\n");
+    printf("  K - Toggle interlaced fields (half the rows per frame)\n");
+    printf("  U - Toggle the static layer (ground drawn once while nothing moves)\n");
+    printf("  Q - Toggle retained static draws (reused while the view holds)\n");
+    printf("  1 - Toggle planar shadows (MD2 player onto the ground)\n");
     printf("  ESC - Quit\n\n");
 
     return true;
 }
 
+/* Waits for the queued frames and reports the recording */
+static void StopRecording(void)
+{
+    FrameDump_Stop();
+    FrameDumpStats_t dump;
+    FrameDump_GetStats(&dump);
+    printf("Frame recording: %u written, %u dropped, %u failed, %u KB, submit at most %.2f ms\n",
+        dump.written, dump.dropped, dump.failed, (unsigned)(dump.bytes / 1024),
+        (double)dump.copy_ticks_max * 1000.0 / (double)Profile_TicksPerSecond());
+}
+
 /* ============================================================
  * Cleanup
  * ============================================================ */
 static void Shutdown(void)
 {
+    if (FrameDump_IsRunning()) StopRecording();
+    if (Telemetry_IsRunning()) Telemetry_Stop();
+
+    ArenaStats_t arena;
+    Arena_GetStats(&arena);
+    printf("Frame arena high water: DTCM %u/%u, AXI %u/%u bytes, %u failed\n",
+        arena.high_water[ARENA_DTCM], arena.capacity[ARENA_DTCM],
+        arena.high_water[ARENA_AXI], arena.capacity[ARENA_AXI], arena.failed_allocs);
+
+    SceneBufferStats_t scene;
+    SceneBuffer_GetStats(&scene);
+    printf("Draw lists: %u published, %u consumed, %u dropped, %u with retained static draws\n",
+        scene.published, scene.consumed, scene.dropped, scene.static_reused);
+
+    TexCacheStats_t cache;
+    TexCache_GetStats(&cache);
+    printf("Texture cache: %u hits, %u misses, %u loads (%u KB), %u evictions\n",
+        cache.hits, cache.misses, cache.loads, cache.bytes_copied / 1024, cache.evictions);
+
+    StreamStats_t stream;
+    Stream_GetStats(&stream);
+    printf("Streaming: %u requested, %u loaded, %u failed, %u KB read\n",
+        stream.requested, stream.completed, stream.failed, stream.bytes_read / 1024);
+    Stream_Shutdown();
+
+    FramePacer_Shutdown();
+    Jobs_Shutdown();
     Entity_Shutdown();
 
+    if (g_obj_image.data) Mesh_Free(g_obj_mesh);
+    if (g_md2_image.data) Mesh_Free(g_md2_mesh);
+    if (g_md2_texture_image.data) Texture_Free(g_md2_texture);
+    UnmapFile(&g_obj_image);
+    UnmapFile(&g_md2_image);
+    UnmapFile(&g_md2_texture_image);
+
     if (gDevice) {
         delete gDevice;
         gDevice = NULL;
@@ -465,7 +897,26 @@ static void Shutdown(void)
  * ============================================================ */
 int main(int argc, char* args[])
 {
-    (void)argc; (void)args;
+    /* rasterizer --cook in.obj|in.md2 out.bmsh, --cook in.bmp out.btex */
+    if (argc == 4 && strcmp(args[1], "--cook") == 0) {
+        return CookAsset(args[2], args[3]);
+    }
+
+    /* rasterizer --telemetry in.bin out.json [itm port] */
+    if ((argc == 4 || argc == 5) && strcmp(args[1], "--telemetry") == 0) {
+        return DecodeTelemetry(args[2], args[3], argc == 5 ? atoi(args[4]) : TELEMETRY_DECODE_RAW);
+    }
+
+    /* rasterizer --bench [scene|all] [frames]: headless, see bench.h */
+    if (argc >= 2 && strcmp(args[1], "--bench") == 0) {
+        return Bench_Main(argc - 2, args + 2);
+    }
+    if (argc >= 2 && strcmp(args[1], "--micro") == 0) {
+        return Bench_Micro(argc - 2, args + 2);
+    }
+    if (argc >= 2 && strcmp(args[1], "--replay") == 0) {
+        return Bench_Replay(argc - 2, args + 2);
+    }
 
     if (!Init()) {
         printf("Initialization failed!\n");
@@ -475,14 +926,30 @@ int main(int argc, char* args[])
     bool quit = false;
     SDL_Event e;
 
-    Uint32 last_time = SDL_GetTicks();
-    float rotation = 0.0f;
+    int overlay = 0;                /* 0 off, 1 stats, 2 stats and tile heat */
+    uint32_t debug_lines = 0;       /* DEBUGDRAW_* over the scene */
+    bool capture_pending = false;   /* Save once the armed capture is done */
+    bool heat_save = false;         /* Write the next resolved heat map */
+    bool pipelined = true;          /* Next step simulated during present */
+    RasterizerStats_t last_stats;   /* Previous frame, present included */
+    Mat4 last_view_proj;            /* Camera of the last drawn list, for field resolves */
+    memset(&last_view_proj, 0, sizeof(last_view_proj));
+    memset(&last_stats, 0, sizeof(last_stats));
+
+    static const uint32_t rates[] = { 60, 30, 0 };
+    uint32_t rate = 0;
+    FramePacer_Init(PACER_VSYNC, rates[rate]);
+
+    /* The first frame draws a list built in advance */
+    SimInput_t input;
+    SampleInput(&input, FramePacer_BeginFrame());
+    Simulate(&input);
 
     while (!quit) {
-        /* Calculate delta time */
-        Uint32 current_time = SDL_GetTicks();
-        float dt = (current_time - last_time) / 1000.0f;
-        last_time = current_time;
+        uint64_t frame_start = Profile_Now();
+
+        /* Step of this frame; whole periods while paced */
+        float dt = FramePacer_BeginFrame();
 
         /* Handle events */
         while (SDL_PollEvent(&e) != 0) {
@@ -490,120 +957,246 @@ int main(int argc, char* args[])
                 quit = true;
             }
             else if (e.type == SDL_KEYDOWN) {
+                /* Most keys change how the scene looks */
+                StaticLayer_Invalidate();
                 if (e.key.keysym.sym == SDLK_ESCAPE) {
                     quit = true;
                 }
+                else if (e.key.keysym.sym == SDLK_b) {
+                    Rasterizer_SetBinning(!Rasterizer_IsBinning());
+                    printf("Tile binning: %s\n", Rasterizer_IsBinning() ? "on" : "off");
+                }
+                else if (e.key.keysym.sym == SDLK_g) {
+                    Rasterizer_SetVisibilityBuffer(!Rasterizer_IsVisibilityBuffer());
+                    DirtyRect_Invalidate();
+                    printf("Visibility buffer: %s\n", Rasterizer_IsVisibilityBuffer() ? "on" : "off");
+                }
+                else if (e.key.keysym.sym == SDLK_f) {
+                    Rasterizer_SetState(Rasterizer_GetState() ^ RASTER_STATE_BILINEAR);
+                    DirtyRect_Invalidate();
+                    printf("Bilinear filtering: %s\n", (Rasterizer_GetState() & RASTER_STATE_BILINEAR) ? "on" : "off");
+                }
+                else if (e.key.keysym.sym == SDLK_y) {
+                    MeshRenderer_t* mr = Entity_GetMeshRenderer(g_cube_entity);
+                    if (mr) {
+                        MeshRenderer_SetMaterial(mr, (mr->material_id == g_glass_material) ? 0 : g_glass_material);
+                        printf("Glass cube: %s\n", (mr->material_id == g_glass_material) ? "on" : "off");
+                    }
+                }
+                else if (e.key.keysym.sym == SDLK_o) {
+                    overlay = (overlay + 1) % 3;
+                }
+                else if (e.key.keysym.sym == SDLK_p) {
+                    printf("Profiler trace: %u zones -> trace.json\n", Profile_SaveTrace("trace.json"));
+                }
+                else if (e.key.keysym.sym == SDLK_e) {
+                    if (Telemetry_IsRunning()) {
+                        TelemetryStats_t tel;
+                        Telemetry_GetStats(&tel);
+                        Telemetry_Stop();
+                        printf("Telemetry: off (%u frames, %u KB, %u dropped)\n",
+                            tel.frames, tel.bytes / 1024, tel.dropped);
+                    }
+                    else if (Telemetry_StartFile("telemetry.bin")) {
+                        printf("Telemetry: on -> telemetry.bin\n");
+                    }
+                }
+                else if (e.key.keysym.sym == SDLK_c) {
+                    Capture_Begin();
+                    DirtyRect_Invalidate();
+                    capture_pending = true;
+                }
+                else if (e.key.keysym.sym == SDLK_h) {
+                    static const char* modes[RASTER_HEAT_MODES] = { "off", "depth tests", "shaded", "cost" };
+                    Rasterizer_SetHeatMode((Rasterizer_GetHeatMode() + 1) % RASTER_HEAT_MODES);
+                    printf("Heat map: %s\n", modes[Rasterizer_GetHeatMode()]);
+                }
+                else if (e.key.keysym.sym == SDLK_m) {
+                    heat_save = Rasterizer_GetHeatMode() != RASTER_HEAT_OFF;
+                }
+                else if (e.key.keysym.sym == SDLK_v) {
+                    if (FrameDump_IsRunning()) StopRecording();
+                    else if (FrameDump_Start("frames", FRAMEDUMP_TIFF)) printf("Frame recording: on\n");
+                }
+                else if (e.key.keysym.sym == SDLK_t) {
+                    FramePacerStats_t pacing;
+                    FramePacer_GetStats(&pacing);
+                    printf("Frame pacing: %u frames, %u missed, jitter at most %.3f ms, work at most %.2f ms\n",
+                        pacing.frames, pacing.missed,
+                        (double)pacing.jitter_max * 1000.0 / (double)Profile_TicksPerSecond(),
+                        (double)pacing.work_max * 1000.0 / (double)Profile_TicksPerSecond());
+                    rate = (rate + 1) % ARRAY_SIZE(rates);
+                    FramePacer_SetTargetRate(rates[rate]);
+                    FramePacer_ResetStats();
+                    if (rates[rate]) printf("Frame rate cap: %u Hz\n", FramePacer_GetTargetRate());
+                    else printf("Frame rate cap: off\n");
+                }
+                else if (e.key.keysym.sym == SDLK_r) {
+                    DynRes_SetEnabled(!DynRes_IsEnabled());
+                    DynResStats_t res;
+                    DynRes_GetStats(&res);
+                    printf("Dynamic resolution: %s (%dx%d, %u drops, %u raises)\n", DynRes_IsEnabled() ? "on" : "off",
+                        res.width, res.height, res.drops, res.raises);
+                }
+                else if (e.key.keysym.sym == SDLK_j) {
+                    Power_SetEnabled(!Power_IsEnabled());
+                    PowerStats_t power;
+                    Power_GetStats(&power);
+                    printf("Clock scaling: %s (%u drops, %u raises, frames per level %u/%u/%u)\n",
+                        Power_IsEnabled() ? "on" : "off", power.drops, power.raises,
+                        power.frames[0], power.frames[1], power.frames[2]);
+                }
+                else if (e.key.keysym.sym == SDLK_x) {
+                    DirtyRectStats_t dirty;
+                    DirtyRect_GetStats(&dirty);
+                    DirtyRect_SetEnabled(!DirtyRect_IsEnabled());
+                    printf("Dirty-rectangle redraw: %s (%u frames, %u full, %u idle)\n", DirtyRect_IsEnabled() ? "on" : "off",
+                        dirty.frames, dirty.full_frames, dirty.idle_frames);
+                }
+                else if (e.key.keysym.sym == SDLK_i) {
+                    ImpostorStats_t imp;
+                    Impostor_GetStats(&imp);
+                    Impostor_SetEnabled(!Impostor_IsEnabled());
+                    DirtyRect_Invalidate();
+                    printf("Impostors: %s (%u sprites, %u drawn and %u refreshed last frame)\n",
+                        Impostor_IsEnabled() ? "on" : "off", imp.active, imp.drawn, imp.refreshed);
+                }
+                else if (e.key.keysym.sym == SDLK_n) {
+                    if (!debug_lines) debug_lines = DEBUGDRAW_WIREFRAME;
+                    else if (!(debug_lines & DEBUGDRAW_BOUNDS)) debug_lines |= DEBUGDRAW_BOUNDS;
+                    else debug_lines = 0;
+                    DirtyRect_Invalidate();
+                    printf("Debug lines: %s%s\n", debug_lines ? "wireframe" : "off",
+                        (debug_lines & DEBUGDRAW_BOUNDS) ? " and bounds" : "");
+                }
+                else if (e.key.keysym.sym == SDLK_z) {
+                    MeshDraw_SetDepthPrepass(!MeshDraw_IsDepthPrepass());
+                    printf("Depth prepass: %s\n", MeshDraw_IsDepthPrepass() ? "on" : "off");
+                }
+                else if (e.key.keysym.sym == SDLK_u) {
+                    StaticLayerStats_t layer;
+                    StaticLayer_GetStats(&layer);
+                    StaticLayer_SetEnabled(!StaticLayer_IsEnabled());
+                    DirtyRect_Invalidate();
+                    printf("Static layer: %s (%u frames, %u rebuilds)\n", StaticLayer_IsEnabled() ? "on" : "off",
+                        layer.frames, layer.rebuilds);
+                }
+                else if (e.key.keysym.sym == SDLK_q) {
+                    SceneBufferStats_t scene;
+                    SceneBuffer_GetStats(&scene);
+                    SceneBuffer_SetRetainStatic(!SceneBuffer_IsRetainStatic());
+                    printf("Retained static draws: %s (%u of %u lists reused them)\n",
+                        SceneBuffer_IsRetainStatic() ? "on" : "off", scene.static_reused, scene.published);
+                }
+                else if (e.key.keysym.sym == SDLK_1) {
+                    ShadowStats_t shadow;
+                    Shadow_GetStats(&shadow);
+                    Shadow_SetEnabled(!Shadow_IsEnabled());
+                    DirtyRect_Invalidate();
+                    printf("Planar shadows: %s (%u casters, %u triangles so far)\n",
+                        Shadow_IsEnabled() ? "on" : "off", shadow.casters, shadow.triangles);
+                }
+                else if (e.key.keysym.sym == SDLK_k) {
+                    Rasterizer_SetInterlace(!Rasterizer_IsInterlace());
+                    printf("Interlaced fields: %s\n", Rasterizer_IsInterlace() ? "on" : "off");
+                }
+                else if (e.key.keysym.sym == SDLK_l) {
+                    pipelined = !pipelined;
+                    printf("Simulate during present: %s\n", pipelined ? "on" : "off");
+                }
             }
         }
 
-        /* Handle input */
-        const Uint8* keys = SDL_GetKeyboardState(NULL);
-        float move_speed = 5.0f * dt;
-        float rot_speed = 2.0f * dt;
+        /* Finish at most one streamed load */
+        Stream_Update();
 
-        /* Camera rotation */
-        if (keys[SDL_SCANCODE_LEFT])  g_camera_rot.y -= rot_speed;
-        if (keys[SDL_SCANCODE_RIGHT]) g_camera_rot.y += rot_speed;
-        if (keys[SDL_SCANCODE_UP])    g_camera_rot.x -= rot_speed;
-        if (keys[SDL_SCANCODE_DOWN])  g_camera_rot.x += rot_speed;
+        /* Without the overlap, this frame's step runs right before it is drawn */
+        SampleInput(&input, dt);
+        if (!pipelined) Simulate(&input);
 
-        /* Camera movement (relative to view direction) */
-        float sin_y = sinf(g_camera_rot.y);
-        float cos_y = cosf(g_camera_rot.y);
-
-        if (keys[SDL_SCANCODE_W]) {
-            g_camera_pos.x -= sin_y * move_speed;
-            g_camera_pos.z -= cos_y * move_speed;
-        }
-        if (keys[SDL_SCANCODE_S]) {
-            g_camera_pos.x += sin_y * move_speed;
-            g_camera_pos.z += cos_y * move_speed;
-        }
-        if (keys[SDL_SCANCODE_A]) {
-            g_camera_pos.x -= cos_y * move_speed;
-            g_camera_pos.z += sin_y * move_speed;
-        }
-        if (keys[SDL_SCANCODE_D]) {
-            g_camera_pos.x += cos_y * move_speed;
-            g_camera_pos.z -= sin_y * move_speed;
+        /* ============================================================
+         * Rendering
+         * ============================================================ */
+        gDevice->Lock();
+        Rasterizer_GetStats(&last_stats);
+        if (DynRes_IsEnabled()) {
+            /* Resolution for this frame from the last one's cost */
+            FramePacerStats_t pacing;
+            FramePacer_GetStats(&pacing);
+            uint64_t budget = pacing.period ? pacing.period : Profile_TicksPerSecond() / 60;
+            DynRes_Update(budget, pacing.work_last,
+                (uint64_t)last_stats.stage_ticks[RASTER_STAGE_SETUP] + last_stats.stage_ticks[RASTER_STAGE_RASTER]);
         }
-        if (keys[SDL_SCANCODE_SPACE]) g_camera_pos.y += move_speed;
-        if (keys[SDL_SCANCODE_LCTRL]) g_camera_pos.y -= move_speed;
 
-        /* Update rotation */
-        rotation += dt;
-
-        /* Update entity transforms */
-        Transform_SetRotation(g_cube_entity, MakeVec3(rotation * 0.5f, rotation, 0));
-        Transform_SetRotation(g_obj_entity, MakeVec3(0, rotation * 0.3f, 0));
-
-        if (g_md2_entity != INVALID_ENTITY) {
-            //Transform_SetRotation(g_md2_entity, MakeVec3(0, rotation * 0.9f, 0));
+        const DrawList_t* draw = SceneBuffer_AcquireRead();
+        uint32_t redraw = 1;
+        if (DirtyRect_IsEnabled() && !StaticLayer_IsEnabled()) {
+            /* Overlays, heat and upscaling paint over the last frame's
+             * scene, and fields leave half of every rectangle behind */
+            if (overlay || debug_lines || Rasterizer_GetHeatMode() != RASTER_HEAT_OFF || DynRes_IsEnabled() ||
+                Rasterizer_IsInterlace()) DirtyRect_Invalidate();
+            RasterRect_t dirty[DIRTY_MAX_RECTS];
+            redraw = draw ? DirtyRect_Update(draw, dirty, DIRTY_MAX_RECTS) : 0;
+            Rasterizer_SetScissorRects(dirty, redraw);
         }
 
-        /* Update entity systems */
-        Entity_UpdateTransforms();
-        Entity_UpdateAnimators(dt);
-
-        /* Sync MD2 animation state */
-        if (g_md2_entity != INVALID_ENTITY) {
-            Animator_t* anim = Entity_GetAnimator(g_md2_entity);
-            MeshRenderer_t* mr = Entity_GetMeshRenderer(g_md2_entity);
-            if (anim && mr) {
-                mr->anim_frame_a = (uint16_t)anim->current_frame;
-                mr->anim_frame_b = (uint16_t)anim->next_frame;
-                mr->anim_lerp = anim->interpolation;
+        if (redraw) {
+            const uint16_t clear_color = RGB565(0x20, 0x20, 0x30);
+            if (!draw || !StaticLayer_Draw(draw, clear_color, PickMaterial, NULL)) {
+                Rasterizer_Clear(clear_color);
+                if (draw) MeshDraw_List(draw, PickMaterial, NULL);
+            }
+            if (draw && debug_lines) {
+                DebugDraw_List(draw, debug_lines, 1, RGB565(0xFF, 0xFF, 0xFF), RGB565(0xFF, 0xC0, 0x20));
             }
 
+            /* Resolve binned tiles */
+            Rasterizer_Flush();
+        }
+        int moved = draw && memcmp(&draw->view_proj, &last_view_proj, sizeof(Mat4)) != 0;
+        if (draw) last_view_proj = draw->view_proj;
+        if (draw) SceneBuffer_ReleaseRead(draw);
+        uint32_t heat_scale = Rasterizer_ResolveHeat(0);
+
+        /* A moving camera would comb against the last frame's rows */
+        Rasterizer_ResolveField(moved);
+        Rasterizer_SetScissorRects(NULL, 0);
+        Rasterizer_Upscale();
+        if (heat_save && heat_scale) {
+            gDevice->WriteToFile("heatmap.tif");
+            printf("Heat map: white at %u -> heatmap.tif\n", heat_scale);
+            heat_save = false;
+        }
+        if (overlay == 2) Overlay_DrawTileHeat();
+        if (overlay) Overlay_DrawStats(8, 8, &last_stats);
+        if (FrameDump_IsRunning()) FrameDump_Submit(gDevice);
+        gDevice->Unlock();
+
+        if (capture_pending && Capture_GetState() == CAPTURE_DONE) {
+            printf("Frame capture: %u bytes -> capture.scap\n", Capture_Save("capture.scap"));
+            capture_pending = false;
         }
 
-        /* Update camera */
-        UpdateCamera();
-
-        /* ============================================================
-         * Rendering
-         * ============================================================ */
-        gDevice->Clear(Color(0x20, 0x20, 0x30));
-        Rasterizer_ClearDepth();
-
-        /* Iterate through all renderable entities */
-        EntityIterator_t it;
-        Entity_BeginIteration(&it, COMP_TRANSFORM | COMP_MESH_RENDERER);
-
-        while (Entity_Next(&it)) {
-            Transform_t* xform = Entity_GetTransform(it.current);
-            MeshRenderer_t* mr = Entity_GetMeshRenderer(it.current);
-
-            if (!xform || !mr || !mr->visible) continue;
-
-            /* Choose color based on entity */
-            uint16_t color = 0xFFFF;
-            if (it.current == g_cube_entity)  color = COLOR_RED;
-            if (it.current == g_plane_entity) color = 0x8410; /* Gray */
-            if (it.current == g_obj_entity)   color = COLOR_GREEN;
-            if (it.current == g_md2_entity)   color = COLOR_BLUE;
-
-            if (mr->is_animated && mr->mesh_id != 0xFFFFFFFF) {
-                /* Render MD2 animated mesh */
-                TextureSlot_t* tex = Texture_Get(g_md2_texture);
-
-                RenderMD2Mesh(mr->mesh_id, &xform->world_matrix,
-                    mr->anim_frame_a, mr->anim_frame_b, mr->anim_lerp, tex);
-            }
-            else if (mr->mesh_id != 0xFFFFFFFF) {
-                /* Render static mesh */
-                RenderStaticMesh(mr->mesh_id, &xform->world_matrix, color);
-            }
+        /* Present; the next frame's step (same length while paced) meanwhile */
+        FramePacer_Overlap(Present, NULL, pipelined ? Simulate : NULL, &input);
+
+        /* Nothing references the pools between frames: defragment a little */
+        Mesh_Compact(1);
+        Texture_Compact(1);
+        Profile_Record("Frame", frame_start, Profile_Now());
+        if (Telemetry_IsRunning()) {
+            RasterizerStats_t frame_stats;
+            Rasterizer_GetStats(&frame_stats);
+            Telemetry_Frame(&frame_stats);
         }
 
-        /* Present */
-        SDL_UpdateWindowSurface(gWindow);
+        /* Hold the frame to the target rate */
+        FramePacer_EndFrame();
 
-        /* Cap to ~60 FPS */
-        Uint32 frame_time = SDL_GetTicks() - current_time;
-        if (frame_time < 16) {
-            SDL_Delay(16 - frame_time);
-        }
+        /* Clock for the next frame from this one's work */
+        FramePacerStats_t pacing;
+        FramePacer_GetStats(&pacing);
+        Power_Update(pacing.period, pacing.work_last);
     }
 
     Shutdown();
@@ -0,0 +1,86 @@
+/**
+ * @file arena.cpp
+ * @brief Per-Frame Linear Scratch Arena Implementation
+ */
+
+#include "arena.h"
+#include <string.h>
+
+/* ============================================================
+ * Regions
+ * ============================================================ */
+
+DTCM_BSS CACHE_ALIGNED static uint8_t g_arena_dtcm[FRAME_ARENA_DTCM_SIZE];
+AXI_DATA CACHE_ALIGNED static uint8_t g_arena_axi[FRAME_ARENA_AXI_SIZE];
+
+static uint8_t* const g_region_base[ARENA_REGION_COUNT] = { g_arena_dtcm, g_arena_axi };
+static const uint32_t g_region_size[ARENA_REGION_COUNT] = { FRAME_ARENA_DTCM_SIZE, FRAME_ARENA_AXI_SIZE };
+
+static uint32_t g_used[ARENA_REGION_COUNT];
+static uint32_t g_high_water[ARENA_REGION_COUNT];
+static uint32_t g_failed_allocs;
+
+/* ============================================================
+ * Public API
+ * ============================================================ */
+
+void Arena_Init(void)
+{
+    memset(g_used, 0, sizeof(g_used));
+    memset(g_high_water, 0, sizeof(g_high_water));
+    g_failed_allocs = 0;
+}
+
+void Arena_Reset(void)
+{
+    memset(g_used, 0, sizeof(g_used));
+}
+
+void* Arena_Alloc(uint32_t size, uint32_t align)
+{
+    if (align == 0) align = ARENA_DEFAULT_ALIGN;
+
+    for (int r = 0; r < ARENA_REGION_COUNT; r++) {
+        uintptr_t base = (uintptr_t)g_region_base[r];
+        uintptr_t p = (base + g_used[r] + (align - 1)) & ~(uintptr_t)(align - 1);
+        uint32_t end = (uint32_t)(p - base) + size;
+        if (end > g_region_size[r]) continue;
+
+        g_used[r] = end;
+        if (end > g_high_water[r]) g_high_water[r] = end;
+        return (void*)p;
+    }
+
+    g_failed_allocs++;
+    return NULL;
+}
+
+ArenaMark_t Arena_Mark(void)
+{
+    ArenaMark_t mark;
+    memcpy(mark.used, g_used, sizeof(g_used));
+    return mark;
+}
+
+void Arena_Release(ArenaMark_t mark)
+{
+    memcpy(g_used, mark.used, sizeof(g_used));
+}
+
+void Arena_GetStats(ArenaStats_t* stats)
+{
+    for (int r = 0; r < ARENA_REGION_COUNT; r++) {
+        stats->capacity[r] = g_region_size[r];
+        stats->used[r] = g_used[r];
+        stats->high_water[r] = g_high_water[r];
+    }
+    stats->failed_allocs = g_failed_allocs;
+}
+
+uint32_t Arena_GetMemPools(MemPool_t* out, uint32_t max)
+{
+    uint32_t n = 0;
+    n = MemMap_Add(out, n, max, "frame arena dtcm", g_arena_dtcm, sizeof(g_arena_dtcm), g_high_water[ARENA_DTCM]);
+    n = MemMap_Add(out, n, max, "frame arena axi", g_arena_axi, sizeof(g_arena_axi), g_high_water[ARENA_AXI]);
+    return n;
+}
@@ -0,0 +1,64 @@
+/**
+ * @file arena.h
+ * @brief Per-Frame Linear Scratch Arena - NO MALLOC
+ *
+ * Bump allocator for render data that only lives for one frame
+ * (post-transform vertices and the like). Memory comes from a small
+ * DTCM region first and falls back to AXI SRAM, so the hottest scratch
+ * stays in zero-wait-state memory. Rasterizer_Clear() resets both
+ * regions; Arena_Mark()/Arena_Release() give back scratch within a
+ * frame, e.g. at the end of a draw.
+ *
+ * Main thread only: worker jobs never allocate from the arena.
+ */
+
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stdint.h>
+#include "engine_config.h"
+#include "memmap.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Regions in allocation order */
+#define ARENA_DTCM              0
+#define ARENA_AXI               1
+#define ARENA_REGION_COUNT      2
+
+#define ARENA_DEFAULT_ALIGN     16
+
+typedef struct {
+    uint32_t used[ARENA_REGION_COUNT];
+} ArenaMark_t;
+
+typedef struct {
+    uint32_t capacity[ARENA_REGION_COUNT];
+    uint32_t used[ARENA_REGION_COUNT];
+    uint32_t high_water[ARENA_REGION_COUNT];    /* Peak use since Arena_Init */
+    uint32_t failed_allocs;                     /* Requests no region could hold */
+} ArenaStats_t;
+
+void Arena_Init(void);
+
+/* Rewinds every region; called from Rasterizer_Clear() */
+void Arena_Reset(void);
+
+/* size bytes aligned to align (power of two); NULL if no region fits */
+void* Arena_Alloc(uint32_t size, uint32_t align);
+
+ArenaMark_t Arena_Mark(void);
+void Arena_Release(ArenaMark_t mark);
+
+void Arena_GetStats(ArenaStats_t* stats);
+
+/* Both regions for MemMap_Print(); used is the high-water mark */
+uint32_t Arena_GetMemPools(MemPool_t* out, uint32_t max);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ARENA_H */
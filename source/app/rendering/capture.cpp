@@ -0,0 +1,393 @@
+/**
+ * @file capture.cpp
+ * @brief Frame Capture And Replay Implementation
+ */
+
+#include "capture.h"
+#include "meshdraw.h"
+#include "meshcluster.h"
+#include <string.h>
+
+#ifdef SDL_PC
+#include <stdio.h>
+#endif
+
+typedef struct {
+    const uint16_t* pixels;     /* Recorder side identity of the texture */
+    const uint16_t* palette;
+    uint16_t width;
+    uint16_t height;
+} CaptureSource_t;
+
+PLACE_CAPTURE_BUFFER CACHE_ALIGNED static uint8_t g_capture[CAPTURE_BUFFER_BYTES];
+static uint32_t g_capture_used;
+static CaptureSource_t g_sources[CAPTURE_MAX_TEXTURES];
+
+uint8_t g_capture_state = CAPTURE_IDLE;
+
+/* ============================================================
+ * Recording
+ * ============================================================ */
+
+static CaptureHeader_t* Header(void)
+{
+    return (CaptureHeader_t*)g_capture;
+}
+
+/* Room for a record of `bytes` (tag included); NULL once full, which
+ * ends the capture as truncated */
+static void* Append(uint32_t type, uint32_t bytes)
+{
+    if (g_capture_state != CAPTURE_RECORDING) return NULL;
+
+    /* The flush record always fits after the last one */
+    bytes = (bytes + 3) & ~3u;
+    if (g_capture_used + bytes + 4 > CAPTURE_BUFFER_BYTES) {
+        Header()->flags |= CAPTURE_FLAG_TRUNCATED;
+        Capture_OnFlush();
+        return NULL;
+    }
+    uint32_t* tag = (uint32_t*)&g_capture[g_capture_used];
+    *tag = CAPTURE_RECORD(type, bytes);
+    g_capture_used += bytes;
+    return tag + 1;
+}
+
+static void AppendWord(uint32_t type, uint32_t value)
+{
+    uint32_t* w = (uint32_t*)Append(type, 8);
+    if (w) *w = value;
+}
+
+void Capture_Begin(void)
+{
+    g_capture_used = 0;
+    memset(g_sources, 0, sizeof(g_sources));
+    g_capture_state = CAPTURE_ARMED;
+}
+
+uint32_t Capture_GetState(void)
+{
+    return g_capture_state;
+}
+
+void Capture_OnClear(uint16_t color)
+{
+    /* Immediate-mode callers need not flush: the next frame ends this one */
+    if (g_capture_state == CAPTURE_RECORDING) {
+        Capture_OnFlush();
+        return;
+    }
+    if (g_capture_state != CAPTURE_ARMED) return;
+
+    CaptureHeader_t* h = Header();
+    memset(h, 0, sizeof(*h));
+    h->magic = CAPTURE_MAGIC;
+    h->version = CAPTURE_VERSION;
+    h->vertex_bytes = (uint16_t)sizeof(ScreenVertex_t);
+    h->width = DISPLAY_WIDTH;
+    h->height = DISPLAY_HEIGHT;
+    h->flags = Rasterizer_IsBinning() ? CAPTURE_FLAG_BINNING : 0;
+    g_capture_used = sizeof(CaptureHeader_t);
+    g_capture_state = CAPTURE_RECORDING;
+
+    AppendWord(CAPTURE_REC_CLEAR, color);
+    AppendWord(CAPTURE_REC_STATE, Rasterizer_GetState());
+}
+
+void Capture_OnState(uint32_t state)
+{
+    AppendWord(CAPTURE_REC_STATE, state);
+}
+
+void Capture_OnView(const Mat4* view_proj, const SceneLight_t* lights, uint32_t light_count)
+{
+    Mat4* m = (Mat4*)Append(CAPTURE_REC_VIEW, 4 + sizeof(Mat4));
+    if (m) *m = *view_proj;
+    if (light_count == 0) return;
+
+    uint32_t* l = (uint32_t*)Append(CAPTURE_REC_LIGHTS, 8 + light_count * sizeof(SceneLight_t));
+    if (!l) return;
+    l[0] = light_count;
+    memcpy(l + 1, lights, light_count * sizeof(SceneLight_t));
+}
+
+void Capture_OnDraw(const DrawCmd_t* cmd, uint16_t color, uint32_t texture_id)
+{
+    CaptureDraw_t* d = (CaptureDraw_t*)Append(CAPTURE_REC_DRAW, 4 + sizeof(CaptureDraw_t));
+    if (!d) return;
+    d->world = cmd->world;
+    d->mesh_id = cmd->mesh_id;
+    d->material_id = cmd->material_id;
+    d->texture_id = texture_id;
+    d->color = color;
+    d->flags = (uint16_t)cmd->flags;
+    d->anim_frame_a = cmd->anim_frame_a;
+    d->anim_frame_b = cmd->anim_frame_b;
+    d->lod = cmd->lod;
+    d->anim_lerp = cmd->anim_lerp;
+    Header()->draws++;
+}
+
+/* Index of the texture in this capture, copying it in on first use;
+ * CAPTURE_NO_TEXTURE if the table or buffer is full */
+static uint16_t RecordTexture(const Texture_t* tex)
+{
+    uint32_t count = Header()->textures;
+    for (uint32_t i = 0; i < count; i++) {
+        const CaptureSource_t* s = &g_sources[i];
+        if (s->pixels == tex->pixels && s->palette == tex->palette &&
+            s->width == tex->width && s->height == tex->height) return (uint16_t)i;
+    }
+    if (count >= CAPTURE_MAX_TEXTURES) return CAPTURE_NO_TEXTURE;
+
+    uint32_t chain = 0;
+    for (uint32_t k = 0; k < tex->levels; k++) {
+        chain += Texture_LevelWords(tex->width >> k, tex->height >> k, tex->format);
+    }
+    uint32_t palette = tex->palette ? Texture_PaletteWords(tex->format) : 0;
+
+    CaptureTexture_t* t = (CaptureTexture_t*)Append(CAPTURE_REC_TEXTURE,
+        4 + sizeof(CaptureTexture_t) + (chain + palette) * sizeof(uint16_t));
+    if (!t) return CAPTURE_NO_TEXTURE;
+
+    memset(t, 0, sizeof(*t));
+    t->index = (uint16_t)count;
+    t->width = tex->width;
+    t->height = tex->height;
+    t->levels = tex->levels;
+    t->tiled = tex->tiled;
+    t->format = tex->format;
+    t->chain_words = chain;
+    t->palette_words = palette;
+    uint16_t* words = (uint16_t*)(t + 1);
+    memcpy(words, tex->pixels, chain * sizeof(uint16_t));
+    if (palette) memcpy(words + chain, tex->palette, palette * sizeof(uint16_t));
+
+    CaptureSource_t* s = &g_sources[count];
+    s->pixels = tex->pixels;
+    s->palette = tex->palette;
+    s->width = tex->width;
+    s->height = tex->height;
+    Header()->textures = count + 1;
+    return (uint16_t)count;
+}
+
+void Capture_OnTriangle(const ScreenVertex_t* v0, const ScreenVertex_t* v1,
+    const ScreenVertex_t* v2, const Texture_t* texture, uint16_t color)
+{
+    uint16_t index = texture ? RecordTexture(texture) : CAPTURE_NO_TEXTURE;
+    if (!Capture_IsRecording()) return;
+
+    CaptureTriangle_t* t = (CaptureTriangle_t*)Append(CAPTURE_REC_TRIANGLE, 4 + sizeof(CaptureTriangle_t));
+    if (!t) return;
+    t->texture = index;
+    t->color = color;
+    t->v[0] = *v0;
+    t->v[1] = *v1;
+    t->v[2] = *v2;
+    Header()->triangles++;
+}
+
+void Capture_OnFlush(void)
+{
+    if (g_capture_state != CAPTURE_RECORDING) return;
+
+    /* Always room: Append() keeps the buffer short of this record */
+    uint32_t* tag = (uint32_t*)&g_capture[g_capture_used];
+    *tag = CAPTURE_RECORD(CAPTURE_REC_FLUSH, 4);
+    g_capture_used += 4;
+    Header()->size = g_capture_used;
+    g_capture_state = CAPTURE_DONE;
+}
+
+const void* Capture_GetData(uint32_t* size)
+{
+    if (g_capture_state != CAPTURE_DONE) return NULL;
+    if (size) *size = g_capture_used;
+    return g_capture;
+}
+
+uint32_t Capture_Write(ProfileWrite_t write, void* user)
+{
+    uint32_t size;
+    const uint8_t* data = (const uint8_t*)Capture_GetData(&size);
+    if (!data) return 0;
+
+    /* Bounded pieces keep writers with small buffers happy */
+    for (uint32_t at = 0; at < size; at += 4096) {
+        uint32_t n = (size - at < 4096) ? size - at : 4096;
+        write((const char*)data + at, n, user);
+    }
+    return size;
+}
+
+#ifdef SDL_PC
+
+static void WriteFile(const char* text, uint32_t length, void* user)
+{
+    fwrite(text, 1, length, (FILE*)user);
+}
+
+uint32_t Capture_Save(const char* path)
+{
+    if (g_capture_state != CAPTURE_DONE) return 0;
+    FILE* f = fopen(path, "wb");
+    if (!f) return 0;
+    uint32_t written = Capture_Write(WriteFile, f);
+    if (fclose(f) != 0) return 0;
+    return written;
+}
+
+#endif
+
+uint32_t Capture_GetMemPools(MemPool_t* out, uint32_t max)
+{
+    return MemMap_Add(out, 0, max, "capture buffer", g_capture, sizeof(g_capture), g_capture_used);
+}
+
+/* ============================================================
+ * Replay
+ * ============================================================ */
+
+PLACE_CAPTURE_BUFFER static DrawList_t g_replay_list;
+static const CaptureDraw_t* g_replay_draws[SCENE_MAX_DRAWS];  /* Record of each cmd */
+
+const CaptureHeader_t* Capture_Validate(const void* data, uint32_t size)
+{
+    const CaptureHeader_t* h = (const CaptureHeader_t*)data;
+    if (!data || ((uintptr_t)data & 3) || size < sizeof(CaptureHeader_t)) return NULL;
+    if (h->magic != CAPTURE_MAGIC || h->version != CAPTURE_VERSION) return NULL;
+    if (h->vertex_bytes != sizeof(ScreenVertex_t) || h->size > size) return NULL;
+    return h;
+}
+
+static uint32_t Word(const uint8_t* p, uint32_t i)
+{
+    return ((const uint32_t*)p)[i];
+}
+
+/* Replayed draws take their look from the record */
+static void ReplayLook(const DrawCmd_t* cmd, uint16_t* color, uint32_t* texture, void* user)
+{
+    (void)user;
+    const CaptureDraw_t* d = g_replay_draws[cmd - g_replay_list.cmds];
+    *color = d->color;
+    *texture = d->texture_id;
+}
+
+static void SubmitDraws(void)
+{
+    if (g_replay_list.count == 0) return;
+    MeshDraw_List(&g_replay_list, ReplayLook, NULL);
+    g_replay_list.count = 0;
+}
+
+uint32_t Capture_Replay(const void* data, uint32_t size, uint32_t mode)
+{
+    const CaptureHeader_t* h = Capture_Validate(data, size);
+    if (!h) return 0xFFFFFFFF;
+
+    Texture_t textures[CAPTURE_MAX_TEXTURES];
+    uint32_t texture_count = 0;
+    uint32_t submitted = 0;
+    g_replay_list.count = 0;
+    g_replay_list.culled = 0;
+
+    const uint8_t* p = (const uint8_t*)data + sizeof(CaptureHeader_t);
+    const uint8_t* end = (const uint8_t*)data + h->size;
+    while (p + 4 <= end) {
+        uint32_t tag = Word(p, 0);
+        uint32_t bytes = CAPTURE_RECORD_BYTES(tag);
+        if (bytes < 4 || (bytes & 3) || p + bytes > end) break;
+        const uint8_t* body = p + 4;
+        p += bytes;
+
+        uint32_t type = CAPTURE_RECORD_TYPE(tag);
+        if (mode == CAPTURE_REPLAY_DRAWS && type != CAPTURE_REC_DRAW) SubmitDraws();
+
+        switch (type) {
+        case CAPTURE_REC_CLEAR:
+            Rasterizer_Clear((uint16_t)Word(body, 0));
+            break;
+
+        case CAPTURE_REC_STATE:
+            Rasterizer_SetState(Word(body, 0));
+            break;
+
+        case CAPTURE_REC_VIEW:
+            memcpy(&g_replay_list.view_proj, body, sizeof(Mat4));
+            g_replay_list.light_count = 0;
+            break;
+
+        case CAPTURE_REC_LIGHTS:
+            g_replay_list.light_count = MIN(Word(body, 0), (uint32_t)MAX_LIGHTS);
+            if (bytes < 8 + g_replay_list.light_count * sizeof(SceneLight_t)) g_replay_list.light_count = 0;
+            memcpy(g_replay_list.lights, body + 4, g_replay_list.light_count * sizeof(SceneLight_t));
+            break;
+
+        case CAPTURE_REC_DRAW:
+            if (mode == CAPTURE_REPLAY_DRAWS && g_replay_list.count < SCENE_MAX_DRAWS) {
+                const CaptureDraw_t* d = (const CaptureDraw_t*)body;
+                DrawCmd_t* cmd = &g_replay_list.cmds[g_replay_list.count];
+                cmd->world = d->world;
+                cmd->entity = INVALID_ENTITY;
+                cmd->mesh_id = d->mesh_id;
+                cmd->material_id = d->material_id;
+                cmd->anim_frame_a = d->anim_frame_a;
+                cmd->anim_frame_b = d->anim_frame_b;
+                cmd->anim_lerp = d->anim_lerp;
+                cmd->flags = d->flags;
+                cmd->lod = d->lod;
+                cmd->cluster_mask = MESH_CLUSTERS_ALL;
+                g_replay_draws[g_replay_list.count++] = d;
+                submitted++;
+            }
+            break;
+
+        case CAPTURE_REC_TEXTURE: {
+            const CaptureTexture_t* t = (const CaptureTexture_t*)body;
+            if (t->index >= CAPTURE_MAX_TEXTURES) break;
+            Texture_t* tex = &textures[t->index];
+            const uint16_t* words = (const uint16_t*)(t + 1);
+            tex->pixels = (uint16_t*)words;
+            tex->palette = t->palette_words ? words + t->chain_words : NULL;
+            tex->width = t->width;
+            tex->height = t->height;
+            tex->width_mask = (uint16_t)(t->width - 1);
+            tex->height_mask = (uint16_t)(t->height - 1);
+            tex->levels = t->levels;
+            tex->tiled = t->tiled;
+            tex->format = t->format;
+            tex->width_shift = 0;
+            while ((2u << tex->width_shift) <= t->width) tex->width_shift++;
+            tex->height_shift = 0;
+            while ((2u << tex->height_shift) <= t->height) tex->height_shift++;
+            if (t->index >= texture_count) texture_count = t->index + 1u;
+            break;
+        }
+
+        case CAPTURE_REC_TRIANGLE:
+            if (mode == CAPTURE_REPLAY_TRIANGLES) {
+                const CaptureTriangle_t* t = (const CaptureTriangle_t*)body;
+                if (t->texture != CAPTURE_NO_TEXTURE && t->texture < texture_count) {
+                    Rasterizer_DrawTriangle(&t->v[0], &t->v[1], &t->v[2], &textures[t->texture]);
+                }
+                else {
+                    Rasterizer_DrawTriangleSolid(&t->v[0], &t->v[1], &t->v[2], t->color);
+                }
+                submitted++;
+            }
+            break;
+
+        case CAPTURE_REC_FLUSH:
+            Rasterizer_Flush();
+            return submitted;
+        }
+    }
+
+    /* Truncated: show what was recorded */
+    SubmitDraws();
+    Rasterizer_Flush();
+    return submitted;
+}
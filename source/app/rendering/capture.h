@@ -0,0 +1,178 @@
+/**
+ * @file capture.h
+ * @brief Frame Capture And Replay Of Draw Streams - NO MALLOC
+ *
+ * Capture_Begin() arms a recording of one frame from the next
+ * Rasterizer_Clear() through the next Rasterizer_Flush(). The capture
+ * holds two views of the frame:
+ *
+ *   draws      view-projection and lights, then per draw the world
+ *              matrix, mesh, material and texture ids, color and
+ *              animation state, as MeshDraw_List() executed them
+ *   triangles  every ScreenVertex_t triangle handed to the rasterizer,
+ *              with the raster state and a copy of each texture it
+ *              sampled (mip chain and palette)
+ *
+ * The triangle view is self-contained: a capture taken on the board
+ * replays on PC without its assets, so rasterizer builds can be compared
+ * on real scenes. Replaying the draw view also runs transform and clip,
+ * but needs the same meshes and textures loaded under the same ids.
+ *
+ * The file is the capture buffer as recorded: a CaptureHeader_t and
+ * 4-byte aligned records, native little-endian. Textures replay in
+ * place from the file, so a loaded capture must stay 4-byte aligned and
+ * mapped while it is replayed. A capture that outgrew the buffer is
+ * flagged CAPTURE_FLAG_TRUNCATED and replays the part that fit.
+ */
+
+#ifndef CAPTURE_H
+#define CAPTURE_H
+
+#include <stdint.h>
+#include "engine_config.h"
+#include "math3d.h"
+#include "rasterizer.h"
+#include "scenebuffer.h"
+#include "profile.h"
+#include "memmap.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define CAPTURE_MAGIC           0x50414353u     /* "SCAP" */
+#define CAPTURE_VERSION         2
+#ifndef CAPTURE_BUFFER_BYTES
+#define CAPTURE_BUFFER_BYTES    (4 * 1024 * 1024)
+#endif
+#define CAPTURE_MAX_TEXTURES    16
+#define CAPTURE_NO_TEXTURE      0xFFFF
+
+/* Recorder states */
+#define CAPTURE_IDLE            0
+#define CAPTURE_ARMED           1   /* Waiting for Rasterizer_Clear() */
+#define CAPTURE_RECORDING       2
+#define CAPTURE_DONE            3   /* Frame complete, Capture_GetData() valid */
+
+#define CAPTURE_FLAG_TRUNCATED  0x01
+#define CAPTURE_FLAG_BINNING    0x02    /* Recorded with tile binning on */
+
+/* Record types; each record starts with CAPTURE_RECORD(type, bytes) */
+#define CAPTURE_REC_CLEAR       1   /* uint32 color */
+#define CAPTURE_REC_STATE       2   /* uint32 Rasterizer_SetState() value */
+#define CAPTURE_REC_VIEW        3   /* Mat4 view_proj, starts a draw list */
+#define CAPTURE_REC_DRAW        4   /* CaptureDraw_t */
+#define CAPTURE_REC_TEXTURE     5   /* CaptureTexture_t, chain words, palette words */
+#define CAPTURE_REC_TRIANGLE    6   /* CaptureTriangle_t */
+#define CAPTURE_REC_FLUSH       7   /* Last record of a complete frame */
+#define CAPTURE_REC_LIGHTS      8   /* uint32 count, SceneLight_t[count]; follows a view */
+
+#define CAPTURE_RECORD(type, bytes)     (((uint32_t)(bytes) << 8) | (type))
+#define CAPTURE_RECORD_TYPE(tag)        ((tag) & 0xFF)
+#define CAPTURE_RECORD_BYTES(tag)       ((tag) >> 8)    /* Tag included, multiple of 4 */
+
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t vertex_bytes;      /* sizeof(ScreenVertex_t) of the recorder */
+    uint16_t width;
+    uint16_t height;
+    uint32_t flags;             /* CAPTURE_FLAG_* */
+    uint32_t size;              /* Header and records */
+    uint32_t triangles;
+    uint32_t draws;
+    uint32_t textures;
+} CaptureHeader_t;
+
+typedef struct {
+    Mat4 world;
+    uint32_t mesh_id;
+    uint32_t material_id;
+    uint32_t texture_id;        /* 0xFFFFFFFF = untextured */
+    uint16_t color;
+    uint16_t flags;             /* DRAW_FLAG_* */
+    uint16_t anim_frame_a;
+    uint16_t anim_frame_b;
+    float anim_lerp;
+    uint32_t lod;
+} CaptureDraw_t;
+
+typedef struct {
+    uint16_t index;             /* Referenced by CaptureTriangle_t */
+    uint16_t width;
+    uint16_t height;
+    uint8_t levels;
+    uint8_t tiled;
+    uint8_t format;
+    uint8_t reserved[3];
+    uint32_t chain_words;       /* Followed by the chain, then the palette */
+    uint32_t palette_words;
+} CaptureTexture_t;
+
+typedef struct {
+    uint16_t texture;           /* CaptureTexture_t index, CAPTURE_NO_TEXTURE = solid */
+    uint16_t color;             /* Solid triangles */
+    ScreenVertex_t v[3];
+} CaptureTriangle_t;
+
+/* Record the next frame; restarts a capture in progress */
+void Capture_Begin(void);
+
+uint32_t Capture_GetState(void);
+
+/* The finished file image, NULL until CAPTURE_DONE */
+const void* Capture_GetData(uint32_t* size);
+
+/* Capture_GetData() in pieces, e.g. to SD card or semihosting; returns
+ * the bytes written */
+uint32_t Capture_Write(ProfileWrite_t write, void* user);
+
+#ifdef SDL_PC
+/* Returns the bytes written, 0 if no capture is done or on error */
+uint32_t Capture_Save(const char* path);
+#endif
+
+uint32_t Capture_GetMemPools(MemPool_t* out, uint32_t max);
+
+/* ============================================================
+ * Recording Hooks
+ * Called by the rasterizer and MeshDraw_List(); cheap while idle.
+ * ============================================================ */
+
+extern uint8_t g_capture_state;
+
+static inline int Capture_IsRecording(void)
+{
+    return g_capture_state == CAPTURE_RECORDING;
+}
+
+/* Starts an armed capture */
+void Capture_OnClear(uint16_t color);
+void Capture_OnState(uint32_t state);
+void Capture_OnView(const Mat4* view_proj, const SceneLight_t* lights, uint32_t light_count);
+void Capture_OnDraw(const DrawCmd_t* cmd, uint16_t color, uint32_t texture_id);
+void Capture_OnTriangle(const ScreenVertex_t* v0, const ScreenVertex_t* v1,
+    const ScreenVertex_t* v2, const Texture_t* texture, uint16_t color);
+/* Completes the capture */
+void Capture_OnFlush(void);
+
+/* ============================================================
+ * Replay
+ * ============================================================ */
+
+#define CAPTURE_REPLAY_TRIANGLES    0   /* Recorded triangles, no assets needed */
+#define CAPTURE_REPLAY_DRAWS        1   /* Draw list through MeshDraw_List() */
+
+/* Header of a valid capture from a compatible build, NULL otherwise */
+const CaptureHeader_t* Capture_Validate(const void* data, uint32_t size);
+
+/* Clear, state changes, draws and flush of the frame; the caller locks
+ * the device around it. Returns triangles (or draws) submitted,
+ * 0xFFFFFFFF if the capture is not valid. */
+uint32_t Capture_Replay(const void* data, uint32_t size, uint32_t mode);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CAPTURE_H */
@@ -0,0 +1,277 @@
+/**
+ * @file clear.cpp
+ * @brief Color And Depth Buffer Fills Implementation
+ */
+
+#include "clear.h"
+#include "dcache.h"
+#include <string.h>
+
+#if defined(SDL_PC) && (defined(__SSE2__) || defined(_M_X64) || defined(_M_IX86_FP))
+#define CLEAR_SSE 1
+#include <immintrin.h>
+#endif
+
+#ifndef SDL_PC
+#include "stm32h7xx.h"
+#endif
+
+/* ============================================================
+ * CPU Fills
+ * ============================================================ */
+
+void Clear_Fill32(uint32_t* dst, uint32_t value, uint32_t count)
+{
+    /* Also covers 0 and all ones, i.e. black and the depth far plane */
+    if ((value & 0xFF) * 0x01010101u == value) {
+        memset(dst, (int)(value & 0xFF), count * sizeof(uint32_t));
+        return;
+    }
+
+    uint32_t i = 0;
+#ifdef CLEAR_SSE
+    __m128i v = _mm_set1_epi32((int)value);
+    for (; i + 16 <= count; i += 16) {
+        _mm_storeu_si128((__m128i*)(dst + i), v);
+        _mm_storeu_si128((__m128i*)(dst + i + 4), v);
+        _mm_storeu_si128((__m128i*)(dst + i + 8), v);
+        _mm_storeu_si128((__m128i*)(dst + i + 12), v);
+    }
+    for (; i + 4 <= count; i += 4) {
+        _mm_storeu_si128((__m128i*)(dst + i), v);
+    }
+#else
+    /* 64-bit stores (STRD on Cortex-M7) once dst is 8-byte aligned */
+    if (((uintptr_t)dst & 4) && count) dst[i++] = value;
+    uint64_t v = ((uint64_t)value << 32) | value;
+    uint64_t* d64 = (uint64_t*)(dst + i);
+    uint32_t pairs = (count - i) >> 1;
+    for (uint32_t p = 0; p + 4 <= pairs; p += 4) {
+        d64[p] = v; d64[p + 1] = v; d64[p + 2] = v; d64[p + 3] = v;
+    }
+    for (uint32_t p = pairs & ~3u; p < pairs; p++) d64[p] = v;
+    i += pairs << 1;
+#endif
+    for (; i < count; i++) dst[i] = value;
+}
+
+void Clear_Fill16(uint16_t* dst, uint16_t value, uint32_t count)
+{
+    if (count == 0) return;
+    if (((uintptr_t)dst & 2)) {
+        *dst++ = value;
+        count--;
+    }
+    Clear_Fill32((uint32_t*)dst, ((uint32_t)value << 16) | value, count >> 1);
+    if (count & 1) dst[count - 1] = value;
+}
+
+/* ============================================================
+ * Asynchronous Surface Fill
+ * ============================================================ */
+
+#ifdef SDL_PC
+
+void Clear_Start16(uint16_t* dst, uint16_t value, uint32_t width, uint32_t height, uint32_t pitch)
+{
+    if (width == pitch) {
+        Clear_Fill16(dst, value, width * height);
+        return;
+    }
+    for (uint32_t y = 0; y < height; y++) Clear_Fill16(dst + y * pitch, value, width);
+}
+
+void Clear_StartCopy16(uint16_t* dst, const uint16_t* src, uint32_t width, uint32_t height,
+    uint32_t dst_pitch, uint32_t src_pitch)
+{
+    for (uint32_t y = 0; y < height; y++) memcpy(dst + y * dst_pitch, src + y * src_pitch, width * sizeof(uint16_t));
+}
+
+void Clear_StartBlend16(uint16_t* dst, const uint16_t* a, const uint16_t* b, uint32_t width, uint32_t height,
+    uint32_t dst_pitch, uint32_t src_pitch)
+{
+    /* Per channel (a + b) / 2: the common bits plus half the differing
+     * ones, with each channel's low bit masked off before the shift */
+    for (uint32_t y = 0; y < height; y++) {
+        uint16_t* d = dst + y * dst_pitch;
+        const uint16_t* pa = a + y * src_pitch;
+        const uint16_t* pb = b + y * src_pitch;
+        for (uint32_t x = 0; x < width; x++) {
+            d[x] = (uint16_t)((pa[x] & pb[x]) + (((pa[x] ^ pb[x]) & 0xF7DEu) >> 1));
+        }
+    }
+}
+
+void Clear_StartAlpha16(uint16_t* dst, const uint16_t* src, uint32_t width, uint32_t height,
+    uint32_t dst_pitch, uint32_t src_pitch, uint8_t alpha)
+{
+    /* Rounded to a weight of 0..32; each channel c = (s * w + d * (32 - w)) >> 5 */
+    uint32_t w = ((uint32_t)alpha * 32 + 127) / 255;
+    if (w == 0) return;
+    if (w == 32) {
+        Clear_StartCopy16(dst, src, width, height, dst_pitch, src_pitch);
+        return;
+    }
+    for (uint32_t y = 0; y < height; y++) {
+        uint16_t* d = dst + y * dst_pitch;
+        const uint16_t* s = src + y * src_pitch;
+        uint32_t x = 0;
+#ifdef CLEAR_SSE
+        /* Eight pixels a step, channels split into 16-bit lanes; 63 * 32
+         * still fits, so the products need no widening */
+        const __m128i ws = _mm_set1_epi16((short)w), wd = _mm_set1_epi16((short)(32 - w));
+        const __m128i m5 = _mm_set1_epi16(0x1F), m6 = _mm_set1_epi16(0x3F);
+        for (; x + 8 <= width; x += 8) {
+            __m128i a = _mm_loadu_si128((const __m128i*)(s + x));
+            __m128i b = _mm_loadu_si128((const __m128i*)(d + x));
+            __m128i r = _mm_add_epi16(_mm_mullo_epi16(_mm_srli_epi16(a, 11), ws),
+                _mm_mullo_epi16(_mm_srli_epi16(b, 11), wd));
+            __m128i g = _mm_add_epi16(_mm_mullo_epi16(_mm_and_si128(_mm_srli_epi16(a, 5), m6), ws),
+                _mm_mullo_epi16(_mm_and_si128(_mm_srli_epi16(b, 5), m6), wd));
+            __m128i bl = _mm_add_epi16(_mm_mullo_epi16(_mm_and_si128(a, m5), ws),
+                _mm_mullo_epi16(_mm_and_si128(b, m5), wd));
+            r = _mm_slli_epi16(_mm_srli_epi16(r, 5), 11);
+            g = _mm_slli_epi16(_mm_srli_epi16(g, 5), 5);
+            bl = _mm_srli_epi16(bl, 5);
+            _mm_storeu_si128((__m128i*)(d + x), _mm_or_si128(_mm_or_si128(r, g), bl));
+        }
+#endif
+        /* Channels spread over a word (0x07E0F81F) so one multiply covers all three */
+        for (; x < width; x++) {
+            uint32_t es = ((uint32_t)s[x] | ((uint32_t)s[x] << 16)) & 0x07E0F81Fu;
+            uint32_t ed = ((uint32_t)d[x] | ((uint32_t)d[x] << 16)) & 0x07E0F81Fu;
+            uint32_t e = ((es * w + ed * (32 - w)) >> 5) & 0x07E0F81Fu;
+            d[x] = (uint16_t)(e | (e >> 16));
+        }
+    }
+}
+
+void Clear_Wait(void)
+{
+}
+
+int Clear_Busy(void)
+{
+    return 0;
+}
+
+#else
+
+static volatile int g_fill_pending = 0;
+
+void Clear_Start16(uint16_t* dst, uint16_t value, uint32_t width, uint32_t height, uint32_t pitch)
+{
+    Clear_Wait();
+    RCC->AHB3ENR |= RCC_AHB3ENR_DMA2DEN;
+
+    /* DMA2D writes behind the D-cache: dirty lines would land on top of the fill */
+    DCache_CleanInvalidate(dst, DCache_RectBytes(width, height, pitch, sizeof(uint16_t)));
+
+    DMA2D->CR = DMA2D_CR_MODE_0 | DMA2D_CR_MODE_1;     /* Register to memory */
+    DMA2D->OPFCCR = 2;                                  /* RGB565 */
+    DMA2D->OCOLR = value;
+    DMA2D->OMAR = (uint32_t)dst;
+    DMA2D->OOR = pitch - width;
+    DMA2D->NLR = (width << DMA2D_NLR_PL_Pos) | height;
+    DMA2D->IFCR = DMA2D_IFCR_CTCIF;
+    DMA2D->CR |= DMA2D_CR_START;
+    g_fill_pending = 1;
+}
+
+void Clear_StartCopy16(uint16_t* dst, const uint16_t* src, uint32_t width, uint32_t height,
+    uint32_t dst_pitch, uint32_t src_pitch)
+{
+    Clear_Wait();
+    RCC->AHB3ENR |= RCC_AHB3ENR_DMA2DEN;
+
+    /* The source may still sit in the D-cache; the destination as for a fill */
+    DCache_Clean(src, DCache_RectBytes(width, height, src_pitch, sizeof(uint16_t)));
+    DCache_CleanInvalidate(dst, DCache_RectBytes(width, height, dst_pitch, sizeof(uint16_t)));
+
+    DMA2D->CR = 0;                                      /* Memory to memory */
+    DMA2D->FGPFCCR = 2;                                 /* RGB565 */
+    DMA2D->FGMAR = (uint32_t)src;
+    DMA2D->FGOR = src_pitch - width;
+    DMA2D->OPFCCR = 2;
+    DMA2D->OMAR = (uint32_t)dst;
+    DMA2D->OOR = dst_pitch - width;
+    DMA2D->NLR = (width << DMA2D_NLR_PL_Pos) | height;
+    DMA2D->IFCR = DMA2D_IFCR_CTCIF;
+    DMA2D->CR |= DMA2D_CR_START;
+    g_fill_pending = 1;
+}
+
+void Clear_StartBlend16(uint16_t* dst, const uint16_t* a, const uint16_t* b, uint32_t width, uint32_t height,
+    uint32_t dst_pitch, uint32_t src_pitch)
+{
+    Clear_Wait();
+    RCC->AHB3ENR |= RCC_AHB3ENR_DMA2DEN;
+
+    DCache_Clean(a, DCache_RectBytes(width, height, src_pitch, sizeof(uint16_t)));
+    DCache_Clean(b, DCache_RectBytes(width, height, src_pitch, sizeof(uint16_t)));
+    DCache_CleanInvalidate(dst, DCache_RectBytes(width, height, dst_pitch, sizeof(uint16_t)));
+
+    /* Memory to memory with blending; the foreground alpha is replaced by
+     * 0x80, so out = (a * 128 + b * 127) / 255 */
+    DMA2D->CR = DMA2D_CR_MODE_1;
+    DMA2D->FGPFCCR = 2 | DMA2D_FGPFCCR_AM_0 | (0x80u << DMA2D_FGPFCCR_ALPHA_Pos);
+    DMA2D->FGMAR = (uint32_t)a;
+    DMA2D->FGOR = src_pitch - width;
+    DMA2D->BGPFCCR = 2;
+    DMA2D->BGMAR = (uint32_t)b;
+    DMA2D->BGOR = src_pitch - width;
+    DMA2D->OPFCCR = 2;
+    DMA2D->OMAR = (uint32_t)dst;
+    DMA2D->OOR = dst_pitch - width;
+    DMA2D->NLR = (width << DMA2D_NLR_PL_Pos) | height;
+    DMA2D->IFCR = DMA2D_IFCR_CTCIF;
+    DMA2D->CR |= DMA2D_CR_START;
+    g_fill_pending = 1;
+}
+
+void Clear_StartAlpha16(uint16_t* dst, const uint16_t* src, uint32_t width, uint32_t height,
+    uint32_t dst_pitch, uint32_t src_pitch, uint8_t alpha)
+{
+    if (alpha == 0) return;
+    if (alpha == 255) {
+        Clear_StartCopy16(dst, src, width, height, dst_pitch, src_pitch);
+        return;
+    }
+    Clear_Wait();
+    RCC->AHB3ENR |= RCC_AHB3ENR_DMA2DEN;
+
+    DCache_Clean(src, DCache_RectBytes(width, height, src_pitch, sizeof(uint16_t)));
+    DCache_CleanInvalidate(dst, DCache_RectBytes(width, height, dst_pitch, sizeof(uint16_t)));
+
+    /* Memory to memory with blending, dst both background and output */
+    DMA2D->CR = DMA2D_CR_MODE_1;
+    DMA2D->FGPFCCR = 2 | DMA2D_FGPFCCR_AM_0 | ((uint32_t)alpha << DMA2D_FGPFCCR_ALPHA_Pos);
+    DMA2D->FGMAR = (uint32_t)src;
+    DMA2D->FGOR = src_pitch - width;
+    DMA2D->BGPFCCR = 2;
+    DMA2D->BGMAR = (uint32_t)dst;
+    DMA2D->BGOR = dst_pitch - width;
+    DMA2D->OPFCCR = 2;
+    DMA2D->OMAR = (uint32_t)dst;
+    DMA2D->OOR = dst_pitch - width;
+    DMA2D->NLR = (width << DMA2D_NLR_PL_Pos) | height;
+    DMA2D->IFCR = DMA2D_IFCR_CTCIF;
+    DMA2D->CR |= DMA2D_CR_START;
+    g_fill_pending = 1;
+}
+
+void Clear_Wait(void)
+{
+    if (!g_fill_pending) return;
+    while (DMA2D->CR & DMA2D_CR_START) {
+    }
+    DMA2D->IFCR = DMA2D_IFCR_CTCIF;
+    g_fill_pending = 0;
+}
+
+int Clear_Busy(void)
+{
+    return g_fill_pending && (DMA2D->CR & DMA2D_CR_START);
+}
+
+#endif
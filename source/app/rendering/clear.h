@@ -0,0 +1,53 @@
+/**
+ * @file clear.h
+ * @brief Color And Depth Buffer Fills
+ *
+ * CPU fills use memset when every byte of the value is equal and wide
+ * (SSE2 on PC, 64-bit) stores otherwise. Clear_Start16() fills a
+ * rectangle of an RGB565 surface; on STM32 it programs a DMA2D
+ * register-to-memory transfer and returns at once, so the clear runs
+ * while the CPU transforms vertices. Anything that touches the surface
+ * must call Clear_Wait() first; it returns immediately when idle.
+ * Clear_StartCopy16() is the same for a memory-to-memory copy, and
+ * Clear_StartBlend16() for the average of two sources (a DMA2D blend at
+ * half alpha, so within one step of the exact mean on the board).
+ * Clear_StartAlpha16() lays a source over dst at a constant alpha, the
+ * DMA2D blend with the foreground alpha replaced.
+ */
+
+#ifndef CLEAR_H
+#define CLEAR_H
+
+#include <stdint.h>
+#include "engine_config.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void Clear_Fill16(uint16_t* dst, uint16_t value, uint32_t count);
+void Clear_Fill32(uint32_t* dst, uint32_t value, uint32_t count);
+
+/* width x height pixels, rows `pitch` pixels apart */
+void Clear_Start16(uint16_t* dst, uint16_t value, uint32_t width, uint32_t height, uint32_t pitch);
+/* width x height pixels from src to dst, rows at their own pitches */
+void Clear_StartCopy16(uint16_t* dst, const uint16_t* src, uint32_t width, uint32_t height,
+    uint32_t dst_pitch, uint32_t src_pitch);
+/* width x height averages of a and b into dst; a and b share src_pitch */
+void Clear_StartBlend16(uint16_t* dst, const uint16_t* a, const uint16_t* b, uint32_t width, uint32_t height,
+    uint32_t dst_pitch, uint32_t src_pitch);
+/* dst = (src * alpha + dst * (255 - alpha)) / 255 per channel over
+ * width x height pixels; 5-bit weights on PC */
+void Clear_StartAlpha16(uint16_t* dst, const uint16_t* src, uint32_t width, uint32_t height,
+    uint32_t dst_pitch, uint32_t src_pitch, uint8_t alpha);
+
+void Clear_Wait(void);
+
+/* Nonzero while an asynchronous fill is in flight */
+int Clear_Busy(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CLEAR_H */
@@ -0,0 +1,492 @@
+/**
+ * @file clip.cpp
+ * @brief Homogeneous Clip-Space Triangle Clipping Implementation
+ */
+
+#include "clip.h"
+#include "profile.h"
+#include "arena.h"
+#include <string.h>
+#include <math.h>
+
+#if defined(SDL_PC) && (defined(__SSE2__) || defined(_M_X64) || defined(_M_IX86_FP))
+#define CLIP_SSE 1
+#include <immintrin.h>
+#endif
+
+/* ============================================================
+ * Plane Tests
+ * ============================================================ */
+
+/* Signed distance to a clip plane in homogeneous space (>= 0 is inside) */
+static inline float PlaneDistance(const Vec4* p, uint32_t plane)
+{
+    switch (plane) {
+    case CLIP_NEAR:   return p->z;
+    case CLIP_FAR:    return p->w - p->z;
+    case CLIP_LEFT:   return p->x + CLIP_GUARD_BAND * p->w;
+    case CLIP_RIGHT:  return CLIP_GUARD_BAND * p->w - p->x;
+    case CLIP_BOTTOM: return p->y + CLIP_GUARD_BAND * p->w;
+    default:          return CLIP_GUARD_BAND * p->w - p->y;   /* CLIP_TOP */
+    }
+}
+
+uint32_t Clip_Outcode(const Vec4* p)
+{
+    uint32_t code = 0;
+    float g = CLIP_GUARD_BAND * p->w;
+    if (p->z < 0.0f)  code |= CLIP_NEAR;
+    if (p->z > p->w)  code |= CLIP_FAR;
+    if (p->x < -g)    code |= CLIP_LEFT;
+    if (p->x > g)     code |= CLIP_RIGHT;
+    if (p->y < -g)    code |= CLIP_BOTTOM;
+    if (p->y > g)     code |= CLIP_TOP;
+    return code;
+}
+
+/* ============================================================
+ * Frustum
+ * ============================================================ */
+
+void Clip_ExtractFrustum(const Mat4* view_proj, ClipFrustum_t* f)
+{
+    const float* m = view_proj->m;
+    /* Rows of the column-major matrix */
+    Vec4 r0 = Vec4_Create(m[0], m[4], m[8], m[12]);
+    Vec4 r1 = Vec4_Create(m[1], m[5], m[9], m[13]);
+    Vec4 r2 = Vec4_Create(m[2], m[6], m[10], m[14]);
+    Vec4 r3 = Vec4_Create(m[3], m[7], m[11], m[15]);
+
+    f->planes[0] = r2;                                  /* Near: z >= 0 */
+    f->planes[1] = Vec4_Add(r3, Vec4_Scale(r2, -1.0f)); /* Far: z <= w */
+    f->planes[2] = Vec4_Add(r3, r0);                    /* Left */
+    f->planes[3] = Vec4_Add(r3, Vec4_Scale(r0, -1.0f)); /* Right */
+    f->planes[4] = Vec4_Add(r3, r1);                    /* Bottom */
+    f->planes[5] = Vec4_Add(r3, Vec4_Scale(r1, -1.0f)); /* Top */
+
+    for (int i = 0; i < 6; i++) {
+        Vec4* p = &f->planes[i];
+        float len = sqrtf(p->x * p->x + p->y * p->y + p->z * p->z);
+        if (len > EPSILON) *p = Vec4_Scale(*p, 1.0f / len);
+    }
+}
+
+int Clip_SphereInFrustum(const ClipFrustum_t* f, Vec3 center, float radius)
+{
+    for (int i = 0; i < 6; i++) {
+        const Vec4* p = &f->planes[i];
+        if (p->x * center.x + p->y * center.y + p->z * center.z + p->w < -radius) return 0;
+    }
+    return 1;
+}
+
+/* ============================================================
+ * Batch Transform
+ * ============================================================ */
+
+#ifdef CLIP_SSE
+/* Transposes four lane registers into four clip-space Vec4s */
+static inline void StoreClip4(__m128 cx, __m128 cy, __m128 cz, __m128 cw, ClipVertex_t* out)
+{
+    _MM_TRANSPOSE4_PS(cx, cy, cz, cw);
+    _mm_storeu_ps(&out[0].pos.x, cx);
+    _mm_storeu_ps(&out[1].pos.x, cy);
+    _mm_storeu_ps(&out[2].pos.x, cz);
+    _mm_storeu_ps(&out[3].pos.x, cw);
+}
+#endif
+
+void Clip_TransformPositions(const Mat4* mvp, const float* x, const float* y,
+    const float* z, uint32_t count, ClipVertex_t* out)
+{
+    const float* m = mvp->m;
+    uint32_t i = 0;
+
+#if defined(CLIP_SSE) && defined(__AVX__)
+    {
+        __m256 m0 = _mm256_set1_ps(m[0]), m1 = _mm256_set1_ps(m[1]), m2 = _mm256_set1_ps(m[2]), m3 = _mm256_set1_ps(m[3]);
+        __m256 m4 = _mm256_set1_ps(m[4]), m5 = _mm256_set1_ps(m[5]), m6 = _mm256_set1_ps(m[6]), m7 = _mm256_set1_ps(m[7]);
+        __m256 m8 = _mm256_set1_ps(m[8]), m9 = _mm256_set1_ps(m[9]), m10 = _mm256_set1_ps(m[10]), m11 = _mm256_set1_ps(m[11]);
+        __m256 m12 = _mm256_set1_ps(m[12]), m13 = _mm256_set1_ps(m[13]), m14 = _mm256_set1_ps(m[14]), m15 = _mm256_set1_ps(m[15]);
+
+        for (; i + 8 <= count; i += 8) {
+            __m256 px = _mm256_loadu_ps(x + i);
+            __m256 py = _mm256_loadu_ps(y + i);
+            __m256 pz = _mm256_loadu_ps(z + i);
+
+            __m256 cx = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(m0, px), _mm256_mul_ps(m4, py)), _mm256_add_ps(_mm256_mul_ps(m8, pz), m12));
+            __m256 cy = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(m1, px), _mm256_mul_ps(m5, py)), _mm256_add_ps(_mm256_mul_ps(m9, pz), m13));
+            __m256 cz = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(m2, px), _mm256_mul_ps(m6, py)), _mm256_add_ps(_mm256_mul_ps(m10, pz), m14));
+            __m256 cw = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(m3, px), _mm256_mul_ps(m7, py)), _mm256_add_ps(_mm256_mul_ps(m11, pz), m15));
+
+            StoreClip4(_mm256_castps256_ps128(cx), _mm256_castps256_ps128(cy),
+                _mm256_castps256_ps128(cz), _mm256_castps256_ps128(cw), out + i);
+            StoreClip4(_mm256_extractf128_ps(cx, 1), _mm256_extractf128_ps(cy, 1),
+                _mm256_extractf128_ps(cz, 1), _mm256_extractf128_ps(cw, 1), out + i + 4);
+        }
+    }
+#endif
+
+#if defined(CLIP_SSE)
+    {
+        __m128 m0 = _mm_set1_ps(m[0]), m1 = _mm_set1_ps(m[1]), m2 = _mm_set1_ps(m[2]), m3 = _mm_set1_ps(m[3]);
+        __m128 m4 = _mm_set1_ps(m[4]), m5 = _mm_set1_ps(m[5]), m6 = _mm_set1_ps(m[6]), m7 = _mm_set1_ps(m[7]);
+        __m128 m8 = _mm_set1_ps(m[8]), m9 = _mm_set1_ps(m[9]), m10 = _mm_set1_ps(m[10]), m11 = _mm_set1_ps(m[11]);
+        __m128 m12 = _mm_set1_ps(m[12]), m13 = _mm_set1_ps(m[13]), m14 = _mm_set1_ps(m[14]), m15 = _mm_set1_ps(m[15]);
+
+        for (; i + 4 <= count; i += 4) {
+            __m128 px = _mm_loadu_ps(x + i);
+            __m128 py = _mm_loadu_ps(y + i);
+            __m128 pz = _mm_loadu_ps(z + i);
+
+            __m128 cx = _mm_add_ps(_mm_add_ps(_mm_mul_ps(m0, px), _mm_mul_ps(m4, py)), _mm_add_ps(_mm_mul_ps(m8, pz), m12));
+            __m128 cy = _mm_add_ps(_mm_add_ps(_mm_mul_ps(m1, px), _mm_mul_ps(m5, py)), _mm_add_ps(_mm_mul_ps(m9, pz), m13));
+            __m128 cz = _mm_add_ps(_mm_add_ps(_mm_mul_ps(m2, px), _mm_mul_ps(m6, py)), _mm_add_ps(_mm_mul_ps(m10, pz), m14));
+            __m128 cw = _mm_add_ps(_mm_add_ps(_mm_mul_ps(m3, px), _mm_mul_ps(m7, py)), _mm_add_ps(_mm_mul_ps(m11, pz), m15));
+
+            StoreClip4(cx, cy, cz, cw, out + i);
+        }
+    }
+#else
+    /* Cortex-M7: keep the matrix in FPU registers and unroll by 4 so the
+     * single-precision multiply-accumulates of independent vertices overlap */
+    {
+        float m0 = m[0], m1 = m[1], m2 = m[2], m3 = m[3];
+        float m4 = m[4], m5 = m[5], m6 = m[6], m7 = m[7];
+        float m8 = m[8], m9 = m[9], m10 = m[10], m11 = m[11];
+        float m12 = m[12], m13 = m[13], m14 = m[14], m15 = m[15];
+
+        for (; i + 4 <= count; i += 4) {
+            for (uint32_t k = 0; k < 4; k++) {
+                float px = x[i + k], py = y[i + k], pz = z[i + k];
+                Vec4* c = &out[i + k].pos;
+                c->x = m0 * px + m4 * py + m8 * pz + m12;
+                c->y = m1 * px + m5 * py + m9 * pz + m13;
+                c->z = m2 * px + m6 * py + m10 * pz + m14;
+                c->w = m3 * px + m7 * py + m11 * pz + m15;
+            }
+        }
+    }
+#endif
+
+    /* Remainder */
+    for (; i < count; i++) {
+        out[i].pos = Mat4_MultiplyVec4(mvp, Vec4_Create(x[i], y[i], z[i], 1.0f));
+    }
+}
+
+void Clip_TransformQuantized(const Mat4* mvp, const int16_t* pos, uint32_t stride,
+    uint32_t count, ClipVertex_t* out)
+{
+    const float* m = mvp->m;
+    float m0 = m[0], m1 = m[1], m2 = m[2], m3 = m[3];
+    float m4 = m[4], m5 = m[5], m6 = m[6], m7 = m[7];
+    float m8 = m[8], m9 = m[9], m10 = m[10], m11 = m[11];
+    float m12 = m[12], m13 = m[13], m14 = m[14], m15 = m[15];
+
+    /* Each vertex is one 12-byte read instead of three float streams */
+    for (uint32_t i = 0; i < count; i++, pos += stride) {
+        float px = (float)pos[0], py = (float)pos[1], pz = (float)pos[2];
+        Vec4* c = &out[i].pos;
+        c->x = m0 * px + m4 * py + m8 * pz + m12;
+        c->y = m1 * px + m5 * py + m9 * pz + m13;
+        c->z = m2 * px + m6 * py + m10 * pz + m14;
+        c->w = m3 * px + m7 * py + m11 * pz + m15;
+    }
+}
+
+/* ============================================================
+ * Polygon Clipping
+ * ============================================================ */
+
+static uint16_t LerpColor(uint16_t a, uint16_t b, float t)
+{
+    int ar = (a >> 11) & 0x1F, ag = (a >> 5) & 0x3F, ab = a & 0x1F;
+    int br = (b >> 11) & 0x1F, bg = (b >> 5) & 0x3F, bb = b & 0x1F;
+    int r = ar + (int)((br - ar) * t + 0.5f);
+    int g = ag + (int)((bg - ag) * t + 0.5f);
+    int bl = ab + (int)((bb - ab) * t + 0.5f);
+    return (uint16_t)((r << 11) | (g << 5) | bl);
+}
+
+static void LerpVertex(const ClipVertex_t* a, const ClipVertex_t* b, float t, ClipVertex_t* out)
+{
+    out->pos.x = a->pos.x + (b->pos.x - a->pos.x) * t;
+    out->pos.y = a->pos.y + (b->pos.y - a->pos.y) * t;
+    out->pos.z = a->pos.z + (b->pos.z - a->pos.z) * t;
+    out->pos.w = a->pos.w + (b->pos.w - a->pos.w) * t;
+    out->u = a->u + (b->u - a->u) * t;
+    out->v = a->v + (b->v - a->v) * t;
+    out->color = LerpColor(a->color, b->color, t);
+}
+
+/* One Sutherland-Hodgman pass; returns output vertex count */
+static int ClipAgainstPlane(const ClipVertex_t* in, int count, uint32_t plane, ClipVertex_t* out)
+{
+    int n = 0;
+    const ClipVertex_t* prev = &in[count - 1];
+    float d_prev = PlaneDistance(&prev->pos, plane);
+
+    for (int i = 0; i < count; i++) {
+        const ClipVertex_t* cur = &in[i];
+        float d_cur = PlaneDistance(&cur->pos, plane);
+
+        if ((d_prev >= 0.0f) != (d_cur >= 0.0f)) {
+            /* Always interpolate from the inside vertex so shared edges
+             * produce bit-identical intersection points */
+            if (d_prev >= 0.0f) LerpVertex(prev, cur, d_prev / (d_prev - d_cur), &out[n++]);
+            else                LerpVertex(cur, prev, d_cur / (d_cur - d_prev), &out[n++]);
+        }
+        if (d_cur >= 0.0f) out[n++] = *cur;
+
+        prev = cur;
+        d_prev = d_cur;
+    }
+    return n;
+}
+
+int Clip_Polygon(const ClipVertex_t* in, int count, uint32_t planes, ClipVertex_t* out)
+{
+    ClipVertex_t buf[2][CLIP_MAX_VERTS];
+    const ClipVertex_t* src = in;
+    int n = count;
+    int which = 0;
+
+    for (uint32_t plane = CLIP_NEAR; plane <= CLIP_TOP && n > 0; plane <<= 1) {
+        if (!(planes & plane)) continue;
+        n = ClipAgainstPlane(src, n, plane, buf[which]);
+        src = buf[which];
+        which ^= 1;
+    }
+
+    for (int i = 0; i < n; i++) out[i] = src[i];
+    return n;
+}
+
+/* ============================================================
+ * Projection
+ * ============================================================ */
+
+void Clip_ToScreen(const ClipVertex_t* in, int width, int height, ScreenVertex_t* out)
+{
+    float inv_w = Math_Recip(in->pos.w);
+    float ndc_x = in->pos.x * inv_w;
+    float ndc_y = in->pos.y * inv_w;
+
+    float screen_x = (ndc_x * 0.5f + 0.5f) * width;
+    float screen_y = (1.0f - (ndc_y * 0.5f + 0.5f)) * height;
+
+    out->x = (int32_t)floorf(screen_x * RASTER_SUBPIXEL_SCALE + 0.5f);
+    out->y = (int32_t)floorf(screen_y * RASTER_SUBPIXEL_SCALE + 0.5f);
+    out->z = in->pos.z * inv_w;
+    out->w_inv = inv_w;
+    out->u = in->u;
+    out->v = in->v;
+    out->color = in->color;
+}
+
+/* ============================================================
+ * Triangle Submission
+ * ============================================================ */
+
+/* Returns the number of screen vertices forming a convex fan, 0 if culled */
+static int ClipTriangle(const RasterContext_t* ctx, const ClipVertex_t* v0, const ClipVertex_t* v1,
+    const ClipVertex_t* v2, ScreenVertex_t* out)
+{
+    uint32_t c0 = Clip_Outcode(&v0->pos);
+    uint32_t c1 = Clip_Outcode(&v1->pos);
+    uint32_t c2 = Clip_Outcode(&v2->pos);
+
+    /* All three outside one plane */
+    if (c0 & c1 & c2) return 0;
+
+    ClipVertex_t poly[CLIP_MAX_VERTS];
+    int n = 3;
+    poly[0] = *v0;
+    poly[1] = *v1;
+    poly[2] = *v2;
+
+    uint32_t straddle = c0 | c1 | c2;
+    if (straddle) {
+        n = Clip_Polygon(poly, 3, straddle, poly);
+        if (n < 3) return 0;
+    }
+
+    int width, height;
+    RasterContext_GetResolution(ctx, &width, &height);
+    for (int i = 0; i < n; i++) {
+        Clip_ToScreen(&poly[i], width, height, &out[i]);
+    }
+    return n;
+}
+
+void Clip_DrawTriangleTo(RasterContext_t* ctx, const ClipVertex_t* v0, const ClipVertex_t* v1,
+    const ClipVertex_t* v2, const Texture_t* texture)
+{
+    ScreenVertex_t sv[CLIP_MAX_VERTS];
+    uint64_t start = Profile_Now();
+    int n = ClipTriangle(ctx, v0, v1, v2, sv);
+    RasterContext_AddStageTime(ctx, RASTER_STAGE_CLIP, start, Profile_Now());
+
+    /* Clipping preserves winding, so the rasterizer's area test still culls back faces */
+    for (int i = 2; i < n; i++) {
+        RasterContext_DrawTriangle(ctx, &sv[0], &sv[i - 1], &sv[i], texture);
+    }
+}
+
+void Clip_DrawTriangleSolidTo(RasterContext_t* ctx, const ClipVertex_t* v0, const ClipVertex_t* v1,
+    const ClipVertex_t* v2, uint16_t color)
+{
+    ScreenVertex_t sv[CLIP_MAX_VERTS];
+    uint64_t start = Profile_Now();
+    int n = ClipTriangle(ctx, v0, v1, v2, sv);
+    RasterContext_AddStageTime(ctx, RASTER_STAGE_CLIP, start, Profile_Now());
+
+    for (int i = 2; i < n; i++) {
+        RasterContext_DrawTriangleSolid(ctx, &sv[0], &sv[i - 1], &sv[i], color);
+    }
+}
+
+void Clip_DrawTriangle(const ClipVertex_t* v0, const ClipVertex_t* v1,
+    const ClipVertex_t* v2, const Texture_t* texture)
+{
+    Clip_DrawTriangleTo(Rasterizer_GetContext(), v0, v1, v2, texture);
+}
+
+void Clip_DrawTriangleSolid(const ClipVertex_t* v0, const ClipVertex_t* v1,
+    const ClipVertex_t* v2, uint16_t color)
+{
+    Clip_DrawTriangleSolidTo(Rasterizer_GetContext(), v0, v1, v2, color);
+}
+
+/* Index lists: in-view triangles gather here and go to the rasterizer
+ * together; a clipped one sends the gathered ones first, keeping order */
+#define CLIP_BATCH_TRIANGLES    256
+#define OUTCODE_PENDING         0xFF
+
+static inline void DrawBatch(RasterContext_t* ctx, const ScreenVertex_t* screen, const uint16_t* batch,
+    uint32_t count, const Texture_t* texture, uint16_t color, int solid)
+{
+    if (!count) return;
+    if (solid) RasterContext_DrawTrianglesSolid(ctx, screen, batch, count, color);
+    else RasterContext_DrawTriangles(ctx, screen, batch, count, texture);
+}
+
+static void DrawList(RasterContext_t* ctx, const ClipVertex_t* verts, uint32_t vertex_count,
+    const uint16_t* indices, const uint32_t* order, uint32_t tri_count, const Texture_t* texture,
+    uint16_t color, int solid)
+{
+    ArenaMark_t mark = Arena_Mark();
+    uint8_t* codes = (uint8_t*)Arena_Alloc(vertex_count, ARENA_DEFAULT_ALIGN);
+    ScreenVertex_t* screen = (ScreenVertex_t*)Arena_Alloc(vertex_count * sizeof(ScreenVertex_t), ARENA_DEFAULT_ALIGN);
+    if (!codes || !screen) {
+        Arena_Release(mark);
+        for (uint32_t t = 0; t < tri_count; t++) {
+            const uint16_t* tri = &indices[(order ? order[t] : t) * 3];
+            if (solid) Clip_DrawTriangleSolidTo(ctx, &verts[tri[0]], &verts[tri[1]], &verts[tri[2]], color);
+            else Clip_DrawTriangleTo(ctx, &verts[tri[0]], &verts[tri[1]], &verts[tri[2]], texture);
+        }
+        return;
+    }
+
+    /* Each referenced vertex tested once, and projected if inside */
+    uint64_t start = Profile_Now();
+    int width, height;
+    RasterContext_GetResolution(ctx, &width, &height);
+    memset(codes, OUTCODE_PENDING, vertex_count);
+    for (uint32_t t = 0; t < tri_count; t++) {
+        const uint16_t* tri = &indices[(order ? order[t] : t) * 3];
+        for (int k = 0; k < 3; k++) {
+            uint32_t i = tri[k];
+            if (codes[i] != OUTCODE_PENDING) continue;
+            codes[i] = (uint8_t)Clip_Outcode(&verts[i].pos);
+            if (!codes[i]) Clip_ToScreen(&verts[i], width, height, &screen[i]);
+        }
+    }
+    RasterContext_AddStageTime(ctx, RASTER_STAGE_CLIP, start, Profile_Now());
+
+    uint16_t batch[CLIP_BATCH_TRIANGLES * 3];
+    uint32_t count = 0;
+    for (uint32_t t = 0; t < tri_count; t++) {
+        const uint16_t* tri = &indices[(order ? order[t] : t) * 3];
+        uint32_t c0 = codes[tri[0]], c1 = codes[tri[1]], c2 = codes[tri[2]];
+        if (c0 & c1 & c2) continue;
+        if (c0 | c1 | c2) {
+            DrawBatch(ctx, screen, batch, count, texture, color, solid);
+            count = 0;
+            if (solid) Clip_DrawTriangleSolidTo(ctx, &verts[tri[0]], &verts[tri[1]], &verts[tri[2]], color);
+            else Clip_DrawTriangleTo(ctx, &verts[tri[0]], &verts[tri[1]], &verts[tri[2]], texture);
+            continue;
+        }
+        memcpy(&batch[count * 3], tri, 3 * sizeof(uint16_t));
+        if (++count == CLIP_BATCH_TRIANGLES) {
+            DrawBatch(ctx, screen, batch, count, texture, color, solid);
+            count = 0;
+        }
+    }
+    DrawBatch(ctx, screen, batch, count, texture, color, solid);
+    Arena_Release(mark);
+}
+
+void Clip_DrawTrianglesTo(RasterContext_t* ctx, const ClipVertex_t* verts, uint32_t vertex_count,
+    const uint16_t* indices, const uint32_t* order, uint32_t tri_count, const Texture_t* texture)
+{
+    DrawList(ctx, verts, vertex_count, indices, order, tri_count, texture, 0, 0);
+}
+
+void Clip_DrawTrianglesSolidTo(RasterContext_t* ctx, const ClipVertex_t* verts, uint32_t vertex_count,
+    const uint16_t* indices, const uint32_t* order, uint32_t tri_count, uint16_t color)
+{
+    DrawList(ctx, verts, vertex_count, indices, order, tri_count, NULL, color, 1);
+}
+
+/* ============================================================
+ * Lines
+ * ============================================================ */
+
+/* Signed distance to a plane of the true view, no guard band: lines are
+ * walked only over their visible pixels, so there is nothing to save */
+static inline float LineDistance(const Vec4* p, uint32_t plane)
+{
+    switch (plane) {
+    case CLIP_NEAR:   return p->z;
+    case CLIP_FAR:    return p->w - p->z;
+    case CLIP_LEFT:   return p->x + p->w;
+    case CLIP_RIGHT:  return p->w - p->x;
+    case CLIP_BOTTOM: return p->y + p->w;
+    default:          return p->w - p->y;   /* CLIP_TOP */
+    }
+}
+
+static inline Vec4 LerpPos(const Vec4* a, const Vec4* b, float t)
+{
+    return Vec4_Create(a->x + (b->x - a->x) * t, a->y + (b->y - a->y) * t,
+        a->z + (b->z - a->z) * t, a->w + (b->w - a->w) * t);
+}
+
+void Clip_DrawLine(const ClipVertex_t* a, const ClipVertex_t* b, uint16_t color, int depth_test)
+{
+    /* Liang-Barsky in homogeneous space: each plane distance is linear
+     * in t, so one pass narrows [t0, t1] to the part inside all six */
+    static const uint32_t planes[6] = { CLIP_NEAR, CLIP_FAR, CLIP_LEFT, CLIP_RIGHT, CLIP_BOTTOM, CLIP_TOP };
+    float t0 = 0.0f, t1 = 1.0f;
+    for (int i = 0; i < 6; i++) {
+        float da = LineDistance(&a->pos, planes[i]);
+        float db = LineDistance(&b->pos, planes[i]);
+        if (da < 0.0f && db < 0.0f) return;
+        if (da < 0.0f) t0 = MAX(t0, da / (da - db));
+        else if (db < 0.0f) t1 = MIN(t1, da / (da - db));
+    }
+    if (t0 > t1) return;
+
+    ClipVertex_t ca = *a, cb = *b;
+    ca.pos = LerpPos(&a->pos, &b->pos, t0);
+    cb.pos = LerpPos(&a->pos, &b->pos, t1);
+
+    int width, height;
+    RasterContext_GetResolution(Rasterizer_GetContext(), &width, &height);
+    ScreenVertex_t sa, sb;
+    Clip_ToScreen(&ca, width, height, &sa);
+    Clip_ToScreen(&cb, width, height, &sb);
+    Rasterizer_DrawLine3D(&sa, &sb, color, depth_test);
+}
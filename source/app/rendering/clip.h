@@ -0,0 +1,104 @@
+/**
+ * @file clip.h
+ * @brief Homogeneous Clip-Space Triangle Clipping
+ *
+ * Triangles are clipped against the near plane (z = 0), the far plane
+ * (z = w) and a guard band of CLIP_GUARD_BAND * w on x/y, then projected
+ * and handed to the rasterizer. Pixels outside the viewport but inside
+ * the guard band are rejected by the rasterizer's scissor, so only
+ * triangles crossing the guard band pay for real x/y clipping.
+ */
+
+#ifndef CLIP_H
+#define CLIP_H
+
+#include <stdint.h>
+#include "math3d.h"
+#include "rasterizer.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Keeps screen coords (with sub-pixel bits) inside int32 edge-function range */
+#define CLIP_GUARD_BAND     1.5f
+
+/* A triangle clipped by 6 planes has at most 9 vertices */
+#define CLIP_MAX_VERTS      9
+
+typedef struct {
+    Vec4 pos;           /* Clip-space position */
+    float u, v;
+    uint16_t color;     /* RGB565 vertex color/lighting */
+} ClipVertex_t;
+
+/* Outcode bits */
+#define CLIP_NEAR           (1 << 0)
+#define CLIP_FAR            (1 << 1)
+#define CLIP_LEFT           (1 << 2)
+#define CLIP_RIGHT          (1 << 3)
+#define CLIP_BOTTOM         (1 << 4)
+#define CLIP_TOP            (1 << 5)
+
+/* View frustum planes (normalized, inside is dot(n, p) + d >= 0) */
+typedef struct {
+    Vec4 planes[6];
+} ClipFrustum_t;
+
+uint32_t Clip_Outcode(const Vec4* p);
+
+/* Planes from a view-projection matrix; culls against the true view,
+ * not the guard band */
+void Clip_ExtractFrustum(const Mat4* view_proj, ClipFrustum_t* f);
+
+/* 0 if the sphere lies completely outside any plane */
+int Clip_SphereInFrustum(const ClipFrustum_t* f, Vec3 center, float radius);
+
+/* Batch clip-space transform of structure-of-arrays positions (w = 1).
+ * Writes out[i].pos only; runs 8 (AVX) or 4 (SSE, unrolled scalar on
+ * Cortex-M7) vertices per iteration. */
+void Clip_TransformPositions(const Mat4* mvp, const float* x, const float* y,
+    const float* z, uint32_t count, ClipVertex_t* out);
+
+/* Same transform for int16 positions at a stride of `stride` int16s
+ * (x, y, z first). Dequantization is expected to be folded into mvp. */
+void Clip_TransformQuantized(const Mat4* mvp, const int16_t* pos, uint32_t stride,
+    uint32_t count, ClipVertex_t* out);
+
+/* Sutherland-Hodgman against every plane set in planes; returns vertex count */
+int Clip_Polygon(const ClipVertex_t* in, int count, uint32_t planes, ClipVertex_t* out);
+
+/* Perspective divide and viewport transform */
+void Clip_ToScreen(const ClipVertex_t* in, int width, int height, ScreenVertex_t* out);
+
+/* Clip, project and rasterize; fans the clipped polygon into triangles */
+void Clip_DrawTriangle(const ClipVertex_t* v0, const ClipVertex_t* v1,
+    const ClipVertex_t* v2, const Texture_t* texture);
+void Clip_DrawTriangleSolid(const ClipVertex_t* v0, const ClipVertex_t* v1,
+    const ClipVertex_t* v2, uint16_t color);
+
+/* The same into a render context, mapped to its resolution */
+void Clip_DrawTriangleTo(RasterContext_t* ctx, const ClipVertex_t* v0, const ClipVertex_t* v1,
+    const ClipVertex_t* v2, const Texture_t* texture);
+void Clip_DrawTriangleSolidTo(RasterContext_t* ctx, const ClipVertex_t* v0, const ClipVertex_t* v1,
+    const ClipVertex_t* v2, uint16_t color);
+
+/* Indexed triangle list over verts (indices below vertex_count), drawn
+ * in the order of `order` if given, else as listed. Each vertex is
+ * tested and projected once; triangles inside the view go to the
+ * rasterizer in batches, and only those crossing a plane are clipped on
+ * their own. The image is that of a Clip_DrawTriangleTo() per triangle. */
+void Clip_DrawTrianglesTo(RasterContext_t* ctx, const ClipVertex_t* verts, uint32_t vertex_count,
+    const uint16_t* indices, const uint32_t* order, uint32_t tri_count, const Texture_t* texture);
+void Clip_DrawTrianglesSolidTo(RasterContext_t* ctx, const ClipVertex_t* verts, uint32_t vertex_count,
+    const uint16_t* indices, const uint32_t* order, uint32_t tri_count, uint16_t color);
+
+/* Clip a line to the view (Liang-Barsky, no guard band), project it to
+ * the default context and draw it with Rasterizer_DrawLine3D() */
+void Clip_DrawLine(const ClipVertex_t* a, const ClipVertex_t* b, uint16_t color, int depth_test);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CLIP_H */
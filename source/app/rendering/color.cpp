@@ -1,5 +1,11 @@
 #include "color.h"
 #include <stdint.h>
+#include <string.h>
+
+#if defined(SDL_PC) && (defined(__SSE2__) || defined(_M_X64) || defined(_M_IX86_FP))
+#define COLOR_SSE 1
+#include <emmintrin.h>
+#endif
 
 #ifdef __cplusplus
 #include <SDL/SDL.h>
@@ -72,4 +78,52 @@ Color blendAdd(const Color* source, const Color* target)
     return ret;
 }
 
-#endif /* __cplusplus */
\ No newline at end of file
+#endif /* __cplusplus */
+
+/* ============================================================
+ * Packed RGB565 Blending
+ * ============================================================ */
+
+#define BLEND_SPAN(blend2) \
+    for (; i + 1 < count; i += 2) { \
+        uint32_t d; \
+        memcpy(&d, &dst[i], sizeof(d)); \
+        d = blend2((uint32_t)src[i] | ((uint32_t)src[i + 1] << 16), d); \
+        memcpy(&dst[i], &d, sizeof(d)); \
+    }
+
+void Color_BlendSpan565(uint16_t* dst, const uint16_t* src, uint32_t count, int mode)
+{
+    uint32_t i = 0;
+    if (count == 0) return;
+
+    if (mode == COLOR_BLEND_KEY) {
+#ifdef COLOR_SSE
+        /* Eight texels a step: the key compare picks dst, anything else src */
+        const __m128i key = _mm_set1_epi16((short)COLOR_KEY_565);
+        for (; i + 8 <= count; i += 8) {
+            __m128i s = _mm_loadu_si128((const __m128i*)(src + i));
+            __m128i d = _mm_loadu_si128((const __m128i*)(dst + i));
+            __m128i hit = _mm_cmpeq_epi16(s, key);
+            _mm_storeu_si128((__m128i*)(dst + i), _mm_or_si128(_mm_and_si128(hit, d), _mm_andnot_si128(hit, s)));
+        }
+#endif
+        for (; i < count; i++) {
+            if (src[i] != COLOR_KEY_565) dst[i] = src[i];
+        }
+        return;
+    }
+
+    /* Leading pixel up to a word boundary, then pairs, then the tail */
+    if ((uintptr_t)dst & 2) {
+        dst[0] = Color_Blend565(src[0], dst[0], mode);
+        i = 1;
+    }
+    if (mode == COLOR_BLEND_ADD) {
+        BLEND_SPAN(Color_Add565x2)
+    }
+    else {
+        BLEND_SPAN(Color_Average565x2)
+    }
+    if (i < count) dst[i] = Color_Blend565(src[i], dst[i], mode);
+}
@@ -93,4 +93,54 @@ Color blendAdd(const Color* source, const Color* target);
 
 #endif /* __cplusplus */
 
-#endif /* RENDERING_COLOR_H */
\ No newline at end of file
+/* ============================================================
+ * Packed RGB565 Blending
+ * Two pixels per 32-bit word. Masks keep the channels apart, so one add
+ * or shift works on all six; used by the rasterizer's transparent pass.
+ * ============================================================ */
+
+#define COLOR_BLEND_AVERAGE     1   /* (src + dst) / 2 per channel */
+#define COLOR_BLEND_ADD         2   /* src + dst per channel, saturated */
+#define COLOR_BLEND_KEY         3   /* src, except where src is COLOR_KEY_565 */
+
+/* Transparent texel of COLOR_BLEND_KEY sprites, e.g. impostors */
+#define COLOR_KEY_565           0xF81F
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Per-channel floor((a + b) / 2): the low bit of each channel is masked
+ * off before the shift so nothing crosses into the channel below */
+static inline uint32_t Color_Average565x2(uint32_t a, uint32_t b)
+{
+    return (a & b) + (((a ^ b) & 0xF7DEF7DEu) >> 1);
+}
+
+/* Per-channel saturated a + b. The halved sum has a spare top bit per
+ * channel that flags overflow; those carries are taken back out of the
+ * plain sum and the overflowed channels filled with ones. */
+static inline uint32_t Color_Add565x2(uint32_t a, uint32_t b)
+{
+    uint32_t half = ((a & 0xF7DEF7DEu) >> 1) + ((b & 0xF7DEF7DEu) >> 1) + (a & b & 0x08210821u);
+    uint32_t carry = half & 0x84108410u;
+    uint32_t fill = (carry << 1) - (((carry & 0x80108010u) >> 4) | ((carry & 0x04000400u) >> 5));
+    return (a + b - (carry << 1)) | fill;
+}
+
+/* One pixel, mode COLOR_BLEND_* */
+static inline uint16_t Color_Blend565(uint16_t src, uint16_t dst, int mode)
+{
+    if (mode == COLOR_BLEND_KEY) return (src == COLOR_KEY_565) ? dst : src;
+    return (uint16_t)((mode == COLOR_BLEND_ADD) ? Color_Add565x2(src, dst) : Color_Average565x2(src, dst));
+}
+
+/* dst[i] = blend(src[i], dst[i]) for count pixels; pairs once dst is
+ * word aligned */
+void Color_BlendSpan565(uint16_t* dst, const uint16_t* src, uint32_t count, int mode);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* RENDERING_COLOR_H */
@@ -0,0 +1,84 @@
+/**
+ * @file dcache.cpp
+ * @brief D-Cache Maintenance Around DMA Transfers Implementation
+ */
+
+#include "dcache.h"
+
+#ifndef SDL_PC
+#include "stm32h7xx.h"
+#endif
+
+#if !defined(SDL_PC) && defined(__DCACHE_PRESENT) && __DCACHE_PRESENT
+
+/* First line of the range, and its length in whole lines */
+static inline uint32_t LineStart(const void* addr)
+{
+    return (uint32_t)addr & ~(uint32_t)(DCACHE_LINE - 1);
+}
+
+static inline int32_t LineBytes(const void* addr, uint32_t bytes)
+{
+    uint32_t end = ((uint32_t)addr + bytes + DCACHE_LINE - 1) & ~(uint32_t)(DCACHE_LINE - 1);
+    return (int32_t)(end - LineStart(addr));
+}
+
+void DCache_Clean(const void* addr, uint32_t bytes)
+{
+    if (!bytes) return;
+    if (bytes > DCACHE_SIZE) {
+        SCB_CleanDCache();
+        return;
+    }
+    SCB_CleanDCache_by_Addr((uint32_t*)LineStart(addr), LineBytes(addr, bytes));
+}
+
+void DCache_Invalidate(void* addr, uint32_t bytes)
+{
+    if (!bytes) return;
+    uint32_t start = (uint32_t)addr, end = start + bytes;
+    uint32_t head = LineStart(addr);
+    uint32_t tail = end & ~(uint32_t)(DCACHE_LINE - 1);
+
+    /* Lines shared with other data keep it; only whole lines are dropped */
+    if (head != start) {
+        SCB_CleanInvalidateDCache_by_Addr((uint32_t*)head, DCACHE_LINE);
+        head += DCACHE_LINE;
+    }
+    if (tail != end && tail >= head) {
+        SCB_CleanInvalidateDCache_by_Addr((uint32_t*)tail, DCACHE_LINE);
+    }
+    if (tail > head) SCB_InvalidateDCache_by_Addr((uint32_t*)head, (int32_t)(tail - head));
+}
+
+void DCache_CleanInvalidate(void* addr, uint32_t bytes)
+{
+    if (!bytes) return;
+    if (bytes > DCACHE_SIZE) {
+        SCB_CleanInvalidateDCache();
+        return;
+    }
+    SCB_CleanInvalidateDCache_by_Addr((uint32_t*)LineStart(addr), LineBytes(addr, bytes));
+}
+
+#else
+
+void DCache_Clean(const void* addr, uint32_t bytes)
+{
+    (void)addr;
+    (void)bytes;
+}
+
+void DCache_Invalidate(void* addr, uint32_t bytes)
+{
+    (void)addr;
+    (void)bytes;
+}
+
+void DCache_CleanInvalidate(void* addr, uint32_t bytes)
+{
+    (void)addr;
+    (void)bytes;
+}
+
+#endif
@@ -0,0 +1,49 @@
+/**
+ * @file dcache.h
+ * @brief D-Cache Maintenance Around DMA Transfers
+ *
+ * DMA2D, MDMA and the LTDC read and write memory behind the Cortex-M7
+ * D-cache, so a buffer in cacheable SDRAM or AXI SRAM has to be cleaned
+ * before a DMA read and invalidated after a DMA write. These helpers take
+ * any byte range and round it out to DCACHE_LINE lines. An invalidate
+ * never discards a neighbour's data: a partial line at either end is
+ * cleaned as well. Ranges larger than the whole cache are cleaned by
+ * set and way, which is quicker. No-ops on PC and on the CM4, which has
+ * no D-cache.
+ */
+
+#ifndef DCACHE_H
+#define DCACHE_H
+
+#include <stdint.h>
+#include "engine_config.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define DCACHE_LINE             32
+#define DCACHE_SIZE             (16 * 1024)     /* STM32H747 CM7 */
+
+/* Before a DMA reads the range: dirty lines written back */
+void DCache_Clean(const void* addr, uint32_t bytes);
+
+/* After a DMA wrote the range: stale lines dropped, including any the
+ * CPU fetched speculatively during the transfer */
+void DCache_Invalidate(void* addr, uint32_t bytes);
+
+/* Before a DMA writes the range: written back and dropped, so no dirty
+ * line lands on top of the transfer later */
+void DCache_CleanInvalidate(void* addr, uint32_t bytes);
+
+/* Bytes covered by height rows of width pixels, rows pitch pixels apart */
+static inline uint32_t DCache_RectBytes(uint32_t width, uint32_t height, uint32_t pitch, uint32_t pixel_bytes)
+{
+    return height ? ((height - 1) * pitch + width) * pixel_bytes : 0;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DCACHE_H */
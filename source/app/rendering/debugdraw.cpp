@@ -0,0 +1,193 @@
+/**
+ * @file debugdraw.cpp
+ * @brief Scene Debug Lines Implementation
+ */
+
+#include "debugdraw.h"
+#include "mesh.h"
+#include "meshlod.h"
+#include "clip.h"
+#include "arena.h"
+#include <math.h>
+#include <string.h>
+
+#define EDGE_EMPTY      0xFFFFFFFFu
+
+static Mat4 g_view_proj;
+static int g_depth_test = 1;
+static DebugDrawStats_t g_stats;
+
+void DebugDraw_Begin(const Mat4* view_proj, int depth_test)
+{
+    g_view_proj = *view_proj;
+    g_depth_test = depth_test;
+    memset(&g_stats, 0, sizeof(g_stats));
+}
+
+void DebugDraw_GetStats(DebugDrawStats_t* stats)
+{
+    *stats = g_stats;
+}
+
+static inline void ToClip(const Mat4* mvp, Vec3 p, ClipVertex_t* out)
+{
+    const float* m = mvp->m;
+    out->pos = Vec4_Create(m[0] * p.x + m[4] * p.y + m[8] * p.z + m[12],
+        m[1] * p.x + m[5] * p.y + m[9] * p.z + m[13],
+        m[2] * p.x + m[6] * p.y + m[10] * p.z + m[14],
+        m[3] * p.x + m[7] * p.y + m[11] * p.z + m[15]);
+}
+
+static inline void DrawClip(const ClipVertex_t* a, const ClipVertex_t* b, uint16_t color)
+{
+    g_stats.lines++;
+    Clip_DrawLine(a, b, color, g_depth_test);
+}
+
+void DebugDraw_Line(Vec3 a, Vec3 b, uint16_t color)
+{
+    ClipVertex_t ca, cb;
+    ToClip(&g_view_proj, a, &ca);
+    ToClip(&g_view_proj, b, &cb);
+    DrawClip(&ca, &cb, color);
+}
+
+void DebugDraw_Sphere(const Mat4* world, Vec3 center, float radius, uint16_t color)
+{
+    Mat4 mvp;
+    Mat4_Multiply(&mvp, &g_view_proj, world);
+
+    /* Each circle's points once, closed back onto the first */
+    ClipVertex_t ring[DEBUGDRAW_CIRCLE_SEGMENTS];
+    for (int axis = 0; axis < 3; axis++) {
+        for (int i = 0; i < DEBUGDRAW_CIRCLE_SEGMENTS; i++) {
+            float a = (float)i * (2.0f * PI / DEBUGDRAW_CIRCLE_SEGMENTS);
+            float c = cosf(a) * radius, s = sinf(a) * radius;
+            Vec3 p = center;
+            if (axis == 0) { p.y += c; p.z += s; }
+            else if (axis == 1) { p.x += c; p.z += s; }
+            else { p.x += c; p.y += s; }
+            ToClip(&mvp, p, &ring[i]);
+        }
+        for (int i = 0; i < DEBUGDRAW_CIRCLE_SEGMENTS; i++) {
+            DrawClip(&ring[i], &ring[(i + 1) % DEBUGDRAW_CIRCLE_SEGMENTS], color);
+        }
+    }
+}
+
+void DebugDraw_Box(const Mat4* world, Vec3 min, Vec3 max, uint16_t color)
+{
+    /* Corner i takes max on axis x, y, z for bits 0, 1, 2; edges join
+     * corners one bit apart */
+    Mat4 mvp;
+    Mat4_Multiply(&mvp, &g_view_proj, world);
+    ClipVertex_t corner[8];
+    for (int i = 0; i < 8; i++) {
+        Vec3 p = Vec3_Create((i & 1) ? max.x : min.x, (i & 2) ? max.y : min.y, (i & 4) ? max.z : min.z);
+        ToClip(&mvp, p, &corner[i]);
+    }
+    for (int i = 0; i < 8; i++) {
+        for (int bit = 1; bit < 8; bit <<= 1) {
+            if (!(i & bit)) DrawClip(&corner[i], &corner[i | bit], color);
+        }
+    }
+}
+
+/* Inserts the undirected edge (a, b); 0 if it was already there */
+static int AddEdge(uint32_t* set, uint32_t mask, uint32_t a, uint32_t b)
+{
+    uint32_t key = (a < b) ? (a << 16 | b) : (b << 16 | a);
+    uint32_t i = (key * 2654435761u) & mask;
+    while (set[i] != EDGE_EMPTY) {
+        if (set[i] == key) return 0;
+        i = (i + 1) & mask;
+    }
+    set[i] = key;
+    return 1;
+}
+
+void DebugDraw_Mesh(uint32_t mesh_id, const Mat4* world, uint32_t lod,
+    uint16_t frame_a, uint16_t frame_b, float lerp, uint16_t color)
+{
+    MeshSlot_t* mesh = Mesh_Get(mesh_id);
+    if (!mesh || (mesh->type != 1 && mesh->type != 2)) return;
+
+    uint32_t index_count, vertex_count;
+    const uint16_t* indices = Mesh_GetLodIndices(mesh, lod, &index_count, &vertex_count);
+    if (!indices || index_count < 3) return;
+
+    Mat4 mvp;
+    Mat4_Multiply(&mvp, &g_view_proj, world);
+
+    /* Every vertex transformed once; MD2 indices name UV pairs, which
+     * map onto frame vertices so seams do not double their edges */
+    ArenaMark_t mark = Arena_Mark();
+    ClipVertex_t* transformed = NULL;
+    const MD2UV_t* uvs = NULL;
+    if (mesh->type == 1) {
+        const PackedVertex_t* packed = Mesh_GetPackedVertices(mesh);
+        transformed = (ClipVertex_t*)Arena_Alloc(vertex_count * sizeof(ClipVertex_t), ARENA_DEFAULT_ALIGN);
+        if (transformed && packed) {
+            Mat4 dequant, packed_mvp;
+            Mesh_GetPackedDequant(&mesh->stat, &dequant);
+            Mat4_Multiply(&packed_mvp, &mvp, &dequant);
+            Clip_TransformQuantized(&packed_mvp, &packed->x, sizeof(PackedVertex_t) / sizeof(int16_t),
+                vertex_count, transformed);
+        }
+        else if (transformed) {
+            const float *x, *y, *z;
+            Mesh_GetPositions(mesh, &x, &y, &z);
+            if (x) Clip_TransformPositions(&mvp, x, y, z, vertex_count, transformed);
+            else transformed = NULL;
+        }
+    }
+    else {
+        const MD2Pose_t* pose = Mesh_GetMD2Pose(mesh_id, frame_a, frame_b, lerp);
+        uvs = Mesh_GetUVPairs(mesh);
+        if (pose && uvs) {
+            transformed = (ClipVertex_t*)Arena_Alloc(pose->count * sizeof(ClipVertex_t), ARENA_DEFAULT_ALIGN);
+            if (transformed) Clip_TransformPositions(&mvp, pose->x, pose->y, pose->z, pose->count, transformed);
+        }
+    }
+
+    /* Closed meshes share every edge between two triangles: a set of
+     * drawn edges, at most twice full, halves the lines */
+    uint32_t capacity = 16;
+    while (capacity < index_count * 2) capacity <<= 1;
+    uint32_t* edges = transformed ? (uint32_t*)Arena_Alloc(capacity * sizeof(uint32_t), ARENA_DEFAULT_ALIGN) : NULL;
+    if (!edges) {
+        Arena_Release(mark);
+        return;
+    }
+    memset(edges, 0xFF, capacity * sizeof(uint32_t));
+
+    for (uint32_t i = 0; i + 2 < index_count; i += 3) {
+        uint32_t v[3];
+        for (int k = 0; k < 3; k++) v[k] = uvs ? uvs[indices[i + k]].vertex : indices[i + k];
+        for (int k = 0; k < 3; k++) {
+            uint32_t a = v[k], b = v[(k + 1) % 3];
+            if (a == b) continue;
+            if (AddEdge(edges, capacity - 1, a, b)) DrawClip(&transformed[a], &transformed[b], color);
+            else g_stats.shared_edges++;
+        }
+    }
+    Arena_Release(mark);
+}
+
+void DebugDraw_List(const DrawList_t* list, uint32_t what, int depth_test,
+    uint16_t wire_color, uint16_t bounds_color)
+{
+    DebugDraw_Begin(&list->view_proj, depth_test);
+    for (uint32_t i = 0; i < list->count; i++) {
+        const DrawCmd_t* cmd = &list->cmds[i];
+        if (what & DEBUGDRAW_WIREFRAME) {
+            DebugDraw_Mesh(cmd->mesh_id, &cmd->world, cmd->lod,
+                cmd->anim_frame_a, cmd->anim_frame_b, cmd->anim_lerp, wire_color);
+        }
+        if (what & DEBUGDRAW_BOUNDS) {
+            MeshSlot_t* mesh = Mesh_Get(cmd->mesh_id);
+            if (mesh && mesh->type == 1) DebugDraw_Sphere(&cmd->world, mesh->stat.bounds_center, mesh->stat.bounds_radius, bounds_color);
+            else if (mesh && mesh->type == 2) DebugDraw_Sphere(&cmd->world, mesh->anim.bounds_center, mesh->anim.bounds_radius, bounds_color);
+        }
+    }
+}
@@ -0,0 +1,61 @@
+/**
+ * @file debugdraw.h
+ * @brief Scene Debug Lines: Wireframes And Bounds - NO MALLOC
+ *
+ * Lines in world or object space over the rendered scene. The vertices
+ * of a call are transformed once into the frame arena, every line is
+ * clipped to the view in homogeneous space (Clip_DrawLine) and walked
+ * only over its visible pixels, optionally depth tested against the
+ * scene. A mesh wireframe draws each edge once, however many triangles
+ * share it. When binning, the lines ride along in the bins and draw per
+ * tile after its triangles: submit them before Rasterizer_Flush().
+ */
+
+#ifndef DEBUGDRAW_H
+#define DEBUGDRAW_H
+
+#include <stdint.h>
+#include "math3d.h"
+#include "scenebuffer.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define DEBUGDRAW_CIRCLE_SEGMENTS   16
+
+/* What DebugDraw_List() shows per draw */
+#define DEBUGDRAW_WIREFRAME     0x01
+#define DEBUGDRAW_BOUNDS        0x02    /* Mesh bounding sphere */
+
+typedef struct {
+    uint32_t lines;             /* Submitted since DebugDraw_Begin(), before clipping */
+    uint32_t shared_edges;      /* Wireframe edges skipped as already drawn */
+} DebugDrawStats_t;
+
+/* Camera for the calls that follow; depth_test hides lines behind the scene */
+void DebugDraw_Begin(const Mat4* view_proj, int depth_test);
+
+void DebugDraw_Line(Vec3 a, Vec3 b, uint16_t color);
+
+/* Three circles about the axes of world, e.g. a mesh bounding sphere */
+void DebugDraw_Sphere(const Mat4* world, Vec3 center, float radius, uint16_t color);
+
+/* Edges of the box [min, max] placed by world */
+void DebugDraw_Box(const Mat4* world, Vec3 min, Vec3 max, uint16_t color);
+
+/* Edges of a mesh detail level; MD2 meshes between two frames as drawn */
+void DebugDraw_Mesh(uint32_t mesh_id, const Mat4* world, uint32_t lod,
+    uint16_t frame_a, uint16_t frame_b, float lerp, uint16_t color);
+
+/* Every draw of a list, with the list's camera; what is DEBUGDRAW_* */
+void DebugDraw_List(const DrawList_t* list, uint32_t what, int depth_test,
+    uint16_t wire_color, uint16_t bounds_color);
+
+void DebugDraw_GetStats(DebugDrawStats_t* stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DEBUGDRAW_H */
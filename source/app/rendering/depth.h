@@ -0,0 +1,49 @@
+/**
+ * @file depth.h
+ * @brief Depth Buffer Encodings Shared By The Device And Rasterizer
+ *
+ * Normalized depth z in [0,1] (0 = near plane, smaller wins) is stored
+ * as one of the DEPTH_FORMAT_* encodings from engine_config.h. Integer
+ * formats clear to all ones, so a memset(0xFF) of any of them is the
+ * far plane.
+ */
+
+#ifndef DEPTH_H
+#define DEPTH_H
+
+#include <stdint.h>
+#include "engine_config.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define DEPTH_Z24_MAX           0x00FFFFFFu
+
+/* Bytes per pixel of a depth format */
+static inline int Depth_FormatBytes(int format)
+{
+    return (format == DEPTH_FORMAT_UNORM16) ? 2 : 4;
+}
+
+/* Map normalized depth [0,1] to the 16-bit depth buffer range */
+static inline uint16_t Depth_ToZ16(float z)
+{
+    if (z <= 0.0f) return 0;
+    if (z >= 1.0f) return 0xFFFF;
+    return (uint16_t)(z * 65535.0f);
+}
+
+/* 24-bit fixed point in the low bits of a uint32 */
+static inline uint32_t Depth_ToZ24(float z)
+{
+    if (z <= 0.0f) return 0;
+    if (z >= 1.0f) return DEPTH_Z24_MAX;
+    return (uint32_t)(z * (float)DEPTH_Z24_MAX);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DEPTH_H */
@@ -1,62 +1,210 @@
 #include "device.h"
+#include "clear.h"
+#include "framedump.h"
 #include <float.h>
+#include <string.h>
 
-Device::Device(SDL_Surface* _screen)
-    :screen(_screen), renderWidth(screen->w), renderHeight(screen->h)
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define DEVICE_SSE 1
+#include <emmintrin.h>
+#endif
+
+static inline uint16_t ColorTo565(const Color& c)
+{
+    return (uint16_t)RGB565(c.r, c.g, c.b);
+}
+
+Device::Device(SDL_Surface* _screen, int _depthFormat)
+    :screen(_screen), depthFormat(_depthFormat), renderWidth(screen->w), renderHeight(screen->h)
 {
-    depthBuffer = new float[renderWidth * renderHeight];
+    // 32-bit words keep float and 24-bit rows aligned; 16-bit packs two per word
+    int bytes = renderWidth * renderHeight * Depth_FormatBytes(depthFormat);
+    depthBuffer = new Uint32[(bytes + 3) / 4];
+    colorBuffer = new uint16_t[renderWidth * renderHeight];
+
+    // Resolve the surface format once; assumes 8 bits per channel like the rest of Device
+    rShift = screen->format->Rshift;
+    gShift = screen->format->Gshift;
+    bShift = screen->format->Bshift;
+    rgb565Table = new Uint32[65536];
+    for (Uint32 c = 0; c < 65536; ++c)
+    {
+        Uint8 r = (Uint8)(((c >> 11) & 0x1F) << 3);
+        Uint8 g = (Uint8)(((c >> 5) & 0x3F) << 2);
+        Uint8 b = (Uint8)((c & 0x1F) << 3);
+        rgb565Table[c] = SDL_MapRGBA(screen->format, r, g, b, 255);
+    }
 }
 
 Device::~Device()
 {
     if (depthBuffer)
     {
-        delete[] depthBuffer;
+        delete[] (Uint32*)depthBuffer;
+    }
+    delete[] colorBuffer;
+    delete[] rgb565Table;
+}
+
+bool Device::Lock()
+{
+    return colorBuffer != NULL;
+}
+
+void Device::Unlock()
+{
+    Present();
+}
+
+// RGB565 to the surface format. With SSE2, eight pixels per step: the
+// channels are widened to 32-bit lanes, expanded to 8 bits and shifted
+// into place, as the table would map them.
+void Device::Present()
+{
+    if (SDL_MUSTLOCK(screen) && SDL_LockSurface(screen) != 0)
+    {
+        return;
+    }
+
+#ifdef DEVICE_SSE
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i alpha = _mm_set1_epi32((int)rgb565Table[0]);
+    const __m128i rMask = _mm_set1_epi32(0xF8), gMask = _mm_set1_epi32(0xFC);
+    const __m128i rCount = _mm_cvtsi32_si128(rShift);
+    const __m128i gCount = _mm_cvtsi32_si128(gShift);
+    const __m128i bCount = _mm_cvtsi32_si128(bShift);
+#endif
+    for (int y = 0; y < renderHeight; ++y)
+    {
+        const uint16_t* src = ColorRow(y);
+        Uint32* dst = (Uint32*)((Uint8*)screen->pixels + y * screen->pitch);
+        int x = 0;
+#ifdef DEVICE_SSE
+        for (; x + 8 <= renderWidth; x += 8)
+        {
+            __m128i c16 = _mm_loadu_si128((const __m128i*)(src + x));
+            __m128i halves[2] = { _mm_unpacklo_epi16(c16, zero), _mm_unpackhi_epi16(c16, zero) };
+            for (int h = 0; h < 2; ++h)
+            {
+                __m128i c = halves[h];
+                __m128i r = _mm_and_si128(_mm_srli_epi32(c, 8), rMask);
+                __m128i g = _mm_and_si128(_mm_srli_epi32(c, 3), gMask);
+                __m128i b = _mm_and_si128(_mm_slli_epi32(c, 3), rMask);
+                __m128i p = _mm_or_si128(_mm_or_si128(_mm_sll_epi32(r, rCount), _mm_sll_epi32(g, gCount)),
+                    _mm_or_si128(_mm_sll_epi32(b, bCount), alpha));
+                _mm_storeu_si128((__m128i*)(dst + x + h * 4), p);
+            }
+        }
+#endif
+        for (; x < renderWidth; ++x)
+        {
+            dst[x] = rgb565Table[src[x]];
+        }
+    }
+
+    if (SDL_MUSTLOCK(screen))
+    {
+        SDL_UnlockSurface(screen);
     }
 }
 
 // Clears the screen buffer to the given color
 void Device::Clear(Color color)
 {
-    Uint32* pixels = (Uint32 *)screen->pixels;
-    Uint32 screenColor = SDL_MapRGBA(screen->format, color.r, color.g, color.b, color.a);
+    ClearColor(color);
+    ClearDepth();
+}
+
+void Device::ClearColor(Color color)
+{
+    Clear_Fill16(colorBuffer, ColorTo565(color), renderWidth * renderHeight);
+}
 
-    for (int i = 0; i < renderWidth * renderHeight; ++i)
+void Device::ClearDepth()
+{
+    int count = renderWidth * renderHeight;
+    if (depthFormat == DEPTH_FORMAT_FLOAT32)
     {
-        pixels[i] = screenColor;
-        depthBuffer[i] = 0.0f;
+        float farDepth = FLT_MAX;
+        Uint32 bits;
+        memcpy(&bits, &farDepth, sizeof(bits));
+        Clear_Fill32((Uint32*)depthBuffer, bits, count);
+        return;
+    }
+
+    // All ones is the far plane of both integer formats
+    Clear_Fill32((Uint32*)depthBuffer, 0xFFFFFFFF, (count * Depth_FormatBytes(depthFormat) + 3) / 4);
+}
+
+void Device::ClearRect(Color color, int x, int y, int w, int h)
+{
+    if (x < 0) { w += x; x = 0; }
+    if (y < 0) { h += y; y = 0; }
+    if (x + w > renderWidth) w = renderWidth - x;
+    if (y + h > renderHeight) h = renderHeight - y;
+    if (w <= 0 || h <= 0) return;
+
+    uint16_t color565 = ColorTo565(color);
+    float farDepth = FLT_MAX;
+    Uint32 farBits;
+    memcpy(&farBits, &farDepth, sizeof(farBits));
+    for (int row = y; row < y + h; ++row)
+    {
+        Clear_Fill16(ColorRow(row) + x, color565, w);
+        if (depthFormat == DEPTH_FORMAT_UNORM16)
+            Clear_Fill16((uint16_t*)DepthRow(row) + x, 0xFFFF, w);
+        else
+            Clear_Fill32((Uint32*)DepthRow(row) + x, (depthFormat == DEPTH_FORMAT_FLOAT32) ? farBits : 0xFFFFFFFF, w);
     }
 }
 
 Color Device::GetPixel(int x, int y)
 {
-	Uint32 index = x + y * renderWidth;
-	Uint32* pixels = (Uint32 *)screen->pixels;
-	Color ret;
-	SDL_GetRGBA(pixels[index], screen->format, &(ret.r), &(ret.g), &(ret.b), &(ret.a));
-	return ret;
+	uint16_t c = colorBuffer[x + y * renderWidth];
+	return Color((Uint8)(((c >> 11) & 0x1F) << 3), (Uint8)(((c >> 5) & 0x3F) << 2), (Uint8)((c & 0x1F) << 3));
 }
 
 // Draws a pixel to the screen ignoring the depthbuffer
 void Device::PutPixel(int x, int y, Color c)
 {
-    Uint32* pixels = (Uint32 *)screen->pixels;
-    Uint32 index = x + y * renderWidth;
-    pixels[index] = SDL_MapRGBA(screen->format, c.r, c.g, c.b, c.a);
+    colorBuffer[x + y * renderWidth] = ColorTo565(c);
 }
 
 // Draws a pixel to the screen only if it passes our depth buffer test
 void Device::PutPixel(int x, int y, float z, Color c)
 {
-    Uint32* pixels = (Uint32 *)screen->pixels;
     Uint32 index = x + y * renderWidth;
-    if (z <= depthBuffer[index])  
+    if (depthFormat == DEPTH_FORMAT_UNORM16)
     {
-        return;
+        uint16_t* depth = (uint16_t*)depthBuffer;
+        uint16_t z16 = Depth_ToZ16(z);
+        if (z16 >= depth[index])
+        {
+            return;
+        }
+        depth[index] = z16;
+    }
+    else if (depthFormat == DEPTH_FORMAT_FIXED24)
+    {
+        uint32_t* depth = (uint32_t*)depthBuffer;
+        uint32_t z24 = Depth_ToZ24(z);
+        if (z24 >= depth[index])
+        {
+            return;
+        }
+        depth[index] = z24;
+    }
+    else
+    {
+        float* depth = (float*)depthBuffer;
+        if (z >= depth[index])
+        {
+            return;
+        }
+        depth[index] = z;
     }
 
-    depthBuffer[index] = z;
-    pixels[index] = SDL_MapRGBA(screen->format, c.r, c.g, c.b, c.a);
+    colorBuffer[index] = ColorTo565(c);
 }
 
 // Draws a point to the screen if it is within the viewport
@@ -79,131 +227,7 @@ void Device::DrawPoint(int x, int y, const Color& c)
 }
 
 
-void WriteHexString(SDL_RWops* file, char *s)
-{
-    Uint32 value;
-    char hex[3];
-
-    for (int i = 0; i < SDL_strlen(s); i += 2) {
-        hex[0] = s[i];
-        hex[1] = s[i + 1];
-        hex[2] = '\0';
-        SDL_sscanf(hex, "%X", &value);
-        SDL_WriteU8(file, value);
-    }
-}
-
 void Device::WriteToFile(const char* filename)
 {
-    SDL_RWops* file = SDL_RWFromFile(filename, "w+b");
-    if (file)
-    {
-        // Writing out a tiff (Code taken from http://paulbourke.net/dataformats/tiff/) switch with a lib later
-        Uint32 numbytes = renderWidth * renderHeight * 3;
-
-        // Header of the file
-        SDL_RWwrite(file, "MM", 2, 1);
-        SDL_WriteBE16(file, 42);
-        Uint32 offset = numbytes + 8; // 8 bytes are from the header including this offset
-        SDL_WriteBE32(file, offset);
-
-        // Then the actual data
-        Uint32* pixels = (Uint32 *)screen->pixels;
-
-        // to avoid a bunch of file io and hopefully speed up the function we're gonna buffer pixel writes and do them at once
-        Uint8* buffer = new Uint8[numbytes];
-        Uint32 bufferOffset = 0;
-
-        for (int y = 0; y < renderHeight; ++y)
-        {
-            for (int x = 0; x < renderWidth; ++x)
-            {
-                Uint32 pixelIndex = x + y * renderWidth;
-
-                Uint32 pixel = pixels[pixelIndex];
-                Color color = Color(pixel);
-
-                buffer[bufferOffset++] = color.r;
-                buffer[bufferOffset++] = color.g;
-                buffer[bufferOffset++] = color.b;
-            }
-        }
-
-        SDL_RWwrite(file, buffer, numbytes, 1);
-        delete buffer;
-
-        // Finally the IFD
-        // The number of directory entries
-        SDL_WriteBE16(file, 14);  
-
-        /* Width tag, short int */
-        WriteHexString(file, "0100000300000001");
-        SDL_WriteBE16(file, renderWidth);
-        WriteHexString(file, "0000");
-
-        /* Height tag, short int */
-        WriteHexString(file, "0101000300000001");
-        SDL_WriteBE16(file, renderHeight);
-        WriteHexString(file, "0000");
-
-        /* Bits per sample tag, short int */
-        WriteHexString(file, "0102000300000003");
-        SDL_WriteBE32(file, numbytes + 182);
-
-        /* Compression flag, short int */
-        WriteHexString(file, "010300030000000100010000");
-
-        /* Photometric interpolation tag, short int */
-        WriteHexString(file, "010600030000000100020000");
-
-        /* Strip offset tag, long int */
-        WriteHexString(file, "011100040000000100000008");
-
-        /* Orientation flag, short int */
-        WriteHexString(file, "011200030000000100010000");
-
-        /* Sample per pixel tag, short int */
-        WriteHexString(file, "011500030000000100030000");
-
-        /* Rows per strip tag, short int */
-        WriteHexString(file, "0116000300000001");
-        SDL_WriteBE16(file, renderHeight);
-        WriteHexString(file, "0000");
-
-        /* Strip byte count flag, long int */
-        WriteHexString(file, "0117000400000001");
-        SDL_WriteBE32(file, numbytes);
-
-        /* Minimum sample value flag, short int */
-        WriteHexString(file, "0118000300000003");
-        SDL_WriteBE32(file, numbytes + 188);
-
-        /* Maximum sample value tag, short int */
-        WriteHexString(file, "0119000300000003");
-        SDL_WriteBE32(file, numbytes + 194);
-
-        /* Planar configuration tag, short int */
-        WriteHexString(file, "011c00030000000100010000");
-
-        /* Sample format tag, short int */
-        WriteHexString(file, "0153000300000003");
-        SDL_WriteBE32(file, numbytes + 200);
-
-        /* End of the directory entry */
-        WriteHexString(file, "00000000");
-
-        /* Bits for each colour channel */
-        WriteHexString(file, "000800080008");
-
-        /* Minimum value for each component */
-        WriteHexString(file, "000000000000");
-
-        /* Maximum value per channel */
-        WriteHexString(file, "00ff00ff00ff");
-
-        /* Samples per pixel for each channel */
-        WriteHexString(file, "000100010001");
-
-        SDL_RWclose(file);
-    }
+    FrameDump_WriteImage(this, filename, FRAMEDUMP_TIFF);
 }
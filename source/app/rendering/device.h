@@ -3,15 +3,18 @@
 
 #include <SDL/SDL.h>
 #include "color.h"
+#include "depth.h"
 
 class Device
 {
 public:
-    Device(SDL_Surface* _screen);
+    // depthFormat is one of the DEPTH_FORMAT_* encodings from engine_config.h
+    Device(SDL_Surface* _screen, int _depthFormat = DEVICE_DEPTH_FORMAT);
     ~Device();
 
-    // Clears the screen buffer to the given color
+    // Clears the screen buffer to the given color, and the depth buffer
     void Clear(Color color);
+    void ClearColor(Color color);
 
 	// Grabs the color from the screen at the given coordinates
 	Color GetPixel(int x, int y);
@@ -19,7 +22,8 @@ public:
     // Puts a pixel on the screen ignoring the depthbuffer and clip checks
     void PutPixel(int x, int y, Color c = Color(0xFFFFFF));
 
-    // Puts a pixel on the screen only if it passes our depth buffer test and ignoring clipping
+    // Puts a pixel on the screen only if it passes our depth buffer test and ignoring clipping.
+    // z is normalized depth [0,1], encoded in the device depth format.
     void PutPixel(int x, int y, float z, Color c = Color(0xFFFFFF));
 
     // Draws a point on the screen if it's within the viewport, taking into account depth
@@ -27,24 +31,46 @@ public:
 
     // Draws a point on the screen if it's within the viewport, ignoring depth
     void DrawPoint(int x, int y, const Color& c);
-    void ClearDepth()
-    {
-        for (int i = 0; i < renderWidth * renderHeight; ++i)
-        {
-            depthBuffer[i] = 0.0f;  
-        }
-    }
+    void ClearDepth();
+    // Color and depth of a rectangle, clipped to the screen
+    void ClearRect(Color color, int x, int y, int w, int h);
 
     int Width(){ return renderWidth; }
     int Height(){ return renderHeight; }
 
+    // Frames render into an RGB565 buffer laid out like the board's
+    // framebuffer, so both produce the same pixels. Lock() and Unlock()
+    // bracket a frame; Unlock() presents it, converting the whole buffer
+    // to the surface in one pass. The conversion stays on the CPU because
+    // a Device only has the SDL_Surface it was given (the window surface,
+    // or an offscreen one for the bench); an SDL2 streaming RGB565 texture
+    // would need an SDL_Renderer the callers do not create.
+    bool Lock();
+    void Unlock();
+    uint16_t* ColorRow(int y) { return colorBuffer + y * renderWidth; }
+    // Depth rows are DepthFormat() encoded: uint16_t, uint32_t (24-bit) or float
+    void* DepthRow(int y) { return (Uint8*)depthBuffer + y * renderWidth * Depth_FormatBytes(depthFormat); }
+    int DepthFormat() const { return depthFormat; }
+    int ColorPitch() const { return renderWidth; }    // In pixels
+
+    // Surface pixel of an RGB565 color
+    Uint32 FromRGB565(uint16_t c) const { return rgb565Table[c]; }
+
+    // Uncompressed RGB TIFF of the screen; see framedump.h for PPM and
+    // for sequences written off the render thread
     void WriteToFile(const char* filename);
 
 private:
+    void Present();
+
     SDL_Surface* screen;
-    float* depthBuffer;
+    uint16_t* colorBuffer;
+    void* depthBuffer;
+    int depthFormat;
     int renderWidth;
     int renderHeight;
+    Uint32* rgb565Table;
+    Uint8 rShift, gShift, bShift;
 };
 
 #endif
\ No newline at end of file
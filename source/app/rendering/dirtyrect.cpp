@@ -0,0 +1,312 @@
+/**
+ * @file dirtyrect.cpp
+ * @brief Dirty-Rectangle Tracking Implementation
+ */
+
+#include "dirtyrect.h"
+#include "mesh.h"
+#include "shadow.h"
+#include <string.h>
+
+/* Last frame's view of one draw */
+typedef struct {
+    Mat4 world;
+    EntityID entity;
+    uint32_t mesh_id;
+    uint32_t material_id;
+    uint16_t anim_frame_a;
+    uint16_t anim_frame_b;
+    float anim_lerp;
+    uint32_t flags;
+    uint32_t lod;
+    RasterRect_t rect;          /* Screen bounds, w = 0 when off screen */
+    uint8_t matched;
+} DrawRecord_t;
+
+typedef struct {
+    RasterRect_t rects[DIRTY_MAX_RECTS];
+    uint32_t count;
+} RectSet_t;
+
+static DrawRecord_t g_records[SCENE_MAX_DRAWS];
+static uint32_t g_record_count = 0;
+static Mat4 g_view_proj;
+static SceneLight_t g_lights[MAX_LIGHTS];
+static uint32_t g_light_count = 0;
+static RectSet_t g_history[DIRTY_MAX_AGE];  /* [0] = previous frame's changes */
+static uint32_t g_age = 1;
+static uint32_t g_full_frames = 0;          /* Full frames still owed */
+static int g_enabled = 0;
+static DirtyRectStats_t g_dirty_stats;
+
+/* ============================================================
+ * Rectangles
+ * ============================================================ */
+
+static inline int Area(const RasterRect_t* r)
+{
+    return r->w * r->h;
+}
+
+static RasterRect_t Union(const RasterRect_t* a, const RasterRect_t* b)
+{
+    RasterRect_t u;
+    u.x = MIN(a->x, b->x);
+    u.y = MIN(a->y, b->y);
+    u.w = MAX(a->x + a->w, b->x + b->w) - u.x;
+    u.h = MAX(a->y + a->h, b->y + b->h) - u.y;
+    return u;
+}
+
+static inline int Overlaps(const RasterRect_t* a, const RasterRect_t* b)
+{
+    return a->x < b->x + b->w && b->x < a->x + a->w && a->y < b->y + b->h && b->y < a->y + a->h;
+}
+
+/* Adds r, merging until no two rectangles overlap. A merge that covers
+ * no more than the two parts is free; a full set takes the merge that
+ * grows least. */
+static void AddRect(RectSet_t* set, RasterRect_t r)
+{
+    if (r.w <= 0 || r.h <= 0) return;
+
+    for (;;) {
+        int merged = 0;
+        for (uint32_t i = 0; i < set->count; i++) {
+            RasterRect_t u = Union(&r, &set->rects[i]);
+            if (Overlaps(&r, &set->rects[i]) || Area(&u) <= Area(&r) + Area(&set->rects[i])) {
+                r = u;
+                set->rects[i] = set->rects[--set->count];
+                merged = 1;
+                break;
+            }
+        }
+        if (merged) continue;
+        if (set->count < DIRTY_MAX_RECTS) break;
+
+        uint32_t best = 0;
+        int best_growth = 0x7FFFFFFF;
+        for (uint32_t i = 0; i < set->count; i++) {
+            RasterRect_t u = Union(&r, &set->rects[i]);
+            int growth = Area(&u) - Area(&r) - Area(&set->rects[i]);
+            if (growth < best_growth) {
+                best_growth = growth;
+                best = i;
+            }
+        }
+        r = Union(&r, &set->rects[best]);
+        set->rects[best] = set->rects[--set->count];
+    }
+    set->rects[set->count++] = r;
+}
+
+/* ============================================================
+ * Projection
+ * ============================================================ */
+
+static RasterRect_t FullScreen(void)
+{
+    RasterRect_t r;
+    r.x = 0;
+    r.y = 0;
+    Rasterizer_GetResolution(&r.w, &r.h);
+    return r;
+}
+
+/* Screen bounds of a draw's mesh sphere, through the corners of the
+ * enclosing object-space box, padded out to whole raster blocks. The
+ * whole screen if the box reaches behind the eye or has no bounds.
+ * Casters take in their shadow's box as well, flattened by shadow. */
+static RasterRect_t DrawBounds(const DrawCmd_t* cmd, const Mat4* view_proj, const Mat4* shadow)
+{
+    RasterRect_t r = FullScreen();
+    int width = r.w, height = r.h;
+
+    const MeshSlot_t* m = Mesh_Get(cmd->mesh_id);
+    if (!m) return r;
+    Vec3 c = (m->type == 2) ? m->anim.bounds_center : m->stat.bounds_center;
+    float radius = (m->type == 2) ? m->anim.bounds_radius : m->stat.bounds_radius;
+    if (radius <= 0.0f) return r;
+
+    Mat4 mvp[2];
+    int boxes = (shadow && (cmd->flags & DRAW_FLAG_CAST_SHADOW)) ? 2 : 1;
+    Mat4_Multiply(&mvp[0], view_proj, &cmd->world);
+    if (boxes == 2) {
+        Mat4 flat;
+        Mat4_Multiply(&flat, shadow, &cmd->world);
+        Mat4_Multiply(&mvp[1], view_proj, &flat);
+    }
+
+    float min_x = 1e30f, min_y = 1e30f, max_x = -1e30f, max_y = -1e30f;
+    for (int i = 0; i < 8 * boxes; i++) {
+        Vec4 p = Vec4_Create(c.x + ((i & 1) ? radius : -radius), c.y + ((i & 2) ? radius : -radius),
+            c.z + ((i & 4) ? radius : -radius), 1.0f);
+        Vec4 q = Mat4_MultiplyVec4(&mvp[i >> 3], p);
+        if (q.w <= 1e-4f) return r;
+        float inv_w = 1.0f / q.w;
+        float sx = (q.x * inv_w * 0.5f + 0.5f) * width;
+        float sy = (1.0f - (q.y * inv_w * 0.5f + 0.5f)) * height;
+        min_x = MIN(min_x, sx);
+        max_x = MAX(max_x, sx);
+        min_y = MIN(min_y, sy);
+        max_y = MAX(max_y, sy);
+    }
+
+    /* One pixel of slack for sub-pixel snapping, then block aligned */
+    int x0 = (int)Clampf(min_x - 1.0f, 0.0f, (float)width);
+    int y0 = (int)Clampf(min_y - 1.0f, 0.0f, (float)height);
+    int x1 = (int)Clampf(max_x + 2.0f, 0.0f, (float)width);
+    int y1 = (int)Clampf(max_y + 2.0f, 0.0f, (float)height);
+    x0 &= ~(RASTER_BLOCK - 1);
+    y0 &= ~(RASTER_BLOCK - 1);
+    x1 = MIN((x1 + RASTER_BLOCK - 1) & ~(RASTER_BLOCK - 1), width);
+    y1 = MIN((y1 + RASTER_BLOCK - 1) & ~(RASTER_BLOCK - 1), height);
+
+    r.x = x0;
+    r.y = y0;
+    r.w = (x1 > x0 && y1 > y0) ? x1 - x0 : 0;
+    r.h = (x1 > x0 && y1 > y0) ? y1 - y0 : 0;
+    return r;
+}
+
+static int SameDraw(const DrawRecord_t* rec, const DrawCmd_t* cmd)
+{
+    return rec->mesh_id == cmd->mesh_id && rec->material_id == cmd->material_id &&
+        rec->flags == cmd->flags && rec->lod == cmd->lod && rec->anim_frame_a == cmd->anim_frame_a &&
+        rec->anim_frame_b == cmd->anim_frame_b && rec->anim_lerp == cmd->anim_lerp &&
+        memcmp(&rec->world, &cmd->world, sizeof(Mat4)) == 0;
+}
+
+/* Lists come out of the spatial query in a stable order: try the same
+ * position first */
+static DrawRecord_t* FindRecord(EntityID entity, uint32_t hint)
+{
+    if (hint < g_record_count && g_records[hint].entity == entity) return &g_records[hint];
+    for (uint32_t i = 0; i < g_record_count; i++) {
+        if (g_records[i].entity == entity) return &g_records[i];
+    }
+    return NULL;
+}
+
+/* ============================================================
+ * Frame Tracking
+ * ============================================================ */
+
+void DirtyRect_Init(uint32_t buffer_age)
+{
+    g_age = CLAMP(buffer_age, 1u, (uint32_t)DIRTY_MAX_AGE);
+    g_record_count = 0;
+    g_enabled = 0;
+    memset(g_history, 0, sizeof(g_history));
+    memset(&g_dirty_stats, 0, sizeof(g_dirty_stats));
+    DirtyRect_Invalidate();
+}
+
+void DirtyRect_SetEnabled(int enabled)
+{
+    g_enabled = enabled ? 1 : 0;
+    DirtyRect_Invalidate();
+}
+
+int DirtyRect_IsEnabled(void)
+{
+    return g_enabled;
+}
+
+void DirtyRect_Invalidate(void)
+{
+    g_full_frames = g_age;
+}
+
+uint32_t DirtyRect_Update(const DrawList_t* list, RasterRect_t* rects, uint32_t max)
+{
+    RectSet_t changed;
+    changed.count = 0;
+    int full = g_full_frames > 0 || memcmp(&g_view_proj, &list->view_proj, sizeof(Mat4)) != 0 ||
+        g_light_count != list->light_count ||
+        memcmp(g_lights, list->lights, list->light_count * sizeof(SceneLight_t)) != 0;
+
+    Mat4 shadow_matrix;
+    const Mat4* shadow = Shadow_GetMatrix(list, &shadow_matrix) ? &shadow_matrix : NULL;
+
+    /* Old and new bounds of every draw that differs from last frame */
+    for (uint32_t i = 0; i < g_record_count; i++) g_records[i].matched = 0;
+    static DrawRecord_t next[SCENE_MAX_DRAWS];
+    for (uint32_t i = 0; i < list->count; i++) {
+        const DrawCmd_t* cmd = &list->cmds[i];
+        DrawRecord_t* old = FindRecord(cmd->entity, i);
+        DrawRecord_t* rec = &next[i];
+        if (old) old->matched = 1;
+
+        if (old && SameDraw(old, cmd)) {
+            *rec = *old;
+            if (full) rec->rect = DrawBounds(cmd, &list->view_proj, shadow);
+            continue;
+        }
+
+        rec->world = cmd->world;
+        rec->entity = cmd->entity;
+        rec->mesh_id = cmd->mesh_id;
+        rec->material_id = cmd->material_id;
+        rec->anim_frame_a = cmd->anim_frame_a;
+        rec->anim_frame_b = cmd->anim_frame_b;
+        rec->anim_lerp = cmd->anim_lerp;
+        rec->flags = cmd->flags;
+        rec->lod = cmd->lod;
+        rec->rect = DrawBounds(cmd, &list->view_proj, shadow);
+        if (!full) {
+            if (old) AddRect(&changed, old->rect);
+            AddRect(&changed, rec->rect);
+        }
+    }
+    for (uint32_t i = 0; i < g_record_count && !full; i++) {
+        if (!g_records[i].matched) AddRect(&changed, g_records[i].rect);
+    }
+    memcpy(g_records, next, list->count * sizeof(DrawRecord_t));
+    g_record_count = list->count;
+    g_view_proj = list->view_proj;
+    g_light_count = list->light_count;
+    memcpy(g_lights, list->lights, list->light_count * sizeof(SceneLight_t));
+
+    /* This buffer last saw the scene g_age frames ago */
+    RectSet_t redraw = changed;
+    for (uint32_t a = 0; a + 1 < g_age; a++) {
+        for (uint32_t i = 0; i < g_history[a].count; i++) AddRect(&redraw, g_history[a].rects[i]);
+    }
+    for (uint32_t a = DIRTY_MAX_AGE - 1; a > 0; a--) g_history[a] = g_history[a - 1];
+    g_history[0] = changed;
+
+    RasterRect_t screen = FullScreen();
+    uint32_t pixels = 0;
+    for (uint32_t i = 0; i < redraw.count; i++) pixels += (uint32_t)Area(&redraw.rects[i]);
+    if (!full && (float)pixels > DIRTY_FULL_FRACTION * (float)Area(&screen)) full = 1;
+
+    if (full) {
+        /* The buffers between still have to catch up with it */
+        g_history[0].count = 1;
+        g_history[0].rects[0] = screen;
+        if (g_full_frames) g_full_frames--;
+        redraw.count = 1;
+        redraw.rects[0] = screen;
+        pixels = (uint32_t)Area(&screen);
+        g_dirty_stats.full_frames++;
+    }
+
+    uint32_t count = MIN(redraw.count, max);
+    memcpy(rects, redraw.rects, count * sizeof(RasterRect_t));
+    if (count && count < redraw.count) {
+        /* Caller holds fewer: fold the rest into the last one */
+        for (uint32_t i = count; i < redraw.count; i++) rects[count - 1] = Union(&rects[count - 1], &redraw.rects[i]);
+    }
+
+    g_dirty_stats.frames++;
+    if (count == 0) g_dirty_stats.idle_frames++;
+    g_dirty_stats.rects_last = count;
+    g_dirty_stats.pixels_last = pixels;
+    return count;
+}
+
+void DirtyRect_GetStats(DirtyRectStats_t* stats)
+{
+    *stats = g_dirty_stats;
+}
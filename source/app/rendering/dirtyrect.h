@@ -0,0 +1,69 @@
+/**
+ * @file dirtyrect.h
+ * @brief Dirty-Rectangle Tracking For Partial Redraws Of Static Scenes
+ *
+ * Compares each draw list with the previous one: a draw whose entity,
+ * mesh, material, world matrix, detail level or MD2 pose changed,
+ * appeared or went away marks the screen bounds of its mesh sphere,
+ * before and after. These are padded to RASTER_BLOCK, merged until no
+ * two overlap and handed to Rasterizer_SetScissorRects(); everything
+ * else on screen is last frame's pixels. Transform_t.dirty is consumed
+ * before the list is built, and the demo sets rotations every frame
+ * whether they moved or not, so the world matrix itself is the change
+ * test; the animator shows up through the pose it writes into the mesh
+ * renderer. A shadow caster's bounds include its flattened shadow.
+ *
+ * A buffer drawn into again is buffer_age frames old: 1 for the SDL
+ * surface, SWAPCHAIN_BUFFERS on the board, so there the rectangles of
+ * the frames in between are redrawn too. A camera or light change, a
+ * region above DIRTY_FULL_FRACTION of the screen or
+ * DirtyRect_Invalidate() make it a full frame.
+ */
+
+#ifndef DIRTYRECT_H
+#define DIRTYRECT_H
+
+#include <stdint.h>
+#include "engine_config.h"
+#include "rasterizer.h"
+#include "scenebuffer.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define DIRTY_MAX_RECTS         4       /* Passes per frame, <= RASTER_MAX_SCISSOR_RECTS */
+#define DIRTY_MAX_AGE           3       /* Deepest swap chain supported */
+#define DIRTY_FULL_FRACTION     0.5f    /* Screen share above which a full frame is cheaper */
+
+typedef struct {
+    uint32_t frames;
+    uint32_t full_frames;
+    uint32_t idle_frames;       /* Nothing to redraw */
+    uint32_t rects_last;
+    uint32_t pixels_last;       /* Redrawn by the last frame */
+} DirtyRectStats_t;
+
+/* buffer_age: frames between two draws into the same buffer */
+void DirtyRect_Init(uint32_t buffer_age);
+
+/* Enabling starts with full frames until every buffer is redrawn */
+void DirtyRect_SetEnabled(int enabled);
+int DirtyRect_IsEnabled(void);
+
+/* Next frames are full: something outside the draw list changed, such
+ * as a texture, a render state or an overlay drawn over the scene */
+void DirtyRect_Invalidate(void);
+
+/* Regions of this frame's list to redraw, at most max (one covering the
+ * screen for a full frame); 0 = the buffer is already up to date. Call
+ * once per drawn list. */
+uint32_t DirtyRect_Update(const DrawList_t* list, RasterRect_t* rects, uint32_t max);
+
+void DirtyRect_GetStats(DirtyRectStats_t* stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DIRTYRECT_H */
@@ -0,0 +1,96 @@
+/**
+ * @file dynres.cpp
+ * @brief Dynamic Resolution Scaling Implementation
+ */
+
+#include "dynres.h"
+#include "rasterizer.h"
+#include <math.h>
+#include <string.h>
+
+#define SMOOTHING       0.25f   /* Weight of the newest frame */
+
+static float g_min_scale = 0.5f;
+static float g_max_scale = 1.0f;
+static int g_enabled = 0;
+static float g_frame_avg = 0.0f;    /* Ticks */
+static float g_raster_avg = 0.0f;
+static uint32_t g_settle = 0;       /* Frames since the last change */
+static DynResStats_t g_dynres_stats;
+
+/* The averages were measured at the old size: carry them over to the
+ * new pixel count so the next frame does not correct twice */
+static void Apply(float scale)
+{
+    float old = g_dynres_stats.scale;
+    if (old > 0.0f) {
+        float ratio = (scale * scale) / (old * old);
+        g_frame_avg -= g_raster_avg * (1.0f - ratio);
+        g_raster_avg *= ratio;
+    }
+    g_dynres_stats.scale = scale;
+    Rasterizer_SetResolution((int)(DISPLAY_WIDTH * scale + 0.5f), (int)(DISPLAY_HEIGHT * scale + 0.5f));
+    Rasterizer_GetResolution(&g_dynres_stats.width, &g_dynres_stats.height);
+    g_settle = 0;
+}
+
+void DynRes_Init(float min_scale, float max_scale)
+{
+    memset(&g_dynres_stats, 0, sizeof(g_dynres_stats));
+    g_max_scale = CLAMP(max_scale, 0.1f, 1.0f);
+    g_min_scale = CLAMP(min_scale, 0.1f, g_max_scale);
+    g_enabled = 0;
+    g_frame_avg = 0.0f;
+    g_raster_avg = 0.0f;
+    Apply(g_max_scale);
+}
+
+void DynRes_SetEnabled(int enabled)
+{
+    g_enabled = enabled ? 1 : 0;
+    g_frame_avg = 0.0f;
+    g_raster_avg = 0.0f;
+    if (!g_enabled) Apply(g_max_scale);
+}
+
+int DynRes_IsEnabled(void)
+{
+    return g_enabled;
+}
+
+void DynRes_Update(uint64_t budget, uint64_t frame_ticks, uint64_t raster_ticks)
+{
+    if (!g_enabled || budget == 0) return;
+    g_settle++;
+
+    if (g_frame_avg == 0.0f) {
+        g_frame_avg = (float)frame_ticks;
+        g_raster_avg = (float)raster_ticks;
+    }
+    else {
+        g_frame_avg += ((float)frame_ticks - g_frame_avg) * SMOOTHING;
+        g_raster_avg += ((float)raster_ticks - g_raster_avg) * SMOOTHING;
+    }
+    if (g_raster_avg <= 0.0f) return;
+
+    /* What is left of the budget for raster after the fixed part */
+    float scale = g_dynres_stats.scale;
+    float fixed = MAX(g_frame_avg - g_raster_avg, 0.0f);
+    float raster_budget = (float)budget * DYNRES_HEADROOM - fixed;
+    float desired = (raster_budget > 0.0f) ? scale * sqrtf(raster_budget / g_raster_avg) : g_min_scale;
+    desired = CLAMP(desired, g_min_scale, g_max_scale);
+
+    if (desired < scale - DYNRES_DEADBAND) {
+        g_dynres_stats.drops++;
+        Apply(desired);
+    }
+    else if (desired > scale + DYNRES_DEADBAND && g_settle >= DYNRES_SETTLE_FRAMES) {
+        g_dynres_stats.raises++;
+        Apply(MIN(desired, scale + DYNRES_MAX_RAISE));
+    }
+}
+
+void DynRes_GetStats(DynResStats_t* stats)
+{
+    *stats = g_dynres_stats;
+}
@@ -0,0 +1,56 @@
+/**
+ * @file dynres.h
+ * @brief Dynamic Resolution Scaling Against A Frame-Time Budget
+ *
+ * Picks the render resolution (Rasterizer_SetResolution) each frame so
+ * the frame fits its budget. A frame is modelled as a fixed part plus
+ * raster work proportional to the pixel count, both smoothed over a few
+ * frames: the scale for a budget is then the current one times
+ * sqrt(raster share of the budget / raster time). Going down happens at
+ * once when over budget; going up waits DYNRES_SETTLE_FRAMES after the
+ * last change and moves at most DYNRES_MAX_RAISE, so a scene near the
+ * budget does not flicker between two sizes. The rendered region is
+ * stretched to the display by Rasterizer_Upscale().
+ */
+
+#ifndef DYNRES_H
+#define DYNRES_H
+
+#include <stdint.h>
+#include "engine_config.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define DYNRES_HEADROOM         0.9f    /* Share of the budget aimed for */
+#define DYNRES_SETTLE_FRAMES    30      /* Frames after a change before raising again */
+#define DYNRES_MAX_RAISE        0.1f    /* Largest single step up in scale */
+#define DYNRES_DEADBAND         0.03f   /* Ignore desired changes smaller than this */
+
+typedef struct {
+    float scale;                /* Per axis, 1 = display resolution */
+    int width, height;          /* Applied resolution */
+    uint32_t raises;
+    uint32_t drops;
+} DynResStats_t;
+
+/* Scale limits per axis; starts at max_scale */
+void DynRes_Init(float min_scale, float max_scale);
+
+/* Disabled goes back to max_scale and stays there */
+void DynRes_SetEnabled(int enabled);
+int DynRes_IsEnabled(void);
+
+/* Feed one finished frame, all in Profile_Now() ticks: the budget, the
+ * whole frame's work and the part of it spent in setup and raster.
+ * Applies the new resolution; call between frames. */
+void DynRes_Update(uint64_t budget, uint64_t frame_ticks, uint64_t raster_ticks);
+
+void DynRes_GetStats(DynResStats_t* stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DYNRES_H */
@@ -5,17 +5,28 @@
 #ifndef ENGINE_CONFIG_H
 #define ENGINE_CONFIG_H
 
+/* Per-application sizing: build with -DENGINE_APP_CONFIG="app_config.h"
+ * to set any of the #ifndef limits below from one header of the app */
+#ifdef ENGINE_APP_CONFIG
+#include ENGINE_APP_CONFIG
+#endif
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
-/* Platform detection */
-#ifndef SDL_PC
-#if defined(_WIN32) || defined(__APPLE__) || (defined(__linux__) && !defined(__arm__))
+/* Platform detection. SDL_PC is defined on the PC build only, so code
+ * tests it with #ifdef SDL_PC; -DSDL_PC=0 selects the board as well. */
+#if defined(SDL_PC) && !SDL_PC
+#undef SDL_PC
+#endif
+#if !defined(SDL_PC) && (defined(_WIN32) || defined(__APPLE__) || (defined(__linux__) && !defined(__arm__)))
 #define SDL_PC  1
+#endif
+#ifndef STM32
+#ifdef SDL_PC
 #define STM32   0
 #else
-#define SDL_PC  0
 #define STM32   1
 #endif
 #endif
@@ -50,14 +61,17 @@ extern "C" {
 #define SDRAM_BASE              0xD0000000
 #define SDRAM_SIZE              (16 * 1024 * 1024)
 
-/* SDRAM Layout (STM32 only) */
+/* SDRAM Layout (STM32 only). Each framebuffer slot is FRAMEBUFFER_SIZE
+ * rounded up to 64KB, so the swap chain's two buffers never overlap. */
 #define FRAMEBUFFER_A_ADDR      (SDRAM_BASE + 0x00000000)
-#define FRAMEBUFFER_B_ADDR      (SDRAM_BASE + 0x000C0000)
-#define TEXTURE_MEM_ADDR        (SDRAM_BASE + 0x00180000)
-#define MODEL_MEM_ADDR          (SDRAM_BASE + 0x00580000)
+#define FRAMEBUFFER_B_ADDR      (SDRAM_BASE + 0x001A0000)
+#define TEXTURE_MEM_ADDR        (SDRAM_BASE + 0x00340000)
+#define MODEL_MEM_ADDR          (SDRAM_BASE + 0x00740000)
 
 /* Engine Limits */
-#define MAX_ENTITIES            256
+#ifndef MAX_ENTITIES
+#define MAX_ENTITIES            256     /* Build-time; at most ENTITY_INDEX_MASK */
+#endif
 #define MAX_RENDER_ENTITIES     256
 #define MAX_MESHES              64
 #define MAX_TEXTURES            64
@@ -70,6 +84,92 @@ extern "C" {
 #define AUDIO_BUFFER_SIZE       1024
 #define MAX_TOUCH_POINTS        5
 
+/* Resource Pools. Each is a static array sized here, in elements; size
+ * them to the app's assets, MemMap_Print() shows what each one uses. */
+#ifndef MAX_TOTAL_VERTICES
+#define MAX_TOTAL_VERTICES      40960   /* Static mesh vertices */
+#endif
+#ifndef MAX_TOTAL_INDICES
+#define MAX_TOTAL_INDICES       81920
+#endif
+#ifndef MAX_MESH_CLUSTERS
+#define MAX_MESH_CLUSTERS       2048
+#endif
+#ifndef MAX_MD2_FRAMES
+#define MAX_MD2_FRAMES          200
+#endif
+#ifndef MAX_MD2_VERTICES
+#define MAX_MD2_VERTICES        204800  /* Frame vertices, every frame of every model */
+#endif
+#ifndef MAX_MD2_UVS
+#define MAX_MD2_UVS             32768   /* Unique (vertex, texcoord) pairs, per model not per frame */
+#endif
+#ifndef MAX_TEXTURE_PIXELS
+#define MAX_TEXTURE_PIXELS      (256 * 256 * 4)     /* 16-bit words for all textures */
+#endif
+
+/* Offsets into the pools are uint32_t and Pool_Alloc() fails with all
+ * ones, so every pool stays below that */
+#if MAX_TOTAL_VERTICES >= 0xFFFFFFFF || MAX_TOTAL_INDICES >= 0xFFFFFFFF || MAX_MD2_VERTICES >= 0xFFFFFFFF || \
+    MAX_MD2_UVS >= 0xFFFFFFFF || MAX_TEXTURE_PIXELS >= 0xFFFFFFFF
+#error "Resource pool too large for uint32_t offsets"
+#endif
+
+/* Tile Binning */
+#define TILE_WIDTH              64
+#define TILE_HEIGHT             32
+#define TILES_X                 ((DISPLAY_WIDTH + TILE_WIDTH - 1) / TILE_WIDTH)
+#define TILES_Y                 ((DISPLAY_HEIGHT + TILE_HEIGHT - 1) / TILE_HEIGHT)
+#define TILE_COUNT              (TILES_X * TILES_Y)
+#ifndef MAX_BINNED_TRIANGLES
+#define MAX_BINNED_TRIANGLES    8192
+#endif
+#ifndef MAX_BIN_REFS
+#define MAX_BIN_REFS            32768
+#endif
+/* Bins link uint16_t triangle and reference indices, all ones ending a bin */
+#if MAX_BINNED_TRIANGLES > 0x10000 || MAX_BIN_REFS > 0xFFFF
+#error "Bin pools too large for uint16_t references"
+#endif
+#define MAX_BINNED_LINES        2048    /* Depth-tested lines per flush, drawn by every tile */
+
+/* Depth buffer formats (rendering/depth.h). The board always uses
+ * UNORM16; the SDL_PC Device can be switched for comparison. */
+#define DEPTH_FORMAT_UNORM16    0
+#define DEPTH_FORMAT_FIXED24    1
+#define DEPTH_FORMAT_FLOAT32    2
+#ifndef DEVICE_DEPTH_FORMAT
+#define DEVICE_DEPTH_FORMAT     DEPTH_FORMAT_UNORM16
+#endif
+
+/* Rasterizer pixel arithmetic. 1 steps depth, vertex colors and UVs as
+ * integer planes and divides through a reciprocal table (fixedpoint.h):
+ * no float per pixel or span, for the CM4 or FPU-less parts. Triangle
+ * setup still reads the float screen vertices. Output matches the float
+ * path to within a rounding step. */
+#ifndef RASTER_FIXED_POINT
+#define RASTER_FIXED_POINT      0
+#endif
+
+/* Rasterizer pixel traversal (Rasterizer_SetTraversal). Blocks walk the
+ * bounding box in 8x8 cells with HiZ; spans walk each row between the
+ * edges only; auto takes spans for thin triangles. Pick per target with
+ * the bench. */
+#define RASTER_TRAVERSAL_BLOCKS 0
+#define RASTER_TRAVERSAL_SPANS  1
+#define RASTER_TRAVERSAL_AUTO   2
+#ifndef RASTER_TRAVERSAL_DEFAULT
+#define RASTER_TRAVERSAL_DEFAULT RASTER_TRAVERSAL_BLOCKS
+#endif
+
+/* Per-frame scratch arena (rendering/arena.h), filled DTCM first */
+#define FRAME_ARENA_DTCM_SIZE   (32 * 1024)
+#ifdef SDL_PC
+#define FRAME_ARENA_AXI_SIZE    (2 * 1024 * 1024)
+#else
+#define FRAME_ARENA_AXI_SIZE    (256 * 1024)
+#endif
+
 /* Physics */
 #define PHYSICS_TIMESTEP        (1.0f / 60.0f)
 #define GRAVITY_Y               -9.81f
@@ -93,6 +193,9 @@ extern "C" {
 #define DTCM_DATA
 #define DTCM_BSS
 #define AXI_DATA
+#define SRAM1_DATA
+#define SRAM2_DATA
+#define SRAM4_DATA
 #define SHARED_DATA
 #define SDRAM_DATA
 #define FRAMEBUFFER
@@ -104,6 +207,9 @@ extern "C" {
 #define DTCM_DATA
 #define DTCM_BSS
 #define AXI_DATA
+#define SRAM1_DATA
+#define SRAM2_DATA
+#define SRAM4_DATA
 #define SHARED_DATA
 #define SDRAM_DATA
 #define FRAMEBUFFER
@@ -115,6 +221,9 @@ extern "C" {
 #define DTCM_DATA           __attribute__((section(".dtcm")))
 #define DTCM_BSS            __attribute__((section(".dtcm_bss")))
 #define AXI_DATA            __attribute__((section(".axi_sram")))
+#define SRAM1_DATA          __attribute__((section(".sram1")))
+#define SRAM2_DATA          __attribute__((section(".sram2")))
+#define SRAM4_DATA          __attribute__((section(".sram4")))
 #define SHARED_DATA         __attribute__((section(".shared"), aligned(32)))
 #define SDRAM_DATA          __attribute__((section(".sdram")))
 #define FRAMEBUFFER         __attribute__((section(".framebuffer"), aligned(32)))
@@ -126,6 +235,9 @@ extern "C" {
 #define DTCM_DATA
 #define DTCM_BSS
 #define AXI_DATA
+#define SRAM1_DATA
+#define SRAM2_DATA
+#define SRAM4_DATA
 #define SHARED_DATA
 #define SDRAM_DATA
 #define FRAMEBUFFER
@@ -134,6 +246,70 @@ extern "C" {
 #define SECTION_DTCM
 #endif
 
+/* Loader scratch arrays: one per thread on SDL_PC, where
+ * Stream_DecodeQueued() decodes on the job pool; the board decodes on
+ * one thread and keeps them plain statics */
+#ifdef SDL_PC
+#define LOADER_SCRATCH          thread_local
+#define LOADER_SCRATCH_SDRAM    thread_local    /* TLS takes no section */
+#else
+#define LOADER_SCRATCH
+#define LOADER_SCRATCH_SDRAM    SDRAM_DATA
+#endif
+
+/* ============================================================
+ * Pool Placement
+ * Region of each large buffer, as one of the section attributes above.
+ * Override on the command line (e.g. -DPLACE_TEXTURE_POOL=AXI_DATA) to
+ * move a hot pool into faster memory; the linker script has to provide
+ * the section. MemMap_Print() shows where everything ended up.
+ * ============================================================ */
+#ifndef PLACE_VERTEX_POOL
+#define PLACE_VERTEX_POOL       SDRAM_DATA  /* Vertices, SoA positions, packed vertices */
+#endif
+#ifndef PLACE_INDEX_POOL
+#define PLACE_INDEX_POOL        SDRAM_DATA
+#endif
+#ifndef PLACE_MD2_POOL
+#define PLACE_MD2_POOL          SDRAM_DATA  /* MD2 frame vertices and UV pairs */
+#endif
+#ifndef PLACE_POSE_CACHE
+#define PLACE_POSE_CACHE        SDRAM_DATA  /* Decoded MD2 poses */
+#endif
+#ifndef PLACE_TEXTURE_POOL
+#define PLACE_TEXTURE_POOL      SDRAM_DATA
+#endif
+#ifndef PLACE_TEXTURE_CACHE
+#define PLACE_TEXTURE_CACHE     AXI_DATA    /* Resident copies of hot textures */
+#endif
+#ifndef PLACE_DEPTH_BUFFER
+#define PLACE_DEPTH_BUFFER      SDRAM_DATA
+#endif
+#ifndef PLACE_BIN_POOL
+#define PLACE_BIN_POOL          SDRAM_DATA  /* Binned triangles and tile references */
+#endif
+#ifndef PLACE_STREAM_STAGING
+#define PLACE_STREAM_STAGING    SDRAM_DATA  /* Asset streaming read buffers */
+#endif
+#ifndef PLACE_PROFILE_EVENTS
+#define PLACE_PROFILE_EVENTS    SDRAM_DATA  /* Profiler zone ring */
+#endif
+#ifndef PLACE_CAPTURE_BUFFER
+#define PLACE_CAPTURE_BUFFER    SDRAM_DATA  /* Frame capture recording and replay list */
+#endif
+#ifndef PLACE_HEAT_BUFFER
+#define PLACE_HEAT_BUFFER       SDRAM_DATA  /* Debug heat map counters */
+#endif
+#ifndef PLACE_SHADOW_MASK
+#define PLACE_SHADOW_MASK       SDRAM_DATA  /* Planar shadow pixel mask, a bit per pixel */
+#endif
+#ifndef PLACE_STATIC_LAYER
+#define PLACE_STATIC_LAYER      SDRAM_DATA  /* Cached color and depth of the static draws */
+#endif
+#ifndef PLACE_TELEMETRY_BUFFER
+#define PLACE_TELEMETRY_BUFFER  AXI_DATA    /* UART telemetry DMA buffers */
+#endif
+
 /* Colors RGB565 */
 #define COLOR_BLACK         0x0000
 #define COLOR_WHITE         0xFFFF
@@ -4,24 +4,149 @@
  */
 
 #include "entity.h"
+#include "mesh.h"
+#include "resource.h"
+#include "spatial.h"
+#include "profile.h"
+#include "namehash.h"
 #include <string.h>
 #include <math.h>
 
+#define NO_SLOT 0xFFFF
+
+/* Every entity has a transform, so transforms stay indexed by slot */
 static Entity_t g_entities[MAX_ENTITIES];
 static Transform_t g_transforms[MAX_ENTITIES];
+static uint16_t g_generations[MAX_ENTITIES];
+
+/* Sparse set: the other components are packed at the front of their
+ * arrays, so iterating them never touches entities without one */
+typedef struct {
+    uint16_t sparse[MAX_ENTITIES];  /* Slot -> dense index, NO_SLOT if absent */
+    uint16_t dense[MAX_ENTITIES];   /* Dense index -> slot */
+    uint32_t count;
+} ComponentSet_t;
+
+static ComponentSet_t g_mesh_renderer_set;
+static ComponentSet_t g_camera_set;
+static ComponentSet_t g_light_set;
+static ComponentSet_t g_animator_set;
 static MeshRenderer_t g_mesh_renderers[MAX_ENTITIES];
 static Camera_t g_cameras[MAX_ENTITIES];
 static Light_t g_lights[MAX_ENTITIES];
 static Animator_t g_animators[MAX_ENTITIES];
-static uint32_t g_next_id = 1;
 
+/* Live slots, parents before children; rebuilt when the hierarchy changes */
+static uint16_t g_order[MAX_ENTITIES];
+static uint8_t g_cycle_root[MAX_ENTITIES];
+static uint32_t g_order_count = 0;
+static uint8_t g_hierarchy_dirty = 1;
+static uint32_t g_static_generation = 0;
+
+/* Name hash -> slot */
+static uint32_t g_name_hashes[2 * MAX_ENTITIES];
+static uint16_t g_name_slots[2 * MAX_ENTITIES];
+static NameIndex_t g_names;
+
+/* O(1): the handle names its slot, and a live slot stores its full handle */
 static int FindIndex(EntityID id) {
-    if (id == INVALID_ENTITY) return -1;
-    for (uint32_t i = 0; i < MAX_ENTITIES; i++)
-        if (g_entities[i].id == id) return (int)i;
-    return -1;
+    uint32_t idx = ENTITY_INDEX(id);
+    if (idx >= MAX_ENTITIES || g_entities[idx].id != id) return -1;
+    return (int)idx;
+}
+
+/* ============================================================
+ * Component Sets
+ * ============================================================ */
+
+static void SetClear(ComponentSet_t* s)
+{
+    for (uint32_t i = 0; i < MAX_ENTITIES; i++) s->sparse[i] = NO_SLOT;
+    s->count = 0;
+}
+
+static inline int SetFind(const ComponentSet_t* s, uint32_t slot)
+{
+    uint16_t d = s->sparse[slot];
+    return (d == NO_SLOT) ? -1 : (int)d;
+}
+
+/* Returns the dense index of a newly added element, -1 if already present */
+static int SetAdd(ComponentSet_t* s, uint32_t slot)
+{
+    if (s->sparse[slot] != NO_SLOT) return -1;
+    uint32_t d = s->count++;
+    s->sparse[slot] = (uint16_t)d;
+    s->dense[d] = (uint16_t)slot;
+    return (int)d;
+}
+
+/* Swap-remove: the last element moves into the hole */
+static void SetRemove(ComponentSet_t* s, uint32_t slot, void* data, size_t elem_size)
+{
+    uint16_t d = s->sparse[slot];
+    if (d == NO_SLOT) return;
+
+    uint32_t last = --s->count;
+    if (d != last) {
+        uint8_t* base = (uint8_t*)data;
+        memcpy(base + d * elem_size, base + last * elem_size, elem_size);
+        s->dense[d] = s->dense[last];
+        s->sparse[s->dense[d]] = d;
+    }
+    s->sparse[slot] = NO_SLOT;
+}
+
+static void AddComponents(uint32_t slot, uint32_t c)
+{
+    int d;
+    if ((c & COMP_MESH_RENDERER) && (d = SetAdd(&g_mesh_renderer_set, slot)) >= 0) {
+        memset(&g_mesh_renderers[d], 0, sizeof(MeshRenderer_t));
+        g_mesh_renderers[d].mesh_id = 0xFFFFFFFF;
+        g_mesh_renderers[d].material_id = 0xFFFFFFFF;
+        g_mesh_renderers[d].visible = 1;
+        g_mesh_renderers[d].bounds_radius = -1.0f;  /* Unknown until set: never culled */
+    }
+    if ((c & COMP_CAMERA) && (d = SetAdd(&g_camera_set, slot)) >= 0) {
+        memset(&g_cameras[d], 0, sizeof(Camera_t));
+        g_cameras[d].fov = 60.0f * DEG_TO_RAD;
+        g_cameras[d].near_plane = 0.1f;
+        g_cameras[d].far_plane = 1000.0f;
+    }
+    if ((c & COMP_LIGHT) && (d = SetAdd(&g_light_set, slot)) >= 0) {
+        memset(&g_lights[d], 0, sizeof(Light_t));
+        g_lights[d].color = Vec3_One();
+        g_lights[d].intensity = 1.0f;
+        g_lights[d].range = 10.0f;
+    }
+    if ((c & COMP_ANIMATOR) && (d = SetAdd(&g_animator_set, slot)) >= 0) {
+        memset(&g_animators[d], 0, sizeof(Animator_t));
+        g_animators[d].playback_speed = 1.0f;
+    }
+}
+
+/* Lets go of what a renderer holds */
+static void ReleaseMeshRenderer(MeshRenderer_t* mr)
+{
+    MeshRenderer_SetMesh(mr, 0xFFFFFFFF);
+    MeshRenderer_SetMaterial(mr, 0xFFFFFFFF);
+}
+
+static void RemoveComponents(uint32_t slot, uint32_t c)
+{
+    if (c & COMP_MESH_RENDERER) g_static_generation++;
+    int d = (c & COMP_MESH_RENDERER) ? SetFind(&g_mesh_renderer_set, slot) : -1;
+    if (d >= 0) ReleaseMeshRenderer(&g_mesh_renderers[d]);
+    if (c & COMP_MESH_RENDERER) SetRemove(&g_mesh_renderer_set, slot, g_mesh_renderers, sizeof(MeshRenderer_t));
+    if (c & COMP_CAMERA)        SetRemove(&g_camera_set, slot, g_cameras, sizeof(Camera_t));
+    if (c & COMP_LIGHT)         SetRemove(&g_light_set, slot, g_lights, sizeof(Light_t));
+    if (c & COMP_ANIMATOR)      SetRemove(&g_animator_set, slot, g_animators, sizeof(Animator_t));
 }
 
+/* ============================================================
+ * Entity Lifetime
+ * ============================================================ */
+
 void Entity_Init(void)
 {
     memset(g_entities, 0, sizeof(g_entities));
@@ -30,6 +155,11 @@ void Entity_Init(void)
     memset(g_cameras, 0, sizeof(g_cameras));
     memset(g_lights, 0, sizeof(g_lights));
     memset(g_animators, 0, sizeof(g_animators));
+    SetClear(&g_mesh_renderer_set);
+    SetClear(&g_camera_set);
+    SetClear(&g_light_set);
+    SetClear(&g_animator_set);
+    NameIndex_Init(&g_names, g_name_hashes, g_name_slots, 2 * MAX_ENTITIES);
     
     for (uint32_t i = 0; i < MAX_ENTITIES; i++) {
         g_entities[i].id = INVALID_ENTITY;
@@ -37,38 +167,43 @@ void Entity_Init(void)
         g_transforms[i].parent = INVALID_ENTITY;
         Mat4_Identity(&g_transforms[i].local_matrix);
         Mat4_Identity(&g_transforms[i].world_matrix);
+        g_generations[i] = 1;
     }
-    g_next_id = 1;
+    g_order_count = 0;
+    g_hierarchy_dirty = 1;
+    g_static_generation++;
+    Spatial_Init();
 }
 
-void Entity_Shutdown(void) { Entity_Init(); }
+void Entity_Shutdown(void)
+{
+    for (uint32_t d = 0; d < g_mesh_renderer_set.count; d++) ReleaseMeshRenderer(&g_mesh_renderers[d]);
+    Entity_Init();
+}
 
 EntityID Entity_Create(const char* name)
 {
     for (uint32_t i = 0; i < MAX_ENTITIES; i++) {
         if (g_entities[i].id == INVALID_ENTITY) {
-            EntityID id = g_next_id++;
+            EntityID id = ((EntityID)g_generations[i] << ENTITY_INDEX_BITS) | i;
             g_entities[i].id = id;
             g_entities[i].components = COMP_TRANSFORM;
             g_entities[i].active = 1;
             g_entities[i].layer = 0;
             g_entities[i].tag = 0;
             if (name) strncpy(g_entities[i].name, name, 23);
+            else g_entities[i].name[0] = '\0';
+            g_entities[i].name_hash = Name_Hash(g_entities[i].name);
+            NameIndex_Insert(&g_names, g_entities[i].name_hash, (uint16_t)i);
             
             g_transforms[i].position = Vec3_Zero();
             g_transforms[i].rotation = Vec3_Zero();
+            g_transforms[i].orientation = Quat_Identity();
+            g_transforms[i].use_orientation = 0;
             g_transforms[i].scale = Vec3_One();
             g_transforms[i].parent = INVALID_ENTITY;
             g_transforms[i].dirty = 1;
-            
-            g_mesh_renderers[i].visible = 1;
-            g_cameras[i].fov = 60.0f * DEG_TO_RAD;
-            g_cameras[i].near_plane = 0.1f;
-            g_cameras[i].far_plane = 1000.0f;
-            g_lights[i].color = Vec3_One();
-            g_lights[i].intensity = 1.0f;
-            g_lights[i].range = 10.0f;
-            g_animators[i].playback_speed = 1.0f;
+            g_hierarchy_dirty = 1;
             
             return id;
         }
@@ -85,8 +220,14 @@ void Entity_Destroy(EntityID id)
                 g_transforms[i].parent = INVALID_ENTITY;
                 g_transforms[i].dirty = 1;
             }
+        Spatial_Remove(idx);
+        RemoveComponents(idx, g_entities[idx].components);
+        NameIndex_Remove(&g_names, g_entities[idx].name_hash, (uint16_t)idx);
         g_entities[idx].id = INVALID_ENTITY;
         g_entities[idx].components = 0;
+        /* Invalidate outstanding handles; 0 is skipped so ids stay nonzero */
+        if (++g_generations[idx] == 0) g_generations[idx] = 1;
+        g_hierarchy_dirty = 1;
     }
 }
 
@@ -94,17 +235,30 @@ int Entity_IsValid(EntityID id) { return FindIndex(id) >= 0; }
 
 void Entity_SetActive(EntityID id, int active) {
     int idx = FindIndex(id);
-    if (idx >= 0) g_entities[idx].active = active ? 1 : 0;
+    if (idx < 0) return;
+    g_entities[idx].active = active ? 1 : 0;
+    /* Inactive entities leave the spatial index; re-added on the next update */
+    if (active) g_transforms[idx].dirty = 1;
+    else {
+        Spatial_Remove(idx);
+        g_static_generation++;
+    }
 }
 
 void Entity_AddComponent(EntityID id, ComponentMask c) {
     int idx = FindIndex(id);
-    if (idx >= 0) g_entities[idx].components |= c;
+    if (idx < 0) return;
+    g_entities[idx].components |= c;
+    AddComponents(idx, c);
+    if (c & COMP_MESH_RENDERER) g_transforms[idx].dirty = 1;
 }
 
 void Entity_RemoveComponent(EntityID id, ComponentMask c) {
     int idx = FindIndex(id);
-    if (idx >= 0) g_entities[idx].components &= ~c;
+    if (idx < 0) return;
+    RemoveComponents(idx, g_entities[idx].components & c);
+    g_entities[idx].components &= ~c;
+    if (c & COMP_MESH_RENDERER) Spatial_Remove(idx);
 }
 
 int Entity_HasComponent(EntityID id, ComponentMask c) {
@@ -116,21 +270,45 @@ Transform_t* Entity_GetTransform(EntityID id) {
     int idx = FindIndex(id); return (idx >= 0) ? &g_transforms[idx] : NULL;
 }
 MeshRenderer_t* Entity_GetMeshRenderer(EntityID id) {
-    int idx = FindIndex(id); return (idx >= 0) ? &g_mesh_renderers[idx] : NULL;
+    int idx = FindIndex(id); int d = (idx >= 0) ? SetFind(&g_mesh_renderer_set, idx) : -1;
+    return (d >= 0) ? &g_mesh_renderers[d] : NULL;
+}
+void MeshRenderer_SetMesh(MeshRenderer_t* mr, uint32_t mesh_id)
+{
+    if (!mr || mr->mesh_id == mesh_id) return;
+    Mesh_Retain(mesh_id);
+    if (mr->mesh_id != 0xFFFFFFFF) Mesh_Free(mr->mesh_id);
+    mr->mesh_id = mesh_id;
+}
+
+void MeshRenderer_SetMaterial(MeshRenderer_t* mr, uint32_t material_id)
+{
+    if (!mr || mr->material_id == material_id) return;
+    Resource_RetainMaterial(material_id);
+    Resource_FreeMaterial(mr->material_id);
+    mr->material_id = material_id;
 }
+
 Camera_t* Entity_GetCamera(EntityID id) {
-    int idx = FindIndex(id); return (idx >= 0) ? &g_cameras[idx] : NULL;
+    int idx = FindIndex(id); int d = (idx >= 0) ? SetFind(&g_camera_set, idx) : -1;
+    return (d >= 0) ? &g_cameras[d] : NULL;
 }
 Light_t* Entity_GetLight(EntityID id) {
-    int idx = FindIndex(id); return (idx >= 0) ? &g_lights[idx] : NULL;
+    int idx = FindIndex(id); int d = (idx >= 0) ? SetFind(&g_light_set, idx) : -1;
+    return (d >= 0) ? &g_lights[d] : NULL;
 }
 Animator_t* Entity_GetAnimator(EntityID id) {
-    int idx = FindIndex(id); return (idx >= 0) ? &g_animators[idx] : NULL;
+    int idx = FindIndex(id); int d = (idx >= 0) ? SetFind(&g_animator_set, idx) : -1;
+    return (d >= 0) ? &g_animators[d] : NULL;
 }
 
 void Entity_SetParent(EntityID child, EntityID parent) {
     int idx = FindIndex(child);
-    if (idx >= 0) { g_transforms[idx].parent = parent; g_transforms[idx].dirty = 1; }
+    if (idx >= 0) {
+        g_transforms[idx].parent = parent;
+        g_transforms[idx].dirty = 1;
+        g_hierarchy_dirty = 1;
+    }
 }
 
 void Transform_SetPosition(EntityID id, Vec3 p) {
@@ -140,7 +318,20 @@ void Transform_SetPosition(EntityID id, Vec3 p) {
 
 void Transform_SetRotation(EntityID id, Vec3 r) {
     int idx = FindIndex(id);
-    if (idx >= 0) { g_transforms[idx].rotation = r; g_transforms[idx].dirty = 1; }
+    if (idx >= 0) {
+        g_transforms[idx].rotation = r;
+        g_transforms[idx].use_orientation = 0;
+        g_transforms[idx].dirty = 1;
+    }
+}
+
+void Transform_SetOrientation(EntityID id, Quaternion q) {
+    int idx = FindIndex(id);
+    if (idx >= 0) {
+        g_transforms[idx].orientation = q;
+        g_transforms[idx].use_orientation = 1;
+        g_transforms[idx].dirty = 1;
+    }
 }
 
 void Transform_SetScale(EntityID id, Vec3 s) {
@@ -192,102 +383,233 @@ Vec3 Transform_GetUp(EntityID id) {
     return Vec3_Normalize(up);
 }
 
+/* T * R * S, R = Ry * Rx * Rz or the orientation */
 static void UpdateLocalMatrix(int idx)
 {
     Transform_t* t = &g_transforms[idx];
-    Mat4 T, Rx, Ry, Rz, S, tmp;
-    
-    Mat4_Translation(&T, t->position.x, t->position.y, t->position.z);
-    Mat4_RotationX(&Rx, t->rotation.x);
-    Mat4_RotationY(&Ry, t->rotation.y);
-    Mat4_RotationZ(&Rz, t->rotation.z);
-    Mat4_Scale(&S, t->scale.x, t->scale.y, t->scale.z);
-    
-    Mat4_Multiply(&tmp, &Ry, &Rx);
-    Mat4_Multiply(&Rx, &tmp, &Rz);
-    Mat4_Multiply(&tmp, &T, &Rx);
-    Mat4_Multiply(&t->local_matrix, &tmp, &S);
+    if (t->use_orientation) Mat4_ComposeTRSQuat(&t->local_matrix, t->position, t->orientation, t->scale);
+    else Mat4_ComposeTRS(&t->local_matrix, t->position, t->rotation, t->scale);
 }
 
-void Entity_UpdateTransforms(void)
+/* Moves the entity's world-space bounding sphere in the spatial index */
+static void UpdateSpatial(int idx)
 {
-    /* Update local matrices for dirty transforms */
-    for (uint32_t i = 0; i < MAX_ENTITIES; i++)
-        if (g_entities[i].id != INVALID_ENTITY && g_transforms[i].dirty)
-            UpdateLocalMatrix(i);
-    
-    /* Propagate world matrices (multiple passes for hierarchy) */
-    for (int pass = 0; pass < 8; pass++) {
-        int any_dirty = 0;
-        for (uint32_t i = 0; i < MAX_ENTITIES; i++) {
-            if (g_entities[i].id == INVALID_ENTITY || !g_transforms[i].dirty) continue;
-            
-            Transform_t* t = &g_transforms[i];
-            if (t->parent == INVALID_ENTITY) {
-                memcpy(&t->world_matrix, &t->local_matrix, sizeof(Mat4));
-                t->dirty = 0;
-            } else {
-                int pidx = FindIndex(t->parent);
-                if (pidx >= 0 && !g_transforms[pidx].dirty) {
-                    Mat4_Multiply(&t->world_matrix, &g_transforms[pidx].world_matrix, &t->local_matrix);
-                    t->dirty = 0;
-                } else {
-                    any_dirty = 1;
-                }
-            }
-        }
-        if (!any_dirty) break;
+    if (!g_entities[idx].active || !(g_entities[idx].components & COMP_MESH_RENDERER)) return;
+
+    MeshRenderer_t* mr = &g_mesh_renderers[g_mesh_renderer_set.sparse[idx]];
+    const float* m = g_transforms[idx].world_matrix.m;
+    if (mr->is_static) g_static_generation++;
+    if (mr->bounds_radius < 0.0f) {
+        Spatial_Update(idx, g_entities[idx].id, Vec3_Zero(), -1.0f);
+        return;
     }
+
+    float sx = m[0] * m[0] + m[1] * m[1] + m[2] * m[2];
+    float sy = m[4] * m[4] + m[5] * m[5] + m[6] * m[6];
+    float sz = m[8] * m[8] + m[9] * m[9] + m[10] * m[10];
+    float max_sq = (sx > sy) ? ((sx > sz) ? sx : sz) : ((sy > sz) ? sy : sz);
+
+    Vec3 center = Mat4_TransformPoint(&g_transforms[idx].world_matrix, mr->bounds_center);
+    Spatial_Update(idx, g_entities[idx].id, center, mr->bounds_radius * sqrtf(max_sq));
 }
 
-void Entity_UpdateAnimators(float dt)
+/* Rebuilds g_order as a depth-first walk from the roots, so parents
+ * always precede their children */
+static void RebuildHierarchyOrder(void)
 {
+    uint16_t first_child[MAX_ENTITIES];
+    uint16_t next_sibling[MAX_ENTITIES];
+    uint16_t stack[2 * MAX_ENTITIES];   /* A cycle root can be pushed twice */
+    uint8_t visited[MAX_ENTITIES];
+    uint32_t sp = 0;
+
+    memset(g_cycle_root, 0, sizeof(g_cycle_root));
+
     for (uint32_t i = 0; i < MAX_ENTITIES; i++) {
+        first_child[i] = NO_SLOT;
+        next_sibling[i] = NO_SLOT;
+        visited[i] = 0;
+    }
+
+    /* Link children (reverse so siblings come out in slot order) */
+    for (int i = MAX_ENTITIES - 1; i >= 0; i--) {
         if (g_entities[i].id == INVALID_ENTITY) continue;
-        if (!(g_entities[i].components & COMP_ANIMATOR)) continue;
-        
-        Animator_t* anim = &g_animators[i];
-        if (!anim->is_playing) continue;
-        
-        anim->frame_time += dt * anim->playback_speed;
-        
-        float frame_duration = 1.0f / 10.0f; /* 10 FPS default */
-        if (anim->frame_time >= frame_duration) {
-            anim->frame_time -= frame_duration;
-            anim->current_frame = anim->next_frame;
-            anim->next_frame++;
-            
-            if (anim->next_frame > anim->end_frame) {
-                if (anim->is_looping) {
-                    anim->next_frame = anim->start_frame;
-                } else {
-                    anim->next_frame = anim->end_frame;
-                    anim->is_playing = 0;
+        int pidx = FindIndex(g_transforms[i].parent);
+        if (pidx >= 0 && pidx != i) {
+            next_sibling[i] = first_child[pidx];
+            first_child[pidx] = (uint16_t)i;
+        }
+        else {
+            stack[sp++] = (uint16_t)i;  /* Root */
+        }
+    }
+
+    g_order_count = 0;
+    for (;;) {
+        while (sp > 0) {
+            uint16_t n = stack[--sp];
+            if (visited[n]) continue;
+            visited[n] = 1;
+            g_order[g_order_count++] = n;
+            for (uint16_t c = first_child[n]; c != NO_SLOT; c = next_sibling[c]) {
+                stack[sp++] = c;
+            }
+        }
+
+        /* Parent cycles are unreachable from any root: break them at the
+         * lowest slot, which is then updated as a root */
+        uint32_t i = 0;
+        while (i < MAX_ENTITIES && (g_entities[i].id == INVALID_ENTITY || visited[i])) i++;
+        if (i == MAX_ENTITIES) break;
+        g_cycle_root[i] = 1;
+        stack[sp++] = (uint16_t)i;
+    }
+
+    g_hierarchy_dirty = 0;
+}
+
+void Entity_UpdateLocalTransforms(uint32_t first, uint32_t count)
+{
+    uint32_t end = MIN(first + count, (uint32_t)MAX_ENTITIES);
+    for (uint32_t i = first; i < end; i++) {
+        if (g_entities[i].id != INVALID_ENTITY && g_transforms[i].dirty) UpdateLocalMatrix((int)i);
+    }
+}
+
+void Entity_PropagateTransforms(void)
+{
+    PROFILE_ZONE("Entity_PropagateTransforms");
+    uint8_t changed[MAX_ENTITIES];
+
+    if (g_hierarchy_dirty) RebuildHierarchyOrder();
+
+    /* One pass in parent-before-child order; a changed world matrix
+     * propagates to every descendant */
+    for (uint32_t k = 0; k < g_order_count; k++) {
+        uint16_t i = g_order[k];
+        Transform_t* t = &g_transforms[i];
+        int pidx = g_cycle_root[i] ? -1 : FindIndex(t->parent);
+        int parent_changed = (pidx >= 0) && changed[pidx];
+
+        changed[i] = 0;
+        if (!t->dirty && !parent_changed) continue;
+
+        if (pidx >= 0) Mat4_MultiplyAffine(&t->world_matrix, &g_transforms[pidx].world_matrix, &t->local_matrix);
+        else memcpy(&t->world_matrix, &t->local_matrix, sizeof(Mat4));
+
+        t->dirty = 0;
+        changed[i] = 1;
+        UpdateSpatial(i);
+    }
+}
+
+uint32_t Entity_GetStaticGeneration(void)
+{
+    return g_static_generation;
+}
+
+void Entity_UpdateTransforms(void)
+{
+    PROFILE_ZONE("Entity_UpdateTransforms");
+    Entity_UpdateLocalTransforms(0, MAX_ENTITIES);
+    Entity_PropagateTransforms();
+}
+
+uint32_t Entity_GetAnimatorCount(void)
+{
+    return g_animator_set.count;
+}
+
+void Entity_UpdateAnimatorRange(uint32_t first, uint32_t count, float dt)
+{
+    uint32_t end = MIN(first + count, g_animator_set.count);
+    for (uint32_t d = first; d < end; d++) {
+        Animator_t* anim = &g_animators[d];
+        int r = SetFind(&g_mesh_renderer_set, g_animator_set.dense[d]);
+        MeshRenderer_t* mr = (r >= 0 && g_mesh_renderers[r].is_animated) ? &g_mesh_renderers[r] : NULL;
+        int drawn = !mr || mr->drawn;
+        if (mr) mr->drawn = 0;
+
+        if (anim->is_playing) {
+            float frame_duration = 1.0f / ((anim->frame_rate > 0.0f) ? anim->frame_rate : ANIMATOR_DEFAULT_FPS);
+            anim->frame_time += dt * anim->playback_speed;
+            while (anim->frame_time >= frame_duration && anim->is_playing) {
+                anim->frame_time -= frame_duration;
+                anim->current_frame = anim->next_frame;
+                anim->next_frame++;
+
+                if (anim->next_frame > anim->end_frame) {
+                    if (anim->is_looping) {
+                        anim->next_frame = anim->start_frame;
+                    } else {
+                        anim->next_frame = anim->end_frame;
+                        anim->is_playing = 0;
+                    }
                 }
             }
+
+            /* Off screen: time only, the lerp waits until it is drawn again */
+            anim->interpolation = drawn ? anim->frame_time / frame_duration : 0.0f;
+        }
+        if (mr) {
+            mr->anim_frame_a = (uint16_t)anim->current_frame;
+            mr->anim_frame_b = (uint16_t)anim->next_frame;
+            mr->anim_lerp = anim->interpolation;
         }
-        
-        anim->interpolation = anim->frame_time / frame_duration;
     }
 }
 
+void Entity_UpdateAnimators(float dt)
+{
+    Entity_UpdateAnimatorRange(0, g_animator_set.count, dt);
+}
+
+/* Lowest live slot whose name hashes to hash, and matches name if given */
+static EntityID FindNamed(uint32_t hash, const char* name)
+{
+    uint32_t best = MAX_ENTITIES;
+    uint32_t cursor = 0;
+    uint16_t i;
+    while ((i = NameIndex_Next(&g_names, hash, &cursor)) != NAME_INDEX_EMPTY) {
+        if (i >= best || g_entities[i].id == INVALID_ENTITY) continue;
+        if (name && strcmp(g_entities[i].name, name) != 0) continue;
+        best = i;
+    }
+    return (best < MAX_ENTITIES) ? g_entities[best].id : INVALID_ENTITY;
+}
+
 EntityID Entity_FindByName(const char* name)
 {
     if (!name) return INVALID_ENTITY;
-    for (uint32_t i = 0; i < MAX_ENTITIES; i++)
-        if (g_entities[i].id != INVALID_ENTITY && strcmp(g_entities[i].name, name) == 0)
-            return g_entities[i].id;
-    return INVALID_ENTITY;
+    return FindNamed(Name_Hash(name), name);
+}
+
+EntityID Entity_FindByHash(uint32_t name_hash)
+{
+    return FindNamed(name_hash, NULL);
 }
 
+/* Drives iteration from the smallest required component set */
 void Entity_BeginIteration(EntityIterator_t* it, uint32_t req) {
+    const ComponentSet_t* sets[4] = { &g_mesh_renderer_set, &g_camera_set, &g_light_set, &g_animator_set };
+    const uint32_t masks[4] = { COMP_MESH_RENDERER, COMP_CAMERA, COMP_LIGHT, COMP_ANIMATOR };
+
     it->index = 0; it->required = req; it->current = INVALID_ENTITY;
+    it->slots = NULL;
+    it->count = MAX_ENTITIES;
+    for (int i = 0; i < 4; i++) {
+        if ((req & masks[i]) && sets[i]->count < it->count) {
+            it->slots = sets[i]->dense;
+            it->count = sets[i]->count;
+        }
+    }
 }
 
 int Entity_Next(EntityIterator_t* it)
 {
-    while (it->index < MAX_ENTITIES) {
-        uint32_t i = it->index++;
+    while (it->index < it->count) {
+        uint32_t i = it->slots ? it->slots[it->index] : it->index;
+        it->index++;
         if (g_entities[i].id != INVALID_ENTITY && g_entities[i].active &&
             (g_entities[i].components & it->required) == it->required) {
             it->current = g_entities[i].id;
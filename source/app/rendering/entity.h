@@ -14,8 +14,18 @@
 extern "C" {
 #endif
 
+/* Handle = generation << ENTITY_INDEX_BITS | slot. The slot's generation
+ * is bumped on destroy, so handles to a reused slot no longer resolve. */
 typedef uint32_t EntityID;
 #define INVALID_ENTITY 0xFFFFFFFF
+#define ENTITY_INDEX_BITS       16
+#define ENTITY_INDEX_MASK       ((1u << ENTITY_INDEX_BITS) - 1)
+#define ENTITY_INDEX(id)        ((id) & ENTITY_INDEX_MASK)
+#define ENTITY_GENERATION(id)   ((id) >> ENTITY_INDEX_BITS)
+
+#if MAX_ENTITIES > ENTITY_INDEX_MASK
+#error "MAX_ENTITIES does not fit in ENTITY_INDEX_BITS"
+#endif
 
 typedef enum {
     COMP_NONE           = 0,
@@ -31,17 +41,19 @@ typedef enum {
 
 typedef struct {
     Vec3 position;
-    Vec3 rotation;
+    Vec3 rotation;              /* Euler radians, applied Z, then X, then Y */
     Vec3 scale;
-    Mat4 local_matrix;
+    Quaternion orientation;     /* Replaces rotation while use_orientation is set */
+    Mat4 local_matrix;          /* Affine, as is world_matrix */
     Mat4 world_matrix;
     EntityID parent;
     uint8_t dirty;
+    uint8_t use_orientation;
 } Transform_t;
 
 typedef struct {
-    uint32_t mesh_id;
-    uint32_t material_id;
+    uint32_t mesh_id;           /* Mesh_* slot, held; set through MeshRenderer_SetMesh() */
+    uint32_t material_id;       /* MaterialID (resource.h), held; MeshRenderer_SetMaterial() */
     Vec3 bounds_center;
     float bounds_radius;
     uint8_t visible;
@@ -51,6 +63,10 @@ typedef struct {
     uint16_t anim_frame_b;      /* Next frame (for interpolation) */
     float anim_lerp;            /* Interpolation factor 0-1 */
     uint8_t is_animated;        /* 1 if this is an MD2 model */
+    uint8_t lod;                /* Detail level drawn last frame (meshlod.h) */
+    uint8_t occluder;           /* Static mesh that hides others (occlusion.h) */
+    uint8_t drawn;              /* Set by SceneBuffer_Build(), cleared by the animator update */
+    uint8_t is_static;          /* Opaque and rarely moved: cached in the static layer (staticlayer.h) */
 } MeshRenderer_t;
 
 typedef struct {
@@ -67,15 +83,18 @@ typedef struct {
     Vec3 color;
     float intensity;
     float range;
-    float spot_angle;
+    float spot_angle;           /* Full cone angle, radians */
 } Light_t;
 
+#define ANIMATOR_DEFAULT_FPS    10.0f
+
 typedef struct {
     uint32_t current_frame;
     uint32_t next_frame;
     float interpolation;
     float frame_time;
     float playback_speed;
+    float frame_rate;           /* Keyframes per second (MD2_GetAnimFrameRate), 0 = ANIMATOR_DEFAULT_FPS */
     uint32_t start_frame;
     uint32_t end_frame;
     uint8_t is_playing;
@@ -89,12 +108,15 @@ typedef struct {
     uint8_t layer;
     uint16_t tag;
     char name[24];
+    uint32_t name_hash;         /* Name_Hash() of name (namehash.h) */
 } Entity_t;
 
 typedef struct {
     uint32_t index;
     uint32_t required;
     EntityID current;
+    const uint16_t* slots;  /* Packed slots of the driving component, NULL = all */
+    uint32_t count;
 } EntityIterator_t;
 
 /* Entity API */
@@ -109,24 +131,64 @@ void Entity_AddComponent(EntityID id, ComponentMask c);
 void Entity_RemoveComponent(EntityID id, ComponentMask c);
 int Entity_HasComponent(EntityID id, ComponentMask c);
 
+/* Components other than the transform are densely packed; their pointers
+ * are NULL if the entity lacks the component and stay valid only until
+ * a component of the same type is removed from any entity */
 Transform_t* Entity_GetTransform(EntityID id);
 MeshRenderer_t* Entity_GetMeshRenderer(EntityID id);
 Camera_t* Entity_GetCamera(EntityID id);
 Light_t* Entity_GetLight(EntityID id);
 Animator_t* Entity_GetAnimator(EntityID id);
 
+/* Point a renderer at a mesh or material (0xFFFFFFFF for none, the
+ * default). It holds a reference to each (Mesh_Retain(),
+ * Resource_RetainMaterial()) until replaced, until the component is
+ * removed or at Entity_Shutdown(). */
+void MeshRenderer_SetMesh(MeshRenderer_t* mr, uint32_t mesh_id);
+void MeshRenderer_SetMaterial(MeshRenderer_t* mr, uint32_t material_id);
+
 void Entity_SetParent(EntityID child, EntityID parent);
 void Transform_SetPosition(EntityID id, Vec3 p);
 void Transform_SetRotation(EntityID id, Vec3 r);
+void Transform_SetOrientation(EntityID id, Quaternion q);   /* Unit q; until the next SetRotation */
 void Transform_SetScale(EntityID id, Vec3 s);
 Vec3 Transform_GetPosition(EntityID id);
 Vec3 Transform_GetForward(EntityID id);
 Vec3 Transform_GetRight(EntityID id);
 Vec3 Transform_GetUp(EntityID id);
 
+/* Also moves mesh renderers in the spatial index (spatial.h); set
+ * MeshRenderer_t bounds before the entity's first update */
 void Entity_UpdateTransforms(void);
+
+/* Advances the playing animators and copies their frames into the
+ * entity's mesh renderer when it is_animated. The pose lerp is only
+ * worked out for models drawn last frame (MeshRenderer_t drawn); the
+ * others keep time and whole keyframes, so off-screen crowds cost a
+ * counter each. */
 void Entity_UpdateAnimators(float dt);
+
+/* Changes whenever a static mesh renderer (is_static) gets a new world
+ * matrix or any renderer leaves the scene; edits to a renderer's fields
+ * are not tracked. SceneBuffer_Build() keys its retained draws on it. */
+uint32_t Entity_GetStaticGeneration(void);
+
+/* The two halves of Entity_UpdateTransforms(), for the system scheduler
+ * (systems.h): local matrices of the dirty transforms among slots
+ * [first, first + count), which are independent and may run on several
+ * threads, then world matrices and the spatial index, parents first,
+ * on one thread */
+void Entity_UpdateLocalTransforms(uint32_t first, uint32_t count);
+void Entity_PropagateTransforms(void);
+
+/* Entity_UpdateAnimators() over dense animators [first, first + count);
+ * ranges are independent */
+uint32_t Entity_GetAnimatorCount(void);
+void Entity_UpdateAnimatorRange(uint32_t first, uint32_t count, float dt);
+/* Lowest-slot live entity of that name, through a hash index; by hash
+ * for names hashed ahead with NAME_HASH(), trusting it (namehash.h) */
 EntityID Entity_FindByName(const char* name);
+EntityID Entity_FindByHash(uint32_t name_hash);
 
 void Entity_BeginIteration(EntityIterator_t* it, uint32_t req);
 int Entity_Next(EntityIterator_t* it);
@@ -0,0 +1,120 @@
+/**
+ * @file fastmath.h
+ * @brief Polynomial Trig And Newton Reciprocals - NO MALLOC
+ *
+ * The Cortex-M7 FPU has single-cycle multiply-add but takes 14 cycles
+ * per VDIV or VSQRT, does not pipeline them, and newlib's sinf/cosf
+ * run a few hundred cycles. These replace them with multiply-adds only:
+ *
+ *   Fast_SinCos   Reduction by pi/2 in three parts (Cody-Waite), then the
+ *                 Cephes minimax polynomials on [-pi/4, pi/4]. Absolute
+ *                 error below FAST_TRIG_MAX_ERROR for |rad| up to
+ *                 FAST_TRIG_MAX_ARG; one reduction serves both.
+ *   Fast_Rsqrt    Exponent-halving estimate plus two Newton steps;
+ *                 relative error below FAST_RSQRT_MAX_ERROR.
+ *   Fast_Recip    Exponent-negating estimate plus three Newton steps;
+ *                 relative error below FAST_RECIP_MAX_ERROR.
+ *
+ * Inputs outside the documented domains (zero, negative, denormal,
+ * infinite, NaN) give unspecified results, not traps. Call these
+ * directly where the error is known to be harmless; math3d.h routes
+ * its own trig and normalization through them when built with
+ * MATH3D_FAST_MATH=1.
+ */
+
+#ifndef FASTMATH_H
+#define FASTMATH_H
+
+#include <stdint.h>
+#include <string.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define FAST_TRIG_MAX_ARG       65536.0f    /* |rad| for which the bound holds */
+#define FAST_TRIG_MAX_ERROR     2e-6f       /* Absolute */
+#define FAST_RSQRT_MAX_ERROR    5e-6f       /* Relative */
+#define FAST_RECIP_MAX_ERROR    1e-6f       /* Relative */
+
+static inline uint32_t Fast_FloatBits(float f)
+{
+    uint32_t u;
+    memcpy(&u, &f, sizeof(u));
+    return u;
+}
+
+static inline float Fast_BitsFloat(uint32_t u)
+{
+    float f;
+    memcpy(&f, &u, sizeof(f));
+    return f;
+}
+
+static inline void Fast_SinCos(float rad, float* s, float* c)
+{
+    /* Nearest multiple of pi/2; the first part has 8 significant bits,
+     * so k * part is exact for |k| < 2^16 */
+    float kf = rad * 0.63661977236758134f;
+    int32_t k = (int32_t)(kf + (kf >= 0.0f ? 0.5f : -0.5f));
+    kf = (float)k;
+    float r = ((rad - kf * 1.5703125f) - kf * 4.837512969970703125e-4f) - kf * 7.54978995489188216e-8f;
+
+    float z = r * r;
+    float sr = ((-1.9515295891e-4f * z + 8.3321608736e-3f) * z - 1.6666654611e-1f) * z * r + r;
+    float cr = ((2.443315711809948e-5f * z - 1.388731625493765e-3f) * z + 4.166664568298827e-2f) * z * z -
+        0.5f * z + 1.0f;
+
+    switch (k & 3) {
+    case 0: *s = sr;  *c = cr;  break;
+    case 1: *s = cr;  *c = -sr; break;
+    case 2: *s = -sr; *c = -cr; break;
+    default: *s = -cr; *c = sr; break;
+    }
+}
+
+static inline float Fast_Sin(float rad)
+{
+    float s, c;
+    Fast_SinCos(rad, &s, &c);
+    return s;
+}
+
+static inline float Fast_Cos(float rad)
+{
+    float s, c;
+    Fast_SinCos(rad, &s, &c);
+    return c;
+}
+
+/* 1 / sqrt(x), x > 0 and normal */
+static inline float Fast_Rsqrt(float x)
+{
+    float y = Fast_BitsFloat(0x5F375A86u - (Fast_FloatBits(x) >> 1));
+    float h = 0.5f * x;
+    y = y * (1.5f - h * y * y);
+    y = y * (1.5f - h * y * y);
+    return y;
+}
+
+/* sqrt(x) for x >= 0; 0 for 0 */
+static inline float Fast_Sqrt(float x)
+{
+    return (x > 0.0f) ? x * Fast_Rsqrt(x) : 0.0f;
+}
+
+/* 1 / x, x normal of either sign */
+static inline float Fast_Recip(float x)
+{
+    float y = Fast_BitsFloat(0x7EF311C7u - Fast_FloatBits(x));
+    y = y * (2.0f - x * y);
+    y = y * (2.0f - x * y);
+    y = y * (2.0f - x * y);
+    return y;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* FASTMATH_H */
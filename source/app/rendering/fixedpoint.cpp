@@ -0,0 +1,18 @@
+/**
+ * @file fixedpoint.cpp
+ * @brief Reciprocal Table
+ */
+
+#include "fixedpoint.h"
+#include "engine_config.h"
+
+DTCM_BSS uint32_t g_fx_recip[FX_RECIP_SIZE + 1];
+
+void Fx_Init(void)
+{
+    for (uint32_t i = 0; i <= FX_RECIP_SIZE; i++) {
+        uint64_t one = (uint64_t)1 << (30 + FX_RECIP_BITS);
+        uint64_t d = FX_RECIP_SIZE + i;
+        g_fx_recip[i] = (uint32_t)((one + d / 2) / d);
+    }
+}
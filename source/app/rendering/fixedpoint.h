@@ -0,0 +1,89 @@
+/**
+ * @file fixedpoint.h
+ * @brief Integer Reciprocals And Fixed-Point Helpers - NO MALLOC
+ *
+ * Used by the RASTER_FIXED_POINT pixel loops (engine_config.h) in place
+ * of float divides. Fx_Recip() normalizes the divisor with a count of
+ * leading zeros and looks 1/mantissa up in a 257-entry table, linearly
+ * interpolated (relative error below 1e-5); Fx_MulRecip() applies it to
+ * any numerator in the divisor's fixed-point scale, so one reciprocal
+ * serves u and v alike.
+ */
+
+#ifndef FIXEDPOINT_H
+#define FIXEDPOINT_H
+
+#include <stdint.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define FX_SHIFT            16
+#define FX_ONE              (1 << FX_SHIFT)
+#define FX_RECIP_BITS       8
+#define FX_RECIP_SIZE       (1 << FX_RECIP_BITS)
+
+/* 2^30 / (1 + i / FX_RECIP_SIZE), i = 0..FX_RECIP_SIZE */
+extern uint32_t g_fx_recip[FX_RECIP_SIZE + 1];
+
+/* Fills the reciprocal table; integer only */
+void Fx_Init(void);
+
+static inline int Fx_Clz(uint32_t x)
+{
+#if defined(_MSC_VER)
+    unsigned long bit;
+    return _BitScanReverse(&bit, x) ? 31 - (int)bit : 32;
+#else
+    return x ? __builtin_clz(x) : 32;
+#endif
+}
+
+/* 1/den as a 2.30 mantissa and the shift that places a product in 16.16 */
+typedef struct {
+    uint32_t mantissa;
+    int shift;
+} FxRecip_t;
+
+/* den > 0; den <= 0 gives a reciprocal that yields 0 */
+static inline FxRecip_t Fx_Recip(int32_t den)
+{
+    FxRecip_t r;
+    if (den <= 0) {
+        r.mantissa = 0;
+        r.shift = 0;
+        return r;
+    }
+    int n = Fx_Clz((uint32_t)den);
+    uint32_t m = (uint32_t)den << n;                        /* 1.31, top bit set */
+    uint32_t i = (m >> (31 - FX_RECIP_BITS)) & (FX_RECIP_SIZE - 1);
+    uint32_t frac = (m >> (15 - FX_RECIP_BITS)) & 0xFFFF;
+    uint32_t t0 = g_fx_recip[i], t1 = g_fx_recip[i + 1];
+    r.mantissa = t0 - (uint32_t)(((uint64_t)(t0 - t1) * frac) >> 16);
+    r.shift = 61 - FX_SHIFT - n;                            /* den = mantissa' * 2^(31 - n) */
+    return r;
+}
+
+/* num / den in 16.16, saturated; num and den in the same scale */
+static inline int32_t Fx_MulRecip(int32_t num, FxRecip_t r)
+{
+    int64_t q = ((int64_t)num * r.mantissa) >> r.shift;
+    if (q > INT32_MAX) return INT32_MAX;
+    if (q < INT32_MIN) return INT32_MIN;
+    return (int32_t)q;
+}
+
+static inline int32_t Fx_Div(int32_t num, int32_t den)
+{
+    return Fx_MulRecip(num, Fx_Recip(den));
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* FIXEDPOINT_H */
@@ -0,0 +1,342 @@
+/**
+ * @file framedump.cpp
+ * @brief Asynchronous Frame Dumps Implementation
+ */
+
+#include "framedump.h"
+
+#ifdef SDL_PC
+
+#include "device.h"
+#include "profile.h"
+#include <stdio.h>
+#include <string.h>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+#define SLOT_FREE       0
+#define SLOT_QUEUED     1
+
+#define RLE_REPEAT      0x8000
+#define RLE_MAX_RUN     0x7FFF
+#define TIFF_ENTRIES    10
+
+typedef struct {
+    uint16_t pixels[DISPLAY_WIDTH * DISPLAY_HEIGHT];    /* RGB565, width per row */
+    uint32_t frame;
+    uint16_t width;
+    uint16_t height;
+    std::atomic<int> state;
+} FrameDumpSlot_t;
+
+static FrameDumpSlot_t g_slots[FRAMEDUMP_SLOTS];
+static uint32_t g_write;                /* Next slot to fill, render thread */
+static uint32_t g_frame;                /* Submissions, render thread */
+static uint32_t g_read;                 /* Next slot to write, writer thread */
+
+/* RAW stream state, writer thread only */
+static uint16_t g_raw_prev[DISPLAY_WIDTH * DISPLAY_HEIGHT];
+static uint16_t g_raw_delta[DISPLAY_WIDTH * DISPLAY_HEIGHT];
+static uint16_t g_raw_codes[DISPLAY_WIDTH * DISPLAY_HEIGHT + DISPLAY_WIDTH * DISPLAY_HEIGHT / RLE_MAX_RUN + 2];
+static FILE* g_raw_file = NULL;
+
+static char g_prefix[FRAMEDUMP_PATH_LENGTH];
+static uint32_t g_format;
+static FrameDumpStats_t g_dump_stats;
+
+static std::thread* g_thread = NULL;
+static std::mutex g_mutex;              /* Wakeups and the writer's stats */
+static std::condition_variable g_wake;
+static bool g_quit = false;
+
+/* ============================================================
+ * Encoders
+ * ============================================================ */
+
+static inline void Put16(uint8_t* p, uint32_t v) { p[0] = (uint8_t)v; p[1] = (uint8_t)(v >> 8); }
+static inline void Put32(uint8_t* p, uint32_t v) { Put16(p, v & 0xFFFF); Put16(p + 2, v >> 16); }
+
+static uint8_t* TiffEntry(uint8_t* p, uint32_t tag, uint32_t type, uint32_t count, uint32_t value)
+{
+    Put16(p, tag);
+    Put16(p + 2, type);
+    Put32(p + 4, count);
+    if (type == 3 && count == 1) { Put16(p + 8, value); Put16(p + 10, 0); }
+    else Put32(p + 8, value);
+    return p + 12;
+}
+
+/* Little-endian baseline TIFF: header, IFD, bits per sample, then the
+ * strip; returns the header bytes */
+static uint32_t TiffHeader(uint8_t* out, uint32_t width, uint32_t height)
+{
+    const uint32_t ifd = 8;
+    const uint32_t bits = ifd + 2 + TIFF_ENTRIES * 12 + 4;
+    const uint32_t strip = bits + 6;
+
+    memcpy(out, "II", 2);
+    Put16(out + 2, 42);
+    Put32(out + 4, ifd);
+    Put16(out + ifd, TIFF_ENTRIES);
+    uint8_t* p = out + ifd + 2;
+    p = TiffEntry(p, 256, 4, 1, width);             /* ImageWidth */
+    p = TiffEntry(p, 257, 4, 1, height);            /* ImageLength */
+    p = TiffEntry(p, 258, 3, 3, bits);              /* BitsPerSample */
+    p = TiffEntry(p, 259, 3, 1, 1);                 /* Compression: none */
+    p = TiffEntry(p, 262, 3, 1, 2);                 /* Photometric: RGB */
+    p = TiffEntry(p, 273, 4, 1, strip);             /* StripOffsets */
+    p = TiffEntry(p, 277, 3, 1, 3);                 /* SamplesPerPixel */
+    p = TiffEntry(p, 278, 4, 1, height);            /* RowsPerStrip */
+    p = TiffEntry(p, 279, 4, 1, width * height * 3);    /* StripByteCounts */
+    p = TiffEntry(p, 284, 3, 1, 1);                 /* PlanarConfiguration: chunky */
+    Put32(p, 0);                                    /* No next IFD */
+    for (int i = 0; i < 3; i++) Put16(out + bits + i * 2, 8);
+    return strip;
+}
+
+/* PPM or TIFF of `pixels`, converted a row at a time */
+static uint32_t WriteImage(FILE* f, uint32_t format, const uint16_t* pixels, uint32_t pitch,
+    uint32_t width, uint32_t height)
+{
+    if (width > DISPLAY_WIDTH) return 0;
+
+    uint8_t header[256];
+    uint32_t header_bytes = (format == FRAMEDUMP_TIFF) ? TiffHeader(header, width, height) :
+        (uint32_t)snprintf((char*)header, sizeof(header), "P6\n%u %u\n255\n", width, height);
+    if (fwrite(header, 1, header_bytes, f) != header_bytes) return 0;
+
+    uint8_t row[DISPLAY_WIDTH * 3];
+    for (uint32_t y = 0; y < height; y++) {
+        const uint16_t* src = pixels + y * pitch;
+        uint8_t* dst = row;
+        for (uint32_t x = 0; x < width; x++) {
+            uint16_t p = src[x];
+            *dst++ = (uint8_t)(((p >> 11) & 0x1F) << 3);
+            *dst++ = (uint8_t)(((p >> 5) & 0x3F) << 2);
+            *dst++ = (uint8_t)((p & 0x1F) << 3);
+        }
+        if (fwrite(row, 1, width * 3, f) != width * 3) return 0;
+    }
+    return header_bytes + width * height * 3;
+}
+
+/* Repeat codes from three equal words, literal codes in between */
+static uint32_t EncodeRLE(const uint16_t* src, uint32_t count, uint16_t* out)
+{
+    uint32_t n = 0, i = 0;
+    while (i < count) {
+        uint32_t run = 1;
+        while (i + run < count && run < RLE_MAX_RUN && src[i + run] == src[i]) run++;
+        if (run >= 3) {
+            out[n++] = (uint16_t)(RLE_REPEAT | run);
+            out[n++] = src[i];
+            i += run;
+            continue;
+        }
+
+        uint32_t start = i, literals = 0;
+        while (i < count && literals < RLE_MAX_RUN) {
+            if (i + 2 < count && src[i] == src[i + 1] && src[i] == src[i + 2]) break;
+            i++;
+            literals++;
+        }
+        out[n++] = (uint16_t)literals;
+        memcpy(&out[n], &src[start], literals * sizeof(uint16_t));
+        n += literals;
+    }
+    return n;
+}
+
+uint32_t FrameDump_DecodeRaw(const uint16_t* codes, uint32_t words, uint16_t* pixels, uint32_t count)
+{
+    uint32_t c = 0, p = 0;
+    while (c < words) {
+        uint16_t code = codes[c++];
+        uint32_t n = code & RLE_MAX_RUN;
+        if (p + n > count) return 0;
+        if (code & RLE_REPEAT) {
+            if (c >= words) return 0;
+            uint16_t word = codes[c++];
+            for (uint32_t i = 0; i < n; i++) pixels[p++] ^= word;
+        }
+        else {
+            if (c + n > words) return 0;
+            for (uint32_t i = 0; i < n; i++) pixels[p++] ^= codes[c++];
+        }
+    }
+    return c;
+}
+
+/* One frame of the RAW stream; the header goes out with the first */
+static uint32_t WriteRaw(const FrameDumpSlot_t* slot)
+{
+    uint32_t written = 0;
+    if (!g_raw_file) {
+        char path[FRAMEDUMP_PATH_LENGTH + 8];
+        snprintf(path, sizeof(path), "%s.sraw", g_prefix);
+        g_raw_file = fopen(path, "wb");
+        if (!g_raw_file) return 0;
+
+        FrameDumpRawHeader_t header = { FRAMEDUMP_RAW_MAGIC, FRAMEDUMP_RAW_VERSION, 0, slot->width, slot->height };
+        if (fwrite(&header, sizeof(header), 1, g_raw_file) != 1) return 0;
+        memset(g_raw_prev, 0, sizeof(g_raw_prev));
+        written += sizeof(header);
+    }
+
+    uint32_t count = (uint32_t)slot->width * slot->height;
+    for (uint32_t i = 0; i < count; i++) {
+        uint16_t c = slot->pixels[i];
+        g_raw_delta[i] = c ^ g_raw_prev[i];
+        g_raw_prev[i] = c;
+    }
+
+    FrameDumpRawFrame_t frame = { slot->frame, EncodeRLE(g_raw_delta, count, g_raw_codes) };
+    if (fwrite(&frame, sizeof(frame), 1, g_raw_file) != 1 ||
+        fwrite(g_raw_codes, sizeof(uint16_t), frame.words, g_raw_file) != frame.words) {
+        return 0;
+    }
+    return written + (uint32_t)sizeof(frame) + frame.words * (uint32_t)sizeof(uint16_t);
+}
+
+static uint32_t WriteSlot(const FrameDumpSlot_t* slot)
+{
+    PROFILE_ZONE("FrameDump_Write");
+    if (g_format == FRAMEDUMP_RAW) return WriteRaw(slot);
+
+    char path[FRAMEDUMP_PATH_LENGTH + 16];
+    snprintf(path, sizeof(path), "%s_%05u.%s", g_prefix, slot->frame, (g_format == FRAMEDUMP_TIFF) ? "tif" : "ppm");
+    FILE* f = fopen(path, "wb");
+    if (!f) return 0;
+    uint32_t bytes = WriteImage(f, g_format, slot->pixels, slot->width, slot->width, slot->height);
+    if (fclose(f) != 0) bytes = 0;
+    return bytes;
+}
+
+/* ============================================================
+ * Writer Thread
+ * ============================================================ */
+
+static void WriterThread(void)
+{
+    std::unique_lock<std::mutex> lk(g_mutex);
+    for (;;) {
+        FrameDumpSlot_t* slot = &g_slots[g_read % FRAMEDUMP_SLOTS];
+        if (slot->state.load(std::memory_order_acquire) != SLOT_QUEUED) {
+            if (g_quit) break;
+            g_wake.wait(lk);
+            continue;
+        }
+
+        lk.unlock();
+        uint32_t bytes = WriteSlot(slot);
+        lk.lock();
+
+        if (bytes) { g_dump_stats.written++; g_dump_stats.bytes += bytes; }
+        else g_dump_stats.failed++;
+        slot->state.store(SLOT_FREE, std::memory_order_release);
+        g_read++;
+    }
+}
+
+int FrameDump_Start(const char* prefix, uint32_t format)
+{
+    FrameDump_Stop();
+    if (strlen(prefix) >= FRAMEDUMP_PATH_LENGTH) return 0;
+
+    strcpy(g_prefix, prefix);
+    g_format = format;
+    g_write = 0;
+    g_frame = 0;
+    g_read = 0;
+    g_quit = false;
+    memset(&g_dump_stats, 0, sizeof(g_dump_stats));
+    for (uint32_t i = 0; i < FRAMEDUMP_SLOTS; i++) {
+        /* Fault the pages in here rather than in the first submits */
+        memset(g_slots[i].pixels, 0, sizeof(g_slots[i].pixels));
+        g_slots[i].state.store(SLOT_FREE);
+    }
+    g_thread = new std::thread(WriterThread);
+    return 1;
+}
+
+void FrameDump_Stop(void)
+{
+    if (!g_thread) return;
+    {
+        std::lock_guard<std::mutex> lk(g_mutex);
+        g_quit = true;
+    }
+    g_wake.notify_one();
+    g_thread->join();
+    delete g_thread;
+    g_thread = NULL;
+
+    if (g_raw_file) {
+        fclose(g_raw_file);
+        g_raw_file = NULL;
+    }
+}
+
+int FrameDump_IsRunning(void)
+{
+    return g_thread != NULL;
+}
+
+/* ============================================================
+ * Render Thread
+ * ============================================================ */
+
+int FrameDump_Submit(Device* device)
+{
+    if (!g_thread) return 0;
+    uint64_t start = Profile_Now();
+    uint32_t frame = g_frame++;
+
+    FrameDumpSlot_t* slot = &g_slots[g_write % FRAMEDUMP_SLOTS];
+    int width = device->Width(), height = device->Height();
+    if (slot->state.load(std::memory_order_acquire) != SLOT_FREE ||
+        width > DISPLAY_WIDTH || height > DISPLAY_HEIGHT) {
+        std::lock_guard<std::mutex> lk(g_mutex);
+        g_dump_stats.submitted++;
+        g_dump_stats.dropped++;
+        return 0;
+    }
+
+    for (int y = 0; y < height; y++) {
+        memcpy(&slot->pixels[y * width], device->ColorRow(y), (size_t)width * sizeof(uint16_t));
+    }
+    slot->frame = frame;
+    slot->width = (uint16_t)width;
+    slot->height = (uint16_t)height;
+    slot->state.store(SLOT_QUEUED, std::memory_order_release);
+    g_write++;
+
+    {
+        std::lock_guard<std::mutex> lk(g_mutex);
+        uint64_t ticks = Profile_Now() - start;
+        g_dump_stats.submitted++;
+        if (ticks > g_dump_stats.copy_ticks_max) g_dump_stats.copy_ticks_max = ticks;
+    }
+    g_wake.notify_one();
+    return 1;
+}
+
+int FrameDump_WriteImage(Device* device, const char* path, uint32_t format)
+{
+    FILE* f = fopen(path, "wb");
+    if (!f) return 0;
+    uint32_t bytes = WriteImage(f, (format == FRAMEDUMP_TIFF) ? FRAMEDUMP_TIFF : FRAMEDUMP_PPM,
+        device->ColorRow(0), (uint32_t)device->ColorPitch(), (uint32_t)device->Width(),
+        (uint32_t)device->Height());
+    return (fclose(f) == 0) && bytes != 0;
+}
+
+void FrameDump_GetStats(FrameDumpStats_t* stats)
+{
+    std::lock_guard<std::mutex> lk(g_mutex);
+    *stats = g_dump_stats;
+}
+
+#endif /* SDL_PC */
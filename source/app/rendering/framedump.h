@@ -0,0 +1,104 @@
+/**
+ * @file framedump.h
+ * @brief Asynchronous Frame Dumps For Screenshots And Sequences - NO MALLOC
+ *
+ * FrameDump_Submit() copies the device's RGB565 frame into one of
+ * FRAMEDUMP_SLOTS staging buffers and returns; a writer thread converts,
+ * encodes and writes it while the next frames render. The render thread
+ * only pays for the row copies. When every slot is still queued the
+ * frame is dropped and counted instead of stalling the frame.
+ *
+ * Formats:
+ *   PPM   prefix_NNNNN.ppm, binary P6, 8 bits per channel
+ *   TIFF  prefix_NNNNN.tif, baseline uncompressed RGB, one strip
+ *   RAW   prefix.sraw, every frame in one file as RGB565 XORed with the
+ *         previous frame and run-length coded (see below)
+ *
+ * RAW stream: a FrameDumpRawHeader_t, then per frame a FrameDumpRawFrame_t
+ * and `words` uint16 codes, all little-endian. A code with the top bit
+ * set repeats the next word (code & 0x7FFF) times; otherwise the next
+ * `code` words are literals. XORed with the previous frame (zeros for
+ * the first), unchanged areas become long zero runs.
+ *
+ * SDL_PC only: on the board, frames leave through capture.h instead.
+ */
+
+#ifndef FRAMEDUMP_H
+#define FRAMEDUMP_H
+
+#include <stdint.h>
+#include "engine_config.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifdef SDL_PC
+
+#define FRAMEDUMP_PPM           0
+#define FRAMEDUMP_TIFF          1
+#define FRAMEDUMP_RAW           2
+
+#ifndef FRAMEDUMP_SLOTS
+#define FRAMEDUMP_SLOTS         3
+#endif
+#define FRAMEDUMP_PATH_LENGTH   96
+
+#define FRAMEDUMP_RAW_MAGIC     0x57415253u     /* "SRAW" */
+#define FRAMEDUMP_RAW_VERSION   1
+
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t reserved;
+    uint16_t width;
+    uint16_t height;
+} FrameDumpRawHeader_t;
+
+typedef struct {
+    uint32_t frame;             /* Submission index */
+    uint32_t words;             /* uint16 codes that follow */
+} FrameDumpRawFrame_t;
+
+typedef struct {
+    uint32_t submitted;
+    uint32_t written;
+    uint32_t dropped;           /* No free slot, or the frame did not fit */
+    uint32_t failed;            /* Could not be written */
+    uint64_t bytes;
+    uint64_t copy_ticks_max;    /* Render thread cost of one submit, Profile_Now() ticks */
+} FrameDumpStats_t;
+
+/* Starts the writer thread for a sequence; stops a running one first.
+ * Returns 0 if the prefix is too long. */
+int FrameDump_Start(const char* prefix, uint32_t format);
+
+/* Writes everything queued, then stops the thread */
+void FrameDump_Stop(void);
+
+int FrameDump_IsRunning(void);
+
+#ifdef __cplusplus
+class Device;
+/* Queues the RGB565 frame as the next one; 0 if dropped. Call locked,
+ * after the frame is complete. */
+int FrameDump_Submit(Device* device);
+
+/* Synchronous single image, PPM or TIFF by format; 0 on error */
+int FrameDump_WriteImage(Device* device, const char* path, uint32_t format);
+#endif
+
+void FrameDump_GetStats(FrameDumpStats_t* stats);
+
+/* Codes of one RAW frame back into RGB565 pixels, undoing the XOR
+ * against `pixels` (the previous frame, zeros before the first); returns
+ * the codes consumed, 0 if they overrun `count` pixels */
+uint32_t FrameDump_DecodeRaw(const uint16_t* codes, uint32_t words, uint16_t* pixels, uint32_t count);
+
+#endif /* SDL_PC */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* FRAMEDUMP_H */
@@ -0,0 +1,322 @@
+/**
+ * @file framepacer.cpp
+ * @brief Frame Pacing Implementation
+ */
+
+#include "framepacer.h"
+#include "profile.h"
+#include <string.h>
+
+#ifdef SDL_PC
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#else
+#include "stm32h7xx.h"
+#endif
+
+static uint32_t g_mode = PACER_FREE;
+static uint32_t g_target_hz = 0;
+static uint64_t g_period = 0;           /* Ticks; 0 when free */
+static uint64_t g_deadline = 0;         /* Of the current frame; 0 = not scheduled yet */
+static uint64_t g_frame_begin = 0;
+static uint64_t g_overshoot = 0;        /* Decaying worst sleep overshoot, ticks */
+static FramePacerStats_t g_pacer_stats;
+
+/* ============================================================
+ * Platform Waits
+ * ============================================================ */
+
+#ifdef SDL_PC
+
+/* Sleeps at most `ticks`; the scheduler may oversleep */
+static void SleepTicks(uint64_t ticks)
+{
+    std::this_thread::sleep_for(std::chrono::nanoseconds(ticks * 1000000000ull / Profile_TicksPerSecond()));
+}
+
+static inline void Relax(void)
+{
+    std::this_thread::yield();
+}
+
+static uint32_t g_interval = 1;
+
+#else
+
+/* SysTick (or any interrupt) wakes the core again */
+static void SleepTicks(uint64_t ticks)
+{
+    (void)ticks;
+    __WFI();
+}
+
+static inline void Relax(void)
+{
+}
+
+static volatile uint32_t g_vblanks = 0;
+static uint32_t g_last_vblank = 0;
+static uint32_t g_interval = 1;         /* Refreshes per frame */
+
+#endif
+
+/* Sleep while more than the margin is left, then spin to the deadline.
+ * The margin tracks how late sleeps come back. */
+static void WaitUntil(uint64_t deadline)
+{
+    uint64_t floor = Profile_TicksPerSecond() / 4000;   /* 0.25 ms */
+    uint64_t margin = g_overshoot + floor;
+
+    uint64_t now = Profile_Now();
+    while (now + margin < deadline) {
+        uint64_t request = deadline - margin - now;
+        SleepTicks(request);
+        uint64_t woke = Profile_Now();
+        uint64_t slept = woke - now;
+        if (slept > request && slept - request > g_overshoot) g_overshoot = slept - request;
+        now = woke;
+    }
+    while (Profile_Now() < deadline) Relax();
+
+    g_overshoot -= g_overshoot / 16;
+    g_pacer_stats.spin_margin = g_overshoot + floor;
+}
+
+/* ============================================================
+ * Pacing
+ * ============================================================ */
+
+static void Reschedule(void)
+{
+    g_period = 0;
+    g_interval = 1;
+    if (g_mode != PACER_FREE && g_target_hz) {
+#ifndef SDL_PC
+        if (g_mode == PACER_VSYNC) {
+            g_interval = (PACER_REFRESH_HZ + g_target_hz / 2) / g_target_hz;
+            if (g_interval < 1) g_interval = 1;
+            g_period = Profile_TicksPerSecond() * g_interval / PACER_REFRESH_HZ;
+            g_last_vblank = g_vblanks;
+        }
+        else
+#endif
+        g_period = Profile_TicksPerSecond() / g_target_hz;
+    }
+    g_deadline = 0;
+    g_pacer_stats.period = g_period;
+}
+
+void FramePacer_Init(uint32_t mode, uint32_t target_hz)
+{
+    memset(&g_pacer_stats, 0, sizeof(g_pacer_stats));
+    g_frame_begin = 0;
+    g_overshoot = Profile_TicksPerSecond() / 1000;
+
+#ifndef SDL_PC
+    /* Line event at the first line past the active area */
+    LTDC->LIPCR = LTDC_VSYNC + LTDC_VBP + DISPLAY_HEIGHT;
+    LTDC->ICR = LTDC_ICR_CLIF;
+    LTDC->IER |= LTDC_IER_LIE;
+    NVIC_EnableIRQ(LTDC_IRQn);
+#endif
+
+    g_mode = mode;
+    g_target_hz = target_hz;
+    Reschedule();
+}
+
+void FramePacer_SetMode(uint32_t mode)
+{
+    g_mode = mode;
+    Reschedule();
+}
+
+uint32_t FramePacer_GetMode(void)
+{
+    return g_mode;
+}
+
+void FramePacer_SetTargetRate(uint32_t target_hz)
+{
+    g_target_hz = target_hz;
+    Reschedule();
+}
+
+uint32_t FramePacer_GetTargetRate(void)
+{
+    if (g_period == 0) return 0;
+    return (uint32_t)((Profile_TicksPerSecond() + g_period / 2) / g_period);
+}
+
+float FramePacer_BeginFrame(void)
+{
+    uint64_t now = Profile_Now();
+    uint64_t interval = g_frame_begin ? now - g_frame_begin : g_period;
+    g_frame_begin = now;
+    if (g_period && g_deadline == 0) g_deadline = now + g_period;
+
+    g_pacer_stats.frames++;
+    g_pacer_stats.interval_last = interval;
+
+    /* Paced frames show on period boundaries: step in whole periods */
+    uint64_t step = interval;
+    if (g_period) {
+        uint64_t periods = (interval + g_period / 2) / g_period;
+        if (periods == 0) periods = 1;
+        step = periods * g_period;
+        uint64_t jitter = (interval > step) ? interval - step : step - interval;
+        if (g_pacer_stats.frames > 1 && jitter > g_pacer_stats.jitter_max) g_pacer_stats.jitter_max = jitter;
+    }
+
+    float dt = (float)((double)step / (double)Profile_TicksPerSecond());
+    return (dt > PACER_MAX_STEP) ? PACER_MAX_STEP : dt;
+}
+
+void FramePacer_EndFrame(void)
+{
+    uint64_t now = Profile_Now();
+    uint64_t work = now - g_frame_begin;
+    g_pacer_stats.work_last = work;
+    if (work > g_pacer_stats.work_max) g_pacer_stats.work_max = work;
+
+    if (g_period == 0) return;
+
+#ifndef SDL_PC
+    if (g_mode == PACER_VSYNC) {
+        uint32_t target = g_last_vblank + g_interval;
+        if ((int32_t)(g_vblanks - target) > (int32_t)g_interval) {
+            g_pacer_stats.missed++;
+        }
+        else {
+            while ((int32_t)(g_vblanks - target) < 0) __WFI();
+        }
+        g_last_vblank = g_vblanks;
+        return;
+    }
+#endif
+
+    if (now > g_deadline) {
+        /* A little late: the next frame makes it up. A whole period late:
+         * start over from now rather than rush several frames out. */
+        if (now - g_deadline > g_period) {
+            g_pacer_stats.missed++;
+            g_deadline = now;
+        }
+    }
+    else {
+        WaitUntil(g_deadline);
+    }
+    g_deadline += g_period;
+}
+
+void FramePacer_GetStats(FramePacerStats_t* stats)
+{
+    *stats = g_pacer_stats;
+}
+
+void FramePacer_ResetStats(void)
+{
+    uint64_t margin = g_pacer_stats.spin_margin;
+    memset(&g_pacer_stats, 0, sizeof(g_pacer_stats));
+    g_pacer_stats.period = g_period;
+    g_pacer_stats.spin_margin = margin;
+}
+
+/* ============================================================
+ * Present Overlap
+ * ============================================================ */
+
+#ifdef SDL_PC
+
+static std::thread* g_helper = NULL;
+static std::mutex g_overlap_mutex;
+static std::condition_variable g_overlap_wake;
+static PacerTask_t g_task = NULL;
+static void* g_task_user = NULL;
+static int g_task_busy = 0;
+static int g_helper_quit = 0;
+
+static void HelperThread(void)
+{
+    std::unique_lock<std::mutex> lk(g_overlap_mutex);
+    for (;;) {
+        g_overlap_wake.wait(lk, [] { return g_task_busy || g_helper_quit; });
+        if (g_helper_quit) break;
+        PacerTask_t task = g_task;
+        void* user = g_task_user;
+        lk.unlock();
+        task(user);
+        lk.lock();
+        g_task_busy = 0;
+        g_overlap_wake.notify_all();
+    }
+}
+
+void FramePacer_Overlap(PacerTask_t present, void* present_user,
+    PacerTask_t simulate, void* simulate_user)
+{
+    if (!simulate || !present) {
+        if (present) present(present_user);
+        if (simulate) simulate(simulate_user);
+        return;
+    }
+
+    if (!g_helper) g_helper = new std::thread(HelperThread);
+    {
+        std::lock_guard<std::mutex> lk(g_overlap_mutex);
+        g_task = simulate;
+        g_task_user = simulate_user;
+        g_task_busy = 1;
+    }
+    g_overlap_wake.notify_all();
+
+    /* SDL wants the window on the thread that created it */
+    present(present_user);
+
+    std::unique_lock<std::mutex> lk(g_overlap_mutex);
+    g_overlap_wake.wait(lk, [] { return !g_task_busy; });
+}
+
+void FramePacer_Shutdown(void)
+{
+    if (!g_helper) return;
+    {
+        std::lock_guard<std::mutex> lk(g_overlap_mutex);
+        g_helper_quit = 1;
+    }
+    g_overlap_wake.notify_all();
+    g_helper->join();
+    delete g_helper;
+    g_helper = NULL;
+    g_helper_quit = 0;
+}
+
+void FramePacer_IRQHandler(void)
+{
+}
+
+#else
+
+/* SwapChain_Present() only queues the buffer: the scanout is the overlap */
+void FramePacer_Overlap(PacerTask_t present, void* present_user,
+    PacerTask_t simulate, void* simulate_user)
+{
+    if (present) present(present_user);
+    if (simulate) simulate(simulate_user);
+}
+
+void FramePacer_Shutdown(void)
+{
+}
+
+void FramePacer_IRQHandler(void)
+{
+    if (LTDC->ISR & LTDC_ISR_LIF) {
+        LTDC->ICR = LTDC_ICR_CLIF;
+        g_vblanks++;
+    }
+}
+
+#endif
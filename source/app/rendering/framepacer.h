@@ -0,0 +1,95 @@
+/**
+ * @file framepacer.h
+ * @brief Frame Pacing Against A Target Rate Or The Display Refresh
+ *
+ * FramePacer_BeginFrame() starts a frame and returns the time step to
+ * simulate; FramePacer_EndFrame() holds the frame until its deadline.
+ * Deadlines advance by exactly one period from the previous deadline,
+ * not from whenever the last frame happened to finish, so wakeup error
+ * never accumulates; a frame that misses by more than a whole period
+ * restarts the schedule instead of bursting to catch up.
+ *
+ * Timing uses Profile_Now(). On SDL_PC the wait sleeps in coarse steps
+ * and spins the last stretch; the spin margin follows the worst sleep
+ * overshoot seen recently, so a coarse scheduler gets a wider margin
+ * and a precise one burns less CPU. On the board PACER_VSYNC counts
+ * LTDC line interrupts at the end of the active area and sleeps in WFI
+ * until `interval` refreshes have passed since the last frame.
+ *
+ * Paced frames reach the display on period boundaries, so the step
+ * returned to the simulation is the measured interval rounded to whole
+ * periods; it is the raw measurement when pacing is off.
+ *
+ * FramePacer_Overlap() runs the next frame's simulation while the
+ * current one is presented: on a helper thread around the blocking
+ * SDL present, inline after the board's SwapChain_Present(), which
+ * returns at once and lets the LTDC scan out in the background.
+ */
+
+#ifndef FRAMEPACER_H
+#define FRAMEPACER_H
+
+#include <stdint.h>
+#include "engine_config.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define PACER_FREE              0   /* No cap, step is the raw interval */
+#define PACER_TIMER             1   /* Target rate from the high-resolution clock */
+#define PACER_VSYNC             2   /* LTDC refresh on the board; PACER_TIMER on SDL_PC */
+
+#ifndef PACER_REFRESH_HZ
+#define PACER_REFRESH_HZ        60  /* LTDC refresh for the configured pixel clock */
+#endif
+#define PACER_MAX_STEP          0.1f    /* Longest step handed to the simulation, s */
+
+typedef struct {
+    uint32_t frames;
+    uint32_t missed;            /* Deadlines overrun by more than one period */
+    uint64_t period;            /* Target interval, Profile_Now() ticks; 0 when free */
+    uint64_t interval_last;     /* Begin to begin */
+    uint64_t work_last;         /* Begin to EndFrame() */
+    uint64_t work_max;
+    uint64_t jitter_max;        /* Largest distance of a paced interval from whole periods */
+    uint64_t spin_margin;       /* Current spin margin of timed waits */
+} FramePacerStats_t;
+
+/* mode PACER_*, target_hz the paced rate (0 = free) */
+void FramePacer_Init(uint32_t mode, uint32_t target_hz);
+
+void FramePacer_SetMode(uint32_t mode);
+uint32_t FramePacer_GetMode(void);
+
+/* With PACER_VSYNC the rate is rounded to a whole number of refreshes */
+void FramePacer_SetTargetRate(uint32_t target_hz);
+uint32_t FramePacer_GetTargetRate(void);
+
+/* Starts a frame; returns the step to simulate in seconds */
+float FramePacer_BeginFrame(void);
+
+/* Ends the work of the frame and waits for its deadline */
+void FramePacer_EndFrame(void);
+
+typedef void (*PacerTask_t)(void* user);
+
+/* Runs present and simulate concurrently, returns when both are done.
+ * simulate must not touch the window or the frame being presented. */
+void FramePacer_Overlap(PacerTask_t present, void* present_user,
+    PacerTask_t simulate, void* simulate_user);
+
+/* Stops the overlap helper thread */
+void FramePacer_Shutdown(void);
+
+/* Called from LTDC_IRQHandler, next to SwapChain_IRQHandler() */
+void FramePacer_IRQHandler(void);
+
+void FramePacer_GetStats(FramePacerStats_t* stats);
+void FramePacer_ResetStats(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* FRAMEPACER_H */
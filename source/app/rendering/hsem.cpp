@@ -0,0 +1,55 @@
+/**
+ * @file hsem.cpp
+ * @brief Hardware Semaphores For CM7/CM4 Synchronization Implementation
+ */
+
+#include "hsem.h"
+
+#ifdef SDL_PC
+
+#include <atomic>
+
+static std::atomic<int> g_hsem[HSEM_COUNT];
+
+int Hsem_TryTake(uint32_t id)
+{
+    int expected = 0;
+    return g_hsem[id].compare_exchange_strong(expected, 1, std::memory_order_acquire) ? 1 : 0;
+}
+
+void Hsem_Release(uint32_t id)
+{
+    g_hsem[id].store(0, std::memory_order_release);
+}
+
+#else
+
+#include "stm32h7xx.h"
+
+#if defined(CORE_CM4)
+#define HSEM_COREID     HSEM_CPU2_COREID
+#else
+#define HSEM_COREID     HSEM_CPU1_COREID
+#endif
+
+int Hsem_TryTake(uint32_t id)
+{
+    /* One-step lock: the read takes the semaphore if it was free */
+    if (HSEM->RLR[id] != (HSEM_R_LOCK | (HSEM_COREID << HSEM_R_COREID_Pos))) return 0;
+    __DMB();
+    return 1;
+}
+
+void Hsem_Release(uint32_t id)
+{
+    __DMB();
+    HSEM->R[id] = HSEM_COREID << HSEM_R_COREID_Pos;
+}
+
+#endif
+
+void Hsem_Take(uint32_t id)
+{
+    while (!Hsem_TryTake(id)) {
+    }
+}
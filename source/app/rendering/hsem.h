@@ -0,0 +1,34 @@
+/**
+ * @file hsem.h
+ * @brief Hardware Semaphores For CM7/CM4 Synchronization
+ *
+ * Thin wrapper over the STM32H7 HSEM one-step lock, using the HSEM_ID_*
+ * numbers from engine_config.h. A semaphore is owned by the core that
+ * took it. On SDL_PC the same API is backed by atomics, so a second
+ * thread can stand in for the other core.
+ */
+
+#ifndef HSEM_H
+#define HSEM_H
+
+#include <stdint.h>
+#include "engine_config.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define HSEM_COUNT              32
+
+/* 1 if the semaphore was free and is now held by this core */
+int Hsem_TryTake(uint32_t id);
+
+/* Spins until the semaphore is held */
+void Hsem_Take(uint32_t id);
+void Hsem_Release(uint32_t id);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HSEM_H */
@@ -0,0 +1,235 @@
+/**
+ * @file impostor.cpp
+ * @brief Cached Sprites For Distant Animated Models Implementation
+ */
+
+#include "impostor.h"
+#include "platform.h"
+#include "meshdraw.h"
+#include "mesh.h"
+#include "meshlod.h"
+#include "texture.h"
+#include "color.h"
+#include "profile.h"
+#include <math.h>
+#include <string.h>
+
+typedef struct {
+    EntityID entity;
+    uint32_t texture_id;        /* 0xFFFFFFFF until first used */
+    uint32_t used_frame;        /* Frame of the last Impostor_Select(), 0 = free */
+    uint32_t rendered_frame;    /* Frame the sprite was rendered, 0 = never */
+    Vec3 rendered_dir;          /* Object-space eye direction it was rendered from */
+    float half;                 /* Quad half size in world units */
+
+    /* This frame, from Impostor_Select() */
+    Vec3 center;                /* World-space bounds */
+    float radius;
+    Vec3 dir;                   /* Unit, eye to center */
+    float distance;
+    Vec3 object_dir;
+} ImpostorSlot_t;
+
+static ImpostorSlot_t g_slots[IMPOSTOR_MAX_SLOTS];
+static uint16_t g_sprite_depth[IMPOSTOR_SIZE * IMPOSTOR_SIZE];
+static uint32_t g_frame = 1;
+static uint32_t g_refreshes;
+static int g_enabled = 0;
+static ImpostorStats_t g_stats;
+
+/* ============================================================
+ * Setup
+ * ============================================================ */
+
+void Impostor_Init(void)
+{
+    memset(g_slots, 0, sizeof(g_slots));
+    for (uint32_t i = 0; i < IMPOSTOR_MAX_SLOTS; i++) g_slots[i].texture_id = 0xFFFFFFFF;
+    memset(&g_stats, 0, sizeof(g_stats));
+    g_frame = 1;
+}
+
+void Impostor_SetEnabled(int enabled) { g_enabled = enabled ? 1 : 0; }
+int Impostor_IsEnabled(void) { return g_enabled; }
+
+void Impostor_BeginFrame(void)
+{
+    g_frame++;
+    g_refreshes = 0;
+    g_stats.drawn = 0;
+    g_stats.refreshed = 0;
+    g_stats.deferred = 0;
+}
+
+/* ============================================================
+ * Selection
+ * ============================================================ */
+
+static uint32_t FindSlot(EntityID entity)
+{
+    uint32_t lru = IMPOSTOR_NONE;
+    uint32_t free_slot = IMPOSTOR_NONE;
+    for (uint32_t i = 0; i < IMPOSTOR_MAX_SLOTS; i++) {
+        ImpostorSlot_t* s = &g_slots[i];
+        if (s->used_frame == 0) {
+            if (free_slot == IMPOSTOR_NONE) free_slot = i;
+            continue;
+        }
+        if (s->entity == entity) return (s->used_frame == g_frame) ? IMPOSTOR_NONE : i;
+        if (s->used_frame < g_frame && (lru == IMPOSTOR_NONE || s->used_frame < g_slots[lru].used_frame)) lru = i;
+    }
+    if (free_slot != IMPOSTOR_NONE) return free_slot;
+    if (lru != IMPOSTOR_NONE) g_slots[lru].rendered_frame = 0;
+    return lru;
+}
+
+uint32_t Impostor_Select(const DrawCmd_t* cmd, const Mat4* view_proj)
+{
+    if (!g_enabled) return IMPOSTOR_NONE;
+    if (!(cmd->flags & DRAW_FLAG_ANIMATED) || (cmd->flags & DRAW_FLAG_TRANSPARENT)) return IMPOSTOR_NONE;
+
+    MeshSlot_t* mesh = Mesh_Get(cmd->mesh_id);
+    if (!mesh || mesh->type != 2 || mesh->anim.bounds_radius <= 0.0f) return IMPOSTOR_NONE;
+
+    if (Mesh_ProjectedRadius(view_proj, &cmd->world, mesh->anim.bounds_center,
+        mesh->anim.bounds_radius) > IMPOSTOR_MAX_RADIUS) return IMPOSTOR_NONE;
+
+    Vec4 eye4 = Mat4_ProjectionEye(view_proj);
+    if (fabsf(eye4.w) < 1e-12f) return IMPOSTOR_NONE;
+    Vec3 eye = Vec3_Scale(MakeVec3(eye4.x, eye4.y, eye4.z), 1.0f / eye4.w);
+
+    const float* w = cmd->world.m;
+    float scale_sq = MAX(MAX(w[0] * w[0] + w[1] * w[1] + w[2] * w[2], w[4] * w[4] + w[5] * w[5] + w[6] * w[6]),
+        w[8] * w[8] + w[9] * w[9] + w[10] * w[10]);
+    Vec3 center = Mat4_TransformPoint(&cmd->world, mesh->anim.bounds_center);
+    float radius = mesh->anim.bounds_radius * sqrtf(scale_sq);
+    Vec3 to_center = Vec3_Sub(center, eye);
+    float distance = Vec3_Length(to_center);
+    if (distance <= radius * IMPOSTOR_MIN_DISTANCE) return IMPOSTOR_NONE;
+
+    uint32_t slot = FindSlot(cmd->entity);
+    if (slot == IMPOSTOR_NONE) return IMPOSTOR_NONE;
+    ImpostorSlot_t* s = &g_slots[slot];
+    if (s->texture_id == 0xFFFFFFFF) {
+        s->texture_id = Texture_Create(IMPOSTOR_SIZE, IMPOSTOR_SIZE, TEXTURE_FORMAT_RGB565, 0);
+        if (s->texture_id == 0xFFFFFFFF) return IMPOSTOR_NONE;
+    }
+
+    if (s->used_frame == 0) g_stats.active++;
+    s->entity = cmd->entity;
+    s->used_frame = g_frame;
+    s->center = center;
+    s->radius = radius;
+    s->dir = Vec3_Scale(to_center, 1.0f / distance);
+    s->distance = distance;
+
+    /* Rotation part transposed takes the direction into object space */
+    s->object_dir = Vec3_Normalize(MakeVec3(
+        w[0] * s->dir.x + w[1] * s->dir.y + w[2] * s->dir.z,
+        w[4] * s->dir.x + w[5] * s->dir.y + w[6] * s->dir.z,
+        w[8] * s->dir.x + w[9] * s->dir.y + w[10] * s->dir.z));
+    return slot;
+}
+
+uint32_t Impostor_GetTextureId(uint32_t slot)
+{
+    return (slot < IMPOSTOR_MAX_SLOTS) ? g_slots[slot].texture_id : 0xFFFFFFFF;
+}
+
+/* ============================================================
+ * Sprites
+ * ============================================================ */
+
+static Vec3 UpFor(Vec3 dir)
+{
+    return (fabsf(dir.y) > 0.99f) ? MakeVec3(0.0f, 0.0f, 1.0f) : MakeVec3(0.0f, 1.0f, 0.0f);
+}
+
+static int IsStale(const ImpostorSlot_t* s)
+{
+    if (s->rendered_frame == 0) return 1;
+    if (g_frame - s->rendered_frame >= IMPOSTOR_REFRESH_FRAMES) return 1;
+    static const float cos_limit = cosf(IMPOSTOR_REFRESH_DEGREES * 3.14159265f / 180.0f);
+    return Vec3_Dot(s->object_dir, s->rendered_dir) < cos_limit;
+}
+
+/* Frames the bounding sphere from the current direction into the
+ * slot's texture, cleared to the key color */
+static void RenderSprite(ImpostorSlot_t* s, const DrawCmd_t* cmd, const Texture_t* texture)
+{
+    uint16_t* pixels = Texture_GetPixels(s->texture_id);
+    if (!pixels) return;
+
+    float d = s->distance;
+    float r = s->radius;
+    Mat4 view, proj, view_proj, mvp;
+    Mat4_LookAt(&view, Vec3_Sub(s->center, Vec3_Scale(s->dir, d)), s->center, UpFor(s->dir));
+    Mat4_Perspective(&proj, 2.0f * asinf(r / d), 1.0f, d - r, d + r);
+    Mat4_Multiply(&view_proj, &proj, &view);
+    Mat4_Multiply(&mvp, &view_proj, &cmd->world);
+
+    RasterContext_t ctx;
+    RasterContext_Init(&ctx, pixels, g_sprite_depth, IMPOSTOR_SIZE, IMPOSTOR_SIZE, IMPOSTOR_SIZE);
+    RasterContext_SetState(&ctx, (Rasterizer_GetState() &
+        ~(RASTER_STATE_BLEND_AVERAGE | RASTER_STATE_BLEND_ADD | RASTER_STATE_BLEND_KEY)) | RASTER_STATE_DEFAULT);
+    RasterContext_Clear(&ctx, COLOR_KEY_565);
+    RasterContext_ClearDepth(&ctx);
+    MeshDraw_MD2To(&ctx, cmd->mesh_id, &mvp, &cmd->world, cmd->lod,
+        cmd->anim_frame_a, cmd->anim_frame_b, cmd->anim_lerp, texture);
+
+    /* The frame pays for the sprite */
+    for (uint32_t i = 0; i < RASTER_STAGE_COUNT; i++) {
+        Rasterizer_AddStageTime(i, 0, ctx.stats.stage_ticks[i]);
+    }
+
+    /* Half extent of the frustum at the center's depth */
+    s->half = r * d / sqrtf(d * d - r * r);
+    s->rendered_dir = s->object_dir;
+    s->rendered_frame = g_frame;
+    g_refreshes++;
+    g_stats.refreshed++;
+}
+
+void Impostor_Draw(uint32_t slot, const DrawCmd_t* cmd, const Mat4* view_proj, const Texture_t* texture)
+{
+    if (slot >= IMPOSTOR_MAX_SLOTS) return;
+    ImpostorSlot_t* s = &g_slots[slot];
+
+    if (IsStale(s)) {
+        if (s->rendered_frame == 0 || g_refreshes < IMPOSTOR_MAX_REFRESHES) RenderSprite(s, cmd, texture);
+        else g_stats.deferred++;
+    }
+    if (s->rendered_frame == 0) return;
+
+    Texture_t sprite;
+    if (!Texture_GetRaster(s->texture_id, &sprite)) return;
+
+    /* Facing the eye now, oriented as the sprite was rendered */
+    Vec3 right = Vec3_Scale(Vec3_Normalize(Vec3_Cross(s->dir, UpFor(s->dir))), s->half);
+    Vec3 up = Vec3_Scale(Vec3_Normalize(Vec3_Cross(right, s->dir)), s->half);
+    static const float corner_u[4] = { 0.0f, 1.0f, 1.0f, 0.0f };
+    static const float corner_v[4] = { 0.0f, 0.0f, 1.0f, 1.0f };
+    ClipVertex_t v[4];
+    for (int i = 0; i < 4; i++) {
+        Vec3 p = Vec3_Add(s->center, Vec3_Add(
+            Vec3_Scale(right, corner_u[i] * 2.0f - 1.0f), Vec3_Scale(up, 1.0f - corner_v[i] * 2.0f)));
+        v[i].pos = Mat4_MultiplyVec4(view_proj, MakeVec4(p.x, p.y, p.z, 1.0f));
+        v[i].u = corner_u[i];
+        v[i].v = corner_v[i];
+        v[i].color = COLOR_WHITE;
+    }
+
+    uint32_t state = Rasterizer_GetState();
+    Rasterizer_SetState((state & ~(RASTER_STATE_DEPTH_WRITE | RASTER_STATE_BILINEAR |
+        RASTER_STATE_BLEND_AVERAGE | RASTER_STATE_BLEND_ADD)) |
+        RASTER_STATE_BLEND_KEY | RASTER_STATE_UNLIT | RASTER_STATE_CLAMP);
+    Clip_DrawTriangle(&v[0], &v[1], &v[2], &sprite);
+    Clip_DrawTriangle(&v[0], &v[2], &v[3], &sprite);
+    Rasterizer_SetState(state);
+    g_stats.drawn++;
+}
+
+void Impostor_GetStats(ImpostorStats_t* stats)
+{
+    *stats = g_stats;
+}
@@ -0,0 +1,79 @@
+/**
+ * @file impostor.h
+ * @brief Cached Sprites For Distant Animated Models - NO MALLOC
+ *
+ * An MD2 draw whose bounds project below IMPOSTOR_MAX_RADIUS pixels is
+ * rendered into a small RGB565 texture in g_pixel_pool, through a
+ * RasterContext of its own and framed on its bounding sphere as seen
+ * from the eye, and then stands in as one camera-facing quad until the
+ * sprite goes stale: IMPOSTOR_REFRESH_FRAMES frames old, or the eye
+ * direction seen from the model moved by more than
+ * IMPOSTOR_REFRESH_DEGREES. The direction is compared in object space,
+ * so the model turning counts as well. At most IMPOSTOR_MAX_REFRESHES
+ * stale sprites are redrawn per frame, so a crowd spreads its decodes
+ * and costs two textured triangles per member in between.
+ *
+ * Quads draw in the alpha pass with RASTER_STATE_BLEND_KEY: the sprite
+ * is cleared to COLOR_KEY_565 and those texels are skipped. Like other
+ * blended draws they test depth but do not write it, so MeshDraw_List()
+ * queues them back to front after the opaque geometry. A slot follows
+ * its entity; when all are taken the least recently used one not drawn
+ * this frame is reclaimed. Off until Impostor_SetEnabled().
+ */
+
+#ifndef IMPOSTOR_H
+#define IMPOSTOR_H
+
+#include <stdint.h>
+#include "math3d.h"
+#include "rasterizer.h"
+#include "scenebuffer.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define IMPOSTOR_MAX_SLOTS          32
+#define IMPOSTOR_SIZE               32      /* Sprite texels per side */
+#define IMPOSTOR_MAX_RADIUS         20.0f   /* Projected bounds radius, display pixels */
+#define IMPOSTOR_MIN_DISTANCE       1.5f    /* Eye distance in bounding radii */
+#define IMPOSTOR_REFRESH_FRAMES     6
+#define IMPOSTOR_REFRESH_DEGREES    5.0f
+#define IMPOSTOR_MAX_REFRESHES      4       /* Stale sprites redrawn per frame */
+#define IMPOSTOR_NONE               0xFFFF
+
+typedef struct {
+    uint32_t active;            /* Slots holding a sprite */
+    uint32_t drawn;             /* Quads drawn since the last BeginFrame */
+    uint32_t refreshed;         /* Sprites rendered since the last BeginFrame */
+    uint32_t deferred;          /* Stale sprites left for a later frame */
+} ImpostorStats_t;
+
+/* After Texture_Init(); sprite textures are created on first use */
+void Impostor_Init(void);
+
+void Impostor_SetEnabled(int enabled);
+int  Impostor_IsEnabled(void);
+
+/* Once per frame, before the first Impostor_Select() */
+void Impostor_BeginFrame(void);
+
+/* Slot to draw cmd through, or IMPOSTOR_NONE to draw the mesh: off, not
+ * an opaque MD2 draw, too large or close, or no slot or sprite memory */
+uint32_t Impostor_Select(const DrawCmd_t* cmd, const Mat4* view_proj);
+
+/* Sprite texture of a selected slot, for sort keys */
+uint32_t Impostor_GetTextureId(uint32_t slot);
+
+/* Renders the slot's sprite if it is stale, with texture as the model's
+ * skin (NULL draws solid), then draws its quad into the screen context
+ * under view_proj. The lights must already be set (Lighting_SetLights). */
+void Impostor_Draw(uint32_t slot, const DrawCmd_t* cmd, const Mat4* view_proj, const Texture_t* texture);
+
+void Impostor_GetStats(ImpostorStats_t* stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* IMPOSTOR_H */
@@ -0,0 +1,215 @@
+/**
+ * @file jobs.cpp
+ * @brief Work-Stealing Job Pool Implementation
+ */
+
+#include "jobs.h"
+#include <string.h>
+
+#ifdef SDL_PC
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#endif
+
+ /* ============================================================
+  * State
+  * ============================================================ */
+
+static JobStats_t g_job_stats;
+static uint32_t g_thread_count = 1;
+static JobFunc_t g_func = NULL;
+static void* g_user = NULL;
+
+#ifdef SDL_PC
+
+/* One contiguous run of indices per thread: owner pops begin, thieves pop end */
+typedef struct {
+    std::mutex lock;
+    std::atomic<uint32_t> begin;
+    std::atomic<uint32_t> end;
+} JobRun_t;
+
+static JobRun_t g_runs[JOB_MAX_THREADS];
+static std::thread* g_workers[JOB_MAX_THREADS];
+
+static std::mutex g_mutex;
+static std::condition_variable g_wake;
+static std::condition_variable g_done;
+static uint32_t g_generation = 0;
+static bool g_quit = false;
+static std::atomic<uint32_t> g_active(0);
+
+/* ============================================================
+ * Work Distribution
+ * ============================================================ */
+
+static bool PopOwn(uint32_t thread, uint32_t* index)
+{
+    JobRun_t* run = &g_runs[thread];
+    std::lock_guard<std::mutex> lk(run->lock);
+    if (run->begin >= run->end) return false;
+    *index = run->begin++;
+    return true;
+}
+
+static bool Steal(uint32_t thread, uint32_t* index)
+{
+    for (;;) {
+        /* Pick the run with the most work left (unlocked peek) */
+        uint32_t victim = 0xFFFFFFFF, best = 0;
+        for (uint32_t i = 0; i < g_thread_count; i++) {
+            if (i == thread) continue;
+            uint32_t b = g_runs[i].begin.load(std::memory_order_relaxed);
+            uint32_t e = g_runs[i].end.load(std::memory_order_relaxed);
+            if (e > b && e - b > best) {
+                best = e - b;
+                victim = i;
+            }
+        }
+        if (victim == 0xFFFFFFFF) return false;
+
+        JobRun_t* run = &g_runs[victim];
+        std::lock_guard<std::mutex> lk(run->lock);
+        if (run->begin < run->end) {
+            *index = --run->end;
+            return true;
+        }
+        /* Lost the race, look again */
+    }
+}
+
+static void RunItems(uint32_t thread)
+{
+    uint32_t index;
+    for (;;) {
+        if (PopOwn(thread, &index)) {
+            g_func(index, thread, g_user);
+            g_job_stats.items_run[thread]++;
+        }
+        else if (Steal(thread, &index)) {
+            g_func(index, thread, g_user);
+            g_job_stats.items_run[thread]++;
+            g_job_stats.items_stolen[thread]++;
+        }
+        else {
+            break;
+        }
+    }
+}
+
+static void WorkerMain(uint32_t thread)
+{
+    uint32_t seen = 0;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lk(g_mutex);
+            g_wake.wait(lk, [&] { return g_quit || g_generation != seen; });
+            if (g_quit) return;
+            seen = g_generation;
+        }
+
+        RunItems(thread);
+
+        if (g_active.fetch_sub(1) == 1) {
+            std::lock_guard<std::mutex> lk(g_mutex);
+            g_done.notify_all();
+        }
+    }
+}
+
+#endif /* SDL_PC */
+
+/* ============================================================
+ * Public API
+ * ============================================================ */
+
+void Jobs_Init(uint32_t thread_count)
+{
+    Jobs_Shutdown();
+    memset(&g_job_stats, 0, sizeof(g_job_stats));
+
+#ifdef SDL_PC
+    if (thread_count == 0) thread_count = std::thread::hardware_concurrency();
+    if (thread_count == 0) thread_count = 1;
+    if (thread_count > JOB_MAX_THREADS) thread_count = JOB_MAX_THREADS;
+
+    g_quit = false;
+    g_generation = 0;
+    g_thread_count = thread_count;
+    for (uint32_t i = 1; i < g_thread_count; i++) {
+        g_workers[i] = new std::thread(WorkerMain, i);
+    }
+#else
+    (void)thread_count;
+    g_thread_count = 1;
+#endif
+}
+
+void Jobs_Shutdown(void)
+{
+#ifdef SDL_PC
+    {
+        std::lock_guard<std::mutex> lk(g_mutex);
+        g_quit = true;
+    }
+    g_wake.notify_all();
+
+    for (uint32_t i = 1; i < g_thread_count; i++) {
+        if (g_workers[i]) {
+            g_workers[i]->join();
+            delete g_workers[i];
+            g_workers[i] = NULL;
+        }
+    }
+#endif
+    g_thread_count = 1;
+}
+
+uint32_t Jobs_GetThreadCount(void)
+{
+    return g_thread_count;
+}
+
+void Jobs_ParallelFor(uint32_t count, JobFunc_t func, void* user)
+{
+    memset(&g_job_stats, 0, sizeof(g_job_stats));
+    if (count == 0) return;
+
+    g_func = func;
+    g_user = user;
+
+#ifdef SDL_PC
+    if (g_thread_count > 1) {
+        /* Contiguous runs keep neighbouring tiles on one thread */
+        for (uint32_t i = 0; i < g_thread_count; i++) {
+            g_runs[i].begin = (uint32_t)(((uint64_t)count * i) / g_thread_count);
+            g_runs[i].end = (uint32_t)(((uint64_t)count * (i + 1)) / g_thread_count);
+        }
+
+        g_active.store(g_thread_count - 1);
+        {
+            std::lock_guard<std::mutex> lk(g_mutex);
+            g_generation++;
+        }
+        g_wake.notify_all();
+
+        RunItems(0);
+
+        std::unique_lock<std::mutex> lk(g_mutex);
+        g_done.wait(lk, [] { return g_active.load() == 0; });
+        return;
+    }
+#endif
+
+    for (uint32_t i = 0; i < count; i++) {
+        func(i, 0, user);
+    }
+    g_job_stats.items_run[0] = count;
+}
+
+void Jobs_GetStats(JobStats_t* stats)
+{
+    *stats = g_job_stats;
+}
@@ -0,0 +1,47 @@
+/**
+ * @file jobs.h
+ * @brief Work-Stealing Job Pool (parallel-for over independent items)
+ *
+ * On SDL_PC a fixed set of worker threads is started once. Each call to
+ * Jobs_ParallelFor splits the index range into one contiguous run per
+ * thread; a thread works its own run from the front and, once empty,
+ * steals from the back of the fullest other run. The calling thread takes
+ * part as thread 0. On STM32 the pool has one thread and runs inline.
+ */
+
+#ifndef JOBS_H
+#define JOBS_H
+
+#include <stdint.h>
+#include "engine_config.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define JOB_MAX_THREADS 32
+
+/* index: item to process, thread: 0..Jobs_GetThreadCount()-1 */
+typedef void (*JobFunc_t)(uint32_t index, uint32_t thread, void* user);
+
+typedef struct {
+    uint32_t items_run[JOB_MAX_THREADS];    /* Items executed per thread */
+    uint32_t items_stolen[JOB_MAX_THREADS]; /* Of those, taken from another run */
+} JobStats_t;
+
+/* thread_count 0 = one per hardware thread, clamped to JOB_MAX_THREADS */
+void Jobs_Init(uint32_t thread_count);
+void Jobs_Shutdown(void);
+uint32_t Jobs_GetThreadCount(void);
+
+/* Runs func for every index in [0,count); returns when all are done */
+void Jobs_ParallelFor(uint32_t count, JobFunc_t func, void* user);
+
+/* Stats of the most recent Jobs_ParallelFor */
+void Jobs_GetStats(JobStats_t* stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* JOBS_H */
@@ -0,0 +1,234 @@
+/**
+ * @file lighting.cpp
+ * @brief Per-Vertex Lighting Implementation
+ */
+
+#include "lighting.h"
+#include <string.h>
+
+/* A light in the object space of the current draw */
+typedef struct {
+    uint32_t type;
+    Vec3 vector;                /* Directional: unit, towards the light; else position */
+    Vec3 spot;                  /* Spot: unit travel direction */
+    float r, g, b;
+    float inv_range_sq;         /* Object-space units; 0 = no falloff */
+    float cos_cone;
+    float inv_cone;             /* 1 / (1 - cos_cone) */
+} ObjectLight_t;
+
+static SceneLight_t g_world_lights[MAX_LIGHTS];
+static uint32_t g_light_count = 0;
+static ObjectLight_t g_object_lights[MAX_LIGHTS];
+static int g_needs_positions = 0;
+
+void Lighting_SetLights(const SceneLight_t* lights, uint32_t count)
+{
+    g_light_count = MIN(count, (uint32_t)MAX_LIGHTS);
+    memcpy(g_world_lights, lights, g_light_count * sizeof(SceneLight_t));
+    g_needs_positions = 0;
+    for (uint32_t i = 0; i < g_light_count; i++) {
+        if (g_world_lights[i].type != LIGHT_DIRECTIONAL) g_needs_positions = 1;
+    }
+}
+
+int Lighting_NeedsPositions(void)
+{
+    return g_needs_positions;
+}
+
+/* ============================================================
+ * Object Space
+ * ============================================================ */
+
+/* Inverse of the upper 3x3 (column-major like Mat4); returns the
+ * determinant, 0 if singular */
+static float Inverse3x3(const Mat4* m, float inv[9])
+{
+    const float* a = m->m;
+    float c0 = a[5] * a[10] - a[9] * a[6];
+    float c1 = a[9] * a[2] - a[1] * a[10];
+    float c2 = a[1] * a[6] - a[5] * a[2];
+    float det = a[0] * c0 + a[4] * c1 + a[8] * c2;
+    if (fabsf(det) < 1e-12f) return 0.0f;
+
+    float s = 1.0f / det;
+    inv[0] = c0 * s;
+    inv[1] = c1 * s;
+    inv[2] = c2 * s;
+    inv[3] = (a[8] * a[6] - a[4] * a[10]) * s;
+    inv[4] = (a[0] * a[10] - a[8] * a[2]) * s;
+    inv[5] = (a[4] * a[2] - a[0] * a[6]) * s;
+    inv[6] = (a[4] * a[9] - a[8] * a[5]) * s;
+    inv[7] = (a[8] * a[1] - a[0] * a[9]) * s;
+    inv[8] = (a[0] * a[5] - a[4] * a[1]) * s;
+    return det;
+}
+
+static inline Vec3 Apply3x3(const float m[9], Vec3 v)
+{
+    return Vec3_Create(m[0] * v.x + m[3] * v.y + m[6] * v.z,
+        m[1] * v.x + m[4] * v.y + m[7] * v.z,
+        m[2] * v.x + m[5] * v.y + m[8] * v.z);
+}
+
+/* dot(M^-T n, L) = dot(n, M^-1 L): lights go through the inverse
+ * instead of every normal through the inverse transpose */
+void Lighting_BeginDraw(const Mat4* world)
+{
+    if (g_light_count == 0) return;
+
+    float inv[9];
+    float det = Inverse3x3(world, inv);
+    if (det == 0.0f) {
+        memset(inv, 0, sizeof(inv));
+        inv[0] = inv[4] = inv[8] = 1.0f;
+        det = 1.0f;
+    }
+    float scale = cbrtf(fabsf(det));    /* World units per object unit */
+    Vec3 origin = Vec3_Create(world->m[12], world->m[13], world->m[14]);
+
+    for (uint32_t i = 0; i < g_light_count; i++) {
+        const SceneLight_t* in = &g_world_lights[i];
+        ObjectLight_t* out = &g_object_lights[i];
+        out->type = in->type;
+        out->r = in->color.x;
+        out->g = in->color.y;
+        out->b = in->color.z;
+
+        if (in->type == LIGHT_DIRECTIONAL) {
+            out->vector = Vec3_Normalize(Apply3x3(inv, Vec3_Negate(in->direction)));
+            continue;
+        }
+        out->vector = Apply3x3(inv, Vec3_Sub(in->position, origin));
+        out->spot = Vec3_Normalize(Apply3x3(inv, in->direction));
+        float range = in->range / scale;
+        out->inv_range_sq = (range > 0.0f) ? 1.0f / (range * range) : 0.0f;
+        out->cos_cone = (in->type == LIGHT_SPOT) ? in->cos_cone : -2.0f;
+        out->inv_cone = (in->cos_cone < 1.0f) ? 1.0f / (1.0f - in->cos_cone) : 0.0f;
+    }
+}
+
+/* ============================================================
+ * Shading
+ * ============================================================ */
+
+/* Old look without lights: half-Lambert from +Y in gray, 0..248 */
+static inline int DefaultLevel(float ny)
+{
+    float light = 0.3f + 0.7f * (ny * 0.5f + 0.5f);
+    int intensity = (int)(light * 31);
+    if (intensity > 31) intensity = 31;
+    if (intensity < 0) intensity = 0;
+    return intensity * 8;
+}
+
+static inline int ToChannel(float v)
+{
+    return (v >= 1.0f) ? 255 : (int)(v * 255.0f + 0.5f);
+}
+
+/* Light of up to LIGHTING_CHUNK vertices into r, g, b */
+static void Accumulate(const float* nx, const float* ny, const float* nz,
+    const float* px, const float* py, const float* pz, uint32_t n, float* r, float* g, float* b)
+{
+    for (uint32_t i = 0; i < n; i++) r[i] = g[i] = b[i] = LIGHTING_AMBIENT;
+
+    for (uint32_t l = 0; l < g_light_count; l++) {
+        const ObjectLight_t* L = &g_object_lights[l];
+        if (L->type == LIGHT_DIRECTIONAL) {
+            for (uint32_t i = 0; i < n; i++) {
+                float d = nx[i] * L->vector.x + ny[i] * L->vector.y + nz[i] * L->vector.z;
+                d = (d > 0.0f) ? d : 0.0f;
+                r[i] += d * L->r;
+                g[i] += d * L->g;
+                b[i] += d * L->b;
+            }
+            continue;
+        }
+        if (!px) continue;
+
+        for (uint32_t i = 0; i < n; i++) {
+            float vx = L->vector.x - px[i];
+            float vy = L->vector.y - py[i];
+            float vz = L->vector.z - pz[i];
+            float dist_sq = vx * vx + vy * vy + vz * vz + 1e-12f;
+            float inv_len = Math_Rsqrt(dist_sq);
+            float d = (nx[i] * vx + ny[i] * vy + nz[i] * vz) * inv_len;
+            float fade = 1.0f - dist_sq * L->inv_range_sq;
+            float cone = -(vx * L->spot.x + vy * L->spot.y + vz * L->spot.z) * inv_len;
+            cone = (cone - L->cos_cone) * L->inv_cone;
+            cone = (L->cos_cone < -1.0f) ? 1.0f : Clampf(cone, 0.0f, 1.0f);
+            d = (d > 0.0f && fade > 0.0f) ? d * fade * cone : 0.0f;
+            r[i] += d * L->r;
+            g[i] += d * L->g;
+            b[i] += d * L->b;
+        }
+    }
+}
+
+void Lighting_Shade(const float* nx, const float* ny, const float* nz,
+    const float* px, const float* py, const float* pz, uint32_t count, ClipVertex_t* out)
+{
+    if (g_light_count == 0) {
+        for (uint32_t i = 0; i < count; i++) {
+            int c = DefaultLevel(ny[i]);
+            out[i].color = RGB565(c, c, c);
+        }
+        return;
+    }
+
+    float r[LIGHTING_CHUNK], g[LIGHTING_CHUNK], b[LIGHTING_CHUNK];
+    for (uint32_t base = 0; base < count; base += LIGHTING_CHUNK) {
+        uint32_t n = MIN(count - base, (uint32_t)LIGHTING_CHUNK);
+        Accumulate(nx + base, ny + base, nz + base, px ? px + base : NULL, py ? py + base : NULL,
+            pz ? pz + base : NULL, n, r, g, b);
+        for (uint32_t i = 0; i < n; i++) {
+            out[base + i].color = (uint16_t)RGB565(ToChannel(r[i]), ToChannel(g[i]), ToChannel(b[i]));
+        }
+    }
+}
+
+/* ============================================================
+ * Normal Tables
+ * ============================================================ */
+
+void Lighting_BuildTable(const float (*normals)[3], uint32_t count, LightLevel_t* out)
+{
+    float nx[LIGHTING_CHUNK], ny[LIGHTING_CHUNK], nz[LIGHTING_CHUNK];
+    float r[LIGHTING_CHUNK], g[LIGHTING_CHUNK], b[LIGHTING_CHUNK];
+    for (uint32_t base = 0; base < count; base += LIGHTING_CHUNK) {
+        uint32_t n = MIN(count - base, (uint32_t)LIGHTING_CHUNK);
+        for (uint32_t i = 0; i < n; i++) {
+            nx[i] = normals[base + i][0];
+            ny[i] = normals[base + i][1];
+            nz[i] = normals[base + i][2];
+        }
+
+        LightLevel_t* o = out + base;
+        if (g_light_count == 0) {
+            for (uint32_t i = 0; i < n; i++) o[i].r = o[i].g = o[i].b = (uint8_t)DefaultLevel(ny[i]);
+            continue;
+        }
+        Accumulate(nx, ny, nz, NULL, NULL, NULL, n, r, g, b);
+        for (uint32_t i = 0; i < n; i++) {
+            o[i].r = (uint8_t)ToChannel(r[i]);
+            o[i].g = (uint8_t)ToChannel(g[i]);
+            o[i].b = (uint8_t)ToChannel(b[i]);
+        }
+    }
+}
+
+void Lighting_ShadeIndexed(const LightLevel_t* table, const uint8_t* index_a, const uint8_t* index_b,
+    uint32_t weight_b, uint32_t count, ClipVertex_t* out)
+{
+    uint32_t weight_a = LIGHTING_WEIGHT_ONE - weight_b;
+    for (uint32_t i = 0; i < count; i++) {
+        const LightLevel_t* a = &table[index_a[i]];
+        const LightLevel_t* b = &table[index_b[i]];
+        uint32_t r = (a->r * weight_a + b->r * weight_b) >> LIGHTING_WEIGHT_BITS;
+        uint32_t g = (a->g * weight_a + b->g * weight_b) >> LIGHTING_WEIGHT_BITS;
+        uint32_t bl = (a->b * weight_a + b->b * weight_b) >> LIGHTING_WEIGHT_BITS;
+        out[i].color = (uint16_t)RGB565(r, g, bl);
+    }
+}
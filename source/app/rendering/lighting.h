@@ -0,0 +1,74 @@
+/**
+ * @file lighting.h
+ * @brief Per-Vertex Lighting From The Draw List's Lights - NO MALLOC
+ *
+ * SceneBuffer_Build() gathers the active Light_t components once per
+ * frame into the draw list. Lighting_SetLights() takes them for the
+ * frame, and Lighting_BeginDraw() moves them into one draw's object
+ * space through the inverse of its world matrix, so mesh normals are
+ * lit as stored and never transformed. The result is exact for rotation,
+ * translation and uniform scale; non-uniform scale is approximate.
+ *
+ * Lighting_Shade() evaluates SoA normals (and positions, for point and
+ * spot lights) in chunks, one light at a time over the chunk, and
+ * writes ClipVertex_t.color as RGB565 light: ambient plus Lambert terms,
+ * point and spot lights fading quadratically to zero at their range.
+ * Without lights it keeps the old default of a soft light from +Y.
+ *
+ * Meshes whose normals index a fixed table (MD2) light the table once
+ * per draw with Lighting_BuildTable() and shade each vertex with two
+ * lookups blended in fixed point, Lighting_ShadeIndexed(): no normal
+ * lerp, normalize or dot product per vertex. A table has no positions,
+ * so it holds only for directional lights (Lighting_NeedsPositions() 0).
+ */
+
+#ifndef LIGHTING_H
+#define LIGHTING_H
+
+#include <stdint.h>
+#include "math3d.h"
+#include "clip.h"
+#include "scenebuffer.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define LIGHTING_AMBIENT        0.2f    /* White ambient when lights are set */
+#define LIGHTING_CHUNK          64      /* Vertices lit per pass over the lights */
+#define LIGHTING_WEIGHT_BITS    8
+#define LIGHTING_WEIGHT_ONE     (1u << LIGHTING_WEIGHT_BITS)
+
+/* Light on one table normal, 8 bits per channel */
+typedef struct {
+    uint8_t r, g, b;
+} LightLevel_t;
+
+/* Lights for the following draws; count 0 = the default light */
+void Lighting_SetLights(const SceneLight_t* lights, uint32_t count);
+
+/* Moves the lights into the object space of a draw */
+void Lighting_BeginDraw(const Mat4* world);
+
+/* Whether Lighting_Shade() reads positions for this draw */
+int Lighting_NeedsPositions(void);
+
+/* Colors of count vertices from object-space normals; px/py/pz may be
+ * NULL when Lighting_NeedsPositions() is 0 */
+void Lighting_Shade(const float* nx, const float* ny, const float* nz,
+    const float* px, const float* py, const float* pz, uint32_t count, ClipVertex_t* out);
+
+/* Light of count object-space unit normals for the current draw;
+ * point and spot lights are left out */
+void Lighting_BuildTable(const float (*normals)[3], uint32_t count, LightLevel_t* out);
+
+/* Colors of count vertices from two table indices each, blended with
+ * weight_b of LIGHTING_WEIGHT_ONE */
+void Lighting_ShadeIndexed(const LightLevel_t* table, const uint8_t* index_a, const uint8_t* index_b,
+    uint32_t weight_b, uint32_t count, ClipVertex_t* out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LIGHTING_H */
@@ -4,6 +4,7 @@
  */
 
 #include "texture.h"
+#include "namehash.h"
 #include "platform.h"
 #include <string.h>
 #include <stdlib.h>
@@ -58,29 +59,31 @@ static void ConvertRow_BGRA32(uint16_t* dst, const uint8_t* src, int width)
     }
 }
 
-static void ConvertRow_Indexed8(uint16_t* dst, const uint8_t* src, int width,
-    const uint8_t* palette)
+/* Indices stay packed; the palette becomes RGB565 */
+static void ConvertRow_Indexed(uint16_t* texels, uint32_t first, const uint8_t* src, int width,
+    int bpp, int format)
 {
     for (int x = 0; x < width; x++) {
-        int idx = src[x] * 4;
-        uint8_t b = palette[idx + 0];
-        uint8_t g = palette[idx + 1];
-        uint8_t r = palette[idx + 2];
-        dst[x] = RGB_to_565(r, g, b);
+        /* 4bpp BMP rows hold the left texel in the high nibble */
+        uint32_t index = (bpp == 8) ? src[x] : (uint32_t)((src[x >> 1] >> ((x & 1) ? 0 : 4)) & 0xF);
+        Texture_StoreRaw(texels, first + (uint32_t)x, index, format);
     }
 }
 
-uint32_t Texture_LoadBMP_Memory(const void* data, uint32_t size)
+/* Header checks; fills the texture's size and format. NULL if malformed
+ * or of an unsupported depth. */
+static const BMPInfoHeader_t* ParseBMP(const void* data, uint32_t size, int* out_width, int* out_height,
+    int* out_top_down, int* out_format, uint32_t* out_palette_count)
 {
     if (!data || size < sizeof(BMPFileHeader_t) + sizeof(BMPInfoHeader_t)) {
-        return 0xFFFFFFFF;
+        return NULL;
     }
 
     const uint8_t* ptr = (const uint8_t*)data;
     const BMPFileHeader_t* file_header = (const BMPFileHeader_t*)ptr;
 
     if (file_header->type != 0x4D42) {
-        return 0xFFFFFFFF;
+        return NULL;
     }
 
     const BMPInfoHeader_t* info = (const BMPInfoHeader_t*)(ptr + sizeof(BMPFileHeader_t));
@@ -95,43 +98,53 @@ uint32_t Texture_LoadBMP_Memory(const void* data, uint32_t size)
     }
 
     if (width <= 0 || height <= 0 || width > 1024 || height > 1024) {
-        return 0xFFFFFFFF;
+        return NULL;
     }
 
-    /* Use pool-based texture allocation */
-    uint32_t tex_id;
-    if (info->bpp == 24 || info->bpp == 32 || info->bpp == 8) {
-        tex_id = Texture_CreateSolid(0x0000, (uint16_t)width, (uint16_t)height);
-    }
-    else {
-        return 0xFFFFFFFF;
+    if (info->bpp != 24 && info->bpp != 32 && info->bpp != 8 && info->bpp != 4) {
+        return NULL;
     }
 
-    if (tex_id == 0xFFFFFFFF) {
-        return 0xFFFFFFFF;
+    /* Paletted images stay indexed: 8bpp ones with at most 16 colors as 4bpp */
+    uint32_t palette_count = 0;
+    int format = TEXTURE_FORMAT_RGB565;
+    if (info->bpp <= 8) {
+        palette_count = info->colors_used ? info->colors_used : (1u << info->bpp);
+        if (palette_count > 256) palette_count = 256;
+        format = (info->bpp == 4 || palette_count <= 16) ? TEXTURE_FORMAT_INDEXED4 : TEXTURE_FORMAT_INDEXED8;
     }
 
-    uint16_t* pixels = Texture_GetPixels(tex_id);
-    if (!pixels) {
-        Texture_Free(tex_id);
-        return 0xFFFFFFFF;
-    }
+    *out_width = width;
+    *out_height = height;
+    *out_top_down = top_down;
+    *out_format = format;
+    *out_palette_count = palette_count;
+    return info;
+}
+
+/* Level 0 and, for indexed formats, the palette */
+static void ConvertBMP(const void* data, const BMPInfoHeader_t* info, int width, int height, int top_down,
+    int format, uint32_t palette_count, uint16_t* pixels, uint16_t* palette)
+{
+    const uint8_t* ptr = (const uint8_t*)data;
+    const BMPFileHeader_t* file_header = (const BMPFileHeader_t*)ptr;
 
-    const uint8_t* palette = NULL;
     if (info->bpp <= 8) {
-        palette = ptr + sizeof(BMPFileHeader_t) + info->size;
+        const uint8_t* bgra = ptr + sizeof(BMPFileHeader_t) + info->size;
+        uint32_t entries = Texture_PaletteWords(format);
+        for (uint32_t i = 0; i < entries; i++) {
+            palette[i] = (i < palette_count) ? RGB_to_565(bgra[i * 4 + 2], bgra[i * 4 + 1], bgra[i * 4 + 0]) : 0;
+        }
     }
 
     const uint8_t* pixel_data = ptr + file_header->offset;
 
     int row_size;
     switch (info->bpp) {
+    case 4:  row_size = (((width + 1) >> 1) + 3) & ~3; break;
     case 8:  row_size = (width + 3) & ~3; break;
     case 24: row_size = ((width * 3) + 3) & ~3; break;
-    case 32: row_size = width * 4; break;
-    default:
-        Texture_Free(tex_id);
-        return 0xFFFFFFFF;
+    default: row_size = width * 4; break;
     }
 
     for (int y = 0; y < height; y++) {
@@ -140,8 +153,9 @@ uint32_t Texture_LoadBMP_Memory(const void* data, uint32_t size)
         uint16_t* dst_row = pixels + y * width;
 
         switch (info->bpp) {
+        case 4:
         case 8:
-            ConvertRow_Indexed8(dst_row, src_row, width, palette);
+            ConvertRow_Indexed(pixels, (uint32_t)(y * width), src_row, width, info->bpp, format);
             break;
         case 24:
             ConvertRow_BGR24(dst_row, src_row, width);
@@ -151,10 +165,62 @@ uint32_t Texture_LoadBMP_Memory(const void* data, uint32_t size)
             break;
         }
     }
+}
+
+uint32_t Texture_LoadBMP_Memory(const void* data, uint32_t size)
+{
+    int width, height, top_down, format;
+    uint32_t palette_count;
+    const BMPInfoHeader_t* info = ParseBMP(data, size, &width, &height, &top_down, &format, &palette_count);
+    if (!info) {
+        return 0xFFFFFFFF;
+    }
+
+    uint64_t hash = Name_HashData(data, size);
+    uint32_t shared = Texture_FindSource(hash, size);
+    if (shared != 0xFFFFFFFF) return shared;
 
+    /* Use pool-based texture allocation */
+    uint32_t tex_id = Texture_Create((uint16_t)width, (uint16_t)height, (uint8_t)format, TEXTURE_FLAG_MIPMAP);
+    if (tex_id == 0xFFFFFFFF) {
+        return 0xFFFFFFFF;
+    }
+
+    uint16_t* pixels = Texture_GetPixels(tex_id);
+    if (!pixels) {
+        Texture_Free(tex_id);
+        return 0xFFFFFFFF;
+    }
+
+    ConvertBMP(data, info, width, height, top_down, format, palette_count, pixels, Texture_GetPalette(tex_id));
+
+    Texture_BuildMips(tex_id);
+    Texture_Tile(tex_id);
+    Texture_SetSource(tex_id, hash, size);
     return tex_id;
 }
 
+int Texture_DecodeBMP(const void* data, uint32_t size, TextureStaging_t* out)
+{
+    int width, height, top_down, format;
+    uint32_t palette_count;
+    const BMPInfoHeader_t* info = ParseBMP(data, size, &width, &height, &top_down, &format, &palette_count);
+    if (!info) return 0;
+
+    out->width = (uint16_t)width;
+    out->height = (uint16_t)height;
+    out->format = (uint8_t)format;
+    out->flags = TEXTURE_FLAG_MIPMAP;
+    Texture_StagingLayout(out);
+    if (!out->data) return 1;
+
+    ConvertBMP(data, info, width, height, top_down, format, palette_count, out->data, out->data + out->palette);
+    Texture_FinishStaged(out);
+    out->source_hash = Name_HashData(data, size);
+    out->source_size = size;
+    return 1;
+}
+
 uint32_t Texture_LoadBMP(const void* data, uint32_t size)
 {
     return Texture_LoadBMP_Memory(data, size);
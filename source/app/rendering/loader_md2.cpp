@@ -4,6 +4,7 @@
  */
 
 #include "mesh.h"
+#include "namehash.h"
 #include "platform.h"
 #include <string.h>
 
@@ -39,8 +40,8 @@ typedef struct {
     MD2FrameVert_t verts[1];
 } MD2FrameData_t;
 
-/* Full MD2 normal table (162 normals) */
-static const float g_normals[162][3] = {
+/* Full MD2 normal table */
+const float g_md2_normals[MD2_NUM_NORMALS][3] = {
     {-0.525731f, 0.000000f, 0.850651f}, {-0.442863f, 0.238856f, 0.864188f},
     {-0.295242f, 0.000000f, 0.955423f}, {-0.309017f, 0.500000f, 0.809017f},
     {-0.162460f, 0.262866f, 0.951056f}, {0.000000f, 0.000000f, 1.000000f},
@@ -125,81 +126,93 @@ static const float g_normals[162][3] = {
 };
 
 
-uint32_t AllocMD2UVs(uint32_t count)
-{
-    if (g_md2_uv_used + count > MAX_MD2_VERTICES) return 0xFFFFFFFF;
-    uint32_t start = g_md2_uv_used;
-    g_md2_uv_used += count;
-    return start;
-}
 /* Pool allocators and globals are declared in mesh.h */
 
-uint32_t Mesh_LoadMD2(const void* data, uint32_t size)
-{
-    if (!data || size < sizeof(MD2Header_t)) return 0xFFFFFFFF;
-
-    const uint8_t* ptr = (const uint8_t*)data;
-    const MD2Header_t* hdr = (const MD2Header_t*)ptr;
-
-    if (hdr->magic != 844121161 || hdr->version != 8) return 0xFFFFFFFF;
-    if (hdr->num_frames > MAX_MD2_FRAMES) return 0xFFFFFFFF;
+/* Load-time scratch for (vertex, uv) deduplication: per-vertex chains
+ * of the pairs emitted so far; per thread on SDL_PC */
+#define MD2_MAX_TRIANGLES   4096
+#define PAIR_NONE           0xFFFF
 
-    uint32_t slot = AllocMeshSlot();
-    if (slot == 0xFFFFFFFF) return 0xFFFFFFFF;
+LOADER_SCRATCH static uint16_t g_pair_head[MAX_MD2_FRAME_VERTICES];
+LOADER_SCRATCH_SDRAM static uint16_t g_pair_next[MD2_MAX_TRIANGLES * 3];
 
-    // MD2 uses per-triangle UVs, so we need num_triangles * 3 UVs
-    uint32_t num_uvs = hdr->num_triangles * 3;
-    uint32_t uv_start = AllocMD2UVs(num_uvs);
-    if (uv_start == 0xFFFFFFFF) return 0xFFFFFFFF;
+/* The header if the file is an MD2 this engine can hold, else NULL */
+static const MD2Header_t* CheckMD2(const void* data, uint32_t size)
+{
+    if (!data || size < sizeof(MD2Header_t)) return NULL;
+
+    const MD2Header_t* hdr = (const MD2Header_t*)data;
+    if (hdr->magic != 844121161 || hdr->version != 8) return NULL;
+    if (hdr->num_frames > MAX_MD2_FRAMES) return NULL;
+    if (hdr->num_vertices > MAX_MD2_FRAME_VERTICES) return NULL;
+    if (hdr->num_triangles > MD2_MAX_TRIANGLES) return NULL;
+    return hdr;
+}
 
-    // Extract texture coordinates from MD2
+/* Index buffer over unique (vertex, uv) pairs; out_uvs has room for
+ * every corner. Returns the pairs emitted. */
+static uint32_t BuildPairs(const MD2Header_t* hdr, MD2UV_t* out_uvs, uint16_t* out_idx)
+{
+    const uint8_t* ptr = (const uint8_t*)hdr;
     const MD2TexCoord_t* src_uvs = (const MD2TexCoord_t*)(ptr + hdr->offset_texcoords);
     const MD2Triangle_t* tris = (const MD2Triangle_t*)(ptr + hdr->offset_triangles);
-
-    MD2UV_t* out_uvs = &g_md2_uv_pool[uv_start];
     float inv_w = 1.0f / (float)hdr->skin_width;
     float inv_h = 1.0f / (float)hdr->skin_height;
 
-    // Build index buffer and expand UVs per triangle
-    uint32_t idx_start = AllocIndices(hdr->num_triangles * 3);
-    if (idx_start == 0xFFFFFFFF) return 0xFFFFFFFF;
+    for (int32_t v = 0; v < hdr->num_vertices; v++) g_pair_head[v] = PAIR_NONE;
 
-    uint16_t* out_idx = &g_index_pool[idx_start];
+    uint32_t num_uvs = 0;
     for (int32_t i = 0; i < hdr->num_triangles; i++) {
-        // Store vertex indices
-        out_idx[i * 3 + 0] = tris[i].vertex[0];
-        out_idx[i * 3 + 1] = tris[i].vertex[2];
-        out_idx[i * 3 + 2] = tris[i].vertex[1];
+        static const int winding[3] = { 0, 2, 1 };
 
-        // Store corresponding UVs (expanded per triangle corner)
         for (int j = 0; j < 3; j++) {
-            uint16_t uv_idx = tris[i].texcoord[j];
-            out_uvs[i * 3 + j].u = (float)src_uvs[uv_idx].s * inv_w;
-            out_uvs[i * 3 + j].v = (float)src_uvs[uv_idx].t * inv_h;
+            uint16_t vi = tris[i].vertex[winding[j]];
+            uint16_t ti = tris[i].texcoord[winding[j]];
+            if (vi >= hdr->num_vertices || ti >= hdr->num_texcoords) vi = ti = 0;
+
+            float u = (float)src_uvs[ti].s * inv_w;
+            float v = (float)src_uvs[ti].t * inv_h;
+
+            // Walk the pairs already emitted for this vertex
+            uint16_t p = g_pair_head[vi];
+            while (p != PAIR_NONE && (out_uvs[p].u != u || out_uvs[p].v != v)) p = g_pair_next[p];
+
+            if (p == PAIR_NONE) {
+                p = (uint16_t)num_uvs++;
+                out_uvs[p].u = u;
+                out_uvs[p].v = v;
+                out_uvs[p].vertex = vi;
+                g_pair_next[p] = g_pair_head[vi];
+                g_pair_head[vi] = p;
+            }
+            out_idx[i * 3 + j] = p;
         }
     }
+    return num_uvs;
+}
 
-    // Allocate frames and vertices
-    uint32_t frame_start = AllocFrames(hdr->num_frames);
-    if (frame_start == 0xFFFFFFFF) return 0xFFFFFFFF;
-
-    uint32_t total_verts = hdr->num_frames * hdr->num_vertices;
-    uint32_t vert_start = AllocMD2Vertices(total_verts);
-    if (vert_start == 0xFFFFFFFF) return 0xFFFFFFFF;
-
-    // Extract frame data
-    const uint8_t* frame_ptr = ptr + hdr->offset_frames;
-    MD2Vertex_t* out_verts = &g_md2_vertex_pool[vert_start];
-    MD2FrameDesc_t* out_frames = &g_frame_pool[frame_start];
+/* Frame descriptors and vertices; frame f's vertices start at
+ * vert_start + f * num_vertices. Bounds enclose every frame. */
+static void ExtractFrames(const MD2Header_t* hdr, MD2FrameDesc_t* out_frames, MD2Vertex_t* out_verts,
+    uint32_t vert_start, Vec3* center, float* radius)
+{
+    const uint8_t* frame_ptr = (const uint8_t*)hdr + hdr->offset_frames;
+    Vec3 bmin = MakeVec3(0, 0, 0), bmax = MakeVec3(0, 0, 0);
 
     for (int32_t f = 0; f < hdr->num_frames; f++) {
         const MD2FrameData_t* src = (const MD2FrameData_t*)frame_ptr;
 
         out_frames[f].scale = MakeVec3(src->scale[0], src->scale[1], src->scale[2]);
         out_frames[f].translate = MakeVec3(src->translate[0], src->translate[1], src->translate[2]);
-        out_frames[f].vertex_start = (uint16_t)(vert_start + f * hdr->num_vertices);
+        out_frames[f].vertex_start = vert_start + f * hdr->num_vertices;
         out_frames[f].vertex_count = (uint16_t)hdr->num_vertices;
 
+        /* Frame box spans the full 0..255 quantization range */
+        Vec3 fmin = out_frames[f].translate;
+        Vec3 fmax = Vec3_Add(fmin, Vec3_Scale(out_frames[f].scale, 255.0f));
+        bmin = (f == 0) ? Vec3_Min(fmin, fmax) : Vec3_Min(bmin, Vec3_Min(fmin, fmax));
+        bmax = (f == 0) ? Vec3_Max(fmin, fmax) : Vec3_Max(bmax, Vec3_Max(fmin, fmax));
+
         MD2Vertex_t* dst_v = &out_verts[f * hdr->num_vertices];
         for (int32_t v = 0; v < hdr->num_vertices; v++) {
             dst_v[v].x = src->verts[v].v[0];
@@ -211,17 +224,95 @@ uint32_t Mesh_LoadMD2(const void* data, uint32_t size)
         frame_ptr += hdr->frame_size;
     }
 
+    *center = Vec3_Scale(Vec3_Add(bmin, bmax), 0.5f);
+    *radius = Vec3_Length(Vec3_Sub(bmax, *center));
+}
+
+uint32_t Mesh_LoadMD2(const void* data, uint32_t size)
+{
+    const MD2Header_t* hdr = CheckMD2(data, size);
+    if (!hdr) return 0xFFFFFFFF;
+
+    uint64_t hash = Name_HashData(data, size);
+    uint32_t slot = FindMeshSource(hash, size);
+    if (slot != 0xFFFFFFFF) return slot;
+    slot = AllocMeshSlot();
+    if (slot == 0xFFFFFFFF) return 0xFFFFFFFF;
+
+    // Reserve the worst case (every corner unique); the tail is returned below
+    uint32_t num_corners = hdr->num_triangles * 3;
+    uint32_t uv_start = AllocMD2UVs(num_corners);
+    if (uv_start == 0xFFFFFFFF) return 0xFFFFFFFF;
+
+    uint32_t idx_start = AllocIndices(num_corners);
+    if (idx_start == 0xFFFFFFFF) {
+        FreeMD2UVs(uv_start, num_corners);
+        return 0xFFFFFFFF;
+    }
+
+    uint32_t num_uvs = BuildPairs(hdr, &g_md2_uv_pool[uv_start], &g_index_pool[idx_start]);
+    FreeMD2UVs(uv_start + num_uvs, num_corners - num_uvs);
+
+    // Allocate frames and vertices
+    uint32_t frame_start = AllocFrames(hdr->num_frames);
+    if (frame_start == 0xFFFFFFFF) {
+        FreeMD2UVs(uv_start, num_uvs);
+        FreeIndices(idx_start, num_corners);
+        return 0xFFFFFFFF;
+    }
+
+    uint32_t total_verts = hdr->num_frames * hdr->num_vertices;
+    uint32_t vert_start = AllocMD2Vertices(total_verts);
+    if (vert_start == 0xFFFFFFFF) {
+        FreeMD2UVs(uv_start, num_uvs);
+        FreeIndices(idx_start, num_corners);
+        FreeFrames(frame_start, hdr->num_frames);
+        return 0xFFFFFFFF;
+    }
+
     g_meshes[slot].type = 2;
-    g_meshes[slot].anim.frame_start = (uint16_t)frame_start;
+    ExtractFrames(hdr, &g_frame_pool[frame_start], &g_md2_vertex_pool[vert_start], vert_start,
+        &g_meshes[slot].anim.bounds_center, &g_meshes[slot].anim.bounds_radius);
+    g_meshes[slot].anim.frame_start = frame_start;
     g_meshes[slot].anim.frame_count = (uint16_t)hdr->num_frames;
-    g_meshes[slot].anim.index_start = (uint16_t)idx_start;
+    g_meshes[slot].anim.index_start = idx_start;
     g_meshes[slot].anim.index_count = (uint16_t)(hdr->num_triangles * 3);
     g_meshes[slot].anim.verts_per_frame = (uint16_t)hdr->num_vertices;
-    g_meshes[slot].anim.uv_start = (uint16_t)uv_start;
+    g_meshes[slot].anim.uv_start = uv_start;
     g_meshes[slot].anim.uv_count = (uint16_t)num_uvs;
+    SetMeshSource(slot, hash, size);
 
     return slot;
 }
+
+int Mesh_DecodeMD2(const void* data, uint32_t size, MeshStaging_t* out)
+{
+    const MD2Header_t* hdr = CheckMD2(data, size);
+    if (!hdr || !out) return 0;
+
+    out->type = 2;
+    out->vertex_count = 0;
+    if (!out->indices || !out->uvs || !out->frames || !out->md2_vertices) {
+        out->index_count = hdr->num_triangles * 3;
+        out->uv_count = hdr->num_triangles * 3;
+        out->frame_count = hdr->num_frames;
+        out->md2_vertex_count = hdr->num_frames * hdr->num_vertices;
+        return 1;
+    }
+    if (out->index_count < (uint32_t)hdr->num_triangles * 3 || out->uv_count < (uint32_t)hdr->num_triangles * 3 ||
+        out->frame_count < (uint32_t)hdr->num_frames ||
+        out->md2_vertex_count < (uint32_t)(hdr->num_frames * hdr->num_vertices)) return 0;
+
+    out->uv_count = BuildPairs(hdr, out->uvs, out->indices);
+    out->index_count = hdr->num_triangles * 3;
+    out->frame_count = hdr->num_frames;
+    out->md2_vertex_count = hdr->num_frames * hdr->num_vertices;
+    ExtractFrames(hdr, out->frames, out->md2_vertices, 0, &out->bounds_center, &out->bounds_radius);
+    out->source_hash = Name_HashData(data, size);
+    out->source_size = size;
+    return 1;
+}
+
 void Mesh_GetMD2Vertex(uint32_t mesh_id, uint32_t vert_idx,
     uint32_t frame_a, uint32_t frame_b, float t,
     Vec3* pos, Vec3* norm, Vec2* uv)  // Added UV parameter
@@ -238,11 +329,11 @@ void Mesh_GetMD2Vertex(uint32_t mesh_id, uint32_t vert_idx,
     if (frame_b >= m->anim.frame_count) frame_b = m->anim.frame_count - 1;
     if (vert_idx >= m->anim.verts_per_frame) vert_idx = 0;
 
-    MD2FrameDesc_t* fa = &g_frame_pool[m->anim.frame_start + frame_a];
-    MD2FrameDesc_t* fb = &g_frame_pool[m->anim.frame_start + frame_b];
+    const MD2FrameDesc_t* fa = &Mesh_GetFrames(m)[frame_a];
+    const MD2FrameDesc_t* fb = &Mesh_GetFrames(m)[frame_b];
 
-    MD2Vertex_t* va = &g_md2_vertex_pool[fa->vertex_start + vert_idx];
-    MD2Vertex_t* vb = &g_md2_vertex_pool[fb->vertex_start + vert_idx];
+    const MD2Vertex_t* va = &Mesh_GetFrameVertices(m, frame_a)[vert_idx];
+    const MD2Vertex_t* vb = &Mesh_GetFrameVertices(m, frame_b)[vert_idx];
 
     Vec3 pa = MakeVec3(
         fa->scale.x * va->x + fa->translate.x,
@@ -256,10 +347,10 @@ void Mesh_GetMD2Vertex(uint32_t mesh_id, uint32_t vert_idx,
     );
     *pos = Vec3_Lerp(pa, pb, t);
 
-    int ni_a = va->normal_index % 162;
-    int ni_b = vb->normal_index % 162;
-    Vec3 na = MakeVec3(g_normals[ni_a][0], g_normals[ni_a][1], g_normals[ni_a][2]);
-    Vec3 nb = MakeVec3(g_normals[ni_b][0], g_normals[ni_b][1], g_normals[ni_b][2]);
+    int ni_a = va->normal_index % MD2_NUM_NORMALS;
+    int ni_b = vb->normal_index % MD2_NUM_NORMALS;
+    Vec3 na = MakeVec3(g_md2_normals[ni_a][0], g_md2_normals[ni_a][1], g_md2_normals[ni_a][2]);
+    Vec3 nb = MakeVec3(g_md2_normals[ni_b][0], g_md2_normals[ni_b][1], g_md2_normals[ni_b][2]);
     *norm = Vec3_Normalize(Vec3_Lerp(na, nb, t));
 
     // Return UV if requested
@@ -267,24 +358,163 @@ void Mesh_GetMD2Vertex(uint32_t mesh_id, uint32_t vert_idx,
         *uv = MakeVec2(0, 0); // Will be set from triangle data
     }
 }
-typedef struct { const char* name; int start, end; } MD2Anim_t;
+
+uint32_t Mesh_DecodeMD2Pose(uint32_t mesh_id, uint32_t frame_a, uint32_t frame_b, float t,
+    float* x, float* y, float* z, Vec3* normals)
+{
+    MeshSlot_t* m = Mesh_Get(mesh_id);
+    if (!m || m->type != 2 || m->anim.frame_count == 0) return 0;
+
+    if (frame_a >= m->anim.frame_count) frame_a = m->anim.frame_count - 1;
+    if (frame_b >= m->anim.frame_count) frame_b = m->anim.frame_count - 1;
+
+    const MD2FrameDesc_t* fa = &Mesh_GetFrames(m)[frame_a];
+    const MD2FrameDesc_t* fb = &Mesh_GetFrames(m)[frame_b];
+    const MD2Vertex_t* va = Mesh_GetFrameVertices(m, frame_a);
+    const MD2Vertex_t* vb = Mesh_GetFrameVertices(m, frame_b);
+    uint32_t count = m->anim.verts_per_frame;
+
+    /* lerp(sa * qa + ta, sb * qb + tb, t) folded into ka * qa + kb * qb + c */
+    float s = 1.0f - t;
+    float kax = fa->scale.x * s, kay = fa->scale.y * s, kaz = fa->scale.z * s;
+    float kbx = fb->scale.x * t, kby = fb->scale.y * t, kbz = fb->scale.z * t;
+    float cx = fa->translate.x * s + fb->translate.x * t;
+    float cy = fa->translate.y * s + fb->translate.y * t;
+    float cz = fa->translate.z * s + fb->translate.z * t;
+
+    /* Positions: branch-free straight-line loop the compiler can vectorize */
+    for (uint32_t i = 0; i < count; i++) {
+        x[i] = kax * va[i].x + kbx * vb[i].x + cx;
+        y[i] = kay * va[i].y + kby * vb[i].y + cy;
+        z[i] = kaz * va[i].z + kbz * vb[i].z + cz;
+    }
+
+    for (uint32_t i = 0; i < count && normals; i++) {
+        const float* na = g_md2_normals[va[i].normal_index % MD2_NUM_NORMALS];
+        const float* nb = g_md2_normals[vb[i].normal_index % MD2_NUM_NORMALS];
+        Vec3 n = MakeVec3(na[0] * s + nb[0] * t, na[1] * s + nb[1] * t, na[2] * s + nb[2] * t);
+        normals[i] = Vec3_Normalize(n);
+    }
+    return count;
+}
+
+/* ============================================================
+ * Pose Cache
+ * ============================================================ */
+
+typedef struct {
+    uint32_t mesh_key;      /* mesh_id + 1, 0 = empty */
+    uint32_t frame_a, frame_b;
+    uint32_t lerp_step;
+    uint32_t last_use;
+} MD2PoseKey_t;
+
+PLACE_POSE_CACHE static MD2Pose_t g_pose_cache[MD2_POSE_CACHE_SIZE];
+static MD2PoseKey_t g_pose_keys[MD2_POSE_CACHE_SIZE];
+static uint32_t g_pose_clock = 0;
+
+const MD2Pose_t* Mesh_GetMD2Pose(uint32_t mesh_id, uint32_t frame_a, uint32_t frame_b, float t)
+{
+    if (t < 0.0f) t = 0.0f;
+    if (t > 1.0f) t = 1.0f;
+    uint32_t step = (uint32_t)(t * MD2_POSE_LERP_STEPS + 0.5f);
+
+    /* Endpoints collapse onto a single keyframe */
+    if (step == 0) frame_b = frame_a;
+    if (step == MD2_POSE_LERP_STEPS) { frame_a = frame_b; step = 0; }
+
+    uint32_t key = mesh_id + 1;
+    uint32_t victim = 0;
+    g_pose_clock++;
+
+    for (uint32_t i = 0; i < MD2_POSE_CACHE_SIZE; i++) {
+        MD2PoseKey_t* k = &g_pose_keys[i];
+        if (k->mesh_key == key && k->frame_a == frame_a &&
+            k->frame_b == frame_b && k->lerp_step == step) {
+            k->last_use = g_pose_clock;
+            return &g_pose_cache[i];
+        }
+        /* Empty entries have last_use 0, so they are evicted first */
+        if (k->last_use < g_pose_keys[victim].last_use) victim = i;
+    }
+
+    MD2Pose_t* pose = &g_pose_cache[victim];
+    MD2PoseKey_t* k = &g_pose_keys[victim];
+    pose->count = Mesh_DecodeMD2Pose(mesh_id, frame_a, frame_b, (float)step / MD2_POSE_LERP_STEPS,
+        pose->x, pose->y, pose->z, NULL);
+    if (pose->count == 0) {
+        memset(k, 0, sizeof(*k));
+        return NULL;
+    }
+
+    /* Normals as indices: no per-vertex normalize, and the draw lights
+     * 162 table entries instead of every vertex */
+    const MeshSlot_t* m = Mesh_Get(mesh_id);
+    const MD2Vertex_t* va = Mesh_GetFrameVertices(m, MIN(frame_a, m->anim.frame_count - 1u));
+    const MD2Vertex_t* vb = Mesh_GetFrameVertices(m, MIN(frame_b, m->anim.frame_count - 1u));
+    for (uint32_t i = 0; i < pose->count; i++) {
+        pose->normal_a[i] = (uint8_t)(va[i].normal_index % MD2_NUM_NORMALS);
+        pose->normal_b[i] = (uint8_t)(vb[i].normal_index % MD2_NUM_NORMALS);
+    }
+    pose->lerp_step = step;
+
+    k->mesh_key = key;
+    k->frame_a = frame_a;
+    k->frame_b = frame_b;
+    k->lerp_step = step;
+    k->last_use = g_pose_clock;
+    return pose;
+}
+
+void Mesh_InvalidateMD2Poses(uint32_t mesh_id)
+{
+    for (uint32_t i = 0; i < MD2_POSE_CACHE_SIZE; i++) {
+        if (g_pose_keys[i].mesh_key == mesh_id + 1) memset(&g_pose_keys[i], 0, sizeof(MD2PoseKey_t));
+    }
+}
+/* Frame ranges and rates of the Quake II player models */
+typedef struct { const char* name; int start, end; float fps; } MD2Anim_t;
 
 static const MD2Anim_t g_anims[] = {
-    {"stand", 0, 39}, {"run", 40, 45}, {"attack", 46, 53},
-    {"pain1", 54, 57}, {"pain2", 58, 61}, {"pain3", 62, 65},
-    {"jump", 66, 71}, {"flip", 72, 83}, {"salute", 84, 94},
-    {"taunt", 95, 111}, {"wave", 112, 122}, {"point", 123, 134},
-    {"death1", 178, 183}, {"death2", 184, 189}, {"death3", 190, 197}
+    {"stand", 0, 39, 9.0f}, {"run", 40, 45, 10.0f}, {"attack", 46, 53, 10.0f},
+    {"pain1", 54, 57, 7.0f}, {"pain2", 58, 61, 7.0f}, {"pain3", 62, 65, 7.0f},
+    {"jump", 66, 71, 7.0f}, {"flip", 72, 83, 7.0f}, {"salute", 84, 94, 7.0f},
+    {"taunt", 95, 111, 7.0f}, {"wave", 112, 122, 7.0f}, {"point", 123, 134, 6.0f},
+    {"death1", 178, 183, 7.0f}, {"death2", 184, 189, 7.0f}, {"death3", 190, 197, 7.0f}
 };
 
-int MD2_GetAnimRange(const char* name, int* start, int* end)
+static const MD2Anim_t* FindAnim(const char* name)
 {
     for (int i = 0; i < (int)(sizeof(g_anims) / sizeof(g_anims[0])); i++) {
-        if (strcmp(g_anims[i].name, name) == 0) {
-            *start = g_anims[i].start;
-            *end = g_anims[i].end;
-            return 1;
-        }
+        if (strcmp(g_anims[i].name, name) == 0) return &g_anims[i];
+    }
+    return NULL;
+}
+
+int MD2_GetAnimRange(const char* name, int* start, int* end)
+{
+    const MD2Anim_t* a = FindAnim(name);
+    if (!a) return 0;
+    *start = a->start;
+    *end = a->end;
+    return 1;
+}
+
+float MD2_GetAnimFrameRate(const char* name)
+{
+    const MD2Anim_t* a = FindAnim(name);
+    return a ? a->fps : 0.0f;
+}
+
+uint32_t MD2_GetMemPools(MemPool_t* out, uint32_t max)
+{
+    uint32_t live = 0;
+    for (uint32_t i = 0; i < MD2_POSE_CACHE_SIZE; i++) {
+        if (g_pose_keys[i].mesh_key != 0) live++;
     }
-    return 0;
-}
\ No newline at end of file
+
+    uint32_t n = 0;
+    n = MemMap_Add(out, n, max, "md2 pose cache", g_pose_cache, sizeof(g_pose_cache), live * sizeof(MD2Pose_t));
+    n = MemMap_Add(out, n, max, "md2 load scratch", g_pair_next, sizeof(g_pair_next), sizeof(g_pair_next));
+    return n;
+}
@@ -1,113 +1,385 @@
 /**
  * @file loader_obj.cpp
- * @brief Wavefront OBJ File Loader
+ * @brief Wavefront OBJ File Loader - NO MALLOC
+ *
+ * One pass over the file text, parsed in place. Attributes go to static
+ * scratch arrays; faces are resolved as they are read, so "f" lines may
+ * only reference attributes defined above them (true of every exporter
+ * and required for relative indices anyway). Each v/vt/vn corner is
+ * looked up in a hash table and emitted once, straight into the largest
+ * free vertex and index ranges, which are trimmed to size at the end.
+ * Mesh_DecodeOBJ() runs the same parse into caller staging instead, on
+ * any thread: the scratch below is per thread on SDL_PC.
  */
 
 #include "mesh.h"
+#include "namehash.h"
 #include "platform.h"
 #include <string.h>
-#include <stdlib.h>
-#include <stdio.h>
-#include <math.h>
 
- /* Temporary parsing buffers */
-#define MAX_OBJ_VERTS    8192
-#define MAX_OBJ_FACES    16384
+ /* Temporary parsing buffers - static allocation */
+#define OBJ_MAX_POS     2048
+#define OBJ_MAX_NORM    2048
+#define OBJ_MAX_UV      2048
+
+/* Corner table; past 3/4 load new corners are emitted without sharing */
+#define OBJ_HASH_SIZE   8192
+#define OBJ_HASH_EMPTY  0xFFFF
+#define OBJ_HASH_LIMIT  (OBJ_HASH_SIZE / 4 * 3)
+
+/* Face corners beyond this are dropped */
+#define OBJ_MAX_CORNERS 32
+
+LOADER_SCRATCH static Vec3 s_obj_pos[OBJ_MAX_POS];
+LOADER_SCRATCH static Vec3 s_obj_norm[OBJ_MAX_NORM];
+LOADER_SCRATCH static Vec2 s_obj_uv[OBJ_MAX_UV];
+LOADER_SCRATCH static uint16_t s_obj_hash[OBJ_HASH_SIZE];
 
 typedef struct {
-    Vec3* positions;
-    Vec3* normals;
-    Vec2* texcoords;
-    uint32_t pos_count;
-    uint32_t norm_count;
-    uint32_t tex_count;
-
-    Vertex_t* out_vertices;
-    uint16_t* out_indices;
-    uint32_t out_vert_count;
-    uint32_t out_idx_count;
-} OBJParser_t;
-
-static int ParseFloat(const char** str, float* out)
+    const char* p;
+    const char* end;
+} OBJCursor_t;
+
+/* ============================================================
+ * Tokens
+ * ============================================================ */
+
+static inline void SkipBlanks(OBJCursor_t* c)
 {
-    while (**str == ' ' || **str == '\t') (*str)++;
-    if (**str == '\0' || **str == '\n') return 0;
+    while (c->p < c->end && (*c->p == ' ' || *c->p == '\t')) c->p++;
+}
 
-    char* end;
-    *out = (float)strtod(*str, &end);
-    if (end == *str) return 0;
-    *str = end;
-    return 1;
+static inline void SkipLine(OBJCursor_t* c)
+{
+    while (c->p < c->end && *c->p != '\n') c->p++;
+    if (c->p < c->end) c->p++;
 }
 
-static int ParseInt(const char** str, int* out)
+static inline int IsDigit(char ch)
 {
-    while (**str == ' ' || **str == '\t') (*str)++;
-    if (**str == '\0' || **str == '\n') return 0;
+    return ch >= '0' && ch <= '9';
+}
+
+/* Decimal with optional sign, fraction and exponent. Digits accumulate
+ * exactly in 64 bits and are scaled once in double, which rounds like
+ * strtod for anything an exporter writes. */
+static int ParseFloat(OBJCursor_t* c, float* out)
+{
+    SkipBlanks(c);
+    const char* s = c->p;
+    const char* end = c->end;
+
+    int negative = 0;
+    if (s < end && (*s == '-' || *s == '+')) negative = (*s++ == '-');
+
+    uint64_t mantissa = 0;
+    int exponent = 0, digits = 0;
+    for (; s < end && IsDigit(*s); s++, digits++) {
+        if (mantissa < 100000000000000000ull) mantissa = mantissa * 10 + (uint64_t)(*s - '0');
+        else exponent++;
+    }
+    if (s < end && *s == '.') {
+        for (s++; s < end && IsDigit(*s); s++, digits++) {
+            if (mantissa < 100000000000000000ull) {
+                mantissa = mantissa * 10 + (uint64_t)(*s - '0');
+                exponent--;
+            }
+        }
+    }
+    if (digits == 0) return 0;
+
+    if (s < end && (*s == 'e' || *s == 'E')) {
+        const char* e = s + 1;
+        int e_negative = 0;
+        if (e < end && (*e == '-' || *e == '+')) e_negative = (*e++ == '-');
+        if (e < end && IsDigit(*e)) {
+            int value = 0;
+            for (; e < end && IsDigit(*e); e++) {
+                if (value < 1000) value = value * 10 + (*e - '0');
+            }
+            exponent += e_negative ? -value : value;
+            s = e;
+        }
+    }
 
-    char* end;
-    *out = (int)strtol(*str, &end, 10);
-    if (end == *str) return 0;
-    *str = end;
+    double result = (double)mantissa;
+    double scale = 1.0;
+    int n = (exponent < 0) ? -exponent : exponent;
+    if (n > 308) n = 308;
+    for (double p10 = 10.0; n; n >>= 1, p10 *= p10) {
+        if (n & 1) scale *= p10;
+    }
+    result = (exponent < 0) ? result / scale : result * scale;
+
+    *out = (float)(negative ? -result : result);
+    c->p = s;
     return 1;
 }
 
-static void ParseFaceIndex(const char** str, int* v, int* vt, int* vn)
+static int ParseInt(OBJCursor_t* c, int* out)
 {
-    *v = *vt = *vn = 0;
+    const char* s = c->p;
+    int negative = 0;
+    if (s < c->end && (*s == '-' || *s == '+')) negative = (*s++ == '-');
+    if (s >= c->end || !IsDigit(*s)) return 0;
 
-    ParseInt(str, v);
+    int value = 0;
+    for (; s < c->end && IsDigit(*s); s++) {
+        if (value < 100000000) value = value * 10 + (*s - '0');
+    }
+    *out = negative ? -value : value;
+    c->p = s;
+    return 1;
+}
 
-    if (**str == '/') {
-        (*str)++;
-        if (**str != '/') {
-            ParseInt(str, vt);
-        }
-        if (**str == '/') {
-            (*str)++;
-            ParseInt(str, vn);
+/* v, v/vt, v//vn or v/vt/vn; absent parts are 0. Returns 0 at end of line. */
+static int ParseCorner(OBJCursor_t* c, int* v, int* vt, int* vn)
+{
+    *v = *vt = *vn = 0;
+    SkipBlanks(c);
+    if (!ParseInt(c, v)) return 0;
+    if (c->p < c->end && *c->p == '/') {
+        c->p++;
+        ParseInt(c, vt);
+        if (c->p < c->end && *c->p == '/') {
+            c->p++;
+            ParseInt(c, vn);
         }
     }
+    return *v != 0;
+}
 
-    while (**str == ' ' || **str == '\t') (*str)++;
+/* 1-based, or negative relative to the attributes read so far; -1 if
+ * absent or out of range */
+static inline int ResolveIndex(int idx, uint32_t count)
+{
+    int i = (idx > 0) ? idx - 1 : (idx < 0) ? (int)count + idx : -1;
+    return (i >= 0 && i < (int)count) ? i : -1;
 }
 
-static uint32_t FindOrAddVertex(OBJParser_t* p, int vi, int vti, int vni)
+/* ============================================================
+ * Loader
+ * ============================================================ */
+
+typedef struct {
+    Vertex_t* verts;
+    uint32_t count;
+    uint32_t capacity;
+    uint32_t hashed;
+} OBJOutput_t;
+
+static inline int SameVertex(const Vertex_t* a, const Vertex_t* b)
 {
-    vi = (vi > 0) ? vi - 1 : (int)p->pos_count + vi;
-    vti = (vti > 0) ? vti - 1 : (vti < 0) ? (int)p->tex_count + vti : -1;
-    vni = (vni > 0) ? vni - 1 : (vni < 0) ? (int)p->norm_count + vni : -1;
+    return a->position.x == b->position.x && a->position.y == b->position.y &&
+        a->position.z == b->position.z && a->normal.x == b->normal.x &&
+        a->normal.y == b->normal.y && a->normal.z == b->normal.z &&
+        a->texcoord.x == b->texcoord.x && a->texcoord.y == b->texcoord.y;
+}
 
+/* Local index of the corner's vertex, emitting it on first use;
+ * 0xFFFFFFFF when the vertex range is full */
+static uint32_t EmitCorner(OBJOutput_t* out, int vi, int ti, int ni)
+{
     Vertex_t vert;
-    vert.position = (vi >= 0 && vi < (int)p->pos_count) ? p->positions[vi] : Vec3_Zero();
-    vert.texcoord = (vti >= 0 && vti < (int)p->tex_count) ? p->texcoords[vti] : MakeVec2(0, 0);
-    vert.normal = (vni >= 0 && vni < (int)p->norm_count) ? p->normals[vni] : MakeVec3(0, 1, 0);
-
-    for (uint32_t i = 0; i < p->out_vert_count; i++) {
-        Vertex_t* v = &p->out_vertices[i];
-        if (fabsf(v->position.x - vert.position.x) < 0.0001f &&
-            fabsf(v->position.y - vert.position.y) < 0.0001f &&
-            fabsf(v->position.z - vert.position.z) < 0.0001f &&
-            fabsf(v->texcoord.x - vert.texcoord.x) < 0.0001f &&
-            fabsf(v->texcoord.y - vert.texcoord.y) < 0.0001f &&
-            fabsf(v->normal.x - vert.normal.x) < 0.0001f &&
-            fabsf(v->normal.y - vert.normal.y) < 0.0001f &&
-            fabsf(v->normal.z - vert.normal.z) < 0.0001f) {
-            return i;
+    vert.position = (vi >= 0) ? s_obj_pos[vi] : Vec3_Zero();
+    vert.normal = (ni >= 0) ? s_obj_norm[ni] : MakeVec3(0, 1, 0);
+    vert.texcoord = (ti >= 0) ? s_obj_uv[ti] : MakeVec2(0, 0);
+
+    uint32_t h = ((uint32_t)(vi + 1) * 73856093u) ^ ((uint32_t)(ti + 1) * 19349663u) ^ ((uint32_t)(ni + 1) * 83492791u);
+    h &= OBJ_HASH_SIZE - 1;
+    while (s_obj_hash[h] != OBJ_HASH_EMPTY) {
+        if (SameVertex(&out->verts[s_obj_hash[h]], &vert)) return s_obj_hash[h];
+        h = (h + 1) & (OBJ_HASH_SIZE - 1);
+    }
+
+    if (out->count >= out->capacity) return 0xFFFFFFFF;
+    uint32_t local = out->count++;
+    out->verts[local] = vert;
+    if (out->hashed < OBJ_HASH_LIMIT) {
+        s_obj_hash[h] = (uint16_t)local;
+        out->hashed++;
+    }
+    return local;
+}
+
+/* Vertices into verts (at most max_verts, 16-bit addressable) and local
+ * indices into indices; returns the vertices used, 0 if none */
+static uint32_t ParseOBJ(const void* data, uint32_t size, Vertex_t* verts, uint32_t max_verts,
+    uint16_t* indices, uint32_t max_indices, uint32_t* index_count)
+{
+    OBJOutput_t out;
+    out.verts = verts;
+    out.count = 0;
+    out.capacity = max_verts;
+    out.hashed = 0;
+    memset(s_obj_hash, 0xFF, sizeof(s_obj_hash));
+
+    uint32_t i_count = 0;
+    uint32_t pos_count = 0, norm_count = 0, uv_count = 0;
+    OBJCursor_t c;
+    c.p = (const char*)data;
+    c.end = c.p + size;
+
+    while (c.p < c.end) {
+        SkipBlanks(&c);
+        if (c.end - c.p < 2) break;
+
+        const char* lp = c.p;
+        if (lp[0] == 'v' && (lp[1] == ' ' || lp[1] == '\t')) {
+            c.p += 2;
+            Vec3 p;
+            if (ParseFloat(&c, &p.x) && ParseFloat(&c, &p.y) && ParseFloat(&c, &p.z)) {
+                if (pos_count < OBJ_MAX_POS) s_obj_pos[pos_count++] = p;
+            }
+        }
+        else if (lp[0] == 'v' && lp[1] == 't') {
+            c.p += 2;
+            Vec2 t;
+            if (ParseFloat(&c, &t.x) && ParseFloat(&c, &t.y)) {
+                t.y = 1.0f - t.y;
+                if (uv_count < OBJ_MAX_UV) s_obj_uv[uv_count++] = t;
+            }
         }
+        else if (lp[0] == 'v' && lp[1] == 'n') {
+            c.p += 2;
+            Vec3 n;
+            if (ParseFloat(&c, &n.x) && ParseFloat(&c, &n.y) && ParseFloat(&c, &n.z)) {
+                if (norm_count < OBJ_MAX_NORM) s_obj_norm[norm_count++] = Vec3_Normalize(n);
+            }
+        }
+        else if (lp[0] == 'f' && (lp[1] == ' ' || lp[1] == '\t')) {
+            c.p += 2;
+
+            /* Polygons become a fan around the first corner */
+            uint32_t corner[OBJ_MAX_CORNERS];
+            uint32_t fc = 0;
+            int v, vt, vn;
+            while (fc < OBJ_MAX_CORNERS && ParseCorner(&c, &v, &vt, &vn)) {
+                uint32_t local = EmitCorner(&out, ResolveIndex(v, pos_count),
+                    ResolveIndex(vt, uv_count), ResolveIndex(vn, norm_count));
+                if (local == 0xFFFFFFFF) break;
+                corner[fc++] = local;
+            }
+
+            for (uint32_t k = 2; k < fc && i_count + 3 <= max_indices; k++) {
+                indices[i_count++] = (uint16_t)corner[0];
+                indices[i_count++] = (uint16_t)corner[k - 1];
+                indices[i_count++] = (uint16_t)corner[k];
+            }
+        }
+        SkipLine(&c);
     }
 
-    if (p->out_vert_count < MAX_OBJ_VERTS) {
-        p->out_vertices[p->out_vert_count] = vert;
-        return p->out_vert_count++;
+    *index_count = i_count;
+    return out.count;
+}
+
+static void ComputeBounds(const Vertex_t* verts, uint32_t count, Vec3* center, float* radius)
+{
+    Vec3 bmin = verts[0].position, bmax = verts[0].position;
+    for (uint32_t i = 1; i < count; i++) {
+        bmin = Vec3_Min(bmin, verts[i].position);
+        bmax = Vec3_Max(bmax, verts[i].position);
     }
+    *center = Vec3_Scale(Vec3_Add(bmin, bmax), 0.5f);
+    *radius = Vec3_Length(Vec3_Sub(bmax, *center));
+}
+
+uint32_t Mesh_LoadOBJ(const void* data, uint32_t size)
+{
+    if (!data || size == 0) return 0xFFFFFFFF;
+
+    uint64_t hash = Name_HashData(data, size);
+    uint32_t slot = FindMeshSource(hash, size);
+    if (slot != 0xFFFFFFFF) return slot;
+    slot = AllocMeshSlot();
+    if (slot == 0xFFFFFFFF) return 0xFFFFFFFF;
 
-    return 0;
+    /* Unknown sizes until the end: take the largest ranges, trim later.
+     * Indices are 16-bit and local to the mesh. */
+    uint32_t max_verts = GetLargestFreeVertices();
+    uint32_t max_indices = GetLargestFreeIndices();
+    if (max_verts > 0x10000) max_verts = 0x10000;
+    if (max_verts < 3 || max_indices < 3) return 0xFFFFFFFF;
+
+    uint32_t v_start = AllocVertices(max_verts);
+    uint32_t i_start = AllocIndices(max_indices);
+
+    uint32_t i_count = 0;
+    uint32_t v_count = ParseOBJ(data, size, &g_vertex_pool[v_start], max_verts,
+        &g_index_pool[i_start], max_indices, &i_count);
+    FreeVertices(v_start + v_count, max_verts - v_count);
+    FreeIndices(i_start + i_count, max_indices - i_count);
+    if (v_count == 0 || i_count == 0) {
+        FreeVertices(v_start, v_count);
+        FreeIndices(i_start, i_count);
+        return 0xFFFFFFFF;
+    }
+
+    Mesh_UpdatePositions(v_start, v_count);
+
+    g_meshes[slot].type = 1;
+    g_meshes[slot].stat.vertex_start = v_start;
+    g_meshes[slot].stat.vertex_count = v_count;
+    g_meshes[slot].stat.index_start = i_start;
+    g_meshes[slot].stat.index_count = i_count;
+    ComputeBounds(&g_vertex_pool[v_start], v_count, &g_meshes[slot].stat.bounds_center,
+        &g_meshes[slot].stat.bounds_radius);
+    Mesh_BuildFacePlanes(slot);
+    SetMeshSource(slot, hash, size);
+
+    return slot;
+}
+
+/* Corners and fan indices of the "f" lines, without parsing them */
+static void CountOBJ(const void* data, uint32_t size, uint32_t* corners, uint32_t* indices)
+{
+    OBJCursor_t c;
+    c.p = (const char*)data;
+    c.end = c.p + size;
+    *corners = *indices = 0;
+
+    while (c.p < c.end) {
+        SkipBlanks(&c);
+        if (c.end - c.p >= 2 && c.p[0] == 'f' && (c.p[1] == ' ' || c.p[1] == '\t')) {
+            c.p += 2;
+            uint32_t fc = 0;
+            for (;;) {
+                SkipBlanks(&c);
+                if (c.p >= c.end || *c.p == '\n' || *c.p == '\r' || *c.p == '#') break;
+                while (c.p < c.end && *c.p != ' ' && *c.p != '\t' && *c.p != '\n' && *c.p != '\r') c.p++;
+                if (fc < OBJ_MAX_CORNERS) fc++;
+            }
+            *corners += fc;
+            if (fc >= 3) *indices += (fc - 2) * 3;
+        }
+        SkipLine(&c);
+    }
 }
 
-/* Use the pool-based loader from mesh.cpp instead */
-uint32_t Mesh_LoadOBJ_Memory(const void* data, uint32_t size)
+int Mesh_DecodeOBJ(const void* data, uint32_t size, MeshStaging_t* out)
 {
-    /* Forward to the pool-based implementation */
-    return Mesh_LoadOBJ(data, size);
-}
\ No newline at end of file
+    if (!data || size == 0 || !out) return 0;
+
+    out->type = 1;
+    out->frame_count = out->md2_vertex_count = out->uv_count = 0;
+    if (!out->vertices || !out->indices) {
+        uint32_t corners, indices;
+        CountOBJ(data, size, &corners, &indices);
+        out->vertex_count = MIN(corners, 0x10000u);
+        out->index_count = indices;
+        return out->vertex_count >= 3 && out->index_count >= 3;
+    }
+
+    uint32_t i_count = 0;
+    uint32_t v_count = ParseOBJ(data, size, out->vertices, MIN(out->vertex_count, 0x10000u),
+        out->indices, out->index_count, &i_count);
+    if (v_count == 0 || i_count == 0) return 0;
+
+    out->vertex_count = v_count;
+    out->index_count = i_count;
+    ComputeBounds(out->vertices, v_count, &out->bounds_center, &out->bounds_radius);
+    out->source_hash = Name_HashData(data, size);
+    out->source_size = size;
+    return 1;
+}
@@ -4,6 +4,32 @@
 #include <stdint.h>
 #include <math.h>
 #include <string.h>
+#include "fastmath.h"
+
+/* Optional vector backend, chosen at compile time. The API below is the
+ * same either way; define MATH3D_NO_SIMD to force the scalar code.
+ *   MATH3D_SSE   - x86 SSE (uses FMA when __FMA__ / AVX2 builds enable it)
+ *   MATH3D_NEON  - ARM NEON, and Helium (MVE) on Armv8.1-M cores
+ * Cortex-M7 (STM32H7) has neither and stays scalar. */
+#if !defined(MATH3D_NO_SIMD)
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define MATH3D_SSE 1
+#include <immintrin.h>
+#elif defined(__ARM_NEON)
+#define MATH3D_NEON 1
+#include <arm_neon.h>
+#elif defined(__ARM_FEATURE_MVE) && (__ARM_FEATURE_MVE & 2)
+#define MATH3D_NEON 1
+#include <arm_mve.h>
+#endif
+#endif
+
+/* MATH3D_FAST_MATH=1 routes the rotations, TRS composition and
+ * normalization below (and the renderer's Math_* call sites) through
+ * fastmath.h; 0 keeps libm and exact divides */
+#ifndef MATH3D_FAST_MATH
+#define MATH3D_FAST_MATH 0
+#endif
 
 #ifdef __cplusplus
 extern "C" {
@@ -45,6 +71,32 @@ extern "C" {
         int m = a; if (b > m) m = b; if (c > m) m = c; return m;
     }
 
+    /* libm, or fastmath.h under MATH3D_FAST_MATH */
+    static inline void Math_SinCos(float rad, float* s, float* c) {
+#if MATH3D_FAST_MATH
+        Fast_SinCos(rad, s, c);
+#else
+        *s = sinf(rad);
+        *c = cosf(rad);
+#endif
+    }
+
+    static inline float Math_Rsqrt(float x) {
+#if MATH3D_FAST_MATH
+        return Fast_Rsqrt(x);
+#else
+        return 1.0f / sqrtf(x);
+#endif
+    }
+
+    static inline float Math_Recip(float x) {
+#if MATH3D_FAST_MATH
+        return Fast_Recip(x);
+#else
+        return 1.0f / x;
+#endif
+    }
+
     /* Vec2 */
     static inline Vec2 Vec2_Create(float x, float y) { Vec2 r; r.x = x; r.y = y; return r; }
     static inline Vec2 Vec2_Add(Vec2 a, Vec2 b) { Vec2 r; r.x = a.x + b.x; r.y = a.y + b.y; return r; }
@@ -86,9 +138,9 @@ extern "C" {
     }
 
     static inline Vec3 Vec3_Normalize(Vec3 v) {
-        float len = Vec3_Length(v);
-        if (len > EPSILON) {
-            float inv = 1.0f / len;
+        float len_sq = Vec3_LengthSq(v);
+        if (len_sq > EPSILON * EPSILON) {
+            float inv = Math_Rsqrt(len_sq);
             Vec3 result;
             result.x = v.x * inv;
             result.y = v.y * inv;
@@ -150,7 +202,45 @@ extern "C" {
         memcpy(dst->m, src->m, sizeof(dst->m));
     }
 
+    /* acc + v * s, four lanes */
+#if defined(MATH3D_SSE)
+    typedef __m128 M3DVec;
+#define M3D_LOAD(p)         _mm_loadu_ps(p)
+#define M3D_STORE(p, v)     _mm_storeu_ps(p, v)
+#define M3D_MUL(v, s)       _mm_mul_ps(v, _mm_set1_ps(s))
+#if defined(__FMA__)
+#define M3D_MADD(acc, v, s) _mm_fmadd_ps(v, _mm_set1_ps(s), acc)
+#else
+#define M3D_MADD(acc, v, s) _mm_add_ps(acc, _mm_mul_ps(v, _mm_set1_ps(s)))
+#endif
+#elif defined(MATH3D_NEON)
+    typedef float32x4_t M3DVec;
+#define M3D_LOAD(p)         vld1q_f32(p)
+#define M3D_STORE(p, v)     vst1q_f32(p, v)
+#define M3D_MUL(v, s)       vmulq_n_f32(v, s)
+#if defined(__aarch64__) || defined(__ARM_FEATURE_MVE)
+#define M3D_MADD(acc, v, s) vfmaq_n_f32(acc, v, s)
+#else
+#define M3D_MADD(acc, v, s) vmlaq_n_f32(acc, v, s)
+#endif
+#endif
+
     static inline void Mat4_Multiply(Mat4* out, const Mat4* a, const Mat4* b) {
+#if defined(MATH3D_SSE) || defined(MATH3D_NEON)
+        /* Column-major: each result column is a's columns weighted by b's column */
+        M3DVec a0 = M3D_LOAD(&a->m[0]), a1 = M3D_LOAD(&a->m[4]);
+        M3DVec a2 = M3D_LOAD(&a->m[8]), a3 = M3D_LOAD(&a->m[12]);
+        M3DVec r[4];
+        int col;
+        for (col = 0; col < 4; col++) {
+            const float* bc = &b->m[col * 4];
+            M3DVec c = M3D_MUL(a0, bc[0]);
+            c = M3D_MADD(c, a1, bc[1]);
+            c = M3D_MADD(c, a2, bc[2]);
+            r[col] = M3D_MADD(c, a3, bc[3]);
+        }
+        for (col = 0; col < 4; col++) M3D_STORE(&out->m[col * 4], r[col]);
+#else
         Mat4 r;
         int row, col;
         for (row = 0; row < 4; row++) {
@@ -163,14 +253,23 @@ extern "C" {
             }
         }
         *out = r;
+#endif
     }
 
     static inline Vec4 Mat4_MultiplyVec4(const Mat4* m, Vec4 v) {
         Vec4 r;
+#if defined(MATH3D_SSE) || defined(MATH3D_NEON)
+        M3DVec c = M3D_MUL(M3D_LOAD(&m->m[0]), v.x);
+        c = M3D_MADD(c, M3D_LOAD(&m->m[4]), v.y);
+        c = M3D_MADD(c, M3D_LOAD(&m->m[8]), v.z);
+        c = M3D_MADD(c, M3D_LOAD(&m->m[12]), v.w);
+        M3D_STORE(&r.x, c);
+#else
         r.x = m->m[0] * v.x + m->m[4] * v.y + m->m[8] * v.z + m->m[12] * v.w;
         r.y = m->m[1] * v.x + m->m[5] * v.y + m->m[9] * v.z + m->m[13] * v.w;
         r.z = m->m[2] * v.x + m->m[6] * v.y + m->m[10] * v.z + m->m[14] * v.w;
         r.w = m->m[3] * v.x + m->m[7] * v.y + m->m[11] * v.z + m->m[15] * v.w;
+#endif
         return r;
     }
 
@@ -201,19 +300,22 @@ extern "C" {
     }
 
     static inline void Mat4_RotationX(Mat4* m, float rad) {
-        float c = cosf(rad), s = sinf(rad);
+        float s, c;
+        Math_SinCos(rad, &s, &c);
         Mat4_Identity(m);
         m->m[5] = c; m->m[9] = -s; m->m[6] = s; m->m[10] = c;
     }
 
     static inline void Mat4_RotationY(Mat4* m, float rad) {
-        float c = cosf(rad), s = sinf(rad);
+        float s, c;
+        Math_SinCos(rad, &s, &c);
         Mat4_Identity(m);
         m->m[0] = c; m->m[8] = s; m->m[2] = -s; m->m[10] = c;
     }
 
     static inline void Mat4_RotationZ(Mat4* m, float rad) {
-        float c = cosf(rad), s = sinf(rad);
+        float s, c;
+        Math_SinCos(rad, &s, &c);
         Mat4_Identity(m);
         m->m[0] = c; m->m[4] = -s; m->m[1] = s; m->m[5] = c;
     }
@@ -262,6 +364,114 @@ extern "C" {
         out->m[15] = 1;
     }
 
+    /* Affine matrices: bottom row (0, 0, 0, 1), so only the 3x4 above
+     * it is computed; results are still full Mat4s */
+
+    /* T * Ry * Rx * Rz * S straight from the sines and cosines, the
+     * product Mat4_Multiply() would give term for term */
+    static inline void Mat4_ComposeTRS(Mat4* m, Vec3 t, Vec3 euler, Vec3 s) {
+        float sx, cx, sy, cy, sz, cz;
+        Math_SinCos(euler.x, &sx, &cx);
+        Math_SinCos(euler.y, &sy, &cy);
+        Math_SinCos(euler.z, &sz, &cz);
+        float sxsy = sy * sx, sxcy = cy * sx;
+
+        m->m[0] = (cy * cz + sxsy * sz) * s.x;
+        m->m[1] = (cx * sz) * s.x;
+        m->m[2] = (-sy * cz + sxcy * sz) * s.x;
+        m->m[3] = 0;
+        m->m[4] = (cy * -sz + sxsy * cz) * s.y;
+        m->m[5] = (cx * cz) * s.y;
+        m->m[6] = (-sy * -sz + sxcy * cz) * s.y;
+        m->m[7] = 0;
+        m->m[8] = (sy * cx) * s.z;
+        m->m[9] = -sx * s.z;
+        m->m[10] = (cy * cx) * s.z;
+        m->m[11] = 0;
+        m->m[12] = t.x; m->m[13] = t.y; m->m[14] = t.z; m->m[15] = 1;
+    }
+
+    /* a * b for affine a and b: 36 multiply-adds instead of 64 */
+    static inline void Mat4_MultiplyAffine(Mat4* out, const Mat4* a, const Mat4* b) {
+#if defined(MATH3D_SSE) || defined(MATH3D_NEON)
+        M3DVec a0 = M3D_LOAD(&a->m[0]), a1 = M3D_LOAD(&a->m[4]);
+        M3DVec a2 = M3D_LOAD(&a->m[8]), a3 = M3D_LOAD(&a->m[12]);
+        M3DVec r[4];
+        int col;
+        for (col = 0; col < 4; col++) {
+            const float* bc = &b->m[col * 4];
+            M3DVec c = M3D_MUL(a0, bc[0]);
+            c = M3D_MADD(c, a1, bc[1]);
+            r[col] = M3D_MADD(c, a2, bc[2]);
+        }
+        r[3] = M3D_MADD(r[3], a3, 1.0f);
+        for (col = 0; col < 4; col++) M3D_STORE(&out->m[col * 4], r[col]);
+#else
+        Mat4 r;
+        int row, col;
+        for (row = 0; row < 3; row++) {
+            for (col = 0; col < 4; col++) {
+                r.m[col * 4 + row] =
+                    a->m[0 * 4 + row] * b->m[col * 4 + 0] +
+                    a->m[1 * 4 + row] * b->m[col * 4 + 1] +
+                    a->m[2 * 4 + row] * b->m[col * 4 + 2];
+            }
+            r.m[12 + row] += a->m[12 + row];
+        }
+        r.m[3] = r.m[7] = r.m[11] = 0; r.m[15] = 1;
+        *out = r;
+#endif
+    }
+
+    /* Inverse of an affine matrix with any invertible 3x3 part (scaled
+     * or sheared); identity when singular */
+    static inline void Mat4_InverseAffine(Mat4* out, const Mat4* m) {
+        const float* a = m->m;
+        float c0 = a[5] * a[10] - a[9] * a[6];
+        float c1 = a[9] * a[2] - a[1] * a[10];
+        float c2 = a[1] * a[6] - a[5] * a[2];
+        float det = a[0] * c0 + a[4] * c1 + a[8] * c2;
+        if (fabsf(det) < 1e-30f) {
+            Mat4_Identity(out);
+            return;
+        }
+        float inv = 1.0f / det;
+        Mat4 r;
+        r.m[0] = c0 * inv;
+        r.m[1] = c1 * inv;
+        r.m[2] = c2 * inv;
+        r.m[4] = (a[8] * a[6] - a[4] * a[10]) * inv;
+        r.m[5] = (a[0] * a[10] - a[8] * a[2]) * inv;
+        r.m[6] = (a[4] * a[2] - a[0] * a[6]) * inv;
+        r.m[8] = (a[4] * a[9] - a[8] * a[5]) * inv;
+        r.m[9] = (a[8] * a[1] - a[0] * a[9]) * inv;
+        r.m[10] = (a[0] * a[5] - a[4] * a[1]) * inv;
+        r.m[12] = -(r.m[0] * a[12] + r.m[4] * a[13] + r.m[8] * a[14]);
+        r.m[13] = -(r.m[1] * a[12] + r.m[5] * a[13] + r.m[9] * a[14]);
+        r.m[14] = -(r.m[2] * a[12] + r.m[6] * a[13] + r.m[10] * a[14]);
+        r.m[3] = r.m[7] = r.m[11] = 0; r.m[15] = 1;
+        *out = r;
+    }
+
+    /* The center of projection of a projection, view-projection or MVP
+     * matrix in the space it transforms from, as the homogeneous point
+     * where clip x, y and w all vanish: w = 0 (a direction) for an
+     * orthographic matrix. Its dot product with a plane has the sign of
+     * the plane's side the eye is on, times the sign of w, so it orients
+     * faces without dividing. */
+    static inline Vec4 Mat4_ProjectionEye(const Mat4* m) {
+        Vec3 a = Vec3_Create(m->m[0], m->m[4], m->m[8]);
+        Vec3 b = Vec3_Create(m->m[1], m->m[5], m->m[9]);
+        Vec3 c = Vec3_Create(m->m[3], m->m[7], m->m[11]);
+        Vec3 bc = Vec3_Cross(b, c), ca = Vec3_Cross(c, a), ab = Vec3_Cross(a, b);
+        Vec4 r;
+        r.x = -(m->m[12] * bc.x + m->m[13] * ca.x + m->m[15] * ab.x);
+        r.y = -(m->m[12] * bc.y + m->m[13] * ca.y + m->m[15] * ab.y);
+        r.z = -(m->m[12] * bc.z + m->m[13] * ca.z + m->m[15] * ab.z);
+        r.w = Vec3_Dot(a, bc);
+        return r;
+    }
+
     /* Quaternion */
     static inline Quaternion Quat_Identity(void) { Quaternion q; q.x = 0; q.y = 0; q.z = 0; q.w = 1; return q; }
 
@@ -323,6 +533,15 @@ extern "C" {
         m->m[12] = 0;          m->m[13] = 0;          m->m[14] = 0;           m->m[15] = 1;
     }
 
+    /* T * R(q) * S for a unit q, composed directly */
+    static inline void Mat4_ComposeTRSQuat(Mat4* m, Vec3 t, Quaternion q, Vec3 s) {
+        Quat_ToMat4(m, q);
+        m->m[0] *= s.x; m->m[1] *= s.x; m->m[2] *= s.x;
+        m->m[4] *= s.y; m->m[5] *= s.y; m->m[6] *= s.y;
+        m->m[8] *= s.z; m->m[9] *= s.z; m->m[10] *= s.z;
+        m->m[12] = t.x; m->m[13] = t.y; m->m[14] = t.z;
+    }
+
     static inline Quaternion Quat_Slerp(Quaternion a, Quaternion b, float t) {
         float dot = a.x * b.x + a.y * b.y + a.z * b.z + a.w * b.w;
         float theta0, theta, sin_theta, sin_theta0, s0, s1;
@@ -342,10 +561,14 @@ extern "C" {
         sin_theta0 = sinf(theta0);
         s0 = cosf(theta) - dot * sin_theta / sin_theta0;
         s1 = sin_theta / sin_theta0;
+#if defined(MATH3D_SSE) || defined(MATH3D_NEON)
+        M3D_STORE(&result.x, M3D_MADD(M3D_MUL(M3D_LOAD(&a.x), s0), M3D_LOAD(&b.x), s1));
+#else
         result.x = a.x * s0 + b.x * s1;
         result.y = a.y * s0 + b.y * s1;
         result.z = a.z * s0 + b.z * s1;
         result.w = a.w * s0 + b.w * s1;
+#endif
         return result;
     }
 
@@ -0,0 +1,115 @@
+/**
+ * @file memmap.cpp
+ * @brief Startup Report Of Where Each Pool Lives
+ */
+
+#include "memmap.h"
+#include "engine_config.h"
+#include "mesh.h"
+#include "meshlod.h"
+#include "meshcluster.h"
+#include "meshorder.h"
+#include "texture.h"
+#include "texcache.h"
+#include "rasterizer.h"
+#include "arena.h"
+#include "scenebuffer.h"
+#include "occlusion.h"
+#include "stream.h"
+#include "profile.h"
+#include "capture.h"
+#include "staticlayer.h"
+#include "telemetry.h"
+#include <stdio.h>
+
+typedef struct {
+    const char* name;
+    uintptr_t base;
+    uint32_t size;
+} MemRegion_t;
+
+static const MemRegion_t g_regions[] = {
+    { "DTCM",     DTCM_BASE,      DTCM_SIZE },
+    { "AXI SRAM", AXI_SRAM_BASE,  AXI_SRAM_SIZE },
+    { "SRAM1",    SRAM1_BASE,     SRAM1_SIZE },
+    { "SRAM2",    SRAM2_BASE,     SRAM2_SIZE },
+    { "SRAM3",    SRAM3_BASE,     SRAM3_SIZE },
+    { "SRAM4",    SRAM4_BASE,     SRAM4_SIZE },
+    { "SDRAM",    SDRAM_BASE,     SDRAM_SIZE },
+};
+#define REGION_COUNT    (sizeof(g_regions) / sizeof(g_regions[0]))
+
+/* Addresses outside every region: heap and statics of the host */
+#ifdef SDL_PC
+#define OTHER_REGION    "host"
+#else
+#define OTHER_REGION    "other"
+#endif
+
+static int FindRegion(const void* addr)
+{
+    uintptr_t a = (uintptr_t)addr;
+    for (uint32_t r = 0; r < REGION_COUNT; r++) {
+        if (a >= g_regions[r].base && a - g_regions[r].base < g_regions[r].size) return (int)r;
+    }
+    return -1;
+}
+
+const char* MemMap_RegionName(const void* addr)
+{
+    int r = FindRegion(addr);
+    if (r >= 0) return g_regions[r].name;
+    return OTHER_REGION;
+}
+
+uint32_t MemMap_Collect(MemPool_t* pools, uint32_t max)
+{
+    uint32_t count = 0;
+    count += Mesh_GetMemPools(pools + count, max - count);
+    count += MD2_GetMemPools(pools + count, max - count);
+    count += MeshLod_GetMemPools(pools + count, max - count);
+    count += MeshCluster_GetMemPools(pools + count, max - count);
+    count += MeshOrder_GetMemPools(pools + count, max - count);
+    count += Texture_GetMemPools(pools + count, max - count);
+    count += TexCache_GetMemPools(pools + count, max - count);
+    count += Rasterizer_GetMemPools(pools + count, max - count);
+    count += Arena_GetMemPools(pools + count, max - count);
+    count += SceneBuffer_GetMemPools(pools + count, max - count);
+    count += Occlusion_GetMemPools(pools + count, max - count);
+    count += Stream_GetMemPools(pools + count, max - count);
+    count += Profile_GetMemPools(pools + count, max - count);
+    count += Capture_GetMemPools(pools + count, max - count);
+    count += StaticLayer_GetMemPools(pools + count, max - count);
+    count += Telemetry_GetMemPools(pools + count, max - count);
+    return count;
+}
+
+void MemMap_Print(void)
+{
+    MemPool_t pools[MEMMAP_MAX_POOLS];
+    uint32_t count = MemMap_Collect(pools, MEMMAP_MAX_POOLS);
+
+    uint32_t region_total[REGION_COUNT] = { 0 };
+    uint32_t other_total = 0;
+
+    printf("Memory map:\n");
+    printf("  %-18s %-9s %-18s %10s %10s\n", "pool", "region", "address", "size KB", "used KB");
+    for (uint32_t i = 0; i < count; i++) {
+        const MemPool_t* p = &pools[i];
+        int r = FindRegion(p->base);
+        if (r >= 0) region_total[r] += p->size;
+        else other_total += p->size;
+
+        printf("  %-18s %-9s 0x%-16lX %10.1f %10.1f\n", p->name, MemMap_RegionName(p->base),
+            (unsigned long)(uintptr_t)p->base, p->size / 1024.0f, p->used / 1024.0f);
+    }
+
+    for (uint32_t r = 0; r < REGION_COUNT; r++) {
+        if (region_total[r] == 0) continue;
+        printf("  %-9s %8.1f / %8.1f KB reserved\n", g_regions[r].name,
+            region_total[r] / 1024.0f, g_regions[r].size / 1024.0f);
+    }
+    if (other_total > 0) {
+        printf("  %-9s %8.1f KB reserved\n", OTHER_REGION, other_total / 1024.0f);
+    }
+}
@@ -0,0 +1,56 @@
+/**
+ * @file memmap.h
+ * @brief Startup Report Of Where Each Pool Lives
+ *
+ * Every module that owns a large static buffer reports it through its
+ * *_GetMemPools() function; MemMap_Print() resolves the addresses
+ * against the memory map in engine_config.h and prints one line per
+ * buffer plus a per-region total. Placement itself is chosen with the
+ * PLACE_* macros in engine_config.h.
+ */
+
+#ifndef MEMMAP_H
+#define MEMMAP_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MEMMAP_MAX_POOLS        48
+
+typedef struct {
+    const char* name;
+    const void* base;
+    uint32_t size;          /* Bytes reserved */
+    uint32_t used;          /* Bytes in use (fixed buffers report their size) */
+} MemPool_t;
+
+/* Appends one entry if there is room; returns the new count */
+static inline uint32_t MemMap_Add(MemPool_t* out, uint32_t n, uint32_t max,
+    const char* name, const void* base, uint32_t size, uint32_t used)
+{
+    if (n < max) {
+        out[n].name = name;
+        out[n].base = base;
+        out[n].size = size;
+        out[n].used = used;
+        n++;
+    }
+    return n;
+}
+
+/* "DTCM", "AXI SRAM", "SRAM1".."SRAM4", "SDRAM"; "host" on PC */
+const char* MemMap_RegionName(const void* addr);
+
+/* Every module's pools, as MemMap_Print() lists them; returns the count */
+uint32_t MemMap_Collect(MemPool_t* pools, uint32_t max);
+
+void MemMap_Print(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MEMMAP_H */
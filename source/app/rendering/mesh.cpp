@@ -8,47 +8,51 @@
 
 #include "mesh.h"
 #include "platform.h"
+#include "pool.h"
+#include "meshbake.h"
 #include <string.h>
 #include <stdlib.h>
 
  /* ============================================================
   * Static Memory Pools
-  * On embedded: placed in SDRAM via linker script
-  * On PC: regular static memory
+  * Placed per PLACE_* in engine_config.h (SDRAM by default on embedded,
+  * regular static memory on PC)
   * ============================================================ */
-  
- 
-#ifdef SDL_PC
-MD2UV_t g_md2_uv_pool[MAX_MD2_VERTICES];
-#else
-MD2UV_t g_md2_uv_pool[MAX_MD2_VERTICES] SECTION_SDRAM;
-#endif
-
-#ifdef SDL_PC
-Vertex_t g_vertex_pool[MAX_TOTAL_VERTICES];
-uint16_t g_index_pool[MAX_TOTAL_INDICES];
-MD2Vertex_t g_md2_vertex_pool[MAX_MD2_VERTICES];
-#else
-  /* GCC embedded - use section attributes */
-Vertex_t g_vertex_pool[MAX_TOTAL_VERTICES] SECTION_SDRAM;
-uint16_t g_index_pool[MAX_TOTAL_INDICES] SECTION_SDRAM;
-MD2Vertex_t g_md2_vertex_pool[MAX_MD2_VERTICES] SECTION_SDRAM;
-#endif
-
-
-uint32_t g_vertex_used = 0;
-uint32_t g_index_used = 0;
-uint32_t g_md2_uv_used = 0;
+
+PLACE_VERTEX_POOL Vertex_t g_vertex_pool[MAX_TOTAL_VERTICES];
+PLACE_VERTEX_POOL float g_position_x[MAX_TOTAL_VERTICES];
+PLACE_VERTEX_POOL float g_position_y[MAX_TOTAL_VERTICES];
+PLACE_VERTEX_POOL float g_position_z[MAX_TOTAL_VERTICES];
+PLACE_VERTEX_POOL PackedVertex_t g_packed_pool[MAX_TOTAL_VERTICES];
+PLACE_INDEX_POOL uint16_t g_index_pool[MAX_TOTAL_INDICES];
+PLACE_INDEX_POOL Vec4 g_face_pool[MAX_TOTAL_INDICES / 3];
+PLACE_INDEX_POOL MeshCluster_t g_cluster_pool[MAX_MESH_CLUSTERS];
+PLACE_MD2_POOL MD2Vertex_t g_md2_vertex_pool[MAX_MD2_VERTICES];
+PLACE_MD2_POOL MD2UV_t g_md2_uv_pool[MAX_MD2_UVS];
+
+/* Free lists over the pools above */
+static Pool_t g_vertex_alloc;
+static Pool_t g_index_alloc;
+static Pool_t g_frame_alloc;
+static Pool_t g_md2_vertex_alloc;
+static Pool_t g_md2_uv_alloc;
+static Pool_t g_cluster_alloc;
 
 /* MD2 frame descriptors */
 MD2FrameDesc_t g_frame_pool[MAX_MD2_FRAMES];
-uint32_t g_frame_used = 0;
-
-uint32_t g_md2_vertex_used = 0;
 
 /* Mesh slots */
 MeshSlot_t g_meshes[MAX_MESHES];
 
+/* Per slot: the file it was loaded from and its holders past the first */
+typedef struct {
+    uint64_t hash;
+    uint32_t size;              /* 0 = no source file */
+    uint16_t extra_refs;        /* MESH_MAX_REFS - 1 = saturated */
+} MeshSource_t;
+
+static MeshSource_t g_mesh_sources[MAX_MESHES];
+
 /* ============================================================
  * Pool Management
  * ============================================================ */
@@ -56,15 +60,39 @@ MeshSlot_t g_meshes[MAX_MESHES];
 void Mesh_Init(void)
 {
     memset(g_meshes, 0, sizeof(g_meshes));
-    g_vertex_used = 0;
-    g_index_used = 0;
-    g_frame_used = 0;
-    g_md2_vertex_used = 0;
-    g_md2_uv_used = 0;
+    memset(g_mesh_sources, 0, sizeof(g_mesh_sources));
+    Pool_Init(&g_vertex_alloc, MAX_TOTAL_VERTICES);
+    Pool_Init(&g_index_alloc, MAX_TOTAL_INDICES);
+    Pool_Init(&g_frame_alloc, MAX_MD2_FRAMES);
+    Pool_Init(&g_md2_vertex_alloc, MAX_MD2_VERTICES);
+    Pool_Init(&g_md2_uv_alloc, MAX_MD2_UVS);
+    Pool_Init(&g_cluster_alloc, MAX_MESH_CLUSTERS);
 }
 
-uint32_t Mesh_GetFreeVertexCount(void) { return MAX_TOTAL_VERTICES - g_vertex_used; }
-uint32_t Mesh_GetFreeIndexCount(void) { return MAX_TOTAL_INDICES - g_index_used; }
+uint32_t Mesh_GetFreeVertexCount(void) { return Pool_GetFree(&g_vertex_alloc); }
+uint32_t Mesh_GetFreeIndexCount(void) { return Pool_GetFree(&g_index_alloc); }
+
+uint32_t Mesh_GetMemPools(MemPool_t* out, uint32_t max)
+{
+    uint32_t verts = MAX_TOTAL_VERTICES - Pool_GetFree(&g_vertex_alloc);
+    uint32_t indices = MAX_TOTAL_INDICES - Pool_GetFree(&g_index_alloc);
+    uint32_t md2_verts = MAX_MD2_VERTICES - Pool_GetFree(&g_md2_vertex_alloc);
+    uint32_t md2_uvs = MAX_MD2_UVS - Pool_GetFree(&g_md2_uv_alloc);
+    uint32_t clusters = MAX_MESH_CLUSTERS - Pool_GetFree(&g_cluster_alloc);
+    uint32_t n = 0;
+
+    n = MemMap_Add(out, n, max, "vertices", g_vertex_pool, sizeof(g_vertex_pool), verts * sizeof(Vertex_t));
+    n = MemMap_Add(out, n, max, "positions x", g_position_x, sizeof(g_position_x), verts * sizeof(float));
+    n = MemMap_Add(out, n, max, "positions y", g_position_y, sizeof(g_position_y), verts * sizeof(float));
+    n = MemMap_Add(out, n, max, "positions z", g_position_z, sizeof(g_position_z), verts * sizeof(float));
+    n = MemMap_Add(out, n, max, "packed vertices", g_packed_pool, sizeof(g_packed_pool), verts * sizeof(PackedVertex_t));
+    n = MemMap_Add(out, n, max, "indices", g_index_pool, sizeof(g_index_pool), indices * sizeof(uint16_t));
+    n = MemMap_Add(out, n, max, "face planes", g_face_pool, sizeof(g_face_pool), indices / 3 * sizeof(Vec4));
+    n = MemMap_Add(out, n, max, "clusters", g_cluster_pool, sizeof(g_cluster_pool), clusters * sizeof(MeshCluster_t));
+    n = MemMap_Add(out, n, max, "md2 vertices", g_md2_vertex_pool, sizeof(g_md2_vertex_pool), md2_verts * sizeof(MD2Vertex_t));
+    n = MemMap_Add(out, n, max, "md2 uv pairs", g_md2_uv_pool, sizeof(g_md2_uv_pool), md2_uvs * sizeof(MD2UV_t));
+    return n;
+}
 
 uint32_t AllocMeshSlot(void)
 {
@@ -74,37 +102,41 @@ uint32_t AllocMeshSlot(void)
     return 0xFFFFFFFF;
 }
 
-uint32_t AllocVertices(uint32_t count)
+uint32_t FindMeshSource(uint64_t hash, uint32_t size)
 {
-    if (g_vertex_used + count > MAX_TOTAL_VERTICES) return 0xFFFFFFFF;
-    uint32_t start = g_vertex_used;
-    g_vertex_used += count;
-    return start;
+    if (size == 0) return 0xFFFFFFFF;
+    for (uint32_t i = 0; i < MAX_MESHES; i++) {
+        if (g_meshes[i].type != 0 && g_mesh_sources[i].size == size && g_mesh_sources[i].hash == hash) {
+            Mesh_Retain(i);
+            return i;
+        }
+    }
+    return 0xFFFFFFFF;
 }
 
-uint32_t AllocIndices(uint32_t count)
+void SetMeshSource(uint32_t slot, uint64_t hash, uint32_t size)
 {
-    if (g_index_used + count > MAX_TOTAL_INDICES) return 0xFFFFFFFF;
-    uint32_t start = g_index_used;
-    g_index_used += count;
-    return start;
+    g_mesh_sources[slot].hash = hash;
+    g_mesh_sources[slot].size = size;
+    g_mesh_sources[slot].extra_refs = 0;
 }
 
-uint32_t AllocFrames(uint32_t count)
-{
-    if (g_frame_used + count > MAX_MD2_FRAMES) return 0xFFFFFFFF;
-    uint32_t start = g_frame_used;
-    g_frame_used += count;
-    return start;
-}
+uint32_t AllocVertices(uint32_t count) { return Pool_Alloc(&g_vertex_alloc, count); }
+uint32_t AllocIndices(uint32_t count) { return Pool_Alloc(&g_index_alloc, count); }
+uint32_t AllocFrames(uint32_t count) { return Pool_Alloc(&g_frame_alloc, count); }
+uint32_t AllocMD2Vertices(uint32_t count) { return Pool_Alloc(&g_md2_vertex_alloc, count); }
+uint32_t AllocMD2UVs(uint32_t count) { return Pool_Alloc(&g_md2_uv_alloc, count); }
+uint32_t AllocClusters(uint32_t count) { return Pool_Alloc(&g_cluster_alloc, count); }
 
-uint32_t AllocMD2Vertices(uint32_t count)
-{
-    if (g_md2_vertex_used + count > MAX_MD2_VERTICES) return 0xFFFFFFFF;
-    uint32_t start = g_md2_vertex_used;
-    g_md2_vertex_used += count;
-    return start;
-}
+uint32_t GetLargestFreeVertices(void) { return Pool_GetLargestFree(&g_vertex_alloc); }
+uint32_t GetLargestFreeIndices(void) { return Pool_GetLargestFree(&g_index_alloc); }
+
+void FreeVertices(uint32_t start, uint32_t count) { Pool_Free(&g_vertex_alloc, start, count); }
+void FreeIndices(uint32_t start, uint32_t count) { Pool_Free(&g_index_alloc, start, count); }
+void FreeFrames(uint32_t start, uint32_t count) { Pool_Free(&g_frame_alloc, start, count); }
+void FreeMD2Vertices(uint32_t start, uint32_t count) { Pool_Free(&g_md2_vertex_alloc, start, count); }
+void FreeMD2UVs(uint32_t start, uint32_t count) { Pool_Free(&g_md2_uv_alloc, start, count); }
+void FreeClusters(uint32_t start, uint32_t count) { Pool_Free(&g_cluster_alloc, start, count); }
 
 /* ============================================================
  * Accessors
@@ -116,11 +148,229 @@ MeshSlot_t* Mesh_Get(uint32_t id)
     return &g_meshes[id];
 }
 
+static inline const MeshBakedHeader_t* Baked(const MeshSlot_t* m)
+{
+    return (m->flags & MESH_FLAG_BAKED) ? (const MeshBakedHeader_t*)m->image : NULL;
+}
+
+const Vertex_t* Mesh_GetVertices(const MeshSlot_t* m)
+{
+    const MeshBakedHeader_t* h = Baked(m);
+    if (h) return (const Vertex_t*)MeshBaked_Section(h, MESH_BAKED_VERTICES);
+    return (m->type == 1) ? &g_vertex_pool[m->stat.vertex_start] : NULL;
+}
+
+const uint16_t* Mesh_GetIndices(const MeshSlot_t* m)
+{
+    const MeshBakedHeader_t* h = Baked(m);
+    if (h) return (const uint16_t*)MeshBaked_Section(h, MESH_BAKED_INDICES);
+    if (m->type == 1) return &g_index_pool[m->stat.index_start];
+    if (m->type == 2) return &g_index_pool[m->anim.index_start];
+    return NULL;
+}
+
+uint32_t Mesh_GetIndexTotal(const MeshSlot_t* m)
+{
+    if (m->lod_count > 1) {
+        const MeshLod_t* last = &m->lods[m->lod_count - 1];
+        return last->index_offset + last->index_count;
+    }
+    return (m->type == 1) ? m->stat.index_count : (m->type == 2) ? m->anim.index_count : 0;
+}
+
+void Mesh_GetPositions(const MeshSlot_t* m, const float** x, const float** y, const float** z)
+{
+    const MeshBakedHeader_t* h = Baked(m);
+    *x = *y = *z = NULL;
+    if (h) {
+        *x = (const float*)MeshBaked_Section(h, MESH_BAKED_POSITION_X);
+        *y = (const float*)MeshBaked_Section(h, MESH_BAKED_POSITION_Y);
+        *z = (const float*)MeshBaked_Section(h, MESH_BAKED_POSITION_Z);
+        if (!*x || !*y || !*z) *x = *y = *z = NULL;
+    }
+    else if (m->type == 1) {
+        *x = &g_position_x[m->stat.vertex_start];
+        *y = &g_position_y[m->stat.vertex_start];
+        *z = &g_position_z[m->stat.vertex_start];
+    }
+}
+
+const PackedVertex_t* Mesh_GetPackedVertices(const MeshSlot_t* m)
+{
+    if (!(m->flags & MESH_FLAG_PACKED)) return NULL;
+    const MeshBakedHeader_t* h = Baked(m);
+    if (h) return (const PackedVertex_t*)MeshBaked_Section(h, MESH_BAKED_PACKED);
+    return &g_packed_pool[m->stat.vertex_start];
+}
+
+const MD2FrameDesc_t* Mesh_GetFrames(const MeshSlot_t* m)
+{
+    const MeshBakedHeader_t* h = Baked(m);
+    if (h) return (const MD2FrameDesc_t*)MeshBaked_Section(h, MESH_BAKED_FRAMES);
+    return (m->type == 2) ? &g_frame_pool[m->anim.frame_start] : NULL;
+}
+
+const MD2Vertex_t* Mesh_GetFrameVertices(const MeshSlot_t* m, uint32_t frame)
+{
+    const MD2FrameDesc_t* frames = Mesh_GetFrames(m);
+    if (!frames || frame >= m->anim.frame_count) return NULL;
+    const MeshBakedHeader_t* h = Baked(m);
+    const MD2Vertex_t* base = h ? (const MD2Vertex_t*)MeshBaked_Section(h, MESH_BAKED_MD2_VERTICES) : g_md2_vertex_pool;
+    return base ? &base[frames[frame].vertex_start] : NULL;
+}
+
+const MD2UV_t* Mesh_GetUVPairs(const MeshSlot_t* m)
+{
+    const MeshBakedHeader_t* h = Baked(m);
+    if (h) return (const MD2UV_t*)MeshBaked_Section(h, MESH_BAKED_UV_PAIRS);
+    return (m->type == 2) ? &g_md2_uv_pool[m->anim.uv_start] : NULL;
+}
+
+const MeshCluster_t* Mesh_GetClusters(const MeshSlot_t* m, uint32_t* count)
+{
+    *count = 0;
+    if (m->type != 1) return NULL;
+    const MeshBakedHeader_t* h = Baked(m);
+    const MeshCluster_t* clusters = h ? (const MeshCluster_t*)MeshBaked_Section(h, MESH_BAKED_CLUSTERS) :
+        (m->stat.cluster_count ? &g_cluster_pool[m->stat.cluster_start] : NULL);
+    if (clusters) *count = m->stat.cluster_count;
+    return clusters;
+}
+
 Vertex_t* Mesh_GetVertexPtr(uint32_t start)
 {
     return (start < MAX_TOTAL_VERTICES) ? &g_vertex_pool[start] : NULL;
 }
 
+void Mesh_UpdatePositions(uint32_t start, uint32_t count)
+{
+    if (start >= MAX_TOTAL_VERTICES) return;
+    if (count > MAX_TOTAL_VERTICES - start) count = MAX_TOTAL_VERTICES - start;
+    for (uint32_t i = start; i < start + count; i++) {
+        g_position_x[i] = g_vertex_pool[i].position.x;
+        g_position_y[i] = g_vertex_pool[i].position.y;
+        g_position_z[i] = g_vertex_pool[i].position.z;
+    }
+}
+
+/* ============================================================
+ * Face Planes
+ * ============================================================ */
+
+/* Packed meshes are drawn from the quantized positions: so are their
+ * planes, for the same edge-on verdicts as the rasterizer */
+static Vec3 FacePosition(const MeshSlot_t* m, const Vertex_t* verts, uint16_t i)
+{
+    if (!(m->flags & MESH_FLAG_PACKED)) return verts[i].position;
+    const PackedVertex_t* p = &g_packed_pool[m->stat.vertex_start + i];
+    float s = m->stat.bounds_radius / (float)PACKED_POS_ONE;
+    return Vec3_Add(m->stat.bounds_center, Vec3_Scale(MakeVec3(p->x, p->y, p->z), s));
+}
+
+static void BuildFacePlanes(MeshSlot_t* m)
+{
+    const StaticMeshDesc_t* desc = &m->stat;
+    const Vertex_t* verts = &g_vertex_pool[desc->vertex_start];
+    const uint16_t* indices = &g_index_pool[desc->index_start];
+    uint32_t total = Mesh_GetIndexTotal(m);
+
+    /* Levels start on whole triangles, so every triangle is at a
+     * multiple of 3 from index_start */
+    Vec4* planes = &g_face_pool[desc->index_start / 3];
+    for (uint32_t i = 0; i + 2 < total; i += 3) {
+        Vec3 a = FacePosition(m, verts, indices[i]);
+        Vec3 b = FacePosition(m, verts, indices[i + 1]);
+        Vec3 c = FacePosition(m, verts, indices[i + 2]);
+
+        /* Oriented to the rasterizer's front faces */
+        Vec3 n = Vec3_Cross(Vec3_Sub(b, a), Vec3_Sub(c, a));
+        planes[i / 3] = MakeVec4(n.x, n.y, n.z, -Vec3_Dot(n, a));
+    }
+    m->flags |= MESH_FLAG_FACE_PLANES;
+}
+
+int Mesh_BuildFacePlanes(uint32_t mesh_id)
+{
+    MeshSlot_t* m = Mesh_Get(mesh_id);
+    if (!m || m->type != 1 || (m->flags & MESH_FLAG_BAKED)) return 0;
+    BuildFacePlanes(m);
+    return 1;
+}
+
+const Vec4* Mesh_GetLodFacePlanes(const MeshSlot_t* m, uint32_t lod)
+{
+    if (!(m->flags & MESH_FLAG_FACE_PLANES)) return NULL;
+    uint32_t offset = (m->lod_count > 1) ? m->lods[MIN(lod, m->lod_count - 1u)].index_offset : 0;
+    return &g_face_pool[m->stat.index_start / 3 + offset / 3];
+}
+
+/* ============================================================
+ * Packed Static Vertices
+ * ============================================================ */
+
+static int16_t PackSnorm(float f)
+{
+    if (f > 1.0f) f = 1.0f;
+    if (f < -1.0f) f = -1.0f;
+    return (int16_t)lrintf(f * (float)PACKED_POS_ONE);
+}
+
+static uint16_t PackOctNormal(Vec3 n)
+{
+    float sum = fabsf(n.x) + fabsf(n.y) + fabsf(n.z);
+    if (sum <= 0.0f) return PackOctNormal(MakeVec3(0, 1, 0));
+    float x = n.x / sum, y = n.y / sum;
+    if (n.z < 0.0f) {
+        float fx = (1.0f - fabsf(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+        float fy = (1.0f - fabsf(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+        x = fx; y = fy;
+    }
+    uint32_t qx = (uint32_t)lrintf((x * 0.5f + 0.5f) * 255.0f);
+    uint32_t qy = (uint32_t)lrintf((y * 0.5f + 0.5f) * 255.0f);
+    return (uint16_t)(qx | (qy << 8));
+}
+
+int Mesh_PackStatic(uint32_t mesh_id)
+{
+    MeshSlot_t* m = Mesh_Get(mesh_id);
+    if (!m || m->type != 1) return 0;
+    if (m->flags & MESH_FLAG_BAKED) return (m->flags & MESH_FLAG_PACKED) != 0;
+
+    const StaticMeshDesc_t* desc = &m->stat;
+    const Vertex_t* src = &g_vertex_pool[desc->vertex_start];
+    PackedVertex_t* dst = &g_packed_pool[desc->vertex_start];
+
+    /* UVs must fit the fixed-point range */
+    const float uv_max = 32767.0f / (float)PACKED_UV_ONE;
+    for (uint32_t i = 0; i < desc->vertex_count; i++) {
+        if (fabsf(src[i].texcoord.x) > uv_max || fabsf(src[i].texcoord.y) > uv_max) return 0;
+    }
+
+    float inv_r = (desc->bounds_radius > 0.0f) ? 1.0f / desc->bounds_radius : 0.0f;
+    for (uint32_t i = 0; i < desc->vertex_count; i++) {
+        Vec3 p = Vec3_Scale(Vec3_Sub(src[i].position, desc->bounds_center), inv_r);
+        dst[i].x = PackSnorm(p.x);
+        dst[i].y = PackSnorm(p.y);
+        dst[i].z = PackSnorm(p.z);
+        dst[i].normal = PackOctNormal(src[i].normal);
+        dst[i].u = (int16_t)lrintf(src[i].texcoord.x * (float)PACKED_UV_ONE);
+        dst[i].v = (int16_t)lrintf(src[i].texcoord.y * (float)PACKED_UV_ONE);
+    }
+
+    m->flags |= MESH_FLAG_PACKED;
+    if (m->flags & MESH_FLAG_FACE_PLANES) BuildFacePlanes(m);
+    return 1;
+}
+
+void Mesh_GetPackedDequant(const StaticMeshDesc_t* desc, Mat4* m)
+{
+    float s = desc->bounds_radius / (float)PACKED_POS_ONE;
+    Mat4_Scale(m, s, s, s);
+    m->m[12] = desc->bounds_center.x;
+    m->m[13] = desc->bounds_center.y;
+    m->m[14] = desc->bounds_center.z;
+}
+
 uint16_t* Mesh_GetIndexPtr(uint32_t start)
 {
     return (start < MAX_TOTAL_INDICES) ? &g_index_pool[start] : NULL;
@@ -160,7 +410,11 @@ uint32_t Mesh_CreateCube(float size)
 
     uint32_t v_start = AllocVertices(24);
     uint32_t i_start = AllocIndices(36);
-    if (v_start == 0xFFFFFFFF || i_start == 0xFFFFFFFF) return 0xFFFFFFFF;
+    if (v_start == 0xFFFFFFFF || i_start == 0xFFFFFFFF) {
+        if (v_start != 0xFFFFFFFF) FreeVertices(v_start, 24);
+        if (i_start != 0xFFFFFFFF) FreeIndices(i_start, 36);
+        return 0xFFFFFFFF;
+    }
 
     float h = size * 0.5f;
     Vertex_t* v = &g_vertex_pool[v_start];
@@ -203,6 +457,8 @@ uint32_t Mesh_CreateCube(float size)
     };
     memcpy(idx, indices, sizeof(indices));
 
+    Mesh_UpdatePositions(v_start, 24);
+
     g_meshes[slot].type = 1;
     g_meshes[slot].stat.vertex_start = v_start;
     g_meshes[slot].stat.vertex_count = 24;
@@ -210,6 +466,7 @@ uint32_t Mesh_CreateCube(float size)
     g_meshes[slot].stat.index_count = 36;
     g_meshes[slot].stat.bounds_center = MakeVec3(0, 0, 0);
     g_meshes[slot].stat.bounds_radius = h * 1.732f;
+    BuildFacePlanes(&g_meshes[slot]);
 
     return slot;
 }
@@ -221,7 +478,11 @@ uint32_t Mesh_CreatePlane(float w, float h)
 
     uint32_t v_start = AllocVertices(4);
     uint32_t i_start = AllocIndices(6);
-    if (v_start == 0xFFFFFFFF || i_start == 0xFFFFFFFF) return 0xFFFFFFFF;
+    if (v_start == 0xFFFFFFFF || i_start == 0xFFFFFFFF) {
+        if (v_start != 0xFFFFFFFF) FreeVertices(v_start, 4);
+        if (i_start != 0xFFFFFFFF) FreeIndices(i_start, 6);
+        return 0xFFFFFFFF;
+    }
 
     float hw = w * 0.5f, hh = h * 0.5f;
     Vertex_t* v = &g_vertex_pool[v_start];
@@ -235,6 +496,8 @@ uint32_t Mesh_CreatePlane(float w, float h)
     idx[0] = 0; idx[1] = 2; idx[2] = 1;
     idx[3] = 0; idx[4] = 3; idx[5] = 2;
 
+    Mesh_UpdatePositions(v_start, 4);
+
     g_meshes[slot].type = 1;
     g_meshes[slot].stat.vertex_start = v_start;
     g_meshes[slot].stat.vertex_count = 4;
@@ -242,308 +505,243 @@ uint32_t Mesh_CreatePlane(float w, float h)
     g_meshes[slot].stat.index_count = 6;
     g_meshes[slot].stat.bounds_center = MakeVec3(0, 0, 0);
     g_meshes[slot].stat.bounds_radius = (hw > hh) ? hw : hh;
+    BuildFacePlanes(&g_meshes[slot]);
 
     return slot;
 }
 
 /* ============================================================
- * OBJ Loader - No malloc version
+ * Staged Meshes
  * ============================================================ */
 
- /* Temporary parsing buffers - static allocation */
-#define OBJ_MAX_POS     2048
-#define OBJ_MAX_NORM    2048
-#define OBJ_MAX_UV      2048
+static uint32_t CommitStaged(const MeshStaging_t* staged, uint32_t slot);
 
-static Vec3 s_obj_pos[OBJ_MAX_POS];
-static Vec3 s_obj_norm[OBJ_MAX_NORM];
-static Vec2 s_obj_uv[OBJ_MAX_UV];
-
-static int ParseFloat(const char** s, float* out)
+uint32_t Mesh_CommitStaged(const MeshStaging_t* staged)
 {
-    while (**s == ' ' || **s == '\t') (*s)++;
-    if (**s == '\0' || **s == '\n' || **s == '\r') return 0;
-    char* end;
-    *out = (float)strtod(*s, &end);
-    if (end == *s) return 0;
-    *s = end;
-    return 1;
+    if (!staged || staged->index_count == 0) return 0xFFFFFFFF;
+
+    /* Same file again, e.g. two requests decoded side by side */
+    uint32_t shared = FindMeshSource(staged->source_hash, staged->source_size);
+    if (shared != 0xFFFFFFFF) return shared;
+
+    uint32_t slot = AllocMeshSlot();
+    if (slot == 0xFFFFFFFF) return 0xFFFFFFFF;
+    slot = CommitStaged(staged, slot);
+    if (slot != 0xFFFFFFFF) SetMeshSource(slot, staged->source_hash, staged->source_size);
+    return slot;
 }
 
-static int ParseInt(const char** s, int* out)
+static uint32_t CommitStaged(const MeshStaging_t* staged, uint32_t slot)
 {
-    while (**s == ' ' || **s == '\t') (*s)++;
-    if (**s == '\0' || **s == '\n' || **s == '\r') return 0;
-    char* end;
-    *out = (int)strtol(*s, &end, 10);
-    if (end == *s) return 0;
-    *s = end;
-    return 1;
+    uint32_t i_count = staged->index_count;
+    uint32_t i_start = AllocIndices(i_count);
+    if (i_start == 0xFFFFFFFF) return 0xFFFFFFFF;
+    memcpy(&g_index_pool[i_start], staged->indices, i_count * sizeof(uint16_t));
+
+    if (staged->type == 1) {
+        uint32_t v_count = staged->vertex_count;
+        uint32_t v_start = AllocVertices(v_count);
+        if (v_start == 0xFFFFFFFF) {
+            FreeIndices(i_start, i_count);
+            return 0xFFFFFFFF;
+        }
+        memcpy(&g_vertex_pool[v_start], staged->vertices, v_count * sizeof(Vertex_t));
+        Mesh_UpdatePositions(v_start, v_count);
+
+        g_meshes[slot].type = 1;
+        g_meshes[slot].stat.vertex_start = v_start;
+        g_meshes[slot].stat.vertex_count = v_count;
+        g_meshes[slot].stat.index_start = i_start;
+        g_meshes[slot].stat.index_count = i_count;
+        g_meshes[slot].stat.bounds_center = staged->bounds_center;
+        g_meshes[slot].stat.bounds_radius = staged->bounds_radius;
+        Mesh_BuildFacePlanes(slot);
+        return slot;
+    }
+
+    uint32_t uv_start = AllocMD2UVs(staged->uv_count);
+    uint32_t frame_start = AllocFrames(staged->frame_count);
+    uint32_t vert_start = AllocMD2Vertices(staged->md2_vertex_count);
+    if (uv_start == 0xFFFFFFFF || frame_start == 0xFFFFFFFF || vert_start == 0xFFFFFFFF) {
+        if (uv_start != 0xFFFFFFFF) FreeMD2UVs(uv_start, staged->uv_count);
+        if (frame_start != 0xFFFFFFFF) FreeFrames(frame_start, staged->frame_count);
+        if (vert_start != 0xFFFFFFFF) FreeMD2Vertices(vert_start, staged->md2_vertex_count);
+        FreeIndices(i_start, i_count);
+        return 0xFFFFFFFF;
+    }
+    memcpy(&g_md2_uv_pool[uv_start], staged->uvs, staged->uv_count * sizeof(MD2UV_t));
+    memcpy(&g_md2_vertex_pool[vert_start], staged->md2_vertices, staged->md2_vertex_count * sizeof(MD2Vertex_t));
+    for (uint32_t f = 0; f < staged->frame_count; f++) {
+        g_frame_pool[frame_start + f] = staged->frames[f];
+        g_frame_pool[frame_start + f].vertex_start += vert_start;
+    }
+
+    g_meshes[slot].type = 2;
+    g_meshes[slot].anim.frame_start = frame_start;
+    g_meshes[slot].anim.frame_count = (uint16_t)staged->frame_count;
+    g_meshes[slot].anim.index_start = i_start;
+    g_meshes[slot].anim.index_count = (uint16_t)i_count;
+    g_meshes[slot].anim.verts_per_frame = (uint16_t)(staged->frame_count ? staged->frames[0].vertex_count : 0);
+    g_meshes[slot].anim.uv_start = uv_start;
+    g_meshes[slot].anim.uv_count = (uint16_t)staged->uv_count;
+    g_meshes[slot].anim.bounds_center = staged->bounds_center;
+    g_meshes[slot].anim.bounds_radius = staged->bounds_radius;
+    return slot;
 }
 
-static void ParseFaceIdx(const char** s, int* v, int* vt, int* vn)
+/* ============================================================
+ * Mesh Freeing
+ * ============================================================ */
+
+void Mesh_Retain(uint32_t id)
 {
-    *v = *vt = *vn = 0;
-    ParseInt(s, v);
-    if (**s == '/') {
-        (*s)++;
-        if (**s != '/') ParseInt(s, vt);
-        if (**s == '/') { (*s)++; ParseInt(s, vn); }
+    if (id < MAX_MESHES && g_meshes[id].type != 0 && g_mesh_sources[id].extra_refs < MESH_MAX_REFS - 1) {
+        g_mesh_sources[id].extra_refs++;
     }
-    while (**s == ' ' || **s == '\t') (*s)++;
 }
 
-uint32_t Mesh_LoadOBJ(const void* data, uint32_t size)
+uint32_t Mesh_GetRefs(uint32_t id)
 {
-    if (!data || size == 0) return 0xFFFFFFFF;
-
-    uint32_t pos_count = 0, norm_count = 0, uv_count = 0;
-
-    /* First pass: count and store raw data */
-    const char* ptr = (const char*)data;
-    const char* end = ptr + size;
-    char line[256];
-
-    while (ptr < end) {
-        int len = 0;
-        while (ptr < end && *ptr != '\n' && *ptr != '\r' && len < 254)
-            line[len++] = *ptr++;
-        line[len] = '\0';
-        while (ptr < end && (*ptr == '\n' || *ptr == '\r')) ptr++;
+    return (id < MAX_MESHES && g_meshes[id].type != 0) ? g_mesh_sources[id].extra_refs + 1u : 0;
+}
 
-        const char* lp = line;
-        while (*lp == ' ' || *lp == '\t') lp++;
+void Mesh_Free(uint32_t id)
+{
+    if (id < MAX_MESHES) {
+        MeshSource_t* source = &g_mesh_sources[id];
+        if (g_meshes[id].type != 0 && source->extra_refs > 0) {
+            if (source->extra_refs < MESH_MAX_REFS - 1) source->extra_refs--;
+            return;
+        }
+        memset(source, 0, sizeof(*source));
 
-        if (lp[0] == 'v' && lp[1] == ' ') {
-            lp += 2;
-            Vec3 p;
-            if (ParseFloat(&lp, &p.x) && ParseFloat(&lp, &p.y) && ParseFloat(&lp, &p.z)) {
-                if (pos_count < OBJ_MAX_POS) s_obj_pos[pos_count++] = p;
-            }
+        MeshSlot_t* m = &g_meshes[id];
+        if (m->type == 2) Mesh_InvalidateMD2Poses(id);
+        if (m->flags & MESH_FLAG_BAKED) {
+            /* Nothing in the pools; the image belongs to the caller */
         }
-        else if (lp[0] == 'v' && lp[1] == 't' && lp[2] == ' ') {
-            lp += 3;
-            Vec2 t;
-            if (ParseFloat(&lp, &t.x) && ParseFloat(&lp, &t.y)) {
-                t.y = 1.0f - t.y;
-                if (uv_count < OBJ_MAX_UV) s_obj_uv[uv_count++] = t;
-            }
+        else if (m->type == 1) {
+            FreeVertices(m->stat.vertex_start, m->stat.vertex_count);
+            FreeIndices(m->stat.index_start, Mesh_GetIndexTotal(m));
+            FreeClusters(m->stat.cluster_start, m->stat.cluster_count);
         }
-        else if (lp[0] == 'v' && lp[1] == 'n' && lp[2] == ' ') {
-            lp += 3;
-            Vec3 n;
-            if (ParseFloat(&lp, &n.x) && ParseFloat(&lp, &n.y) && ParseFloat(&lp, &n.z)) {
-                if (norm_count < OBJ_MAX_NORM) s_obj_norm[norm_count++] = Vec3_Normalize(n);
+        else if (m->type == 2) {
+            FreeIndices(m->anim.index_start, Mesh_GetIndexTotal(m));
+            if (m->anim.frame_count > 0) {
+                FreeMD2Vertices(g_frame_pool[m->anim.frame_start].vertex_start,
+                    (uint32_t)m->anim.frame_count * m->anim.verts_per_frame);
             }
+            FreeFrames(m->anim.frame_start, m->anim.frame_count);
+            FreeMD2UVs(m->anim.uv_start, m->anim.uv_count);
         }
+        /* Loaders fill in only the descriptor fields they know */
+        memset(m, 0, sizeof(*m));
     }
+}
 
-    /* Count faces (second pass) */
-    uint32_t face_count = 0;
-    ptr = (const char*)data;
-    while (ptr < end) {
-        int len = 0;
-        while (ptr < end && *ptr != '\n' && *ptr != '\r' && len < 254)
-            line[len++] = *ptr++;
-        line[len] = '\0';
-        while (ptr < end && (*ptr == '\n' || *ptr == '\r')) ptr++;
-
-        const char* lp = line;
-        while (*lp == ' ' || *lp == '\t') lp++;
-        if (lp[0] == 'f' && lp[1] == ' ') face_count++;
-    }
-
-    /* Estimate vertex/index needs (faces * 3 for triangles, * 2 for quads) */
-    uint32_t max_verts = face_count * 4;
-    uint32_t max_indices = face_count * 6;
-
-    /* Allocate from pools */
-    uint32_t slot = AllocMeshSlot();
-    if (slot == 0xFFFFFFFF) return 0xFFFFFFFF;
-
-    uint32_t v_start = AllocVertices(max_verts);
-    uint32_t i_start = AllocIndices(max_indices);
-    if (v_start == 0xFFFFFFFF || i_start == 0xFFFFFFFF) return 0xFFFFFFFF;
-
-    Vertex_t* out_v = &g_vertex_pool[v_start];
-    uint16_t* out_i = &g_index_pool[i_start];
-    uint32_t v_count = 0, i_count = 0;
-
-    /* Third pass: build mesh */
-    ptr = (const char*)data;
-    while (ptr < end) {
-        int len = 0;
-        while (ptr < end && *ptr != '\n' && *ptr != '\r' && len < 254)
-            line[len++] = *ptr++;
-        line[len] = '\0';
-        while (ptr < end && (*ptr == '\n' || *ptr == '\r')) ptr++;
+/* ============================================================
+ * Compaction
+ * ============================================================ */
 
-        const char* lp = line;
-        while (*lp == ' ' || *lp == '\t') lp++;
+enum { POOL_VERTEX, POOL_INDEX, POOL_FRAME, POOL_MD2_VERTEX, POOL_MD2_UV, POOL_CLUSTER, POOL_KIND_COUNT };
 
-        if (lp[0] == 'f' && lp[1] == ' ') {
-            lp += 2;
+static Pool_t* const g_pools[POOL_KIND_COUNT] = {
+    &g_vertex_alloc, &g_index_alloc, &g_frame_alloc, &g_md2_vertex_alloc, &g_md2_uv_alloc, &g_cluster_alloc
+};
 
-            int fv[4], ft[4], fn[4];
-            int fc = 0;
+/* The mesh that owns `block` in pool `kind`, its offset field and the
+ * size of the allocation. NULL if no mesh starts there. */
+static MeshSlot_t* FindOwner(int kind, uint32_t block, uint32_t** field, uint32_t* count)
+{
+    for (uint32_t i = 0; i < MAX_MESHES; i++) {
+        MeshSlot_t* m = &g_meshes[i];
+        *field = NULL;
 
-            while (*lp && fc < 4) {
-                ParseFaceIdx(&lp, &fv[fc], &ft[fc], &fn[fc]);
-                if (fv[fc] != 0) fc++;
-                else break;
-            }
+        if (m->flags & MESH_FLAG_BAKED) continue;
 
-            if (fc >= 3 && v_count + fc <= max_verts && i_count + 6 <= max_indices) {
-                uint32_t base = v_count;
-
-                for (int i = 0; i < fc; i++) {
-                    int vi = (fv[i] > 0) ? fv[i] - 1 : (int)pos_count + fv[i];
-                    int ti = (ft[i] > 0) ? ft[i] - 1 : (ft[i] < 0) ? (int)uv_count + ft[i] : -1;
-                    int ni = (fn[i] > 0) ? fn[i] - 1 : (fn[i] < 0) ? (int)norm_count + fn[i] : -1;
-
-                    out_v[v_count].position = (vi >= 0 && vi < (int)pos_count) ? s_obj_pos[vi] : Vec3_Zero();
-                    out_v[v_count].texcoord = (ti >= 0 && ti < (int)uv_count) ? s_obj_uv[ti] : MakeVec2(0, 0);
-                    out_v[v_count].normal = (ni >= 0 && ni < (int)norm_count) ? s_obj_norm[ni] : MakeVec3(0, 1, 0);
-                    v_count++;
-                }
-
-                /* Triangle */
-                out_i[i_count++] = (uint16_t)base;
-                out_i[i_count++] = (uint16_t)(base + 1);
-                out_i[i_count++] = (uint16_t)(base + 2);
-
-                /* Quad -> second triangle */
-                if (fc == 4) {
-                    out_i[i_count++] = (uint16_t)base;
-                    out_i[i_count++] = (uint16_t)(base + 2);
-                    out_i[i_count++] = (uint16_t)(base + 3);
-                }
+        if (m->type == 1) {
+            if (kind == POOL_VERTEX) { *field = &m->stat.vertex_start; *count = m->stat.vertex_count; }
+            else if (kind == POOL_INDEX) { *field = &m->stat.index_start; *count = Mesh_GetIndexTotal(m); }
+            else if (kind == POOL_CLUSTER) { *field = &m->stat.cluster_start; *count = m->stat.cluster_count; }
+        }
+        else if (m->type == 2) {
+            if (kind == POOL_INDEX) { *field = &m->anim.index_start; *count = Mesh_GetIndexTotal(m); }
+            else if (kind == POOL_FRAME) { *field = &m->anim.frame_start; *count = m->anim.frame_count; }
+            else if (kind == POOL_MD2_UV) { *field = &m->anim.uv_start; *count = m->anim.uv_count; }
+            else if (kind == POOL_MD2_VERTEX && m->anim.frame_count > 0) {
+                *field = &g_frame_pool[m->anim.frame_start].vertex_start;
+                *count = (uint32_t)m->anim.frame_count * m->anim.verts_per_frame;
             }
         }
-    }
-
-    /* Trim unused allocation */
-    g_vertex_used = v_start + v_count;
-    g_index_used = i_start + i_count;
 
-    /* Calculate bounds */
-    Vec3 bmin = out_v[0].position, bmax = out_v[0].position;
-    for (uint32_t i = 1; i < v_count; i++) {
-        bmin = Vec3_Min(bmin, out_v[i].position);
-        bmax = Vec3_Max(bmax, out_v[i].position);
+        if (*field && *count > 0 && **field == block) return m;
     }
+    return NULL;
+}
 
-    g_meshes[slot].type = 1;
-    g_meshes[slot].stat.vertex_start = v_start;
-    g_meshes[slot].stat.vertex_count = v_count;
-    g_meshes[slot].stat.index_start = i_start;
-    g_meshes[slot].stat.index_count = i_count;
-    g_meshes[slot].stat.bounds_center = Vec3_Scale(Vec3_Add(bmin, bmax), 0.5f);
-    g_meshes[slot].stat.bounds_radius = Vec3_Length(Vec3_Sub(bmax, g_meshes[slot].stat.bounds_center));
+/* Slides one allocation down into the lowest hole of a pool */
+static int CompactStep(int kind)
+{
+    uint32_t hole, block, count;
+    uint32_t* field;
+    if (!Pool_FirstGap(g_pools[kind], &hole, &block)) return 0;
+
+    MeshSlot_t* m = FindOwner(kind, block, &field, &count);
+    if (!m) return 0;
+
+    switch (kind) {
+    case POOL_VERTEX:
+        memmove(&g_vertex_pool[hole], &g_vertex_pool[block], count * sizeof(Vertex_t));
+        memmove(&g_position_x[hole], &g_position_x[block], count * sizeof(float));
+        memmove(&g_position_y[hole], &g_position_y[block], count * sizeof(float));
+        memmove(&g_position_z[hole], &g_position_z[block], count * sizeof(float));
+        memmove(&g_packed_pool[hole], &g_packed_pool[block], count * sizeof(PackedVertex_t));
+        *field = hole;
+        break;
+    case POOL_INDEX:
+        memmove(&g_index_pool[hole], &g_index_pool[block], count * sizeof(uint16_t));
+        *field = hole;
+        /* The shift need not be whole triangles: recompute */
+        if (m->flags & MESH_FLAG_FACE_PLANES) BuildFacePlanes(m);
+        break;
+    case POOL_FRAME:
+        memmove(&g_frame_pool[hole], &g_frame_pool[block], count * sizeof(MD2FrameDesc_t));
+        *field = hole;
+        break;
+    case POOL_MD2_VERTEX:
+        memmove(&g_md2_vertex_pool[hole], &g_md2_vertex_pool[block], count * sizeof(MD2Vertex_t));
+        /* Every frame of the mesh points into the moved range */
+        for (uint32_t f = 0; f < m->anim.frame_count; f++) {
+            g_frame_pool[m->anim.frame_start + f].vertex_start -= block - hole;
+        }
+        break;
+    case POOL_MD2_UV:
+        memmove(&g_md2_uv_pool[hole], &g_md2_uv_pool[block], count * sizeof(MD2UV_t));
+        *field = hole;
+        break;
+    case POOL_CLUSTER:
+        memmove(&g_cluster_pool[hole], &g_cluster_pool[block], count * sizeof(MeshCluster_t));
+        *field = hole;
+        break;
+    }
 
-    return slot;
+    Pool_Move(g_pools[kind], block, hole, count);
+    return 1;
 }
 
-/* ============================================================
- * Mesh Freeing
- * ============================================================ */
-
-void Mesh_Free(uint32_t id)
+uint32_t Mesh_Compact(uint32_t max_moves)
 {
-    if (id < MAX_MESHES) {
-        g_meshes[id].type = 0;
+    uint32_t moves = 0;
+    for (int kind = 0; kind < POOL_KIND_COUNT && moves < max_moves; kind++) {
+        while (moves < max_moves && CompactStep(kind)) moves++;
     }
+    return moves;
 }
 
 /* ============================================================
  * MD2 Vertex Interpolation
  * ============================================================ */
 
- /* MD2 pre-computed normals table (162 normals) */
-static const float g_md2_normals[162][3] = {
-    {-0.525731f, 0.000000f, 0.850651f}, {-0.442863f, 0.238856f, 0.864188f},
-    {-0.295242f, 0.000000f, 0.955423f}, {-0.309017f, 0.500000f, 0.809017f},
-    {-0.162460f, 0.262866f, 0.951056f}, {0.000000f, 0.000000f, 1.000000f},
-    {0.000000f, 0.850651f, 0.525731f}, {-0.147621f, 0.716567f, 0.681718f},
-    {0.147621f, 0.716567f, 0.681718f}, {0.000000f, 0.525731f, 0.850651f},
-    {0.309017f, 0.500000f, 0.809017f}, {0.525731f, 0.000000f, 0.850651f},
-    {0.295242f, 0.000000f, 0.955423f}, {0.442863f, 0.238856f, 0.864188f},
-    {0.162460f, 0.262866f, 0.951056f}, {-0.681718f, 0.147621f, 0.716567f},
-    {-0.809017f, 0.309017f, 0.500000f}, {-0.587785f, 0.425325f, 0.688191f},
-    {-0.850651f, 0.525731f, 0.000000f}, {-0.864188f, 0.442863f, 0.238856f},
-    {-0.716567f, 0.681718f, 0.147621f}, {-0.688191f, 0.587785f, 0.425325f},
-    {-0.500000f, 0.809017f, 0.309017f}, {-0.238856f, 0.864188f, 0.442863f},
-    {-0.425325f, 0.688191f, 0.587785f}, {-0.716567f, 0.681718f, -0.147621f},
-    {-0.500000f, 0.809017f, -0.309017f}, {-0.525731f, 0.850651f, 0.000000f},
-    {0.000000f, 0.850651f, -0.525731f}, {-0.238856f, 0.864188f, -0.442863f},
-    {0.000000f, 0.955423f, -0.295242f}, {-0.262866f, 0.951056f, -0.162460f},
-    {0.000000f, 1.000000f, 0.000000f}, {0.000000f, 0.955423f, 0.295242f},
-    {-0.262866f, 0.951056f, 0.162460f}, {0.238856f, 0.864188f, 0.442863f},
-    {0.262866f, 0.951056f, 0.162460f}, {0.500000f, 0.809017f, 0.309017f},
-    {0.238856f, 0.864188f, -0.442863f}, {0.262866f, 0.951056f, -0.162460f},
-    {0.500000f, 0.809017f, -0.309017f}, {0.850651f, 0.525731f, 0.000000f},
-    {0.716567f, 0.681718f, 0.147621f}, {0.716567f, 0.681718f, -0.147621f},
-    {0.525731f, 0.850651f, 0.000000f}, {0.425325f, 0.688191f, 0.587785f},
-    {0.864188f, 0.442863f, 0.238856f}, {0.688191f, 0.587785f, 0.425325f},
-    {0.809017f, 0.309017f, 0.500000f}, {0.681718f, 0.147621f, 0.716567f},
-    {0.587785f, 0.425325f, 0.688191f}, {0.955423f, 0.295242f, 0.000000f},
-    {1.000000f, 0.000000f, 0.000000f}, {0.951056f, 0.162460f, 0.262866f},
-    {0.850651f, -0.525731f, 0.000000f}, {0.955423f, -0.295242f, 0.000000f},
-    {0.864188f, -0.442863f, 0.238856f}, {0.951056f, -0.162460f, 0.262866f},
-    {0.809017f, -0.309017f, 0.500000f}, {0.681718f, -0.147621f, 0.716567f},
-    {0.850651f, 0.000000f, 0.525731f}, {0.864188f, 0.442863f, -0.238856f},
-    {0.809017f, 0.309017f, -0.500000f}, {0.951056f, 0.162460f, -0.262866f},
-    {0.525731f, 0.000000f, -0.850651f}, {0.681718f, 0.147621f, -0.716567f},
-    {0.681718f, -0.147621f, -0.716567f}, {0.850651f, 0.000000f, -0.525731f},
-    {0.809017f, -0.309017f, -0.500000f}, {0.864188f, -0.442863f, -0.238856f},
-    {0.951056f, -0.162460f, -0.262866f}, {0.147621f, 0.716567f, -0.681718f},
-    {0.309017f, 0.500000f, -0.809017f}, {0.425325f, 0.688191f, -0.587785f},
-    {0.442863f, 0.238856f, -0.864188f}, {0.587785f, 0.425325f, -0.688191f},
-    {0.688191f, 0.587785f, -0.425325f}, {-0.147621f, 0.716567f, -0.681718f},
-    {-0.309017f, 0.500000f, -0.809017f}, {0.000000f, 0.525731f, -0.850651f},
-    {-0.525731f, 0.000000f, -0.850651f}, {-0.442863f, 0.238856f, -0.864188f},
-    {-0.295242f, 0.000000f, -0.955423f}, {-0.162460f, 0.262866f, -0.951056f},
-    {0.000000f, 0.000000f, -1.000000f}, {0.295242f, 0.000000f, -0.955423f},
-    {0.162460f, 0.262866f, -0.951056f}, {-0.442863f, -0.238856f, -0.864188f},
-    {-0.309017f, -0.500000f, -0.809017f}, {-0.162460f, -0.262866f, -0.951056f},
-    {0.000000f, -0.850651f, -0.525731f}, {-0.147621f, -0.716567f, -0.681718f},
-    {0.147621f, -0.716567f, -0.681718f}, {0.000000f, -0.525731f, -0.850651f},
-    {0.309017f, -0.500000f, -0.809017f}, {0.442863f, -0.238856f, -0.864188f},
-    {0.162460f, -0.262866f, -0.951056f}, {0.238856f, -0.864188f, -0.442863f},
-    {0.500000f, -0.809017f, -0.309017f}, {0.425325f, -0.688191f, -0.587785f},
-    {0.716567f, -0.681718f, -0.147621f}, {0.688191f, -0.587785f, -0.425325f},
-    {0.587785f, -0.425325f, -0.688191f}, {0.000000f, -0.955423f, -0.295242f},
-    {0.000000f, -1.000000f, 0.000000f}, {0.262866f, -0.951056f, -0.162460f},
-    {0.000000f, -0.850651f, 0.525731f}, {0.000000f, -0.955423f, 0.295242f},
-    {0.238856f, -0.864188f, 0.442863f}, {0.262866f, -0.951056f, 0.162460f},
-    {0.500000f, -0.809017f, 0.309017f}, {0.716567f, -0.681718f, 0.147621f},
-    {0.525731f, -0.850651f, 0.000000f}, {-0.238856f, -0.864188f, -0.442863f},
-    {-0.500000f, -0.809017f, -0.309017f}, {-0.262866f, -0.951056f, -0.162460f},
-    {-0.850651f, -0.525731f, 0.000000f}, {-0.716567f, -0.681718f, -0.147621f},
-    {-0.716567f, -0.681718f, 0.147621f}, {-0.525731f, -0.850651f, 0.000000f},
-    {-0.500000f, -0.809017f, 0.309017f}, {-0.238856f, -0.864188f, 0.442863f},
-    {-0.262866f, -0.951056f, 0.162460f}, {-0.864188f, -0.442863f, 0.238856f},
-    {-0.809017f, -0.309017f, 0.500000f}, {-0.688191f, -0.587785f, 0.425325f},
-    {-0.681718f, -0.147621f, 0.716567f}, {-0.442863f, -0.238856f, 0.864188f},
-    {-0.587785f, -0.425325f, 0.688191f}, {-0.309017f, -0.500000f, 0.809017f},
-    {-0.147621f, -0.716567f, 0.681718f}, {-0.425325f, -0.688191f, 0.587785f},
-    {-0.162460f, -0.262866f, 0.951056f}, {0.442863f, -0.238856f, 0.864188f},
-    {0.162460f, -0.262866f, 0.951056f}, {0.309017f, -0.500000f, 0.809017f},
-    {0.147621f, -0.716567f, 0.681718f}, {0.000000f, -0.525731f, 0.850651f},
-    {0.425325f, -0.688191f, 0.587785f}, {0.587785f, -0.425325f, 0.688191f},
-    {0.688191f, -0.587785f, 0.425325f}, {-0.955423f, 0.295242f, 0.000000f},
-    {-0.951056f, 0.162460f, 0.262866f}, {-1.000000f, 0.000000f, 0.000000f},
-    {-0.850651f, 0.000000f, 0.525731f}, {-0.955423f, -0.295242f, 0.000000f},
-    {-0.951056f, -0.162460f, 0.262866f}, {-0.864188f, 0.442863f, -0.238856f},
-    {-0.951056f, 0.162460f, -0.262866f}, {-0.809017f, 0.309017f, -0.500000f},
-    {-0.864188f, -0.442863f, -0.238856f}, {-0.951056f, -0.162460f, -0.262866f},
-    {-0.809017f, -0.309017f, -0.500000f}, {-0.681718f, 0.147621f, -0.716567f},
-    {-0.681718f, -0.147621f, -0.716567f}, {-0.850651f, 0.000000f, -0.525731f},
-    {-0.688191f, 0.587785f, -0.425325f}, {-0.587785f, 0.425325f, -0.688191f},
-    {-0.425325f, 0.688191f, -0.587785f}, {-0.425325f, -0.688191f, -0.587785f},
-    {-0.587785f, -0.425325f, -0.688191f}, {-0.688191f, -0.587785f, -0.425325f}
-};
-
 void Mesh_GetMD2InterpolatedVertex(uint32_t mesh_id, uint32_t vertex_index,
     uint16_t frame_a, uint16_t frame_b, float lerp,
     Vec3* out_position, Vec3* out_normal)
@@ -566,12 +764,12 @@ void Mesh_GetMD2InterpolatedVertex(uint32_t mesh_id, uint32_t vertex_index,
     }
 
     /* Get frame descriptors */
-    MD2FrameDesc_t* fd_a = &g_frame_pool[anim->frame_start + frame_a];
-    MD2FrameDesc_t* fd_b = &g_frame_pool[anim->frame_start + frame_b];
+    const MD2FrameDesc_t* fd_a = &Mesh_GetFrames(&g_meshes[mesh_id])[frame_a];
+    const MD2FrameDesc_t* fd_b = &Mesh_GetFrames(&g_meshes[mesh_id])[frame_b];
 
     /* Get compressed vertices */
-    MD2Vertex_t* v_a = &g_md2_vertex_pool[fd_a->vertex_start + vertex_index];
-    MD2Vertex_t* v_b = &g_md2_vertex_pool[fd_b->vertex_start + vertex_index];
+    const MD2Vertex_t* v_a = &Mesh_GetFrameVertices(&g_meshes[mesh_id], frame_a)[vertex_index];
+    const MD2Vertex_t* v_b = &Mesh_GetFrameVertices(&g_meshes[mesh_id], frame_b)[vertex_index];
 
     /* Decompress positions */
     Vec3 pos_a = MakeVec3(
@@ -586,8 +784,8 @@ void Mesh_GetMD2InterpolatedVertex(uint32_t mesh_id, uint32_t vertex_index,
     );
 
     /* Get normals from lookup table */
-    int ni_a = v_a->normal_index % 162;
-    int ni_b = v_b->normal_index % 162;
+    int ni_a = v_a->normal_index % MD2_NUM_NORMALS;
+    int ni_b = v_b->normal_index % MD2_NUM_NORMALS;
     Vec3 norm_a = MakeVec3(g_md2_normals[ni_a][0], g_md2_normals[ni_a][1], g_md2_normals[ni_a][2]);
     Vec3 norm_b = MakeVec3(g_md2_normals[ni_b][0], g_md2_normals[ni_b][1], g_md2_normals[ni_b][2]);
 
@@ -8,16 +8,14 @@
 #include <stdint.h>
 #include "math3d.h"
 #include "engine_config.h"
+#include "memmap.h"
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
-    /* Pool sizes - adjust based on your SRAM budget */
-#define MAX_TOTAL_VERTICES      40960
-#define MAX_TOTAL_INDICES       81920
-#define MAX_MD2_FRAMES          200
-#define MAX_MD2_VERTICES        204800
+    /* Pool sizes are in engine_config.h */
+#define MAX_MD2_FRAME_VERTICES  2048    /* MD2 format limit per frame */
 
 /* Vertex formats */
     typedef struct {
@@ -31,65 +29,136 @@ extern "C" {
         uint8_t normal_index;
     } MD2Vertex_t;
 
+    /* The fixed MD2 normal table that normal_index refers to */
+#define MD2_NUM_NORMALS         162
+    extern const float g_md2_normals[MD2_NUM_NORMALS][3];
+
+    /* Packed static vertex (12 bytes, opt-in via Mesh_PackStatic).
+     * Positions are snorm16 relative to the mesh bounding sphere, the
+     * normal is octahedral with 8 bits per axis, UVs are fixed point. */
+#define PACKED_POS_ONE          32767
+#define PACKED_UV_ONE           2048    /* UVs in [-16, 16) */
+    typedef struct {
+        int16_t x, y, z;
+        uint16_t normal;
+        int16_t u, v;
+    } PackedVertex_t;
+
     /* Static mesh descriptor */
     typedef struct {
-        uint16_t vertex_start;
+        uint32_t vertex_start;
         uint16_t vertex_count;
-        uint16_t index_start;
+        uint32_t index_start;
         uint16_t index_count;
         Vec3 bounds_center;
         float bounds_radius;
+        uint32_t cluster_start;     /* Level 0 clusters in g_cluster_pool, see meshcluster.h */
+        uint16_t cluster_count;
     } StaticMeshDesc_t;
 
     /* MD2 frame descriptor */
     typedef struct {
         Vec3 scale;
         Vec3 translate;
-        uint16_t vertex_start;
+        uint32_t vertex_start;
         uint16_t vertex_count;
     } MD2FrameDesc_t;
 
 
+    /* Unique (vertex, texcoord) pair; MD2 indices address these */
     typedef struct {
         float u, v;
+        uint16_t vertex;        /* Frame vertex the pair takes its position from */
     } MD2UV_t;
-   
-	// Add to global pools (near the other pools)
-#ifdef SDL_PC
-	extern MD2UV_t g_md2_uv_pool[MAX_MD2_VERTICES];
-#else
-	extern MD2UV_t g_md2_uv_pool[MAX_MD2_VERTICES] SECTION_SDRAM;
-#endif
 
-	extern uint32_t g_md2_uv_used;
+    /* Decoded, interpolated MD2 pose in object space. Normals stay as
+     * the two keyframes' table indices, blended by lerp_step: shading
+     * looks them up in a per-draw light table (Lighting_ShadeIndexed). */
+#define MD2_POSE_CACHE_SIZE     8
+#define MD2_POSE_LERP_STEPS     32      /* Lerp quantization for pose sharing */
+    typedef struct {
+        float x[MAX_MD2_FRAME_VERTICES];
+        float y[MAX_MD2_FRAME_VERTICES];
+        float z[MAX_MD2_FRAME_VERTICES];
+        uint8_t normal_a[MAX_MD2_FRAME_VERTICES];
+        uint8_t normal_b[MAX_MD2_FRAME_VERTICES];
+        uint32_t lerp_step;             /* Weight of normal_b, of MD2_POSE_LERP_STEPS */
+        uint32_t count;
+    } MD2Pose_t;
+   
+    extern MD2UV_t g_md2_uv_pool[];
 
-    // Add allocator function
-    uint32_t AllocMD2UVs(uint32_t count);
     typedef struct {
-        uint16_t frame_start;
+        uint32_t frame_start;
         uint16_t frame_count;
-        uint16_t index_start;
+        uint32_t index_start;
         uint16_t index_count;
         uint16_t verts_per_frame;
-        uint16_t uv_start;     
-        uint16_t uv_count;   
+        uint32_t uv_start;      /* Unique (vertex, uv) pairs in g_md2_uv_pool */
+        uint16_t uv_count;
+        Vec3 bounds_center;     /* Encloses every frame */
+        float bounds_radius;
     } AnimatedMeshDesc_t;
 
+    /* Detail level: an index list over the mesh's vertices (static) or
+     * UV pairs (MD2), stored after level 0 in its index allocation. See
+     * meshlod.h. */
+#define MESH_MAX_LODS           4
+    typedef struct {
+        uint32_t index_offset;  /* From the descriptor's index_start */
+        uint32_t index_count;
+        uint32_t vertex_count;  /* Static: leading vertices the level reads */
+        float max_radius;       /* Drawn while the bounds project below this, pixels */
+    } MeshLod_t;
+
+    /* Run of level 0 triangles culled as a whole: a bounding sphere and
+     * a cone holding every face normal, all in object space */
+    typedef struct {
+        Vec3 center;
+        float radius;
+        Vec3 cone_apex;         /* Behind every triangle's plane */
+        Vec3 cone_axis;         /* Unit, mean facing */
+        float cone_cutoff;      /* Sine of the normals' spread about the axis; >= 1 no cone */
+        uint32_t first;         /* First triangle, in level 0's index order */
+        uint32_t count;         /* Triangles */
+    } MeshCluster_t;
+
+    /* Mesh slot flags */
+#define MESH_FLAG_PACKED        0x01    /* Static mesh renders from g_packed_pool */
+#define MESH_FLAG_BAKED         0x02    /* Arrays live in a baked image, not the pools */
+#define MESH_FLAG_FACE_PLANES   0x04    /* Static mesh has planes in g_face_pool */
+
     /* Mesh slot */
     typedef struct {
         uint8_t type;           /* 0=free, 1=static, 2=animated */
         uint8_t flags;
+        const void* image;      /* MESH_FLAG_BAKED: MeshBakedHeader_t, see meshbake.h */
         union {
             StaticMeshDesc_t stat;
             AnimatedMeshDesc_t anim;
         };
+        uint8_t lod_count;      /* Levels in lods[]; 0 = level 0 only, as described above */
+        MeshLod_t lods[MESH_MAX_LODS];
     } MeshSlot_t;
 
     /* ============================================================
      * Pool Globals (defined in mesh.cpp)
      * ============================================================ */
     extern Vertex_t g_vertex_pool[];
+    /* Structure-of-arrays copy of g_vertex_pool positions for batch transforms */
+    extern float g_position_x[];
+    extern float g_position_y[];
+    extern float g_position_z[];
+    /* Packed copy of g_vertex_pool, same indices; valid for MESH_FLAG_PACKED meshes */
+    extern PackedVertex_t g_packed_pool[];
     extern uint16_t g_index_pool[];
+    /* Object-space plane per static triangle: xyz the face normal (not
+     * unit length), w = -dot(normal, first vertex), signed so that
+     * dot(plane, eye) > 0 when the triangle faces a homogeneous eye
+     * (Mat4_ProjectionEye). The triangle at g_index_pool[i] owns plane
+     * i / 3; triangles never share index slots, so neither planes. */
+    extern Vec4 g_face_pool[];
+    extern MeshCluster_t g_cluster_pool[];
     extern MD2FrameDesc_t g_frame_pool[];
     extern MD2Vertex_t g_md2_vertex_pool[];
     extern MeshSlot_t g_meshes[];
@@ -98,10 +167,29 @@ extern "C" {
      * Pool Allocators (defined in mesh.cpp)
      * ============================================================ */
     uint32_t AllocMeshSlot(void);
+    /* Source files of loaded meshes, by Name_HashData() and size: the
+     * slot already holding one, with one more holder, else 0xFFFFFFFF;
+     * and the record a loader leaves on the slot it filled */
+    uint32_t FindMeshSource(uint64_t hash, uint32_t size);
+    void SetMeshSource(uint32_t slot, uint64_t hash, uint32_t size);
     uint32_t AllocVertices(uint32_t count);
     uint32_t AllocIndices(uint32_t count);
     uint32_t AllocFrames(uint32_t count);
     uint32_t AllocMD2Vertices(uint32_t count);
+    uint32_t AllocMD2UVs(uint32_t count);
+    uint32_t AllocClusters(uint32_t count);
+
+    /* Largest single free range, for loaders that reserve it and trim */
+    uint32_t GetLargestFreeVertices(void);
+    uint32_t GetLargestFreeIndices(void);
+
+    /* Return a range to its pool's free list */
+    void FreeVertices(uint32_t start, uint32_t count);
+    void FreeIndices(uint32_t start, uint32_t count);
+    void FreeFrames(uint32_t start, uint32_t count);
+    void FreeMD2Vertices(uint32_t start, uint32_t count);
+    void FreeMD2UVs(uint32_t start, uint32_t count);
+    void FreeClusters(uint32_t start, uint32_t count);
 
     /* ============================================================
      * Public API
@@ -109,18 +197,107 @@ extern "C" {
     void Mesh_Init(void);
     uint32_t Mesh_LoadOBJ(const void* data, uint32_t size);
     uint32_t Mesh_LoadMD2(const void* data, uint32_t size);
+
+    /* A mesh decoded away from the pools, on any thread, for loaders
+     * that decode several files at once (Stream_DecodeQueued). Call a
+     * decoder with the arrays NULL for the counts to allocate (upper
+     * bounds for OBJ), then with arrays of those counts: it writes the
+     * mesh and sets the counts used. Mesh_CommitStaged() copies it into
+     * the pools on their thread, the only step that touches them. */
+    typedef struct {
+        uint8_t type;               /* 1 static, 2 animated */
+        Vertex_t* vertices;         /* Static */
+        uint16_t* indices;
+        MD2FrameDesc_t* frames;     /* Animated; vertex_start counts from md2_vertices */
+        MD2Vertex_t* md2_vertices;
+        MD2UV_t* uvs;
+        uint32_t vertex_count;
+        uint32_t index_count;
+        uint32_t frame_count;
+        uint32_t md2_vertex_count;
+        uint32_t uv_count;
+        Vec3 bounds_center;
+        float bounds_radius;
+        uint64_t source_hash;       /* Of the file, set by the decoders; source_size 0 = none */
+        uint32_t source_size;
+    } MeshStaging_t;
+
+    /* 0 if the file is invalid or does not fit the given arrays */
+    int Mesh_DecodeOBJ(const void* data, uint32_t size, MeshStaging_t* out);
+    int Mesh_DecodeMD2(const void* data, uint32_t size, MeshStaging_t* out);
+    /* New mesh id, 0xFFFFFFFF if the pools are full */
+    uint32_t Mesh_CommitStaged(const MeshStaging_t* staged);
     uint32_t Mesh_CreateCube(float size);
     uint32_t Mesh_CreatePlane(float w, float h);
 
     MeshSlot_t* Mesh_Get(uint32_t id);
+
+    /* Arrays of a mesh wherever they live, pool or baked image; use these
+     * rather than indexing the pools with the descriptor offsets */
+    const Vertex_t* Mesh_GetVertices(const MeshSlot_t* m);
+    const uint16_t* Mesh_GetIndices(const MeshSlot_t* m);
+    /* Indices in the mesh's allocation, every detail level included */
+    uint32_t Mesh_GetIndexTotal(const MeshSlot_t* m);
+    /* SoA positions; NULL for all three if the mesh has none */
+    void Mesh_GetPositions(const MeshSlot_t* m, const float** x, const float** y, const float** z);
+    const PackedVertex_t* Mesh_GetPackedVertices(const MeshSlot_t* m);
+    const MD2FrameDesc_t* Mesh_GetFrames(const MeshSlot_t* m);
+    const MD2Vertex_t* Mesh_GetFrameVertices(const MeshSlot_t* m, uint32_t frame);
+    const MD2UV_t* Mesh_GetUVPairs(const MeshSlot_t* m);
+    /* Level 0 clusters of a static mesh; NULL and 0 without */
+    const MeshCluster_t* Mesh_GetClusters(const MeshSlot_t* m, uint32_t* count);
     Vertex_t* Mesh_GetVertexPtr(uint32_t start);
+    /* Refresh the SoA positions after writing g_vertex_pool[start..start+count) */
+    void Mesh_UpdatePositions(uint32_t start, uint32_t count);
     uint16_t* Mesh_GetIndexPtr(uint32_t start);
+
+    /* Computes the face planes of every level of a static pool mesh and
+     * sets MESH_FLAG_FACE_PLANES. Mesh loaders, Mesh_AddLod() and
+     * Mesh_Compact() keep them current; call again after editing the
+     * positions. Returns 0 for MD2 and baked meshes, which have none. */
+    int Mesh_BuildFacePlanes(uint32_t mesh_id);
+    /* Planes of a level's triangles in index order, NULL without */
+    const Vec4* Mesh_GetLodFacePlanes(const MeshSlot_t* m, uint32_t lod);
+
+    /* Encode a static mesh into g_packed_pool and set MESH_FLAG_PACKED.
+     * Returns 0 (mesh left unpacked) if its UVs exceed the fixed-point range. */
+    int Mesh_PackStatic(uint32_t mesh_id);
+    /* Object-space position = m * (x, y, z, 1) for a packed vertex */
+    void Mesh_GetPackedDequant(const StaticMeshDesc_t* desc, Mat4* m);
+
+    static inline Vec3 Mesh_DecodeNormal(uint16_t n)
+    {
+        float x = (float)(n & 0xFF) * (2.0f / 255.0f) - 1.0f;
+        float y = (float)(n >> 8) * (2.0f / 255.0f) - 1.0f;
+        float z = 1.0f - fabsf(x) - fabsf(y);
+        if (z < 0.0f) {
+            float fx = (1.0f - fabsf(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+            float fy = (1.0f - fabsf(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+            x = fx; y = fy;
+        }
+        return Vec3_Normalize(Vec3_Create(x, y, z));
+    }
     MD2FrameDesc_t* Mesh_GetFramePtr(uint32_t start);
     MD2Vertex_t* Mesh_GetMD2VertexPtr(uint32_t start);
 
+    /* Holders: a load, commit or create is the first. Loading or
+     * committing a file already in a slot (same content hash and size)
+     * returns that slot with one more holder instead of a second copy,
+     * so edits to a loaded mesh (LODs, packing, atlas UVs) are shared.
+     * Mesh_Free() drops one and releases the pools with the last; a
+     * count that reaches MESH_MAX_REFS saturates and the mesh stays. */
+#define MESH_MAX_REFS           0x10000
+    void Mesh_Retain(uint32_t id);
+    uint32_t Mesh_GetRefs(uint32_t id);
     void Mesh_Free(uint32_t id);
+    /* Slide up to max_moves allocations down into free holes, fixing the
+     * mesh offsets. Call between frames (nothing may hold pool pointers);
+     * returns the number of ranges moved, 0 once every pool is compact. */
+    uint32_t Mesh_Compact(uint32_t max_moves);
     uint32_t Mesh_GetFreeVertexCount(void);
     uint32_t Mesh_GetFreeIndexCount(void);
+    /* Mesh pools for MemMap_Print(); returns the entries written */
+    uint32_t Mesh_GetMemPools(MemPool_t* out, uint32_t max);
 
     /* MD2 Animation */
     void Mesh_GetMD2InterpolatedVertex(uint32_t mesh_id, uint32_t vertex_index,
@@ -131,7 +308,25 @@ extern "C" {
         uint32_t frame_a, uint32_t frame_b, float t,
         Vec3* pos, Vec3* norm, Vec2* uv);
 
+    /* Decodes a whole interpolated pose in one pass: positions as SoA
+     * (ready for Clip_TransformPositions) plus normalized normals, which
+     * may be NULL. Each array holds verts_per_frame entries; returns that
+     * count, 0 on error. */
+    uint32_t Mesh_DecodeMD2Pose(uint32_t mesh_id, uint32_t frame_a, uint32_t frame_b, float t,
+        float* x, float* y, float* z, Vec3* normals);
+
+    /* Cached pose for (mesh, frame_a, frame_b, lerp quantized to
+     * MD2_POSE_LERP_STEPS). Instances on the same pose share one decode;
+     * the pointer stays valid until MD2_POSE_CACHE_SIZE other poses have
+     * been requested. NULL on error. */
+    const MD2Pose_t* Mesh_GetMD2Pose(uint32_t mesh_id, uint32_t frame_a, uint32_t frame_b, float t);
+    void Mesh_InvalidateMD2Poses(uint32_t mesh_id);
+
     int MD2_GetAnimRange(const char* name, int* start, int* end);
+    /* Keyframes per second of a named animation, 0 if unknown */
+    float MD2_GetAnimFrameRate(const char* name);
+    /* MD2 pose cache and loader scratch for MemMap_Print() */
+    uint32_t MD2_GetMemPools(MemPool_t* out, uint32_t max);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,212 @@
+/**
+ * @file meshbake.cpp
+ * @brief Baked Binary Mesh Images Implementation
+ */
+
+#include "meshbake.h"
+#include <string.h>
+
+static inline uint32_t AlignUp(uint32_t n)
+{
+    return (n + MESH_BAKED_ALIGN - 1) & ~(uint32_t)(MESH_BAKED_ALIGN - 1);
+}
+
+/* ============================================================
+ * Cooking
+ * ============================================================ */
+
+uint32_t Mesh_Bake(uint32_t mesh_id, void* out, uint32_t max)
+{
+    const MeshSlot_t* m = Mesh_Get(mesh_id);
+    if (!m) return 0;
+
+    MeshBakedHeader_t h;
+    memset(&h, 0, sizeof(h));
+    h.magic = MESH_BAKED_MAGIC;
+    h.version = MESH_BAKED_VERSION;
+    h.type = m->type;
+    h.layout = MESH_BAKED_LAYOUT;
+
+    const void* src[MESH_BAKED_SECTION_COUNT];
+    memset(src, 0, sizeof(src));
+
+    if (m->type == 1) {
+        const float *x, *y, *z;
+        Mesh_GetPositions(m, &x, &y, &z);
+        uint32_t vc = m->stat.vertex_count;
+
+        h.flags = m->flags & MESH_FLAG_PACKED;
+        h.vertex_count = m->stat.vertex_count;
+        h.index_count = m->stat.index_count;
+        h.bounds_center = m->stat.bounds_center;
+        h.bounds_radius = m->stat.bounds_radius;
+
+        src[MESH_BAKED_VERTICES] = Mesh_GetVertices(m);
+        src[MESH_BAKED_POSITION_X] = x;
+        src[MESH_BAKED_POSITION_Y] = y;
+        src[MESH_BAKED_POSITION_Z] = z;
+        src[MESH_BAKED_PACKED] = Mesh_GetPackedVertices(m);
+        h.sections[MESH_BAKED_VERTICES].size = vc * sizeof(Vertex_t);
+        h.sections[MESH_BAKED_POSITION_X].size = x ? vc * sizeof(float) : 0;
+        h.sections[MESH_BAKED_POSITION_Y].size = y ? vc * sizeof(float) : 0;
+        h.sections[MESH_BAKED_POSITION_Z].size = z ? vc * sizeof(float) : 0;
+        h.sections[MESH_BAKED_PACKED].size = src[MESH_BAKED_PACKED] ? vc * sizeof(PackedVertex_t) : 0;
+
+        uint32_t cluster_count;
+        src[MESH_BAKED_CLUSTERS] = Mesh_GetClusters(m, &cluster_count);
+        h.cluster_count = (uint16_t)cluster_count;
+        h.sections[MESH_BAKED_CLUSTERS].size = cluster_count * sizeof(MeshCluster_t);
+    }
+    else if (m->type == 2) {
+        h.index_count = m->anim.index_count;
+        h.frame_count = m->anim.frame_count;
+        h.verts_per_frame = m->anim.verts_per_frame;
+        h.uv_count = m->anim.uv_count;
+        h.bounds_center = m->anim.bounds_center;
+        h.bounds_radius = m->anim.bounds_radius;
+
+        /* A mesh's frames share one contiguous vertex block */
+        src[MESH_BAKED_FRAMES] = Mesh_GetFrames(m);
+        src[MESH_BAKED_MD2_VERTICES] = Mesh_GetFrameVertices(m, 0);
+        src[MESH_BAKED_UV_PAIRS] = Mesh_GetUVPairs(m);
+        h.sections[MESH_BAKED_FRAMES].size = h.frame_count * sizeof(MD2FrameDesc_t);
+        h.sections[MESH_BAKED_MD2_VERTICES].size = (uint32_t)h.frame_count * h.verts_per_frame * sizeof(MD2Vertex_t);
+        h.sections[MESH_BAKED_UV_PAIRS].size = h.uv_count * sizeof(MD2UV_t);
+    }
+    else {
+        return 0;
+    }
+    src[MESH_BAKED_INDICES] = Mesh_GetIndices(m);
+    h.sections[MESH_BAKED_INDICES].size = Mesh_GetIndexTotal(m) * sizeof(uint16_t);
+    h.lod_count = m->lod_count;
+    memcpy(h.lods, m->lods, sizeof(h.lods));
+
+    uint32_t offset = AlignUp(sizeof(h));
+    for (uint32_t s = 0; s < MESH_BAKED_SECTION_COUNT; s++) {
+        if (!src[s]) h.sections[s].size = 0;
+        if (h.sections[s].size == 0) continue;
+        h.sections[s].offset = offset;
+        offset = AlignUp(offset + h.sections[s].size);
+    }
+    h.image_size = offset;
+
+    if (!out) return h.image_size;
+    if (h.image_size > max) return 0;
+
+    uint8_t* dst = (uint8_t*)out;
+    memset(dst, 0, h.image_size);
+    memcpy(dst, &h, sizeof(h));
+    for (uint32_t s = 0; s < MESH_BAKED_SECTION_COUNT; s++) {
+        if (h.sections[s].size) memcpy(dst + h.sections[s].offset, src[s], h.sections[s].size);
+    }
+
+    /* Frame vertex offsets become relative to the image's vertex section */
+    if (h.sections[MESH_BAKED_FRAMES].size) {
+        MD2FrameDesc_t* frames = (MD2FrameDesc_t*)(dst + h.sections[MESH_BAKED_FRAMES].offset);
+        for (uint32_t f = 0; f < h.frame_count; f++) frames[f].vertex_start = f * h.verts_per_frame;
+    }
+    return h.image_size;
+}
+
+/* ============================================================
+ * Loading In Place
+ * ============================================================ */
+
+/* Section present with exactly `bytes`, or absent when bytes is 0 */
+static int CheckSection(const MeshBakedHeader_t* h, uint32_t s, uint32_t bytes)
+{
+    const MeshBakedSection_t* sec = &h->sections[s];
+    if (sec->size != bytes) return 0;
+    if (bytes == 0) return 1;
+    return (sec->offset & 3) == 0 && sec->offset >= sizeof(*h) &&
+        sec->offset <= h->image_size && sec->size <= h->image_size - sec->offset;
+}
+
+/* Structure only: counts, sizes and bounds of every section. The
+ * contents (index ranges and so on) are trusted, as checking them would
+ * touch the whole image at boot. */
+static int Validate(const MeshBakedHeader_t* h, uint32_t size)
+{
+    if (h->magic != MESH_BAKED_MAGIC || h->version != MESH_BAKED_VERSION) return 0;
+    if (h->layout != MESH_BAKED_LAYOUT || h->image_size > size) return 0;
+    if (h->index_count == 0 || h->index_count % 3 || h->lod_count > MESH_MAX_LODS) return 0;
+
+    /* Levels pack the index section in order after level 0 */
+    uint32_t index_total = h->index_count;
+    if (h->lod_count && (h->lods[0].index_offset != 0 || h->lods[0].index_count != h->index_count)) return 0;
+    for (uint32_t l = 1; l < h->lod_count; l++) {
+        const MeshLod_t* lod = &h->lods[l];
+        if (lod->index_offset != index_total || lod->index_count == 0 || lod->index_count % 3) return 0;
+        if (h->type == 1 && lod->vertex_count > h->vertex_count) return 0;
+        index_total += lod->index_count;
+    }
+    if (!CheckSection(h, MESH_BAKED_INDICES, index_total * sizeof(uint16_t))) return 0;
+
+    if (h->type == 1) {
+        uint32_t vc = h->vertex_count;
+        uint32_t packed = (h->flags & MESH_FLAG_PACKED) ? vc * sizeof(PackedVertex_t) : 0;
+        return vc > 0 &&
+            CheckSection(h, MESH_BAKED_VERTICES, vc * sizeof(Vertex_t)) &&
+            CheckSection(h, MESH_BAKED_POSITION_X, vc * sizeof(float)) &&
+            CheckSection(h, MESH_BAKED_POSITION_Y, vc * sizeof(float)) &&
+            CheckSection(h, MESH_BAKED_POSITION_Z, vc * sizeof(float)) &&
+            CheckSection(h, MESH_BAKED_PACKED, packed) &&
+            CheckSection(h, MESH_BAKED_CLUSTERS, h->cluster_count * sizeof(MeshCluster_t)) &&
+            CheckSection(h, MESH_BAKED_FRAMES, 0) &&
+            CheckSection(h, MESH_BAKED_MD2_VERTICES, 0) &&
+            CheckSection(h, MESH_BAKED_UV_PAIRS, 0);
+    }
+    if (h->type == 2) {
+        return h->frame_count > 0 && h->verts_per_frame > 0 &&
+            h->verts_per_frame <= MAX_MD2_FRAME_VERTICES &&
+            CheckSection(h, MESH_BAKED_FRAMES, h->frame_count * sizeof(MD2FrameDesc_t)) &&
+            CheckSection(h, MESH_BAKED_MD2_VERTICES, (uint32_t)h->frame_count * h->verts_per_frame * sizeof(MD2Vertex_t)) &&
+            CheckSection(h, MESH_BAKED_UV_PAIRS, h->uv_count * sizeof(MD2UV_t)) &&
+            CheckSection(h, MESH_BAKED_VERTICES, 0) &&
+            CheckSection(h, MESH_BAKED_PACKED, 0) &&
+            CheckSection(h, MESH_BAKED_CLUSTERS, 0);
+    }
+    return 0;
+}
+
+uint32_t Mesh_LoadBaked(const void* image, uint32_t size)
+{
+    if (!image || size < sizeof(MeshBakedHeader_t) || ((uintptr_t)image & 3)) return 0xFFFFFFFF;
+
+    const MeshBakedHeader_t* h = (const MeshBakedHeader_t*)image;
+    if (!Validate(h, size)) return 0xFFFFFFFF;
+
+    uint32_t slot = AllocMeshSlot();
+    if (slot == 0xFFFFFFFF) return 0xFFFFFFFF;
+
+    MeshSlot_t* m = &g_meshes[slot];
+    m->flags = (uint8_t)(MESH_FLAG_BAKED | (h->flags & MESH_FLAG_PACKED));
+    m->image = image;
+
+    /* Offsets into the image sections, which the accessors resolve */
+    if (h->type == 1) {
+        m->stat.vertex_start = 0;
+        m->stat.vertex_count = h->vertex_count;
+        m->stat.index_start = 0;
+        m->stat.index_count = h->index_count;
+        m->stat.bounds_center = h->bounds_center;
+        m->stat.bounds_radius = h->bounds_radius;
+        m->stat.cluster_start = 0;
+        m->stat.cluster_count = h->cluster_count;
+    }
+    else {
+        m->anim.frame_start = 0;
+        m->anim.frame_count = h->frame_count;
+        m->anim.index_start = 0;
+        m->anim.index_count = h->index_count;
+        m->anim.verts_per_frame = h->verts_per_frame;
+        m->anim.uv_start = 0;
+        m->anim.uv_count = h->uv_count;
+        m->anim.bounds_center = h->bounds_center;
+        m->anim.bounds_radius = h->bounds_radius;
+    }
+    m->lod_count = (uint8_t)h->lod_count;
+    memcpy(m->lods, h->lods, sizeof(m->lods));
+    m->type = (uint8_t)h->type;
+    return slot;
+}
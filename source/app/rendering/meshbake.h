@@ -0,0 +1,97 @@
+/**
+ * @file meshbake.h
+ * @brief Baked Binary Mesh Images, Referenced In Place - NO MALLOC
+ *
+ * A baked image holds one static or animated mesh exactly as the pools
+ * would: Vertex_t, the SoA positions, PackedVertex_t, 16-bit indices,
+ * MD2FrameDesc_t, MD2Vertex_t, MD2UV_t and MeshCluster_t arrays, each section starting
+ * on a MESH_BAKED_ALIGN boundary. Mesh_LoadBaked() only validates the
+ * header and points a mesh slot at it, so nothing is parsed or copied
+ * at boot: the image stays where it is, memory-mapped on SDL_PC, in
+ * memory-mapped QSPI/OSPI flash (execute-in-place) on the STM32.
+ *
+ * Images come from Mesh_Bake(), run offline on a mesh loaded the usual
+ * way (the PC build's --cook mode). They are native little-endian and
+ * tied to the struct layouts of the engine that cooked them; the
+ * version and layout fields reject anything else.
+ */
+
+#ifndef MESHBAKE_H
+#define MESHBAKE_H
+
+#include <stdint.h>
+#include "mesh.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MESH_BAKED_MAGIC        0x48534D42u     /* "BMSH" */
+#define MESH_BAKED_VERSION      3
+#define MESH_BAKED_ALIGN        32              /* Section alignment, from the image base */
+
+/* Struct sizes the image was cooked against */
+#define MESH_BAKED_LAYOUT       (((uint32_t)sizeof(Vertex_t) << 24) | ((uint32_t)sizeof(PackedVertex_t) << 16) | \
+                                 ((uint32_t)sizeof(MD2FrameDesc_t) << 8) | (uint32_t)sizeof(MD2UV_t))
+
+/* Sections; absent ones have size 0 */
+#define MESH_BAKED_VERTICES     0   /* Vertex_t[vertex_count] */
+#define MESH_BAKED_POSITION_X   1   /* float[vertex_count] */
+#define MESH_BAKED_POSITION_Y   2
+#define MESH_BAKED_POSITION_Z   3
+#define MESH_BAKED_PACKED       4   /* PackedVertex_t[vertex_count], MESH_FLAG_PACKED */
+#define MESH_BAKED_INDICES      5   /* uint16_t, level 0's index_count then coarser levels */
+#define MESH_BAKED_FRAMES       6   /* MD2FrameDesc_t[frame_count], vertex_start into MD2_VERTICES */
+#define MESH_BAKED_MD2_VERTICES 7   /* MD2Vertex_t[frame_count * verts_per_frame] */
+#define MESH_BAKED_UV_PAIRS     8   /* MD2UV_t[uv_count] */
+#define MESH_BAKED_CLUSTERS     9   /* MeshCluster_t[cluster_count] */
+#define MESH_BAKED_SECTION_COUNT 10
+
+typedef struct {
+    uint32_t offset;            /* From the start of the image */
+    uint32_t size;              /* Bytes */
+} MeshBakedSection_t;
+
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t type;              /* MeshSlot_t type: 1 static, 2 animated */
+    uint32_t layout;            /* MESH_BAKED_LAYOUT */
+    uint32_t image_size;
+    uint16_t flags;             /* MESH_FLAG_PACKED */
+    uint16_t vertex_count;
+    uint16_t index_count;
+    uint16_t frame_count;
+    uint16_t verts_per_frame;
+    uint16_t uv_count;
+    uint16_t cluster_count;
+    uint16_t reserved;
+    Vec3 bounds_center;
+    float bounds_radius;
+    uint32_t lod_count;         /* MeshSlot_t lod_count; offsets into the index section */
+    MeshLod_t lods[MESH_MAX_LODS];
+    MeshBakedSection_t sections[MESH_BAKED_SECTION_COUNT];
+} MeshBakedHeader_t;
+
+/* Serialize a loaded mesh. With out == NULL returns the image size;
+ * otherwise the bytes written, 0 if the mesh is invalid or max is too
+ * small. out should be MESH_BAKED_ALIGN aligned. */
+uint32_t Mesh_Bake(uint32_t mesh_id, void* out, uint32_t max);
+
+/* Mesh slot referencing the image in place; it must stay mapped until
+ * Mesh_Free(). The base must be 4-byte aligned; MESH_BAKED_ALIGN keeps
+ * the sections on cache lines. 0xFFFFFFFF if the image is malformed,
+ * misaligned or cooked for another version or layout. */
+uint32_t Mesh_LoadBaked(const void* image, uint32_t size);
+
+/* Section `section` of a validated image */
+static inline const void* MeshBaked_Section(const MeshBakedHeader_t* h, uint32_t section)
+{
+    return h->sections[section].size ? (const uint8_t*)h + h->sections[section].offset : NULL;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MESHBAKE_H */
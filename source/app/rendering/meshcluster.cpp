@@ -0,0 +1,261 @@
+/**
+ * @file meshcluster.cpp
+ * @brief Mesh Clusters Implementation
+ */
+
+#include "meshcluster.h"
+#include <string.h>
+
+#define CLUSTER_MORTON_BITS 9               /* Per axis, under 3 bits of facing */
+
+/* Load-time scratch: per level 0 triangle its Morton key and the sort
+ * order, then the index list rewritten in that order */
+SDRAM_DATA static uint32_t g_cluster_keys[MESH_CLUSTER_MAX_TRIANGLES];
+SDRAM_DATA static uint16_t g_cluster_order[2][MESH_CLUSTER_MAX_TRIANGLES];
+SDRAM_DATA static uint16_t g_cluster_indices[MESH_CLUSTER_MAX_TRIANGLES * 3];
+
+static inline Vec3 Position(const float* x, const float* y, const float* z, uint16_t i)
+{
+    return Vec3_Create(x[i], y[i], z[i]);
+}
+
+/* ============================================================
+ * Partitioning
+ * ============================================================ */
+
+/* The low bits of v moved to every third bit */
+static uint32_t Spread3(uint32_t v)
+{
+    v &= 0x3FF;
+    v = (v | (v << 16)) & 0x030000FF;
+    v = (v | (v << 8)) & 0x0300F00F;
+    v = (v | (v << 4)) & 0x030C30C3;
+    v = (v | (v << 2)) & 0x09249249;
+    return v;
+}
+
+static uint32_t Quantize(float f, float lo, float scale)
+{
+    float q = (f - lo) * scale;
+    if (q < 0.0f) return 0;
+    if (q > (float)((1 << CLUSTER_MORTON_BITS) - 1)) return (1 << CLUSTER_MORTON_BITS) - 1;
+    return (uint32_t)q;
+}
+
+/* Dominant axis and sign of a face normal: triangles sharing it are
+ * within 55 degrees of that axis, so a run of them gets a cone */
+static uint32_t Facing(Vec3 n)
+{
+    float ax = fabsf(n.x), ay = fabsf(n.y), az = fabsf(n.z);
+    if (ax >= ay && ax >= az) return (n.x < 0.0f) ? 1 : 0;
+    if (ay >= az) return (n.y < 0.0f) ? 3 : 2;
+    return (n.z < 0.0f) ? 5 : 4;
+}
+
+/* Triangle order by facing, then along the Morton curve through the
+ * centroids; by byte passes as RenderQueue_Sort() */
+static const uint16_t* SortTriangles(const float* x, const float* y, const float* z, const uint16_t* indices,
+    uint32_t tri_count, Vec3 lo, Vec3 hi)
+{
+    float extent = MAX(hi.x - lo.x, MAX(hi.y - lo.y, hi.z - lo.z));
+    float scale = (extent > 0.0f) ? (float)(1 << CLUSTER_MORTON_BITS) / extent : 0.0f;
+    uint16_t* src = g_cluster_order[0];
+    uint16_t* dst = g_cluster_order[1];
+    for (uint32_t t = 0; t < tri_count; t++) {
+        const uint16_t* tri = &indices[t * 3];
+        Vec3 a = Position(x, y, z, tri[0]);
+        Vec3 b = Position(x, y, z, tri[1]);
+        Vec3 d = Position(x, y, z, tri[2]);
+        Vec3 c = Vec3_Scale(Vec3_Add(a, Vec3_Add(b, d)), 1.0f / 3.0f);
+        g_cluster_keys[t] = (Facing(Vec3_Cross(Vec3_Sub(b, a), Vec3_Sub(d, a))) << (3 * CLUSTER_MORTON_BITS)) |
+            Spread3(Quantize(c.x, lo.x, scale)) | (Spread3(Quantize(c.y, lo.y, scale)) << 1) |
+            (Spread3(Quantize(c.z, lo.z, scale)) << 2);
+        src[t] = (uint16_t)t;
+    }
+
+    for (uint32_t shift = 0; shift < 3 * CLUSTER_MORTON_BITS + 3; shift += 8) {
+        uint32_t histogram[256];
+        memset(histogram, 0, sizeof(histogram));
+        for (uint32_t t = 0; t < tri_count; t++) histogram[(g_cluster_keys[t] >> shift) & 0xFF]++;
+        if (histogram[(g_cluster_keys[0] >> shift) & 0xFF] == tri_count) continue;
+
+        uint32_t offset = 0;
+        for (uint32_t b = 0; b < 256; b++) {
+            uint32_t n = histogram[b];
+            histogram[b] = offset;
+            offset += n;
+        }
+        for (uint32_t t = 0; t < tri_count; t++) {
+            uint16_t idx = src[t];
+            dst[histogram[(g_cluster_keys[idx] >> shift) & 0xFF]++] = idx;
+        }
+        uint16_t* tmp = src; src = dst; dst = tmp;
+    }
+    return src;
+}
+
+/* Sphere around the box of the cluster's corners, and the cone of its
+ * face normals, oriented as the face planes */
+static void Bound(MeshCluster_t* c, const float* x, const float* y, const float* z, const uint16_t* indices,
+    float quantum)
+{
+    const uint16_t* tris = &indices[c->first * 3];
+    Vec3 lo = Position(x, y, z, tris[0]);
+    Vec3 hi = lo;
+    for (uint32_t i = 1; i < c->count * 3; i++) {
+        Vec3 p = Position(x, y, z, tris[i]);
+        lo = Vec3_Create(MIN(lo.x, p.x), MIN(lo.y, p.y), MIN(lo.z, p.z));
+        hi = Vec3_Create(MAX(hi.x, p.x), MAX(hi.y, p.y), MAX(hi.z, p.z));
+    }
+    c->center = Vec3_Scale(Vec3_Add(lo, hi), 0.5f);
+    float radius_sq = 0.0f;
+    for (uint32_t i = 0; i < c->count * 3; i++) {
+        Vec3 d = Vec3_Sub(Position(x, y, z, tris[i]), c->center);
+        radius_sq = MAX(radius_sq, Vec3_Dot(d, d));
+    }
+    c->radius = sqrtf(radius_sq) + quantum;
+
+    /* Degenerate triangles have no facing and never draw: left out */
+    Vec3 sum = Vec3_Zero();
+    for (uint32_t t = 0; t < c->count; t++) {
+        const uint16_t* tri = &tris[t * 3];
+        Vec3 a = Position(x, y, z, tri[0]);
+        Vec3 n = Vec3_Cross(Vec3_Sub(Position(x, y, z, tri[1]), a), Vec3_Sub(Position(x, y, z, tri[2]), a));
+        float len = Vec3_Length(n);
+        if (len > 0.0f) sum = Vec3_Add(sum, Vec3_Scale(n, 1.0f / len));
+    }
+    c->cone_apex = c->center;
+    c->cone_axis = Vec3_Create(0.0f, 0.0f, 1.0f);
+    c->cone_cutoff = 1.0f;
+    float sum_len = Vec3_Length(sum);
+    if (sum_len <= 0.0f) return;
+    Vec3 axis = Vec3_Scale(sum, 1.0f / sum_len);
+
+    float min_dot = 1.0f;
+    for (uint32_t t = 0; t < c->count; t++) {
+        const uint16_t* tri = &tris[t * 3];
+        Vec3 a = Position(x, y, z, tri[0]);
+        Vec3 n = Vec3_Cross(Vec3_Sub(Position(x, y, z, tri[1]), a), Vec3_Sub(Position(x, y, z, tri[2]), a));
+        float len = Vec3_Length(n);
+        if (len > 0.0f) min_dot = MIN(min_dot, Vec3_Dot(n, axis) / len);
+    }
+    if (min_dot < MESH_CLUSTER_MIN_SPREAD) return;
+
+    /* Back from the center along the axis until behind every plane, and
+     * the quantization step further */
+    float back = 0.0f;
+    for (uint32_t t = 0; t < c->count; t++) {
+        const uint16_t* tri = &tris[t * 3];
+        Vec3 a = Position(x, y, z, tri[0]);
+        Vec3 n = Vec3_Cross(Vec3_Sub(Position(x, y, z, tri[1]), a), Vec3_Sub(Position(x, y, z, tri[2]), a));
+        float dn = Vec3_Dot(n, axis);
+        if (dn > 0.0f) back = MAX(back, Vec3_Dot(n, Vec3_Sub(c->center, a)) / dn);
+    }
+    c->cone_apex = Vec3_Sub(c->center, Vec3_Scale(axis, back + quantum / min_dot));
+    c->cone_axis = axis;
+    c->cone_cutoff = sqrtf(MAX(1.0f - min_dot * min_dot, 0.0f));
+}
+
+uint32_t Mesh_BuildClusters(uint32_t mesh_id)
+{
+    MeshSlot_t* m = Mesh_Get(mesh_id);
+    if (!m || m->type != 1 || (m->flags & MESH_FLAG_BAKED)) return 0;
+
+    StaticMeshDesc_t* desc = &m->stat;
+    if (desc->cluster_count) FreeClusters(desc->cluster_start, desc->cluster_count);
+    desc->cluster_count = 0;
+
+    uint32_t tri_count = desc->index_count / 3;
+    if (tri_count <= MESH_CLUSTER_TRIANGLES || tri_count > MESH_CLUSTER_MAX_TRIANGLES) return 0;
+    uint32_t count = (tri_count + MESH_CLUSTER_TRIANGLES - 1) / MESH_CLUSTER_TRIANGLES;
+    uint32_t start = AllocClusters(count);
+    if (start == 0xFFFFFFFF) return 0;
+
+    const float *x, *y, *z;
+    Mesh_GetPositions(m, &x, &y, &z);
+    uint16_t* indices = &g_index_pool[desc->index_start];
+
+    /* Level 0 only; coarser levels index the vertices, not these slots */
+    Vec3 lo = Position(x, y, z, indices[0]);
+    Vec3 hi = lo;
+    for (uint32_t i = 1; i < tri_count * 3; i++) {
+        Vec3 p = Position(x, y, z, indices[i]);
+        lo = Vec3_Create(MIN(lo.x, p.x), MIN(lo.y, p.y), MIN(lo.z, p.z));
+        hi = Vec3_Create(MAX(hi.x, p.x), MAX(hi.y, p.y), MAX(hi.z, p.z));
+    }
+    const uint16_t* order = SortTriangles(x, y, z, indices, tri_count, lo, hi);
+    for (uint32_t t = 0; t < tri_count; t++) {
+        memcpy(&g_cluster_indices[t * 3], &indices[order[t] * 3], 3 * sizeof(uint16_t));
+    }
+    memcpy(indices, g_cluster_indices, tri_count * 3 * sizeof(uint16_t));
+
+    /* Packed meshes draw from positions up to half a step per axis off */
+    float quantum = desc->bounds_radius * (0.87f / (float)PACKED_POS_ONE);
+    for (uint32_t k = 0; k < count; k++) {
+        MeshCluster_t* c = &g_cluster_pool[start + k];
+        c->first = k * MESH_CLUSTER_TRIANGLES;
+        c->count = MIN((uint32_t)MESH_CLUSTER_TRIANGLES, tri_count - c->first);
+        Bound(c, x, y, z, indices, quantum);
+    }
+    desc->cluster_start = start;
+    desc->cluster_count = (uint16_t)count;
+
+    if (m->flags & MESH_FLAG_FACE_PLANES) Mesh_BuildFacePlanes(mesh_id);
+    return count;
+}
+
+/* ============================================================
+ * Culling
+ * ============================================================ */
+
+void MeshCluster_BeginView(MeshClusterView_t* view, const Mat4* mvp)
+{
+    Clip_ExtractFrustum(mvp, &view->frustum);
+
+    /* A mirroring mvp flips which side of a plane draws, w < 0 */
+    Vec4 eye = Mat4_ProjectionEye(mvp);
+    view->eye = Vec3_Zero();
+    view->facing = 0.0f;
+    if (fabsf(eye.w) > 1e-12f) {
+        view->eye = Vec3_Scale(Vec3_Create(eye.x, eye.y, eye.z), 1.0f / eye.w);
+        view->facing = (eye.w > 0.0f) ? 1.0f : -1.0f;
+    }
+}
+
+int MeshCluster_Visible(const MeshClusterView_t* view, const MeshCluster_t* c)
+{
+    if (!Clip_SphereInFrustum(&view->frustum, c->center, c->radius)) return 0;
+    if (view->facing == 0.0f || c->cone_cutoff >= 1.0f) return 1;
+
+    /* Every normal is within theta = asin(cutoff) of the axis. Seen from
+     * an eye within 90 - theta degrees of the axis through the apex,
+     * which lies behind every plane, each triangle faces away. Mirrored,
+     * the apex would have to lie in front of them instead. */
+    if (view->facing > 0.0f) {
+        Vec3 u = Vec3_Sub(c->cone_apex, view->eye);
+        if (Vec3_Dot(c->cone_axis, u) >= (c->cone_cutoff + MESH_CLUSTER_CONE_MARGIN) * Vec3_Length(u)) return 0;
+    }
+
+    /* Or by the sphere, tighter when the apex is far back: with phi the
+     * angle from the axis to the view ray v, every normal is within
+     * phi + theta of v, so the eye is at least |v| cos(phi + theta) -
+     * radius behind each plane */
+    Vec3 v = Vec3_Sub(c->center, view->eye);
+    float along = view->facing * Vec3_Dot(c->cone_axis, v);
+    if (along <= 0.0f) return 1;
+    float dist_sq = Vec3_Dot(v, v);
+    float across = sqrtf(MAX(dist_sq - along * along, 0.0f));
+    float cos_spread = sqrtf(1.0f - c->cone_cutoff * c->cone_cutoff);
+    float behind = along * cos_spread - across * c->cone_cutoff;
+    return behind <= c->radius + MESH_CLUSTER_CONE_MARGIN * sqrtf(dist_sq);
+}
+
+uint32_t MeshCluster_GetMemPools(MemPool_t* out, uint32_t max)
+{
+    uint32_t n = 0;
+    n = MemMap_Add(out, n, max, "cluster sort keys", g_cluster_keys, sizeof(g_cluster_keys), sizeof(g_cluster_keys));
+    n = MemMap_Add(out, n, max, "cluster sort order", g_cluster_order, sizeof(g_cluster_order), sizeof(g_cluster_order));
+    n = MemMap_Add(out, n, max, "cluster index scratch", g_cluster_indices, sizeof(g_cluster_indices),
+        sizeof(g_cluster_indices));
+    return n;
+}
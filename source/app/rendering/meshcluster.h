@@ -0,0 +1,68 @@
+/**
+ * @file meshcluster.h
+ * @brief Mesh Clusters: Partitioning And Per-Cluster Culling - NO MALLOC
+ *
+ * Level 0 of a static mesh is split into runs of MESH_CLUSTER_TRIANGLES
+ * neighbouring triangles (MeshCluster_t in mesh.h), each with a bounding
+ * sphere and a cone around its face normals. MeshDraw tests the clusters
+ * of a draw before any vertex work and skips those outside the frustum
+ * or facing wholly away from the eye, so their triangles are never
+ * assembled and the vertices only they use are never transformed.
+ * SceneBuffer_Build() also tests the spheres of the first
+ * MESH_CLUSTER_MASK_BITS clusters against the frame's occluders and
+ * hands the survivors down in DrawCmd_t cluster_mask.
+ *
+ * Mesh_BuildClusters() sorts level 0's triangles along a Morton curve
+ * through their centroids, so that each run is compact, and reorders
+ * the index list to match. The cooker runs it before baking and images
+ * carry the clusters; coarser levels are few triangles and draw
+ * unclustered. The cone test is conservative: the eye lies behind every
+ * plane of a culled cluster, by a margin that leaves nearly edge-on
+ * triangles to the per-triangle tests.
+ */
+
+#ifndef MESHCLUSTER_H
+#define MESHCLUSTER_H
+
+#include <stdint.h>
+#include "mesh.h"
+#include "clip.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MESH_CLUSTER_TRIANGLES      64
+#define MESH_CLUSTER_MAX_TRIANGLES  8192    /* Level 0 of the largest mesh clustered */
+#define MESH_CLUSTER_MIN_SPREAD     0.1f    /* Normals within acos of this of the axis get a cone */
+#define MESH_CLUSTER_CONE_MARGIN    0.02f   /* Of the eye distance, before a cone culls */
+#define MESH_CLUSTER_MASK_BITS      32
+#define MESH_CLUSTERS_ALL           0xFFFFFFFFu
+
+/* Clusters for level 0 of a static pool mesh, replacing any it had;
+ * reorders its triangles (face planes follow). Call after editing the
+ * positions or indices. Returns the cluster count, 0 if none were built:
+ * MD2, baked, at most one cluster's worth of triangles, too large, or
+ * the cluster pool is full. */
+uint32_t Mesh_BuildClusters(uint32_t mesh_id);
+
+/* One draw's view of its mesh, in object space */
+typedef struct {
+    ClipFrustum_t frustum;
+    Vec3 eye;
+    float facing;               /* +1, -1 under a mirroring mvp, 0 orthographic: no cone test */
+} MeshClusterView_t;
+
+void MeshCluster_BeginView(MeshClusterView_t* view, const Mat4* mvp);
+
+/* 0 when no triangle of the cluster can be drawn from view */
+int MeshCluster_Visible(const MeshClusterView_t* view, const MeshCluster_t* c);
+
+/* Build scratch for MemMap_Print() */
+uint32_t MeshCluster_GetMemPools(MemPool_t* out, uint32_t max);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MESHCLUSTER_H */
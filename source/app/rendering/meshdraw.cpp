@@ -0,0 +1,648 @@
+/**
+ * @file meshdraw.cpp
+ * @brief Mesh Submission Implementation
+ */
+
+#include "meshdraw.h"
+#include "platform.h"
+#include "mesh.h"
+#include "meshlod.h"
+#include "meshcluster.h"
+#include "clip.h"
+#include "arena.h"
+#include "rasterizer.h"
+#include "renderqueue.h"
+#include "texcache.h"
+#include "profile.h"
+#include "capture.h"
+#include "lighting.h"
+#include "impostor.h"
+#include "shadow.h"
+#include <string.h>
+
+/* ============================================================
+ * Vertex Processing
+ * ============================================================ */
+
+/* Vertex lighting is skipped in the depth prepass, which writes no color */
+static inline int Shaded(void)
+{
+    return !(Rasterizer_GetState() & RASTER_STATE_DEPTH_ONLY);
+}
+
+/* Post-transform vertex buffer from the frame arena: each mesh vertex is
+ * transformed once per draw, then triangles are assembled from the index
+ * list. Released again when the draw ends. */
+static ClipVertex_t* AllocTransformed(uint32_t count)
+{
+    return (ClipVertex_t*)Arena_Alloc(count * sizeof(ClipVertex_t), ARENA_DEFAULT_ALIGN);
+}
+
+/* SoA scratch for the lighting inputs: normals, then positions when the
+ * lights need them */
+typedef struct {
+    float* nx;
+    float* ny;
+    float* nz;
+    float* px;
+    float* py;
+    float* pz;
+} LightInput_t;
+
+static int AllocLightInput(LightInput_t* in, uint32_t count, int positions)
+{
+    float* f = (float*)Arena_Alloc(count * (positions ? 6 : 3) * sizeof(float), ARENA_DEFAULT_ALIGN);
+    if (!f) return 0;
+    in->nx = f;
+    in->ny = f + count;
+    in->nz = f + count * 2;
+    in->px = positions ? f + count * 3 : NULL;
+    in->py = positions ? f + count * 4 : NULL;
+    in->pz = positions ? f + count * 5 : NULL;
+    return 1;
+}
+
+void MeshDraw_SyncBounds(MeshRenderer_t* mr)
+{
+    MeshSlot_t* mesh = Mesh_Get(mr->mesh_id);
+    mr->bounds_center = MakeVec3(0, 0, 0);
+    mr->bounds_radius = -1.0f;  /* Unknown: never culled */
+    if (!mesh) return;
+
+    if (mesh->type == 1) {
+        mr->bounds_center = mesh->stat.bounds_center;
+        mr->bounds_radius = mesh->stat.bounds_radius;
+    }
+    else if (mesh->type == 2) {
+        mr->bounds_center = mesh->anim.bounds_center;
+        mr->bounds_radius = mesh->anim.bounds_radius;
+    }
+}
+
+/* ============================================================
+ * Mesh Draws
+ * ============================================================ */
+
+/* One static mesh level set up for any number of placements. Transforms
+ * write only positions and lighting only colors, so the UVs in the
+ * transformed buffer and the lighting inputs stay valid across them. */
+typedef struct {
+    const uint16_t* indices;
+    uint32_t tri_count;
+    uint32_t count;             /* Leading vertices the level reads */
+    const PackedVertex_t* packed;
+    Mat4 dequant;
+    const float* x;
+    const float* y;
+    const float* z;
+    ClipVertex_t* transformed;
+    LightInput_t light;
+    const Vec4* planes;         /* Per triangle, NULL = rasterizer culls back faces */
+    const MeshCluster_t* clusters;  /* Level 0 only, NULL = unclustered */
+    uint32_t cluster_count;
+} StaticSetup_t;
+
+/* Arena buffers and per-vertex inputs of a static draw; 0 if the mesh
+ * cannot be drawn (nothing to release then) */
+static int BeginStatic(StaticSetup_t* s, uint32_t mesh_id, uint32_t lod)
+{
+    MeshSlot_t* mesh = Mesh_Get(mesh_id);
+    if (!mesh || mesh->type != 1) return 0;
+
+    /* A coarser level reads only the leading vertices */
+    uint32_t index_count;
+    const Vertex_t* verts = Mesh_GetVertices(mesh);
+    s->indices = Mesh_GetLodIndices(mesh, lod, &index_count, &s->count);
+
+    if (!verts || !s->indices) return 0;
+    if (index_count == 0) return 0;
+    s->tri_count = index_count / 3;
+    s->planes = Mesh_GetLodFacePlanes(mesh, lod);
+    s->clusters = (lod == 0) ? Mesh_GetClusters(mesh, &s->cluster_count) : NULL;
+    if (!s->clusters) s->cluster_count = 0;
+
+    int positions = Lighting_NeedsPositions();
+    s->transformed = AllocTransformed(s->count);
+    if (!s->transformed || !AllocLightInput(&s->light, s->count, positions)) return 0;
+
+    uint64_t transform_start = Profile_Now();
+    uint32_t count = s->count;
+    ClipVertex_t* transformed = s->transformed;
+    LightInput_t* light = &s->light;
+    s->packed = Mesh_GetPackedVertices(mesh);
+    if (s->packed) {
+        const PackedVertex_t* packed = s->packed;
+        Mesh_GetPackedDequant(&mesh->stat, &s->dequant);
+        for (uint32_t i = 0; i < count; i++) {
+            Vec3 n = Mesh_DecodeNormal(packed[i].normal);
+            light->nx[i] = n.x;
+            light->ny[i] = n.y;
+            light->nz[i] = n.z;
+            transformed[i].u = packed[i].u * (1.0f / PACKED_UV_ONE);
+            transformed[i].v = packed[i].v * (1.0f / PACKED_UV_ONE);
+            if (positions) {
+                Vec3 p = Mat4_TransformPoint(&s->dequant, MakeVec3(packed[i].x, packed[i].y, packed[i].z));
+                light->px[i] = p.x;
+                light->py[i] = p.y;
+                light->pz[i] = p.z;
+            }
+        }
+        s->x = light->px;
+        s->y = light->py;
+        s->z = light->pz;
+    }
+    else {
+        Mesh_GetPositions(mesh, &s->x, &s->y, &s->z);
+        for (uint32_t i = 0; i < count; i++) {
+            light->nx[i] = verts[i].normal.x;
+            light->ny[i] = verts[i].normal.y;
+            light->nz[i] = verts[i].normal.z;
+            transformed[i].u = verts[i].texcoord.x;
+            transformed[i].v = verts[i].texcoord.y;
+        }
+    }
+    Rasterizer_AddStageTime(RASTER_STAGE_TRANSFORM, transform_start, Profile_Now());
+    return 1;
+}
+
+/* Object-space culling ahead of the transform: clusters outside the
+ * frustum of mvp, facing away from its eye or clear in cluster_mask
+ * (MESH_CLUSTER_MASK_BITS), then single back faces. The triangles left
+ * come as a new index list, plus the vertices they use when that is few
+ * enough to gather. 0 when nothing is left. */
+typedef struct {
+    const uint16_t* indices;
+    uint32_t tri_count;
+    uint16_t* live;             /* Vertices to transform, NULL = all */
+    uint32_t live_count;
+} FrontFaces_t;
+
+static uint32_t CullBackFaces(const StaticSetup_t* s, const Mat4* mvp, uint32_t cluster_mask, FrontFaces_t* f)
+{
+    f->indices = s->indices;
+    f->tri_count = s->tri_count;
+    f->live = NULL;
+    f->live_count = s->count;
+    if (!s->planes && !s->clusters) return f->tri_count;
+
+    uint16_t* front = (uint16_t*)Arena_Alloc(s->tri_count * 3 * sizeof(uint16_t), ARENA_DEFAULT_ALIGN);
+    uint8_t* used = (uint8_t*)Arena_Alloc(s->count, ARENA_DEFAULT_ALIGN);
+    if (!front || !used) return f->tri_count;
+    memset(used, 0, s->count);
+
+    /* Nearly edge-on triangles are left to the rasterizer: its area
+     * test on snapped coordinates keeps a few slivers the exact plane
+     * test would reject */
+    Vec4 eye = Mat4_ProjectionEye(mvp);
+    MeshClusterView_t view;
+    if (s->clusters) MeshCluster_BeginView(&view, mvp);
+    uint32_t out = 0;
+    uint32_t culled = 0;
+    uint32_t runs = s->clusters ? s->cluster_count : 1;
+    for (uint32_t k = 0; k < runs; k++) {
+        uint32_t first = 0, last = s->tri_count;
+        if (s->clusters) {
+            const MeshCluster_t* c = &s->clusters[k];
+            if ((k < MESH_CLUSTER_MASK_BITS && !(cluster_mask & (1u << k))) || !MeshCluster_Visible(&view, c)) {
+                culled++;
+                continue;
+            }
+            first = c->first;
+            last = c->first + c->count;
+        }
+
+        for (uint32_t t = first; t < last; t++) {
+            if (s->planes) {
+                const Vec4* p = &s->planes[t];
+                float side = p->x * eye.x + p->y * eye.y + p->z * eye.z + p->w * eye.w;
+                float scale = fabsf(p->x * eye.x) + fabsf(p->y * eye.y) + fabsf(p->z * eye.z) + fabsf(p->w * eye.w);
+                if (side < -1e-2f * scale) continue;
+            }
+
+            const uint16_t* tri = &s->indices[t * 3];
+            front[out++] = tri[0];
+            front[out++] = tri[1];
+            front[out++] = tri[2];
+            used[tri[0]] = used[tri[1]] = used[tri[2]] = 1;
+        }
+    }
+    if (culled) Rasterizer_AddCulledClusters(culled);
+    f->indices = front;
+    f->tri_count = out / 3;
+
+    /* Gathering pays off only when it skips a good share of the
+     * vertices; otherwise the batch transform takes them all */
+    uint32_t live_count = 0;
+    for (uint32_t i = 0; i < s->count; i++) live_count += used[i];
+    if (live_count * 4 > s->count * 3) return f->tri_count;
+
+    uint16_t* live = (uint16_t*)Arena_Alloc(live_count * sizeof(uint16_t), ARENA_DEFAULT_ALIGN);
+    if (!live) return f->tri_count;
+    uint32_t n = 0;
+    for (uint32_t i = 0; i < s->count; i++) {
+        if (used[i]) live[n++] = (uint16_t)i;
+    }
+    f->live = live;
+    f->live_count = live_count;
+    return f->tri_count;
+}
+
+/* Transforms and lights only the live vertices: gathered into SoA
+ * scratch for the batch routines, then scattered back in place */
+static int TransformLive(const StaticSetup_t* s, const Mat4* mvp, const FrontFaces_t* f)
+{
+    uint32_t n = f->live_count;
+    float* g = (float*)Arena_Alloc(n * 6 * sizeof(float), ARENA_DEFAULT_ALIGN);
+    ClipVertex_t* out = AllocTransformed(n);
+    if (!g || !out) return 0;
+    float *x = g, *y = g + n, *z = g + n * 2, *nx = g + n * 3, *ny = g + n * 4, *nz = g + n * 5;
+
+    for (uint32_t j = 0; j < n; j++) {
+        uint32_t i = f->live[j];
+        if (s->packed) {
+            const PackedVertex_t* pv = &s->packed[i];
+            Vec3 p = Mat4_TransformPoint(&s->dequant, MakeVec3(pv->x, pv->y, pv->z));
+            x[j] = p.x;
+            y[j] = p.y;
+            z[j] = p.z;
+        }
+        else {
+            x[j] = s->x[i];
+            y[j] = s->y[i];
+            z[j] = s->z[i];
+        }
+        nx[j] = s->light.nx[i];
+        ny[j] = s->light.ny[i];
+        nz[j] = s->light.nz[i];
+    }
+    Clip_TransformPositions(mvp, x, y, z, n, out);
+    if (Shaded()) Lighting_Shade(nx, ny, nz, x, y, z, n, out);
+
+    for (uint32_t j = 0; j < n; j++) {
+        ClipVertex_t* v = &s->transformed[f->live[j]];
+        v->pos = out[j].pos;
+        v->color = out[j].color;
+    }
+    return 1;
+}
+
+/* One placement: cull clusters and back faces against the eye,
+ * transform the vertex range (or what the triangles left use of it),
+ * light it in object space and draw the level */
+static void DrawStatic(const StaticSetup_t* s, const Mat4* mvp, const Mat4* world, uint16_t color,
+    uint32_t cluster_mask)
+{
+    ArenaMark_t mark = Arena_Mark();
+    uint64_t transform_start = Profile_Now();
+    FrontFaces_t faces;
+    if (CullBackFaces(s, mvp, cluster_mask, &faces) == 0) {
+        Arena_Release(mark);
+        Rasterizer_AddStageTime(RASTER_STAGE_TRANSFORM, transform_start, Profile_Now());
+        return;
+    }
+
+    Lighting_BeginDraw(world);
+    if (faces.live && TransformLive(s, mvp, &faces)) {
+        /* Done */
+    }
+    else if (s->packed) {
+        /* Dequantization rides along in the MVP */
+        Mat4 packed_mvp;
+        Mat4_Multiply(&packed_mvp, mvp, &s->dequant);
+        Clip_TransformQuantized(&packed_mvp, &s->packed->x, sizeof(PackedVertex_t) / sizeof(int16_t),
+            s->count, s->transformed);
+        if (Shaded()) Lighting_Shade(s->light.nx, s->light.ny, s->light.nz, s->x, s->y, s->z, s->count, s->transformed);
+    }
+    else {
+        Clip_TransformPositions(mvp, s->x, s->y, s->z, s->count, s->transformed);
+        if (Shaded()) Lighting_Shade(s->light.nx, s->light.ny, s->light.nz, s->x, s->y, s->z, s->count, s->transformed);
+    }
+    Rasterizer_AddStageTime(RASTER_STAGE_TRANSFORM, transform_start, Profile_Now());
+
+    /* Large meshes draw nearest triangles first for the early depth test;
+     * blended ones farthest first instead */
+    uint32_t* order = NULL;
+    uint32_t tri_count = faces.tri_count;
+    if (tri_count >= RQ_SORT_MIN_TRIANGLES) {
+        order = RenderQueue_SortTriangles(s->transformed, faces.indices, tri_count);
+    }
+    int back_to_front = (Rasterizer_GetState() & (RASTER_STATE_BLEND_AVERAGE | RASTER_STATE_BLEND_ADD)) != 0;
+
+    if (order && back_to_front) {
+        for (uint32_t a = 0, b = tri_count - 1; a < b; a++, b--) {
+            uint32_t swap = order[a];
+            order[a] = order[b];
+            order[b] = swap;
+        }
+    }
+
+    /* Draw triangles (the rasterizer culls any back faces left) */
+    Clip_DrawTrianglesSolidTo(Rasterizer_GetContext(), s->transformed, s->count, faces.indices, order,
+        tri_count, color);
+    Arena_Release(mark);
+}
+
+static void DrawStaticMasked(uint32_t mesh_id, const Mat4* mvp, const Mat4* world, uint32_t lod, uint16_t color,
+    uint32_t cluster_mask)
+{
+    ArenaMark_t mark = Arena_Mark();
+    StaticSetup_t setup;
+    if (BeginStatic(&setup, mesh_id, lod)) DrawStatic(&setup, mvp, world, color, cluster_mask);
+    Arena_Release(mark);
+}
+
+void MeshDraw_Static(uint32_t mesh_id, const Mat4* mvp, const Mat4* world, uint32_t lod, uint16_t color)
+{
+    DrawStaticMasked(mesh_id, mvp, world, lod, color, MESH_CLUSTERS_ALL);
+}
+
+/* Instances share one setup; frustum NULL draws every one, cluster_masks
+ * NULL every cluster of each */
+static uint32_t DrawStaticInstances(uint32_t mesh_id, const Mat4* view_proj, const ClipFrustum_t* frustum,
+    const MeshInstance_t* instances, const uint32_t* cluster_masks, uint32_t count, uint32_t lod)
+{
+    const MeshSlot_t* mesh = Mesh_Get(mesh_id);
+    if (!mesh || mesh->type != 1 || count == 0) return 0;
+
+    ArenaMark_t mark = Arena_Mark();
+    StaticSetup_t setup;
+    if (!BeginStatic(&setup, mesh_id, lod)) {
+        Arena_Release(mark);
+        return 0;
+    }
+
+    uint32_t drawn = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        const Mat4* world = &instances[i].world;
+        if (frustum) {
+            /* Mesh bounds under the instance's largest axis scale */
+            const float* m = world->m;
+            float sx = m[0] * m[0] + m[1] * m[1] + m[2] * m[2];
+            float sy = m[4] * m[4] + m[5] * m[5] + m[6] * m[6];
+            float sz = m[8] * m[8] + m[9] * m[9] + m[10] * m[10];
+            float max_sq = MAX(sx, MAX(sy, sz));
+            Vec3 center = Mat4_TransformPoint(world, mesh->stat.bounds_center);
+            if (!Clip_SphereInFrustum(frustum, center, mesh->stat.bounds_radius * sqrtf(max_sq))) continue;
+        }
+
+        Mat4 mvp;
+        Mat4_Multiply(&mvp, view_proj, world);
+        DrawStatic(&setup, &mvp, world, instances[i].color, cluster_masks ? cluster_masks[i] : MESH_CLUSTERS_ALL);
+        drawn++;
+    }
+    Arena_Release(mark);
+    if (frustum) Rasterizer_AddCulledEntities(count - drawn);
+    return drawn;
+}
+
+uint32_t MeshDraw_StaticInstanced(uint32_t mesh_id, const Mat4* view_proj, const MeshInstance_t* instances,
+    uint32_t count, uint32_t lod)
+{
+    ClipFrustum_t frustum;
+    Clip_ExtractFrustum(view_proj, &frustum);
+    return DrawStaticInstances(mesh_id, view_proj, &frustum, instances, NULL, count, lod);
+}
+
+void MeshDraw_MD2To(RasterContext_t* ctx, uint32_t mesh_id, const Mat4* mvp, const Mat4* world, uint32_t lod,
+    uint16_t frame_a, uint16_t frame_b, float lerp, const Texture_t* texture)
+{
+    MeshSlot_t* mesh = Mesh_Get(mesh_id);
+    if (!mesh || mesh->type != 2) return;
+
+    uint32_t index_count, lod_pairs;
+    const uint16_t* indices = Mesh_GetLodIndices(mesh, lod, &index_count, &lod_pairs);
+    if (!indices) return;
+
+    const MD2UV_t* uvs = Mesh_GetUVPairs(mesh);
+
+    /* Decode (shared between instances on the same pose) and transform
+     * every frame vertex once */
+    uint64_t transform_start = Profile_Now();
+    const MD2Pose_t* pose = Mesh_GetMD2Pose(mesh_id, frame_a, frame_b, lerp);
+    if (!pose) return;
+    uint32_t count = pose->count;
+    uint32_t pair_count = MIN(lod_pairs, (uint32_t)mesh->anim.uv_count);   /* Pairs the level addresses */
+
+    ArenaMark_t mark = Arena_Mark();
+    ClipVertex_t* transformed = AllocTransformed(count + pair_count);
+    if (!transformed) {
+        Arena_Release(mark);
+        return;
+    }
+
+    Clip_TransformPositions(mvp, pose->x, pose->y, pose->z, count, transformed);
+    for (uint32_t i = 0; i < count; i++) {
+        transformed[i].u = 0.0f;
+        transformed[i].v = 0.0f;
+    }
+
+    /* Directional light: one lit entry per table normal, then a blended
+     * lookup per vertex. Point and spot lights need the decoded normals. */
+    Lighting_BeginDraw(world);
+    if (RasterContext_GetState(ctx) & RASTER_STATE_DEPTH_ONLY) {
+        /* Prepass: no colors */
+    }
+    else if (!Lighting_NeedsPositions()) {
+        LightLevel_t table[MD2_NUM_NORMALS];
+        Lighting_BuildTable(g_md2_normals, MD2_NUM_NORMALS, table);
+        Lighting_ShadeIndexed(table, pose->normal_a, pose->normal_b,
+            pose->lerp_step * LIGHTING_WEIGHT_ONE / MD2_POSE_LERP_STEPS, count, transformed);
+    } else {
+        LightInput_t light;
+        if (!AllocLightInput(&light, count, 0)) {
+            Arena_Release(mark);
+            return;
+        }
+        float t = (float)pose->lerp_step / MD2_POSE_LERP_STEPS;
+        for (uint32_t i = 0; i < count; i++) {
+            const float* na = g_md2_normals[pose->normal_a[i]];
+            const float* nb = g_md2_normals[pose->normal_b[i]];
+            Vec3 n = Vec3_Normalize(Vec3_Lerp(MakeVec3(na[0], na[1], na[2]),
+                MakeVec3(nb[0], nb[1], nb[2]), t));
+            light.nx[i] = n.x;
+            light.ny[i] = n.y;
+            light.nz[i] = n.z;
+        }
+        Lighting_Shade(light.nx, light.ny, light.nz, pose->x, pose->y, pose->z, count, transformed);
+    }
+
+    /* Expand to the deduplicated (vertex, uv) pairs past the frame vertices;
+     * triangles index these directly */
+    ClipVertex_t* pairs = &transformed[count];
+    for (uint32_t k = 0; k < pair_count; k++) {
+        uint16_t vi = uvs[k].vertex;
+        pairs[k] = transformed[(vi < count) ? vi : 0];
+        pairs[k].u = uvs[k].u;
+        pairs[k].v = uvs[k].v;
+    }
+    RasterContext_AddStageTime(ctx, RASTER_STAGE_TRANSFORM, transform_start, Profile_Now());
+
+    /* Draw triangles */
+    if (texture) Clip_DrawTrianglesTo(ctx, pairs, pair_count, indices, NULL, index_count / 3, texture);
+    else Clip_DrawTrianglesSolidTo(ctx, pairs, pair_count, indices, NULL, index_count / 3, COLOR_BLUE);
+    Arena_Release(mark);
+}
+
+void MeshDraw_MD2(uint32_t mesh_id, const Mat4* mvp, const Mat4* world, uint32_t lod,
+    uint16_t frame_a, uint16_t frame_b, float lerp, const Texture_t* texture)
+{
+    MeshDraw_MD2To(Rasterizer_GetContext(), mesh_id, mvp, world, lod, frame_a, frame_b, lerp, texture);
+}
+
+/* ============================================================
+ * Draw Lists
+ * ============================================================ */
+
+static int g_depth_prepass = 0;
+
+void MeshDraw_SetDepthPrepass(int enabled)
+{
+    g_depth_prepass = enabled;
+}
+
+int MeshDraw_IsDepthPrepass(void)
+{
+    return g_depth_prepass;
+}
+
+/* One pass over the sorted queue in batches that share a texture (and
+ * the material too in the alpha pass). The depth-only pass stops where the transparent draws and
+ * impostors begin, as they write no depth; the shading pass draws the
+ * planar shadows there, over the opaque draws and under the rest. */
+static void ExecuteQueue(const DrawList_t* list, uint32_t state, int depth_only)
+{
+    const RenderItem_t* items = RenderQueue_GetItems();
+    uint32_t item_count = RenderQueue_GetCount();
+    int shadowed = depth_only;
+    for (uint32_t start = 0; start < item_count; ) {
+        int alpha = (items[start].key >> RQ_PASS_SHIFT) == RQ_PASS_ALPHA;
+        if (depth_only && alpha) break;
+        if (alpha && !shadowed) {
+            Shadow_Draw(list, items, start);
+            shadowed = 1;
+        }
+        uint32_t end = RenderQueue_BatchEnd(start, alpha ? RQ_ALPHA_BATCH_MASK : RQ_BATCH_MASK);
+
+        /* Transparent draws blend without writing depth */
+        uint32_t batch_state = state;
+        if (depth_only) {
+            batch_state |= RASTER_STATE_DEPTH_ONLY;
+        }
+        else if (alpha && items[start].impostor == IMPOSTOR_NONE) {
+            batch_state &= ~RASTER_STATE_DEPTH_WRITE;
+            batch_state |= (items[start].draw->flags & DRAW_FLAG_ADDITIVE) ?
+                RASTER_STATE_BLEND_ADD : RASTER_STATE_BLEND_AVERAGE;
+        }
+        if (batch_state != Rasterizer_GetState()) Rasterizer_SetState(batch_state);
+
+        Texture_t tex;
+        const Texture_t* bound = (!depth_only && TexCache_GetRaster(items[start].texture_id, &tex)) ? &tex : NULL;
+
+        for (uint32_t i = start; i < end; ) {
+            const DrawCmd_t* cmd = items[i].draw;
+            if (items[i].impostor != IMPOSTOR_NONE) {
+                Impostor_Draw(items[i].impostor, cmd, &list->view_proj, bound);
+                i++;
+                continue;
+            }
+
+            /* Neighbours drawing the same static level share one setup */
+            uint32_t run = i + 1;
+            if (!(cmd->flags & DRAW_FLAG_ANIMATED)) {
+                while (run < end && !(items[run].draw->flags & DRAW_FLAG_ANIMATED) &&
+                    items[run].draw->mesh_id == cmd->mesh_id && items[run].draw->lod == cmd->lod) run++;
+            }
+            if (run - i > 1) {
+                ArenaMark_t mark = Arena_Mark();
+                MeshInstance_t* instances = (MeshInstance_t*)Arena_Alloc((run - i) * sizeof(MeshInstance_t),
+                    ARENA_DEFAULT_ALIGN);
+                uint32_t* masks = (uint32_t*)Arena_Alloc((run - i) * sizeof(uint32_t), ARENA_DEFAULT_ALIGN);
+                if (instances && masks) {
+                    for (uint32_t k = i; k < run; k++) {
+                        instances[k - i].world = items[k].draw->world;
+                        instances[k - i].color = items[k].color;
+                        masks[k - i] = items[k].draw->cluster_mask;
+                    }
+                    DrawStaticInstances(cmd->mesh_id, &list->view_proj, NULL, instances, masks, run - i, cmd->lod);
+                    Arena_Release(mark);
+                    i = run;
+                    continue;
+                }
+                Arena_Release(mark);
+            }
+
+            /* Model -> world -> view -> clip, combined once per draw */
+            Mat4 mvp;
+            Mat4_Multiply(&mvp, &list->view_proj, &cmd->world);
+
+            if (cmd->flags & DRAW_FLAG_ANIMATED) {
+                MeshDraw_MD2(cmd->mesh_id, &mvp, &cmd->world, cmd->lod,
+                    cmd->anim_frame_a, cmd->anim_frame_b, cmd->anim_lerp, bound);
+            }
+            else {
+                DrawStaticMasked(cmd->mesh_id, &mvp, &cmd->world, cmd->lod, items[i].color, cmd->cluster_mask);
+            }
+            i++;
+        }
+        start = end;
+    }
+    if (!shadowed) Shadow_Draw(list, items, item_count);
+}
+
+void MeshDraw_List(const DrawList_t* list, MeshDrawMaterial_t material, void* user)
+{
+    Rasterizer_AddCulledEntities(list->culled);
+    MeshDraw_ListFiltered(list, material, user, 0, 0);
+}
+
+void MeshDraw_ListFiltered(const DrawList_t* list, MeshDrawMaterial_t material, void* user,
+    uint32_t flag_mask, uint32_t flag_value)
+{
+    if (Capture_IsRecording()) Capture_OnView(&list->view_proj, list->lights, list->light_count);
+    Lighting_SetLights(list->lights, list->light_count);
+
+    /* Queue every draw under its sort key */
+    TexCache_BeginFrame();
+    Impostor_BeginFrame();
+    RenderQueue_Begin();
+    for (uint32_t i = 0; i < list->count; i++) {
+        const DrawCmd_t* cmd = &list->cmds[i];
+        if ((cmd->flags & flag_mask) != flag_value) continue;
+
+        uint16_t color = 0xFFFF;
+        uint32_t texture = 0xFFFFFFFF;
+        if (material) material(cmd, &color, &texture, user);
+        if (Capture_IsRecording()) Capture_OnDraw(cmd, color, texture);
+
+        /* Depth of the object origin orders opaque draws front to back,
+         * transparent ones back to front after them */
+        Vec4 origin = Mat4_MultiplyVec4(&list->view_proj,
+            MakeVec4(cmd->world.m[12], cmd->world.m[13], cmd->world.m[14], 1.0f));
+        float depth = (origin.w > 0.0f) ? origin.z / origin.w : 0.0f;
+        uint32_t pass = (cmd->flags & DRAW_FLAG_TRANSPARENT) ? RQ_PASS_ALPHA : RQ_PASS_OPAQUE;
+        uint32_t key_texture = (texture != 0xFFFFFFFF) ? texture : RQ_NO_TEXTURE;
+
+        /* Distant animated models draw as keyed sprites, which do not
+         * write depth, so they go with the blended draws */
+        uint32_t impostor = Impostor_Select(cmd, &list->view_proj);
+        if (impostor != IMPOSTOR_NONE) {
+            pass = RQ_PASS_ALPHA;
+            key_texture = Impostor_GetTextureId(impostor);
+        }
+
+        RenderItem_t* item = RenderQueue_Push(RenderQueue_MakeKey(pass, cmd->material_id, key_texture, depth));
+        if (!item) break;
+        item->draw = cmd;
+        item->texture_id = texture;
+        item->color = color;
+        item->impostor = (uint16_t)impostor;
+        if (texture != 0xFFFFFFFF) TexCache_Request(texture);
+    }
+    RenderQueue_Sort();
+
+    /* With the prepass, the opaque draws go through depth only first */
+    uint32_t state = Rasterizer_GetState();
+    if (g_depth_prepass && !Rasterizer_IsVisibilityBuffer()) ExecuteQueue(list, state, 1);
+    ExecuteQueue(list, state, 0);
+    if (Rasterizer_GetState() != state) Rasterizer_SetState(state);
+}
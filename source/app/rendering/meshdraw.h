@@ -0,0 +1,88 @@
+/**
+ * @file meshdraw.h
+ * @brief Mesh Submission: Transform, Shade And Draw - NO MALLOC
+ *
+ * Turns pool meshes into clipped triangles for the rasterizer. Every
+ * vertex of a draw is transformed once into a frame-arena buffer
+ * (packed, SoA or MD2 pose), lit in object space (lighting.h), and the
+ * index list is then assembled into Clip_DrawTriangle*() calls. MeshDraw_List() runs
+ * a whole scene buffer draw list through the render queue, so the demo
+ * and the benchmark submit identical work. Repeated static meshes, drawn
+ * through MeshDraw_StaticInstanced() or met back to back in a list, set
+ * up their vertex data once for every copy.
+ */
+
+#ifndef MESHDRAW_H
+#define MESHDRAW_H
+
+#include <stdint.h>
+#include "math3d.h"
+#include "entity.h"
+#include "texture.h"
+#include "scenebuffer.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Static mesh (type 1) detail level lod in one solid color, lit by the
+ * Lighting_SetLights() lights; world places them in object space */
+void MeshDraw_Static(uint32_t mesh_id, const Mat4* mvp, const Mat4* world, uint32_t lod, uint16_t color);
+
+/* One placement of an instanced draw */
+typedef struct {
+    Mat4 world;
+    uint16_t color;
+} MeshInstance_t;
+
+/* count copies of one static mesh level, each with its own world matrix
+ * and color. Instances whose mesh bounds miss the frustum of view_proj
+ * are dropped in one pass (counted as culled entities); the rest share
+ * the mesh lookups, normals, UVs and lighting inputs, decoded once, so
+ * only the transform and lighting run per instance. Returns the number
+ * drawn. */
+uint32_t MeshDraw_StaticInstanced(uint32_t mesh_id, const Mat4* view_proj, const MeshInstance_t* instances,
+    uint32_t count, uint32_t lod);
+
+/* MD2 mesh (type 2) detail level lod between two frames; NULL texture
+ * draws solid blue */
+void MeshDraw_MD2(uint32_t mesh_id, const Mat4* mvp, const Mat4* world, uint32_t lod,
+    uint16_t frame_a, uint16_t frame_b, float lerp, const Texture_t* texture);
+
+/* The same into a render context, e.g. an impostor sprite */
+void MeshDraw_MD2To(RasterContext_t* ctx, uint32_t mesh_id, const Mat4* mvp, const Mat4* world, uint32_t lod,
+    uint16_t frame_a, uint16_t frame_b, float lerp, const Texture_t* texture);
+
+/* Picks a draw's look: solid color for static meshes, texture id
+ * (0xFFFFFFFF = none) for animated ones. Both arrive preset to white
+ * and untextured. */
+typedef void (*MeshDrawMaterial_t)(const DrawCmd_t* cmd, uint16_t* color, uint32_t* texture, void* user);
+
+/* Queue, sort and execute every draw of a list, batched by material and
+ * texture through the texture cache. DRAW_FLAG_TRANSPARENT draws follow
+ * the opaque ones back to front, blended without depth writes; the
+ * shadows of DRAW_FLAG_CAST_SHADOW draws (shadow.h) go in between. */
+void MeshDraw_List(const DrawList_t* list, MeshDrawMaterial_t material, void* user);
+
+/* MeshDraw_List() over the draws with (flags & flag_mask) == flag_value,
+ * e.g. DRAW_FLAG_STATIC, 0 for the moving ones; leaves the list's culled
+ * count to the caller */
+void MeshDraw_ListFiltered(const DrawList_t* list, MeshDrawMaterial_t material, void* user,
+    uint32_t flag_mask, uint32_t flag_value);
+
+/* Depth prepass for the following MeshDraw_List() calls: the opaque
+ * draws go through RASTER_STATE_DEPTH_ONLY first, unlit and untextured,
+ * then shade with every hidden pixel rejected (rasterizer.h). Pays the
+ * opaque transforms and coverage twice to shade each pixel once; ignored
+ * under the visibility buffer. */
+void MeshDraw_SetDepthPrepass(int enabled);
+int MeshDraw_IsDepthPrepass(void);
+
+/* Copy the mesh's object-space bounding sphere into the renderer */
+void MeshDraw_SyncBounds(MeshRenderer_t* mr);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MESHDRAW_H */
@@ -0,0 +1,324 @@
+/**
+ * @file meshlod.cpp
+ * @brief Mesh Detail Levels Implementation
+ */
+
+#include "meshlod.h"
+#include <string.h>
+
+#define LOD_HASH_SIZE       (MESH_LOD_MAX_VERTICES * 2)     /* Power of two, half full at most */
+#define LOD_EMPTY           0xFFFF
+#define LOD_MOVED           0x80                            /* g_lod_level: vertex already permuted */
+
+/* Load-time scratch: per vertex the representative it clusters to at
+ * the level being built, and the coarsest level it represents */
+SDRAM_DATA static uint16_t g_lod_rep[MESH_LOD_MAX_VERTICES];
+SDRAM_DATA static uint8_t g_lod_level[MESH_LOD_MAX_VERTICES];
+SDRAM_DATA static uint16_t g_lod_cells[LOD_HASH_SIZE];
+SDRAM_DATA static uint16_t g_lod_indices[MESH_LOD_MAX_TRIANGLES * 3];
+
+/* Positions to cluster: static SoA, or MD2 frame 0 through the UV pairs */
+typedef struct {
+    const float* x;
+    const float* y;
+    const float* z;
+    const MD2UV_t* pairs;
+    const MD2Vertex_t* verts;
+    const MD2FrameDesc_t* frame;
+    uint32_t count;
+} LodSource_t;
+
+static Vec3 SourcePosition(const LodSource_t* s, uint32_t i)
+{
+    if (s->pairs) {
+        const MD2Vertex_t* v = &s->verts[s->pairs[i].vertex];
+        return Vec3_Create(v->x * s->frame->scale.x + s->frame->translate.x,
+            v->y * s->frame->scale.y + s->frame->translate.y,
+            v->z * s->frame->scale.z + s->frame->translate.z);
+    }
+    return Vec3_Create(s->x[i], s->y[i], s->z[i]);
+}
+
+/* ============================================================
+ * Levels
+ * ============================================================ */
+
+const uint16_t* Mesh_GetLodIndices(const MeshSlot_t* m, uint32_t lod, uint32_t* index_count,
+    uint32_t* vertex_count)
+{
+    const uint16_t* base = Mesh_GetIndices(m);
+    if (!base) return NULL;
+
+    if (m->lod_count <= 1) {
+        *index_count = (m->type == 1) ? m->stat.index_count : m->anim.index_count;
+        *vertex_count = (m->type == 1) ? m->stat.vertex_count : m->anim.uv_count;
+        return base;
+    }
+    const MeshLod_t* l = &m->lods[MIN(lod, m->lod_count - 1u)];
+    *index_count = l->index_count;
+    *vertex_count = l->vertex_count;
+    return base + l->index_offset;
+}
+
+int Mesh_AddLod(uint32_t mesh_id, const uint16_t* indices, uint32_t index_count, float max_radius)
+{
+    MeshSlot_t* m = Mesh_Get(mesh_id);
+    if (!m || (m->flags & MESH_FLAG_BAKED) || m->lod_count >= MESH_MAX_LODS) return 0;
+    if (index_count == 0 || index_count % 3) return 0;
+
+    /* One allocation holds every level: grow it */
+    uint32_t* start = (m->type == 1) ? &m->stat.index_start : &m->anim.index_start;
+    uint32_t total = Mesh_GetIndexTotal(m);
+    uint32_t fresh = AllocIndices(total + index_count);
+    if (fresh == 0xFFFFFFFF) return 0;
+    memcpy(&g_index_pool[fresh], &g_index_pool[*start], total * sizeof(uint16_t));
+    memcpy(&g_index_pool[fresh + total], indices, index_count * sizeof(uint16_t));
+    FreeIndices(*start, total);
+    *start = fresh;
+
+    if (m->lod_count == 0) {
+        MeshLod_t* base = &m->lods[0];
+        base->index_offset = 0;
+        base->index_count = total;
+        base->vertex_count = (m->type == 1) ? m->stat.vertex_count : m->anim.uv_count;
+        base->max_radius = 1e30f;
+        m->lod_count = 1;
+    }
+
+    uint32_t highest = 0;
+    for (uint32_t i = 0; i < index_count; i++) highest = MAX(highest, (uint32_t)indices[i]);
+
+    MeshLod_t* l = &m->lods[m->lod_count++];
+    l->index_offset = total;
+    l->index_count = index_count;
+    l->vertex_count = highest + 1;
+    l->max_radius = max_radius;
+    if (m->flags & MESH_FLAG_FACE_PLANES) Mesh_BuildFacePlanes(mesh_id);
+    return 1;
+}
+
+/* ============================================================
+ * Generation
+ * ============================================================ */
+
+static inline void CellOf(Vec3 p, float inv_cell, int32_t c[3])
+{
+    c[0] = (int32_t)floorf(p.x * inv_cell);
+    c[1] = (int32_t)floorf(p.y * inv_cell);
+    c[2] = (int32_t)floorf(p.z * inv_cell);
+}
+
+static inline uint32_t HashCell(const int32_t c[3])
+{
+    return ((uint32_t)c[0] * 73856093u ^ (uint32_t)c[1] * 19349663u ^ (uint32_t)c[2] * 83492791u) &
+        (LOD_HASH_SIZE - 1);
+}
+
+/* g_lod_rep for every representative of level - 1: the first of them
+ * in its cell */
+static void Cluster(const LodSource_t* src, uint32_t level, float cell)
+{
+    float inv_cell = 1.0f / cell;
+    memset(g_lod_cells, 0xFF, sizeof(g_lod_cells));
+
+    for (uint32_t v = 0; v < src->count; v++) {
+        if (g_lod_level[v] < level - 1) continue;
+
+        int32_t c[3];
+        CellOf(SourcePosition(src, v), inv_cell, c);
+        uint32_t h = HashCell(c);
+        for (;;) {
+            uint16_t e = g_lod_cells[h];
+            if (e == LOD_EMPTY) {
+                g_lod_cells[h] = (uint16_t)v;
+                g_lod_rep[v] = (uint16_t)v;
+                break;
+            }
+            int32_t ec[3];
+            CellOf(SourcePosition(src, e), inv_cell, ec);
+            if (ec[0] == c[0] && ec[1] == c[1] && ec[2] == c[2]) {
+                g_lod_rep[v] = e;
+                break;
+            }
+            h = (h + 1) & (LOD_HASH_SIZE - 1);
+        }
+    }
+}
+
+/* Vertices sorted by the coarsest level they represent, coarsest first,
+ * so every level reads a prefix. Permutes the pool in place along the
+ * cycles of the permutation and rewrites every level's indices. */
+static void ReorderVertices(MeshSlot_t* m)
+{
+    uint32_t n = m->stat.vertex_count;
+    uint32_t start = m->stat.vertex_start;
+
+    uint32_t first[MESH_MAX_LODS + 1] = { 0 };
+    for (uint32_t v = 0; v < n; v++) first[MESH_MAX_LODS - 1 - g_lod_level[v] + 1]++;
+    for (uint32_t k = 1; k <= MESH_MAX_LODS; k++) first[k] += first[k - 1];
+    uint16_t* dest = g_lod_rep;
+    for (uint32_t v = 0; v < n; v++) dest[v] = (uint16_t)first[MESH_MAX_LODS - 1 - g_lod_level[v]]++;
+
+    for (uint32_t s = 0; s < n; s++) {
+        if (g_lod_level[s] & LOD_MOVED) continue;
+        Vertex_t vert = g_vertex_pool[start + s];
+        float x = g_position_x[start + s], y = g_position_y[start + s], z = g_position_z[start + s];
+        uint32_t cur = s;
+        do {
+            uint32_t d = start + dest[cur];
+            Vertex_t tv = g_vertex_pool[d];
+            float tx = g_position_x[d], ty = g_position_y[d], tz = g_position_z[d];
+            g_vertex_pool[d] = vert;
+            g_position_x[d] = x;
+            g_position_y[d] = y;
+            g_position_z[d] = z;
+            vert = tv;
+            x = tx;
+            y = ty;
+            z = tz;
+            g_lod_level[cur] |= LOD_MOVED;
+            cur = dest[cur];
+        } while (cur != s);
+    }
+
+    uint16_t* indices = &g_index_pool[m->stat.index_start];
+    for (uint32_t i = 0; i < Mesh_GetIndexTotal(m); i++) indices[i] = dest[indices[i]];
+    for (uint32_t l = 1; l < m->lod_count; l++) {
+        MeshLod_t* lod = &m->lods[l];
+        uint32_t highest = 0;
+        for (uint32_t i = 0; i < lod->index_count; i++) highest = MAX(highest, (uint32_t)indices[lod->index_offset + i]);
+        lod->vertex_count = highest + 1;
+    }
+}
+
+uint32_t Mesh_GenerateLods(uint32_t mesh_id, uint32_t max_levels)
+{
+    MeshSlot_t* m = Mesh_Get(mesh_id);
+    if (!m || (m->flags & MESH_FLAG_BAKED) || m->lod_count > 1) return m ? Mesh_GetLodCount(m) : 0;
+
+    LodSource_t src;
+    memset(&src, 0, sizeof(src));
+    float radius;
+    if (m->type == 1) {
+        Mesh_GetPositions(m, &src.x, &src.y, &src.z);
+        src.count = m->stat.vertex_count;
+        radius = m->stat.bounds_radius;
+    }
+    else {
+        src.pairs = Mesh_GetUVPairs(m);
+        src.verts = Mesh_GetFrameVertices(m, 0);
+        src.frame = &Mesh_GetFrames(m)[0];
+        src.count = m->anim.uv_count;
+        radius = m->anim.bounds_radius;
+    }
+
+    uint32_t index_count, vertex_count;
+    const uint16_t* base = Mesh_GetLodIndices(m, 0, &index_count, &vertex_count);
+    if (!base || src.count == 0 || src.count > MESH_LOD_MAX_VERTICES) return 1;
+    if (index_count / 3 > MESH_LOD_MAX_TRIANGLES || index_count / 3 <= MESH_LOD_MIN_TRIANGLES) return 1;
+
+    /* Level 1 cells are the mean edge */
+    float edges = 0.0f;
+    for (uint32_t i = 0; i < index_count; i += 3) {
+        Vec3 a = SourcePosition(&src, base[i]);
+        Vec3 b = SourcePosition(&src, base[i + 1]);
+        Vec3 c = SourcePosition(&src, base[i + 2]);
+        edges += Vec3_Length(Vec3_Sub(a, b)) + Vec3_Length(Vec3_Sub(b, c)) + Vec3_Length(Vec3_Sub(c, a));
+    }
+    float cell = edges / (float)index_count;
+    if (cell <= 0.0f) return 1;
+
+    memset(g_lod_level, 0, src.count);
+    uint32_t levels = 1;
+    uint32_t prev_count = index_count;
+    for (; levels < MIN(max_levels, (uint32_t)MESH_MAX_LODS); levels++, cell *= 2.0f) {
+        Cluster(&src, levels, cell);
+
+        /* The previous level's triangles over the new representatives */
+        uint32_t prev_lod_count;
+        const uint16_t* prev = Mesh_GetLodIndices(m, levels - 1, &prev_lod_count, &vertex_count);
+        uint32_t out = 0;
+        for (uint32_t i = 0; i < prev_lod_count; i += 3) {
+            uint16_t a = g_lod_rep[prev[i]], b = g_lod_rep[prev[i + 1]], c = g_lod_rep[prev[i + 2]];
+            if (a == b || b == c || c == a) continue;
+            g_lod_indices[out++] = a;
+            g_lod_indices[out++] = b;
+            g_lod_indices[out++] = c;
+        }
+        if (out / 3 < MESH_LOD_MIN_TRIANGLES || (float)out > MESH_LOD_MIN_REDUCTION * (float)prev_count) break;
+        if (!Mesh_AddLod(mesh_id, g_lod_indices, out, radius * MESH_LOD_ERROR_PIXELS / cell)) break;
+
+        for (uint32_t v = 0; v < src.count; v++) {
+            if (g_lod_level[v] == levels - 1 && g_lod_rep[v] == v) g_lod_level[v] = (uint8_t)levels;
+        }
+        prev_count = out;
+    }
+
+    if (m->type == 1 && levels > 1) {
+        ReorderVertices(m);
+        if (m->flags & MESH_FLAG_PACKED) {
+            m->flags &= ~MESH_FLAG_PACKED;
+            Mesh_PackStatic(mesh_id);
+        }
+    }
+    return levels;
+}
+
+/* ============================================================
+ * Selection
+ * ============================================================ */
+
+float Mesh_ProjectedRadius(const Mat4* view_proj, const Mat4* world, Vec3 center, float radius)
+{
+    if (radius <= 0.0f) return 1e30f;
+
+    const float* w = world->m;
+    float scale_sq = MAX(MAX(w[0] * w[0] + w[1] * w[1] + w[2] * w[2], w[4] * w[4] + w[5] * w[5] + w[6] * w[6]),
+        w[8] * w[8] + w[9] * w[9] + w[10] * w[10]);
+    float r = radius * sqrtf(scale_sq);
+
+    Vec4 c = Mat4_MultiplyVec4(world, Vec4_Create(center.x, center.y, center.z, 1.0f));
+    Vec4 clip = Mat4_MultiplyVec4(view_proj, c);
+    if (clip.w <= r) return 1e30f;
+
+    /* The clip-y row of a perspective view_proj has length cot(fov_y / 2) */
+    const float* vp = view_proj->m;
+    float focal = sqrtf(vp[1] * vp[1] + vp[5] * vp[5] + vp[9] * vp[9]);
+    return r * focal / clip.w * (DISPLAY_HEIGHT * 0.5f);
+}
+
+uint32_t Mesh_SelectLod(const MeshSlot_t* m, float radius_px, uint32_t current)
+{
+    uint32_t count = Mesh_GetLodCount(m);
+    uint32_t lod = MIN(current, count - 1);
+    while (lod > 0 && radius_px > m->lods[lod].max_radius * (1.0f + MESH_LOD_HYSTERESIS)) lod--;
+    while (lod + 1 < count && radius_px < m->lods[lod + 1].max_radius * (1.0f - MESH_LOD_HYSTERESIS)) lod++;
+    return lod;
+}
+
+float Mesh_LodAnimLerp(float lerp, uint32_t lod)
+{
+    if (lod == 0) return lerp;
+    uint32_t steps = MESH_LOD_LERP_STEPS >> (2 * (lod - 1));
+    if (steps == 0) return (lerp < 0.5f) ? 0.0f : 1.0f;
+    return floorf(lerp * (float)steps + 0.5f) / (float)steps;
+}
+
+uint32_t Mesh_SelectAnimLod(float radius_px)
+{
+    uint32_t lod = 0;
+    float limit = MESH_LOD_ANIM_RADIUS;
+    while (lod < MESH_LOD_ANIM_LEVELS && radius_px < limit) {
+        lod++;
+        limit *= 0.5f;
+    }
+    return lod;
+}
+
+uint32_t MeshLod_GetMemPools(MemPool_t* out, uint32_t max)
+{
+    uint32_t n = 0;
+    n = MemMap_Add(out, n, max, "lod cluster scratch", g_lod_cells, sizeof(g_lod_cells), sizeof(g_lod_cells));
+    n = MemMap_Add(out, n, max, "lod index scratch", g_lod_indices, sizeof(g_lod_indices), sizeof(g_lod_indices));
+    return n;
+}
@@ -0,0 +1,92 @@
+/**
+ * @file meshlod.h
+ * @brief Mesh Detail Levels: Generation And Selection - NO MALLOC
+ *
+ * A mesh slot holds up to MESH_MAX_LODS levels (MeshLod_t in mesh.h).
+ * Level 0 is the mesh as loaded; each coarser level is another index
+ * list over the same vertices (static) or UV pairs (MD2), stored after
+ * level 0 in the mesh's one index allocation, so freeing, compaction
+ * and baked images carry it like any other indices. Generation orders
+ * static vertices coarsest first: a level reads, and MeshDraw
+ * transforms, only a prefix of the vertex range.
+ *
+ * Mesh_GenerateLods() simplifies by vertex clustering on a grid that
+ * doubles per level, each level clustering the one before, and takes
+ * the cell size as the level's error. The cooker runs it before baking;
+ * levels may also be authored with Mesh_AddLod(). A level is drawn
+ * while the bounding sphere projects below its max_radius in pixels,
+ * with MESH_LOD_HYSTERESIS either side of each switch so a mesh sitting
+ * on one does not flicker between levels.
+ *
+ * Distant MD2 models also animate coarser: Mesh_LodAnimLerp() snaps the
+ * pose lerp to fewer steps per level, down to whole keyframes, so a
+ * crowd shares a handful of decoded poses in the pose cache. Models
+ * without levels take theirs from Mesh_SelectAnimLod(), one per halving
+ * of the projected radius below MESH_LOD_ANIM_RADIUS.
+ */
+
+#ifndef MESHLOD_H
+#define MESHLOD_H
+
+#include <stdint.h>
+#include "mesh.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MESH_LOD_ERROR_PIXELS   2.0f    /* Generated levels: cell size on screen at the switch */
+#define MESH_LOD_HYSTERESIS     0.15f   /* Switch band, fraction of max_radius */
+#define MESH_LOD_MIN_REDUCTION  0.75f   /* A generated level keeps at most this share of triangles */
+#define MESH_LOD_MIN_TRIANGLES  16      /* Coarsest generated level */
+#define MESH_LOD_LERP_STEPS     8       /* MD2 pose lerp steps at level 1, a quarter per level after */
+#define MESH_LOD_ANIM_RADIUS    48.0f   /* Pixels; smooth MD2 animation above */
+#define MESH_LOD_ANIM_LEVELS    3       /* Coarsest animation level: whole keyframes */
+
+/* Generation scratch limits per mesh: vertices (MD2: UV pairs) and
+ * level 0 triangles */
+#define MESH_LOD_MAX_VERTICES   8192
+#define MESH_LOD_MAX_TRIANGLES  8192
+
+/* Simplified levels for a pool mesh without any, up to max_levels in
+ * all. Call at load or in the cooker, before Mesh_PackStatic() or again
+ * after it: static vertices are reordered. Returns the level count, 1
+ * if nothing was generated (too small, too large or baked). */
+uint32_t Mesh_GenerateLods(uint32_t mesh_id, uint32_t max_levels);
+
+/* Appends an authored level, coarser than the last: indices as level 0
+ * addresses its vertices or UV pairs. 0 if the mesh is baked, full or
+ * the index pool has no room. */
+int Mesh_AddLod(uint32_t mesh_id, const uint16_t* indices, uint32_t index_count, float max_radius);
+
+static inline uint32_t Mesh_GetLodCount(const MeshSlot_t* m)
+{
+    return m->lod_count ? m->lod_count : 1;
+}
+
+/* Indices of a level, clamped to the mesh's coarsest; vertex_count is
+ * how many leading vertices (MD2: UV pairs) they can address */
+const uint16_t* Mesh_GetLodIndices(const MeshSlot_t* m, uint32_t lod, uint32_t* index_count,
+    uint32_t* vertex_count);
+
+/* Radius in display pixels of a bounding sphere (object space) under
+ * world and view_proj; very large when the eye is inside it */
+float Mesh_ProjectedRadius(const Mat4* view_proj, const Mat4* world, Vec3 center, float radius);
+
+/* Level to draw at radius_px, given the one drawn last frame */
+uint32_t Mesh_SelectLod(const MeshSlot_t* m, float radius_px, uint32_t current);
+
+/* MD2 pose lerp coarsened for a level */
+float Mesh_LodAnimLerp(float lerp, uint32_t lod);
+
+/* Animation level for a projected radius in pixels */
+uint32_t Mesh_SelectAnimLod(float radius_px);
+
+/* Generation scratch for MemMap_Print() */
+uint32_t MeshLod_GetMemPools(MemPool_t* out, uint32_t max);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MESHLOD_H */
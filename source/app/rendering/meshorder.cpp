@@ -0,0 +1,248 @@
+/**
+ * @file meshorder.cpp
+ * @brief Triangle And Vertex Order Implementation
+ */
+
+#include "meshorder.h"
+#include "meshlod.h"
+#include <string.h>
+
+#define ORDER_NONE          0xFFFF
+
+/* Load-time scratch. A run of triangles is reordered over its own local
+ * vertex numbers: per local vertex its global one, the triangles around
+ * it (offsets into the adjacency list), its live triangle count and
+ * cache time stamp. */
+SDRAM_DATA static uint16_t g_order_local[MESH_ORDER_MAX_VERTICES];     /* Global -> local, then the remap */
+SDRAM_DATA static uint16_t g_order_global[MESH_ORDER_MAX_TRIANGLES * 3];
+SDRAM_DATA static uint16_t g_order_tris[MESH_ORDER_MAX_TRIANGLES * 3];  /* Local corners */
+SDRAM_DATA static uint32_t g_order_offsets[MESH_ORDER_MAX_TRIANGLES * 3 + 1];
+SDRAM_DATA static uint16_t g_order_adjacency[MESH_ORDER_MAX_TRIANGLES * 3];
+SDRAM_DATA static uint16_t g_order_live[MESH_ORDER_MAX_TRIANGLES * 3];
+SDRAM_DATA static uint32_t g_order_stamp[MESH_ORDER_MAX_VERTICES];
+SDRAM_DATA static uint16_t g_order_dead[MESH_ORDER_MAX_TRIANGLES * 3];
+SDRAM_DATA static uint16_t g_order_candidates[MESH_ORDER_MAX_TRIANGLES * 3];
+SDRAM_DATA static uint8_t g_order_emitted[MESH_ORDER_MAX_TRIANGLES];
+SDRAM_DATA static uint16_t g_order_out[MESH_ORDER_MAX_TRIANGLES * 3];
+
+/* ============================================================
+ * Triangle Order
+ * ============================================================ */
+
+typedef struct {
+    uint32_t time;
+    uint32_t dead_count;
+    uint32_t cursor;            /* Lowest local vertex that may still be live */
+    uint32_t vertex_count;
+} Tipsify_t;
+
+/* The candidate with the most triangles left that will still be cached
+ * after fanning them; else the latest dead end with triangles left;
+ * else the next live vertex in order. -1 when all are emitted. */
+static int32_t NextFan(Tipsify_t* t, uint32_t candidate_count)
+{
+    int32_t best = -1;
+    int32_t best_priority = -1;
+    for (uint32_t i = 0; i < candidate_count; i++) {
+        uint16_t v = g_order_candidates[i];
+        if (g_order_live[v] == 0) continue;
+        int32_t priority = 0;
+        uint32_t age = t->time - g_order_stamp[v];
+        if (age + 2 * g_order_live[v] <= MESH_ORDER_CACHE_SIZE) priority = (int32_t)age;
+        if (priority > best_priority) {
+            best_priority = priority;
+            best = v;
+        }
+    }
+    if (best >= 0) return best;
+
+    while (t->dead_count > 0) {
+        uint16_t v = g_order_dead[--t->dead_count];
+        if (g_order_live[v] > 0) return v;
+    }
+    while (t->cursor < t->vertex_count) {
+        if (g_order_live[t->cursor] > 0) return (int32_t)t->cursor;
+        t->cursor++;
+    }
+    return -1;
+}
+
+/* Reorders tri_count triangles in place */
+static void Tipsify(uint16_t* indices, uint32_t tri_count)
+{
+    uint32_t corners = tri_count * 3;
+
+    /* Local numbers in order of first appearance */
+    for (uint32_t i = 0; i < corners; i++) g_order_local[indices[i]] = ORDER_NONE;
+    uint32_t n = 0;
+    for (uint32_t i = 0; i < corners; i++) {
+        uint16_t v = indices[i];
+        if (g_order_local[v] == ORDER_NONE) {
+            g_order_local[v] = (uint16_t)n;
+            g_order_global[n++] = v;
+        }
+        g_order_tris[i] = g_order_local[v];
+    }
+
+    /* Triangles around each vertex */
+    memset(g_order_live, 0, n * sizeof(uint16_t));
+    for (uint32_t i = 0; i < corners; i++) g_order_live[g_order_tris[i]]++;
+    g_order_offsets[0] = 0;
+    for (uint32_t v = 0; v < n; v++) g_order_offsets[v + 1] = g_order_offsets[v] + g_order_live[v];
+    for (uint32_t i = 0; i < corners; i++) {
+        uint16_t v = g_order_tris[i];
+        g_order_adjacency[g_order_offsets[v + 1] - g_order_live[v]] = (uint16_t)(i / 3);
+        g_order_live[v]--;
+    }
+    for (uint32_t i = 0; i < corners; i++) g_order_live[g_order_tris[i]]++;
+
+    memset(g_order_stamp, 0, n * sizeof(uint32_t));
+    memset(g_order_emitted, 0, tri_count);
+    Tipsify_t t;
+    t.time = MESH_ORDER_CACHE_SIZE + 1;
+    t.dead_count = 0;
+    t.cursor = 0;
+    t.vertex_count = n;
+
+    uint32_t out = 0;
+    int32_t fan = 0;
+    while (fan >= 0) {
+        uint32_t candidate_count = 0;
+        for (uint32_t a = g_order_offsets[fan]; a < g_order_offsets[fan + 1]; a++) {
+            uint32_t tri = g_order_adjacency[a];
+            if (g_order_emitted[tri]) continue;
+            g_order_emitted[tri] = 1;
+            for (uint32_t j = 0; j < 3; j++) {
+                uint16_t v = g_order_tris[tri * 3 + j];
+                g_order_out[out++] = g_order_global[v];
+                g_order_dead[t.dead_count++] = v;
+                g_order_candidates[candidate_count++] = v;
+                g_order_live[v]--;
+                if (t.time - g_order_stamp[v] > MESH_ORDER_CACHE_SIZE) g_order_stamp[v] = t.time++;
+            }
+        }
+        fan = NextFan(&t, candidate_count);
+    }
+    memcpy(indices, g_order_out, corners * sizeof(uint16_t));
+}
+
+/* ============================================================
+ * Vertex Order
+ * ============================================================ */
+
+/* Renumbers in order of first use, coarsest level first so that each
+ * level still reads a prefix; unused vertices go last */
+static void RenumberVertices(MeshSlot_t* m)
+{
+    uint32_t n = m->stat.vertex_count;
+    uint16_t* remap = g_order_local;
+    for (uint32_t v = 0; v < n; v++) remap[v] = ORDER_NONE;
+
+    uint32_t next = 0;
+    for (uint32_t level = Mesh_GetLodCount(m); level-- > 0; ) {
+        uint32_t index_count, vertex_count;
+        const uint16_t* indices = Mesh_GetLodIndices(m, level, &index_count, &vertex_count);
+        for (uint32_t i = 0; i < index_count; i++) {
+            if (remap[indices[i]] == ORDER_NONE) remap[indices[i]] = (uint16_t)next++;
+        }
+        if (level > 0) m->lods[level].vertex_count = next;
+    }
+    for (uint32_t v = 0; v < n; v++) {
+        if (remap[v] == ORDER_NONE) remap[v] = (uint16_t)next++;
+    }
+
+    uint16_t* indices = &g_index_pool[m->stat.index_start];
+    for (uint32_t i = 0; i < Mesh_GetIndexTotal(m); i++) indices[i] = remap[indices[i]];
+
+    /* Along the cycles of the permutation; emitted marks moved slots */
+    Vertex_t* verts = &g_vertex_pool[m->stat.vertex_start];
+    uint8_t* moved = g_order_emitted;
+    memset(moved, 0, n);
+    for (uint32_t s = 0; s < n; s++) {
+        if (moved[s]) continue;
+        Vertex_t carry = verts[s];
+        uint32_t cur = s;
+        do {
+            uint32_t d = remap[cur];
+            Vertex_t next_carry = verts[d];
+            verts[d] = carry;
+            carry = next_carry;
+            moved[cur] = 1;
+            cur = d;
+        } while (cur != s);
+    }
+    Mesh_UpdatePositions(m->stat.vertex_start, n);
+}
+
+int Mesh_OptimizeOrder(uint32_t mesh_id)
+{
+    MeshSlot_t* m = Mesh_Get(mesh_id);
+    if (!m || m->type != 1 || (m->flags & MESH_FLAG_BAKED)) return 0;
+    if (m->stat.vertex_count > MESH_ORDER_MAX_VERTICES) return 0;
+    for (uint32_t level = 0; level < Mesh_GetLodCount(m); level++) {
+        uint32_t index_count, vertex_count;
+        Mesh_GetLodIndices(m, level, &index_count, &vertex_count);
+        if (index_count / 3 > MESH_ORDER_MAX_TRIANGLES) return 0;
+    }
+
+    /* Clusters of level 0 one by one, the coarser levels whole */
+    uint16_t* base = &g_index_pool[m->stat.index_start];
+    uint32_t cluster_count;
+    const MeshCluster_t* clusters = Mesh_GetClusters(m, &cluster_count);
+    if (clusters) {
+        for (uint32_t k = 0; k < cluster_count; k++) Tipsify(&base[clusters[k].first * 3], clusters[k].count);
+    }
+    else {
+        Tipsify(base, m->stat.index_count / 3);
+    }
+    for (uint32_t level = 1; level < Mesh_GetLodCount(m); level++) {
+        Tipsify(&base[m->lods[level].index_offset], m->lods[level].index_count / 3);
+    }
+
+    RenumberVertices(m);
+    if (m->flags & MESH_FLAG_PACKED) {
+        m->flags &= ~MESH_FLAG_PACKED;
+        Mesh_PackStatic(mesh_id);
+    }
+    else if (m->flags & MESH_FLAG_FACE_PLANES) {
+        Mesh_BuildFacePlanes(mesh_id);
+    }
+    return 1;
+}
+
+/* ============================================================
+ * Measurement
+ * ============================================================ */
+
+float Mesh_CacheMissRatio(uint32_t mesh_id, uint32_t lod)
+{
+    const MeshSlot_t* m = Mesh_Get(mesh_id);
+    if (!m || m->type != 1 || m->stat.vertex_count > MESH_ORDER_MAX_VERTICES) return 0.0f;
+
+    uint32_t index_count, vertex_count;
+    const uint16_t* indices = Mesh_GetLodIndices(m, lod, &index_count, &vertex_count);
+    if (!indices || index_count == 0) return 0.0f;
+
+    memset(g_order_stamp, 0, m->stat.vertex_count * sizeof(uint32_t));
+    uint32_t time = MESH_ORDER_CACHE_SIZE + 1;
+    uint32_t misses = 0;
+    for (uint32_t i = 0; i < index_count; i++) {
+        uint16_t v = indices[i];
+        if (time - g_order_stamp[v] > MESH_ORDER_CACHE_SIZE) {
+            g_order_stamp[v] = time++;
+            misses++;
+        }
+    }
+    return (float)misses / (float)(index_count / 3);
+}
+
+uint32_t MeshOrder_GetMemPools(MemPool_t* out, uint32_t max)
+{
+    uint32_t n = 0;
+    n = MemMap_Add(out, n, max, "order adjacency", g_order_adjacency, sizeof(g_order_adjacency),
+        sizeof(g_order_adjacency));
+    n = MemMap_Add(out, n, max, "order offsets", g_order_offsets, sizeof(g_order_offsets), sizeof(g_order_offsets));
+    n = MemMap_Add(out, n, max, "order triangles", g_order_tris, sizeof(g_order_tris), sizeof(g_order_tris));
+    n = MemMap_Add(out, n, max, "order output", g_order_out, sizeof(g_order_out), sizeof(g_order_out));
+    return n;
+}
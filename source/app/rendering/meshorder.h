@@ -0,0 +1,52 @@
+/**
+ * @file meshorder.h
+ * @brief Triangle And Vertex Order For Fetch Locality - NO MALLOC
+ *
+ * Loaders emit triangles in file order and vertices in order of first
+ * appearance in the file, which scatters the reads a draw makes: the
+ * gather of front-facing vertices from g_vertex_pool or g_packed_pool
+ * (SDRAM on the board) and the triangle assembly from the transformed
+ * buffer. Mesh_OptimizeOrder() reorders each run of triangles with
+ * Tipsify (Sander, Nehab and Barczak 2007) against a FIFO of
+ * MESH_ORDER_CACHE_SIZE vertices, then renumbers the vertices in order
+ * of first use, so neighbouring triangles read neighbouring vertices.
+ *
+ * It keeps what the other passes rely on: triangles only move within
+ * a cluster (meshcluster.h) or a detail level, and vertices only within
+ * the bands that make each coarser level read a prefix (meshlod.h), so
+ * it runs last, after Mesh_GenerateLods(), Mesh_PackStatic() and
+ * Mesh_BuildClusters(). The cooker applies it before baking; the demo
+ * also applies it to the OBJ it streams in.
+ */
+
+#ifndef MESHORDER_H
+#define MESHORDER_H
+
+#include <stdint.h>
+#include "mesh.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MESH_ORDER_CACHE_SIZE       16      /* Tipsify FIFO, vertices */
+#define MESH_ORDER_MAX_VERTICES     8192    /* Largest mesh reordered */
+#define MESH_ORDER_MAX_TRIANGLES    8192    /* Largest level reordered */
+
+/* Reorders a static pool mesh as above, packed vertices and face planes
+ * following. Returns 0 (mesh untouched) for MD2, baked and oversized
+ * meshes. */
+int Mesh_OptimizeOrder(uint32_t mesh_id);
+
+/* Vertices transformed per triangle by a FIFO of MESH_ORDER_CACHE_SIZE
+ * drawing a level in index order (ACMR; 0.5 at best, 3 at worst) */
+float Mesh_CacheMissRatio(uint32_t mesh_id, uint32_t lod);
+
+/* Reorder scratch for MemMap_Print() */
+uint32_t MeshOrder_GetMemPools(MemPool_t* out, uint32_t max);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MESHORDER_H */
@@ -0,0 +1,313 @@
+/**
+ * @file microbench.cpp
+ * @brief Kernel Microbenchmarks Implementation
+ */
+
+#include "microbench.h"
+#include "rasterizer.h"
+#include "texture.h"
+#include "mesh.h"
+#include "clear.h"
+#include "platform.h"
+#include <stdio.h>
+#include <string.h>
+
+#define OBJ_GRID        8                   /* Quads per side of the parsed grid */
+#define OBJ_TEXT_BYTES  (16 * 1024)
+
+typedef void (*MicroKernel_t)(uint32_t ops);
+
+/* Results feed this so the compiler cannot drop the work */
+static volatile uint32_t g_sink;
+
+static Texture_t g_tex;
+static uint32_t g_md2_mesh;
+static uint32_t g_triangle_size;            /* Leg length in pixels */
+static char g_obj_text[OBJ_TEXT_BYTES];
+static uint32_t g_obj_size;
+
+/* ============================================================
+ * Kernels
+ * ============================================================ */
+
+static inline uint32_t NextRandom(uint32_t* state)
+{
+    *state = *state * 1664525u + 1013904223u;
+    return *state >> 8;
+}
+
+static void SetVertex(ScreenVertex_t* v, int x, int y, float u, float t)
+{
+    v->x = x * RASTER_SUBPIXEL_SCALE;
+    v->y = y * RASTER_SUBPIXEL_SCALE;
+    v->z = 0.5f;
+    v->w_inv = 1.0f;
+    v->u = u;
+    v->v = t;
+    v->color = 0xFFFF;
+}
+
+/* Right triangles with legs of g_triangle_size, walked over the screen;
+ * the full-screen class covers it with one triangle */
+static void KernelTriangle(uint32_t ops)
+{
+    int size = (int)g_triangle_size;
+    int span_x = (DISPLAY_WIDTH > size) ? DISPLAY_WIDTH - size : 1;
+    int span_y = (DISPLAY_HEIGHT > size) ? DISPLAY_HEIGHT - size : 1;
+    ScreenVertex_t v0, v1, v2;
+
+    for (uint32_t i = 0; i < ops; i++) {
+        int x = 0, y = 0, w = size, h = size;
+        if (size == 0) {
+            w = DISPLAY_WIDTH * 2;
+            h = DISPLAY_HEIGHT * 2;
+        }
+        else {
+            x = (int)(i * 37u) % span_x;
+            y = (int)(i * 23u) % span_y;
+        }
+        SetVertex(&v0, x, y, 0.0f, 0.0f);
+        SetVertex(&v1, x + w, y, 1.0f, 0.0f);
+        SetVertex(&v2, x, y + h, 0.0f, 1.0f);
+        Rasterizer_DrawTriangle(&v0, &v1, &v2, &g_tex);
+    }
+}
+
+/* Diagonal slivers 256 pixels long and 2 wide, the case a bounding-box
+ * walk is worst at */
+static void KernelSliver(uint32_t ops)
+{
+    ScreenVertex_t v0, v1, v2;
+
+    for (uint32_t i = 0; i < ops; i++) {
+        int x = (int)(i * 37u) % (DISPLAY_WIDTH - 258);
+        int y = (int)(i * 23u) % (DISPLAY_HEIGHT - 258);
+        SetVertex(&v0, x, y, 0.0f, 0.0f);
+        SetVertex(&v1, x + 258, y + 256, 1.0f, 1.0f);
+        SetVertex(&v2, x + 256, y + 256, 1.0f, 0.0f);
+        Rasterizer_DrawTriangle(&v0, &v1, &v2, &g_tex);
+    }
+}
+
+static void KernelSampleLinear(uint32_t ops)
+{
+    uint32_t sum = 0;
+    float step = 1.0f / (float)g_tex.width;
+    float u = 0.0f;
+    for (uint32_t i = 0; i < ops; i++) {
+        sum += Texture_Sample(&g_tex, u, 0.5f);
+        u += step;
+    }
+    g_sink = sum;
+}
+
+static void KernelSampleRandom(uint32_t ops)
+{
+    uint32_t sum = 0, state = 1;
+    for (uint32_t i = 0; i < ops; i++) {
+        float u = (float)(NextRandom(&state) & 0xFFFF) * (1.0f / 65536.0f);
+        float v = (float)(NextRandom(&state) & 0xFFFF) * (1.0f / 65536.0f);
+        sum += Texture_Sample(&g_tex, u, v);
+    }
+    g_sink = sum;
+}
+
+static void KernelSampleFixed(uint32_t ops)
+{
+    uint32_t sum = 0, state = 1;
+    for (uint32_t i = 0; i < ops; i++) {
+        sum += Texture_SampleFixed(&g_tex, (int32_t)(NextRandom(&state) & 0xFFFF),
+            (int32_t)(NextRandom(&state) & 0xFFFF));
+    }
+    g_sink = sum;
+}
+
+static void KernelMat4Multiply(uint32_t ops)
+{
+    Mat4 a, b, c;
+    Mat4_RotationY(&a, 0.3f);
+    Mat4_Translation(&b, 1.0f, 2.0f, 3.0f);
+    for (uint32_t i = 0; i < ops; i++) {
+        Mat4_Multiply(&c, &a, &b);
+        b.m[12] = c.m[13];          /* Chain so each multiply is needed */
+    }
+    g_sink = (uint32_t)(int32_t)b.m[12];
+}
+
+/* ops vertices, over consecutive frame pairs */
+static void KernelMD2Vertex(uint32_t ops)
+{
+    MeshSlot_t* mesh = Mesh_Get(g_md2_mesh);
+    uint32_t verts = mesh->anim.verts_per_frame;
+    uint32_t frames = mesh->anim.frame_count;
+    Vec3 pos, norm;
+    float sum = 0.0f;
+
+    for (uint32_t i = 0; i < ops; i++) {
+        uint32_t frame = (i / verts) % frames;
+        Mesh_GetMD2InterpolatedVertex(g_md2_mesh, i % verts, (uint16_t)frame,
+            (uint16_t)((frame + 1) % frames), 0.5f, &pos, &norm);
+        sum += pos.x + norm.y;
+    }
+    g_sink = (uint32_t)(int32_t)sum;
+}
+
+static void KernelOBJParse(uint32_t ops)
+{
+    for (uint32_t i = 0; i < ops; i++) {
+        uint32_t id = Mesh_LoadOBJ(g_obj_text, g_obj_size);
+        if (id != 0xFFFFFFFF) Mesh_Free(id);
+    }
+}
+
+static void KernelClear(uint32_t ops)
+{
+    for (uint32_t i = 0; i < ops; i++) {
+        Rasterizer_Clear((uint16_t)(i * 0x0841));
+        Clear_Wait();
+    }
+}
+
+/* ============================================================
+ * Runner
+ * ============================================================ */
+
+/* (OBJ_GRID + 1)^2 vertices with UVs and normals, OBJ_GRID^2 quads */
+static void BuildOBJText(void)
+{
+    uint32_t n = 0;
+    for (int z = 0; z <= OBJ_GRID; z++) {
+        for (int x = 0; x <= OBJ_GRID; x++) {
+            n += (uint32_t)snprintf(g_obj_text + n, OBJ_TEXT_BYTES - n, "v %.4f %.4f %.4f\nvt %.4f %.4f\nvn 0 1 0\n",
+                x * 0.25f, (float)((x * 7 + z * 3) % 5) * 0.1f, z * 0.25f,
+                (float)x / OBJ_GRID, (float)z / OBJ_GRID);
+        }
+    }
+    for (int z = 0; z < OBJ_GRID; z++) {
+        for (int x = 0; x < OBJ_GRID; x++) {
+            int a = z * (OBJ_GRID + 1) + x + 1;
+            int b = a + OBJ_GRID + 1;
+            n += (uint32_t)snprintf(g_obj_text + n, OBJ_TEXT_BYTES - n,
+                "f %d/%d/%d %d/%d/%d %d/%d/%d %d/%d/%d\n", a, a, a, b, b, b, b + 1, b + 1, b + 1, a + 1, a + 1, a + 1);
+        }
+    }
+    g_obj_size = n;
+}
+
+static uint32_t Time(MicroResult_t* out, uint32_t count, uint32_t max,
+    const char* name, MicroKernel_t kernel, uint32_t ops)
+{
+    if (count >= max) return count;
+
+    kernel(ops);                    /* Warm caches and state */
+    uint64_t best = ~0ull;
+    for (uint32_t r = 0; r < MICRO_REPEATS; r++) {
+        uint64_t start = Profile_Now();
+        kernel(ops);
+        uint64_t ticks = Profile_Now() - start;
+        if (ticks < best) best = ticks;
+    }
+
+    MicroResult_t* res = &out[count];
+    res->name = name;
+    res->ops = ops;
+    res->best_ticks = best;
+    res->ticks_per_op = (float)((double)best / (double)ops);
+    return count + 1;
+}
+
+uint32_t Micro_Run(const MicroAssets_t* assets, MicroResult_t* out, uint32_t max)
+{
+    uint32_t n = 0;
+    int textured = Texture_GetRaster(assets->texture, &g_tex);
+
+    int binning = Rasterizer_IsBinning();
+    uint32_t state = Rasterizer_GetState();
+    Rasterizer_SetBinning(0);
+    Rasterizer_SetState(state & ~(RASTER_STATE_DEPTH_TEST | RASTER_STATE_DEPTH_WRITE));
+
+    if (textured) {
+        g_triangle_size = 1;   n = Time(out, n, max, "tri_1px", KernelTriangle, 4096);
+        g_triangle_size = 16;  n = Time(out, n, max, "tri_16px", KernelTriangle, 1024);
+        g_triangle_size = 256; n = Time(out, n, max, "tri_256px", KernelTriangle, 32);
+        g_triangle_size = 0;   n = Time(out, n, max, "tri_full", KernelTriangle, 4);
+        n = Time(out, n, max, "tri_sliver", KernelSliver, 256);
+    }
+
+    /* Color and depth; deferred to the flush when binning */
+    n = Time(out, n, max, "clear", KernelClear, 8);
+
+    Rasterizer_SetState(state);
+    Rasterizer_SetBinning(binning);
+
+    if (textured) {
+        n = Time(out, n, max, "sample_linear", KernelSampleLinear, 65536);
+        n = Time(out, n, max, "sample_random", KernelSampleRandom, 65536);
+        n = Time(out, n, max, "sample_fixed", KernelSampleFixed, 65536);
+    }
+
+    n = Time(out, n, max, "mat4_multiply", KernelMat4Multiply, 65536);
+
+    g_md2_mesh = assets->md2_mesh;
+    MeshSlot_t* md2 = Mesh_Get(g_md2_mesh);
+    if (md2 && md2->type == 2 && md2->anim.frame_count > 1) {
+        n = Time(out, n, max, "md2_vertex", KernelMD2Vertex, 16384);
+    }
+
+    BuildOBJText();
+    n = Time(out, n, max, "obj_parse", KernelOBJParse, 16);
+    return n;
+}
+
+/* ============================================================
+ * Baselines
+ * ============================================================ */
+
+uint32_t Micro_WriteBaseline(const MicroResult_t* results, uint32_t count,
+    ProfileWrite_t write, void* user)
+{
+    for (uint32_t i = 0; i < count; i++) {
+        char line[64];
+        int len = snprintf(line, sizeof(line), "%s %.3f\n", results[i].name, results[i].ticks_per_op);
+        if (len <= 0) continue;
+        if (len >= (int)sizeof(line)) len = (int)sizeof(line) - 1;
+        write(line, (uint32_t)len, user);
+    }
+    return count;
+}
+
+/* Baseline ticks per op for `name`; negative if the kernel is not listed */
+static float FindBaseline(const char* baseline, const char* name)
+{
+    const char* p = baseline;
+    while (p && *p) {
+        char key[MICRO_NAME_LENGTH];
+        float value;
+        if (sscanf(p, "%23s %f", key, &value) == 2 && strcmp(key, name) == 0) return value;
+        p = strchr(p, '\n');
+        if (p) p++;
+    }
+    return -1.0f;
+}
+
+uint32_t Micro_Report(const MicroResult_t* results, uint32_t count,
+    const char* baseline, float tolerance)
+{
+    uint32_t slower = 0;
+    printf("kernel              ops    ticks/op    baseline   change\n");
+    for (uint32_t i = 0; i < count; i++) {
+        const MicroResult_t* r = &results[i];
+        float base = baseline ? FindBaseline(baseline, r->name) : -1.0f;
+        if (base <= 0.0f) {
+            printf("%-14s %8u %11.2f\n", r->name, (unsigned)r->ops, r->ticks_per_op);
+            continue;
+        }
+
+        float change = r->ticks_per_op / base - 1.0f;
+        int regressed = change > tolerance;
+        if (regressed) slower++;
+        printf("%-14s %8u %11.2f %11.2f  %+6.1f%%%s\n", r->name, (unsigned)r->ops, r->ticks_per_op,
+            base, change * 100.0f, regressed ? "  SLOWER" : "");
+    }
+    return slower;
+}
@@ -0,0 +1,66 @@
+/**
+ * @file microbench.h
+ * @brief Kernel Microbenchmarks With Baseline Comparison - NO MALLOC
+ *
+ * Times isolated hot paths in Profile_Now() ticks, which are cycles on
+ * the Cortex-M7 (DWT CYCCNT) and nanoseconds on SDL_PC. Each kernel runs
+ * a fixed number of operations MICRO_REPEATS times and keeps the fastest
+ * repeat, so interrupts, preemption and cold caches drop out rather than
+ * being averaged in.
+ *
+ * Results can be written as a plain-text baseline ("name ticks_per_op"
+ * per line) and later runs compared against it, flagging kernels that
+ * got slower than the tolerance. A baseline only means something for
+ * the same build on the same machine.
+ *
+ * Triangle kernels draw immediate mode (binning off) with depth testing
+ * off, so they cover setup plus the pixel loop and nothing else; the
+ * rasterizer's state is restored afterwards. They need the rasterizer
+ * bound to a device or framebuffer.
+ */
+
+#ifndef MICROBENCH_H
+#define MICROBENCH_H
+
+#include <stdint.h>
+#include "profile.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MICRO_MAX_RESULTS       24
+#define MICRO_REPEATS           5
+#define MICRO_NAME_LENGTH       24
+
+typedef struct {
+    const char* name;
+    uint32_t ops;               /* Operations per repeat */
+    uint64_t best_ticks;        /* Fastest repeat */
+    float ticks_per_op;
+} MicroResult_t;
+
+/* Assets the kernels run on; 0xFFFFFFFF skips the kernels needing one */
+typedef struct {
+    uint32_t texture;           /* Any loaded texture, sampled and drawn with */
+    uint32_t md2_mesh;
+} MicroAssets_t;
+
+/* Runs every kernel; returns the results written */
+uint32_t Micro_Run(const MicroAssets_t* assets, MicroResult_t* out, uint32_t max);
+
+/* Baseline text for the results; returns the lines written */
+uint32_t Micro_WriteBaseline(const MicroResult_t* results, uint32_t count,
+    ProfileWrite_t write, void* user);
+
+/* Prints every result with its change against `baseline` (NUL-terminated
+ * text from Micro_WriteBaseline, or NULL). Returns the kernels slower
+ * than the baseline by more than tolerance (0.05 = 5%). */
+uint32_t Micro_Report(const MicroResult_t* results, uint32_t count,
+    const char* baseline, float tolerance);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MICROBENCH_H */
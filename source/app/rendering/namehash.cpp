@@ -0,0 +1,84 @@
+/**
+ * @file namehash.cpp
+ * @brief Name Index Implementation
+ */
+
+#include "namehash.h"
+
+/* Home slot: hash scaled onto [0, capacity) */
+static inline uint32_t Home(const NameIndex_t* index, uint32_t hash)
+{
+    return (uint32_t)(((uint64_t)hash * index->capacity) >> 32);
+}
+
+static inline uint32_t Step(const NameIndex_t* index, uint32_t i)
+{
+    return (i + 1 == index->capacity) ? 0 : i + 1;
+}
+
+void NameIndex_Init(NameIndex_t* index, uint32_t* hashes, uint16_t* values, uint32_t capacity)
+{
+    index->hashes = hashes;
+    index->values = values;
+    index->capacity = capacity;
+    NameIndex_Clear(index);
+}
+
+void NameIndex_Clear(NameIndex_t* index)
+{
+    for (uint32_t i = 0; i < index->capacity; i++) {
+        index->hashes[i] = 0;
+        index->values[i] = NAME_INDEX_EMPTY;
+    }
+}
+
+void NameIndex_Insert(NameIndex_t* index, uint32_t hash, uint16_t value)
+{
+    uint32_t i = Home(index, hash);
+    for (uint32_t n = 0; n < index->capacity; n++) {
+        if (index->values[i] == NAME_INDEX_EMPTY) {
+            index->hashes[i] = hash;
+            index->values[i] = value;
+            return;
+        }
+        i = Step(index, i);
+    }
+}
+
+void NameIndex_Remove(NameIndex_t* index, uint32_t hash, uint16_t value)
+{
+    uint32_t i = Home(index, hash);
+    while (index->values[i] != NAME_INDEX_EMPTY) {
+        if (index->hashes[i] == hash && index->values[i] == value) break;
+        i = Step(index, i);
+    }
+    if (index->values[i] == NAME_INDEX_EMPTY) return;
+
+    /* Pull back later entries of the run that may no longer sit past the
+     * hole: those whose home is not cyclically in (hole, j] */
+    uint32_t hole = i;
+    for (uint32_t j = Step(index, hole); index->values[j] != NAME_INDEX_EMPTY; j = Step(index, j)) {
+        uint32_t home = Home(index, index->hashes[j]);
+        int stays = (hole <= j) ? (hole < home && home <= j) : (hole < home || home <= j);
+        if (stays) continue;
+        index->hashes[hole] = index->hashes[j];
+        index->values[hole] = index->values[j];
+        hole = j;
+    }
+    index->hashes[hole] = 0;
+    index->values[hole] = NAME_INDEX_EMPTY;
+}
+
+uint16_t NameIndex_Next(const NameIndex_t* index, uint32_t hash, uint32_t* cursor)
+{
+    uint32_t i = Home(index, hash);
+    for (uint32_t n = 0; n < *cursor; n++) i = Step(index, i);
+
+    while (*cursor < index->capacity && index->values[i] != NAME_INDEX_EMPTY) {
+        (*cursor)++;
+        if (index->hashes[i] == hash) return index->values[i];
+        i = Step(index, i);
+    }
+    *cursor = index->capacity;
+    return NAME_INDEX_EMPTY;
+}
@@ -0,0 +1,82 @@
+/**
+ * @file namehash.h
+ * @brief Interned Name Hashes And Open-Addressing Index - NO MALLOC
+ *
+ * Names of entities and resources are hashed once, when they are given
+ * (32-bit FNV-1a), and kept in a linear-probing table of hash -> slot,
+ * so a lookup probes a few integers instead of running strcmp over
+ * every slot. A table holds at most half its capacity for short probe
+ * runs; removal shifts the run back, so there are no tombstones.
+ *
+ * Different names may share a hash: the *_FindByName functions confirm
+ * the one candidate with strcmp. The *_FindByHash functions trust the
+ * hash and are meant for names hashed at compile time with NAME_HASH()
+ * (C++), where the string is not at hand; hash 0 is never produced.
+ */
+
+#ifndef NAMEHASH_H
+#define NAMEHASH_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define NAME_HASH_BASIS         0x811C9DC5u
+#define NAME_HASH_PRIME         0x01000193u
+#define NAME_INDEX_EMPTY        0xFFFF
+
+static inline uint32_t Name_Hash(const char* s)
+{
+    uint32_t h = NAME_HASH_BASIS;
+    while (*s) h = (h ^ (uint8_t)*s++) * NAME_HASH_PRIME;
+    return h ? h : 1;
+}
+
+/* 64-bit FNV-1a of a file's bytes, for recognising a source loaded
+ * twice; together with the size, equal hashes are taken as equal data */
+static inline uint64_t Name_HashData(const void* data, uint32_t size)
+{
+    const uint8_t* p = (const uint8_t*)data;
+    uint64_t h = 0xCBF29CE484222325ull;
+    for (uint32_t i = 0; i < size; i++) h = (h ^ p[i]) * 0x100000001B3ull;
+    return h;
+}
+
+/* Caller-owned storage of capacity entries each; capacity at least twice
+ * the number of names held */
+typedef struct {
+    uint32_t* hashes;
+    uint16_t* values;
+    uint32_t capacity;
+} NameIndex_t;
+
+void NameIndex_Init(NameIndex_t* index, uint32_t* hashes, uint16_t* values, uint32_t capacity);
+void NameIndex_Clear(NameIndex_t* index);
+void NameIndex_Insert(NameIndex_t* index, uint32_t hash, uint16_t value);
+
+/* Removes the (hash, value) entry if present */
+void NameIndex_Remove(NameIndex_t* index, uint32_t hash, uint16_t value);
+
+/* Values stored under hash, one per call: start with *cursor = 0; returns
+ * NAME_INDEX_EMPTY when there are no more */
+uint16_t NameIndex_Next(const NameIndex_t* index, uint32_t hash, uint32_t* cursor);
+
+#ifdef __cplusplus
+}
+
+#include <type_traits>
+
+/* Compile-time hash of a string literal, equal to Name_Hash() */
+constexpr uint32_t NameHash_Const(const char* s)
+{
+    uint32_t h = NAME_HASH_BASIS;
+    while (*s) h = (h ^ (uint8_t)*s++) * NAME_HASH_PRIME;
+    return h ? h : 1;
+}
+
+#define NAME_HASH(literal)      (std::integral_constant<uint32_t, NameHash_Const(literal)>::value)
+#endif
+
+#endif /* NAMEHASH_H */
@@ -0,0 +1,234 @@
+/**
+ * @file occlusion.cpp
+ * @brief Coarse Occlusion Culling Implementation
+ */
+
+#include "occlusion.h"
+#include "mesh.h"
+#include "clip.h"
+#include "rasterizer.h"
+#include <string.h>
+
+#define OCC_EMPTY           1e30f   /* No occluder: never hides anything */
+#define OCC_BLOCKS_X        (OCCLUSION_WIDTH / OCCLUSION_BLOCK)
+#define OCC_BLOCKS_Y        (OCCLUSION_HEIGHT / OCCLUSION_BLOCK)
+#define SUBPIXEL_HALF       (RASTER_SUBPIXEL_SCALE >> 1)
+
+static float g_depth[OCCLUSION_WIDTH * OCCLUSION_HEIGHT];
+static float g_block_max[OCC_BLOCKS_X * OCC_BLOCKS_Y];
+static ClipVertex_t g_transformed[OCCLUSION_MAX_VERTICES];
+static Mat4 g_view_proj;
+static uint32_t g_occluders = 0;
+static int g_blocks_dirty = 0;
+
+void Occlusion_Begin(const Mat4* view_proj)
+{
+    g_view_proj = *view_proj;
+    g_occluders = 0;
+    g_blocks_dirty = 0;
+    for (uint32_t i = 0; i < OCCLUSION_WIDTH * OCCLUSION_HEIGHT; i++) g_depth[i] = OCC_EMPTY;
+    for (uint32_t i = 0; i < OCC_BLOCKS_X * OCC_BLOCKS_Y; i++) g_block_max[i] = OCC_EMPTY;
+}
+
+uint32_t Occlusion_GetOccluderCount(void)
+{
+    return g_occluders;
+}
+
+/* ============================================================
+ * Occluders
+ * ============================================================ */
+
+/* Nearest depth per covered pixel center. Edge setup and fill rule as
+ * SetupTriangle() in rasterizer.cpp; either winding is accepted. */
+static void RasterDepth(const ScreenVertex_t* v0, const ScreenVertex_t* v1, const ScreenVertex_t* v2)
+{
+    int32_t x0 = v0->x, y0 = v0->y;
+    int32_t x1 = v1->x, y1 = v1->y;
+    int32_t x2 = v2->x, y2 = v2->y;
+    float z0 = v0->z, z1 = v1->z, z2 = v2->z;
+
+    int32_t area = (x1 - x0) * (y2 - y0) - (y1 - y0) * (x2 - x0);
+    if (area == 0) return;
+    if (area < 0) {
+        int32_t t = x1; x1 = x2; x2 = t;
+        t = y1; y1 = y2; y2 = t;
+        float tz = z1; z1 = z2; z2 = tz;
+        area = -area;
+    }
+
+    int minX = Clampi((Min3i(x0, x1, x2) - SUBPIXEL_HALF + RASTER_SUBPIXEL_SCALE - 1) >> RASTER_SUBPIXEL_BITS, 0, OCCLUSION_WIDTH - 1);
+    int maxX = Clampi((Max3i(x0, x1, x2) - SUBPIXEL_HALF) >> RASTER_SUBPIXEL_BITS, -1, OCCLUSION_WIDTH - 1);
+    int minY = Clampi((Min3i(y0, y1, y2) - SUBPIXEL_HALF + RASTER_SUBPIXEL_SCALE - 1) >> RASTER_SUBPIXEL_BITS, 0, OCCLUSION_HEIGHT - 1);
+    int maxY = Clampi((Max3i(y0, y1, y2) - SUBPIXEL_HALF) >> RASTER_SUBPIXEL_BITS, -1, OCCLUSION_HEIGHT - 1);
+    if (minX > maxX || minY > maxY) return;
+
+    int32_t ea[3] = { y1 - y2, y2 - y0, y0 - y1 };
+    int32_t eb[3] = { x2 - x1, x0 - x2, x1 - x0 };
+    int32_t px = (minX << RASTER_SUBPIXEL_BITS) + SUBPIXEL_HALF;
+    int32_t py = (minY << RASTER_SUBPIXEL_BITS) + SUBPIXEL_HALF;
+    int32_t w[3] = {
+        (x2 - x1) * (py - y1) - (y2 - y1) * (px - x1),
+        (x0 - x2) * (py - y2) - (y0 - y2) * (px - x2),
+        (x1 - x0) * (py - y0) - (y1 - y0) * (px - x0)
+    };
+
+    int32_t A[3], B[3], row[3];
+    float inv_area = 1.0f / (float)area;
+    float z_origin = 0.0f, dzdx = 0.0f, dzdy = 0.0f;
+    const float z[3] = { z0, z1, z2 };
+    for (int i = 0; i < 3; i++) {
+        A[i] = ea[i] * RASTER_SUBPIXEL_SCALE;
+        B[i] = eb[i] * RASTER_SUBPIXEL_SCALE;
+        z_origin += (float)w[i] * z[i] * inv_area;
+        dzdx += (float)A[i] * z[i] * inv_area;
+        dzdy += (float)B[i] * z[i] * inv_area;
+        row[i] = w[i] + ((ea[i] > 0 || (ea[i] == 0 && eb[i] > 0)) ? 0 : -1);
+    }
+
+    for (int y = minY; y <= maxY; y++) {
+        int32_t w0 = row[0], w1 = row[1], w2 = row[2];
+        float zx = z_origin + dzdy * (float)(y - minY);
+        float* out = &g_depth[y * OCCLUSION_WIDTH];
+        for (int x = minX; x <= maxX; x++) {
+            if ((w0 | w1 | w2) >= 0 && zx < out[x]) out[x] = zx;
+            w0 += A[0]; w1 += A[1]; w2 += A[2];
+            zx += dzdx;
+        }
+        row[0] += B[0]; row[1] += B[1]; row[2] += B[2];
+    }
+    g_blocks_dirty = 1;
+}
+
+int Occlusion_AddOccluder(uint32_t mesh_id, const Mat4* world)
+{
+    if (g_occluders >= OCCLUSION_MAX_OCCLUDERS) return 0;
+    MeshSlot_t* mesh = Mesh_Get(mesh_id);
+    if (!mesh || mesh->type != 1) return 0;
+
+    uint32_t count = mesh->stat.vertex_count;
+    uint32_t index_count = mesh->stat.index_count;
+    const uint16_t* indices = Mesh_GetIndices(mesh);
+    if (!indices || count > OCCLUSION_MAX_VERTICES) return 0;
+
+    Mat4 mvp;
+    Mat4_Multiply(&mvp, &g_view_proj, world);
+    const PackedVertex_t* packed = Mesh_GetPackedVertices(mesh);
+    if (packed) {
+        Mat4 dequant, packed_mvp;
+        Mesh_GetPackedDequant(&mesh->stat, &dequant);
+        Mat4_Multiply(&packed_mvp, &mvp, &dequant);
+        Clip_TransformQuantized(&packed_mvp, &packed->x, sizeof(PackedVertex_t) / sizeof(int16_t),
+            count, g_transformed);
+    }
+    else {
+        const float *x, *y, *z;
+        Mesh_GetPositions(mesh, &x, &y, &z);
+        if (!x) return 0;
+        Clip_TransformPositions(&mvp, x, y, z, count, g_transformed);
+    }
+
+    for (uint32_t i = 0; i + 2 < index_count; i += 3) {
+        const ClipVertex_t* v0 = &g_transformed[indices[i]];
+        const ClipVertex_t* v1 = &g_transformed[indices[i + 1]];
+        const ClipVertex_t* v2 = &g_transformed[indices[i + 2]];
+        uint32_t c0 = Clip_Outcode(&v0->pos);
+        uint32_t c1 = Clip_Outcode(&v1->pos);
+        uint32_t c2 = Clip_Outcode(&v2->pos);
+        if (c0 & c1 & c2) continue;
+
+        ClipVertex_t poly[CLIP_MAX_VERTS];
+        int n = 3;
+        poly[0] = *v0;
+        poly[1] = *v1;
+        poly[2] = *v2;
+        if (c0 | c1 | c2) {
+            n = Clip_Polygon(poly, 3, c0 | c1 | c2, poly);
+            if (n < 3) continue;
+        }
+
+        ScreenVertex_t sv[CLIP_MAX_VERTS];
+        for (int k = 0; k < n; k++) Clip_ToScreen(&poly[k], OCCLUSION_WIDTH, OCCLUSION_HEIGHT, &sv[k]);
+        for (int k = 2; k < n; k++) RasterDepth(&sv[0], &sv[k - 1], &sv[k]);
+    }
+    g_occluders++;
+    return 1;
+}
+
+/* ============================================================
+ * Queries
+ * ============================================================ */
+
+/* Farthest occluder depth per block, rebuilt once after new occluders */
+static void UpdateBlocks(void)
+{
+    for (int by = 0; by < OCC_BLOCKS_Y; by++) {
+        for (int bx = 0; bx < OCC_BLOCKS_X; bx++) {
+            float m = 0.0f;
+            for (int y = by * OCCLUSION_BLOCK; y < (by + 1) * OCCLUSION_BLOCK; y++) {
+                const float* row = &g_depth[y * OCCLUSION_WIDTH + bx * OCCLUSION_BLOCK];
+                for (int x = 0; x < OCCLUSION_BLOCK; x++) m = MAX(m, row[x]);
+            }
+            g_block_max[by * OCC_BLOCKS_X + bx] = m;
+        }
+    }
+    g_blocks_dirty = 0;
+}
+
+int Occlusion_TestBounds(const Mat4* world, Vec3 center, float radius)
+{
+    if (g_occluders == 0 || radius < 0.0f) return 1;
+    if (g_blocks_dirty) UpdateBlocks();
+
+    Mat4 mvp;
+    Mat4_Multiply(&mvp, &g_view_proj, world);
+
+    /* The box around the sphere: its projection covers the sphere's and
+     * its nearest corner is no farther than the sphere's nearest point */
+    float min_x = 1e30f, min_y = 1e30f, max_x = -1e30f, max_y = -1e30f, min_z = 1e30f;
+    for (int i = 0; i < 8; i++) {
+        Vec4 c = Mat4_MultiplyVec4(&mvp, Vec4_Create(center.x + ((i & 1) ? radius : -radius),
+            center.y + ((i & 2) ? radius : -radius), center.z + ((i & 4) ? radius : -radius), 1.0f));
+        if (c.z < 0.0f || c.w <= 0.0f) return 1;
+        float inv_w = 1.0f / c.w;
+        float sx = (c.x * inv_w * 0.5f + 0.5f) * OCCLUSION_WIDTH;
+        float sy = (1.0f - (c.y * inv_w * 0.5f + 0.5f)) * OCCLUSION_HEIGHT;
+        min_x = MIN(min_x, sx);
+        max_x = MAX(max_x, sx);
+        min_y = MIN(min_y, sy);
+        max_y = MAX(max_y, sy);
+        min_z = MIN(min_z, c.z * inv_w);
+    }
+
+    /* Pixels the rectangle touches, one more each side */
+    if (max_x < 0.0f || max_y < 0.0f || min_x >= OCCLUSION_WIDTH || min_y >= OCCLUSION_HEIGHT) return 1;
+    int x0 = Clampi((int)floorf(min_x) - 1, 0, OCCLUSION_WIDTH - 1);
+    int x1 = Clampi((int)floorf(max_x) + 1, 0, OCCLUSION_WIDTH - 1);
+    int y0 = Clampi((int)floorf(min_y) - 1, 0, OCCLUSION_HEIGHT - 1);
+    int y1 = Clampi((int)floorf(max_y) + 1, 0, OCCLUSION_HEIGHT - 1);
+
+    for (int by = y0 / OCCLUSION_BLOCK; by <= y1 / OCCLUSION_BLOCK; by++) {
+        for (int bx = x0 / OCCLUSION_BLOCK; bx <= x1 / OCCLUSION_BLOCK; bx++) {
+            if (g_block_max[by * OCC_BLOCKS_X + bx] < min_z) continue;
+
+            /* Block has far or empty pixels: look at the ones inside */
+            int ya = MAX(y0, by * OCCLUSION_BLOCK), yb = MIN(y1, by * OCCLUSION_BLOCK + OCCLUSION_BLOCK - 1);
+            int xa = MAX(x0, bx * OCCLUSION_BLOCK), xb = MIN(x1, bx * OCCLUSION_BLOCK + OCCLUSION_BLOCK - 1);
+            for (int y = ya; y <= yb; y++) {
+                const float* row = &g_depth[y * OCCLUSION_WIDTH];
+                for (int x = xa; x <= xb; x++) {
+                    if (row[x] >= min_z) return 1;
+                }
+            }
+        }
+    }
+    return 0;
+}
+
+uint32_t Occlusion_GetMemPools(MemPool_t* out, uint32_t max)
+{
+    uint32_t n = 0;
+    n = MemMap_Add(out, n, max, "occlusion depth", g_depth, sizeof(g_depth), sizeof(g_depth));
+    n = MemMap_Add(out, n, max, "occlusion verts", g_transformed, sizeof(g_transformed), sizeof(g_transformed));
+    return n;
+}
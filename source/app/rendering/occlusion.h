@@ -0,0 +1,59 @@
+/**
+ * @file occlusion.h
+ * @brief Coarse Occlusion Culling Against A Software Depth Buffer - NO MALLOC
+ *
+ * Each frame SceneBuffer_Build() rasterizes the visible mesh renderers
+ * marked occluder, depth only, into an OCCLUSION_WIDTH x OCCLUSION_HEIGHT
+ * buffer with the main rasterizer's half-space edge functions and
+ * top-left rule. Every other candidate draw then projects its bounds to
+ * a screen rectangle and nearest depth and is dropped, before any vertex
+ * work, when every buffer pixel under the rectangle holds a nearer
+ * occluder. An 8x8 block maximum answers most rectangles without
+ * touching pixels, as HiZ does for the framebuffer.
+ *
+ * The test is conservative: the rectangle comes from the box around the
+ * bounding sphere, is widened by one pixel for occluder edges sampled at
+ * pixel centers, and bounds reaching the near plane are always visible.
+ * Occluders should be large, simple static meshes (walls, floors,
+ * terrain). Both windings are rasterized, so single-sided walls occlude
+ * from either side; meshes above OCCLUSION_MAX_VERTICES are skipped.
+ */
+
+#ifndef OCCLUSION_H
+#define OCCLUSION_H
+
+#include <stdint.h>
+#include "math3d.h"
+#include "memmap.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define OCCLUSION_WIDTH         128
+#define OCCLUSION_HEIGHT        64
+#define OCCLUSION_BLOCK         8       /* Block max-depth cell, pixels */
+#define OCCLUSION_MAX_OCCLUDERS 16      /* Per frame; more are ignored */
+#define OCCLUSION_MAX_VERTICES  1024    /* Largest occluder mesh */
+
+/* Clears the buffer for a new view */
+void Occlusion_Begin(const Mat4* view_proj);
+
+/* Rasterizes static mesh mesh_id (type 1, level 0) under world; 0 if it
+ * was skipped (not static, too large, or the occluder budget is spent) */
+int Occlusion_AddOccluder(uint32_t mesh_id, const Mat4* world);
+
+/* 0 when the object-space bounding sphere under world is certainly hidden
+ * by this frame's occluders; radius < 0 (unbounded) is always visible */
+int Occlusion_TestBounds(const Mat4* world, Vec3 center, float radius);
+
+/* Occluders rasterized since Occlusion_Begin() */
+uint32_t Occlusion_GetOccluderCount(void);
+
+uint32_t Occlusion_GetMemPools(MemPool_t* out, uint32_t max);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* OCCLUSION_H */
@@ -0,0 +1,188 @@
+/**
+ * @file overlay.cpp
+ * @brief On-Screen Statistics Overlay Implementation
+ */
+
+#include "overlay.h"
+#include "profile.h"
+#include <stdio.h>
+
+/* 5x7 glyphs for ' '..'Z', one byte per column, bit 0 = top row */
+#define FONT_FIRST      ' '
+#define FONT_LAST       'Z'
+
+static const uint8_t g_font[FONT_LAST - FONT_FIRST + 1][5] = {
+    { 0x00, 0x00, 0x00, 0x00, 0x00 },  /* ' ' */
+    { 0x00, 0x00, 0x00, 0x00, 0x00 },  /* '!' */
+    { 0x00, 0x00, 0x00, 0x00, 0x00 },  /* '"' */
+    { 0x00, 0x00, 0x00, 0x00, 0x00 },  /* '#' */
+    { 0x00, 0x00, 0x00, 0x00, 0x00 },  /* '$' */
+    { 0x23, 0x13, 0x08, 0x64, 0x62 },  /* '%' */
+    { 0x00, 0x00, 0x00, 0x00, 0x00 },  /* '&' */
+    { 0x00, 0x00, 0x00, 0x00, 0x00 },  /* ''' */
+    { 0x00, 0x1C, 0x22, 0x41, 0x00 },  /* '(' */
+    { 0x00, 0x41, 0x22, 0x1C, 0x00 },  /* ')' */
+    { 0x00, 0x00, 0x00, 0x00, 0x00 },  /* '*' */
+    { 0x00, 0x00, 0x00, 0x00, 0x00 },  /* '+' */
+    { 0x00, 0x50, 0x30, 0x00, 0x00 },  /* ',' */
+    { 0x08, 0x08, 0x08, 0x08, 0x08 },  /* '-' */
+    { 0x00, 0x60, 0x60, 0x00, 0x00 },  /* '.' */
+    { 0x20, 0x10, 0x08, 0x04, 0x02 },  /* '/' */
+    { 0x3E, 0x51, 0x49, 0x45, 0x3E },  /* '0' */
+    { 0x00, 0x42, 0x7F, 0x40, 0x00 },  /* '1' */
+    { 0x42, 0x61, 0x51, 0x49, 0x46 },  /* '2' */
+    { 0x21, 0x41, 0x45, 0x4B, 0x31 },  /* '3' */
+    { 0x18, 0x14, 0x12, 0x7F, 0x10 },  /* '4' */
+    { 0x27, 0x45, 0x45, 0x45, 0x39 },  /* '5' */
+    { 0x3C, 0x4A, 0x49, 0x49, 0x30 },  /* '6' */
+    { 0x01, 0x71, 0x09, 0x05, 0x03 },  /* '7' */
+    { 0x36, 0x49, 0x49, 0x49, 0x36 },  /* '8' */
+    { 0x06, 0x49, 0x49, 0x29, 0x1E },  /* '9' */
+    { 0x00, 0x36, 0x36, 0x00, 0x00 },  /* ':' */
+    { 0x00, 0x00, 0x00, 0x00, 0x00 },  /* ';' */
+    { 0x00, 0x00, 0x00, 0x00, 0x00 },  /* '<' */
+    { 0x14, 0x14, 0x14, 0x14, 0x14 },  /* '=' */
+    { 0x00, 0x00, 0x00, 0x00, 0x00 },  /* '>' */
+    { 0x00, 0x00, 0x00, 0x00, 0x00 },  /* '?' */
+    { 0x00, 0x00, 0x00, 0x00, 0x00 },  /* '@' */
+    { 0x7E, 0x11, 0x11, 0x11, 0x7E },  /* 'A' */
+    { 0x7F, 0x49, 0x49, 0x49, 0x36 },  /* 'B' */
+    { 0x3E, 0x41, 0x41, 0x41, 0x22 },  /* 'C' */
+    { 0x7F, 0x41, 0x41, 0x22, 0x1C },  /* 'D' */
+    { 0x7F, 0x49, 0x49, 0x49, 0x41 },  /* 'E' */
+    { 0x7F, 0x09, 0x09, 0x09, 0x01 },  /* 'F' */
+    { 0x3E, 0x41, 0x49, 0x49, 0x7A },  /* 'G' */
+    { 0x7F, 0x08, 0x08, 0x08, 0x7F },  /* 'H' */
+    { 0x00, 0x41, 0x7F, 0x41, 0x00 },  /* 'I' */
+    { 0x20, 0x40, 0x41, 0x3F, 0x01 },  /* 'J' */
+    { 0x7F, 0x08, 0x14, 0x22, 0x41 },  /* 'K' */
+    { 0x7F, 0x40, 0x40, 0x40, 0x40 },  /* 'L' */
+    { 0x7F, 0x02, 0x0C, 0x02, 0x7F },  /* 'M' */
+    { 0x7F, 0x04, 0x08, 0x10, 0x7F },  /* 'N' */
+    { 0x3E, 0x41, 0x41, 0x41, 0x3E },  /* 'O' */
+    { 0x7F, 0x09, 0x09, 0x09, 0x06 },  /* 'P' */
+    { 0x3E, 0x41, 0x51, 0x21, 0x5E },  /* 'Q' */
+    { 0x7F, 0x09, 0x19, 0x29, 0x46 },  /* 'R' */
+    { 0x46, 0x49, 0x49, 0x49, 0x31 },  /* 'S' */
+    { 0x01, 0x01, 0x7F, 0x01, 0x01 },  /* 'T' */
+    { 0x3F, 0x40, 0x40, 0x40, 0x3F },  /* 'U' */
+    { 0x1F, 0x20, 0x40, 0x20, 0x1F },  /* 'V' */
+    { 0x3F, 0x40, 0x38, 0x40, 0x3F },  /* 'W' */
+    { 0x63, 0x14, 0x08, 0x14, 0x63 },  /* 'X' */
+    { 0x07, 0x08, 0x70, 0x08, 0x07 },  /* 'Y' */
+    { 0x61, 0x51, 0x49, 0x45, 0x43 },  /* 'Z' */
+};
+
+#define PANEL_LINES     8
+#define PANEL_COLUMNS   44
+#define PANEL_PAD       4
+
+/* ============================================================
+ * Text
+ * ============================================================ */
+
+static int DrawTextScaled(int x, int y, const char* text, uint16_t color, int scale)
+{
+    for (const char* s = text; *s; s++) {
+        char ch = *s;
+        if (ch >= 'a' && ch <= 'z') ch = (char)(ch - 'a' + 'A');
+        if (ch >= FONT_FIRST && ch <= FONT_LAST) {
+            const uint8_t* glyph = g_font[ch - FONT_FIRST];
+            for (int col = 0; col < 5; col++) {
+                for (int row = 0; row < 7; row++) {
+                    if (glyph[col] & (1 << row)) {
+                        Rasterizer_FillRect(x + col * scale, y + row * scale, scale, scale, color);
+                    }
+                }
+            }
+        }
+        x += 6 * scale;
+    }
+    return x;
+}
+
+int Overlay_DrawText(int x, int y, const char* text, uint16_t color)
+{
+    return DrawTextScaled(x, y, text, color, OVERLAY_SCALE);
+}
+
+/* ============================================================
+ * Panels
+ * ============================================================ */
+
+static uint32_t TicksToMicros(uint32_t ticks)
+{
+    return (uint32_t)((uint64_t)ticks * 1000000u / Profile_TicksPerSecond());
+}
+
+void Overlay_DrawStats(int x, int y, const RasterizerStats_t* stats)
+{
+    Rasterizer_FillRect(x, y, PANEL_COLUMNS * OVERLAY_CHAR_WIDTH + 2 * PANEL_PAD,
+        PANEL_LINES * OVERLAY_LINE_HEIGHT + 2 * PANEL_PAD, COLOR_BLACK);
+    x += PANEL_PAD;
+    y += PANEL_PAD;
+
+    uint32_t tested = stats->pixels_drawn + stats->pixels_depth_rejected;
+    uint32_t us[RASTER_STAGE_COUNT];
+    for (uint32_t s = 0; s < RASTER_STAGE_COUNT; s++) us[s] = TicksToMicros(stats->stage_ticks[s]);
+    uint32_t vertex_us = us[RASTER_STAGE_TRANSFORM] + us[RASTER_STAGE_CLIP] + us[RASTER_STAGE_SETUP];
+    uint32_t pixel_us = us[RASTER_STAGE_RASTER];
+    int width, height;
+    Rasterizer_GetResolution(&width, &height);
+    float overdraw = (float)stats->pixels_drawn / (float)(width * height);
+
+    char line[PANEL_COLUMNS + 1];
+    snprintf(line, sizeof(line), "TRIS %u  CULLED %u  DRAWN %u",
+        stats->triangles_submitted, stats->triangles_culled, stats->triangles_drawn);
+    Overlay_DrawText(x, y, line, COLOR_WHITE);
+    y += OVERLAY_LINE_HEIGHT;
+
+    snprintf(line, sizeof(line), "ENT CULLED %u  CLUSTERS %u  SMALL %u",
+        stats->entities_culled, stats->clusters_culled, stats->triangles_small);
+    Overlay_DrawText(x, y, line, COLOR_WHITE);
+    y += OVERLAY_LINE_HEIGHT;
+
+    snprintf(line, sizeof(line), "BBOX %u  VISITED %u", stats->pixels_bbox, stats->pixels_visited);
+    Overlay_DrawText(x, y, line, COLOR_WHITE);
+    y += OVERLAY_LINE_HEIGHT;
+
+    snprintf(line, sizeof(line), "DEPTH %u/%u PASS  HIZ %u",
+        stats->pixels_drawn, tested, stats->hiz_blocks_culled);
+    Overlay_DrawText(x, y, line, COLOR_WHITE);
+    y += OVERLAY_LINE_HEIGHT;
+
+    snprintf(line, sizeof(line), "OVERDRAW %.2fX  TEXELS %u", overdraw, stats->texels_fetched);
+    Overlay_DrawText(x, y, line, COLOR_WHITE);
+    y += OVERLAY_LINE_HEIGHT;
+
+    snprintf(line, sizeof(line), "US XFORM %u CLIP %u SETUP %u",
+        us[RASTER_STAGE_TRANSFORM], us[RASTER_STAGE_CLIP], us[RASTER_STAGE_SETUP]);
+    Overlay_DrawText(x, y, line, COLOR_CYAN);
+    y += OVERLAY_LINE_HEIGHT;
+
+    snprintf(line, sizeof(line), "US RASTER %u PRESENT %u", pixel_us, us[RASTER_STAGE_PRESENT]);
+    Overlay_DrawText(x, y, line, COLOR_CYAN);
+    y += OVERLAY_LINE_HEIGHT;
+
+    Overlay_DrawText(x, y, (pixel_us >= vertex_us) ? "FILL BOUND" : "VERTEX BOUND", COLOR_YELLOW);
+}
+
+void Overlay_DrawTileHeat(void)
+{
+    const uint32_t layer = TILE_WIDTH * TILE_HEIGHT;
+    for (uint32_t tile = 0; tile < TILE_COUNT; tile++) {
+        uint32_t triangles, pixels;
+        Rasterizer_GetTileStats(tile, &triangles, &pixels);
+        if (triangles == 0 && pixels == 0) continue;
+
+        uint16_t color = (pixels < layer) ? COLOR_GREEN : (pixels < 2 * layer) ? COLOR_YELLOW :
+            (pixels < 4 * layer) ? RGB565(0xFF, 0x80, 0x00) : COLOR_RED;
+        int x = (int)(tile % TILES_X) * TILE_WIDTH;
+        int y = (int)(tile / TILES_X) * TILE_HEIGHT;
+
+        char count[12];
+        snprintf(count, sizeof(count), "%u", triangles);
+        Rasterizer_FillRect(x + 1, y + 1, 4, 9, color);
+        DrawTextScaled(x + 7, y + 2, count, color, 1);
+    }
+}
@@ -0,0 +1,40 @@
+/**
+ * @file overlay.h
+ * @brief On-Screen Statistics Overlay - NO MALLOC
+ *
+ * Text in a built-in 5x7 font and a per-tile heat map, drawn with
+ * Rasterizer_FillRect() once the frame has been resolved, so it never
+ * shows up in the counters it displays. The font covers ' ' to 'Z';
+ * lowercase prints as uppercase, anything else as a blank.
+ */
+
+#ifndef OVERLAY_H
+#define OVERLAY_H
+
+#include <stdint.h>
+#include "rasterizer.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define OVERLAY_SCALE           2                       /* Screen pixels per font pixel */
+#define OVERLAY_CHAR_WIDTH      (6 * OVERLAY_SCALE)
+#define OVERLAY_LINE_HEIGHT     (9 * OVERLAY_SCALE)
+
+/* Returns the x after the last character */
+int Overlay_DrawText(int x, int y, const char* text, uint16_t color);
+
+/* Panel at (x, y) with one frame's counters, overdraw and stage times,
+ * and whether raster or the vertex stages took longer */
+void Overlay_DrawStats(int x, int y, const RasterizerStats_t* stats);
+
+/* Each tile's corner tinted by the pixels drawn in it (green under one
+ * full layer through red at four or more), with its triangle count */
+void Overlay_DrawTileHeat(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* OVERLAY_H */
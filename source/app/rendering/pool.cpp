@@ -0,0 +1,138 @@
+/**
+ * @file pool.cpp
+ * @brief Free-List Range Allocator Implementation
+ */
+
+#include "pool.h"
+
+/* ============================================================
+ * Range Table Helpers
+ * ============================================================ */
+
+static void InsertRange(Pool_t* p, uint32_t at, uint32_t start, uint32_t count)
+{
+    for (uint32_t i = p->range_count; i > at; i--) p->free[i] = p->free[i - 1];
+    p->free[at].start = start;
+    p->free[at].count = count;
+    p->range_count++;
+}
+
+static void RemoveRange(Pool_t* p, uint32_t at)
+{
+    for (uint32_t i = at; i + 1 < p->range_count; i++) p->free[i] = p->free[i + 1];
+    p->range_count--;
+}
+
+/* Removes [start, start + count) from the free table; it must be free */
+static void Claim(Pool_t* p, uint32_t start, uint32_t count)
+{
+    for (uint32_t i = 0; i < p->range_count; i++) {
+        PoolRange_t* r = &p->free[i];
+        if (start < r->start || start + count > r->start + r->count) continue;
+
+        uint32_t tail_start = start + count;
+        uint32_t tail_count = r->start + r->count - tail_start;
+        r->count = start - r->start;
+
+        if (r->count == 0) {
+            if (tail_count > 0) { r->start = tail_start; r->count = tail_count; }
+            else RemoveRange(p, i);
+        }
+        else if (tail_count > 0) {
+            if (p->range_count < POOL_MAX_RANGES) InsertRange(p, i + 1, tail_start, tail_count);
+            else p->free_total -= tail_count;   /* Table full: tail is lost */
+        }
+        p->free_total -= count;
+        return;
+    }
+}
+
+/* ============================================================
+ * Public API
+ * ============================================================ */
+
+void Pool_Init(Pool_t* p, uint32_t capacity)
+{
+    p->capacity = capacity;
+    p->free_total = capacity;
+    p->range_count = 0;
+    if (capacity > 0) InsertRange(p, 0, 0, capacity);
+}
+
+uint32_t Pool_Alloc(Pool_t* p, uint32_t count)
+{
+    if (count == 0) return 0;
+
+    for (uint32_t i = 0; i < p->range_count; i++) {
+        if (p->free[i].count < count) continue;
+        uint32_t start = p->free[i].start;
+        p->free[i].start += count;
+        p->free[i].count -= count;
+        if (p->free[i].count == 0) RemoveRange(p, i);
+        p->free_total -= count;
+        return start;
+    }
+    return 0xFFFFFFFF;
+}
+
+void Pool_Free(Pool_t* p, uint32_t start, uint32_t count)
+{
+    if (count == 0 || start >= p->capacity || count > p->capacity - start) return;
+
+    /* First range after the freed one */
+    uint32_t i = 0;
+    while (i < p->range_count && p->free[i].start < start) i++;
+
+    int join_prev = (i > 0 && p->free[i - 1].start + p->free[i - 1].count == start);
+    int join_next = (i < p->range_count && start + count == p->free[i].start);
+
+    if (join_prev && join_next) {
+        p->free[i - 1].count += count + p->free[i].count;
+        RemoveRange(p, i);
+    }
+    else if (join_prev) {
+        p->free[i - 1].count += count;
+    }
+    else if (join_next) {
+        p->free[i].start = start;
+        p->free[i].count += count;
+    }
+    else if (p->range_count < POOL_MAX_RANGES) {
+        InsertRange(p, i, start, count);
+    }
+    else {
+        return;     /* Table full: the range stays lost until Pool_Init */
+    }
+    p->free_total += count;
+}
+
+int Pool_FirstGap(const Pool_t* p, uint32_t* hole, uint32_t* block)
+{
+    if (p->range_count == 0) return 0;
+    const PoolRange_t* r = &p->free[0];
+    if (r->start + r->count >= p->capacity) return 0;
+    *hole = r->start;
+    *block = r->start + r->count;
+    return 1;
+}
+
+void Pool_Move(Pool_t* p, uint32_t from, uint32_t to, uint32_t count)
+{
+    if (count == 0 || from == to) return;
+    Pool_Free(p, from, count);
+    Claim(p, to, count);
+}
+
+uint32_t Pool_GetFree(const Pool_t* p)
+{
+    return p->free_total;
+}
+
+uint32_t Pool_GetLargestFree(const Pool_t* p)
+{
+    uint32_t largest = 0;
+    for (uint32_t i = 0; i < p->range_count; i++) {
+        if (p->free[i].count > largest) largest = p->free[i].count;
+    }
+    return largest;
+}
@@ -0,0 +1,60 @@
+/**
+ * @file pool.h
+ * @brief Free-List Range Allocator For The Static Resource Pools - NO MALLOC
+ *
+ * Tracks the free ranges of a fixed-size array; the array itself stays
+ * with the module that owns it. Allocation is first fit and freed
+ * ranges coalesce with their neighbours.
+ *
+ * Compaction is incremental and driven by the owner, which is the only
+ * one who knows what lives in a range: Pool_FirstGap() finds the lowest
+ * hole and the block right after it, the owner slides that block down
+ * into the hole and fixes up its offset, then reports it with
+ * Pool_Move(). Repeating this packs every allocation at the front.
+ */
+
+#ifndef POOL_H
+#define POOL_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Free ranges never outnumber allocations + 1 */
+#define POOL_MAX_RANGES         128
+
+typedef struct {
+    uint32_t start;
+    uint32_t count;
+} PoolRange_t;
+
+typedef struct {
+    PoolRange_t free[POOL_MAX_RANGES];  /* Sorted by start, never adjacent */
+    uint32_t range_count;
+    uint32_t capacity;
+    uint32_t free_total;
+} Pool_t;
+
+void Pool_Init(Pool_t* p, uint32_t capacity);
+
+/* First fit; 0xFFFFFFFF if no free range is large enough */
+uint32_t Pool_Alloc(Pool_t* p, uint32_t count);
+void Pool_Free(Pool_t* p, uint32_t start, uint32_t count);
+
+/* 1 and the lowest hole plus the start of the block that follows it;
+ * 0 once the pool is compact */
+int Pool_FirstGap(const Pool_t* p, uint32_t* hole, uint32_t* block);
+
+/* Records that the owner moved [from, from + count) down to `to` */
+void Pool_Move(Pool_t* p, uint32_t from, uint32_t to, uint32_t count);
+
+uint32_t Pool_GetFree(const Pool_t* p);
+uint32_t Pool_GetLargestFree(const Pool_t* p);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* POOL_H */
@@ -0,0 +1,180 @@
+/**
+ * @file power.cpp
+ * @brief Frame-Budget-Aware Clock Scaling Implementation
+ */
+
+#include "power.h"
+#include "profile.h"
+#include <string.h>
+
+#ifndef SDL_PC
+#include "stm32h7xx.h"
+#endif
+
+typedef struct {
+    uint32_t shift;             /* Core clock is the startup clock >> shift */
+    uint32_t vos;               /* Voltage scale, 0 (highest) to 3 */
+} PowerPoint_t;
+
+static const PowerPoint_t g_points[POWER_LEVELS] = {
+    { 0, 0 },
+    { 1, 2 },
+    { 2, 3 },
+};
+
+static int g_enabled = 0;
+static uint64_t g_window_max = 0;       /* Most work in the current window, ticks */
+static uint32_t g_window_frames = 0;
+static PowerStats_t g_power_stats;
+
+/* ============================================================
+ * Operating Points
+ * ============================================================ */
+
+#ifndef SDL_PC
+
+static uint32_t g_startup_hz;
+static uint32_t g_ahb_div;
+
+static inline void WaitVoltage(void)
+{
+    while (!(PWR->D3CR & PWR_D3CR_VOSRDY)) {}
+}
+
+/* VOS0 is VOS1 with the overdrive on top; it has to be left first and
+ * entered last */
+static void SetVoltage(uint32_t vos)
+{
+    if (vos != 0 && (SYSCFG->PWRCR & SYSCFG_PWRCR_ODEN)) {
+        SYSCFG->PWRCR &= ~SYSCFG_PWRCR_ODEN;
+        WaitVoltage();
+    }
+    uint32_t bits = (vos == 0) ? 3 : 4 - vos;   /* VOS1 = 11b, VOS2 = 10b, VOS3 = 01b */
+    PWR->D3CR = (PWR->D3CR & ~PWR_D3CR_VOS) | (bits << PWR_D3CR_VOS_Pos);
+    WaitVoltage();
+    if (vos == 0) {
+        SYSCFG->PWRCR |= SYSCFG_PWRCR_ODEN;
+        WaitVoltage();
+    }
+}
+
+static void SetCoreDivider(uint32_t shift)
+{
+    static const uint32_t prescaler[POWER_LEVELS] = {
+        RCC_D1CFGR_D1CPRE_DIV1, RCC_D1CFGR_D1CPRE_DIV2, RCC_D1CFGR_D1CPRE_DIV4
+    };
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    Profile_SetCycleShift(shift);
+    RCC->D1CFGR = (RCC->D1CFGR & ~RCC_D1CFGR_D1CPRE) | prescaler[shift];
+    __set_PRIMASK(primask);
+
+    SystemCoreClock = g_startup_hz >> shift;
+    Power_PlatformClockChanged(SystemCoreClock, SystemCoreClock / g_ahb_div);
+}
+
+static void PlatformInit(void)
+{
+    static const uint32_t ahb[8] = { 2, 4, 8, 16, 64, 128, 256, 512 };
+    uint32_t hpre = (RCC->D1CFGR & RCC_D1CFGR_HPRE) >> RCC_D1CFGR_HPRE_Pos;
+    g_startup_hz = SystemCoreClock;
+    g_ahb_div = (hpre & 8) ? ahb[hpre & 7] : 1;
+}
+
+/* Slower: clock down, then voltage. Faster: voltage up first. */
+static void PlatformApply(uint32_t from, uint32_t to)
+{
+    if (to > from) {
+        SetCoreDivider(g_points[to].shift);
+        SetVoltage(g_points[to].vos);
+    }
+    else {
+        SetVoltage(g_points[to].vos);
+        SetCoreDivider(g_points[to].shift);
+    }
+    g_power_stats.core_hz = SystemCoreClock;
+}
+
+#else
+
+static void PlatformInit(void)
+{
+}
+
+static void PlatformApply(uint32_t from, uint32_t to)
+{
+    (void)from;
+    (void)to;
+}
+
+#endif
+
+static void Apply(uint32_t level)
+{
+    if (level != g_power_stats.level) {
+        PlatformApply(g_power_stats.level, level);
+        g_power_stats.level = level;
+    }
+    g_window_max = 0;
+    g_window_frames = 0;
+}
+
+/* ============================================================
+ * Policy
+ * ============================================================ */
+
+void Power_Init(void)
+{
+    memset(&g_power_stats, 0, sizeof(g_power_stats));
+    PlatformInit();
+#ifndef SDL_PC
+    g_power_stats.core_hz = SystemCoreClock;
+#endif
+    g_enabled = 0;
+    Apply(0);
+}
+
+void Power_SetEnabled(int enabled)
+{
+    g_enabled = enabled ? 1 : 0;
+    Apply(0);
+}
+
+int Power_IsEnabled(void)
+{
+    return g_enabled;
+}
+
+void Power_Update(uint64_t budget, uint64_t work_ticks)
+{
+    uint32_t level = g_power_stats.level;
+    g_power_stats.frames[level]++;
+    if (!g_enabled) return;
+
+    if (budget == 0 || (float)work_ticks > (float)budget * POWER_RAISE) {
+        if (level != 0) g_power_stats.raises++;
+        Apply(0);
+        return;
+    }
+
+    if (work_ticks > g_window_max) g_window_max = work_ticks;
+    if (++g_window_frames < POWER_WINDOW_FRAMES) return;
+
+    /* Work scales with the core clock; memory-bound parts scale less,
+     * which only makes the prediction conservative */
+    if (level + 1 < POWER_LEVELS) {
+        uint64_t predicted = g_window_max << (g_points[level + 1].shift - g_points[level].shift);
+        if ((float)predicted < (float)budget * POWER_HEADROOM) {
+            g_power_stats.drops++;
+            Apply(level + 1);
+            return;
+        }
+    }
+    g_window_max = 0;
+    g_window_frames = 0;
+}
+
+void Power_GetStats(PowerStats_t* stats)
+{
+    *stats = g_power_stats;
+}
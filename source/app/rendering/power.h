@@ -0,0 +1,80 @@
+/**
+ * @file power.h
+ * @brief Frame-Budget-Aware Clock Scaling
+ *
+ * A frame that finishes early already sleeps: FramePacer_EndFrame()
+ * waits in WFI for the LTDC refresh. Sleeping only gates the clock, so a
+ * frame's work still costs the same energy at full voltage. Power_Update()
+ * looks at the work the pacer measured against the frame budget and,
+ * once POWER_WINDOW_FRAMES frames in a row would still have fitted in
+ * POWER_HEADROOM of the budget at the next slower operating point, drops
+ * to it: a lower core clock and the lower core voltage that clock allows.
+ * Any frame over POWER_RAISE of the budget goes back to full clock at
+ * once, before the following frames miss their deadlines, and the window
+ * starts over.
+ *
+ * Operating points (board, from 480 MHz core and 240 MHz AHB at VOS0):
+ *   0   480 / 240 MHz   VOS0
+ *   1   240 / 120 MHz   VOS2
+ *   2   120 /  60 MHz   VOS3
+ * Only the D1 core prescaler changes: flash wait states stay at the
+ * startup setting, which covers every slower point. Peripherals clocked
+ * from the AHB/APB buses see the change through
+ * Power_PlatformClockChanged(); SDRAM, LTDC and the UARTs should take
+ * their kernel clocks from PLL2/PLL3 so they do not need to.
+ * Profile_Now() keeps counting at the full clock's rate throughout.
+ *
+ * On SDL_PC the levels are picked the same way but nothing changes.
+ * With dynamic resolution on, it fills the budget first; the clock only
+ * drops once the resolution is at its maximum.
+ */
+
+#ifndef POWER_H
+#define POWER_H
+
+#include <stdint.h>
+#include "engine_config.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define POWER_LEVELS            3
+#define POWER_WINDOW_FRAMES     60      /* Frames of evidence before a step down */
+#define POWER_HEADROOM          0.7f    /* Share of the budget the next level must fit */
+#define POWER_RAISE             0.85f   /* Work above this share of the budget goes to full clock */
+
+typedef struct {
+    uint32_t level;             /* 0 = full clock */
+    uint32_t core_hz;           /* 0 on SDL_PC */
+    uint32_t drops;
+    uint32_t raises;
+    uint32_t frames[POWER_LEVELS];  /* Frames spent at each level */
+} PowerStats_t;
+
+/* Starts at full clock, disabled */
+void Power_Init(void);
+
+/* Disabled goes back to full clock and stays there */
+void Power_SetEnabled(int enabled);
+int Power_IsEnabled(void);
+
+/* Feed one finished frame in Profile_Now() ticks: the budget (the pacer
+ * period; 0 when not paced, which holds full clock) and the frame's work
+ * before its wait. Changes the clock; call between frames. */
+void Power_Update(uint64_t budget, uint64_t work_ticks);
+
+void Power_GetStats(PowerStats_t* stats);
+
+#ifndef SDL_PC
+/* The board support re-derives what depends on the bus clocks (SysTick
+ * reload, timer prescalers); called after every change with the new
+ * core and AHB clocks */
+void Power_PlatformClockChanged(uint32_t core_hz, uint32_t hclk_hz);
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* POWER_H */
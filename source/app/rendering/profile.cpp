@@ -0,0 +1,267 @@
+/**
+ * @file profile.cpp
+ * @brief Scoped Zone Profiler Implementation
+ */
+
+#include "profile.h"
+#include <string.h>
+#include <stdio.h>
+#include <atomic>
+
+#ifdef SDL_PC
+#include <chrono>
+#else
+#include "stm32h7xx.h"
+#endif
+
+#define EVENT_MASK      (PROFILE_MAX_EVENTS - 1)
+#define TRACE_LINE      160
+
+PLACE_PROFILE_EVENTS static ProfileEvent_t g_events[PROFILE_MAX_EVENTS];
+static std::atomic<uint32_t> g_head(0);
+
+/* ============================================================
+ * Clock
+ * ============================================================ */
+
+#ifdef SDL_PC
+
+static std::atomic<uint32_t> g_next_thread(0);
+
+/* Small ids in order of each thread's first zone */
+static uint16_t ThreadId(void)
+{
+    static thread_local uint32_t id = 0xFFFFFFFF;
+    if (id == 0xFFFFFFFF) id = g_next_thread.fetch_add(1, std::memory_order_relaxed);
+    return (uint16_t)id;
+}
+
+void Profile_Init(void)
+{
+    ThreadId();
+    Profile_Reset();
+}
+
+uint64_t Profile_Now(void)
+{
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+uint64_t Profile_TicksPerSecond(void)
+{
+    return 1000000000ull;
+}
+
+#else
+
+/* CYCCNT wraps every few seconds at full clock; every read carries it.
+ * Cycles count 1 << g_cycle_shift ticks each while the core runs
+ * divided (power.h), so ticks stay at the full clock's rate. */
+static uint64_t g_ticks;
+static uint32_t g_cycles_last;
+static uint32_t g_cycle_shift;
+static uint32_t g_ticks_per_second;
+
+static inline uint16_t ThreadId(void)
+{
+    return 0;
+}
+
+void Profile_Init(void)
+{
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->LAR = 0xC5ACCE55;      /* Unlock; required on the M7 */
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+    g_ticks = 0;
+    g_cycles_last = 0;
+    g_cycle_shift = 0;
+    g_ticks_per_second = SystemCoreClock;
+    Profile_Reset();
+}
+
+uint64_t Profile_Now(void)
+{
+    /* Zones may close in ISRs: the extension must not be torn */
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    uint32_t now = DWT->CYCCNT;
+    g_ticks += (uint64_t)(now - g_cycles_last) << g_cycle_shift;
+    g_cycles_last = now;
+    uint64_t ticks = g_ticks;
+    __set_PRIMASK(primask);
+    return ticks;
+}
+
+void Profile_SetCycleShift(uint32_t shift)
+{
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    Profile_Now();              /* Cycles so far at the old rate */
+    g_cycle_shift = shift;
+    __set_PRIMASK(primask);
+}
+
+uint64_t Profile_TicksPerSecond(void)
+{
+    return g_ticks_per_second;
+}
+
+#endif
+
+/* ============================================================
+ * Recording
+ * ============================================================ */
+
+void Profile_Record(const char* name, uint64_t start, uint64_t end)
+{
+    uint32_t n = g_head.fetch_add(1, std::memory_order_relaxed);
+    ProfileEvent_t* e = &g_events[n & EVENT_MASK];
+    uint64_t ticks = end - start;
+    e->start = start;
+    e->duration = (ticks > 0xFFFFFFFFull) ? 0xFFFFFFFFu : (uint32_t)ticks;
+    e->thread = ThreadId();
+    e->name = name;
+}
+
+void Profile_Reset(void)
+{
+    memset(g_events, 0, sizeof(g_events));
+    g_head.store(0, std::memory_order_relaxed);
+}
+
+uint32_t Profile_Read(uint32_t* cursor, ProfileEvent_t* out, uint32_t max, uint32_t* lost)
+{
+    uint32_t head = g_head.load(std::memory_order_acquire);
+    uint32_t next = *cursor;
+    if (next > head) next = 0;      /* Reset since the last read */
+    if (head - next > PROFILE_MAX_EVENTS) {
+        *lost += head - next - PROFILE_MAX_EVENTS;
+        next = head - PROFILE_MAX_EVENTS;
+    }
+
+    uint32_t count = 0;
+    for (; next != head && count < max; next++) {
+        const ProfileEvent_t* e = &g_events[next & EVENT_MASK];
+        if (e->name) out[count++] = *e;
+    }
+    *cursor = next;
+    return count;
+}
+
+uint32_t Profile_GetMemPools(MemPool_t* out, uint32_t max)
+{
+    uint32_t recorded = g_head.load(std::memory_order_relaxed);
+    if (recorded > PROFILE_MAX_EVENTS) recorded = PROFILE_MAX_EVENTS;
+    return MemMap_Add(out, 0, max, "profile events", g_events, sizeof(g_events),
+        recorded * (uint32_t)sizeof(ProfileEvent_t));
+}
+
+/* ============================================================
+ * Chrome Trace Export
+ * ============================================================ */
+
+/* Name as a JSON string body; zone names are plain literals, but a
+ * quote or backslash must not break the file */
+static uint32_t EscapeName(char* out, uint32_t max, const char* name)
+{
+    uint32_t n = 0;
+    for (const char* s = name; *s && n + 2 < max; s++) {
+        if (*s == '"' || *s == '\\') out[n++] = '\\';
+        out[n++] = (*s >= ' ') ? *s : '?';
+    }
+    out[n] = 0;
+    return n;
+}
+
+void Profile_TraceBegin(ProfileTrace_t* trace, ProfileWrite_t write, void* user)
+{
+    static const char open_text[] = "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n";
+    trace->write = write;
+    trace->user = user;
+    trace->events = 0;
+    write(open_text, sizeof(open_text) - 1, user);
+}
+
+static void TraceLine(ProfileTrace_t* trace, const char* line, int len)
+{
+    if (len <= 0) return;
+    if (len >= TRACE_LINE) len = TRACE_LINE - 1;
+    trace->write(line, (uint32_t)len, trace->user);
+    trace->events++;
+}
+
+void Profile_TraceZone(ProfileTrace_t* trace, const char* name, uint32_t thread, double ts, double dur)
+{
+    char escaped[64];
+    EscapeName(escaped, sizeof(escaped), name);
+
+    char line[TRACE_LINE];
+    int len = snprintf(line, sizeof(line),
+        "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":0,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+        trace->events ? ",\n" : "", escaped, (unsigned)thread, ts, dur);
+    TraceLine(trace, line, len);
+}
+
+void Profile_TraceCounter(ProfileTrace_t* trace, const char* name, double ts, double value)
+{
+    char escaped[64];
+    EscapeName(escaped, sizeof(escaped), name);
+
+    char line[TRACE_LINE];
+    int len = snprintf(line, sizeof(line),
+        "%s{\"name\":\"%s\",\"ph\":\"C\",\"pid\":0,\"ts\":%.3f,\"args\":{\"value\":%.0f}}",
+        trace->events ? ",\n" : "", escaped, ts, value);
+    TraceLine(trace, line, len);
+}
+
+void Profile_TraceEnd(ProfileTrace_t* trace)
+{
+    static const char close_text[] = "\n]}\n";
+    trace->write(close_text, sizeof(close_text) - 1, trace->user);
+}
+
+uint32_t Profile_WriteTrace(ProfileWrite_t write, void* user)
+{
+    uint32_t head = g_head.load(std::memory_order_acquire);
+    uint32_t count = (head < PROFILE_MAX_EVENTS) ? head : PROFILE_MAX_EVENTS;
+    uint32_t first = head - count;
+
+    /* Timestamps relative to the earliest zone in the ring */
+    uint64_t base = ~0ull;
+    for (uint32_t i = 0; i < count; i++) {
+        const ProfileEvent_t* e = &g_events[(first + i) & EVENT_MASK];
+        if (e->name && e->start < base) base = e->start;
+    }
+    double us_per_tick = 1000000.0 / (double)Profile_TicksPerSecond();
+
+    ProfileTrace_t trace;
+    Profile_TraceBegin(&trace, write, user);
+    for (uint32_t i = 0; i < count; i++) {
+        const ProfileEvent_t* e = &g_events[(first + i) & EVENT_MASK];
+        if (!e->name) continue;
+        Profile_TraceZone(&trace, e->name, e->thread,
+            (double)(e->start - base) * us_per_tick, (double)e->duration * us_per_tick);
+    }
+    Profile_TraceEnd(&trace);
+    return trace.events;
+}
+
+#ifdef SDL_PC
+
+static void WriteFile(const char* text, uint32_t length, void* user)
+{
+    fwrite(text, 1, length, (FILE*)user);
+}
+
+uint32_t Profile_SaveTrace(const char* path)
+{
+    FILE* f = fopen(path, "wb");
+    if (!f) return 0;
+    uint32_t written = Profile_WriteTrace(WriteFile, f);
+    if (fclose(f) != 0) return 0;
+    return written;
+}
+
+#endif
@@ -0,0 +1,122 @@
+/**
+ * @file profile.h
+ * @brief Scoped Zone Profiler With Chrome Trace Export - NO MALLOC
+ *
+ * PROFILE_ZONE("name") times the rest of the enclosing scope. Finished
+ * zones are appended to a fixed ring of PROFILE_MAX_EVENTS entries with
+ * one atomic increment, so any thread (or an ISR on the board) can
+ * record without locks; once full, the oldest zones are overwritten and
+ * the ring always holds the most recent history.
+ *
+ * Timestamps come from std::chrono::steady_clock on SDL_PC and from the
+ * DWT cycle counter (CYCCNT, extended to 64 bits) on the Cortex-M7,
+ * in cycles of the clock at Profile_Init() even while power.h runs the
+ * core divided.
+ * Profile_WriteTrace() emits the ring as Chrome trace JSON, which
+ * chrome://tracing and ui.perfetto.dev open directly.
+ *
+ * Build with PROFILE_ENABLED 0 to compile every zone out.
+ */
+
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include <stdint.h>
+#include "engine_config.h"
+#include "memmap.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef PROFILE_ENABLED
+#define PROFILE_ENABLED         1
+#endif
+#ifndef PROFILE_MAX_EVENTS
+#define PROFILE_MAX_EVENTS      4096    /* Power of two */
+#endif
+
+typedef struct {
+    const char* name;           /* Static string; NULL for an unused entry */
+    uint64_t start;             /* Profile_Now() ticks */
+    uint32_t duration;          /* Ticks */
+    uint16_t thread;            /* Recording thread, 0 = the one that ran Profile_Init() */
+    uint16_t reserved;
+} ProfileEvent_t;
+
+/* Starts the clock (enables DWT on the board); call once at startup */
+void Profile_Init(void);
+
+uint64_t Profile_Now(void);
+uint64_t Profile_TicksPerSecond(void);
+
+#ifndef SDL_PC
+/* The core now runs at the startup clock >> shift; called by power.cpp
+ * around a clock change, so tick durations keep their meaning */
+void Profile_SetCycleShift(uint32_t shift);
+#endif
+
+/* Append one finished zone */
+void Profile_Record(const char* name, uint64_t start, uint64_t end);
+
+/* Drop everything recorded so far */
+void Profile_Reset(void);
+
+/* Zones recorded since *cursor (0 at startup), oldest first, at most
+ * max; advances the cursor past them. Zones the ring overwrote before
+ * they were read are skipped and added to *lost. Same caveat as
+ * Profile_WriteTrace(): call while no zones are closing. */
+uint32_t Profile_Read(uint32_t* cursor, ProfileEvent_t* out, uint32_t max, uint32_t* lost);
+
+uint32_t Profile_GetMemPools(MemPool_t* out, uint32_t max);
+
+/* Receives the trace in pieces; length excludes any terminator */
+typedef void (*ProfileWrite_t)(const char* text, uint32_t length, void* user);
+
+/* Chrome trace JSON of the ring, oldest first. Call while no zones are
+ * closing (between frames, jobs idle). Returns the events written. */
+uint32_t Profile_WriteTrace(ProfileWrite_t write, void* user);
+
+/* Chrome trace JSON written event by event, for zones that did not come
+ * from the ring (e.g. decoded board telemetry). Times in microseconds. */
+typedef struct {
+    ProfileWrite_t write;
+    void* user;
+    uint32_t events;
+} ProfileTrace_t;
+
+void Profile_TraceBegin(ProfileTrace_t* trace, ProfileWrite_t write, void* user);
+void Profile_TraceZone(ProfileTrace_t* trace, const char* name, uint32_t thread, double ts, double dur);
+/* A "C" event: one sample of a counter track */
+void Profile_TraceCounter(ProfileTrace_t* trace, const char* name, double ts, double value);
+void Profile_TraceEnd(ProfileTrace_t* trace);
+
+#ifdef SDL_PC
+/* Profile_WriteTrace() into a file; returns the events written, 0 on error */
+uint32_t Profile_SaveTrace(const char* path);
+#endif
+
+#ifdef __cplusplus
+}
+
+/* Records [construction, destruction) as one zone */
+struct ProfileZone {
+    const char* name;
+    uint64_t start;
+
+    explicit ProfileZone(const char* zone_name) : name(zone_name), start(Profile_Now()) {}
+    ~ProfileZone() { Profile_Record(name, start, Profile_Now()); }
+};
+
+#define PROFILE_CONCAT2(a, b)   a##b
+#define PROFILE_CONCAT(a, b)    PROFILE_CONCAT2(a, b)
+
+#if PROFILE_ENABLED
+#define PROFILE_ZONE(name)      ProfileZone PROFILE_CONCAT(profile_zone_, __LINE__)(name)
+#else
+#define PROFILE_ZONE(name)      ((void)0)
+#endif
+
+#endif /* __cplusplus */
+
+#endif /* PROFILE_H */
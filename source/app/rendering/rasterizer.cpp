@@ -5,20 +5,184 @@
 
 #include "rasterizer.h"
 #include "engine_config.h"
+#include "jobs.h"
+#include "arena.h"
+#include "depth.h"
+#include "clear.h"
+#include "swapchain.h"
+#include "profile.h"
+#include "capture.h"
+#include "fixedpoint.h"
+#include "color.h"
 #include <string.h>
 #include <stdint.h>
 
 #ifdef SDL_PC
 #include "device.h"
 static Device* g_device = NULL;
+/* Binned depth carried across bin-overflow flushes (the board reuses zbuffer) */
+static uint16_t g_overflow_depth[DISPLAY_WIDTH * DISPLAY_HEIGHT];
 #else
 #include "display.h"
- /* Z-buffer in DTCM for fast access */
-DTCM_BSS static uint16_t zbuffer[DISPLAY_WIDTH * DISPLAY_HEIGHT];
-static uint16_t* g_framebuffer = NULL;
+ /* Full-screen Z-buffer for immediate mode. At 1240x680 it does not fit in
+  * DTCM, so it lives in SDRAM; binned mode uses the DTCM tile buffers instead. */
+PLACE_DEPTH_BUFFER static uint16_t zbuffer[DISPLAY_WIDTH * DISPLAY_HEIGHT];
+static uint16_t* const g_overflow_depth = zbuffer;
 #endif
 
-static RasterizerStats_t g_stats;
+/* The screen: the board's back buffer, or the PC Device's color buffer
+ * in the same layout. Binning, heat maps and the other screen-only
+ * features below belong to this context. */
+static RasterContext_t g_default;
+
+#if (TILE_WIDTH % RASTER_BLOCK) || (TILE_HEIGHT % RASTER_BLOCK) || \
+    (DISPLAY_WIDTH % RASTER_BLOCK) || (DISPLAY_HEIGHT % RASTER_BLOCK)
+#error "Tile and display sizes must be multiples of RASTER_BLOCK"
+#endif
+
+DTCM_BSS static uint16_t g_screen_hiz[(DISPLAY_WIDTH / RASTER_BLOCK) * (DISPLAY_HEIGHT / RASTER_BLOCK)];
+
+/* ============================================================
+ * Render Targets
+ * ============================================================ */
+
+/* Destination of the pixel loops: either a tile buffer or the full screen.
+ * Depth is 16-bit, 0 = near plane, smaller wins. */
+typedef struct {
+    uint16_t* color;            /* RGB565 */
+    uint16_t* depth;
+#ifdef SDL_PC
+    void* wide_depth;           /* Device FIXED24/FLOAT32 depth, used instead of depth */
+    int32_t wide_format;
+#endif
+    int32_t stride;             /* Pixels per row of color/depth */
+    int32_t origin_x, origin_y; /* Screen position of color[0] */
+    int32_t min_x, min_y;       /* Inclusive clip rect in screen space */
+    int32_t max_x, max_y;
+    int32_t depth_range;        /* DEPTH_RANGE_* encoding of the 16-bit depth */
+    uint16_t* hiz;              /* Max depth per RASTER_BLOCK cell, NULL = none */
+    int32_t hiz_stride;         /* Cells per row */
+    uint16_t* heat;             /* Screen heat counters, NULL = render normally */
+    int32_t heat_mode;          /* RASTER_HEAT_* the counters are for */
+    uint8_t* shadow_mask;       /* Screen shadow mask, NULL = shadows may darken twice */
+    int32_t perspective_span;   /* Of the owning context */
+    int32_t traversal;
+    RasterizerStats_t* stats;   /* Pixel counters of the owning thread */
+} RasterTarget_t;
+
+/* ============================================================
+ * Tile Binning
+ * ============================================================ */
+
+#define BIN_END 0xFFFF
+
+typedef struct {
+    ScreenVertex_t v[3];
+    Texture_t texture;          /* Copied: callers may pass stack textures */
+    uint16_t color;             /* Flat color for solid triangles */
+    uint8_t solid;
+    uint8_t small;              /* Small-triangle path, see RasterSmall() */
+    uint8_t blend;              /* COLOR_BLEND_* or BLEND_SHADOW, 0 = opaque; see RasterBlend() */
+    uint8_t variant;            /* Pipeline variant key, resolved at submit */
+} BinnedTri_t;
+
+PLACE_BIN_POOL static BinnedTri_t g_bin_tris[MAX_BINNED_TRIANGLES];
+PLACE_BIN_POOL static uint16_t g_bin_ref_tri[MAX_BIN_REFS];
+PLACE_BIN_POOL static uint16_t g_bin_ref_next[MAX_BIN_REFS];
+static uint16_t g_bin_head[TILE_COUNT];
+static uint16_t g_bin_tail[TILE_COUNT];
+static uint32_t g_bin_tri_count = 0;
+static uint32_t g_bin_ref_count = 0;
+
+/* Lines are not binned per tile: every tile clips each one to itself,
+ * which rejects a line that misses it in a few compares */
+typedef struct {
+    int32_t x0, y0, x1, y1;     /* Whole pixels */
+    float z0, z1;
+    uint16_t color;
+    uint8_t depth_test;
+} BinnedLine_t;
+
+PLACE_BIN_POOL static BinnedLine_t g_bin_lines[MAX_BINNED_LINES];
+static uint32_t g_bin_line_count = 0;
+
+/* One tile buffer pair per job thread; STM32 flushes on a single core */
+#ifdef SDL_PC
+#define TILE_THREADS JOB_MAX_THREADS
+#else
+#define TILE_THREADS 1
+#endif
+
+DTCM_BSS static uint16_t g_tile_color[TILE_THREADS][TILE_WIDTH * TILE_HEIGHT];
+DTCM_BSS static uint16_t g_tile_depth[TILE_THREADS][TILE_WIDTH * TILE_HEIGHT];
+DTCM_BSS static uint16_t g_tile_hiz[TILE_THREADS][(TILE_WIDTH / RASTER_BLOCK) * (TILE_HEIGHT / RASTER_BLOCK)];
+static RasterizerStats_t g_thread_stats[TILE_THREADS];
+static uint32_t g_tile_triangles[TILE_COUNT];
+static uint32_t g_tile_pixels[TILE_COUNT];
+
+static uint16_t g_upscale_x[DISPLAY_WIDTH];     /* Source column per screen column */
+
+/* Interlaced fields (Rasterizer_SetInterlace). While a field is open the
+ * default context addresses only its rows, at twice the stride and half
+ * the height; the whole-frame geometry waits here for the resolve. */
+typedef struct {
+    uint16_t* color;
+    void* depth;
+    int32_t height, stride, res_height;
+    uint16_t* hiz;
+    int32_t hiz_stride;
+    uint32_t scissor_count;
+    RasterRect_t scissor[RASTER_MAX_SCISSOR_RECTS];
+} FieldFrame_t;
+
+static int g_interlace = 0;
+static int g_field_open = 0;
+static int g_field_parity = 1;      /* Of the open or last field; the first is even */
+static int32_t g_field_offset = 0;  /* Subpixels added to vertex y while open */
+static FieldFrame_t g_field_frame;
+
+/* Layers (Rasterizer_ClearToLayer): display-sized color and depth, rows
+ * DISPLAY_WIDTH apart. Tiles of the next flush take the layer's color,
+ * those of every flush in the frame its depth; the store takes the
+ * tiles of one flush. A bin-overflow flush stores its depth to
+ * g_overflow_depth, which becomes the layer depth for the rest of the
+ * frame. */
+static const uint16_t* g_layer_color = NULL;
+static const uint16_t* g_layer_depth = NULL;
+static uint16_t* g_store_color = NULL;
+static uint16_t* g_store_depth = NULL;
+static int g_store_overflow = 0;
+
+static int g_binning = 0;
+static int g_visibility = 0;
+static int g_clear_pending = 0;
+static uint16_t g_clear_color = 0;
+
+/* Alternating depth ranges (Rasterizer_SetDepthAlternate). The near half
+ * stores z/2 and smaller wins; the far half stores 1 - z/2 and larger
+ * wins, so every value of one half beats every value of the other. Both
+ * halves clear to the midpoint. */
+#define DEPTH_RANGE_FULL        0
+#define DEPTH_RANGE_NEAR        1
+#define DEPTH_RANGE_FAR         2
+#define DEPTH_RANGE_MID         0x8000
+
+/* Heat map counters, DISPLAY_WIDTH per row, indexed by screen position */
+PLACE_HEAT_BUFFER static uint16_t g_heat[DISPLAY_WIDTH * DISPLAY_HEIGHT];
+static int g_heat_mode = RASTER_HEAT_OFF;      /* Requested */
+static int g_heat_active = RASTER_HEAT_OFF;    /* Of the frame being drawn */
+
+/* Planar shadow mask: a bit per screen pixel, set once the pixel has
+ * been darkened this frame. Rows of bytes, so tiles a multiple of 8
+ * pixels wide never share a byte and flush in parallel. Only the rows
+ * shadows were submitted to are cleared. */
+#if (TILE_WIDTH % 8) || (DISPLAY_WIDTH % 8)
+#error "Tile and display widths must be multiples of 8 for the shadow mask"
+#endif
+#define SHADOW_MASK_STRIDE      (DISPLAY_WIDTH / 8)
+PLACE_SHADOW_MASK static uint8_t g_shadow_mask[SHADOW_MASK_STRIDE * DISPLAY_HEIGHT];
+static int32_t g_shadow_rows_min = DISPLAY_HEIGHT;  /* Rows to clear, empty when min > max */
+static int32_t g_shadow_rows_max = -1;
 
 /* Edge function: positive if point is on left side of edge */
 static inline int32_t EdgeFunction(int32_t v0x, int32_t v0y,
@@ -28,79 +192,600 @@ static inline int32_t EdgeFunction(int32_t v0x, int32_t v0y,
     return (v1x - v0x) * (py - v0y) - (v1y - v0y) * (px - v0x);
 }
 
+/* ============================================================
+ * Triangle Setup
+ * ============================================================ */
+
+#define SUBPIXEL_HALF (RASTER_SUBPIXEL_SCALE >> 1)
+
+/* Edge equations of one triangle over a pixel rectangle. Edge i is
+ * opposite vertex i; values are sampled at pixel centers. */
+typedef struct {
+    int32_t A[3], B[3];     /* Edge deltas per pixel column / per pixel row */
+    int32_t origin[3];      /* Fill-rule biased edge values at (minX, minY) */
+    int32_t bias[3];        /* Bias folded into origin; removed again for interpolation */
+    float inv_area;
+    int minX, minY, maxX, maxY;
+} TriSetup_t;
+
+/* Top-left rule: with y down and positive area, a left edge has A > 0 and
+ * a top edge is horizontal with B > 0. Other edges exclude pixel centers
+ * lying exactly on them, so shared edges are rasterized once. */
+static inline int32_t FillBias(int32_t A, int32_t B)
+{
+    return (A > 0 || (A == 0 && B > 0)) ? 0 : -1;
+}
+
+/* Returns the area (<= 0: back-facing/degenerate) and, for positive area,
+ * fills only s's bounds, clipped to [clip_min, clip_max]. s->minX > s->maxX
+ * or s->minY > s->maxY when no pixel center is in them. No divide. */
+static int32_t SetupBounds(const ScreenVertex_t* v0, const ScreenVertex_t* v1,
+    const ScreenVertex_t* v2, int clip_min_x, int clip_min_y, int clip_max_x, int clip_max_y,
+    TriSetup_t* s)
+{
+    int32_t x0 = v0->x, y0 = v0->y;
+    int32_t x1 = v1->x, y1 = v1->y;
+    int32_t x2 = v2->x, y2 = v2->y;
+
+    int32_t area = EdgeFunction(x0, y0, x1, y1, x2, y2);
+    if (area <= 0) return area;
+
+    /* First/last pixel whose center lies inside the sub-pixel bounds */
+    s->minX = Clampi((Min3i(x0, x1, x2) - SUBPIXEL_HALF + RASTER_SUBPIXEL_SCALE - 1) >> RASTER_SUBPIXEL_BITS, clip_min_x, clip_max_x);
+    s->maxX = Clampi((Max3i(x0, x1, x2) - SUBPIXEL_HALF) >> RASTER_SUBPIXEL_BITS, clip_min_x - 1, clip_max_x);
+    s->minY = Clampi((Min3i(y0, y1, y2) - SUBPIXEL_HALF + RASTER_SUBPIXEL_SCALE - 1) >> RASTER_SUBPIXEL_BITS, clip_min_y, clip_max_y);
+    s->maxY = Clampi((Max3i(y0, y1, y2) - SUBPIXEL_HALF) >> RASTER_SUBPIXEL_BITS, clip_min_y - 1, clip_max_y);
+    return area;
+}
+
+/* SetupBounds() plus the edge equations and 1/area */
+static int32_t SetupTriangle(const ScreenVertex_t* v0, const ScreenVertex_t* v1,
+    const ScreenVertex_t* v2, int clip_min_x, int clip_min_y, int clip_max_x, int clip_max_y,
+    TriSetup_t* s)
+{
+    int32_t area = SetupBounds(v0, v1, v2, clip_min_x, clip_min_y, clip_max_x, clip_max_y, s);
+    if (area <= 0) return area;
+
+    int32_t x0 = v0->x, y0 = v0->y;
+    int32_t x1 = v1->x, y1 = v1->y;
+    int32_t x2 = v2->x, y2 = v2->y;
+    int32_t ea[3] = { y1 - y2, y2 - y0, y0 - y1 };
+    int32_t eb[3] = { x2 - x1, x0 - x2, x1 - x0 };
+
+    int32_t px = (s->minX << RASTER_SUBPIXEL_BITS) + SUBPIXEL_HALF;
+    int32_t py = (s->minY << RASTER_SUBPIXEL_BITS) + SUBPIXEL_HALF;
+    int32_t w[3] = {
+        EdgeFunction(x1, y1, x2, y2, px, py),
+        EdgeFunction(x2, y2, x0, y0, px, py),
+        EdgeFunction(x0, y0, x1, y1, px, py)
+    };
+
+    for (int i = 0; i < 3; i++) {
+        s->A[i] = ea[i] * RASTER_SUBPIXEL_SCALE;
+        s->B[i] = eb[i] * RASTER_SUBPIXEL_SCALE;
+        s->bias[i] = FillBias(ea[i], eb[i]);
+        s->origin[i] = w[i] + s->bias[i];
+    }
+    s->inv_area = 1.0f / (float)area;
+    return area;
+}
+
+/* Pixel (x, y)'s center inside the triangle under the fill rule, as the
+ * edge loops would decide it; positive area only */
+static inline int CoversCenter(const ScreenVertex_t* v0, const ScreenVertex_t* v1,
+    const ScreenVertex_t* v2, int x, int y)
+{
+    int32_t px = (x << RASTER_SUBPIXEL_BITS) + SUBPIXEL_HALF;
+    int32_t py = (y << RASTER_SUBPIXEL_BITS) + SUBPIXEL_HALF;
+    return EdgeFunction(v1->x, v1->y, v2->x, v2->y, px, py) + FillBias(v1->y - v2->y, v2->x - v1->x) >= 0 &&
+        EdgeFunction(v2->x, v2->y, v0->x, v0->y, px, py) + FillBias(v2->y - v0->y, v0->x - v2->x) >= 0 &&
+        EdgeFunction(v0->x, v0->y, v1->x, v1->y, px, py) + FillBias(v0->y - v1->y, v1->x - v0->x) >= 0;
+}
+
+static void ResetBins(void)
+{
+    for (int i = 0; i < TILE_COUNT; i++) {
+        g_bin_head[i] = BIN_END;
+        g_bin_tail[i] = BIN_END;
+    }
+    g_bin_tri_count = 0;
+    g_bin_ref_count = 0;
+    g_bin_line_count = 0;
+}
+
+void RasterContext_Init(RasterContext_t* ctx, uint16_t* color, uint16_t* depth,
+    int width, int height, int stride)
+{
+    memset(ctx, 0, sizeof(*ctx));
+    ctx->color = color;
+    ctx->depth = depth;
+    ctx->depth_format = DEPTH_FORMAT_UNORM16;
+    ctx->width = width;
+    ctx->height = height;
+    ctx->stride = stride;
+    ctx->res_width = width;
+    ctx->res_height = height;
+    ctx->state = RASTER_STATE_DEFAULT;
+    ctx->perspective_span = 1;
+    ctx->traversal = RASTER_TRAVERSAL_DEFAULT;
+    ctx->depth_range = DEPTH_RANGE_FULL;
+}
+
+RasterContext_t* Rasterizer_GetContext(void)
+{
+    return &g_default;
+}
+
 void Rasterizer_Init(void)
 {
 #ifdef SDL_PC
     g_device = NULL;
+    RasterContext_Init(&g_default, NULL, NULL, DISPLAY_WIDTH, DISPLAY_HEIGHT, DISPLAY_WIDTH);
 #else
-    g_framebuffer = NULL;
+    RasterContext_Init(&g_default, NULL, zbuffer, DISPLAY_WIDTH, DISPLAY_HEIGHT, DISPLAY_WIDTH);
+    g_default.hiz = g_screen_hiz;
+    g_default.hiz_stride = DISPLAY_WIDTH / RASTER_BLOCK;
+#endif
+    g_binning = 0;
+    g_clear_pending = 0;
+    g_heat_mode = RASTER_HEAT_OFF;
+    g_heat_active = RASTER_HEAT_OFF;
+    ResetBins();
+#if RASTER_FIXED_POINT
+    Fx_Init();
 #endif
-    memset(&g_stats, 0, sizeof(g_stats));
 }
 
 #ifdef SDL_PC
 void Rasterizer_SetDevice(Device* device)
 {
     g_device = device;
+    if (!device) {
+        g_default.color = NULL;
+        g_default.depth = NULL;
+        return;
+    }
+    g_default.color = device->ColorRow(0);
+    g_default.depth = device->DepthRow(0);
+    g_default.depth_format = device->DepthFormat();
+    g_default.width = device->Width();
+    g_default.height = device->Height();
+    g_default.stride = device->ColorPitch();
+
+    /* Same 16-bit depth as the board; HiZ also needs the display size */
+    int fits = g_default.width == DISPLAY_WIDTH && g_default.height == DISPLAY_HEIGHT &&
+        g_default.depth_format == DEPTH_FORMAT_UNORM16;
+    g_default.hiz = fits ? g_screen_hiz : NULL;
+    g_default.hiz_stride = fits ? DISPLAY_WIDTH / RASTER_BLOCK : 0;
 }
 #else
 void Rasterizer_SetFrameBuffer(uint16_t* fb)
 {
-    g_framebuffer = fb;
+    g_default.color = fb;
 }
 #endif
 
-void Rasterizer_Clear(uint16_t color)
+/* First pixel access of a frame: on STM32 the back buffer may still be
+ * scanned out, or filled by DMA2D. Both return at once when idle. */
+static inline void AcquireTarget(const RasterContext_t* ctx)
+{
+    if (ctx == &g_default) SwapChain_WaitBack();
+    Clear_Wait();
+}
+
+/* 16-bit depth over a rectangle of the context */
+static void FillDepth16(RasterContext_t* ctx, uint16_t value, int x, int y, int w, int h)
+{
+    uint16_t* depth = (uint16_t*)ctx->depth;
+    if (x == 0 && w == ctx->stride) {
+        Clear_Fill16(&depth[y * ctx->stride], value, (uint32_t)(w * h));
+        return;
+    }
+    for (int row = y; row < y + h; row++) Clear_Fill16(&depth[row * ctx->stride + x], value, (uint32_t)w);
+}
+
+/* Immediate-mode clear of the scissor rectangles. The depth range goes
+ * back to full: nothing outside the rectangles is tested until the next
+ * unscissored clear, which is then a real one. */
+static void ClearScissor(RasterContext_t* ctx, uint16_t color)
 {
+    if (!ctx->color || !ctx->depth) return;
+    if (ctx == &g_default) SwapChain_WaitBack();
+    for (uint32_t i = 0; i < ctx->scissor_count; i++) {
+        const RasterRect_t* r = &ctx->scissor[i];
 #ifdef SDL_PC
-    if (!g_device) return;
+        if (ctx->depth_format != DEPTH_FORMAT_UNORM16) {
+            /* Wide depth only comes from the Device, which clears both */
+            g_device->ClearRect(Color(((color >> 11) & 0x1F) << 3, ((color >> 5) & 0x3F) << 2, (color & 0x1F) << 3),
+                r->x, r->y, r->w, r->h);
+            continue;
+        }
+#endif
+        Clear_Start16(&ctx->color[r->y * ctx->stride + r->x], color, r->w, r->h, ctx->stride);
+        FillDepth16(ctx, 0xFFFF, r->x, r->y, r->w, r->h);
+    }
+    ctx->depth_range = DEPTH_RANGE_FULL;
 
-    /* Convert RGB565 to Color */
-    uint8_t r = ((color >> 11) & 0x1F) << 3;
-    uint8_t g = ((color >> 5) & 0x3F) << 2;
-    uint8_t b = (color & 0x1F) << 3;
-    g_device->Clear(Color(r, g, b));
-#else
-    if (!g_framebuffer) return;
+    /* Every HiZ cell the rectangles touch may now hold far depth */
+    if (!ctx->hiz) return;
+    for (uint32_t i = 0; i < ctx->scissor_count; i++) {
+        const RasterRect_t* r = &ctx->scissor[i];
+        int cx0 = r->x / RASTER_BLOCK, cx1 = (r->x + r->w - 1) / RASTER_BLOCK;
+        for (int cy = r->y / RASTER_BLOCK; cy <= (r->y + r->h - 1) / RASTER_BLOCK; cy++) {
+            memset(&ctx->hiz[cy * ctx->hiz_stride + cx0], 0xFF, (cx1 - cx0 + 1) * sizeof(uint16_t));
+        }
+    }
+}
 
-    uint32_t color32 = ((uint32_t)color << 16) | color;
-    uint32_t* fb32 = (uint32_t*)g_framebuffer;
-    int count = (DISPLAY_WIDTH * DISPLAY_HEIGHT) / 2;
+/* Opens the next field on the default context. Field row i is frame row
+ * 2i + p; vertices project at field scale, where that row's center lies
+ * a quarter row below the field center for p = 0 and above it for p = 1,
+ * so they move by the opposite quarter and the edge functions sample the
+ * frame rows exactly. Scissor rectangles keep the field rows they cover. */
+static void BeginField(void)
+{
+    RasterContext_t* ctx = &g_default;
+    FieldFrame_t* f = &g_field_frame;
+    f->color = ctx->color;
+    f->depth = ctx->depth;
+    f->height = ctx->height;
+    f->stride = ctx->stride;
+    f->res_height = ctx->res_height;
+    f->hiz = ctx->hiz;
+    f->hiz_stride = ctx->hiz_stride;
+    f->scissor_count = ctx->scissor_count;
+    memcpy(f->scissor, ctx->scissor, sizeof(f->scissor));
+
+    int p = g_field_parity ^= 1;
+    if (ctx->color) ctx->color += p * ctx->stride;
+    if (ctx->depth) ctx->depth = (uint8_t*)ctx->depth + p * ctx->stride * Depth_FormatBytes(ctx->depth_format);
+    ctx->stride *= 2;
+    ctx->height /= 2;
+    ctx->res_height /= 2;
 
-    for (int i = 0; i < count; i++) {
-        fb32[i] = color32;
+    /* HiZ clears whole cell rows only */
+    if (ctx->height % RASTER_BLOCK) {
+        ctx->hiz = NULL;
+        ctx->hiz_stride = 0;
     }
 
-    Rasterizer_ClearDepth();
-#endif
-    Rasterizer_ResetStats();
+    ctx->scissor_count = 0;
+    for (uint32_t i = 0; i < f->scissor_count; i++) {
+        RasterRect_t r = f->scissor[i];
+        int y0 = (r.y - p + 1) >> 1, y1 = (r.y + r.h - p + 1) >> 1;
+        if (y1 <= y0) continue;
+        r.y = y0;
+        r.h = y1 - y0;
+        ctx->scissor[ctx->scissor_count++] = r;
+    }
+
+    g_field_offset = p ? -(RASTER_SUBPIXEL_SCALE / 4) : RASTER_SUBPIXEL_SCALE / 4;
+    g_field_open = 1;
 }
 
-void Rasterizer_ClearDepth(void)
+static void EndField(void)
 {
-#ifdef SDL_PC
-    if (g_device) {
-        g_device->ClearDepth();  // Actually clear it!
+    RasterContext_t* ctx = &g_default;
+    const FieldFrame_t* f = &g_field_frame;
+    ctx->color = f->color;
+    ctx->depth = f->depth;
+    ctx->height = f->height;
+    ctx->stride = f->stride;
+    ctx->res_height = f->res_height;
+    ctx->hiz = f->hiz;
+    ctx->hiz_stride = f->hiz_stride;
+    ctx->scissor_count = f->scissor_count;
+    memcpy(ctx->scissor, f->scissor, sizeof(f->scissor));
+    g_field_offset = 0;
+    g_field_open = 0;
+}
+
+/* New frame on the screen: last frame's scratch is dead */
+static void BeginScreenFrame(void)
+{
+    Arena_Reset();
+    g_layer_color = NULL;
+    g_layer_depth = NULL;
+
+    g_heat_active = g_heat_mode;
+    if (g_heat_active) memset(g_heat, 0, sizeof(g_heat));
+
+    if (g_shadow_rows_min <= g_shadow_rows_max) {
+        memset(&g_shadow_mask[g_shadow_rows_min * SHADOW_MASK_STRIDE], 0,
+            (size_t)(g_shadow_rows_max - g_shadow_rows_min + 1) * SHADOW_MASK_STRIDE);
+        g_shadow_rows_min = DISPLAY_HEIGHT;
+        g_shadow_rows_max = -1;
+    }
+}
+
+void RasterContext_Clear(RasterContext_t* ctx, uint16_t color)
+{
+    if (ctx == &g_default) {
+        if (g_interlace && !g_field_open) BeginField();
+        if (g_capture_state == CAPTURE_ARMED || Capture_IsRecording()) Capture_OnClear(color);
+        BeginScreenFrame();
+
+        if (g_binning) {
+            /* Resolved per tile in Rasterizer_Flush */
+            ResetBins();
+            g_clear_color = color;
+            g_clear_pending = 1;
+            RasterContext_ResetStats(ctx);
+            return;
+        }
+    }
+
+    if (ctx->scissor_on) {
+        ClearScissor(ctx, color);
+        RasterContext_ResetStats(ctx);
+        return;
     }
-#else
-    uint32_t* zb32 = (uint32_t*)zbuffer;
-    int count = (DISPLAY_WIDTH * DISPLAY_HEIGHT) / 2;
 
-    for (int i = 0; i < count; i++) {
-        zb32[i] = 0xFFFFFFFF;
+    if (!ctx->color || !ctx->depth) return;
+
+    /* DMA2D fill on the board; the first pixel access waits for it */
+    if (ctx == &g_default) SwapChain_WaitBack();
+    Clear_Start16(ctx->color, color, (uint32_t)MIN(ctx->res_width, ctx->width),
+        (uint32_t)MIN(ctx->res_height, ctx->height), (uint32_t)ctx->stride);
+    /* A field's rows last held depth two frames ago, in this frame's half */
+    int alternate = ctx->depth_alternate && ctx->depth_format == DEPTH_FORMAT_UNORM16 &&
+        !(ctx == &g_default && g_field_open);
+
+    if (alternate && ctx->depth_range != DEPTH_RANGE_FULL) {
+        /* Last frame's depth all loses against the other half */
+        ctx->depth_range = (ctx->depth_range == DEPTH_RANGE_NEAR) ? DEPTH_RANGE_FAR : DEPTH_RANGE_NEAR;
+    }
+    else {
+        ctx->depth_range = alternate ? DEPTH_RANGE_NEAR : DEPTH_RANGE_FULL;
+        RasterContext_ClearDepth(ctx);
+    }
+    RasterContext_ResetStats(ctx);
+}
+
+void RasterContext_SetDepthAlternate(RasterContext_t* ctx, int enabled)
+{
+    ctx->depth_alternate = enabled;
+    ctx->depth_range = DEPTH_RANGE_FULL;   /* Next clear is a real one */
+}
+
+void RasterContext_ClearDepth(RasterContext_t* ctx)
+{
+    /* Binned depth is reset per tile on flush */
+    if (ctx == &g_default && g_binning) return;
+    if (!ctx->depth) return;
+
+    uint16_t far16 = (ctx->depth_range == DEPTH_RANGE_FULL) ? 0xFFFF : DEPTH_RANGE_MID;
+    if (ctx->depth_format == DEPTH_FORMAT_UNORM16) {
+        FillDepth16(ctx, far16, 0, 0, ctx->stride, ctx->height);
+    }
+#ifdef SDL_PC
+    else {
+        g_device->ClearDepth();
     }
 #endif
+    if (ctx->hiz) memset(ctx->hiz, 0xFF, (ctx->height / RASTER_BLOCK) * ctx->hiz_stride * sizeof(uint16_t));
+}
+
+void Rasterizer_Clear(uint16_t color) { RasterContext_Clear(&g_default, color); }
+
+/* Whole-screen 16-bit depth and no field: the layer's geometry */
+static int LayerTarget(void)
+{
+    return g_default.color && g_default.depth && g_default.depth_format == DEPTH_FORMAT_UNORM16 && !g_interlace;
+}
+
+int Rasterizer_ClearToLayer(const uint16_t* color, const uint16_t* depth)
+{
+    RasterContext_t* ctx = &g_default;
+    if (!LayerTarget()) return 0;
+    BeginScreenFrame();
+    RasterContext_ResetStats(ctx);
+    ctx->depth_range = DEPTH_RANGE_FULL;
+
+    if (g_binning) {
+        /* Loaded per tile in Rasterizer_Flush */
+        ResetBins();
+        g_clear_pending = 0;
+        g_layer_color = color;
+        g_layer_depth = depth;
+        return 1;
+    }
+
+    int w, h;
+    RasterContext_GetResolution(ctx, &w, &h);
+    SwapChain_WaitBack();
+    Clear_StartCopy16(ctx->color, color, (uint32_t)w, (uint32_t)h, (uint32_t)ctx->stride, DISPLAY_WIDTH);
+    Clear_StartCopy16((uint16_t*)ctx->depth, depth, (uint32_t)w, (uint32_t)h, (uint32_t)ctx->stride, DISPLAY_WIDTH);
+    if (ctx->hiz) memset(ctx->hiz, 0xFF, (ctx->height / RASTER_BLOCK) * ctx->hiz_stride * sizeof(uint16_t));
+    return 1;
+}
+
+int Rasterizer_StoreLayer(uint16_t* color, uint16_t* depth)
+{
+    RasterContext_t* ctx = &g_default;
+    if (!LayerTarget()) return 0;
+
+    if (g_binning) {
+        g_store_color = color;
+        g_store_depth = depth;
+        Rasterizer_Flush();
+        g_store_color = NULL;
+        g_store_depth = NULL;
+
+        /* Binned depth ends with the flush: the rest of the frame tests
+         * against the layer's instead */
+        g_layer_depth = depth;
+        return 1;
+    }
+
+    int w, h;
+    RasterContext_GetResolution(ctx, &w, &h);
+    AcquireTarget(ctx);
+    Clear_StartCopy16(color, ctx->color, (uint32_t)w, (uint32_t)h, DISPLAY_WIDTH, (uint32_t)ctx->stride);
+    Clear_StartCopy16(depth, (const uint16_t*)ctx->depth, (uint32_t)w, (uint32_t)h, DISPLAY_WIDTH, (uint32_t)ctx->stride);
+    Clear_Wait();
+    return 1;
+}
+
+/* Mid-frame flush for full bins. The overflow depth starts as the
+ * frame's depth so far, so tiles the flush skips keep theirs, and later
+ * flushes load it like a layer's. */
+static void FlushOverflow(void)
+{
+    const size_t bytes = DISPLAY_WIDTH * DISPLAY_HEIGHT * sizeof(uint16_t);
+    if (g_layer_depth != g_overflow_depth) {
+        if (g_layer_depth) memcpy(g_overflow_depth, g_layer_depth, bytes);
+        else memset(g_overflow_depth, 0xFF, bytes);
+        g_layer_depth = g_overflow_depth;
+    }
+    g_store_overflow = 1;
+    Rasterizer_Flush();
+    g_store_overflow = 0;
+}
+
+void Rasterizer_ClearDepth(void) { RasterContext_ClearDepth(&g_default); }
+void Rasterizer_SetDepthAlternate(int enabled) { RasterContext_SetDepthAlternate(&g_default, enabled); }
+
+/* ============================================================
+ * Texture Sampling
+ * ============================================================ */
+
+/* 16.16 UVs. The clamp keeps the product in int32; wrapping is exact
+ * for every UV below it since only the low bits survive the mask. */
+static inline int32_t ToFixedUV(float f)
+{
+    f = MIN(MAX(f, -32767.0f), 32767.0f);
+    return (int32_t)(f * (float)TEXTURE_UV_ONE);
+}
+
+/* RGB565 spread to 0x07E0F81F: each channel gets 5 spare bits above it,
+ * so one multiply by a 5-bit weight lerps all three at once */
+static inline uint32_t Expand565(uint16_t c)
+{
+    return ((uint32_t)c | ((uint32_t)c << 16)) & 0x07E0F81Fu;
+}
+
+static inline uint32_t Lerp565(uint32_t a, uint32_t b, uint32_t f)
+{
+    return ((a * (32 - f) + b * f) >> 5) & 0x07E0F81Fu;
+}
+
+/* Power-of-2 sizes make wrapping a mask and the texel index a shift of
+ * the 16.16 coordinate; two's complement wraps negative UVs for free.
+ * Clamping limits the UV to [0, 1) first, after which the same path
+ * applies. Bilinear samples at texel centers with 5-bit weights. */
+template <bool BILINEAR, bool CLAMP>
+static inline uint16_t SampleFixed(const Texture_t* tex, int32_t u, int32_t v)
+{
+    if (CLAMP) {
+        u = Clampi(u, 0, TEXTURE_UV_ONE - 1);
+        v = Clampi(v, 0, TEXTURE_UV_ONE - 1);
+    }
+    uint32_t su = (uint32_t)u << tex->width_shift;
+    uint32_t sv = (uint32_t)v << tex->height_shift;
+
+    if (!BILINEAR) {
+        uint32_t tx = (su >> 16) & tex->width_mask;
+        uint32_t ty = (sv >> 16) & tex->height_mask;
+        return Texture_Fetch(tex->pixels, tex->palette, Texture_TexelOffset(tx, ty, tex->width, tex->tiled), tex->format);
+    }
+
+    su -= TEXTURE_UV_ONE / 2;
+    sv -= TEXTURE_UV_ONE / 2;
+    uint32_t fx = (su >> 11) & 0x1F, fy = (sv >> 11) & 0x1F;
+    int32_t x0 = (int32_t)su >> 16, y0 = (int32_t)sv >> 16;
+    int32_t x1 = x0 + 1, y1 = y0 + 1;
+    if (CLAMP) {
+        x0 = Clampi(x0, 0, tex->width_mask); x1 = Clampi(x1, 0, tex->width_mask);
+        y0 = Clampi(y0, 0, tex->height_mask); y1 = Clampi(y1, 0, tex->height_mask);
+    }
+    else {
+        x0 &= tex->width_mask; x1 &= tex->width_mask;
+        y0 &= tex->height_mask; y1 &= tex->height_mask;
+    }
+
+    uint32_t w = tex->width;
+    uint32_t c00 = Expand565(Texture_Fetch(tex->pixels, tex->palette, Texture_TexelOffset(x0, y0, w, tex->tiled), tex->format));
+    uint32_t c10 = Expand565(Texture_Fetch(tex->pixels, tex->palette, Texture_TexelOffset(x1, y0, w, tex->tiled), tex->format));
+    uint32_t c01 = Expand565(Texture_Fetch(tex->pixels, tex->palette, Texture_TexelOffset(x0, y1, w, tex->tiled), tex->format));
+    uint32_t c11 = Expand565(Texture_Fetch(tex->pixels, tex->palette, Texture_TexelOffset(x1, y1, w, tex->tiled), tex->format));
+
+    uint32_t c = Lerp565(Lerp565(c00, c10, fx), Lerp565(c01, c11, fx), fy);
+    return (uint16_t)((c & 0xFFFF) | (c >> 16));
+}
+
+uint16_t Texture_SampleFixed(const Texture_t* tex, int32_t u, int32_t v)
+{
+    return SampleFixed<false, false>(tex, u, v);
 }
 
 uint16_t Texture_Sample(const Texture_t* tex, float u, float v)
 {
-    u = u - (int)u; if (u < 0) u += 1.0f;
-    v = v - (int)v; if (v < 0) v += 1.0f;
+    return SampleFixed<false, false>(tex, ToFixedUV(u), ToFixedUV(v));
+}
+
+/* Level lod of tex, clamped to the last stored one, described in level */
+static const Texture_t* MipLevel(const Texture_t* tex, int lod, Texture_t* level)
+{
+    if (lod > tex->levels - 1) lod = tex->levels - 1;
+
+    const uint16_t* pixels = tex->pixels;
+    for (int k = 0; k < lod; k++) pixels += Texture_LevelWords(tex->width >> k, tex->height >> k, tex->format);
+
+    level->pixels = (uint16_t*)pixels;
+    level->palette = tex->palette;
+    level->format = tex->format;
+    level->width = tex->width >> lod;
+    level->height = tex->height >> lod;
+    level->width_mask = level->width - 1;
+    level->height_mask = level->height - 1;
+    level->width_shift = (uint8_t)(tex->width_shift - lod);
+    level->height_shift = (uint8_t)(tex->height_shift - lod);
+    level->levels = 1;
+    level->tiled = tex->tiled && level->width >= TEXTURE_TILE && level->height >= TEXTURE_TILE;
+    return level;
+}
+
+/* Level view of a mipmapped texture for one triangle: texels covered per
+ * pixel from the UV and screen areas, log2 of its square root (rounded
+ * down, so the level stays on the sharp side). inv_area is the
+ * reciprocal of the sub-pixel edge-function area. */
+static const Texture_t* SelectLevel(const Texture_t* tex, const ScreenVertex_t* v0,
+    const ScreenVertex_t* v1, const ScreenVertex_t* v2, float inv_area, Texture_t* level)
+{
+    if (tex->levels <= 1) return tex;
+
+    float uv_area = (v1->u - v0->u) * (v2->v - v0->v) - (v2->u - v0->u) * (v1->v - v0->v);
+    if (uv_area < 0) uv_area = -uv_area;
+    float ratio = uv_area * (float)tex->width * (float)tex->height *
+        (float)(RASTER_SUBPIXEL_SCALE * RASTER_SUBPIXEL_SCALE) * inv_area;
+    if (!(ratio >= 4.0f)) return tex;
 
-    int tx = (int)(u * tex->width) & tex->width_mask;
-    int ty = (int)(v * tex->height) & tex->height_mask;
+    /* floor(log2(ratio)) straight from the float exponent */
+    uint32_t bits;
+    memcpy(&bits, &ratio, sizeof(bits));
+    int lod = (int)(((bits >> 23) & 0xFF) - 127) >> 1;
+    return MipLevel(tex, lod, level);
+}
+
+/* SelectLevel() without the reciprocal: the largest lod whose texel
+ * footprint 4^lod stays within the UV to screen area ratio */
+static const Texture_t* SelectLevelArea(const Texture_t* tex, const ScreenVertex_t* v0,
+    const ScreenVertex_t* v1, const ScreenVertex_t* v2, int32_t area, Texture_t* level)
+{
+    if (tex->levels <= 1) return tex;
 
-    return tex->pixels[ty * tex->width + tx];
+    float uv_area = (v1->u - v0->u) * (v2->v - v0->v) - (v2->u - v0->u) * (v1->v - v0->v);
+    if (uv_area < 0) uv_area = -uv_area;
+    float texels = uv_area * (float)tex->width * (float)tex->height *
+        (float)(RASTER_SUBPIXEL_SCALE * RASTER_SUBPIXEL_SCALE);
+    float footprint = (float)area * 4.0f;
+    int lod = 0;
+    while (lod < tex->levels - 1 && texels >= footprint) {
+        lod++;
+        footprint *= 4.0f;
+    }
+    return lod ? MipLevel(tex, lod, level) : tex;
 }
 
 static inline uint16_t ColorLerp(uint16_t c0, uint16_t c1, uint16_t c2,
@@ -114,202 +799,2728 @@ static inline uint16_t ColorLerp(uint16_t c0, uint16_t c1, uint16_t c2,
     return (uint16_t)((r << 11) | (g << 5) | b);
 }
 
-static inline uint16_t ColorModulate(uint16_t texel, uint16_t light)
+/* Texel times light given as separate 5/6/5-bit channels */
+static inline uint16_t ModulateChannels(uint16_t texel, int lr, int lg, int lb)
 {
     int tr = (texel >> 11) & 0x1F, tg = (texel >> 5) & 0x3F, tb = texel & 0x1F;
-    int lr = (light >> 11) & 0x1F, lg = (light >> 5) & 0x3F, lb = light & 0x1F;
     return (uint16_t)(((tr * lr) >> 5 << 11) | ((tg * lg) >> 6 << 5) | ((tb * lb) >> 5));
 }
 
-/* Helper: Convert RGB565 to Color (PC only) */
+static inline uint16_t ColorModulate(uint16_t texel, uint16_t light)
+{
+    return ModulateChannels(texel, (light >> 11) & 0x1F, (light >> 5) & 0x3F, light & 0x1F);
+}
+
 #ifdef SDL_PC
-static inline Color RGB565ToColor(uint16_t c)
+/* Depth test and write against a 24-bit or float device buffer */
+template <bool DEPTH_TEST, bool DEPTH_WRITE>
+static inline int WideDepthPass(const RasterTarget_t* t, int idx, float z)
 {
-    uint8_t r = ((c >> 11) & 0x1F) << 3;
-    uint8_t g = ((c >> 5) & 0x3F) << 2;
-    uint8_t b = (c & 0x1F) << 3;
-    return Color(r, g, b);
+    if (t->wide_format == DEPTH_FORMAT_FIXED24) {
+        uint32_t* depth = (uint32_t*)t->wide_depth;
+        uint32_t z24 = Depth_ToZ24(z);
+        if (DEPTH_TEST && z24 >= depth[idx]) return 0;
+        if (DEPTH_WRITE) depth[idx] = z24;
+    }
+    else {
+        float* depth = (float*)t->wide_depth;
+        if (DEPTH_TEST && z >= depth[idx]) return 0;
+        if (DEPTH_WRITE) depth[idx] = z;
+    }
+    return 1;
 }
 #endif
 
-void Rasterizer_DrawTriangle(const ScreenVertex_t* v0, const ScreenVertex_t* v1,
-    const ScreenVertex_t* v2, const Texture_t* texture)
+/* 16-bit depth buffer under the target's depth range */
+template <bool DEPTH_TEST, bool DEPTH_WRITE>
+static inline int DepthPass16(const RasterTarget_t* t, int idx, uint16_t z16)
+{
+    if (t->depth_range == DEPTH_RANGE_FULL) {
+        if (DEPTH_TEST && z16 >= t->depth[idx]) return 0;
+    }
+    else if (t->depth_range == DEPTH_RANGE_NEAR) {
+        z16 >>= 1;
+        if (DEPTH_TEST && z16 >= t->depth[idx]) return 0;
+    }
+    else {
+        z16 = (uint16_t)(0xFFFF - (z16 >> 1));
+        if (DEPTH_TEST && z16 <= t->depth[idx]) return 0;
+    }
+    if (DEPTH_WRITE) t->depth[idx] = z16;
+    return 1;
+}
+
+/* Depth test and write with compile-time depth state; 0 = rejected.
+ * Runs before shading, so occluded pixels never sample or light. */
+template <bool DEPTH_TEST, bool DEPTH_WRITE>
+static inline int DepthPass(const RasterTarget_t* t, int idx, float z)
 {
+    if (!DEPTH_TEST && !DEPTH_WRITE) return 1;
 #ifdef SDL_PC
-    if (!g_device) return;
-    int width = g_device->Width();
-    int height = g_device->Height();
-#else
-    if (!g_framebuffer) return;
-    int width = DISPLAY_WIDTH;
-    int height = DISPLAY_HEIGHT;
+    if (t->wide_depth) return WideDepthPass<DEPTH_TEST, DEPTH_WRITE>(t, idx, z);
 #endif
+    return DepthPass16<DEPTH_TEST, DEPTH_WRITE>(t, idx, Depth_ToZ16(z));
+}
 
-    g_stats.triangles_submitted++;
-
-    int x0 = v0->x, y0 = v0->y;
-    int x1 = v1->x, y1 = v1->y;
-    int x2 = v2->x, y2 = v2->y;
-
-    int32_t area = EdgeFunction(x0, y0, x1, y1, x2, y2);
-    if (area <= 0) { g_stats.triangles_culled++; return; }
-
-    int minX = Clampi(Min3i(x0, x1, x2), 0, width - 1);
-    int maxX = Clampi(Max3i(x0, x1, x2), 0, width - 1);
-    int minY = Clampi(Min3i(y0, y1, y2), 0, height - 1);
-    int maxY = Clampi(Max3i(y0, y1, y2), 0, height - 1);
-
-    if (minX > maxX || minY > maxY) { g_stats.triangles_culled++; return; }
+#if RASTER_FIXED_POINT
+/* Fixed-point depth: 16-bit depth units with RASTER_FX_Z_BITS fraction */
+#define RASTER_FX_Z_BITS    12
+#define RASTER_FX_Z_SCALE   (65535.0f * (float)(1 << RASTER_FX_Z_BITS))
+typedef int32_t RasterZ_t;
 
-    float invArea = 1.0f / (float)area;
+template <bool DEPTH_TEST, bool DEPTH_WRITE>
+static inline int DepthPass(const RasterTarget_t* t, int idx, int32_t z)
+{
+    if (!DEPTH_TEST && !DEPTH_WRITE) return 1;
+#ifdef SDL_PC
+    if (t->wide_depth) return WideDepthPass<DEPTH_TEST, DEPTH_WRITE>(t, idx, (float)z * (1.0f / RASTER_FX_Z_SCALE));
+#endif
+    return DepthPass16<DEPTH_TEST, DEPTH_WRITE>(t, idx, (uint16_t)Clampi(z >> RASTER_FX_Z_BITS, 0, 0xFFFF));
+}
+#else
+typedef float RasterZ_t;
+#endif
 
-    int32_t A12 = y1 - y2, B12 = x2 - x1;
-    int32_t A20 = y2 - y0, B20 = x0 - x2;
-    int32_t A01 = y0 - y1, B01 = x1 - x0;
+static inline int PixelIndex(const RasterTarget_t* t, int x, int y)
+{
+    return (y - t->origin_y) * t->stride + (x - t->origin_x);
+}
 
-    int32_t w0_row = EdgeFunction(x1, y1, x2, y2, minX, minY);
-    int32_t w1_row = EdgeFunction(x2, y2, x0, y0, minX, minY);
-    int32_t w2_row = EdgeFunction(x0, y0, x1, y1, minX, minY);
+static inline void WriteColor(const RasterTarget_t* t, int idx, uint16_t color565)
+{
+    t->color[idx] = color565;
+    t->stats->pixels_drawn++;
+}
 
-    float w0_inv = v0->w_inv, w1_inv = v1->w_inv, w2_inv = v2->w_inv;
+/* Write into the target with compile-time depth state */
+template <bool DEPTH_TEST, bool DEPTH_WRITE>
+static inline void WritePixel(const RasterTarget_t* t, int x, int y, RasterZ_t z, uint16_t color565)
+{
+    int idx = PixelIndex(t, x, y);
+    if (DepthPass<DEPTH_TEST, DEPTH_WRITE>(t, idx, z)) WriteColor(t, idx, color565);
+    else t->stats->pixels_depth_rejected++;
+}
 
-    for (int y = minY; y <= maxY; y++) {
-        int32_t w0 = w0_row, w1 = w1_row, w2 = w2_row;
-
-        for (int x = minX; x <= maxX; x++) {
-            if ((w0 | w1 | w2) >= 0) {
-                float b0 = w0 * invArea, b1 = w1 * invArea, b2 = w2 * invArea;
-                float z = b0 * v0->z + b1 * v1->z + b2 * v2->z;
-
-                uint16_t color565;
-                if (texture) {
-                    float w = b0 * w0_inv + b1 * w1_inv + b2 * w2_inv;
-                    float inv_w = 1.0f / w;
-                    float u = (b0 * v0->u * w0_inv + b1 * v1->u * w1_inv + b2 * v2->u * w2_inv) * inv_w;
-                    float v = (b0 * v0->v * w0_inv + b1 * v1->v * w1_inv + b2 * v2->v * w2_inv) * inv_w;
-                    uint16_t texel = Texture_Sample(texture, u, v);
-                    uint16_t light = ColorLerp(v0->color, v1->color, v2->color, b0, b1, b2);
-                    color565 = ColorModulate(texel, light);
-                }
-                else {
-                    color565 = ColorLerp(v0->color, v1->color, v2->color, b0, b1, b2);
-                }
+/* ============================================================
+ * Pixel Groups
+ * RASTER_LANES neighbouring pixels of a row per step: SSE2 on PC, and
+ * on the Cortex-M7 the DSP halfword instructions, two depth or RGB565
+ * values per register. Depth results are those of DepthPass16(); only
+ * 16-bit full-range depth, other targets keep the per-pixel loops.
+ * RasterFlat() fills solid color through them, RasterShaded() shades
+ * (ShadeGroups()).
+ * ============================================================ */
 
-#ifdef SDL_PC
-                /* Use Device::PutPixel with depth test */
-                g_device->PutPixel(x, y, z, RGB565ToColor(color565));
-                g_stats.pixels_drawn++;
+#if !RASTER_FIXED_POINT && defined(SDL_PC) && (defined(__SSE2__) || defined(_M_X64) || defined(_M_IX86_FP))
+#define RASTER_SSE 1
+#define RASTER_LANES    4
+#include <emmintrin.h>
+#elif !RASTER_FIXED_POINT && !defined(SDL_PC) && defined(__ARM_FEATURE_DSP)
+#define RASTER_DSP 1
+#define RASTER_LANES    2
+#include "stm32h7xx.h"
 #else
-                /* Direct framebuffer access with manual depth test */
-                uint16_t z16 = (uint16_t)(z);
-                int idx = y * DISPLAY_WIDTH + x;
-                if (z16 < zbuffer[idx]) {
-                    zbuffer[idx] = z16;
-                    g_framebuffer[idx] = color565;
-                    g_stats.pixels_drawn++;
-                }
+#define RASTER_LANES    1
 #endif
-            }
-            w0 += A12; w1 += A20; w2 += A01;
-        }
-        w0_row += B12; w1_row += B20; w2_row += B01;
-    }
-    g_stats.triangles_drawn++;
-}
+#define LANES_ALL       ((1u << RASTER_LANES) - 1)
 
-void Rasterizer_DrawTriangleSolid(const ScreenVertex_t* v0, const ScreenVertex_t* v1,
-    const ScreenVertex_t* v2, uint16_t color)
+#if RASTER_LANES > 1
+static inline int GroupTarget(const RasterTarget_t* t)
 {
 #ifdef SDL_PC
-    if (!g_device) return;
-    int width = g_device->Width();
-    int height = g_device->Height();
-    Color col = RGB565ToColor(color);
-#else
-    if (!g_framebuffer) return;
-    int width = DISPLAY_WIDTH;
-    int height = DISPLAY_HEIGHT;
+    if (t->wide_depth) return 0;
 #endif
+    return t->depth_range == DEPTH_RANGE_FULL;
+}
 
-    g_stats.triangles_submitted++;
+/* Set bits of a lane mask */
+static inline uint32_t LaneCount(uint32_t bits)
+{
+    return (uint32_t)(0x4332322132212110ull >> (bits * 4)) & 0xF;
+}
 
-    int x0 = v0->x, y0 = v0->y;
-    int x1 = v1->x, y1 = v1->y;
-    int x2 = v2->x, y2 = v2->y;
+/* Stats of a run of groups, kept local and added once: the vector
+ * stores below may alias anything, the target and its stats included */
+typedef struct {
+    uint32_t drawn;
+    uint32_t rejected;
+} GroupCount_t;
+#endif
 
-    int32_t area = EdgeFunction(x0, y0, x1, y1, x2, y2);
-    if (area <= 0) { g_stats.triangles_culled++; return; }
+#ifdef RASTER_SSE
+/* Lane bits to all-ones 32-bit lanes */
+static inline __m128i LaneMask(uint32_t bits)
+{
+    const __m128i lane = _mm_set_epi32(8, 4, 2, 1);
+    return _mm_cmpeq_epi32(_mm_and_si128(_mm_set1_epi32((int)bits), lane), lane);
+}
+
+/* Four 0..0xFFFF lanes to uint16 in the low half; SSE2 only packs signed */
+static inline __m128i PackU16(__m128i v)
+{
+    v = _mm_packs_epi32(_mm_sub_epi32(v, _mm_set1_epi32(0x8000)), _mm_setzero_si128());
+    return _mm_xor_si128(v, _mm_set1_epi16((short)0x8000));
+}
 
-    int minX = Clampi(Min3i(x0, x1, x2), 0, width - 1);
-    int maxX = Clampi(Max3i(x0, x1, x2), 0, width - 1);
-    int minY = Clampi(Min3i(y0, y1, y2), 0, height - 1);
-    int maxY = Clampi(Max3i(y0, y1, y2), 0, height - 1);
+/* Depths of the next four pixels, z stepping by dz one pixel at a time
+ * exactly as the scalar loops do; built in registers, as a store and a
+ * wide reload would stall on store forwarding */
+typedef __m128 ZGroup_t;
 
-    if (minX > maxX || minY > maxY) { g_stats.triangles_culled++; return; }
+static inline ZGroup_t ZGroupStep(float* z, float dz)
+{
+    float a = *z, b = a + dz, c = b + dz, d = c + dz;
+    *z = d + dz;
+    return _mm_set_ps(d, c, b, a);
+}
 
-    float invArea = 1.0f / (float)area;
+/* Coverage `cover` and depths z of the lanes at depth; returns the lanes
+ * that pass, their depth written */
+template <bool DEPTH_TEST, bool DEPTH_WRITE>
+static inline uint32_t DepthGroup(uint16_t* depth, uint32_t cover, ZGroup_t z, GroupCount_t* n)
+{
+    if (!DEPTH_TEST && !DEPTH_WRITE) return cover;
+    /* Depth_ToZ16(): clamped, then truncated */
+    __m128 zc = _mm_min_ps(_mm_max_ps(z, _mm_setzero_ps()), _mm_set1_ps(1.0f));
+    __m128i z16 = _mm_cvttps_epi32(_mm_mul_ps(zc, _mm_set1_ps(65535.0f)));
+    __m128i old = _mm_loadl_epi64((const __m128i*)depth);
+    __m128i pass = LaneMask(cover);
+    if (DEPTH_TEST) pass = _mm_and_si128(pass, _mm_cmplt_epi32(z16, _mm_unpacklo_epi16(old, _mm_setzero_si128())));
+    uint32_t bits = (uint32_t)_mm_movemask_ps(_mm_castsi128_ps(pass));
+    if (DEPTH_WRITE && bits) {
+        __m128i keep = _mm_packs_epi32(pass, pass);
+        _mm_storel_epi64((__m128i*)depth, _mm_or_si128(_mm_and_si128(keep, PackU16(z16)), _mm_andnot_si128(keep, old)));
+    }
+    n->rejected += LaneCount(cover & ~bits);
+    return bits;
+}
 
-    for (int y = minY; y <= maxY; y++) {
-        for (int x = minX; x <= maxX; x++) {
-            int32_t w0 = EdgeFunction(x1, y1, x2, y2, x, y);
-            int32_t w1 = EdgeFunction(x2, y2, x0, y0, x, y);
-            int32_t w2 = EdgeFunction(x0, y0, x1, y1, x, y);
+/* RGB565 of the lanes, in the low four halfwords */
+typedef __m128i ColorLanes_t;
 
-            if ((w0 | w1 | w2) >= 0) {
-                float b0 = w0 * invArea, b1 = w1 * invArea, b2 = w2 * invArea;
-                float z = b0 * v0->z + b1 * v1->z + b2 * v2->z;
+static inline ColorLanes_t SplatLanes(uint16_t value)
+{
+    return _mm_set1_epi16((short)value);
+}
 
-#ifdef SDL_PC
-                g_device->PutPixel(x, y, z, col);
-                g_stats.pixels_drawn++;
-#else
-                uint16_t z16 = (uint16_t)(z);
-                int idx = y * DISPLAY_WIDTH + x;
-                if (z16 < zbuffer[idx]) {
-                    zbuffer[idx] = z16;
-                    g_framebuffer[idx] = color;
-                    g_stats.pixels_drawn++;
-                }
-#endif
-            }
-        }
+/* Stores the lanes of bits */
+static inline void StoreGroup(uint16_t* color, uint32_t bits, ColorLanes_t c, GroupCount_t* n)
+{
+    if (!bits) return;
+    if (bits != LANES_ALL) {
+        __m128i keep = LaneMask(bits);
+        keep = _mm_packs_epi32(keep, keep);
+        c = _mm_or_si128(_mm_and_si128(keep, c), _mm_andnot_si128(keep, _mm_loadl_epi64((const __m128i*)color)));
     }
-    g_stats.triangles_drawn++;
+    _mm_storel_epi64((__m128i*)color, c);
+    n->drawn += LaneCount(bits);
 }
+#endif
 
-void Rasterizer_DrawLine(int x0, int y0, int x1, int y1, uint16_t color)
+#ifdef RASTER_DSP
+/* Lane bits to all-ones halfwords */
+static inline uint32_t LaneMask(uint32_t bits)
 {
-#ifdef SDL_PC
-    if (!g_device) return;
-    int width = g_device->Width();
-    int height = g_device->Height();
-    Color col = RGB565ToColor(color);
-#else
-    if (!g_framebuffer) return;
-    int width = DISPLAY_WIDTH;
-    int height = DISPLAY_HEIGHT;
-#endif
+    return ((bits & 1) ? 0x0000FFFFu : 0) | ((bits & 2) ? 0xFFFF0000u : 0);
+}
 
-    int dx = (x1 > x0) ? (x1 - x0) : (x0 - x1);
-    int dy = (y1 > y0) ? (y1 - y0) : (y0 - y1);
-    int sx = (x0 < x1) ? 1 : -1;
-    int sy = (y0 < y1) ? 1 : -1;
-    int err = dx - dy;
+typedef struct {
+    float z[2];
+} ZGroup_t;
 
-    while (1) {
-        if (x0 >= 0 && x0 < width && y0 >= 0 && y0 < height) {
-#ifdef SDL_PC
-            g_device->PutPixel(x0, y0, col);
-#else
-            g_framebuffer[y0 * DISPLAY_WIDTH + x0] = color;
-#endif
-        }
-        if (x0 == x1 && y0 == y1) break;
-        int e2 = 2 * err;
-        if (e2 > -dy) { err -= dy; x0 += sx; }
-        if (e2 < dx) { err += dx; y0 += sy; }
+static inline ZGroup_t ZGroupStep(float* z, float dz)
+{
+    ZGroup_t g;
+    g.z[0] = *z;
+    g.z[1] = g.z[0] + dz;
+    *z = g.z[1] + dz;
+    return g;
+}
+
+template <bool DEPTH_TEST, bool DEPTH_WRITE>
+static inline uint32_t DepthGroup(uint16_t* depth, uint32_t cover, ZGroup_t z, GroupCount_t* n)
+{
+    if (!DEPTH_TEST && !DEPTH_WRITE) return cover;
+    uint32_t z16 = Depth_ToZ16(z.z[0]) | ((uint32_t)Depth_ToZ16(z.z[1]) << 16);
+    uint32_t old;
+    memcpy(&old, depth, sizeof(old));
+    uint32_t keep = LaneMask(cover);
+    if (DEPTH_TEST) {
+        /* GE flags per halfword where z >= depth; SEL keeps the others */
+        __USUB16(z16, old);
+        keep &= __SEL(0, 0xFFFFFFFFu);
+    }
+    if (DEPTH_WRITE && keep) {
+        uint32_t out = (z16 & keep) | (old & ~keep);
+        memcpy(depth, &out, sizeof(out));
     }
+    uint32_t bits = (keep & 1) | ((keep >> 16) & 2);
+    n->rejected += LaneCount(cover & ~bits);
+    return bits;
 }
 
-void Rasterizer_GetStats(RasterizerStats_t* stats) { *stats = g_stats; }
-void Rasterizer_ResetStats(void) { memset(&g_stats, 0, sizeof(g_stats)); }
\ No newline at end of file
+/* RGB565 of the lanes, lane 0 in the low halfword */
+typedef uint32_t ColorLanes_t;
+
+static inline ColorLanes_t SplatLanes(uint16_t value)
+{
+    return value | ((uint32_t)value << 16);
+}
+
+static inline void StoreGroup(uint16_t* color, uint32_t bits, ColorLanes_t c, GroupCount_t* n)
+{
+    if (!bits) return;
+    if (bits != LANES_ALL) {
+        uint32_t keep = LaneMask(bits), old;
+        memcpy(&old, color, sizeof(old));
+        c = (c & keep) | (old & ~keep);
+    }
+    memcpy(color, &c, sizeof(c));
+    n->drawn += LaneCount(bits);
+}
+#endif
+
+#if RASTER_LANES > 1
+static inline void ColorGroup(uint16_t* color, uint32_t bits, uint16_t value, GroupCount_t* n)
+{
+    StoreGroup(color, bits, SplatLanes(value), n);
+}
+#endif
+
+/* Whole-target destination of immediate draws into ctx */
+static int GetContextTarget(RasterContext_t* ctx, RasterTarget_t* t)
+{
+    if (!ctx->color || !ctx->depth) return 0;
+    t->color = ctx->color;
+    t->stride = ctx->stride;
+    t->max_x = MIN(ctx->width, ctx->res_width) - 1;
+    t->max_y = MIN(ctx->height, ctx->res_height) - 1;
+#ifdef SDL_PC
+    if (ctx->depth_format == DEPTH_FORMAT_UNORM16) {
+        t->depth = (uint16_t*)ctx->depth;
+        t->wide_depth = NULL;
+    }
+    else {
+        t->depth = NULL;
+        t->wide_depth = ctx->depth;
+        t->wide_format = ctx->depth_format;
+    }
+#else
+    t->depth = (uint16_t*)ctx->depth;
+#endif
+    /* HiZ keeps a max, which only bounds the full "smaller wins" range */
+    t->hiz = (ctx->depth_range == DEPTH_RANGE_FULL) ? ctx->hiz : NULL;
+    t->hiz_stride = ctx->hiz_stride;
+    t->heat = (ctx == &g_default && g_heat_active && t->max_x < DISPLAY_WIDTH && t->max_y < DISPLAY_HEIGHT) ? g_heat : NULL;
+    t->heat_mode = t->heat ? g_heat_active : RASTER_HEAT_OFF;
+    t->shadow_mask = (ctx == &g_default && t->max_x < DISPLAY_WIDTH && t->max_y < DISPLAY_HEIGHT) ? g_shadow_mask : NULL;
+    t->perspective_span = ctx->perspective_span;
+    t->traversal = ctx->traversal;
+    t->depth_range = ctx->depth_range;
+    t->origin_x = 0;
+    t->origin_y = 0;
+    t->min_x = 0;
+    t->min_y = 0;
+    t->stats = &ctx->stats;
+    return 1;
+}
+
+/* Clip rect of target t narrowed to scissor rectangle i; 0 when empty */
+static int ScissorTarget(const RasterContext_t* ctx, const RasterTarget_t* t, uint32_t i, RasterTarget_t* out)
+{
+    const RasterRect_t* r = &ctx->scissor[i];
+    *out = *t;
+    out->min_x = MAX(t->min_x, r->x);
+    out->min_y = MAX(t->min_y, r->y);
+    out->max_x = MIN(t->max_x, r->x + r->w - 1);
+    out->max_y = MIN(t->max_y, r->y + r->h - 1);
+    return out->min_x <= out->max_x && out->min_y <= out->max_y;
+}
+
+/* Whether the inclusive box touches any scissor rectangle */
+static int ScissorOverlaps(const RasterContext_t* ctx, int min_x, int min_y, int max_x, int max_y)
+{
+    for (uint32_t i = 0; i < ctx->scissor_count; i++) {
+        const RasterRect_t* r = &ctx->scissor[i];
+        if (min_x < r->x + r->w && max_x >= r->x && min_y < r->y + r->h && max_y >= r->y) return 1;
+    }
+    return 0;
+}
+
+/* ============================================================
+ * Pixel Loops
+ * ============================================================ */
+
+/* Block traversal: edge functions are evaluated at the corners of
+ * RASTER_BLOCK x RASTER_BLOCK blocks; blocks outside any edge are skipped,
+ * blocks inside all three edges are shaded without per-pixel edge tests. */
+
+enum { BLOCK_OUTSIDE = 0, BLOCK_PARTIAL, BLOCK_INSIDE };
+
+/* e: edge values at the block's top-left pixel; dx/dy: offset to the far corner */
+static inline int BlockCoverage(const int32_t e[3], const int32_t A[3], const int32_t B[3],
+    int dx, int dy)
+{
+    int inside = 1;
+    for (int i = 0; i < 3; i++) {
+        int32_t ax = A[i] * dx, by = B[i] * dy;
+        int32_t lo = e[i] + MIN(ax, 0) + MIN(by, 0);
+        int32_t hi = e[i] + MAX(ax, 0) + MAX(by, 0);
+        if (hi < 0) return BLOCK_OUTSIDE;
+        if (lo < 0) inside = 0;
+    }
+    return inside ? BLOCK_INSIDE : BLOCK_PARTIAL;
+}
+
+/* ============================================================
+ * Traversal
+ * The pixel loops take runs of pixels from WalkNext(): RASTER_BLOCK
+ * cells aligned to the HiZ grid and classified by BlockCoverage(), or
+ * with spans one run per row between the triangle's edges, inside by
+ * construction. Both cover exactly the pixels the edge functions accept.
+ * Spans never visit an uncovered pixel, which pays on long thin
+ * triangles whose bounding box is mostly empty; blocks keep HiZ
+ * rejection and need no per-row edge solve.
+ * ============================================================ */
+
+/* Auto traversal takes spans when the triangle covers less than
+ * 1 / RASTER_SPAN_THIN_RATIO of its bounding box in the target */
+#define RASTER_SPAN_THIN_RATIO  4
+
+typedef struct {
+    const TriSetup_t* ts;
+    int spans;
+    int cx, cy;             /* HiZ cell of the run; blocks only */
+    int bx, by, bw, bh;     /* bw x bh pixels from (bx, by) */
+    int coverage;
+    int32_t e[3];           /* Edge values at (bx, by) */
+} RasterWalk_t;
+
+static inline int UseSpans(const RasterTarget_t* t, const TriSetup_t* ts, int32_t area)
+{
+    if (t->traversal != RASTER_TRAVERSAL_AUTO) return t->traversal == RASTER_TRAVERSAL_SPANS;
+    /* area is twice the triangle's, in sub-pixel units */
+    int64_t box = (int64_t)(ts->maxX - ts->minX + 1) * (ts->maxY - ts->minY + 1);
+    return box * (2 * RASTER_SUBPIXEL_SCALE * RASTER_SUBPIXEL_SCALE) > (int64_t)area * RASTER_SPAN_THIN_RATIO;
+}
+
+static inline void WalkBegin(RasterWalk_t* w, const TriSetup_t* ts, int spans)
+{
+    w->ts = ts;
+    w->spans = spans;
+    w->cx = (ts->minX & ~(RASTER_BLOCK - 1)) - RASTER_BLOCK;
+    w->cy = ts->minY & ~(RASTER_BLOCK - 1);
+    w->by = ts->minY - 1;
+}
+
+/* Next row span: edge i holds where e_i + A_i * k >= 0, which gives a
+ * first column for A_i > 0 and a last one for A_i < 0. Edges already
+ * non-negative across the row cost no divide. */
+static inline int WalkNextSpan(RasterWalk_t* w)
+{
+    const TriSetup_t* ts = w->ts;
+    int last = ts->maxX - ts->minX;
+
+    while (++w->by <= ts->maxY) {
+        int lo = 0, hi = last;
+        int32_t e[3];
+        for (int i = 0; i < 3 && lo <= hi; i++) {
+            int32_t a = ts->A[i];
+            e[i] = ts->origin[i] + ts->B[i] * (w->by - ts->minY);
+            if (a > 0) {
+                if (e[i] < 0) lo = MAX(lo, (-e[i] - 1) / a + 1);
+            }
+            else if (a < 0) {
+                if (e[i] < 0) hi = -1;
+                else if (e[i] + a * last < 0) hi = MIN(hi, e[i] / -a);
+            }
+            else if (e[i] < 0) {
+                hi = -1;
+            }
+        }
+        if (lo > hi) continue;
+
+        w->bx = ts->minX + lo;
+        w->bw = hi - lo + 1;
+        w->bh = 1;
+        w->coverage = BLOCK_INSIDE;
+        for (int i = 0; i < 3; i++) w->e[i] = e[i] + ts->A[i] * lo;
+        return 1;
+    }
+    return 0;
+}
+
+/* Next block with any coverage, row by row; 0 when done */
+static inline int WalkNext(RasterWalk_t* w)
+{
+    if (w->spans) return WalkNextSpan(w);
+
+    const TriSetup_t* ts = w->ts;
+    for (;;) {
+        w->cx += RASTER_BLOCK;
+        if (w->cx > ts->maxX) {
+            w->cx = ts->minX & ~(RASTER_BLOCK - 1);
+            w->cy += RASTER_BLOCK;
+            if (w->cx > ts->maxX) return 0;
+        }
+        if (w->cy > ts->maxY) return 0;
+
+        w->bx = MAX(w->cx, ts->minX);
+        w->by = MAX(w->cy, ts->minY);
+        w->bw = MIN(w->cx + RASTER_BLOCK - 1, ts->maxX) - w->bx + 1;
+        w->bh = MIN(w->cy + RASTER_BLOCK - 1, ts->maxY) - w->by + 1;
+        for (int i = 0; i < 3; i++) {
+            w->e[i] = ts->origin[i] + ts->A[i] * (w->bx - ts->minX) + ts->B[i] * (w->by - ts->minY);
+        }
+        w->coverage = BlockCoverage(w->e, ts->A, ts->B, w->bw - 1, w->bh - 1);
+        if (w->coverage != BLOCK_OUTSIDE) return 1;
+    }
+}
+
+/* ============================================================
+ * Hierarchical Z
+ * One max-depth value per RASTER_BLOCK cell. A cell is skipped when the
+ * triangle's nearest vertex is behind everything already in it. Cells are
+ * refreshed after a fully covered block; partial blocks only ever lower
+ * depth, so the stored max stays a valid (conservative) bound.
+ * ============================================================ */
+
+static inline int HiZReject(const RasterTarget_t* t, int cx, int cy, uint16_t zmin16)
+{
+    if (!t->hiz) return 0;
+    int cell = ((cy - t->origin_y) / RASTER_BLOCK) * t->hiz_stride + (cx - t->origin_x) / RASTER_BLOCK;
+    if (zmin16 > t->hiz[cell]) {
+        t->stats->hiz_blocks_culled++;
+        return 1;
+    }
+    return 0;
+}
+
+static inline void HiZUpdate(const RasterTarget_t* t, int cx, int cy)
+{
+    if (!t->hiz) return;
+    int x0 = cx - t->origin_x, y0 = cy - t->origin_y;
+    uint16_t zmax = 0;
+    for (int y = y0; y < y0 + RASTER_BLOCK; y++) {
+        const uint16_t* row = &t->depth[y * t->stride + x0];
+        for (int x = 0; x < RASTER_BLOCK; x++) zmax = MAX(zmax, row[x]);
+    }
+    t->hiz[(y0 / RASTER_BLOCK) * t->hiz_stride + x0 / RASTER_BLOCK] = zmax;
+}
+
+/* Perspective-correct quantity q/w as a screen-space plane */
+typedef struct {
+    float origin, dx, dy;
+} AttribPlane_t;
+
+static inline void SetupPlane(AttribPlane_t* p, const TriSetup_t* ts, float a0, float a1, float a2)
+{
+    p->dx = (ts->A[0] * a0 + ts->A[1] * a1 + ts->A[2] * a2) * ts->inv_area;
+    p->dy = (ts->B[0] * a0 + ts->B[1] * a1 + ts->B[2] * a2) * ts->inv_area;
+    p->origin = ((ts->origin[0] - ts->bias[0]) * a0 + (ts->origin[1] - ts->bias[1]) * a1 +
+        (ts->origin[2] - ts->bias[2]) * a2) * ts->inv_area;
+}
+
+static inline float EvalPlane(const AttribPlane_t* p, float fx, float fy)
+{
+    return p->origin + p->dx * fx + p->dy * fy;
+}
+
+/* ============================================================
+ * Gouraud Light
+ * Vertex colors as one plane per RGB565 channel, set up once per
+ * triangle. Pixels carry the light as three integers with
+ * RASTER_GOURAUD_BITS fraction bits: stepping one is three adds, and
+ * shading takes the channels as they are instead of blending and
+ * unpacking vertex colors per pixel.
+ * ============================================================ */
+
+#define RASTER_GOURAUD_BITS     16
+#define RASTER_GOURAUD_LIMIT    256.0f  /* Channel levels kept in int32 */
+
+typedef struct {
+    int32_t r, g, b;
+} Gouraud_t;
+
+typedef struct {
+    AttribPlane_t r, g, b;
+    Gouraud_t dx;               /* Per-pixel step along x */
+} GouraudPlane_t;
+
+static inline int32_t ToGouraud(float level)
+{
+    return (int32_t)(Clampf(level, -RASTER_GOURAUD_LIMIT, RASTER_GOURAUD_LIMIT) * (float)(1 << RASTER_GOURAUD_BITS));
+}
+
+static inline void SetupGouraudChannel(AttribPlane_t* p, const TriSetup_t* ts,
+    uint16_t c0, uint16_t c1, uint16_t c2, int shift, uint32_t mask)
+{
+    SetupPlane(p, ts, (float)((c0 >> shift) & mask), (float)((c1 >> shift) & mask), (float)((c2 >> shift) & mask));
+    p->origin += 0.5f;          /* Round like ColorLerp */
+}
+
+static inline void SetupGouraud(GouraudPlane_t* p, const TriSetup_t* ts, const ScreenVertex_t* v0,
+    const ScreenVertex_t* v1, const ScreenVertex_t* v2)
+{
+    SetupGouraudChannel(&p->r, ts, v0->color, v1->color, v2->color, 11, 0x1F);
+    SetupGouraudChannel(&p->g, ts, v0->color, v1->color, v2->color, 5, 0x3F);
+    SetupGouraudChannel(&p->b, ts, v0->color, v1->color, v2->color, 0, 0x1F);
+    p->dx.r = ToGouraud(p->r.dx);
+    p->dx.g = ToGouraud(p->g.dx);
+    p->dx.b = ToGouraud(p->b.dx);
+}
+
+/* Light at (minX + x, minY + y), the start of a run that then steps */
+static inline Gouraud_t EvalGouraud(const GouraudPlane_t* p, int x, int y)
+{
+    float fx = (float)x, fy = (float)y;
+    Gouraud_t l = { ToGouraud(EvalPlane(&p->r, fx, fy)), ToGouraud(EvalPlane(&p->g, fx, fy)),
+        ToGouraud(EvalPlane(&p->b, fx, fy)) };
+    return l;
+}
+
+static inline void StepGouraud(Gouraud_t* l, const GouraudPlane_t* p)
+{
+    l->r += p->dx.r; l->g += p->dx.g; l->b += p->dx.b;
+}
+
+/* Steps drift past the triangle's colors by a fraction at most; the
+ * clamps only catch edge pixels */
+static inline uint16_t GouraudColor(const Gouraud_t* l)
+{
+    int r = Clampi(l->r >> RASTER_GOURAUD_BITS, 0, 31);
+    int g = Clampi(l->g >> RASTER_GOURAUD_BITS, 0, 63);
+    int b = Clampi(l->b >> RASTER_GOURAUD_BITS, 0, 31);
+    return (uint16_t)((r << 11) | (g << 5) | b);
+}
+
+static inline uint16_t ModulateGouraud(uint16_t texel, const Gouraud_t* l)
+{
+    return ModulateChannels(texel, Clampi(l->r >> RASTER_GOURAUD_BITS, 0, 31),
+        Clampi(l->g >> RASTER_GOURAUD_BITS, 0, 63), Clampi(l->b >> RASTER_GOURAUD_BITS, 0, 31));
+}
+
+/* Per-pixel shading, specialized on state. Untextured lit triangles
+ * take the stepped light; untextured unlit ones use v0's color. */
+template <bool LIT, bool BILINEAR, bool CLAMP>
+static inline uint16_t ShadeTexel(const Texture_t* texture, int32_t u, int32_t v, const Gouraud_t* light)
+{
+    uint16_t texel = SampleFixed<BILINEAR, CLAMP>(texture, u, v);
+    return LIT ? ModulateGouraud(texel, light) : texel;
+}
+
+/* Exact perspective divide per pixel; other textured cases step UVs in
+ * RasterShaded */
+template <bool TEXTURED, bool LIT, bool BILINEAR, bool CLAMP>
+static inline uint16_t ShadePixel(const ScreenVertex_t* v0, const ScreenVertex_t* v1,
+    const ScreenVertex_t* v2, const Texture_t* texture, float b0, float b1, float b2,
+    const Gouraud_t* light)
+{
+    if (!TEXTURED) {
+        return LIT ? GouraudColor(light) : v0->color;
+    }
+
+    float w0_inv = v0->w_inv, w1_inv = v1->w_inv, w2_inv = v2->w_inv;
+    float w = b0 * w0_inv + b1 * w1_inv + b2 * w2_inv;
+    float inv_w = 1.0f / w;
+    float u = (b0 * v0->u * w0_inv + b1 * v1->u * w1_inv + b2 * v2->u * w2_inv) * inv_w;
+    float v = (b0 * v0->v * w0_inv + b1 * v1->v * w1_inv + b2 * v2->v * w2_inv) * inv_w;
+
+    return ShadeTexel<LIT, BILINEAR, CLAMP>(texture, ToFixedUV(u), ToFixedUV(v), light);
+}
+
+#if RASTER_FIXED_POINT
+/* Integer plane over the triangle's pixel centers, value at
+ * (minX + x, minY + y) = origin + dx * x + dy * y. Vertex values arrive
+ * scaled to the plane's fixed point, at most 2^28 so extrapolating
+ * across the bounding box stays in range. */
+typedef struct {
+    int32_t origin, dx, dy;
+} FxPlane_t;
+
+#define RASTER_FX_COLOR_BITS    22      /* RGB565 channels in the color planes */
+#define RASTER_FX_RANGE_BITS    28
+
+static inline void SetupFxPlane(FxPlane_t* p, const TriSetup_t* ts, int32_t area,
+    int32_t a0, int32_t a1, int32_t a2)
+{
+    p->dx = (int32_t)(((int64_t)ts->A[0] * a0 + (int64_t)ts->A[1] * a1 + (int64_t)ts->A[2] * a2) / area);
+    p->dy = (int32_t)(((int64_t)ts->B[0] * a0 + (int64_t)ts->B[1] * a1 + (int64_t)ts->B[2] * a2) / area);
+    p->origin = (int32_t)(((int64_t)(ts->origin[0] - ts->bias[0]) * a0 + (int64_t)(ts->origin[1] - ts->bias[1]) * a1 +
+        (int64_t)(ts->origin[2] - ts->bias[2]) * a2) / area);
+}
+
+static inline int32_t EvalFxPlane(const FxPlane_t* p, int x, int y)
+{
+    return p->origin + p->dx * x + p->dy * y;
+}
+
+static inline int32_t FxDepth(float z)
+{
+    return (int32_t)(Clampf(z, 0.0f, 1.0f) * RASTER_FX_Z_SCALE);
+}
+
+/* Fraction bits putting max_abs just under 2^RASTER_FX_RANGE_BITS */
+static inline int FxFracBits(float max_abs, int lo, int hi)
+{
+    int e;
+    frexpf(max_abs, &e);
+    return Clampi(RASTER_FX_RANGE_BITS - e, lo, hi);
+}
+
+static inline int32_t FxFromFloat(float f, int frac)
+{
+    float limit = (float)(1 << RASTER_FX_RANGE_BITS);
+    return (int32_t)Clampf(f * (float)(1 << frac), -limit, limit);
+}
+
+static inline void SetupFxColor(FxPlane_t* p, const TriSetup_t* ts, int32_t area,
+    uint16_t c0, uint16_t c1, uint16_t c2, int shift, uint32_t mask)
+{
+    SetupFxPlane(p, ts, area, (int32_t)((c0 >> shift) & mask) << RASTER_FX_COLOR_BITS,
+        (int32_t)((c1 >> shift) & mask) << RASTER_FX_COLOR_BITS,
+        (int32_t)((c2 >> shift) & mask) << RASTER_FX_COLOR_BITS);
+    p->origin += 1 << (RASTER_FX_COLOR_BITS - 1);     /* Round like ColorLerp */
+}
+
+static inline uint16_t FxColor(int32_t r, int32_t g, int32_t b)
+{
+    int cr = Clampi(r >> RASTER_FX_COLOR_BITS, 0, 31);
+    int cg = Clampi(g >> RASTER_FX_COLOR_BITS, 0, 63);
+    int cb = Clampi(b >> RASTER_FX_COLOR_BITS, 0, 31);
+    return (uint16_t)((cr << 11) | (cg << 5) | cb);
+}
+
+template <bool TEXTURED, bool LIT, bool BILINEAR, bool CLAMP>
+static inline uint16_t ShadeFx(const ScreenVertex_t* v0, const Texture_t* texture,
+    int32_t u, int32_t v, int32_t r, int32_t g, int32_t b)
+{
+    if (!TEXTURED) return LIT ? FxColor(r, g, b) : v0->color;
+    uint16_t texel = SampleFixed<BILINEAR, CLAMP>(texture, u, v);
+    if (!LIT) return texel;
+    return ModulateChannels(texel, Clampi(r >> RASTER_FX_COLOR_BITS, 0, 31),
+        Clampi(g >> RASTER_FX_COLOR_BITS, 0, 63), Clampi(b >> RASTER_FX_COLOR_BITS, 0, 31));
+}
+#endif
+
+#if RASTER_FIXED_POINT
+/* Fixed-point variant: depth, light and UVs step as integer planes.
+ * Perspective spans divide u/w and v/w by 1/w through one table
+ * reciprocal per span end; a perspective span of 1 does it every pixel. */
+template <bool TEXTURED, bool LIT, bool DEPTH_TEST, bool DEPTH_WRITE, bool PERSPECTIVE,
+    bool BILINEAR, bool CLAMP>
+static void RasterShaded(const ScreenVertex_t* v0, const ScreenVertex_t* v1,
+    const ScreenVertex_t* v2, const Texture_t* texture, const RasterTarget_t* t)
+{
+    TriSetup_t ts;
+    int32_t area = SetupTriangle(v0, v1, v2, t->min_x, t->min_y, t->max_x, t->max_y, &ts);
+    if (area <= 0) return;
+
+    const int32_t* A = ts.A;
+    const int32_t* B = ts.B;
+    int minX = ts.minX, maxX = ts.maxX, minY = ts.minY, maxY = ts.maxY;
+    uint16_t zmin16 = Depth_ToZ16(MIN(v0->z, MIN(v1->z, v2->z)));
+    uint32_t drawn_before = t->stats->pixels_drawn;
+    t->stats->pixels_bbox += (uint32_t)((maxX - minX + 1) * (maxY - minY + 1));
+
+    Texture_t level;
+    if (TEXTURED) texture = SelectLevel(texture, v0, v1, v2, ts.inv_area, &level);
+
+    FxPlane_t z_plane, r_plane = {}, g_plane = {}, b_plane = {};
+    SetupFxPlane(&z_plane, &ts, area, FxDepth(v0->z), FxDepth(v1->z), FxDepth(v2->z));
+    if (LIT) {
+        SetupFxColor(&r_plane, &ts, area, v0->color, v1->color, v2->color, 11, 0x1F);
+        SetupFxColor(&g_plane, &ts, area, v0->color, v1->color, v2->color, 5, 0x3F);
+        SetupFxColor(&b_plane, &ts, area, v0->color, v1->color, v2->color, 0, 0x1F);
+    }
+
+    /* Affine UVs in uv_shift + 16 fraction bits; perspective u/w, v/w and
+     * 1/w share one scale, which the divide cancels */
+    FxPlane_t u_plane = {}, v_plane = {}, q_plane = {};
+    int uv_shift = 0;
+    if (TEXTURED && PERSPECTIVE) {
+        float q[3] = { v0->w_inv, v1->w_inv, v2->w_inv };
+        float uq[3] = { v0->u * q[0], v1->u * q[1], v2->u * q[2] };
+        float vq[3] = { v0->v * q[0], v1->v * q[1], v2->v * q[2] };
+        float m = 0.0f;
+        for (int i = 0; i < 3; i++) m = MAX(m, MAX(fabsf(q[i]), MAX(fabsf(uq[i]), fabsf(vq[i]))));
+        int frac = FxFracBits(m, 0, 30);
+        SetupFxPlane(&q_plane, &ts, area, FxFromFloat(q[0], frac), FxFromFloat(q[1], frac), FxFromFloat(q[2], frac));
+        SetupFxPlane(&u_plane, &ts, area, FxFromFloat(uq[0], frac), FxFromFloat(uq[1], frac), FxFromFloat(uq[2], frac));
+        SetupFxPlane(&v_plane, &ts, area, FxFromFloat(vq[0], frac), FxFromFloat(vq[1], frac), FxFromFloat(vq[2], frac));
+    }
+    else if (TEXTURED) {
+        float m = MAX(MAX(fabsf(v0->u), fabsf(v1->u)), MAX(fabsf(v2->u), MAX(fabsf(v0->v), MAX(fabsf(v1->v), fabsf(v2->v)))));
+        int frac = FxFracBits(m, FX_SHIFT, 30);
+        uv_shift = frac - FX_SHIFT;
+        SetupFxPlane(&u_plane, &ts, area, FxFromFloat(v0->u, frac), FxFromFloat(v1->u, frac), FxFromFloat(v2->u, frac));
+        SetupFxPlane(&v_plane, &ts, area, FxFromFloat(v0->v, frac), FxFromFloat(v1->v, frac), FxFromFloat(v2->v, frac));
+    }
+    int span = (TEXTURED && PERSPECTIVE) ? t->perspective_span : RASTER_BLOCK;
+
+    RasterWalk_t walk;
+    WalkBegin(&walk, &ts, UseSpans(t, &ts, area));
+    while (WalkNext(&walk)) {
+        int bx = walk.bx, by = walk.by, bw = walk.bw, bh = walk.bh;
+        int coverage = walk.coverage;
+        int32_t e[3] = { walk.e[0], walk.e[1], walk.e[2] };
+        if (DEPTH_TEST && !walk.spans && HiZReject(t, walk.cx, walk.cy, zmin16)) continue;
+        t->stats->pixels_visited += (uint32_t)(bw * bh);
+
+        for (int y = by; y < by + bh; y++) {
+            int32_t w0 = e[0], w1 = e[1], w2 = e[2];
+            int fx = bx - minX, fy = y - minY;
+            int32_t z = EvalFxPlane(&z_plane, fx, fy);
+            int32_t r = 0, g = 0, b = 0;
+            if (LIT) {
+                r = EvalFxPlane(&r_plane, fx, fy);
+                g = EvalFxPlane(&g_plane, fx, fy);
+                b = EvalFxPlane(&b_plane, fx, fy);
+            }
+
+            /* 16.16 UVs of the current pixel; affine ones step their planes */
+            int32_t u = 0, v = 0, du = 0, dv = 0, pu = 0, pv = 0;
+            if (TEXTURED && PERSPECTIVE) {
+                FxRecip_t rq = Fx_Recip(EvalFxPlane(&q_plane, fx, fy));
+                u = Fx_MulRecip(EvalFxPlane(&u_plane, fx, fy), rq);
+                v = Fx_MulRecip(EvalFxPlane(&v_plane, fx, fy), rq);
+            }
+            else if (TEXTURED) {
+                pu = EvalFxPlane(&u_plane, fx, fy);
+                pv = EvalFxPlane(&v_plane, fx, fy);
+            }
+
+            for (int sx = bx; sx < bx + bw; sx += span) {
+                int len = MIN(span, bx + bw - sx);
+                int32_t u_end = 0, v_end = 0;
+                if (TEXTURED && PERSPECTIVE) {
+                    /* End point doubles as the next span's start */
+                    fx += len;
+                    FxRecip_t rq = Fx_Recip(EvalFxPlane(&q_plane, fx, fy));
+                    u_end = Fx_MulRecip(EvalFxPlane(&u_plane, fx, fy), rq);
+                    v_end = Fx_MulRecip(EvalFxPlane(&v_plane, fx, fy), rq);
+                    du = (len == 1) ? u_end - u : (u_end - u) / len;
+                    dv = (len == 1) ? v_end - v : (v_end - v) / len;
+                }
+
+                for (int x = sx; x < sx + len; x++) {
+                    if (coverage == BLOCK_INSIDE || (w0 | w1 | w2) >= 0) {
+                        int idx = PixelIndex(t, x, y);
+                        if (DepthPass<DEPTH_TEST, DEPTH_WRITE>(t, idx, z)) {
+                            if (TEXTURED && !PERSPECTIVE) {
+                                u = pu >> uv_shift;
+                                v = pv >> uv_shift;
+                            }
+                            WriteColor(t, idx, ShadeFx<TEXTURED, LIT, BILINEAR, CLAMP>(v0, texture, u, v, r, g, b));
+                        }
+                        else {
+                            t->stats->pixels_depth_rejected++;
+                        }
+                    }
+                    w0 += A[0]; w1 += A[1]; w2 += A[2];
+                    z += z_plane.dx;
+                    if (LIT) { r += r_plane.dx; g += g_plane.dx; b += b_plane.dx; }
+                    if (TEXTURED && PERSPECTIVE) { u += du; v += dv; }
+                    else if (TEXTURED) { pu += u_plane.dx; pv += v_plane.dx; }
+                }
+                if (TEXTURED && PERSPECTIVE) { u = u_end; v = v_end; }
+            }
+            e[0] += B[0]; e[1] += B[1]; e[2] += B[2];
+        }
+        if (DEPTH_WRITE && !walk.spans && coverage == BLOCK_INSIDE) HiZUpdate(t, walk.cx, walk.cy);
+    }
+
+    /* Every drawn pixel sampled once, or a 2x2 footprint */
+    if (TEXTURED) t->stats->texels_fetched += (t->stats->pixels_drawn - drawn_before) * (BILINEAR ? 4 : 1);
+}
+#else
+#if RASTER_LANES > 1
+/* Depths of the next lanes from the edge values w of the first, the
+ * same barycentric sums as RasterShaded's per-pixel loops */
+#ifdef RASTER_SSE
+static inline ZGroup_t ZGroupEdges(const int32_t* w, const TriSetup_t* ts, const ScreenVertex_t* v0,
+    const ScreenVertex_t* v1, const ScreenVertex_t* v2)
+{
+    __m128 b[3];
+    for (int i = 0; i < 3; i++) {
+        int32_t e = w[i] - ts->bias[i], a = ts->A[i];
+        b[i] = _mm_mul_ps(_mm_cvtepi32_ps(_mm_set_epi32(e + 3 * a, e + 2 * a, e + a, e)), _mm_set1_ps(ts->inv_area));
+    }
+    return _mm_add_ps(_mm_add_ps(_mm_mul_ps(b[0], _mm_set1_ps(v0->z)), _mm_mul_ps(b[1], _mm_set1_ps(v1->z))),
+        _mm_mul_ps(b[2], _mm_set1_ps(v2->z)));
+}
+
+/* GouraudColor() of four steps of the light at once */
+static inline ColorLanes_t GouraudLanes(const Gouraud_t* l, const Gouraud_t* d)
+{
+    __m128i r = _mm_srai_epi32(_mm_set_epi32(l->r + 3 * d->r, l->r + 2 * d->r, l->r + d->r, l->r), RASTER_GOURAUD_BITS);
+    __m128i g = _mm_srai_epi32(_mm_set_epi32(l->g + 3 * d->g, l->g + 2 * d->g, l->g + d->g, l->g), RASTER_GOURAUD_BITS);
+    __m128i b = _mm_srai_epi32(_mm_set_epi32(l->b + 3 * d->b, l->b + 2 * d->b, l->b + d->b, l->b), RASTER_GOURAUD_BITS);
+    __m128i zero = _mm_setzero_si128();
+    r = _mm_min_epi16(_mm_max_epi16(_mm_packs_epi32(r, r), zero), _mm_set1_epi16(31));
+    g = _mm_min_epi16(_mm_max_epi16(_mm_packs_epi32(g, g), zero), _mm_set1_epi16(63));
+    b = _mm_min_epi16(_mm_max_epi16(_mm_packs_epi32(b, b), zero), _mm_set1_epi16(31));
+    return _mm_or_si128(_mm_or_si128(_mm_slli_epi16(r, 11), _mm_slli_epi16(g, 5)), b);
+}
+#endif
+
+#ifdef RASTER_DSP
+static inline ZGroup_t ZGroupEdges(const int32_t* w, const TriSetup_t* ts, const ScreenVertex_t* v0,
+    const ScreenVertex_t* v1, const ScreenVertex_t* v2)
+{
+    ZGroup_t g;
+    for (int k = 0; k < RASTER_LANES; k++) {
+        float b0 = (w[0] + k * ts->A[0] - ts->bias[0]) * ts->inv_area;
+        float b1 = (w[1] + k * ts->A[1] - ts->bias[1]) * ts->inv_area;
+        float b2 = (w[2] + k * ts->A[2] - ts->bias[2]) * ts->inv_area;
+        g.z[k] = b0 * v0->z + b1 * v1->z + b2 * v2->z;
+    }
+    return g;
+}
+#endif
+
+/* The pixels x..end-1 of row y of a block inside the triangle,
+ * RASTER_LANES at a time, for RasterShaded: depth and the depth test
+ * per group, then colors for the lanes that passed. Solid and (SSE)
+ * Gouraud colors are computed a group at a time and stored masked;
+ * texels are still fetched and written per lane. Partly covered blocks
+ * stay per pixel, where the group test measured slower. w, u, v and
+ * the light step past the pixels taken; returns the first x left for
+ * the per-pixel loop, whose results these match. */
+template <bool TEXTURED, bool LIT, bool DEPTH_TEST, bool DEPTH_WRITE, bool BILINEAR, bool CLAMP>
+static inline int ShadeGroups(const RasterTarget_t* t, const TriSetup_t* ts, const ScreenVertex_t* v0,
+    const ScreenVertex_t* v1, const ScreenVertex_t* v2, const Texture_t* texture,
+    int x, int end, int y, int32_t* w, int32_t* u, int32_t* v, int32_t du, int32_t dv,
+    Gouraud_t* light, const GouraudPlane_t* light_plane)
+{
+#ifdef RASTER_SSE
+    const bool per_lane = TEXTURED;
+#else
+    const bool per_lane = TEXTURED || LIT;
+#endif
+    /* Locals: the stores to color could otherwise alias any of these */
+    const int32_t a0 = ts->A[0], a1 = ts->A[1], a2 = ts->A[2];
+    int32_t e[3] = { w[0], w[1], w[2] };
+    int32_t lu = *u, lv = *v;
+    Gouraud_t l = *light;
+    Texture_t tex;
+    if (TEXTURED) tex = *texture;
+    int idx = PixelIndex(t, x, y);
+    uint16_t* color = &t->color[idx];
+    uint16_t* depth = &t->depth[idx];
+    GroupCount_t n = { 0, 0 };
+    for (; x + RASTER_LANES <= end; x += RASTER_LANES) {
+        uint32_t bits = DepthGroup<DEPTH_TEST, DEPTH_WRITE>(depth, LANES_ALL, ZGroupEdges(e, ts, v0, v1, v2), &n);
+        e[0] += RASTER_LANES * a0; e[1] += RASTER_LANES * a1; e[2] += RASTER_LANES * a2;
+
+        if (per_lane) {
+            for (int k = 0; k < RASTER_LANES; k++) {
+                if (bits & (1u << k)) {
+                    color[k] = TEXTURED ? ShadeTexel<LIT, BILINEAR, CLAMP>(&tex, lu, lv, &l) : GouraudColor(&l);
+                }
+                lu += du; lv += dv;
+                if (LIT) StepGouraud(&l, light_plane);
+            }
+            n.drawn += LaneCount(bits);
+        }
+        else {
+            ColorLanes_t c = SplatLanes(v0->color);
+#ifdef RASTER_SSE
+            if (LIT) c = GouraudLanes(&l, &light_plane->dx);
+#endif
+            StoreGroup(color, bits, c, &n);
+            if (LIT) {
+                for (int k = 0; k < RASTER_LANES; k++) StepGouraud(&l, light_plane);
+            }
+        }
+        color += RASTER_LANES;
+        depth += RASTER_LANES;
+    }
+    w[0] = e[0]; w[1] = e[1]; w[2] = e[2];
+    *u = lu; *v = lv;
+    *light = l;
+    t->stats->pixels_drawn += n.drawn;
+    t->stats->pixels_depth_rejected += n.rejected;
+    return x;
+}
+#endif
+
+template <bool TEXTURED, bool LIT, bool DEPTH_TEST, bool DEPTH_WRITE, bool PERSPECTIVE,
+    bool BILINEAR, bool CLAMP>
+static void RasterShaded(const ScreenVertex_t* v0, const ScreenVertex_t* v1,
+    const ScreenVertex_t* v2, const Texture_t* texture, const RasterTarget_t* t)
+{
+    TriSetup_t ts;
+    int32_t area = SetupTriangle(v0, v1, v2, t->min_x, t->min_y, t->max_x, t->max_y, &ts);
+    if (area <= 0) return;
+
+    const int32_t* A = ts.A;
+    const int32_t* B = ts.B;
+    const int32_t* bias = ts.bias;
+    float invArea = ts.inv_area;
+    int minX = ts.minX, maxX = ts.maxX, minY = ts.minY, maxY = ts.maxY;
+    uint16_t zmin16 = Depth_ToZ16(MIN(v0->z, MIN(v1->z, v2->z)));
+    uint32_t drawn_before = t->stats->pixels_drawn;
+    t->stats->pixels_bbox += (uint32_t)((maxX - minX + 1) * (maxY - minY + 1));
+
+    Texture_t level;
+    if (TEXTURED) texture = SelectLevel(texture, v0, v1, v2, invArea, &level);
+
+    GouraudPlane_t light_plane;
+    if (LIT) SetupGouraud(&light_plane, &ts, v0, v1, v2);
+
+    /* Span subdivision: exact u/v at span ends, 16.16 steps in between.
+     * Affine UVs are linear, so their spans cover the whole block row. */
+    int span = !TEXTURED ? 1 : PERSPECTIVE ? t->perspective_span : RASTER_BLOCK;
+    AttribPlane_t q_plane = {}, u_plane = {}, v_plane = {};
+    float inv_span = 1.0f;
+    if (span > 1) {
+        if (PERSPECTIVE) {
+            SetupPlane(&q_plane, &ts, v0->w_inv, v1->w_inv, v2->w_inv);
+            SetupPlane(&u_plane, &ts, v0->u * v0->w_inv, v1->u * v1->w_inv, v2->u * v2->w_inv);
+            SetupPlane(&v_plane, &ts, v0->v * v0->w_inv, v1->v * v1->w_inv, v2->v * v2->w_inv);
+        }
+        else {
+            SetupPlane(&u_plane, &ts, v0->u, v1->u, v2->u);
+            SetupPlane(&v_plane, &ts, v0->v, v1->v, v2->v);
+        }
+        inv_span = 1.0f / (float)span;
+    }
+#if RASTER_LANES > 1
+    int groups = GroupTarget(t);
+#endif
+
+    RasterWalk_t walk;
+    WalkBegin(&walk, &ts, UseSpans(t, &ts, area));
+    while (WalkNext(&walk)) {
+        int bx = walk.bx, by = walk.by, bw = walk.bw, bh = walk.bh;
+        int coverage = walk.coverage;
+        int32_t e[3] = { walk.e[0], walk.e[1], walk.e[2] };
+        if (DEPTH_TEST && !walk.spans && HiZReject(t, walk.cx, walk.cy, zmin16)) continue;
+        t->stats->pixels_visited += (uint32_t)(bw * bh);
+
+        for (int y = by; y < by + bh; y++) {
+            int32_t w0 = e[0], w1 = e[1], w2 = e[2];
+            Gouraud_t light = { 0, 0, 0 };
+            if (LIT) light = EvalGouraud(&light_plane, bx - minX, y - minY);
+
+            if (span > 1) {
+                float fy = (float)(y - minY);
+                float fx = (float)(bx - minX);
+                float q = PERSPECTIVE ? Math_Recip(EvalPlane(&q_plane, fx, fy)) : 1.0f;
+                float u_start = EvalPlane(&u_plane, fx, fy) * q;
+                float v_start = EvalPlane(&v_plane, fx, fy) * q;
+
+                for (int sx = bx; sx < bx + bw; sx += span) {
+                    int len = MIN(span, bx + bw - sx);
+                    fx += (float)len;
+                    /* End point doubles as the next span's start */
+                    float q_end = PERSPECTIVE ? Math_Recip(EvalPlane(&q_plane, fx, fy)) : 1.0f;
+                    float u_end = EvalPlane(&u_plane, fx, fy) * q_end;
+                    float v_end = EvalPlane(&v_plane, fx, fy) * q_end;
+                    float step = (len == span) ? inv_span : 1.0f / (float)len;
+                    int32_t u = ToFixedUV(u_start), v = ToFixedUV(v_start);
+                    int32_t du = ToFixedUV((u_end - u_start) * step), dv = ToFixedUV((v_end - v_start) * step);
+                    int x = sx;
+#if RASTER_LANES > 1
+                    /* Texels are fetched per lane either way; lit spans
+                     * measured slower in groups */
+                    if (!LIT && groups && coverage == BLOCK_INSIDE && len >= RASTER_LANES) {
+                        int32_t w[3] = { w0, w1, w2 };
+                        x = ShadeGroups<TEXTURED, LIT, DEPTH_TEST, DEPTH_WRITE, BILINEAR, CLAMP>(t, &ts, v0, v1, v2,
+                            texture, x, sx + len, y, w, &u, &v, du, dv, &light, &light_plane);
+                        w0 = w[0]; w1 = w[1]; w2 = w[2];
+                    }
+#endif
+
+                    for (; x < sx + len; x++) {
+                        if (coverage == BLOCK_INSIDE || (w0 | w1 | w2) >= 0) {
+                            float b0 = (w0 - bias[0]) * invArea, b1 = (w1 - bias[1]) * invArea, b2 = (w2 - bias[2]) * invArea;
+                            float z = b0 * v0->z + b1 * v1->z + b2 * v2->z;
+                            int idx = PixelIndex(t, x, y);
+                            if (DepthPass<DEPTH_TEST, DEPTH_WRITE>(t, idx, z)) {
+                                WriteColor(t, idx, ShadeTexel<LIT, BILINEAR, CLAMP>(texture, u, v, &light));
+                            }
+                            else {
+                                t->stats->pixels_depth_rejected++;
+                            }
+                        }
+                        w0 += A[0]; w1 += A[1]; w2 += A[2];
+                        u += du; v += dv;
+                        if (LIT) StepGouraud(&light, &light_plane);
+                    }
+                    u_start = u_end; v_start = v_end;
+                }
+                e[0] += B[0]; e[1] += B[1]; e[2] += B[2];
+                continue;
+            }
+
+            int x = bx;
+#if RASTER_LANES > 1
+            /* Per-pixel perspective divides stay in the loop below */
+            if (!TEXTURED && groups && coverage == BLOCK_INSIDE && bw >= RASTER_LANES) {
+                int32_t w[3] = { w0, w1, w2 }, u = 0, v = 0;
+                x = ShadeGroups<TEXTURED, LIT, DEPTH_TEST, DEPTH_WRITE, BILINEAR, CLAMP>(t, &ts, v0, v1, v2,
+                    texture, x, bx + bw, y, w, &u, &v, 0, 0, &light, &light_plane);
+                w0 = w[0]; w1 = w[1]; w2 = w[2];
+            }
+#endif
+            for (; x < bx + bw; x++) {
+                if (coverage == BLOCK_INSIDE || (w0 | w1 | w2) >= 0) {
+                    float b0 = (w0 - bias[0]) * invArea, b1 = (w1 - bias[1]) * invArea, b2 = (w2 - bias[2]) * invArea;
+                    float z = b0 * v0->z + b1 * v1->z + b2 * v2->z;
+                    int idx = PixelIndex(t, x, y);
+                    if (DepthPass<DEPTH_TEST, DEPTH_WRITE>(t, idx, z)) {
+                        WriteColor(t, idx, ShadePixel<TEXTURED, LIT, BILINEAR, CLAMP>(v0, v1, v2, texture, b0, b1, b2, &light));
+                    }
+                    else {
+                        t->stats->pixels_depth_rejected++;
+                    }
+                }
+                w0 += A[0]; w1 += A[1]; w2 += A[2];
+                if (LIT) StepGouraud(&light, &light_plane);
+            }
+            e[0] += B[0]; e[1] += B[1]; e[2] += B[2];
+        }
+        if (DEPTH_WRITE && !walk.spans && coverage == BLOCK_INSIDE) HiZUpdate(t, walk.cx, walk.cy);
+    }
+
+    /* Every drawn pixel sampled once, or a 2x2 footprint */
+    if (TEXTURED) t->stats->texels_fetched += (t->stats->pixels_drawn - drawn_before) * (BILINEAR ? 4 : 1);
+}
+#endif
+
+/* ============================================================
+ * Heat Map
+ * ============================================================ */
+
+static inline void HeatAdd(uint16_t* cell, uint32_t weight)
+{
+    uint32_t sum = *cell + weight;
+    *cell = (uint16_t)MIN(sum, 0xFFFFu);
+}
+
+/* Counts instead of shading; cost mode only spreads `weight` over the
+ * coverage, after the triangle has been rendered and counted */
+template <bool DEPTH_TEST, bool DEPTH_WRITE>
+static inline void HeatPixel(const RasterTarget_t* t, int x, int y, RasterZ_t z, uint32_t weight)
+{
+    uint16_t* cell = &t->heat[y * DISPLAY_WIDTH + x];
+    if (t->heat_mode == RASTER_HEAT_COST) {
+        HeatAdd(cell, weight);
+        return;
+    }
+    if (t->heat_mode == RASTER_HEAT_TESTED) HeatAdd(cell, 1);
+    if (DepthPass<DEPTH_TEST, DEPTH_WRITE>(t, PixelIndex(t, x, y), z)) {
+        if (t->heat_mode == RASTER_HEAT_SHADED) HeatAdd(cell, 1);
+        t->stats->pixels_drawn++;
+    }
+    else {
+        t->stats->pixels_depth_rejected++;
+    }
+}
+
+/* ============================================================
+ * Flat Pixel Loop
+ * ============================================================ */
+
+/* Depth-only prepass pixel (RASTER_STATE_DEPTH_ONLY): tested as usual,
+ * stored RASTER_PREPASS_BIAS units farther. The shading pass's strict
+ * test then lets through the nearest surface again, even where its
+ * pixel loop rounds depth a unit differently, and nothing behind it. */
+#if RASTER_FIXED_POINT
+#define PREPASS_Z_BIAS      ((RasterZ_t)RASTER_PREPASS_BIAS << RASTER_FX_Z_BITS)
+#else
+#define PREPASS_Z_BIAS      ((float)RASTER_PREPASS_BIAS / 65535.0f)
+#endif
+
+static inline void PrepassPixel(const RasterTarget_t* t, int idx, RasterZ_t z)
+{
+    if (!DepthPass<true, true>(t, idx, z + PREPASS_Z_BIAS)) t->stats->pixels_depth_rejected++;
+}
+
+/* What RasterFlat() does per covered pixel */
+enum { FLAT_COLOR = 0, FLAT_HEAT, FLAT_DEPTH };
+
+/* Flat color fill, the heat map pass with `value` as the weight, or the
+ * depth-only prepass; only depth state matters. Returns the pixels
+ * covered when FLAT_HEAT. */
+template <bool DEPTH_TEST, bool DEPTH_WRITE, int MODE>
+static uint32_t RasterFlat(const ScreenVertex_t* v0, const ScreenVertex_t* v1,
+    const ScreenVertex_t* v2, uint32_t value, const RasterTarget_t* t)
+{
+    TriSetup_t ts;
+    int32_t area = SetupTriangle(v0, v1, v2, t->min_x, t->min_y, t->max_x, t->max_y, &ts);
+    if (area <= 0) return 0;
+
+    const int32_t* A = ts.A;
+    const int32_t* B = ts.B;
+    int minX = ts.minX, maxX = ts.maxX, minY = ts.minY, maxY = ts.maxY;
+    uint16_t zmin16 = Depth_ToZ16(MIN(v0->z, MIN(v1->z, v2->z)));
+    int counted = MODE != FLAT_HEAT || t->heat_mode != RASTER_HEAT_COST;     /* Cost passes repeat a counted draw */
+    uint32_t covered = 0;
+    if (counted) t->stats->pixels_bbox += (uint32_t)((maxX - minX + 1) * (maxY - minY + 1));
+
+    /* Depth plane z = dzdx * x + dzdy * y + c, anchored at (minX, minY) */
+#if RASTER_FIXED_POINT
+    FxPlane_t z_plane;
+    SetupFxPlane(&z_plane, &ts, area, FxDepth(v0->z), FxDepth(v1->z), FxDepth(v2->z));
+    RasterZ_t dzdx = z_plane.dx, dzdy = z_plane.dy, z_origin = z_plane.origin;
+#else
+    float dzdx = (A[0] * v0->z + A[1] * v1->z + A[2] * v2->z) * ts.inv_area;
+    float dzdy = (B[0] * v0->z + B[1] * v1->z + B[2] * v2->z) * ts.inv_area;
+    float z_origin = ((ts.origin[0] - ts.bias[0]) * v0->z + (ts.origin[1] - ts.bias[1]) * v1->z +
+        (ts.origin[2] - ts.bias[2]) * v2->z) * ts.inv_area;
+#endif
+
+#if RASTER_LANES > 1
+    int groups = MODE == FLAT_COLOR && GroupTarget(t);
+#endif
+
+    RasterWalk_t walk;
+    WalkBegin(&walk, &ts, UseSpans(t, &ts, area));
+    while (WalkNext(&walk)) {
+        int bx = walk.bx, by = walk.by, bw = walk.bw, bh = walk.bh;
+        int coverage = walk.coverage;
+        int32_t e[3] = { walk.e[0], walk.e[1], walk.e[2] };
+        if (DEPTH_TEST && !walk.spans && HiZReject(t, walk.cx, walk.cy, zmin16)) continue;
+        if (counted) t->stats->pixels_visited += (uint32_t)(bw * bh);
+
+        for (int y = by; y < by + bh; y++) {
+            RasterZ_t z = z_origin + dzdx * (RasterZ_t)(bx - minX) + dzdy * (RasterZ_t)(y - minY);
+            int x = bx;
+
+#if RASTER_LANES > 1
+            /* z still steps pixel by pixel, so the groups match the loops below */
+            if (groups && bw >= RASTER_LANES) {
+                int32_t w0 = e[0], w1 = e[1], w2 = e[2];
+                int idx = PixelIndex(t, x, y);
+                uint16_t* color = &t->color[idx];
+                uint16_t* depth = &t->depth[idx];
+                GroupCount_t n = { 0, 0 };
+                for (; x + RASTER_LANES <= bx + bw; x += RASTER_LANES) {
+                    uint32_t cover = LANES_ALL;
+                    if (coverage != BLOCK_INSIDE) {
+                        cover = 0;
+                        for (int k = 0; k < RASTER_LANES; k++) {
+                            if ((w0 | w1 | w2) >= 0) cover |= 1u << k;
+                            w0 += A[0]; w1 += A[1]; w2 += A[2];
+                        }
+                    }
+                    ZGroup_t zg = ZGroupStep(&z, dzdx);
+                    ColorGroup(color, DepthGroup<DEPTH_TEST, DEPTH_WRITE>(depth, cover, zg, &n), (uint16_t)value, &n);
+                    covered += LaneCount(cover);
+                    color += RASTER_LANES;
+                    depth += RASTER_LANES;
+                }
+                t->stats->pixels_drawn += n.drawn;
+                t->stats->pixels_depth_rejected += n.rejected;
+            }
+#endif
+            if (coverage == BLOCK_INSIDE) {
+                for (; x < bx + bw; x++) {
+                    if (MODE == FLAT_HEAT) HeatPixel<DEPTH_TEST, DEPTH_WRITE>(t, x, y, z, value);
+                    else if (MODE == FLAT_DEPTH) PrepassPixel(t, PixelIndex(t, x, y), z);
+                    else WritePixel<DEPTH_TEST, DEPTH_WRITE>(t, x, y, z, (uint16_t)value);
+                    z += dzdx;
+                }
+                covered += (uint32_t)(bx + bw - x);
+            }
+            else {
+                int32_t w0 = e[0] + A[0] * (x - bx), w1 = e[1] + A[1] * (x - bx), w2 = e[2] + A[2] * (x - bx);
+                for (; x < bx + bw; x++) {
+                    if ((w0 | w1 | w2) >= 0) {
+                        if (MODE == FLAT_HEAT) HeatPixel<DEPTH_TEST, DEPTH_WRITE>(t, x, y, z, value);
+                        else if (MODE == FLAT_DEPTH) PrepassPixel(t, PixelIndex(t, x, y), z);
+                        else WritePixel<DEPTH_TEST, DEPTH_WRITE>(t, x, y, z, (uint16_t)value);
+                        covered++;
+                    }
+                    w0 += A[0]; w1 += A[1]; w2 += A[2];
+                    z += dzdx;
+                }
+            }
+            e[0] += B[0]; e[1] += B[1]; e[2] += B[2];
+        }
+        if (DEPTH_WRITE && !walk.spans && coverage == BLOCK_INSIDE) HiZUpdate(t, walk.cx, walk.cy);
+    }
+    return covered;
+}
+
+template <bool DEPTH_TEST, bool DEPTH_WRITE>
+static void RasterSolid(const ScreenVertex_t* v0, const ScreenVertex_t* v1,
+    const ScreenVertex_t* v2, uint16_t color, const RasterTarget_t* t)
+{
+    RasterFlat<DEPTH_TEST, DEPTH_WRITE, FLAT_COLOR>(v0, v1, v2, color, t);
+}
+
+template <bool DEPTH_TEST, bool DEPTH_WRITE>
+static uint32_t RasterHeat(const ScreenVertex_t* v0, const ScreenVertex_t* v1,
+    const ScreenVertex_t* v2, uint32_t weight, const RasterTarget_t* t)
+{
+    return RasterFlat<DEPTH_TEST, DEPTH_WRITE, FLAT_HEAT>(v0, v1, v2, weight, t);
+}
+
+/* ============================================================
+ * Pipeline Variants
+ * ============================================================ */
+
+/* Variant key: one bit per template parameter */
+#define VARIANT_TEXTURED     (1 << 0)
+#define VARIANT_LIT          (1 << 1)
+#define VARIANT_DEPTH_TEST   (1 << 2)
+#define VARIANT_DEPTH_WRITE  (1 << 3)
+#define VARIANT_PERSPECTIVE  (1 << 4)
+#define VARIANT_BILINEAR     (1 << 5)
+#define VARIANT_CLAMP        (1 << 6)
+#define VARIANT_COUNT        128
+#define VARIANT_DEPTH_ONLY   (1 << 7)    /* Prepass, outside the table: RasterDepthOnly() */
+
+typedef void (*ShadedFunc_t)(const ScreenVertex_t*, const ScreenVertex_t*,
+    const ScreenVertex_t*, const Texture_t*, const RasterTarget_t*);
+typedef void (*SolidFunc_t)(const ScreenVertex_t*, const ScreenVertex_t*,
+    const ScreenVertex_t*, uint16_t, const RasterTarget_t*);
+
+template <uint32_t KEY>
+static void RasterShadedVariant(const ScreenVertex_t* v0, const ScreenVertex_t* v1,
+    const ScreenVertex_t* v2, const Texture_t* texture, const RasterTarget_t* t)
+{
+    RasterShaded<(KEY & VARIANT_TEXTURED) != 0, (KEY & VARIANT_LIT) != 0,
+        (KEY & VARIANT_DEPTH_TEST) != 0, (KEY & VARIANT_DEPTH_WRITE) != 0,
+        (KEY & VARIANT_PERSPECTIVE) != 0, (KEY & VARIANT_BILINEAR) != 0,
+        (KEY & VARIANT_CLAMP) != 0>(v0, v1, v2, texture, t);
+}
+
+#define VARIANTS_4(n) RasterShadedVariant<(n)>, RasterShadedVariant<(n) + 1>, \
+    RasterShadedVariant<(n) + 2>, RasterShadedVariant<(n) + 3>
+#define VARIANTS_32(n) VARIANTS_4(n), VARIANTS_4((n) + 4), VARIANTS_4((n) + 8), VARIANTS_4((n) + 12), \
+    VARIANTS_4((n) + 16), VARIANTS_4((n) + 20), VARIANTS_4((n) + 24), VARIANTS_4((n) + 28)
+
+static const ShadedFunc_t g_shaded_variants[VARIANT_COUNT] = {
+    VARIANTS_32(0), VARIANTS_32(32), VARIANTS_32(64), VARIANTS_32(96)
+};
+
+/* Indexed by (key >> 2) & 3: depth test, depth write */
+static const SolidFunc_t g_solid_variants[4] = {
+    RasterSolid<false, false>, RasterSolid<true, false>,
+    RasterSolid<false, true>,  RasterSolid<true, true>
+};
+
+static inline uint8_t VariantKey(uint32_t state, int textured)
+{
+    if (state & RASTER_STATE_DEPTH_ONLY) return VARIANT_DEPTH_ONLY | VARIANT_DEPTH_TEST | VARIANT_DEPTH_WRITE;
+    uint8_t key = 0;
+    if (textured) {
+        key |= VARIANT_TEXTURED;
+        if (state & RASTER_STATE_BILINEAR) key |= VARIANT_BILINEAR;
+        if (state & RASTER_STATE_CLAMP) key |= VARIANT_CLAMP;
+    }
+    if (!(state & RASTER_STATE_UNLIT)) key |= VARIANT_LIT;
+    if (state & RASTER_STATE_DEPTH_TEST) key |= VARIANT_DEPTH_TEST;
+    if (state & RASTER_STATE_DEPTH_WRITE) key |= VARIANT_DEPTH_WRITE;
+    if (!(state & RASTER_STATE_AFFINE)) key |= VARIANT_PERSPECTIVE;
+    return key;
+}
+
+typedef uint32_t (*HeatFunc_t)(const ScreenVertex_t*, const ScreenVertex_t*,
+    const ScreenVertex_t*, uint32_t, const RasterTarget_t*);
+
+/* Indexed like g_solid_variants */
+static const HeatFunc_t g_heat_variants[4] = {
+    RasterHeat<false, false>, RasterHeat<true, false>,
+    RasterHeat<false, true>,  RasterHeat<true, true>
+};
+
+/* ============================================================
+ * Small Triangles
+ * Triangles whose pixel-center bounds are at most RASTER_SMALL_SIZE
+ * square, mostly distant models, cover a handful of pixels. They skip
+ * the edge setup and 1/area: each center is tested directly, and depth
+ * and color are taken once at the centroid for all covered pixels. The
+ * covered pixels are exactly those of the full path.
+ * ============================================================ */
+
+#define RASTER_SMALL_SIZE       2       /* 0 sends every triangle through the full path */
+
+template <bool BILINEAR, bool CLAMP>
+static inline uint16_t SmallTexel(const Texture_t* texture, float u, float v)
+{
+    return SampleFixed<BILINEAR, CLAMP>(texture, ToFixedUV(u), ToFixedUV(v));
+}
+
+/* Centroid color of a small triangle for variant key */
+static uint16_t SmallColor(const ScreenVertex_t* v0, const ScreenVertex_t* v1,
+    const ScreenVertex_t* v2, const Texture_t* texture, int32_t area, uint8_t key)
+{
+    const float third = 1.0f / 3.0f;
+    uint16_t light = (key & VARIANT_LIT) ? ColorLerp(v0->color, v1->color, v2->color, third, third, third) : v0->color;
+    if (!(key & VARIANT_TEXTURED)) return light;
+
+    Texture_t level;
+    texture = SelectLevelArea(texture, v0, v1, v2, area, &level);
+    float u = (v0->u + v1->u + v2->u) * third;
+    float v = (v0->v + v1->v + v2->v) * third;
+    uint16_t texel;
+    switch (key & (VARIANT_BILINEAR | VARIANT_CLAMP)) {
+    case 0:                 texel = SmallTexel<false, false>(texture, u, v); break;
+    case VARIANT_BILINEAR:  texel = SmallTexel<true, false>(texture, u, v); break;
+    case VARIANT_CLAMP:     texel = SmallTexel<false, true>(texture, u, v); break;
+    default:                texel = SmallTexel<true, true>(texture, u, v); break;
+    }
+    return (key & VARIANT_LIT) ? ColorModulate(texel, light) : texel;
+}
+
+template <bool DEPTH_TEST, bool DEPTH_WRITE>
+static void RasterSmall(const ScreenVertex_t* v0, const ScreenVertex_t* v1,
+    const ScreenVertex_t* v2, const Texture_t* texture, uint16_t color, int solid,
+    uint8_t key, const RasterTarget_t* t)
+{
+    TriSetup_t ts;
+    int32_t area = SetupBounds(v0, v1, v2, t->min_x, t->min_y, t->max_x, t->max_y, &ts);
+    if (area <= 0) return;
+
+    uint32_t box = (uint32_t)(MAX(ts.maxX - ts.minX + 1, 0) * MAX(ts.maxY - ts.minY + 1, 0));
+    t->stats->pixels_bbox += box;
+    t->stats->pixels_visited += box;
+
+    float zc = (v0->z + v1->z + v2->z) * (1.0f / 3.0f);
+#if RASTER_FIXED_POINT
+    RasterZ_t z = FxDepth(zc);
+#else
+    RasterZ_t z = zc;
+#endif
+    int shaded = 0;
+    uint32_t drawn_before = t->stats->pixels_drawn;
+    for (int y = ts.minY; y <= ts.maxY; y++) {
+        for (int x = ts.minX; x <= ts.maxX; x++) {
+            if (!CoversCenter(v0, v1, v2, x, y)) continue;
+            int idx = PixelIndex(t, x, y);
+            if (!DepthPass<DEPTH_TEST, DEPTH_WRITE>(t, idx, z)) {
+                t->stats->pixels_depth_rejected++;
+                continue;
+            }
+            /* Shaded on the first pixel that passes */
+            if (!shaded) {
+                if (!solid) color = SmallColor(v0, v1, v2, texture, area, key);
+                shaded = 1;
+            }
+            WriteColor(t, idx, color);
+        }
+    }
+
+    if (!solid && (key & VARIANT_TEXTURED)) {
+        t->stats->texels_fetched += (t->stats->pixels_drawn - drawn_before) * ((key & VARIANT_BILINEAR) ? 4 : 1);
+    }
+}
+
+typedef void (*SmallFunc_t)(const ScreenVertex_t*, const ScreenVertex_t*,
+    const ScreenVertex_t*, const Texture_t*, uint16_t, int, uint8_t, const RasterTarget_t*);
+
+/* Indexed like g_solid_variants */
+static const SmallFunc_t g_small_variants[4] = {
+    RasterSmall<false, false>, RasterSmall<true, false>,
+    RasterSmall<false, true>,  RasterSmall<true, true>
+};
+
+/* Prepass triangle (RASTER_STATE_DEPTH_ONLY): depth from the same plane
+ * or, for small triangles, the same centroid as the shading pass */
+static void RasterDepthOnly(const ScreenVertex_t* v0, const ScreenVertex_t* v1,
+    const ScreenVertex_t* v2, int small, const RasterTarget_t* t)
+{
+    if (!small) {
+        RasterFlat<true, true, FLAT_DEPTH>(v0, v1, v2, 0, t);
+        return;
+    }
+
+    TriSetup_t ts;
+    if (SetupBounds(v0, v1, v2, t->min_x, t->min_y, t->max_x, t->max_y, &ts) <= 0) return;
+    float zc = (v0->z + v1->z + v2->z) * (1.0f / 3.0f);
+#if RASTER_FIXED_POINT
+    RasterZ_t z = FxDepth(zc);
+#else
+    RasterZ_t z = zc;
+#endif
+    for (int y = ts.minY; y <= ts.maxY; y++) {
+        for (int x = ts.minX; x <= ts.maxX; x++) {
+            if (CoversCenter(v0, v1, v2, x, y)) PrepassPixel(t, PixelIndex(t, x, y), z);
+        }
+    }
+}
+
+/* ============================================================
+ * Blending
+ * Transparent triangles (RASTER_STATE_BLEND_*) always walk spans. Each
+ * row's pixels that pass depth are shaded into a run buffer, and the run
+ * is blended into the target with the packed two-pixel kernels of
+ * color.h. Depth is tested but never written, so transparent surfaces
+ * behind one another all show; submit them back to front after the
+ * opaque geometry.
+ * ============================================================ */
+
+#define RASTER_BLEND_RUN        64      /* Pixels shaded per blend call */
+
+static void BlendRun(const RasterTarget_t* t, int x, int y, const uint16_t* src, int count, int mode)
+{
+    Color_BlendSpan565(&t->color[PixelIndex(t, x, y)], src, (uint32_t)count, mode);
+    t->stats->pixels_drawn += (uint32_t)count;
+}
+
+/* Untextured unlit triangles blend `color` */
+template <bool TEXTURED, bool LIT, bool DEPTH_TEST, bool BILINEAR, bool CLAMP>
+static void RasterBlend(const ScreenVertex_t* v0, const ScreenVertex_t* v1,
+    const ScreenVertex_t* v2, const Texture_t* texture, uint16_t color, int mode,
+    const RasterTarget_t* t)
+{
+    TriSetup_t ts;
+    if (SetupTriangle(v0, v1, v2, t->min_x, t->min_y, t->max_x, t->max_y, &ts) <= 0) return;
+    t->stats->pixels_bbox += (uint32_t)(MAX(ts.maxX - ts.minX + 1, 0) * MAX(ts.maxY - ts.minY + 1, 0));
+
+    Texture_t level;
+    if (TEXTURED) texture = SelectLevel(texture, v0, v1, v2, ts.inv_area, &level);
+
+    float dzdx = (ts.A[0] * v0->z + ts.A[1] * v1->z + ts.A[2] * v2->z) * ts.inv_area;
+    float dzdy = (ts.B[0] * v0->z + ts.B[1] * v1->z + ts.B[2] * v2->z) * ts.inv_area;
+    float z_origin = ((ts.origin[0] - ts.bias[0]) * v0->z + (ts.origin[1] - ts.bias[1]) * v1->z +
+        (ts.origin[2] - ts.bias[2]) * v2->z) * ts.inv_area;
+    GouraudPlane_t light_plane;
+    if (LIT) SetupGouraud(&light_plane, &ts, v0, v1, v2);
+
+    uint16_t run[RASTER_BLEND_RUN];
+    uint32_t drawn_before = t->stats->pixels_drawn;
+    RasterWalk_t walk;
+    WalkBegin(&walk, &ts, 1);
+    while (WalkNext(&walk)) {
+        int y = walk.by;
+        t->stats->pixels_visited += (uint32_t)walk.bw;
+
+        float z = z_origin + dzdx * (float)(walk.bx - ts.minX) + dzdy * (float)(y - ts.minY);
+        int32_t w0 = walk.e[0] - ts.bias[0], w1 = walk.e[1] - ts.bias[1], w2 = walk.e[2] - ts.bias[2];
+        Gouraud_t light = { 0, 0, 0 };
+        if (LIT) light = EvalGouraud(&light_plane, walk.bx - ts.minX, y - ts.minY);
+        int start = walk.bx, count = 0;
+        for (int x = walk.bx; x < walk.bx + walk.bw; x++) {
+            if (DepthPass<DEPTH_TEST, false>(t, PixelIndex(t, x, y), z)) {
+                if (count == 0) start = x;
+                if (TEXTURED || LIT) {
+                    run[count++] = ShadePixel<TEXTURED, LIT, BILINEAR, CLAMP>(v0, v1, v2, texture,
+                        w0 * ts.inv_area, w1 * ts.inv_area, w2 * ts.inv_area, &light);
+                }
+                else {
+                    run[count++] = color;
+                }
+                if (count == RASTER_BLEND_RUN) {
+                    BlendRun(t, start, y, run, count, mode);
+                    count = 0;
+                }
+            }
+            else {
+                t->stats->pixels_depth_rejected++;
+                if (count) BlendRun(t, start, y, run, count, mode);
+                count = 0;
+            }
+            w0 += ts.A[0]; w1 += ts.A[1]; w2 += ts.A[2];
+            z += dzdx;
+            if (LIT) StepGouraud(&light, &light_plane);
+        }
+        if (count) BlendRun(t, start, y, run, count, mode);
+    }
+
+    if (TEXTURED) t->stats->texels_fetched += (t->stats->pixels_drawn - drawn_before) * (BILINEAR ? 4 : 1);
+}
+
+typedef void (*BlendFunc_t)(const ScreenVertex_t*, const ScreenVertex_t*,
+    const ScreenVertex_t*, const Texture_t*, uint16_t, int, const RasterTarget_t*);
+
+/* Indexed by textured, lit, depth test, bilinear, clamp from bit 0 */
+#define BLEND_VARIANT(n) RasterBlend<((n) & 1) != 0, ((n) & 2) != 0, ((n) & 4) != 0, \
+    ((n) & 8) != 0, ((n) & 16) != 0>
+#define BLEND_VARIANTS_4(n) BLEND_VARIANT(n), BLEND_VARIANT((n) + 1), \
+    BLEND_VARIANT((n) + 2), BLEND_VARIANT((n) + 3)
+
+static const BlendFunc_t g_blend_variants[32] = {
+    BLEND_VARIANTS_4(0), BLEND_VARIANTS_4(4), BLEND_VARIANTS_4(8), BLEND_VARIANTS_4(12),
+    BLEND_VARIANTS_4(16), BLEND_VARIANTS_4(20), BLEND_VARIANTS_4(24), BLEND_VARIANTS_4(28)
+};
+
+/* ============================================================
+ * Planar Shadows
+ * RASTER_STATE_SHADOW triangles, the blend pass of one solid color: each
+ * pixel that passes depth, and is still clear in the screen's shadow
+ * mask, is marked and joins a run averaged with the color. Casters
+ * flattened onto a plane overlap themselves and each other; the mask
+ * keeps every pixel to one darkening a frame.
+ * ============================================================ */
+
+#define BLEND_SHADOW            0x80    /* BinnedTri_t blend of SHADOW triangles, beside COLOR_BLEND_* */
+
+/* Sets the pixel's mask bit; 0 if it was already set */
+static inline int ShadowMark(uint8_t* mask, int x, int y)
+{
+    uint8_t* byte = &mask[y * SHADOW_MASK_STRIDE + (x >> 3)];
+    uint8_t bit = (uint8_t)(1u << (x & 7));
+    if (*byte & bit) return 0;
+    *byte |= bit;
+    return 1;
+}
+
+template <bool DEPTH_TEST>
+static void RasterShadow(const ScreenVertex_t* v0, const ScreenVertex_t* v1,
+    const ScreenVertex_t* v2, uint16_t color, const RasterTarget_t* t)
+{
+    TriSetup_t ts;
+    if (SetupTriangle(v0, v1, v2, t->min_x, t->min_y, t->max_x, t->max_y, &ts) <= 0) return;
+    t->stats->pixels_bbox += (uint32_t)(MAX(ts.maxX - ts.minX + 1, 0) * MAX(ts.maxY - ts.minY + 1, 0));
+
+    float dzdx = (ts.A[0] * v0->z + ts.A[1] * v1->z + ts.A[2] * v2->z) * ts.inv_area;
+    float dzdy = (ts.B[0] * v0->z + ts.B[1] * v1->z + ts.B[2] * v2->z) * ts.inv_area;
+    float z_origin = ((ts.origin[0] - ts.bias[0]) * v0->z + (ts.origin[1] - ts.bias[1]) * v1->z +
+        (ts.origin[2] - ts.bias[2]) * v2->z) * ts.inv_area;
+
+    /* Every run is the one color */
+    uint16_t run[RASTER_BLEND_RUN];
+    for (int i = 0; i < RASTER_BLEND_RUN; i++) run[i] = color;
+
+    uint8_t* mask = t->shadow_mask;
+    RasterWalk_t walk;
+    WalkBegin(&walk, &ts, 1);
+    while (WalkNext(&walk)) {
+        int y = walk.by;
+        t->stats->pixels_visited += (uint32_t)walk.bw;
+
+        float z = z_origin + dzdx * (float)(walk.bx - ts.minX) + dzdy * (float)(y - ts.minY);
+        int start = walk.bx, count = 0;
+        for (int x = walk.bx; x < walk.bx + walk.bw; x++, z += dzdx) {
+            if (!DepthPass<DEPTH_TEST, false>(t, PixelIndex(t, x, y), z)) {
+                t->stats->pixels_depth_rejected++;
+            }
+            else if (!mask || ShadowMark(mask, x, y)) {
+                if (count == 0) start = x;
+                if (++count == RASTER_BLEND_RUN) {
+                    BlendRun(t, start, y, run, count, COLOR_BLEND_AVERAGE);
+                    count = 0;
+                }
+                continue;
+            }
+            if (count) BlendRun(t, start, y, run, count, COLOR_BLEND_AVERAGE);
+            count = 0;
+        }
+        if (count) BlendRun(t, start, y, run, count, COLOR_BLEND_AVERAGE);
+    }
+}
+
+static inline int BlendMode(uint32_t state)
+{
+    if (state & RASTER_STATE_SHADOW) return BLEND_SHADOW;
+    if (state & RASTER_STATE_BLEND_KEY) return COLOR_BLEND_KEY;
+    if (state & RASTER_STATE_BLEND_ADD) return COLOR_BLEND_ADD;
+    if (state & RASTER_STATE_BLEND_AVERAGE) return COLOR_BLEND_AVERAGE;
+    return 0;
+}
+
+static inline void RasterDispatch(const ScreenVertex_t* v0, const ScreenVertex_t* v1,
+    const ScreenVertex_t* v2, const Texture_t* texture, uint16_t color, int solid,
+    int small, int blend, uint8_t key, const RasterTarget_t* t)
+{
+    /* Counted as heat in the shading pass that follows */
+    if (key & VARIANT_DEPTH_ONLY) {
+        RasterDepthOnly(v0, v1, v2, small, t);
+        return;
+    }
+
+    uint64_t start = 0;
+    if (t->heat) {
+        if (t->heat_mode != RASTER_HEAT_COST) {
+            g_heat_variants[(key >> 2) & 3](v0, v1, v2, 1, t);
+            return;
+        }
+        start = Profile_Now();
+    }
+
+    if (blend == BLEND_SHADOW) {
+        if (!solid) color = v0->color;
+        if (key & VARIANT_DEPTH_TEST) RasterShadow<true>(v0, v1, v2, color, t);
+        else RasterShadow<false>(v0, v1, v2, color, t);
+    }
+    else if (blend) {
+        if (solid) key &= VARIANT_DEPTH_TEST;
+        else if (!(key & (VARIANT_TEXTURED | VARIANT_LIT))) color = v0->color;
+        g_blend_variants[(key & 7) | ((key >> 2) & 0x18)](v0, v1, v2, texture, color, blend, t);
+    }
+    else if (small) g_small_variants[(key >> 2) & 3](v0, v1, v2, texture, color, solid, key, t);
+    else if (solid) g_solid_variants[(key >> 2) & 3](v0, v1, v2, color, t);
+    else g_shaded_variants[key](v0, v1, v2, texture, t);
+
+    if (t->heat) {
+        /* Count the coverage, then spread the ticks over it, rounding up
+         * so every covered pixel shows */
+        uint32_t ticks = (uint32_t)(Profile_Now() - start);
+        uint32_t covered = RasterHeat<false, false>(v0, v1, v2, 0, t);
+        if (covered) RasterHeat<false, false>(v0, v1, v2, (ticks + covered - 1) / covered, t);
+    }
+}
+
+void RasterContext_SetState(RasterContext_t* ctx, uint32_t state)
+{
+    if (ctx == &g_default && Capture_IsRecording() && state != ctx->state) Capture_OnState(state);
+    ctx->state = state;
+}
+
+uint32_t RasterContext_GetState(const RasterContext_t* ctx)
+{
+    return ctx->state;
+}
+
+void RasterContext_SetPerspectiveSpan(RasterContext_t* ctx, int pixels)
+{
+    ctx->perspective_span = Clampi(pixels, 1, RASTER_BLOCK);
+}
+
+void RasterContext_SetTraversal(RasterContext_t* ctx, int mode)
+{
+    ctx->traversal = Clampi(mode, RASTER_TRAVERSAL_BLOCKS, RASTER_TRAVERSAL_AUTO);
+}
+
+void Rasterizer_SetState(uint32_t state) { RasterContext_SetState(&g_default, state); }
+uint32_t Rasterizer_GetState(void) { return g_default.state; }
+void Rasterizer_SetPerspectiveSpan(int pixels) { RasterContext_SetPerspectiveSpan(&g_default, pixels); }
+void Rasterizer_SetTraversal(int mode) { RasterContext_SetTraversal(&g_default, mode); }
+int Rasterizer_GetTraversal(void) { return g_default.traversal; }
+
+/* ============================================================
+ * Lines
+ * ============================================================ */
+
+/* Pixels of the line (x0, y0)-(x1, y1) inside t's clip rect. Pixel k
+ * along the major axis takes minor offset round(k * minor / major), a
+ * function of the endpoints alone, so the line is clipped up front to a
+ * range of k - parametric clipping against the rect's four sides - and
+ * only that range is walked, with no per-pixel bounds test. A tile or
+ * the screen clipping the same line draw the same pixels where they
+ * overlap. Depth is linear in screen space, tested and never written. */
+template <bool DEPTH_TEST>
+static void RasterLine(const RasterTarget_t* t, int x0, int y0, float z0, int x1, int y1, float z1,
+    uint16_t color)
+{
+    int adx = (x1 > x0) ? (x1 - x0) : (x0 - x1);
+    int ady = (y1 > y0) ? (y1 - y0) : (y0 - y1);
+    int x_major = adx >= ady;
+    int n = x_major ? adx : ady;
+    int dm = x_major ? ady : adx;
+    int m0 = x_major ? x0 : y0, s0 = x_major ? y0 : x0;
+    int ms = x_major ? ((x1 < x0) ? -1 : 1) : ((y1 < y0) ? -1 : 1);
+    int ss = x_major ? ((y1 < y0) ? -1 : 1) : ((x1 < x0) ? -1 : 1);
+    int m_lo = x_major ? t->min_x : t->min_y, m_hi = x_major ? t->max_x : t->max_y;
+    int s_lo = x_major ? t->min_y : t->min_x, s_hi = x_major ? t->max_y : t->max_x;
+
+    /* Steps k in [k0, k1] whose major coordinate is inside */
+    int64_t k0 = (ms > 0) ? (int64_t)m_lo - m0 : (int64_t)m0 - m_hi;
+    int64_t k1 = (ms > 0) ? (int64_t)m_hi - m0 : (int64_t)m0 - m_lo;
+    k0 = MAX(k0, 0);
+    k1 = MIN(k1, (int64_t)n);
+
+    /* Minor offsets [a, b] inside, then the steps reaching them:
+     * offset(k) = floor((2 k dm + n) / 2n) */
+    int64_t a = (ss > 0) ? (int64_t)s_lo - s0 : (int64_t)s0 - s_hi;
+    int64_t b = (ss > 0) ? (int64_t)s_hi - s0 : (int64_t)s0 - s_lo;
+    a = MAX(a, 0);
+    b = MIN(b, (int64_t)dm);
+    if (a > b) return;
+    if (dm > 0) {
+        if (a > 0) k0 = MAX(k0, (2 * n * a - n + 2 * dm - 1) / (2 * dm));
+        k1 = MIN(k1, (2 * n * (b + 1) - n - 1) / (2 * dm));
+    }
+    if (k0 > k1) return;
+
+    /* Walk: the minor remainder gains 2 dm per step and carries at 2n */
+    int64_t den = 2 * (int64_t)n;
+    int64_t num = 2 * k0 * dm + n;
+    int64_t rem = den ? num % den : 0;
+    int major = m0 + ms * (int)k0;
+    int minor = s0 + ss * (int)(den ? num / den : 0);
+    float dz = n ? (z1 - z0) / (float)n : 0.0f;
+    float z = z0 + dz * (float)k0;
+    for (int64_t k = k0; k <= k1; k++) {
+        int idx = x_major ? PixelIndex(t, major, minor) : PixelIndex(t, minor, major);
+        if (DepthPass<DEPTH_TEST, false>(t, idx, z)) WriteColor(t, idx, color);
+        else t->stats->pixels_depth_rejected++;
+        major += ms;
+        rem += 2 * dm;
+        if (rem >= den) {
+            rem -= den;
+            minor += ss;
+        }
+        z += dz;
+    }
+}
+
+/* ============================================================
+ * Binning
+ * ============================================================ */
+
+/* Returns 0 if the bins are full; caller flushes and retries */
+static int BinTriangle(const ScreenVertex_t* v0, const ScreenVertex_t* v1,
+    const ScreenVertex_t* v2, const Texture_t* texture, uint16_t color, int solid,
+    int small, int blend, uint8_t variant, int minX, int minY, int maxX, int maxY)
+{
+    int tx0 = minX / TILE_WIDTH, tx1 = maxX / TILE_WIDTH;
+    int ty0 = minY / TILE_HEIGHT, ty1 = maxY / TILE_HEIGHT;
+    uint32_t refs = (uint32_t)((tx1 - tx0 + 1) * (ty1 - ty0 + 1));
+
+    if (g_bin_tri_count >= MAX_BINNED_TRIANGLES ||
+        g_bin_ref_count + refs > MAX_BIN_REFS) {
+        return 0;
+    }
+
+    uint16_t index = (uint16_t)g_bin_tri_count++;
+    BinnedTri_t* tri = &g_bin_tris[index];
+    tri->v[0] = *v0;
+    tri->v[1] = *v1;
+    tri->v[2] = *v2;
+    if (texture) tri->texture = *texture;
+    tri->color = color;
+    tri->solid = (uint8_t)solid;
+    tri->small = (uint8_t)small;
+    tri->blend = (uint8_t)blend;
+    tri->variant = variant;
+
+    /* Append so each tile shades in submission order */
+    for (int ty = ty0; ty <= ty1; ty++) {
+        for (int tx = tx0; tx <= tx1; tx++) {
+            int tile = ty * TILES_X + tx;
+            g_tile_triangles[tile]++;
+            uint16_t ref = (uint16_t)g_bin_ref_count++;
+            g_bin_ref_tri[ref] = index;
+            g_bin_ref_next[ref] = BIN_END;
+            if (g_bin_tail[tile] == BIN_END) g_bin_head[tile] = ref;
+            else g_bin_ref_next[g_bin_tail[tile]] = ref;
+            g_bin_tail[tile] = ref;
+        }
+    }
+    return 1;
+}
+
+static inline void AddStageTicks(RasterContext_t* ctx, uint32_t stage, uint64_t start, uint64_t end)
+{
+    ctx->stats.stage_ticks[stage] += (uint32_t)(end - start);
+}
+
+/* What every triangle of a draw shares, set up once per call or batch */
+typedef struct {
+    RasterTarget_t screen;
+    const Texture_t* texture;
+    uint16_t color;
+    int solid;
+    int blend;
+    uint8_t variant;
+} SubmitState_t;
+
+/* 0 without a target. Picks the specialized pipeline once per draw;
+ * blended triangles never write depth. */
+static int BeginSubmit(RasterContext_t* ctx, const Texture_t* texture, uint16_t color, int solid, SubmitState_t* s)
+{
+    if (!GetContextTarget(ctx, &s->screen)) return 0;
+    s->texture = texture;
+    s->color = color;
+    s->solid = solid;
+    s->variant = VariantKey(ctx->state, texture != NULL);
+    s->blend = (s->variant & VARIANT_DEPTH_ONLY) ? 0 : BlendMode(ctx->state);
+    if (s->blend) s->variant &= (uint8_t)~VARIANT_DEPTH_WRITE;
+    return 1;
+}
+
+/* Common front end: stats, culling, clipping, then immediate draw or bin */
+static void SubmitPrepared(RasterContext_t* ctx, const SubmitState_t* s, const ScreenVertex_t* v0,
+    const ScreenVertex_t* v1, const ScreenVertex_t* v2)
+{
+    const RasterTarget_t* screen = &s->screen;
+    const Texture_t* texture = s->texture;
+    uint16_t color = s->color;
+    int solid = s->solid, blend = s->blend;
+    uint8_t variant = s->variant;
+    RasterizerStats_t* stats = &ctx->stats;
+
+    uint64_t start = Profile_Now();
+    stats->triangles_submitted++;
+
+    ScreenVertex_t field[3];
+    if (ctx == &g_default && g_field_offset) {
+        field[0] = *v0;
+        field[1] = *v1;
+        field[2] = *v2;
+        for (int i = 0; i < 3; i++) field[i].y += g_field_offset;
+        v0 = &field[0];
+        v1 = &field[1];
+        v2 = &field[2];
+    }
+
+    /* Bounds only: the pixel loops do their own setup per target */
+    TriSetup_t ts;
+    if (SetupBounds(v0, v1, v2, 0, 0, screen->max_x, screen->max_y, &ts) <= 0) {
+        stats->triangles_culled++;
+        AddStageTicks(ctx, RASTER_STAGE_SETUP, start, Profile_Now());
+        return;
+    }
+    int minX = ts.minX, maxX = ts.maxX, minY = ts.minY, maxY = ts.maxY;
+
+    if (minX > maxX || minY > maxY || (ctx->scissor_on && !ScissorOverlaps(ctx, minX, minY, maxX, maxY))) {
+        stats->triangles_culled++;
+        AddStageTicks(ctx, RASTER_STAGE_SETUP, start, Profile_Now());
+        return;
+    }
+
+    /* Micro triangles: test the few centers now, drop those covering
+     * none; blended ones take no small-triangle shortcut */
+    int small = 0;
+    if (maxX - minX < RASTER_SMALL_SIZE && maxY - minY < RASTER_SMALL_SIZE) {
+        for (int y = minY; y <= maxY && !small; y++) {
+            for (int x = minX; x <= maxX && !small; x++) small = CoversCenter(v0, v1, v2, x, y);
+        }
+        if (!small) {
+            stats->triangles_culled++;
+            stats->triangles_micro_culled++;
+            AddStageTicks(ctx, RASTER_STAGE_SETUP, start, Profile_Now());
+            return;
+        }
+        if (blend) small = 0;
+        else stats->triangles_small++;
+    }
+
+    /* Mask rows to clear at the next frame */
+    if (blend == BLEND_SHADOW && ctx == &g_default) {
+        g_shadow_rows_min = MAX(MIN(g_shadow_rows_min, minY), 0);
+        g_shadow_rows_max = MIN(MAX(g_shadow_rows_max, maxY), DISPLAY_HEIGHT - 1);
+    }
+
+    if (ctx == &g_default && g_binning) {
+        if (!BinTriangle(v0, v1, v2, texture, color, solid, small, blend, variant, minX, minY, maxX, maxY)) {
+            /* Bins exhausted: resolve what we have, keeping its depth
+             * for the next flush. The flush times itself as raster. */
+            AddStageTicks(ctx, RASTER_STAGE_SETUP, start, Profile_Now());
+            FlushOverflow();
+            start = Profile_Now();
+            BinTriangle(v0, v1, v2, texture, color, solid, small, blend, variant, minX, minY, maxX, maxY);
+        }
+        AddStageTicks(ctx, RASTER_STAGE_SETUP, start, Profile_Now());
+    }
+    else {
+        uint64_t raster_start = Profile_Now();
+        AddStageTicks(ctx, RASTER_STAGE_SETUP, start, raster_start);
+        AcquireTarget(ctx);
+        if (ctx->scissor_on) {
+            RasterTarget_t part;
+            for (uint32_t i = 0; i < ctx->scissor_count; i++) {
+                if (ScissorTarget(ctx, screen, i, &part)) RasterDispatch(v0, v1, v2, texture, color, solid, small, blend, variant, &part);
+            }
+        }
+        else {
+            RasterDispatch(v0, v1, v2, texture, color, solid, small, blend, variant, screen);
+        }
+        AddStageTicks(ctx, RASTER_STAGE_RASTER, raster_start, Profile_Now());
+    }
+    stats->triangles_drawn++;
+}
+
+static void SubmitTriangle(RasterContext_t* ctx, const ScreenVertex_t* v0, const ScreenVertex_t* v1,
+    const ScreenVertex_t* v2, const Texture_t* texture, uint16_t color, int solid)
+{
+    SubmitState_t s;
+    if (ctx == &g_default && Capture_IsRecording()) Capture_OnTriangle(v0, v1, v2, texture, color);
+    if (BeginSubmit(ctx, texture, color, solid, &s)) SubmitPrepared(ctx, &s, v0, v1, v2);
+}
+
+static void SubmitTriangles(RasterContext_t* ctx, const ScreenVertex_t* verts, const uint16_t* indices,
+    uint32_t tri_count, const Texture_t* texture, uint16_t color, int solid)
+{
+    SubmitState_t s;
+    if (!BeginSubmit(ctx, texture, color, solid, &s)) return;
+    int capture = ctx == &g_default && Capture_IsRecording();
+    for (uint32_t t = 0; t < tri_count; t++, indices += 3) {
+        const ScreenVertex_t* v0 = &verts[indices[0]];
+        const ScreenVertex_t* v1 = &verts[indices[1]];
+        const ScreenVertex_t* v2 = &verts[indices[2]];
+        if (capture) Capture_OnTriangle(v0, v1, v2, texture, color);
+        SubmitPrepared(ctx, &s, v0, v1, v2);
+    }
+}
+
+void RasterContext_DrawTriangle(RasterContext_t* ctx, const ScreenVertex_t* v0,
+    const ScreenVertex_t* v1, const ScreenVertex_t* v2, const Texture_t* texture)
+{
+    SubmitTriangle(ctx, v0, v1, v2, texture, 0, 0);
+}
+
+void RasterContext_DrawTriangleSolid(RasterContext_t* ctx, const ScreenVertex_t* v0,
+    const ScreenVertex_t* v1, const ScreenVertex_t* v2, uint16_t color)
+{
+    SubmitTriangle(ctx, v0, v1, v2, NULL, color, 1);
+}
+
+void RasterContext_DrawTriangles(RasterContext_t* ctx, const ScreenVertex_t* verts, const uint16_t* indices,
+    uint32_t tri_count, const Texture_t* texture)
+{
+    SubmitTriangles(ctx, verts, indices, tri_count, texture, 0, 0);
+}
+
+void RasterContext_DrawTrianglesSolid(RasterContext_t* ctx, const ScreenVertex_t* verts, const uint16_t* indices,
+    uint32_t tri_count, uint16_t color)
+{
+    SubmitTriangles(ctx, verts, indices, tri_count, NULL, color, 1);
+}
+
+void Rasterizer_DrawTriangle(const ScreenVertex_t* v0, const ScreenVertex_t* v1,
+    const ScreenVertex_t* v2, const Texture_t* texture)
+{
+    RasterContext_DrawTriangle(&g_default, v0, v1, v2, texture);
+}
+
+void Rasterizer_DrawTriangleSolid(const ScreenVertex_t* v0, const ScreenVertex_t* v1,
+    const ScreenVertex_t* v2, uint16_t color)
+{
+    RasterContext_DrawTriangleSolid(&g_default, v0, v1, v2, color);
+}
+
+void Rasterizer_DrawTriangles(const ScreenVertex_t* verts, const uint16_t* indices, uint32_t tri_count,
+    const Texture_t* texture)
+{
+    SubmitTriangles(&g_default, verts, indices, tri_count, texture, 0, 0);
+}
+
+void Rasterizer_DrawTrianglesSolid(const ScreenVertex_t* verts, const uint16_t* indices, uint32_t tri_count,
+    uint16_t color)
+{
+    SubmitTriangles(&g_default, verts, indices, tri_count, NULL, color, 1);
+}
+
+/* Bounds of render sizes and scissor rectangles: the display for the
+ * screen, whatever the Device size, else the context's target */
+static inline void ContextLimits(const RasterContext_t* ctx, int* width, int* height)
+{
+    *width = (ctx == &g_default) ? DISPLAY_WIDTH : ctx->width;
+    *height = (ctx == &g_default) ? DISPLAY_HEIGHT : ctx->height;
+}
+
+void RasterContext_SetResolution(RasterContext_t* ctx, int width, int height)
+{
+    int w, h;
+    ContextLimits(ctx, &w, &h);
+    ctx->res_width = Clampi(width & ~(RASTER_BLOCK - 1), RASTER_BLOCK, w);
+    ctx->res_height = Clampi(height & ~(RASTER_BLOCK - 1), RASTER_BLOCK, h);
+}
+
+void RasterContext_GetResolution(const RasterContext_t* ctx, int* width, int* height)
+{
+    *width = MIN(ctx->res_width, ctx->width);
+    *height = MIN(ctx->res_height, ctx->height);
+}
+
+void RasterContext_SetScissorRects(RasterContext_t* ctx, const RasterRect_t* rects, uint32_t count)
+{
+    int w, h;
+    ContextLimits(ctx, &w, &h);
+    ctx->scissor_on = count > 0;
+    ctx->scissor_count = 0;
+    for (uint32_t i = 0; i < count && ctx->scissor_count < RASTER_MAX_SCISSOR_RECTS; i++) {
+        int x0 = MAX(rects[i].x, 0), y0 = MAX(rects[i].y, 0);
+        int x1 = MIN(rects[i].x + rects[i].w, w);
+        int y1 = MIN(rects[i].y + rects[i].h, h);
+        if (x0 >= x1 || y0 >= y1) continue;
+        RasterRect_t* r = &ctx->scissor[ctx->scissor_count++];
+        r->x = x0;
+        r->y = y0;
+        r->w = x1 - x0;
+        r->h = y1 - y0;
+    }
+}
+
+void Rasterizer_SetResolution(int width, int height) { RasterContext_SetResolution(&g_default, width, height); }
+void Rasterizer_GetResolution(int* width, int* height) { RasterContext_GetResolution(&g_default, width, height); }
+void Rasterizer_SetScissorRects(const RasterRect_t* rects, uint32_t count) { RasterContext_SetScissorRects(&g_default, rects, count); }
+
+/* Bottom row first and right to left: every source pixel sits at or
+ * above and left of the pixels it fills, so it is read before it is
+ * overwritten. Source positions sample at the screen pixel centers. */
+void Rasterizer_Upscale(void)
+{
+    if (!g_default.color) return;
+    int dw = MIN(g_default.width, DISPLAY_WIDTH), dh = g_default.height;
+    int sw = MIN(g_default.res_width, dw), sh = MIN(g_default.res_height, dh);
+    if (sw == dw && sh == dh) return;
+    PROFILE_ZONE("Rasterizer_Upscale");
+    AcquireTarget(&g_default);
+
+    for (int x = 0; x < dw; x++) g_upscale_x[x] = (uint16_t)(((2 * x + 1) * sw) / (2 * dw));
+
+    int expanded = -1;      /* Screen row holding the last expanded source row */
+    int expanded_src = -1;
+    for (int y = dh - 1; y >= 0; y--) {
+        int sy = ((2 * y + 1) * sh) / (2 * dh);
+        uint16_t* dst = &g_default.color[y * g_default.stride];
+        if (sy == expanded_src) {
+            Clear_StartCopy16(dst, &g_default.color[expanded * g_default.stride], (uint32_t)dw, 1, g_default.stride, g_default.stride);
+            continue;
+        }
+        /* Rows share cache lines at their ends: no CPU writes next to a copy */
+        Clear_Wait();
+        const uint16_t* src = &g_default.color[sy * g_default.stride];
+        for (int x = dw - 1; x >= 0; x--) dst[x] = src[g_upscale_x[x]];
+        expanded = y;
+        expanded_src = sy;
+    }
+}
+
+void Rasterizer_SetInterlace(int enabled)
+{
+    g_interlace = enabled ? 1 : 0;
+}
+
+int Rasterizer_IsInterlace(void)
+{
+    return g_interlace;
+}
+
+/* The missing rows are those of the other parity inside the rendered
+ * region. A weave takes them from the last frame, which on the board is
+ * the front buffer and on the PC is still in place; a bob averages the
+ * field rows on either side, copying the one neighbour at the edges. */
+void Rasterizer_ResolveField(int motion)
+{
+    if (!g_field_open) return;
+    EndField();
+    if (!g_default.color) return;
+    PROFILE_ZONE("Rasterizer_ResolveField");
+
+    int dw = MIN(g_default.width, DISPLAY_WIDTH), dh = g_default.height;
+    int w = MIN(g_default.res_width, dw), h = MIN(g_default.res_height, dh);
+    int s = g_default.stride;
+    int q = g_field_parity ^ 1;
+    uint16_t* c = g_default.color;
+    if (h <= q) return;
+
+    /* Below full resolution the last frame kept only its upscaled copy */
+    if (!motion && w == dw && h == dh) {
+        const uint16_t* front = SwapChain_GetFrontBuffer();
+        if (front && front != c) Clear_StartCopy16(&c[q * s], &front[q * s], (uint32_t)w, (uint32_t)((h - q + 1) / 2), 2 * s, 2 * s);
+        return;
+    }
+
+    int first = q, last = h - 1 - ((h - 1 - q) & 1);
+    if (first == 0) {
+        Clear_StartCopy16(c, &c[s], (uint32_t)w, 1, s, s);
+        first = 2;
+    }
+    if (last == h - 1) {
+        Clear_StartCopy16(&c[last * s], &c[(last - 1) * s], (uint32_t)w, 1, s, s);
+        last -= 2;
+    }
+    if (last >= first) {
+        Clear_StartBlend16(&c[first * s], &c[(first - 1) * s], &c[(first + 1) * s], (uint32_t)w,
+            (uint32_t)((last - first) / 2 + 1), 2 * s, 2 * s);
+    }
+}
+
+void Rasterizer_SetBinning(int enabled)
+{
+    if (g_binning && !enabled) Rasterizer_Flush();
+    g_binning = enabled ? 1 : 0;
+    ResetBins();
+}
+
+int Rasterizer_IsBinning(void)
+{
+    return g_binning;
+}
+
+void Rasterizer_SetVisibilityBuffer(int enabled)
+{
+    g_visibility = enabled ? 1 : 0;
+}
+
+int Rasterizer_IsVisibilityBuffer(void)
+{
+    return g_visibility;
+}
+
+/* Copy a tile region between the local buffer and the screen */
+static void LoadTile(const RasterTarget_t* t)
+{
+    int w = t->max_x - t->min_x + 1;
+    for (int y = t->min_y; y <= t->max_y; y++) {
+        uint16_t* dst = &t->color[PixelIndex(t, t->min_x, y)];
+        memcpy(dst, &g_default.color[y * g_default.stride + t->min_x], w * sizeof(uint16_t));
+    }
+}
+
+static void StoreTile(const RasterTarget_t* t)
+{
+    int w = t->max_x - t->min_x + 1;
+    for (int y = t->min_y; y <= t->max_y; y++) {
+        const uint16_t* src = &t->color[PixelIndex(t, t->min_x, y)];
+        memcpy(&g_default.color[y * g_default.stride + t->min_x], src, w * sizeof(uint16_t));
+    }
+}
+
+/* A tile region from a layer, or color and depth to the store */
+static void LoadLayerTile(uint16_t* dst, const uint16_t* layer, const RasterTarget_t* t)
+{
+    int w = t->max_x - t->min_x + 1;
+    for (int y = t->min_y; y <= t->max_y; y++) {
+        memcpy(&dst[PixelIndex(t, t->min_x, y)], &layer[y * DISPLAY_WIDTH + t->min_x], w * sizeof(uint16_t));
+    }
+}
+
+static void StoreLayerTile(const RasterTarget_t* t)
+{
+    int w = t->max_x - t->min_x + 1;
+    for (int y = t->min_y; y <= t->max_y; y++) {
+        int i = PixelIndex(t, t->min_x, y), l = y * DISPLAY_WIDTH + t->min_x;
+        memcpy(&g_store_color[l], &t->color[i], w * sizeof(uint16_t));
+        memcpy(&g_store_depth[l], &t->depth[i], w * sizeof(uint16_t));
+    }
+}
+
+static void StoreOverflowTile(const RasterTarget_t* t)
+{
+    int w = t->max_x - t->min_x + 1;
+    for (int y = t->min_y; y <= t->max_y; y++) {
+        memcpy(&g_overflow_depth[y * DISPLAY_WIDTH + t->min_x], &t->depth[PixelIndex(t, t->min_x, y)], w * sizeof(uint16_t));
+    }
+}
+
+/* ============================================================
+ * Visibility Buffer
+ * A tile first rasterizes every binned triangle flat, writing its bin
+ * index where it passes depth, so each pixel ends up holding the
+ * triangle forward shading would have left there. The resolve then
+ * shades each of those pixels once from the stored triangle, rebuilding
+ * barycentrics from its edge equations; shading no longer scales with
+ * depth complexity. Triangle setups are cached per thread, as neighbour
+ * pixels mostly share one. Blended triangles skip the ID pass and are
+ * drawn forward after the resolve.
+ * ============================================================ */
+
+#define RESOLVE_CACHE           16      /* Direct-mapped setups, power of 2 */
+
+DTCM_BSS static uint16_t g_tile_ids[TILE_THREADS][TILE_WIDTH * TILE_HEIGHT];
+
+struct ResolveTri_t;
+typedef void (*ResolveFunc_t)(const struct ResolveTri_t* r, int x, int y, int len, uint16_t* dst);
+
+/* One binned triangle set up against the tile being resolved */
+typedef struct ResolveTri_t {
+    const BinnedTri_t* tri;
+    const Texture_t* texture;   /* Selected mip level */
+    Texture_t level;
+    TriSetup_t ts;
+    GouraudPlane_t light;         /* Lit variants */
+    ResolveFunc_t shade;        /* NULL: every pixel is color */
+    uint16_t color;
+    uint16_t id;                /* Bin index, BIN_END = empty */
+    uint8_t texels;             /* Fetched per pixel */
+} ResolveTri_t;
+
+static ResolveTri_t g_resolve_cache[TILE_THREADS][RESOLVE_CACHE];
+
+/* A run of len pixels from (x, y) covered by r. Edge values step as
+ * in the forward loops; perspective UVs divide every pixel. */
+template <bool TEXTURED, bool LIT, bool PERSPECTIVE, bool BILINEAR, bool CLAMP>
+static void ResolveRun(const ResolveTri_t* r, int x, int y, int len, uint16_t* dst)
+{
+    const TriSetup_t* ts = &r->ts;
+    const ScreenVertex_t* v = r->tri->v;
+    int dx = x - ts->minX, dy = y - ts->minY;
+    int32_t w0 = ts->origin[0] - ts->bias[0] + ts->A[0] * dx + ts->B[0] * dy;
+    int32_t w1 = ts->origin[1] - ts->bias[1] + ts->A[1] * dx + ts->B[1] * dy;
+    int32_t w2 = ts->origin[2] - ts->bias[2] + ts->A[2] * dx + ts->B[2] * dy;
+    Gouraud_t light = { 0, 0, 0 };
+    if (LIT) light = EvalGouraud(&r->light, dx, dy);
+
+    for (int i = 0; i < len; i++) {
+        float b0 = w0 * ts->inv_area, b1 = w1 * ts->inv_area, b2 = w2 * ts->inv_area;
+        if (!TEXTURED || PERSPECTIVE) {
+            dst[i] = ShadePixel<TEXTURED, LIT, BILINEAR, CLAMP>(&v[0], &v[1], &v[2], r->texture, b0, b1, b2, &light);
+        }
+        else {
+            float u = b0 * v[0].u + b1 * v[1].u + b2 * v[2].u;
+            float t = b0 * v[0].v + b1 * v[1].v + b2 * v[2].v;
+            dst[i] = ShadeTexel<LIT, BILINEAR, CLAMP>(r->texture, ToFixedUV(u), ToFixedUV(t), &light);
+        }
+        w0 += ts->A[0]; w1 += ts->A[1]; w2 += ts->A[2];
+        if (LIT) StepGouraud(&light, &r->light);
+    }
+}
+
+/* Indexed by textured, lit, perspective, bilinear, clamp from bit 0 */
+#define RESOLVE_VARIANT(n) ResolveRun<((n) & 1) != 0, ((n) & 2) != 0, ((n) & 4) != 0, \
+    ((n) & 8) != 0, ((n) & 16) != 0>
+#define RESOLVE_VARIANTS_4(n) RESOLVE_VARIANT(n), RESOLVE_VARIANT((n) + 1), \
+    RESOLVE_VARIANT((n) + 2), RESOLVE_VARIANT((n) + 3)
+
+static const ResolveFunc_t g_resolve_variants[32] = {
+    RESOLVE_VARIANTS_4(0), RESOLVE_VARIANTS_4(4), RESOLVE_VARIANTS_4(8), RESOLVE_VARIANTS_4(12),
+    RESOLVE_VARIANTS_4(16), RESOLVE_VARIANTS_4(20), RESOLVE_VARIANTS_4(24), RESOLVE_VARIANTS_4(28)
+};
+
+static const ResolveTri_t* ResolveSetup(ResolveTri_t* cache, uint16_t id, const RasterTarget_t* t)
+{
+    ResolveTri_t* r = &cache[id & (RESOLVE_CACHE - 1)];
+    if (r->id == id) return r;
+
+    const BinnedTri_t* tri = &g_bin_tris[id];
+    const ScreenVertex_t* v = tri->v;
+    uint8_t key = tri->variant;
+    r->id = id;
+    r->tri = tri;
+    r->shade = NULL;
+    r->texels = 0;
+    if (tri->solid) {
+        r->color = tri->color;
+    }
+    else if (tri->small) {
+        int32_t area = SetupBounds(&v[0], &v[1], &v[2], t->min_x, t->min_y, t->max_x, t->max_y, &r->ts);
+        r->color = SmallColor(&v[0], &v[1], &v[2], &tri->texture, area, key);
+        if (key & VARIANT_TEXTURED) r->texels = (key & VARIANT_BILINEAR) ? 4 : 1;
+    }
+    else if (!(key & (VARIANT_TEXTURED | VARIANT_LIT))) {
+        r->color = v[0].color;
+    }
+    else {
+        SetupTriangle(&v[0], &v[1], &v[2], t->min_x, t->min_y, t->max_x, t->max_y, &r->ts);
+        r->shade = g_resolve_variants[(key & (VARIANT_TEXTURED | VARIANT_LIT)) |
+            ((key & (VARIANT_PERSPECTIVE | VARIANT_BILINEAR | VARIANT_CLAMP)) >> 2)];
+        if (key & VARIANT_LIT) SetupGouraud(&r->light, &r->ts, &v[0], &v[1], &v[2]);
+        if (key & VARIANT_TEXTURED) {
+            r->texture = SelectLevel(&tri->texture, &v[0], &v[1], &v[2], r->ts.inv_area, &r->level);
+            r->texels = (key & VARIANT_BILINEAR) ? 4 : 1;
+        }
+    }
+    return r;
+}
+
+/* Both passes over one tile region; heat maps stay forward */
+static void VisibilityTileRegion(uint32_t tile, uint32_t thread, RasterTarget_t* t)
+{
+    RasterTarget_t vis = *t;
+    vis.color = g_tile_ids[thread];
+    for (int y = t->min_y; y <= t->max_y; y++) {
+        memset(&vis.color[PixelIndex(t, t->min_x, y)], 0xFF, (t->max_x - t->min_x + 1) * sizeof(uint16_t));
+    }
+
+    int blended = 0;
+    for (uint16_t ref = g_bin_head[tile]; ref != BIN_END; ref = g_bin_ref_next[ref]) {
+        uint16_t id = g_bin_ref_tri[ref];
+        const BinnedTri_t* tri = &g_bin_tris[id];
+        uint8_t depth = (tri->variant >> 2) & 3;
+        if (tri->blend) blended = 1;
+        else if (tri->variant & VARIANT_DEPTH_ONLY) continue;   /* The id pass resolves depth itself */
+        else if (tri->small) g_small_variants[depth](&tri->v[0], &tri->v[1], &tri->v[2], NULL, id, 1, tri->variant, &vis);
+        else g_solid_variants[depth](&tri->v[0], &tri->v[1], &tri->v[2], id, &vis);
+    }
+
+    ResolveTri_t* cache = g_resolve_cache[thread];
+    for (int i = 0; i < RESOLVE_CACHE; i++) cache[i].id = BIN_END;
+    uint32_t resolved = 0, texels = 0;
+    int w = t->max_x - t->min_x + 1;
+    for (int y = t->min_y; y <= t->max_y; y++) {
+        const uint16_t* ids = &vis.color[PixelIndex(t, t->min_x, y)];
+        uint16_t* dst = &t->color[PixelIndex(t, t->min_x, y)];
+        for (int i = 0; i < w;) {
+            uint16_t id = ids[i];
+            if (id == BIN_END) {
+                i++;
+                continue;
+            }
+            /* Run of one triangle */
+            int len = 1;
+            while (i + len < w && ids[i + len] == id) len++;
+            const ResolveTri_t* r = ResolveSetup(cache, id, t);
+            if (r->shade) r->shade(r, t->min_x + i, y, len, &dst[i]);
+            else Clear_Fill16(&dst[i], r->color, (uint32_t)len);
+            resolved += (uint32_t)len;
+            texels += r->texels * (uint32_t)len;
+            i += len;
+        }
+    }
+    t->stats->pixels_resolved += resolved;
+    t->stats->texels_fetched += texels;
+    if (!blended) return;
+
+    /* Transparent triangles blend forward over the resolved tile, tested
+     * against the final opaque depth */
+    for (uint16_t ref = g_bin_head[tile]; ref != BIN_END; ref = g_bin_ref_next[ref]) {
+        const BinnedTri_t* tri = &g_bin_tris[g_bin_ref_tri[ref]];
+        if (!tri->blend) continue;
+        RasterDispatch(&tri->v[0], &tri->v[1], &tri->v[2], &tri->texture,
+            tri->color, tri->solid, 0, tri->blend, tri->variant, t);
+    }
+}
+
+/* Shades the bins of a tile into one region of it and stores the region */
+static void ShadeTileRegion(uint32_t tile, uint32_t thread, RasterTarget_t* t)
+{
+    if (g_layer_color) LoadLayerTile(t->color, g_layer_color, t);
+    else if (g_clear_pending) Clear_Fill16(t->color, g_clear_color, TILE_WIDTH * TILE_HEIGHT);
+    else LoadTile(t);
+    if (g_layer_depth) LoadLayerTile(t->depth, g_layer_depth, t);
+    else memset(t->depth, 0xFF, TILE_WIDTH * TILE_HEIGHT * sizeof(uint16_t));
+    memset(t->hiz, 0xFF, sizeof(g_tile_hiz[0]));
+
+    uint32_t drawn_before = t->stats->pixels_drawn;
+    if (g_visibility && !t->heat) {
+        VisibilityTileRegion(tile, thread, t);
+    }
+    else {
+        for (uint16_t ref = g_bin_head[tile]; ref != BIN_END; ref = g_bin_ref_next[ref]) {
+            const BinnedTri_t* tri = &g_bin_tris[g_bin_ref_tri[ref]];
+            RasterDispatch(&tri->v[0], &tri->v[1], &tri->v[2], &tri->texture,
+                tri->color, tri->solid, tri->small, tri->blend, tri->variant, t);
+        }
+    }
+    for (uint32_t i = 0; i < g_bin_line_count; i++) {
+        const BinnedLine_t* l = &g_bin_lines[i];
+        if (l->depth_test) RasterLine<true>(t, l->x0, l->y0, l->z0, l->x1, l->y1, l->z1, l->color);
+        else RasterLine<false>(t, l->x0, l->y0, l->z0, l->x1, l->y1, l->z1, l->color);
+    }
+    g_tile_pixels[tile] += t->stats->pixels_drawn - drawn_before;
+
+    StoreTile(t);
+    if (g_store_color) StoreLayerTile(t);
+    if (g_store_overflow) StoreOverflowTile(t);
+}
+
+/* Job: shade one tile. Tiles touch disjoint screen pixels, so any number
+ * of threads can run this concurrently against the read-only bins. */
+static void FlushTile(uint32_t tile, uint32_t thread, void* user)
+{
+    const RasterTarget_t* screen = (const RasterTarget_t*)user;
+    if (g_bin_head[tile] == BIN_END && !g_clear_pending && g_bin_line_count == 0 &&
+        !g_layer_color && !g_store_color) return;
+    PROFILE_ZONE("FlushTile");
+
+    RasterTarget_t t;
+    t.color = g_tile_color[thread];
+    t.depth = g_tile_depth[thread];
+    t.hiz = g_tile_hiz[thread];
+    t.hiz_stride = TILE_WIDTH / RASTER_BLOCK;
+    t.heat = screen->heat;
+    t.heat_mode = screen->heat_mode;
+    t.shadow_mask = screen->shadow_mask;
+    t.perspective_span = screen->perspective_span;
+    t.traversal = screen->traversal;
+    t.depth_range = DEPTH_RANGE_FULL;
+    t.stride = TILE_WIDTH;
+#ifdef SDL_PC
+    t.wide_depth = NULL;
+#endif
+    t.origin_x = (tile % TILES_X) * TILE_WIDTH;
+    t.origin_y = (tile / TILES_X) * TILE_HEIGHT;
+    t.min_x = t.origin_x;
+    t.min_y = t.origin_y;
+    t.max_x = MIN(t.origin_x + TILE_WIDTH - 1, screen->max_x);
+    t.max_y = MIN(t.origin_y + TILE_HEIGHT - 1, screen->max_y);
+    t.stats = &g_thread_stats[thread];
+    if (t.min_x > t.max_x || t.min_y > t.max_y) return;
+
+    if (!g_default.scissor_on) {
+        ShadeTileRegion(tile, thread, &t);
+        return;
+    }
+
+    /* Each scissor rectangle in the tile is a pass of its own */
+    RasterTarget_t part;
+    for (uint32_t i = 0; i < g_default.scissor_count; i++) {
+        if (ScissorTarget(&g_default, &t, i, &part)) ShadeTileRegion(tile, thread, &part);
+    }
+}
+
+void Rasterizer_Flush(void)
+{
+    if (Capture_IsRecording()) Capture_OnFlush();
+
+    RasterTarget_t screen;
+    if (!g_binning || !GetContextTarget(&g_default, &screen)) return;
+    PROFILE_ZONE("Rasterizer_Flush");
+    uint64_t start = Profile_Now();
+    AcquireTarget(&g_default);
+
+    uint32_t threads = MIN(Jobs_GetThreadCount(), (uint32_t)TILE_THREADS);
+    memset(g_thread_stats, 0, sizeof(g_thread_stats));
+
+    if (threads > 1) {
+        Jobs_ParallelFor(TILE_COUNT, FlushTile, &screen);
+    }
+    else {
+        for (uint32_t tile = 0; tile < TILE_COUNT; tile++) FlushTile(tile, 0, &screen);
+    }
+
+    /* Merge per-thread counters */
+    RasterizerStats_t* stats = &g_default.stats;
+    for (uint32_t i = 0; i < threads; i++) {
+        stats->pixels_drawn += g_thread_stats[i].pixels_drawn;
+        stats->hiz_blocks_culled += g_thread_stats[i].hiz_blocks_culled;
+        stats->pixels_depth_rejected += g_thread_stats[i].pixels_depth_rejected;
+        stats->pixels_bbox += g_thread_stats[i].pixels_bbox;
+        stats->pixels_visited += g_thread_stats[i].pixels_visited;
+        stats->texels_fetched += g_thread_stats[i].texels_fetched;
+        stats->pixels_resolved += g_thread_stats[i].pixels_resolved;
+    }
+
+    g_clear_pending = 0;
+    g_layer_color = NULL;
+    ResetBins();
+    AddStageTicks(&g_default, RASTER_STAGE_RASTER, start, Profile_Now());
+}
+
+void Rasterizer_GetThreadStats(uint32_t thread, RasterizerStats_t* stats)
+{
+    if (thread >= TILE_THREADS) { memset(stats, 0, sizeof(*stats)); return; }
+    *stats = g_thread_stats[thread];
+}
+
+uint32_t Rasterizer_GetMemPools(MemPool_t* out, uint32_t max)
+{
+    uint32_t n = 0;
+#ifndef SDL_PC
+    n = MemMap_Add(out, n, max, "depth buffer", zbuffer, sizeof(zbuffer), sizeof(zbuffer));
+#endif
+    n = MemMap_Add(out, n, max, "screen hiz", g_screen_hiz, sizeof(g_screen_hiz), sizeof(g_screen_hiz));
+    n = MemMap_Add(out, n, max, "bin triangles", g_bin_tris, sizeof(g_bin_tris), sizeof(g_bin_tris));
+    n = MemMap_Add(out, n, max, "bin refs", g_bin_ref_tri, sizeof(g_bin_ref_tri), sizeof(g_bin_ref_tri));
+    n = MemMap_Add(out, n, max, "bin ref links", g_bin_ref_next, sizeof(g_bin_ref_next), sizeof(g_bin_ref_next));
+    n = MemMap_Add(out, n, max, "bin lines", g_bin_lines, sizeof(g_bin_lines), sizeof(g_bin_lines));
+    n = MemMap_Add(out, n, max, "tile color", g_tile_color, sizeof(g_tile_color), sizeof(g_tile_color));
+    n = MemMap_Add(out, n, max, "tile depth", g_tile_depth, sizeof(g_tile_depth), sizeof(g_tile_depth));
+    n = MemMap_Add(out, n, max, "tile hiz", g_tile_hiz, sizeof(g_tile_hiz), sizeof(g_tile_hiz));
+    n = MemMap_Add(out, n, max, "tile ids", g_tile_ids, sizeof(g_tile_ids), g_visibility ? sizeof(g_tile_ids) : 0);
+    n = MemMap_Add(out, n, max, "heat map", g_heat, sizeof(g_heat), g_heat_active ? sizeof(g_heat) : 0);
+    n = MemMap_Add(out, n, max, "shadow mask", g_shadow_mask, sizeof(g_shadow_mask),
+        (g_shadow_rows_min <= g_shadow_rows_max) ? sizeof(g_shadow_mask) : 0);
+    return n;
+}
+
+/* Color-only whole-screen target for lines drawn without depth */
+static void GetScreenLineTarget(RasterTarget_t* t)
+{
+    memset(t, 0, sizeof(*t));
+    t->color = g_default.color;
+    t->stride = g_default.stride;
+    t->max_x = g_default.width - 1;
+    t->max_y = g_default.height - 1;
+    t->stats = &g_default.stats;
+}
+
+void Rasterizer_DrawLine(int x0, int y0, int x1, int y1, uint16_t color)
+{
+    if (!g_default.color) return;
+    RasterTarget_t t;
+    GetScreenLineTarget(&t);
+    AcquireTarget(&g_default);
+    RasterLine<false>(&t, x0, y0, 0.0f, x1, y1, 0.0f, color);
+}
+
+void Rasterizer_DrawLine3D(const ScreenVertex_t* a, const ScreenVertex_t* b, uint16_t color, int depth_test)
+{
+    if (!g_default.color) return;
+    int x0 = a->x >> RASTER_SUBPIXEL_BITS, y0 = (a->y + g_field_offset) >> RASTER_SUBPIXEL_BITS;
+    int x1 = b->x >> RASTER_SUBPIXEL_BITS, y1 = (b->y + g_field_offset) >> RASTER_SUBPIXEL_BITS;
+    float z0 = a->z - RASTER_LINE_DEPTH_BIAS, z1 = b->z - RASTER_LINE_DEPTH_BIAS;
+
+    /* Trivially outside the rendered region */
+    int max_x = MIN(g_default.width, g_default.res_width) - 1;
+    int max_y = MIN(g_default.height, g_default.res_height) - 1;
+    if (MAX(x0, x1) < 0 || MAX(y0, y1) < 0 || MIN(x0, x1) > max_x || MIN(y0, y1) > max_y) return;
+
+    if (g_binning) {
+        if (g_bin_line_count >= MAX_BINNED_LINES) Rasterizer_Flush();
+        BinnedLine_t* l = &g_bin_lines[g_bin_line_count++];
+        l->x0 = x0;
+        l->y0 = y0;
+        l->x1 = x1;
+        l->y1 = y1;
+        l->z0 = z0;
+        l->z1 = z1;
+        l->color = color;
+        l->depth_test = (uint8_t)(depth_test != 0);
+        return;
+    }
+
+    RasterTarget_t t;
+    if (!depth_test || !GetContextTarget(&g_default, &t)) {
+        GetScreenLineTarget(&t);
+        depth_test = 0;
+    }
+    t.max_x = MIN(t.max_x, max_x);
+    t.max_y = MIN(t.max_y, max_y);
+    AcquireTarget(&g_default);
+    if (depth_test) RasterLine<true>(&t, x0, y0, z0, x1, y1, z1, color);
+    else RasterLine<false>(&t, x0, y0, z0, x1, y1, z1, color);
+}
+
+void Rasterizer_FillRect(int x, int y, int w, int h, uint16_t color)
+{
+    if (!g_default.color) return;
+    int width = g_default.width;
+    int height = g_default.height;
+    int x0 = MAX(x, 0), y0 = MAX(y, 0);
+    int x1 = MIN(x + w, width), y1 = MIN(y + h, height);
+    if (x0 >= x1 || y0 >= y1) return;
+    AcquireTarget(&g_default);
+
+    for (int py = y0; py < y1; py++) {
+        Clear_Fill16(&g_default.color[py * g_default.stride + x0], color, (uint32_t)(x1 - x0));
+    }
+}
+
+#define BLIT_CHUNK      64
+
+void Rasterizer_Blit(const Texture_t* texture, int src_x, int src_y, int x, int y, int w, int h,
+    int mode, uint8_t alpha)
+{
+    if (!g_default.color || !texture || !texture->pixels) return;
+    if (mode == 0 && alpha == 0) return;
+
+    /* Clip the source to the texture, then the destination to the screen,
+     * moving the other rectangle along */
+    if (src_x < 0) { x -= src_x; w += src_x; src_x = 0; }
+    if (src_y < 0) { y -= src_y; h += src_y; src_y = 0; }
+    w = MIN(w, (int)texture->width - src_x);
+    h = MIN(h, (int)texture->height - src_y);
+    if (x < 0) { src_x -= x; w += x; x = 0; }
+    if (y < 0) { src_y -= y; h += y; y = 0; }
+    w = MIN(w, g_default.width - x);
+    h = MIN(h, g_default.height - y);
+    if (w <= 0 || h <= 0) return;
+    AcquireTarget(&g_default);
+
+    uint16_t* dst = &g_default.color[y * g_default.stride + x];
+    if (texture->format == TEXTURE_FORMAT_RGB565 && !texture->tiled) {
+        const uint16_t* src = &texture->pixels[src_y * texture->width + src_x];
+        if (mode == 0) {
+            Clear_StartAlpha16(dst, src, (uint32_t)w, (uint32_t)h, (uint32_t)g_default.stride,
+                texture->width, alpha);
+            return;
+        }
+        for (int row = 0; row < h; row++) {
+            Color_BlendSpan565(dst + row * g_default.stride, src + row * texture->width, (uint32_t)w, mode);
+        }
+        return;
+    }
+
+    /* Texels decoded a chunk at a time, then laid over as above */
+    uint16_t texels[BLIT_CHUNK];
+    for (int row = 0; row < h; row++) {
+        for (int col = 0; col < w; col += BLIT_CHUNK) {
+            int n = MIN(BLIT_CHUNK, w - col);
+            for (int i = 0; i < n; i++) {
+                uint32_t offset = Texture_TexelOffset((uint32_t)(src_x + col + i), (uint32_t)(src_y + row),
+                    texture->width, texture->tiled);
+                texels[i] = Texture_Fetch(texture->pixels, texture->palette, offset, texture->format);
+            }
+            uint16_t* out = dst + row * g_default.stride + col;
+            if (mode == 0) {
+                Clear_StartAlpha16(out, texels, (uint32_t)n, 1, (uint32_t)g_default.stride, (uint32_t)n, alpha);
+                Clear_Wait();
+            }
+            else {
+                Color_BlendSpan565(out, texels, (uint32_t)n, mode);
+            }
+        }
+    }
+}
+
+void Rasterizer_SetHeatMode(int mode)
+{
+    g_heat_mode = (mode > RASTER_HEAT_OFF && mode < RASTER_HEAT_MODES) ? mode : RASTER_HEAT_OFF;
+}
+
+int Rasterizer_GetHeatMode(void)
+{
+    return g_heat_mode;
+}
+
+const uint16_t* Rasterizer_GetHeat(void)
+{
+    return g_heat_active ? g_heat : NULL;
+}
+
+#define HEAT_RAMP       256
+#define HEAT_AUTO_COUNT 6       /* One ramp key per layer */
+#define HEAT_AUTO_MEAN  3       /* Cost: multiples of the mean over covered pixels */
+
+static void BuildHeatRamp(uint16_t* ramp)
+{
+    static const uint16_t keys[] = {
+        COLOR_BLACK, COLOR_BLUE, COLOR_CYAN, COLOR_GREEN, COLOR_YELLOW, COLOR_RED, COLOR_WHITE
+    };
+    const int segments = (int)ARRAY_SIZE(keys) - 1;
+    for (int i = 0; i < HEAT_RAMP; i++) {
+        int pos = i * segments * 256 / (HEAT_RAMP - 1);
+        int k = MIN(pos >> 8, segments - 1);
+        uint32_t f = (uint32_t)(pos - (k << 8)) >> 3;     /* 5-bit weight, as Lerp565 */
+        uint32_t c = Lerp565(Expand565(keys[k]), Expand565(keys[k + 1]), MIN(f, 32u));
+        ramp[i] = (uint16_t)((c & 0xFFFF) | (c >> 16));
+    }
+}
+
+uint32_t Rasterizer_ResolveHeat(uint32_t scale)
+{
+    RasterTarget_t screen;
+    if (!g_heat_active || !GetContextTarget(&g_default, &screen) || !screen.heat) return 0;
+    int width = screen.max_x + 1, height = screen.max_y + 1;
+
+    if (scale == 0) {
+        scale = HEAT_AUTO_COUNT;
+        if (g_heat_active == RASTER_HEAT_COST) {
+            uint64_t sum = 0;
+            uint32_t covered = 0;
+            for (int y = 0; y < height; y++) {
+                const uint16_t* row = &g_heat[y * DISPLAY_WIDTH];
+                for (int x = 0; x < width; x++) {
+                    sum += row[x];
+                    covered += row[x] != 0;
+                }
+            }
+            scale = covered ? (uint32_t)(sum * HEAT_AUTO_MEAN / covered) : 1;
+            if (scale == 0) scale = 1;
+        }
+    }
+
+    uint16_t ramp[HEAT_RAMP];
+    BuildHeatRamp(ramp);
+    AcquireTarget(&g_default);
+
+    for (int y = 0; y < height; y++) {
+        const uint16_t* row = &g_heat[y * DISPLAY_WIDTH];
+        uint16_t* dst = &g_default.color[y * g_default.stride];
+        for (int x = 0; x < width; x++) {
+            uint32_t i = (uint32_t)MIN((uint64_t)row[x] * (HEAT_RAMP - 1) / scale, (uint64_t)(HEAT_RAMP - 1));
+            dst[x] = ramp[i];
+        }
+    }
+    return scale;
+}
+
+void RasterContext_GetStats(const RasterContext_t* ctx, RasterizerStats_t* stats) { *stats = ctx->stats; }
+
+void RasterContext_ResetStats(RasterContext_t* ctx)
+{
+    memset(&ctx->stats, 0, sizeof(ctx->stats));
+    if (ctx != &g_default) return;
+    memset(g_tile_triangles, 0, sizeof(g_tile_triangles));
+    memset(g_tile_pixels, 0, sizeof(g_tile_pixels));
+}
+
+void RasterContext_AddStageTime(RasterContext_t* ctx, uint32_t stage, uint64_t start, uint64_t end)
+{
+    if (stage < RASTER_STAGE_COUNT) AddStageTicks(ctx, stage, start, end);
+}
+
+void Rasterizer_GetStats(RasterizerStats_t* stats) { *stats = g_default.stats; }
+void Rasterizer_ResetStats(void) { RasterContext_ResetStats(&g_default); }
+void Rasterizer_AddStageTime(uint32_t stage, uint64_t start, uint64_t end) { RasterContext_AddStageTime(&g_default, stage, start, end); }
+void Rasterizer_AddCulledEntities(uint32_t count) { g_default.stats.entities_culled += count; }
+void Rasterizer_AddCulledClusters(uint32_t count) { g_default.stats.clusters_culled += count; }
+
+void Rasterizer_GetTileStats(uint32_t tile, uint32_t* triangles, uint32_t* pixels)
+{
+    *triangles = (tile < TILE_COUNT) ? g_tile_triangles[tile] : 0;
+    *pixels = (tile < TILE_COUNT) ? g_tile_pixels[tile] : 0;
+}
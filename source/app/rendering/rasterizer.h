@@ -4,37 +4,156 @@
 #include <stdint.h>
 #include "math3d.h"
 #include "engine_config.h"
+#include "memmap.h"
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+    /* Sub-pixel precision of ScreenVertex_t x/y. 4 bits keeps the edge
+     * function products in int32 range for the full guard band; 0 gives the
+     * old whole-pixel behaviour. Pixels are sampled at their centers and
+     * edges follow the top-left fill rule. */
+#define RASTER_SUBPIXEL_BITS    4
+#define RASTER_SUBPIXEL_SCALE   (1 << RASTER_SUBPIXEL_BITS)
+
+    /* Traversal block and HiZ cell size; tiles and the screen are multiples of it */
+#define RASTER_BLOCK            8
+
     /* Screen-space vertex after projection */
     typedef struct {
-        int32_t x, y;       /* 16.16 fixed point screen coords */
+        int32_t x, y;       /* Fixed point screen coords, RASTER_SUBPIXEL_BITS fraction */
         float z;            /* Normalized depth [0,1] */
         float w_inv;        /* 1/w for perspective correction */
         float u, v;         /* Texture coordinates (pre-divided by w for perspective) */
         uint16_t color;     /* RGB565 vertex color/lighting */
     } ScreenVertex_t;
 
+    /* Texel storage. Indexed formats pack texels into the uint16_t words
+     * little-endian, even texel in the low nibble for 4bpp, and resolve
+     * them through a palette of RGB565 entries. */
+#define TEXTURE_FORMAT_RGB565   0
+#define TEXTURE_FORMAT_INDEXED8 1   /* 256-entry palette */
+#define TEXTURE_FORMAT_INDEXED4 2   /* 16-entry palette */
+
     /* Texture structure */
     typedef struct {
         uint16_t* pixels;
+        const uint16_t* palette;    /* Indexed formats only */
         uint16_t width;
         uint16_t height;
         uint16_t width_mask;    /* width - 1 for power-of-2 wrapping */
         uint16_t height_mask;   /* height - 1 for power-of-2 wrapping */
+        uint8_t levels;         /* Mip levels stored after pixels, 1 = base only */
+        uint8_t tiled;          /* Texels in TEXTURE_TILE blocks, see below */
+        uint8_t format;         /* TEXTURE_FORMAT_* */
+        uint8_t width_shift;    /* log2(width) */
+        uint8_t height_shift;
     } Texture_t;
 
-    /* Rasterizer statistics */
+    /* Fixed-point texture coordinates: 16.16, TEXTURE_UV_ONE spans the texture */
+#define TEXTURE_UV_ONE          (1 << 16)
+
+    /* Tiled layout: 4x4 texel blocks (32 bytes of RGB565, one Cortex-M7
+     * cache line), blocks row-major, texels row-major inside a block. Any
+     * 2D neighbourhood then hits one or two lines whatever the span
+     * direction. Needs power-of-2 sides of at least TEXTURE_TILE. */
+#define TEXTURE_TILE            4
+
+    static inline uint32_t Texture_TexelOffset(uint32_t tx, uint32_t ty, uint32_t width, int tiled)
+    {
+        if (!tiled) return ty * width + tx;
+        return (ty & ~3u) * width + ((tx & ~3u) << 2) + ((ty & 3u) << 2) + (tx & 3u);
+    }
+
+    static inline uint32_t Texture_FormatBits(int format)
+    {
+        return (format == TEXTURE_FORMAT_INDEXED8) ? 8 : (format == TEXTURE_FORMAT_INDEXED4) ? 4 : 16;
+    }
+
+    /* Words one w x h level occupies */
+    static inline uint32_t Texture_LevelWords(uint32_t w, uint32_t h, int format)
+    {
+        return (w * h * Texture_FormatBits(format) + 15) >> 4;
+    }
+
+    /* Stored value of texel i: a color or a palette index */
+    static inline uint32_t Texture_FetchRaw(const uint16_t* pixels, uint32_t i, int format)
+    {
+        if (format == TEXTURE_FORMAT_RGB565) return pixels[i];
+        const uint8_t* bytes = (const uint8_t*)pixels;
+        if (format == TEXTURE_FORMAT_INDEXED8) return bytes[i];
+        return (bytes[i >> 1] >> ((i & 1) << 2)) & 0xF;
+    }
+
+    static inline uint16_t Texture_Fetch(const uint16_t* pixels, const uint16_t* palette, uint32_t i, int format)
+    {
+        uint32_t raw = Texture_FetchRaw(pixels, i, format);
+        return (format == TEXTURE_FORMAT_RGB565) ? (uint16_t)raw : palette[raw];
+    }
+
+    /* Pipeline stages timed in RasterizerStats_t::stage_ticks */
+#define RASTER_STAGE_TRANSFORM  0   /* Vertex transform and lighting (caller) */
+#define RASTER_STAGE_CLIP       1   /* Outcodes, clipping, projection */
+#define RASTER_STAGE_SETUP      2   /* Edge setup, bounds, binning */
+#define RASTER_STAGE_RASTER     3   /* Pixel loops; the whole flush when binning */
+#define RASTER_STAGE_PRESENT    4   /* Handing the frame to the display (caller) */
+#define RASTER_STAGE_COUNT      5
+
+    /* Rasterizer statistics. Every covered pixel is depth tested, so
+     * pixels tested = pixels_drawn + pixels_depth_rejected; of the
+     * bounding box, pixels_visited are those in blocks that were walked
+     * rather than skipped whole. */
     typedef struct {
         uint32_t triangles_submitted;
         uint32_t triangles_culled;
         uint32_t triangles_drawn;
-        uint32_t pixels_drawn;
+        uint32_t triangles_small;       /* Drawn by the few-pixel path, no edge setup */
+        uint32_t triangles_micro_culled;    /* Culled covering no pixel center (in triangles_culled) */
+        uint32_t pixels_drawn;          /* Passed depth and written */
+        uint32_t hiz_blocks_culled;     /* 8x8 blocks skipped by the coarse depth test */
+        uint32_t pixels_depth_rejected; /* Covered but failing depth, before shading */
+        uint32_t entities_culled;       /* Whole draws rejected by bounds before transform */
+        uint32_t clusters_culled;       /* Mesh clusters rejected before transform, meshcluster.h */
+        uint32_t pixels_bbox;           /* Clipped bounding boxes of rasterized triangles */
+        uint32_t pixels_visited;        /* Inside blocks that were not skipped */
+        uint32_t texels_fetched;        /* 1 per textured pixel, 4 when bilinear */
+        uint32_t pixels_resolved;       /* Shaded by the visibility buffer resolve */
+        uint32_t stage_ticks[RASTER_STAGE_COUNT];   /* Profile_Now() ticks */
     } RasterizerStats_t;
 
+    /* Render state for subsequent draws. Each combination maps to a
+     * compile-time specialized pixel loop selected once per triangle. */
+#define RASTER_STATE_DEPTH_TEST     (1 << 0)
+#define RASTER_STATE_DEPTH_WRITE    (1 << 1)
+#define RASTER_STATE_UNLIT          (1 << 2)    /* MAT_UNLIT: no vertex lighting */
+#define RASTER_STATE_AFFINE         (1 << 3)    /* Linear UVs, no per-pixel divide */
+#define RASTER_STATE_BILINEAR       (1 << 4)    /* 2x2 filtered texels instead of nearest */
+#define RASTER_STATE_CLAMP          (1 << 5)    /* Clamp UVs to the texture instead of wrapping */
+#define RASTER_STATE_BLEND_AVERAGE  (1 << 6)    /* MAT_TRANSPARENT: half over the target, no depth write */
+#define RASTER_STATE_BLEND_ADD      (1 << 7)    /* MAT_ADDITIVE: saturating add, no depth write */
+#define RASTER_STATE_BLEND_KEY      (1 << 8)    /* Cutout: COLOR_KEY_565 texels skipped, no depth write; draw unlit */
+#define RASTER_STATE_DEPTH_ONLY     (1 << 9)    /* Prepass: depth test and write only, see below */
+#define RASTER_STATE_SHADOW         (1 << 10)   /* Planar shadow: solid color averaged in once per pixel, see below */
+#define RASTER_STATE_DEFAULT        (RASTER_STATE_DEPTH_TEST | RASTER_STATE_DEPTH_WRITE)
+
+    /* Depth prepass: draw the opaque geometry once with DEPTH_ONLY (no
+     * texturing, lighting or color writes), then again with the normal
+     * state. The prepass stores depth RASTER_PREPASS_BIAS 16-bit units
+     * farther than the surface, so the second pass's strict test acts as
+     * an equal test: each pixel is shaded once, by its nearest surface,
+     * plus any other surface within the bias of it. With binning both
+     * passes must land in the same flush; the visibility buffer skips
+     * prepass triangles, as it shades once anyway. */
+#define RASTER_PREPASS_BIAS         4
+
+    /* Planar shadows (shadow.h): SHADOW triangles average their solid
+     * color into the target where the depth test passes, without writing
+     * depth, like BLEND_AVERAGE. On the screen each pixel is darkened at
+     * most once per frame, however many shadow triangles cover it: a bit
+     * mask marks the darkened pixels, and the rows it used are cleared at
+     * the next Rasterizer_Clear(). Other contexts have no mask. */
+
     /* Initialization */
     void Rasterizer_Init(void);
 
@@ -48,26 +167,272 @@ extern "C" {
     void Rasterizer_SetFrameBuffer(uint16_t* fb);
 #endif
 
+    void Rasterizer_SetState(uint32_t state);
+    uint32_t Rasterizer_GetState(void);
+
+    /* Perspective quality: 1 = exact divide per pixel, N = exact u/v every
+     * N pixels with linear steps in between (clamped to the 8-pixel block) */
+    void Rasterizer_SetPerspectiveSpan(int pixels);
+
+    /* Pixel traversal, RASTER_TRAVERSAL_* (engine_config.h); the build's
+     * RASTER_TRAVERSAL_DEFAULT until changed. Output is identical. */
+    void Rasterizer_SetTraversal(int mode);
+    int Rasterizer_GetTraversal(void);
+
+    /* Render resolution. Draws go to the top-left width x height of the
+     * screen and depth buffers (rows keep the display stride), and
+     * Rasterizer_Upscale() stretches that region over the whole screen.
+     * Sizes round down to RASTER_BLOCK multiples within the display; the
+     * default is the full display. Change it between frames. */
+    void Rasterizer_SetResolution(int width, int height);
+    void Rasterizer_GetResolution(int* width, int* height);
+
+    /* Nearest-neighbour stretch of the rendered region to the full screen,
+     * in place; no-op at full resolution. Call after Rasterizer_Flush()
+     * and before anything drawn at display resolution, such as overlays.
+     * On STM32 repeated rows are copied by DMA2D. */
+    void Rasterizer_Upscale(void);
+
+    /* Interlaced rendering: each Rasterizer_Clear() opens a field of the
+     * even or odd rows, alternating per frame, and only those are cleared
+     * and rasterized, for half the fill and depth traffic. Until
+     * Rasterizer_ResolveField() the screen context is the field: half the
+     * height (and resolution height), every other row, rows of the other
+     * parity untouched; projection through Rasterizer_GetResolution()
+     * follows on its own, and vertices are moved so pixels sample the
+     * centers of their screen rows. Scissor rectangles stay in screen
+     * rows: set them before the clear and reset them after the resolve,
+     * which puts back those of the clear. Depth alternation pauses while
+     * interlaced. Takes effect at the next clear. */
+    void Rasterizer_SetInterlace(int enabled);
+    int Rasterizer_IsInterlace(void);
+
+    /* Fills the rows the field skipped and restores the whole screen;
+     * no-op without an open field. Still scenes weave in the last frame's
+     * rows (DMA2D copy from the front buffer on STM32); with motion set,
+     * or below full resolution, each row is the mean of its neighbours
+     * (DMA2D blend on STM32). Call after Rasterizer_Flush() and
+     * Rasterizer_ResolveHeat(), before Rasterizer_Upscale(). */
+    void Rasterizer_ResolveField(int motion);
+
+    /* Scissor rectangles for partial redraws. While set, Rasterizer_Clear()
+     * clears only the rectangles (color and depth, no depth range flip)
+     * and triangles only touch pixels inside them; triangles missing all
+     * of them count as culled. Overlapping rectangles are only redundant
+     * work. count 0 restores the whole target; lines and FillRect ignore
+     * the scissor. Set it before Rasterizer_Clear() and keep it until
+     * after Rasterizer_Flush(). */
+#define RASTER_MAX_SCISSOR_RECTS    8
+
+    typedef struct {
+        int x, y, w, h;
+    } RasterRect_t;
+
+    void Rasterizer_SetScissorRects(const RasterRect_t* rects, uint32_t count);
+
     /* Clear operations */
     void Rasterizer_Clear(uint16_t color);
     void Rasterizer_ClearDepth(void);
 
+    /* Immediate-mode depth clear elimination: alternate frames use the near
+     * half of the 16-bit range (smaller wins) and the far half (larger
+     * wins), so Rasterizer_Clear() flips the range instead of clearing.
+     * Costs one bit of depth precision and the screen HiZ, and is only
+     * correct when every pixel is drawn each frame. Binned mode ignores it. */
+    void Rasterizer_SetDepthAlternate(int enabled);
+
+    /* Layers: a color and a 16-bit depth image of the display, rows
+     * DISPLAY_WIDTH apart, such as a cached background. ClearToLayer
+     * starts the frame as Rasterizer_Clear() does, from the layer's
+     * pixels and depth; binned, tiles load it during the flush, and later
+     * flushes of the frame still test against its depth. StoreLayer
+     * copies the rendered region into a layer after the last draw of it:
+     * binned, it flushes and stores the tiles, and the rest of the frame
+     * tests against the stored depth. Both cover the whole rendered
+     * region, so keep the scissor off, and return 0 without a 16-bit
+     * screen depth buffer or while interlaced. */
+    int Rasterizer_ClearToLayer(const uint16_t* color, const uint16_t* depth);
+    int Rasterizer_StoreLayer(uint16_t* color, uint16_t* depth);
+
     /* Triangle rasterization */
     void Rasterizer_DrawTriangle(const ScreenVertex_t* v0, const ScreenVertex_t* v1,
         const ScreenVertex_t* v2, const Texture_t* texture);
     void Rasterizer_DrawTriangleSolid(const ScreenVertex_t* v0, const ScreenVertex_t* v1,
         const ScreenVertex_t* v2, uint16_t color);
 
-    /* Line drawing (Bresenham) */
+    /* Indexed triangle list, three indices into verts per triangle, all
+     * with one texture or color. The draw state is set up once for the
+     * list rather than per triangle; the image is the same. */
+    void Rasterizer_DrawTriangles(const ScreenVertex_t* verts, const uint16_t* indices, uint32_t tri_count,
+        const Texture_t* texture);
+    void Rasterizer_DrawTrianglesSolid(const ScreenVertex_t* verts, const uint16_t* indices, uint32_t tri_count,
+        uint16_t color);
+
+    /* Tile binning: when enabled, triangles are recorded into TILE_WIDTH x
+     * TILE_HEIGHT screen bins and shaded per tile into a small local
+     * color/depth buffer on Rasterizer_Flush(). Rasterizer_Clear() is deferred
+     * to the flush, and depth only lives for the duration of one flush;
+     * flushes forced by full bins (MAX_BINNED_TRIANGLES, MAX_BIN_REFS)
+     * carry it over in a display-sized buffer (zbuffer on the board).
+     * With a job pool running (Jobs_Init), tiles are flushed in parallel. */
+    void Rasterizer_SetBinning(int enabled);
+    int  Rasterizer_IsBinning(void);
+
+    /* Visibility buffer for the binned path: each tile rasterizes depth
+     * and a 16-bit triangle index per pixel first, then shades every
+     * visible pixel exactly once from its triangle, so shading cost no
+     * longer grows with overdraw. The resolve interpolates in float and
+     * UVs exactly per pixel, whatever Rasterizer_SetPerspectiveSpan() or
+     * RASTER_FIXED_POINT say, so only stepped UVs can differ from the
+     * forward image. Immediate mode and heat maps draw forward. */
+    void Rasterizer_SetVisibilityBuffer(int enabled);
+    int  Rasterizer_IsVisibilityBuffer(void);
+    void Rasterizer_Flush(void);
+
+    /* Line straight to the screen, no depth. Clipped to the screen before
+     * the walk, so far off-screen endpoints cost nothing extra. */
     void Rasterizer_DrawLine(int x0, int y0, int x1, int y1, uint16_t color);
 
-    /* Texture sampling */
+    /* Line between two projected vertices (x, y, z read), clipped to the
+     * rendered region. With depth_test it is hidden behind the scene but
+     * writes no depth, and z is pulled RASTER_LINE_DEPTH_BIAS toward the
+     * eye so edges stay visible over their own faces. When binning, lines
+     * are queued (MAX_BINNED_LINES per flush; more flush early) and each
+     * tile draws them after its triangles, whatever the submission order.
+     * Scissor rectangles clip binned lines only. */
+#define RASTER_LINE_DEPTH_BIAS  0.0002f
+    void Rasterizer_DrawLine3D(const ScreenVertex_t* a, const ScreenVertex_t* b, uint16_t color, int depth_test);
+
+    /* Solid rectangle straight to the screen, no depth; after the flush
+     * when binning */
+    void Rasterizer_FillRect(int x, int y, int w, int h, uint16_t color);
+
+    /* Texels [src_x, src_x + w) x [src_y, src_y + h) of a texture's base
+     * level to the screen at (x, y), unscaled, no depth; e.g. HUD sprites
+     * and UI panels. Mode 0 lays them over at alpha (255 copies), on STM32
+     * as a DMA2D transfer the CPU does not wait for; COLOR_BLEND_* modes,
+     * such as COLOR_BLEND_KEY, and indexed or tiled textures go through
+     * the CPU, and alpha is then ignored. Clipped to the texture and the
+     * screen, not the scissor; after the flush when binning. */
+    void Rasterizer_Blit(const Texture_t* texture, int src_x, int src_y, int x, int y, int w, int h,
+        int mode, uint8_t alpha);
+
+    /* Texture sampling, nearest texel with wrapping */
     uint16_t Texture_Sample(const Texture_t* tex, float u, float v);
+    uint16_t Texture_SampleFixed(const Texture_t* tex, int32_t u, int32_t v);
 
     /* Statistics */
     void Rasterizer_GetStats(RasterizerStats_t* stats);
     void Rasterizer_ResetStats(void);
 
+    /* Records draws rejected by the caller's visibility test */
+    void Rasterizer_AddCulledEntities(uint32_t count);
+    void Rasterizer_AddCulledClusters(uint32_t count);
+
+    /* Adds [start, end) in Profile_Now() ticks to a stage the caller runs */
+    void Rasterizer_AddStageTime(uint32_t stage, uint64_t start, uint64_t end);
+
+    /* Triangles binned into and pixels drawn in one tile since the last
+     * Rasterizer_Clear(); zero in immediate mode */
+    void Rasterizer_GetTileStats(uint32_t tile, uint32_t* triangles, uint32_t* pixels);
+
+    /* Pixel counters gathered by one job thread during the last
+     * Rasterizer_Flush(); already merged into Rasterizer_GetStats() */
+    void Rasterizer_GetThreadStats(uint32_t thread, RasterizerStats_t* stats);
+
+    /* Debug heat map: each pixel the loops reach adds to a full-screen
+     * counter instead of being shaded, and Rasterizer_ResolveHeat() shows
+     * the counters in place of the frame. Coverage, depth and HiZ work as
+     * when rendering, so the tested and shaded counts are the frame's real
+     * depth complexity and overdraw. Cost mode does render, timing every
+     * triangle (per tile when binning) and spreading its ticks evenly over
+     * the pixels it covers, so small or expensive triangles stand out.
+     * Needs a target no larger than the display. */
+#define RASTER_HEAT_OFF         0
+#define RASTER_HEAT_TESTED      1   /* Depth tests per pixel */
+#define RASTER_HEAT_SHADED      2   /* Depth passes, i.e. shaded writes, per pixel */
+#define RASTER_HEAT_COST        3   /* Profile_Now() ticks per pixel */
+#define RASTER_HEAT_MODES       4
+
+    /* Takes effect at the next Rasterizer_Clear() */
+    void Rasterizer_SetHeatMode(int mode);
+    int  Rasterizer_GetHeatMode(void);
+
+    /* Replaces the screen with the counters on a black, blue, cyan, green,
+     * yellow, red, white ramp reaching white at `scale`. 0 picks one: six
+     * for the counts, so each layer is one step, and three times the mean
+     * over covered pixels for cost. Call after Rasterizer_Flush(); returns
+     * the scale used, 0 when heat mode is off. */
+    uint32_t Rasterizer_ResolveHeat(uint32_t scale);
+
+    /* Counters of the last frame, DISPLAY_WIDTH per row, saturating at
+     * 0xFFFF; NULL when heat mode is off */
+    const uint16_t* Rasterizer_GetHeat(void);
+
+    /* Depth, HiZ, bin and tile buffers for MemMap_Print() */
+    uint32_t Rasterizer_GetMemPools(MemPool_t* out, uint32_t max);
+
+    /* Render contexts. A context is one RGB565 target with its depth
+     * buffer, render state, scissor and statistics; draws into different
+     * contexts share no mutable state, so each can be fed from its own
+     * thread, e.g. a shadow or minimap pass next to the main view, or
+     * render to a texture's pixels. The Rasterizer_* calls above work on
+     * the default context, which targets the screen set by
+     * Rasterizer_SetDevice() / Rasterizer_SetFrameBuffer() and alone owns
+     * binning, the visibility buffer, heat maps, Rasterizer_Upscale(),
+     * lines and FillRect; other contexts always draw immediately. The
+     * caller owns the storage; treat the fields as private. */
+    typedef struct {
+        uint16_t* color;            /* RGB565, stride pixels per row */
+        void* depth;                /* depth_format values, same stride */
+        int32_t depth_format;       /* DEPTH_FORMAT_*; wide only on the PC Device */
+        int32_t width, height, stride;
+        uint16_t* hiz;              /* Max depth per RASTER_BLOCK cell, NULL = none */
+        int32_t hiz_stride;         /* Cells per row */
+        int32_t res_width, res_height;
+        uint32_t state;
+        int32_t perspective_span;
+        int32_t traversal;
+        int32_t depth_alternate;
+        int32_t depth_range;
+        int32_t scissor_on;
+        uint32_t scissor_count;
+        RasterRect_t scissor[RASTER_MAX_SCISSOR_RECTS];
+        RasterizerStats_t stats;
+    } RasterContext_t;
+
+    /* Targets width x height pixels of color and 16-bit depth, rows
+     * `stride` pixels apart in both, with default state and no HiZ. Any
+     * size works; nothing is cleared. */
+    void RasterContext_Init(RasterContext_t* ctx, uint16_t* color, uint16_t* depth,
+        int width, int height, int stride);
+
+    /* The screen context behind the Rasterizer_* calls */
+    RasterContext_t* Rasterizer_GetContext(void);
+
+    /* As the Rasterizer_* call of the same name, on ctx */
+    void RasterContext_SetState(RasterContext_t* ctx, uint32_t state);
+    uint32_t RasterContext_GetState(const RasterContext_t* ctx);
+    void RasterContext_SetPerspectiveSpan(RasterContext_t* ctx, int pixels);
+    void RasterContext_SetTraversal(RasterContext_t* ctx, int mode);
+    void RasterContext_SetResolution(RasterContext_t* ctx, int width, int height);
+    void RasterContext_GetResolution(const RasterContext_t* ctx, int* width, int* height);
+    void RasterContext_SetScissorRects(RasterContext_t* ctx, const RasterRect_t* rects, uint32_t count);
+    void RasterContext_Clear(RasterContext_t* ctx, uint16_t color);
+    void RasterContext_ClearDepth(RasterContext_t* ctx);
+    void RasterContext_SetDepthAlternate(RasterContext_t* ctx, int enabled);
+    void RasterContext_DrawTriangle(RasterContext_t* ctx, const ScreenVertex_t* v0,
+        const ScreenVertex_t* v1, const ScreenVertex_t* v2, const Texture_t* texture);
+    void RasterContext_DrawTriangleSolid(RasterContext_t* ctx, const ScreenVertex_t* v0,
+        const ScreenVertex_t* v1, const ScreenVertex_t* v2, uint16_t color);
+    void RasterContext_DrawTriangles(RasterContext_t* ctx, const ScreenVertex_t* verts, const uint16_t* indices,
+        uint32_t tri_count, const Texture_t* texture);
+    void RasterContext_DrawTrianglesSolid(RasterContext_t* ctx, const ScreenVertex_t* verts, const uint16_t* indices,
+        uint32_t tri_count, uint16_t color);
+    void RasterContext_GetStats(const RasterContext_t* ctx, RasterizerStats_t* stats);
+    void RasterContext_ResetStats(RasterContext_t* ctx);
+    void RasterContext_AddStageTime(RasterContext_t* ctx, uint32_t stage, uint64_t start, uint64_t end);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,123 @@
+/**
+ * @file renderqueue.cpp
+ * @brief Sorted Per-Frame Render Queue Implementation
+ */
+
+#include "renderqueue.h"
+#include "arena.h"
+#include <string.h>
+
+static RenderItem_t g_items[RQ_MAX_ITEMS];
+static RenderItem_t g_sorted[RQ_MAX_ITEMS];
+static uint16_t g_order[2][RQ_MAX_ITEMS];
+static uint32_t g_count;
+
+void RenderQueue_Begin(void)
+{
+    g_count = 0;
+}
+
+RenderItem_t* RenderQueue_Push(uint64_t key)
+{
+    if (g_count >= RQ_MAX_ITEMS) return NULL;
+    RenderItem_t* item = &g_items[g_count++];
+    item->key = key;
+    item->draw = NULL;
+    item->texture_id = 0xFFFFFFFF;
+    item->color = 0xFFFF;
+    item->impostor = 0xFFFF;
+    return item;
+}
+
+void RenderQueue_Sort(void)
+{
+    uint16_t* src = g_order[0];
+    uint16_t* dst = g_order[1];
+    for (uint32_t i = 0; i < g_count; i++) src[i] = (uint16_t)i;
+
+    /* One pass per key byte; bytes equal across the queue are skipped,
+     * which drops the unused low bits and usually the pass byte */
+    for (uint32_t shift = 0; shift < 64; shift += 8) {
+        uint32_t histogram[256];
+        memset(histogram, 0, sizeof(histogram));
+        for (uint32_t i = 0; i < g_count; i++) histogram[(g_items[i].key >> shift) & 0xFF]++;
+        if (g_count == 0 || histogram[(g_items[0].key >> shift) & 0xFF] == g_count) continue;
+
+        uint32_t offset = 0;
+        for (uint32_t b = 0; b < 256; b++) {
+            uint32_t n = histogram[b];
+            histogram[b] = offset;
+            offset += n;
+        }
+        for (uint32_t i = 0; i < g_count; i++) {
+            uint16_t idx = src[i];
+            dst[histogram[(g_items[idx].key >> shift) & 0xFF]++] = idx;
+        }
+        uint16_t* tmp = src; src = dst; dst = tmp;
+    }
+
+    for (uint32_t i = 0; i < g_count; i++) g_sorted[i] = g_items[src[i]];
+    memcpy(g_items, g_sorted, g_count * sizeof(RenderItem_t));
+}
+
+uint32_t RenderQueue_GetCount(void)
+{
+    return g_count;
+}
+
+const RenderItem_t* RenderQueue_GetItems(void)
+{
+    return g_items;
+}
+
+uint32_t RenderQueue_BatchEnd(uint32_t start, uint64_t mask)
+{
+    if (start >= g_count) return g_count;
+    uint64_t batch = g_items[start].key & mask;
+    uint32_t end = start + 1;
+    while (end < g_count && (g_items[end].key & mask) == batch) end++;
+    return end;
+}
+
+/* ============================================================
+ * Triangle Order Within A Draw
+ * ============================================================ */
+
+uint32_t* RenderQueue_SortTriangles(const ClipVertex_t* verts, const uint16_t* indices, uint32_t tri_count)
+{
+    if (tri_count == 0) return NULL;
+    uint32_t* keys = (uint32_t*)Arena_Alloc(tri_count * sizeof(uint32_t), ARENA_DEFAULT_ALIGN);
+    uint32_t* src = (uint32_t*)Arena_Alloc(tri_count * sizeof(uint32_t), ARENA_DEFAULT_ALIGN);
+    uint32_t* dst = (uint32_t*)Arena_Alloc(tri_count * sizeof(uint32_t), ARENA_DEFAULT_ALIGN);
+    if (!keys || !src || !dst) return NULL;
+
+    /* Positive floats order like their bit patterns */
+    for (uint32_t i = 0; i < tri_count; i++) {
+        const uint16_t* tri = &indices[i * 3];
+        float w = verts[tri[0]].pos.w + verts[tri[1]].pos.w + verts[tri[2]].pos.w;
+        uint32_t bits;
+        memcpy(&bits, &w, sizeof(bits));
+        keys[i] = (w > 0.0f) ? bits : 0;
+        src[i] = i;
+    }
+
+    for (uint32_t shift = 0; shift < 32; shift += 8) {
+        uint32_t histogram[256];
+        memset(histogram, 0, sizeof(histogram));
+        for (uint32_t i = 0; i < tri_count; i++) histogram[(keys[i] >> shift) & 0xFF]++;
+        if (histogram[(keys[0] >> shift) & 0xFF] == tri_count) continue;
+
+        uint32_t offset = 0;
+        for (uint32_t b = 0; b < 256; b++) {
+            uint32_t n = histogram[b];
+            histogram[b] = offset;
+            offset += n;
+        }
+        for (uint32_t i = 0; i < tri_count; i++) {
+            uint32_t tri = src[i];
+            dst[histogram[(keys[tri] >> shift) & 0xFF]++] = tri;
+        }
+        uint32_t* tmp = src; src = dst; dst = tmp;
+    }
+    return src;
+}
@@ -0,0 +1,123 @@
+/**
+ * @file renderqueue.h
+ * @brief Sorted Per-Frame Render Queue - NO MALLOC
+ *
+ * Draws are pushed with a packed 64-bit sort key, radix-sorted once per
+ * frame and executed in key order, so draws sharing a texture form
+ * contiguous batches and opaque geometry runs front to back for
+ * HiZ/early depth rejection. Key layout, most significant first:
+ *
+ *   63..60  pass      RQ_PASS_*
+ *   59..44  texture   16 bits, RQ_NO_TEXTURE for untextured draws
+ *   43..28  material  16 bits
+ *   27..4   depth     24 bits, nearest first
+ *    3..0   unused
+ *
+ * Opaque batches are the draws on one texture: nothing bound per batch
+ * depends on the material there, so materials whose textures went onto
+ * one atlas page (texatlas.h) draw as one batch.
+ *
+ * RQ_PASS_ALPHA keys put depth first, farthest first, and material and
+ * texture below it: blending needs back-to-front order across the whole
+ * pass, so transparent batches are only the draws at equal depth.
+ *
+ *   59..36  depth     24 bits, farthest first
+ *   35..20  material
+ *   19..4   texture
+ *
+ * Items carry a DrawCmd_t from the scene buffer, so a sorted queue is
+ * also what the render core consumes.
+ */
+
+#ifndef RENDERQUEUE_H
+#define RENDERQUEUE_H
+
+#include <stdint.h>
+#include "engine_config.h"
+#include "scenebuffer.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define RQ_MAX_ITEMS            SCENE_MAX_DRAWS
+
+/* Passes in execution order */
+#define RQ_PASS_OPAQUE          0
+#define RQ_PASS_ALPHA           1   /* Back to front */
+#define RQ_PASS_OVERLAY         2
+
+#define RQ_NO_TEXTURE           0xFFFF
+
+#define RQ_PASS_SHIFT           60
+#define RQ_TEXTURE_SHIFT        44
+#define RQ_MATERIAL_SHIFT       28
+#define RQ_DEPTH_SHIFT          4
+#define RQ_DEPTH_BITS           24
+#define RQ_ALPHA_DEPTH_SHIFT    36
+#define RQ_ALPHA_MATERIAL_SHIFT 20
+#define RQ_ALPHA_TEXTURE_SHIFT  4
+
+/* Key bits shared by one batch: pass and texture; alpha batches need
+ * the whole key */
+#define RQ_BATCH_MASK           (~0ull << RQ_TEXTURE_SHIFT)
+#define RQ_ALPHA_BATCH_MASK     (~0ull << RQ_ALPHA_TEXTURE_SHIFT)
+
+typedef struct {
+    uint64_t key;
+    const DrawCmd_t* draw;
+    uint32_t texture_id;        /* 0xFFFFFFFF = untextured */
+    uint16_t color;             /* Solid color of untextured draws */
+    uint16_t impostor;          /* Impostor slot, 0xFFFF = draw the mesh */
+} RenderItem_t;
+
+/* depth is normalized [0,1]; ids above 16 bits alias */
+static inline uint64_t RenderQueue_MakeKey(uint32_t pass, uint32_t material, uint32_t texture, float depth)
+{
+    if (depth < 0.0f) depth = 0.0f;
+    if (depth > 1.0f) depth = 1.0f;
+    uint32_t d = (uint32_t)(depth * (float)((1u << RQ_DEPTH_BITS) - 1));
+    if (pass == RQ_PASS_ALPHA) {
+        d = ((1u << RQ_DEPTH_BITS) - 1) - d;
+        return ((uint64_t)(pass & 0xF) << RQ_PASS_SHIFT) |
+            ((uint64_t)d << RQ_ALPHA_DEPTH_SHIFT) |
+            ((uint64_t)(material & 0xFFFF) << RQ_ALPHA_MATERIAL_SHIFT) |
+            ((uint64_t)(texture & 0xFFFF) << RQ_ALPHA_TEXTURE_SHIFT);
+    }
+
+    return ((uint64_t)(pass & 0xF) << RQ_PASS_SHIFT) |
+        ((uint64_t)(material & 0xFFFF) << RQ_MATERIAL_SHIFT) |
+        ((uint64_t)(texture & 0xFFFF) << RQ_TEXTURE_SHIFT) |
+        ((uint64_t)d << RQ_DEPTH_SHIFT);
+}
+
+void RenderQueue_Begin(void);
+
+/* Slot for one draw, NULL when the queue is full */
+RenderItem_t* RenderQueue_Push(uint64_t key);
+
+/* LSD radix sort on the keys; stable, so equal keys keep push order */
+void RenderQueue_Sort(void);
+
+uint32_t RenderQueue_GetCount(void);
+const RenderItem_t* RenderQueue_GetItems(void);
+
+/* End of the batch starting at `start`: first later item whose key
+ * differs in `mask` (RQ_BATCH_MASK for the texture,
+ * RQ_ALPHA_BATCH_MASK in the alpha pass) */
+uint32_t RenderQueue_BatchEnd(uint32_t start, uint64_t mask);
+
+/* Triangles of one large draw, nearest centroid (clip w) first, so the
+ * early depth test rejects what the mesh hides of itself. Returns triangle
+ * numbers in draw order from the frame arena, or NULL when the arena is
+ * full (draw in index order then). Below RQ_SORT_MIN_TRIANGLES sorting
+ * costs more than it saves. */
+#define RQ_SORT_MIN_TRIANGLES   128
+
+uint32_t* RenderQueue_SortTriangles(const ClipVertex_t* verts, const uint16_t* indices, uint32_t tri_count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* RENDERQUEUE_H */
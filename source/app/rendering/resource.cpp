@@ -7,7 +7,9 @@
 #include "mesh.h"
 #include "texture.h"
 #include "entity.h"
+#include "texatlas.h"
 #include "platform.h"
+#include "namehash.h"
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
@@ -18,11 +20,15 @@
 
 #define MAX_RESOURCES 64
 #define NAME_LENGTH 32
+#define MAX_REFS 0xFFFF         /* Saturated: the resource stays until shutdown */
 
 typedef struct {
     char name[NAME_LENGTH];
+    uint32_t name_hash;         /* Indexed under this while nonzero */
     uint8_t type;
     uint8_t flags;
+    uint16_t refs;              /* Holders; the data goes with the last */
+    uint32_t pool_id;           /* Mesh_* slot when loaded into the pools, else INVALID_RESOURCE */
     uint32_t vertex_count;
     uint32_t index_count;
     uint32_t frame_count;
@@ -34,17 +40,22 @@ typedef struct {
 
 typedef struct {
     char name[NAME_LENGTH];
+    uint32_t name_hash;         /* Indexed under this while nonzero */
     uint8_t in_use;
+    uint16_t refs;
+    uint32_t pool_id;           /* Texture_* slot when loaded into the pool, else INVALID_RESOURCE */
     uint16_t width;
     uint16_t height;
-    uint16_t* pixels;
+    uint16_t* pixels;           /* NULL when pooled */
 } TextureResource_t;
 
 typedef struct {
     char name[NAME_LENGTH];
+    uint32_t name_hash;         /* Indexed under this while nonzero */
     uint8_t in_use;
+    uint16_t refs;
     uint32_t flags;
-    TextureID texture;
+    TextureID texture;          /* Held while set */
     uint16_t color;
 } MaterialResource_t;
 
@@ -53,6 +64,13 @@ static MeshResource_t g_res_meshes[MAX_RESOURCES];
 static TextureResource_t g_res_textures[MAX_RESOURCES];
 static MaterialResource_t g_res_materials[MAX_RESOURCES];
 
+/* Name hash -> id, per pool */
+static uint32_t g_name_hashes[3][2 * MAX_RESOURCES];
+static uint16_t g_name_ids[3][2 * MAX_RESOURCES];
+static NameIndex_t g_mesh_names;
+static NameIndex_t g_texture_names;
+static NameIndex_t g_material_names;
+
 static uint32_t g_mesh_memory = 0;
 static uint32_t g_texture_memory = 0;
 
@@ -66,6 +84,60 @@ static inline Vertex_t MakeVertex(Vec3 pos, Vec3 norm, Vec2 uv)
     return v;
 }
 
+/* ============================================================
+ * Name Index
+ * ============================================================ */
+
+static void Unname(NameIndex_t* index, uint32_t* name_hash, uint32_t id)
+{
+    if (*name_hash) NameIndex_Remove(index, *name_hash, (uint16_t)id);
+    *name_hash = 0;
+}
+
+static void Name(NameIndex_t* index, char* name, uint32_t* name_hash, const char* new_name, uint32_t id)
+{
+    if (new_name) strncpy(name, new_name, NAME_LENGTH - 1);
+    *name_hash = Name_Hash(name);
+    NameIndex_Insert(index, *name_hash, (uint16_t)id);
+}
+
+/* Lowest id under hash whose live_name() matches name, if given */
+static uint32_t FindNamed(const NameIndex_t* index, uint32_t hash, const char* name,
+    const char* (*live_name)(uint32_t id))
+{
+    uint32_t best = INVALID_RESOURCE;
+    uint32_t cursor = 0;
+    uint16_t id;
+    while ((id = NameIndex_Next(index, hash, &cursor)) != NAME_INDEX_EMPTY) {
+        const char* n = live_name(id);
+        if (id >= best || !n || (name && strcmp(n, name) != 0)) continue;
+        best = id;
+    }
+    return best;
+}
+
+static const char* MeshName(uint32_t id)
+{
+    return g_res_meshes[id].type != 0 ? g_res_meshes[id].name : NULL;
+}
+
+static const char* TextureName(uint32_t id)
+{
+    return g_res_textures[id].in_use ? g_res_textures[id].name : NULL;
+}
+
+static const char* MaterialName(uint32_t id)
+{
+    return g_res_materials[id].in_use ? g_res_materials[id].name : NULL;
+}
+
+static void ResetNames(void)
+{
+    NameIndex_Init(&g_mesh_names, g_name_hashes[0], g_name_ids[0], 2 * MAX_RESOURCES);
+    NameIndex_Init(&g_texture_names, g_name_hashes[1], g_name_ids[1], 2 * MAX_RESOURCES);
+    NameIndex_Init(&g_material_names, g_name_hashes[2], g_name_ids[2], 2 * MAX_RESOURCES);
+}
+
 /* ============================================================
  * Initialization
  * ============================================================ */
@@ -75,6 +147,7 @@ void Resource_Init(void)
     memset(g_res_meshes, 0, sizeof(g_res_meshes));
     memset(g_res_textures, 0, sizeof(g_res_textures));
     memset(g_res_materials, 0, sizeof(g_res_materials));
+    ResetNames();
     g_mesh_memory = 0;
     g_texture_memory = 0;
 }
@@ -83,6 +156,7 @@ void Resource_Shutdown(void)
 {
     for (int i = 0; i < MAX_RESOURCES; i++) {
         if (g_res_meshes[i].type != 0) {
+            if (g_res_meshes[i].pool_id != INVALID_RESOURCE) Mesh_Free(g_res_meshes[i].pool_id);
             free(g_res_meshes[i].vertex_data);
             free(g_res_meshes[i].index_data);
             g_res_meshes[i].type = 0;
@@ -91,12 +165,18 @@ void Resource_Shutdown(void)
 
     for (int i = 0; i < MAX_RESOURCES; i++) {
         if (g_res_textures[i].in_use) {
+            if (g_res_textures[i].pool_id != INVALID_RESOURCE) Texture_Free(g_res_textures[i].pool_id);
             free(g_res_textures[i].pixels);
             g_res_textures[i].in_use = 0;
         }
     }
 
     memset(g_res_materials, 0, sizeof(g_res_materials));
+    for (int i = 0; i < MAX_RESOURCES; i++) {
+        g_res_meshes[i].name_hash = 0;
+        g_res_textures[i].name_hash = 0;
+    }
+    ResetNames();
     g_mesh_memory = 0;
     g_texture_memory = 0;
 }
@@ -109,8 +189,11 @@ static MeshID AllocMesh(const char* name)
 {
     for (uint32_t i = 0; i < MAX_RESOURCES; i++) {
         if (g_res_meshes[i].type == 0) {
+            Unname(&g_mesh_names, &g_res_meshes[i].name_hash, i);   /* Left by a failed create */
             memset(&g_res_meshes[i], 0, sizeof(MeshResource_t));
-            if (name) strncpy(g_res_meshes[i].name, name, NAME_LENGTH - 1);
+            Name(&g_mesh_names, g_res_meshes[i].name, &g_res_meshes[i].name_hash, name, i);
+            g_res_meshes[i].refs = 1;
+            g_res_meshes[i].pool_id = INVALID_RESOURCE;
             return i;
         }
     }
@@ -120,27 +203,109 @@ static MeshID AllocMesh(const char* name)
 MeshID Resource_FindMesh(const char* name)
 {
     if (!name) return INVALID_RESOURCE;
-    for (uint32_t i = 0; i < MAX_RESOURCES; i++) {
-        if (g_res_meshes[i].type != 0 && strcmp(g_res_meshes[i].name, name) == 0) {
-            return i;
-        }
-    }
-    return INVALID_RESOURCE;
+    return FindNamed(&g_mesh_names, Name_Hash(name), name, MeshName);
+}
+
+MeshID Resource_FindMeshByHash(uint32_t name_hash)
+{
+    return FindNamed(&g_mesh_names, name_hash, NULL, MeshName);
+}
+
+void Resource_RetainMesh(MeshID id)
+{
+    if (id < MAX_RESOURCES && g_res_meshes[id].type != 0 && g_res_meshes[id].refs < MAX_REFS) g_res_meshes[id].refs++;
 }
 
 void Resource_FreeMesh(MeshID id)
 {
     if (id >= MAX_RESOURCES || g_res_meshes[id].type == 0) return;
+    if (g_res_meshes[id].refs == MAX_REFS || --g_res_meshes[id].refs > 0) return;
 
+    if (g_res_meshes[id].pool_id != INVALID_RESOURCE) Mesh_Free(g_res_meshes[id].pool_id);
     uint32_t mem = g_res_meshes[id].vertex_count * sizeof(Vertex_t) +
         g_res_meshes[id].index_count * sizeof(uint16_t);
     g_mesh_memory -= mem;
 
     free(g_res_meshes[id].vertex_data);
     free(g_res_meshes[id].index_data);
+    Unname(&g_mesh_names, &g_res_meshes[id].name_hash, id);
     memset(&g_res_meshes[id], 0, sizeof(MeshResource_t));
 }
 
+/* ============================================================
+ * Loading With Deduplication
+ * ============================================================ */
+
+static MeshID FindMeshPoolId(uint32_t pool_id)
+{
+    for (uint32_t i = 0; i < MAX_RESOURCES; i++) {
+        if (g_res_meshes[i].type != 0 && g_res_meshes[i].pool_id == pool_id) return i;
+    }
+    return INVALID_RESOURCE;
+}
+
+static MeshID LoadMesh(const void* data, uint32_t size, const char* name, uint32_t (*load)(const void*, uint32_t))
+{
+    if (!data || size == 0) return INVALID_RESOURCE;
+
+    /* The pool loaders recognise a file already loaded and hand back its
+     * slot with one more holder: keep one pool holder per resource */
+    uint32_t pool_id = load(data, size);
+    const MeshSlot_t* m = Mesh_Get(pool_id);
+    if (!m) return INVALID_RESOURCE;
+    MeshID id = FindMeshPoolId(pool_id);
+    if (id != INVALID_RESOURCE) {
+        Mesh_Free(pool_id);
+        Resource_RetainMesh(id);
+        return id;
+    }
+
+    id = AllocMesh(name);
+    if (id == INVALID_RESOURCE) {
+        Mesh_Free(pool_id);
+        return INVALID_RESOURCE;
+    }
+
+    MeshResource_t* r = &g_res_meshes[id];
+    r->pool_id = pool_id;
+    if (m->type == 1) {
+        r->vertex_count = m->stat.vertex_count;
+        r->index_count = m->stat.index_count;
+        r->bounds_center = m->stat.bounds_center;
+        r->bounds_radius = m->stat.bounds_radius;
+    }
+    else {
+        r->vertex_count = (uint32_t)m->anim.verts_per_frame * m->anim.frame_count;
+        r->index_count = m->anim.index_count;
+        r->frame_count = m->anim.frame_count;
+        r->bounds_center = m->anim.bounds_center;
+        r->bounds_radius = m->anim.bounds_radius;
+    }
+    r->type = m->type;
+    g_mesh_memory += r->vertex_count * sizeof(Vertex_t) + r->index_count * sizeof(uint16_t);
+    return id;
+}
+
+MeshID Resource_LoadMeshOBJ(const void* data, uint32_t size, const char* name)
+{
+    return LoadMesh(data, size, name, Mesh_LoadOBJ);
+}
+
+MeshID Resource_LoadMeshMD2(const void* data, uint32_t size, const char* name)
+{
+    return LoadMesh(data, size, name, Mesh_LoadMD2);
+}
+
+uint32_t Resource_GetMeshPoolId(MeshID id)
+{
+    return (id < MAX_RESOURCES && g_res_meshes[id].type != 0) ? g_res_meshes[id].pool_id : INVALID_RESOURCE;
+}
+
+uint32_t Resource_GetMeshRefs(MeshID id)
+{
+    return (id < MAX_RESOURCES && g_res_meshes[id].type != 0) ? g_res_meshes[id].refs : 0;
+}
+
 /* ============================================================
  * Primitive Mesh Creation
  * ============================================================ */
@@ -410,8 +575,11 @@ static TextureID AllocTexture(const char* name)
 {
     for (uint32_t i = 0; i < MAX_RESOURCES; i++) {
         if (!g_res_textures[i].in_use) {
+            Unname(&g_texture_names, &g_res_textures[i].name_hash, i);   /* Left by a failed create */
             memset(&g_res_textures[i], 0, sizeof(TextureResource_t));
-            if (name) strncpy(g_res_textures[i].name, name, NAME_LENGTH - 1);
+            Name(&g_texture_names, g_res_textures[i].name, &g_res_textures[i].name_hash, name, i);
+            g_res_textures[i].refs = 1;
+            g_res_textures[i].pool_id = INVALID_RESOURCE;
             return i;
         }
     }
@@ -421,20 +589,69 @@ static TextureID AllocTexture(const char* name)
 TextureID Resource_FindTexture(const char* name)
 {
     if (!name) return INVALID_RESOURCE;
+    return FindNamed(&g_texture_names, Name_Hash(name), name, TextureName);
+}
+
+TextureID Resource_FindTextureByHash(uint32_t name_hash)
+{
+    return FindNamed(&g_texture_names, name_hash, NULL, TextureName);
+}
+
+TextureID Resource_LoadTextureBMP(const void* data, uint32_t size, const char* name)
+{
+    if (!data || size == 0) return INVALID_RESOURCE;
+
+    /* As LoadMesh(): one pool holder per resource */
+    uint32_t pool_id = Texture_LoadBMP(data, size);
+    const TextureSlot_t* t = Texture_Get(pool_id);
+    if (!t) return INVALID_RESOURCE;
     for (uint32_t i = 0; i < MAX_RESOURCES; i++) {
-        if (g_res_textures[i].in_use && strcmp(g_res_textures[i].name, name) == 0) {
+        if (g_res_textures[i].in_use && g_res_textures[i].pool_id == pool_id) {
+            Texture_Free(pool_id);
+            Resource_RetainTexture(i);
             return i;
         }
     }
-    return INVALID_RESOURCE;
+
+    TextureID id = AllocTexture(name);
+    if (id == INVALID_RESOURCE) {
+        Texture_Free(pool_id);
+        return INVALID_RESOURCE;
+    }
+
+    TextureResource_t* r = &g_res_textures[id];
+    r->pool_id = pool_id;
+    r->width = t->width;
+    r->height = t->height;
+    r->in_use = 1;
+    g_texture_memory += r->width * r->height * 2;
+    return id;
+}
+
+uint32_t Resource_GetTexturePoolId(TextureID id)
+{
+    return (id < MAX_RESOURCES && g_res_textures[id].in_use) ? g_res_textures[id].pool_id : INVALID_RESOURCE;
+}
+
+uint32_t Resource_GetTextureRefs(TextureID id)
+{
+    return (id < MAX_RESOURCES && g_res_textures[id].in_use) ? g_res_textures[id].refs : 0;
+}
+
+void Resource_RetainTexture(TextureID id)
+{
+    if (id < MAX_RESOURCES && g_res_textures[id].in_use && g_res_textures[id].refs < MAX_REFS) g_res_textures[id].refs++;
 }
 
 void Resource_FreeTexture(TextureID id)
 {
     if (id >= MAX_RESOURCES || !g_res_textures[id].in_use) return;
+    if (g_res_textures[id].refs == MAX_REFS || --g_res_textures[id].refs > 0) return;
 
+    if (g_res_textures[id].pool_id != INVALID_RESOURCE) Texture_Free(g_res_textures[id].pool_id);
     g_texture_memory -= g_res_textures[id].width * g_res_textures[id].height * 2;
     free(g_res_textures[id].pixels);
+    Unname(&g_texture_names, &g_res_textures[id].name_hash, id);
     memset(&g_res_textures[id], 0, sizeof(TextureResource_t));
 }
 
@@ -501,8 +718,9 @@ MaterialID Resource_CreateMaterial(const char* name)
     for (uint32_t i = 0; i < MAX_RESOURCES; i++) {
         if (!g_res_materials[i].in_use) {
             memset(&g_res_materials[i], 0, sizeof(MaterialResource_t));
-            if (name) strncpy(g_res_materials[i].name, name, NAME_LENGTH - 1);
+            Name(&g_material_names, g_res_materials[i].name, &g_res_materials[i].name_hash, name, i);
             g_res_materials[i].in_use = 1;
+            g_res_materials[i].refs = 1;
             g_res_materials[i].texture = INVALID_RESOURCE;
             g_res_materials[i].color = 0xFFFF;
             return i;
@@ -514,6 +732,8 @@ MaterialID Resource_CreateMaterial(const char* name)
 void Material_SetTexture(MaterialID mat, TextureID tex)
 {
     if (mat < MAX_RESOURCES && g_res_materials[mat].in_use) {
+        Resource_RetainTexture(tex);
+        Resource_FreeTexture(g_res_materials[mat].texture);
         g_res_materials[mat].texture = tex;
     }
 }
@@ -535,19 +755,150 @@ void Material_SetFlags(MaterialID mat, uint32_t flags)
 MaterialID Resource_FindMaterial(const char* name)
 {
     if (!name) return INVALID_RESOURCE;
-    for (uint32_t i = 0; i < MAX_RESOURCES; i++) {
-        if (g_res_materials[i].in_use && strcmp(g_res_materials[i].name, name) == 0) {
-            return i;
-        }
-    }
-    return INVALID_RESOURCE;
+    return FindNamed(&g_material_names, Name_Hash(name), name, MaterialName);
+}
+
+MaterialID Resource_FindMaterialByHash(uint32_t name_hash)
+{
+    return FindNamed(&g_material_names, name_hash, NULL, MaterialName);
+}
+
+void Resource_RetainMaterial(MaterialID id)
+{
+    if (id < MAX_RESOURCES && g_res_materials[id].in_use && g_res_materials[id].refs < MAX_REFS) g_res_materials[id].refs++;
+}
+
+uint32_t Resource_GetMaterialRefs(MaterialID id)
+{
+    return (id < MAX_RESOURCES && g_res_materials[id].in_use) ? g_res_materials[id].refs : 0;
 }
 
 void Resource_FreeMaterial(MaterialID id)
 {
-    if (id < MAX_RESOURCES) {
-        memset(&g_res_materials[id], 0, sizeof(MaterialResource_t));
+    if (id >= MAX_RESOURCES || !g_res_materials[id].in_use) return;
+    if (g_res_materials[id].refs == MAX_REFS || --g_res_materials[id].refs > 0) return;
+
+    Resource_FreeTexture(g_res_materials[id].texture);
+    Unname(&g_material_names, &g_res_materials[id].name_hash, id);
+    memset(&g_res_materials[id], 0, sizeof(MaterialResource_t));
+}
+
+/* ============================================================
+ * Texture Atlas
+ * ============================================================ */
+
+#define ATLAS_CONFLICT 0xFFFFFFFE
+
+/* Per pool mesh: the pool texture it is drawn with, ATLAS_CONFLICT for
+ * several. Per pool texture: seen, refused, and its source index. */
+static uint32_t g_atlas_mesh_texture[MAX_MESHES];
+static uint8_t g_atlas_seen[MAX_TEXTURES];
+static uint8_t g_atlas_refused[MAX_TEXTURES];
+static uint8_t g_atlas_source[MAX_TEXTURES];
+
+static uint32_t MaterialPoolTexture(MaterialID mat)
+{
+    if (mat >= MAX_RESOURCES || !g_res_materials[mat].in_use) return INVALID_RESOURCE;
+    uint32_t tex = Resource_GetTexturePoolId(g_res_materials[mat].texture);
+    return (tex < MAX_TEXTURES) ? tex : INVALID_RESOURCE;
+}
+
+/* Resource holding a new page */
+static TextureID PageResource(uint32_t page)
+{
+    TextureID id = AllocTexture("Atlas");
+    if (id == INVALID_RESOURCE) return INVALID_RESOURCE;
+    const TextureSlot_t* t = Texture_Get(page);
+    TextureResource_t* r = &g_res_textures[id];
+    r->pool_id = page;
+    r->width = t->width;
+    r->height = t->height;
+    r->in_use = 1;
+    g_texture_memory += r->width * r->height * 2;
+    return id;
+}
+
+uint32_t Resource_AtlasMaterials(void)
+{
+    for (uint32_t i = 0; i < MAX_MESHES; i++) g_atlas_mesh_texture[i] = INVALID_RESOURCE;
+    memset(g_atlas_seen, 0, sizeof(g_atlas_seen));
+    memset(g_atlas_refused, 0, sizeof(g_atlas_refused));
+
+    /* The texture each drawn mesh samples; a mesh on two refuses both */
+    EntityIterator_t it;
+    Entity_BeginIteration(&it, COMP_MESH_RENDERER);
+    while (Entity_Next(&it)) {
+        const MeshRenderer_t* mr = Entity_GetMeshRenderer(it.current);
+        uint32_t tex = MaterialPoolTexture(mr->material_id);
+        if (tex == INVALID_RESOURCE || mr->mesh_id >= MAX_MESHES) continue;
+        g_atlas_seen[tex] = 1;
+        uint32_t* drawn = &g_atlas_mesh_texture[mr->mesh_id];
+        if (*drawn == INVALID_RESOURCE || *drawn == tex) {
+            *drawn = tex;
+            continue;
+        }
+        if (*drawn != ATLAS_CONFLICT) g_atlas_refused[*drawn] = 1;
+        g_atlas_refused[tex] = 1;
+        *drawn = ATLAS_CONFLICT;
+    }
+    for (uint32_t m = 0; m < MAX_MESHES; m++) {
+        uint32_t tex = g_atlas_mesh_texture[m];
+        if (tex < MAX_TEXTURES && !TexAtlas_CanRemap(m)) g_atlas_refused[tex] = 1;
+    }
+
+    uint32_t sources[TEXATLAS_MAX_SOURCES];
+    TexAtlasEntry_t entries[TEXATLAS_MAX_SOURCES];
+    uint32_t count = 0;
+    for (uint32_t t = 0; t < MAX_TEXTURES; t++) {
+        if (count == TEXATLAS_MAX_SOURCES) g_atlas_refused[t] = 1;
+        if (!g_atlas_seen[t] || g_atlas_refused[t]) continue;
+        g_atlas_source[t] = (uint8_t)count;
+        sources[count++] = t;
+    }
+    uint32_t pages = (count >= 2) ? TexAtlas_Build(sources, count, entries) : 0;
+    if (pages == 0) return 0;
+
+    /* A resource per page, held by the pass until the materials take it;
+     * without one for each, nothing moves */
+    TextureID page_res[TEXATLAS_MAX_SOURCES];
+    uint32_t page_ids[TEXATLAS_MAX_SOURCES];
+    uint32_t made = 0;
+    int wrapped = 1;
+    for (uint32_t k = 0; k < count; k++) {
+        if (entries[k].texture_id == sources[k]) continue;
+        uint32_t p = 0;
+        while (p < made && page_ids[p] != entries[k].texture_id) p++;
+        if (p == made) {
+            page_ids[made] = entries[k].texture_id;
+            page_res[made] = PageResource(entries[k].texture_id);
+            if (page_res[made] == INVALID_RESOURCE) wrapped = 0;
+            made++;
+        }
+    }
+    if (!wrapped) {
+        for (uint32_t p = 0; p < made; p++) {
+            if (page_res[p] != INVALID_RESOURCE) Resource_FreeTexture(page_res[p]);
+            else Texture_Free(page_ids[p]);
+        }
+        return 0;
     }
+
+    for (uint32_t m = 0; m < MAX_MESHES; m++) {
+        uint32_t tex = g_atlas_mesh_texture[m];
+        if (tex >= MAX_TEXTURES || !g_atlas_seen[tex] || g_atlas_refused[tex]) continue;
+        const TexAtlasEntry_t* e = &entries[g_atlas_source[tex]];
+        if (e->texture_id != tex) TexAtlas_RemapMesh(m, e);
+    }
+    for (uint32_t i = 0; i < MAX_RESOURCES; i++) {
+        uint32_t tex = MaterialPoolTexture(i);
+        if (tex == INVALID_RESOURCE || !g_atlas_seen[tex] || g_atlas_refused[tex]) continue;
+        const TexAtlasEntry_t* e = &entries[g_atlas_source[tex]];
+        for (uint32_t p = 0; p < made; p++) {
+            if (page_ids[p] == e->texture_id && page_ids[p] != tex) Material_SetTexture(i, page_res[p]);
+        }
+    }
+    for (uint32_t p = 0; p < made; p++) Resource_FreeTexture(page_res[p]);
+    return pages;
 }
 
 /* ============================================================
@@ -559,7 +910,7 @@ void Entity_SetMesh(uint32_t entity_id, MeshID mesh)
 {
     MeshRenderer_t* mr = Entity_GetMeshRenderer(entity_id);
     if (mr && mesh < MAX_RESOURCES && g_res_meshes[mesh].type != 0) {
-        mr->mesh_id = mesh;
+        MeshRenderer_SetMesh(mr, g_res_meshes[mesh].pool_id);
         mr->bounds_center = g_res_meshes[mesh].bounds_center;
         mr->bounds_radius = g_res_meshes[mesh].bounds_radius;
     }
@@ -569,7 +920,7 @@ void Entity_SetMaterial(uint32_t entity_id, MaterialID material)
 {
     MeshRenderer_t* mr = Entity_GetMeshRenderer(entity_id);
     if (mr && material < MAX_RESOURCES && g_res_materials[material].in_use) {
-        mr->material_id = material;
+        MeshRenderer_SetMaterial(mr, material);
     }
 }
 
@@ -622,6 +973,8 @@ uint32_t Resource_GetMaterialCount(void)
 Vertex_t* Resource_GetMeshVertices(MeshID id)
 {
     if (id < MAX_RESOURCES && g_res_meshes[id].type == 1) {
+        const MeshSlot_t* m = Mesh_Get(g_res_meshes[id].pool_id);
+        if (m) return (m->flags & MESH_FLAG_BAKED) ? NULL : &g_vertex_pool[m->stat.vertex_start];
         return (Vertex_t*)g_res_meshes[id].vertex_data;
     }
     return NULL;
@@ -630,6 +983,9 @@ Vertex_t* Resource_GetMeshVertices(MeshID id)
 uint16_t* Resource_GetMeshIndices(MeshID id)
 {
     if (id < MAX_RESOURCES && g_res_meshes[id].type != 0) {
+        const MeshSlot_t* m = Mesh_Get(g_res_meshes[id].pool_id);
+        if (m && (m->flags & MESH_FLAG_BAKED)) return NULL;
+        if (m) return &g_index_pool[(m->type == 1) ? m->stat.index_start : m->anim.index_start];
         return g_res_meshes[id].index_data;
     }
     return NULL;
@@ -650,6 +1006,7 @@ uint32_t Resource_GetMeshIndexCount(MeshID id)
 uint16_t* Resource_GetTexturePixels(TextureID id)
 {
     if (id < MAX_RESOURCES && g_res_textures[id].in_use) {
+        if (g_res_textures[id].pool_id != INVALID_RESOURCE) return Texture_GetPixels(g_res_textures[id].pool_id);
         return g_res_textures[id].pixels;
     }
     return NULL;
@@ -689,4 +1046,12 @@ uint32_t Material_GetFlags(MaterialID id)
         return g_res_materials[id].flags;
     }
     return 0;
+}
+
+void Material_GetDraw(MaterialID mat, uint16_t* color, uint32_t* texture)
+{
+    if (mat >= MAX_RESOURCES || !g_res_materials[mat].in_use) return;
+    *color = g_res_materials[mat].color;
+    uint32_t tex = Resource_GetTexturePoolId(g_res_materials[mat].texture);
+    if (tex != INVALID_RESOURCE) *texture = tex;
 }
\ No newline at end of file
@@ -57,21 +57,33 @@ void Resource_Shutdown(void);
  * You can also create primitives programmatically.
  * ============================================================ */
 
-/* Load from memory (for embedded data) */
+/* Load from memory (for embedded data) into the mesh pools. The same file
+ * loaded again returns the first ID with one more reference instead of a
+ * second copy (the pools recognise it, Mesh_LoadOBJ()); the first name
+ * stays. */
 MeshID Resource_LoadMeshOBJ(const void* data, uint32_t size, const char* name);
 MeshID Resource_LoadMeshMD2(const void* data, uint32_t size, const char* name);
 
+/* Mesh_* slot of a loaded mesh, for MeshRenderer_t mesh_id;
+ * INVALID_RESOURCE for primitives */
+uint32_t Resource_GetMeshPoolId(MeshID id);
+
 /* Create primitive meshes */
 MeshID Resource_CreateCube(float size, const char* name);
 MeshID Resource_CreateSphere(float radius, int segments, const char* name);
 MeshID Resource_CreatePlane(float width, float height, const char* name);
 MeshID Resource_CreateCylinder(float radius, float height, int segments, const char* name);
 
-/* Get mesh by name */
+/* Get mesh by name, or by a NAME_HASH() of it (namehash.h) */
 MeshID Resource_FindMesh(const char* name);
+MeshID Resource_FindMeshByHash(uint32_t name_hash);
 
-/* Free mesh */
+/* Every load, create or retain is one reference; Resource_FreeMesh drops
+ * one and releases the pool memory with the last. A count that reaches
+ * 0xFFFF saturates and the resource stays until Resource_Shutdown(). */
+void Resource_RetainMesh(MeshID id);
 void Resource_FreeMesh(MeshID id);
+uint32_t Resource_GetMeshRefs(MeshID id);
 
 /* ============================================================
  * TEXTURE LOADING
@@ -83,18 +95,23 @@ void Resource_FreeMesh(MeshID id);
  * IMPORTANT: Use power-of-2 sizes (64, 128, 256) for best performance!
  * ============================================================ */
 
-/* Load from memory */
+/* Load from memory into the texture pool; duplicates share one copy as
+ * with meshes */
 TextureID Resource_LoadTextureBMP(const void* data, uint32_t size, const char* name);
+uint32_t Resource_GetTexturePoolId(TextureID id);
 
 /* Create procedural textures */
 TextureID Resource_CreateSolidTexture(uint16_t color, int size, const char* name);
 TextureID Resource_CreateCheckerTexture(uint16_t c1, uint16_t c2, int size, const char* name);
 
-/* Get texture by name */
+/* Get texture by name, or by a NAME_HASH() of it */
 TextureID Resource_FindTexture(const char* name);
+TextureID Resource_FindTextureByHash(uint32_t name_hash);
 
-/* Free texture */
+/* Reference counted as meshes are */
+void Resource_RetainTexture(TextureID id);
 void Resource_FreeTexture(TextureID id);
+uint32_t Resource_GetTextureRefs(TextureID id);
 
 /* ============================================================
  * MATERIALS
@@ -109,20 +126,43 @@ void Resource_FreeTexture(TextureID id);
 #define MAT_UNLIT       (1 << 0)    /* No lighting calculations */
 #define MAT_TRANSPARENT (1 << 1)    /* Enable alpha blending */
 #define MAT_DOUBLESIDED (1 << 2)    /* Disable backface culling */
+#define MAT_ADDITIVE    (1 << 3)    /* With MAT_TRANSPARENT: add to the target instead of averaging */
 
 /* Create material */
 MaterialID Resource_CreateMaterial(const char* name);
 
-/* Set material properties */
+/* Set material properties; the material holds a reference to its texture */
 void Material_SetTexture(MaterialID mat, TextureID tex);
 void Material_SetColor(MaterialID mat, uint16_t color);
 void Material_SetFlags(MaterialID mat, uint32_t flags);
 
-/* Get material by name */
+/* MAT_* flags; 0 for an unused id */
+uint32_t Material_GetFlags(MaterialID mat);
+
+/* Color and Texture_* slot to draw with, for a MeshDrawMaterial_t
+ * callback; each is left as passed when the material has none */
+void Material_GetDraw(MaterialID mat, uint16_t* color, uint32_t* texture);
+
+/* Get material by name, or by a NAME_HASH() of it */
 MaterialID Resource_FindMaterial(const char* name);
+MaterialID Resource_FindMaterialByHash(uint32_t name_hash);
 
-/* Free material */
+/* Reference counted as meshes are; the last release also drops the
+ * texture. Renderers hold one through MeshRenderer_SetMaterial(). */
+void Resource_RetainMaterial(MaterialID id);
 void Resource_FreeMaterial(MaterialID id);
+uint32_t Resource_GetMaterialRefs(MaterialID id);
+
+/* Load-time atlas pass (texatlas.h) over the active mesh renderers:
+ * small pooled textures of their materials go onto shared pages, the
+ * meshes drawn with them get their UVs moved into place and the
+ * materials point at the page, so they draw as one batch. A texture is
+ * left alone if one of its meshes is also drawn with another texture
+ * or cannot be remapped. Sources go once nothing else holds them; free
+ * your own references to give their slots back. Run it once the scene
+ * is set up; meshes are remapped in place, so run it once. Returns the
+ * pages made. */
+uint32_t Resource_AtlasMaterials(void);
 
 /* ============================================================
  * ENTITY INTEGRATION
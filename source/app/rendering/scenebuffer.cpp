@@ -0,0 +1,388 @@
+/**
+ * @file scenebuffer.cpp
+ * @brief Double-Buffered Draw List Handoff Implementation
+ */
+
+#include "scenebuffer.h"
+#include "spatial.h"
+#include "meshlod.h"
+#include "meshcluster.h"
+#include "occlusion.h"
+#include "resource.h"
+#include "hsem.h"
+#include "profile.h"
+#include <string.h>
+
+/* List states */
+#define LIST_FREE       0
+#define LIST_WRITING    1
+#define LIST_READY      2
+#define LIST_READING    3
+
+/* One block so both images agree on the layout */
+typedef struct {
+    volatile uint32_t state[SCENE_LIST_COUNT];
+    volatile uint32_t frame;                    /* Last frame handed out */
+    volatile uint32_t flags[MAX_FLAGS];
+    SceneBufferStats_t stats;
+    DrawList_t lists[SCENE_LIST_COUNT];
+} SceneShared_t;
+
+SHARED_DATA static SceneShared_t g_scene;
+
+#define RETAIN_NONE     0xFFFF
+
+/* Producer-side copy of the last full build's static draws, valid for
+ * the view and static generation it was built under */
+typedef struct {
+    int enabled;
+    int valid;
+    Mat4 view_proj;
+    uint32_t generation;
+    uint32_t occluded;                          /* Static draws the occluders hid */
+    uint32_t count;
+    uint16_t slot[MAX_ENTITIES];                /* Entity slot -> cmds[], RETAIN_NONE if not drawn */
+    DrawCmd_t cmds[SCENE_MAX_DRAWS];
+} SceneRetained_t;
+
+static SceneRetained_t g_retained;
+
+/* ============================================================
+ * Handoff
+ * ============================================================ */
+
+static inline void Lock(void)
+{
+    Hsem_Take(HSEM_ID_SCENE_BUFFER);
+}
+
+static inline void Unlock(void)
+{
+    Hsem_Release(HSEM_ID_SCENE_BUFFER);
+}
+
+static inline uint32_t ListIndex(const DrawList_t* list)
+{
+    return (uint32_t)(list - g_scene.lists);
+}
+
+void SceneBuffer_Init(void)
+{
+    Lock();
+    for (uint32_t i = 0; i < SCENE_LIST_COUNT; i++) {
+        g_scene.state[i] = LIST_FREE;
+        g_scene.lists[i].frame = 0;
+        g_scene.lists[i].count = 0;
+    }
+    g_scene.frame = 0;
+    for (uint32_t i = 0; i < MAX_FLAGS; i++) g_scene.flags[i] = 0;
+    memset(&g_scene.stats, 0, sizeof(g_scene.stats));
+    Unlock();
+    g_retained.enabled = 1;
+    g_retained.valid = 0;
+}
+
+DrawList_t* SceneBuffer_BeginWrite(void)
+{
+    Lock();
+
+    /* Prefer a free list; otherwise replace the oldest unread one */
+    int pick = -1;
+    for (uint32_t i = 0; i < SCENE_LIST_COUNT; i++) {
+        if (g_scene.state[i] == LIST_FREE) { pick = (int)i; break; }
+    }
+    if (pick < 0) {
+        for (uint32_t i = 0; i < SCENE_LIST_COUNT; i++) {
+            if (g_scene.state[i] != LIST_READY) continue;
+            if (pick < 0 || g_scene.lists[i].frame < g_scene.lists[pick].frame) pick = (int)i;
+        }
+        if (pick >= 0) g_scene.stats.dropped++;
+    }
+
+    DrawList_t* list = NULL;
+    if (pick >= 0) {
+        g_scene.state[pick] = LIST_WRITING;
+        list = &g_scene.lists[pick];
+        list->frame = ++g_scene.frame;
+        list->count = 0;
+        list->culled = 0;
+        list->occluded = 0;
+    }
+    Unlock();
+    return list;
+}
+
+void SceneBuffer_EndWrite(DrawList_t* list)
+{
+    if (!list) return;
+    Lock();
+    g_scene.state[ListIndex(list)] = LIST_READY;
+    g_scene.flags[FLAG_NEW_FRAME] = 1;
+    g_scene.stats.published++;
+    Unlock();
+}
+
+const DrawList_t* SceneBuffer_AcquireRead(void)
+{
+    Lock();
+
+    int pick = -1;
+    for (uint32_t i = 0; i < SCENE_LIST_COUNT; i++) {
+        if (g_scene.state[i] != LIST_READY) continue;
+        if (pick < 0 || g_scene.lists[i].frame > g_scene.lists[pick].frame) pick = (int)i;
+    }
+
+    const DrawList_t* list = NULL;
+    if (pick >= 0) {
+        /* Older ready lists would only take the consumer back in time */
+        for (uint32_t i = 0; i < SCENE_LIST_COUNT; i++) {
+            if ((int)i != pick && g_scene.state[i] == LIST_READY) {
+                g_scene.state[i] = LIST_FREE;
+                g_scene.stats.dropped++;
+            }
+        }
+        g_scene.state[pick] = LIST_READING;
+        g_scene.flags[FLAG_NEW_FRAME] = 0;
+        g_scene.stats.consumed++;
+        list = &g_scene.lists[pick];
+    }
+    Unlock();
+    return list;
+}
+
+void SceneBuffer_ReleaseRead(const DrawList_t* list)
+{
+    if (!list) return;
+    Lock();
+    g_scene.state[ListIndex(list)] = LIST_FREE;
+    Unlock();
+}
+
+/* ============================================================
+ * Serialization
+ * ============================================================ */
+
+/* Clusters of a static mesh's level 0 that the occluders leave visible */
+static uint32_t VisibleClusters(const MeshSlot_t* mesh, const Mat4* world)
+{
+    uint32_t count;
+    const MeshCluster_t* clusters = Mesh_GetClusters(mesh, &count);
+    uint32_t mask = MESH_CLUSTERS_ALL;
+    for (uint32_t k = 0; k < MIN(count, (uint32_t)MESH_CLUSTER_MASK_BITS); k++) {
+        if (!Occlusion_TestBounds(world, clusters[k].center, clusters[k].radius)) mask &= ~(1u << k);
+    }
+    return mask;
+}
+
+/* Static renderers whose draws the retained list keeps */
+static inline int IsRetained(const MeshRenderer_t* mr)
+{
+    return g_retained.enabled && mr->is_static && !mr->is_animated;
+}
+
+static inline int IsOccluder(const MeshRenderer_t* mr)
+{
+    /* Transparent meshes are seen through */
+    return mr->visible && mr->occluder && !mr->is_animated && !(Material_GetFlags(mr->material_id) & MAT_TRANSPARENT);
+}
+
+/* Occlusion test, detail level and the command for one visible entity;
+ * 0 if the occluders hide it */
+static int EmitDraw(DrawList_t* list, EntityID id, const Transform_t* xform, MeshRenderer_t* mr,
+    const Mat4* view_proj)
+{
+    if (!mr->occluder && !Occlusion_TestBounds(&xform->world_matrix, mr->bounds_center, mr->bounds_radius)) {
+        list->occluded++;
+        list->culled++;
+        return 0;
+    }
+
+    /* Detail from the projected bounds, against last frame's level;
+     * animation detail from the same radius */
+    const MeshSlot_t* mesh = Mesh_Get(mr->mesh_id);
+    uint32_t lod = 0, anim_lod = 0;
+    if (mesh && (Mesh_GetLodCount(mesh) > 1 || mr->is_animated)) {
+        float radius = Mesh_ProjectedRadius(view_proj, &xform->world_matrix, mr->bounds_center,
+            mr->bounds_radius);
+        if (Mesh_GetLodCount(mesh) > 1) lod = Mesh_SelectLod(mesh, radius, mr->lod);
+        if (mr->is_animated) anim_lod = MAX(lod, Mesh_SelectAnimLod(radius));
+    }
+    mr->lod = (uint8_t)lod;
+    mr->drawn = 1;
+
+    DrawCmd_t* cmd = &list->cmds[list->count++];
+    cmd->world = xform->world_matrix;
+    cmd->entity = id;
+    cmd->mesh_id = mr->mesh_id;
+    cmd->material_id = mr->material_id;
+    cmd->anim_frame_a = mr->anim_frame_a;
+    cmd->anim_frame_b = mr->anim_frame_b;
+    cmd->anim_lerp = mr->is_animated ? Mesh_LodAnimLerp(mr->anim_lerp, anim_lod) : mr->anim_lerp;
+    cmd->flags = mr->is_animated ? DRAW_FLAG_ANIMATED : 0;
+    uint32_t mat_flags = Material_GetFlags(mr->material_id);
+    if (mat_flags & MAT_TRANSPARENT) {
+        cmd->flags |= DRAW_FLAG_TRANSPARENT;
+        if (mat_flags & MAT_ADDITIVE) cmd->flags |= DRAW_FLAG_ADDITIVE;
+    }
+    else if (mr->is_static && !mr->is_animated) {
+        cmd->flags |= DRAW_FLAG_STATIC;
+    }
+    if (mr->cast_shadows) cmd->flags |= DRAW_FLAG_CAST_SHADOW;
+    cmd->lod = lod;
+    cmd->cluster_mask = MESH_CLUSTERS_ALL;
+    if (mesh && lod == 0 && !mr->occluder && Occlusion_GetOccluderCount() > 0) {
+        cmd->cluster_mask = VisibleClusters(mesh, &xform->world_matrix);
+    }
+    return 1;
+}
+
+/* The retained draws hold while the view and the static renderers do,
+ * and no moving occluder is in view: the occlusion buffer of the build
+ * that filled them is then still this frame's */
+static int CanReuse(const Mat4* view_proj, const EntityID* visible, uint32_t visible_count)
+{
+    if (!g_retained.enabled || !g_retained.valid || g_retained.generation != Entity_GetStaticGeneration() ||
+        memcmp(&g_retained.view_proj, view_proj, sizeof(Mat4)) != 0) return 0;
+
+    for (uint32_t v = 0; v < visible_count; v++) {
+        const MeshRenderer_t* mr = Entity_GetMeshRenderer(visible[v]);
+        if (mr && !IsRetained(mr) && IsOccluder(mr)) return 0;
+    }
+    return 1;
+}
+
+uint32_t SceneBuffer_Build(DrawList_t* list, const Mat4* view_proj, const ClipFrustum_t* frustum)
+{
+    PROFILE_ZONE("SceneBuffer_Build");
+    static EntityID visible[MAX_ENTITIES];
+    uint32_t visible_count = Spatial_QueryFrustum(frustum, visible, MAX_ENTITIES);
+
+    list->view_proj = *view_proj;
+    list->culled = Spatial_GetCount() - visible_count;
+    list->count = 0;
+
+    /* Lights are few and reach past the frustum: all active ones */
+    list->light_count = 0;
+    EntityIterator_t it;
+    Entity_BeginIteration(&it, COMP_LIGHT);
+    while (Entity_Next(&it) && list->light_count < MAX_LIGHTS) {
+        const Light_t* light = Entity_GetLight(it.current);
+        const Transform_t* xform = Entity_GetTransform(it.current);
+        if (!light || !xform || light->intensity <= 0.0f) continue;
+
+        SceneLight_t* out = &list->lights[list->light_count++];
+        const float* m = xform->world_matrix.m;
+        out->type = (uint32_t)light->type;
+        out->position = Vec3_Create(m[12], m[13], m[14]);
+        out->direction = Vec3_Normalize(Vec3_Create(-m[8], -m[9], -m[10]));
+        out->color = Vec3_Scale(light->color, light->intensity);
+        out->range = light->range;
+        out->cos_cone = cosf(light->spot_angle * 0.5f);
+    }
+
+    int reuse = CanReuse(view_proj, visible, visible_count);
+    list->occluded = 0;
+    if (reuse) {
+        Lock();
+        g_scene.stats.static_reused++;
+        Unlock();
+        list->occluded = g_retained.occluded;
+        list->culled += g_retained.occluded;
+    }
+    else {
+        /* Visible occluders first, depth only, into the occlusion buffer */
+        int moving_occluders = 0;
+        Occlusion_Begin(view_proj);
+        for (uint32_t v = 0; v < visible_count; v++) {
+            const Transform_t* xform = Entity_GetTransform(visible[v]);
+            const MeshRenderer_t* mr = Entity_GetMeshRenderer(visible[v]);
+            if (!xform || !mr || !IsOccluder(mr)) continue;
+            Occlusion_AddOccluder(mr->mesh_id, &xform->world_matrix);
+            if (!IsRetained(mr)) moving_occluders = 1;
+        }
+
+        g_retained.valid = g_retained.enabled && !moving_occluders;
+        g_retained.view_proj = *view_proj;
+        g_retained.generation = Entity_GetStaticGeneration();
+        g_retained.occluded = 0;
+        g_retained.count = 0;
+        if (g_retained.valid) {
+            for (uint32_t i = 0; i < MAX_ENTITIES; i++) g_retained.slot[i] = RETAIN_NONE;
+        }
+    }
+
+    /* In visible order either way, so a reused list matches a full build */
+    for (uint32_t v = 0; v < visible_count && list->count < SCENE_MAX_DRAWS; v++) {
+        Transform_t* xform = Entity_GetTransform(visible[v]);
+        MeshRenderer_t* mr = Entity_GetMeshRenderer(visible[v]);
+        if (!xform || !mr || !mr->visible || mr->mesh_id == 0xFFFFFFFF) continue;
+
+        uint32_t slot = ENTITY_INDEX(visible[v]);
+        if (reuse && IsRetained(mr)) {
+            if (g_retained.slot[slot] != RETAIN_NONE) list->cmds[list->count++] = g_retained.cmds[g_retained.slot[slot]];
+            continue;
+        }
+
+        uint32_t occluded = list->occluded;
+        int drawn = EmitDraw(list, visible[v], xform, mr, view_proj);
+        if (reuse || !g_retained.valid || !IsRetained(mr)) continue;
+        if (drawn) {
+            g_retained.slot[slot] = (uint16_t)g_retained.count;
+            g_retained.cmds[g_retained.count++] = list->cmds[list->count - 1];
+        }
+        else {
+            g_retained.occluded += list->occluded - occluded;
+        }
+    }
+
+    /* A full list may have left statics out that a later visible order fits */
+    if (!reuse && list->count == SCENE_MAX_DRAWS) g_retained.valid = 0;
+    return list->count;
+}
+
+void SceneBuffer_SetRetainStatic(int enabled)
+{
+    g_retained.enabled = enabled ? 1 : 0;
+    g_retained.valid = 0;
+}
+
+int SceneBuffer_IsRetainStatic(void)
+{
+    return g_retained.enabled;
+}
+
+void SceneBuffer_InvalidateStatic(void)
+{
+    g_retained.valid = 0;
+}
+
+/* ============================================================
+ * Flags And Stats
+ * ============================================================ */
+
+void SceneBuffer_SetFlag(uint32_t flag, uint32_t value)
+{
+    if (flag >= MAX_FLAGS) return;
+    Lock();
+    g_scene.flags[flag] = value;
+    Unlock();
+}
+
+uint32_t SceneBuffer_GetFlag(uint32_t flag)
+{
+    return (flag < MAX_FLAGS) ? g_scene.flags[flag] : 0;
+}
+
+void SceneBuffer_GetStats(SceneBufferStats_t* stats)
+{
+    Lock();
+    *stats = g_scene.stats;
+    Unlock();
+}
+
+uint32_t SceneBuffer_GetMemPools(MemPool_t* out, uint32_t max)
+{
+    uint32_t count = MemMap_Add(out, 0, max, "scene buffer", &g_scene, sizeof(g_scene), sizeof(g_scene));
+    return MemMap_Add(out, count, max, "retained draws", &g_retained, sizeof(g_retained),
+        sizeof(g_retained) - (SCENE_MAX_DRAWS - g_retained.count) * sizeof(DrawCmd_t));
+}
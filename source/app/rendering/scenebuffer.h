@@ -0,0 +1,124 @@
+/**
+ * @file scenebuffer.h
+ * @brief Double-Buffered Draw List Handoff Between Logic And Render Cores
+ *
+ * The CM4 runs game logic (Entity_UpdateTransforms, Entity_UpdateAnimators),
+ * culls against the camera frustum and occluders (occlusion.h) and
+ * serializes the visible meshes and the active lights into a DrawList_t; the CM7 consumes the list and
+ * rasterizes it. Two lists live in SHARED_DATA and move through
+ * FREE -> WRITING -> READY -> READING under HSEM_ID_SCENE_BUFFER, so
+ * each core works on its own list while the other is busy. The consumer
+ * always takes the newest READY list; a list the producer overwrites
+ * before it was read counts as dropped.
+ *
+ * Static renderers (MeshRenderer_t is_static, not animated) keep their
+ * draws between lists: a build copies them from the previous one, in
+ * the same visible order, while the view_proj is unchanged, no static
+ * renderer has moved or left (Entity_GetStaticGeneration()) and no
+ * moving occluder is in view. Their occlusion buffer, detail levels and
+ * cluster masks are then still exact, so only the moving entities are
+ * tested and serialized. Edits to a static renderer's fields or to its
+ * material need SceneBuffer_InvalidateStatic().
+ *
+ * Meshes and textures are referenced by ID and must be loaded before the
+ * CM4 starts. The .shared section has to be linked at the same address
+ * in both images and mapped non-cacheable on the CM7 (MPU). On SDL_PC
+ * both sides run on one thread, or a second thread stands in for the
+ * CM4.
+ */
+
+#ifndef SCENEBUFFER_H
+#define SCENEBUFFER_H
+
+#include <stdint.h>
+#include "math3d.h"
+#include "engine_config.h"
+#include "entity.h"
+#include "clip.h"
+#include "memmap.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SCENE_MAX_DRAWS         MAX_RENDER_ENTITIES
+#define SCENE_LIST_COUNT        2
+
+#define DRAW_FLAG_ANIMATED      0x01
+#define DRAW_FLAG_TRANSPARENT   0x02    /* MAT_TRANSPARENT: blended in the alpha pass */
+#define DRAW_FLAG_ADDITIVE      0x04    /* MAT_ADDITIVE: with TRANSPARENT, add instead of average */
+#define DRAW_FLAG_STATIC        0x08    /* MeshRenderer_t is_static, opaque and not animated */
+#define DRAW_FLAG_CAST_SHADOW   0x10    /* MeshRenderer_t cast_shadows: flattened onto the ground, shadow.h */
+
+typedef struct {
+    Mat4 world;
+    EntityID entity;
+    uint32_t mesh_id;
+    uint32_t material_id;
+    uint16_t anim_frame_a;
+    uint16_t anim_frame_b;
+    float anim_lerp;            /* Coarsened for distant levels, Mesh_LodAnimLerp() */
+    uint32_t flags;             /* DRAW_FLAG_* */
+    uint32_t lod;               /* Mesh detail level */
+    uint32_t cluster_mask;      /* Clusters 0-31 not hidden by occluders; later ones always drawn */
+} DrawCmd_t;
+
+/* An active Light_t in world space, gathered once per list */
+typedef struct {
+    uint32_t type;              /* LIGHT_DIRECTIONAL, LIGHT_POINT or LIGHT_SPOT */
+    Vec3 position;              /* Point and spot */
+    Vec3 direction;             /* Unit, the way the light travels: transform forward */
+    Vec3 color;                 /* Light_t color times intensity */
+    float range;                /* Point and spot: no light at this distance */
+    float cos_cone;             /* Spot: cosine of the half angle */
+} SceneLight_t;
+
+typedef struct {
+    uint32_t frame;             /* Producer frame number, starts at 1 */
+    uint32_t count;
+    uint32_t culled;            /* Entities rejected by the frustum or occluders */
+    uint32_t occluded;          /* Of those, hidden behind occluders */
+    Mat4 view_proj;
+    uint32_t light_count;       /* 0 = default top light, see lighting.h */
+    SceneLight_t lights[MAX_LIGHTS];
+    DrawCmd_t cmds[SCENE_MAX_DRAWS];
+} DrawList_t;
+
+typedef struct {
+    uint32_t published;
+    uint32_t consumed;
+    uint32_t dropped;           /* Published lists replaced before being read */
+    uint32_t static_reused;     /* Lists built with the retained static draws */
+} SceneBufferStats_t;
+
+/* Once, on the CM7, before the CM4 is released */
+void SceneBuffer_Init(void);
+
+/* Producer (CM4). BeginWrite returns NULL only if no list is available. */
+DrawList_t* SceneBuffer_BeginWrite(void);
+uint32_t SceneBuffer_Build(DrawList_t* list, const Mat4* view_proj, const ClipFrustum_t* frustum);
+void SceneBuffer_EndWrite(DrawList_t* list);
+
+/* Retained static draws, on by default; off rebuilds every list in full */
+void SceneBuffer_SetRetainStatic(int enabled);
+int SceneBuffer_IsRetainStatic(void);
+
+/* Rebuild the static draws on the next SceneBuffer_Build() */
+void SceneBuffer_InvalidateStatic(void);
+
+/* Consumer (CM7). NULL when nothing new was published since the last read. */
+const DrawList_t* SceneBuffer_AcquireRead(void);
+void SceneBuffer_ReleaseRead(const DrawList_t* list);
+
+/* Shared FLAG_* words (engine_config.h) */
+void SceneBuffer_SetFlag(uint32_t flag, uint32_t value);
+uint32_t SceneBuffer_GetFlag(uint32_t flag);
+
+void SceneBuffer_GetStats(SceneBufferStats_t* stats);
+uint32_t SceneBuffer_GetMemPools(MemPool_t* out, uint32_t max);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SCENEBUFFER_H */
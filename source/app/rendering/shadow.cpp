@@ -0,0 +1,206 @@
+/**
+ * @file shadow.cpp
+ * @brief Planar Projected Shadows Implementation
+ */
+
+#include "shadow.h"
+#include "platform.h"
+#include "mesh.h"
+#include "meshlod.h"
+#include "clip.h"
+#include "arena.h"
+#include "rasterizer.h"
+#include "impostor.h"
+#include "profile.h"
+#include <string.h>
+
+static int g_enabled = 1;
+static Vec4 g_plane = { 0.0f, 1.0f, 0.0f, 0.0f };     /* Unit normal, d */
+static uint16_t g_color = COLOR_BLACK;
+static ShadowStats_t g_shadow_stats;
+
+void Shadow_SetEnabled(int enabled)
+{
+    g_enabled = enabled ? 1 : 0;
+}
+
+int Shadow_IsEnabled(void)
+{
+    return g_enabled;
+}
+
+void Shadow_SetPlane(Vec3 normal, float d)
+{
+    float len = Vec3_Length(normal);
+    if (len <= 0.0f) return;
+    g_plane = MakeVec4(normal.x / len, normal.y / len, normal.z / len, d / len);
+}
+
+void Shadow_SetColor(uint16_t color)
+{
+    g_color = color;
+}
+
+/* ============================================================
+ * Shadow Matrix
+ * ============================================================ */
+
+/* The light as a homogeneous point: toward it for directional lights
+ * (w = 0), its position otherwise */
+static Vec4 LightPoint(const DrawList_t* list)
+{
+    for (uint32_t i = 0; i < list->light_count; i++) {
+        const SceneLight_t* l = &list->lights[i];
+        if (l->type == LIGHT_DIRECTIONAL) return MakeVec4(-l->direction.x, -l->direction.y, -l->direction.z, 0.0f);
+    }
+    for (uint32_t i = 0; i < list->light_count; i++) {
+        const SceneLight_t* l = &list->lights[i];
+        return MakeVec4(l->position.x, l->position.y, l->position.z, 1.0f);
+    }
+    return MakeVec4(0.0f, 1.0f, 0.0f, 0.0f);
+}
+
+/* S = dot(P, L) I - L P^T maps every point along the light onto plane
+ * P, here the receiving plane moved up by SHADOW_LIFT */
+int Shadow_GetMatrix(const DrawList_t* list, Mat4* shadow)
+{
+    if (!g_enabled) return 0;
+    Vec4 L = LightPoint(list);
+    float P[4] = { g_plane.x, g_plane.y, g_plane.z, g_plane.w - SHADOW_LIFT };
+    float l[4] = { L.x, L.y, L.z, L.w };
+    float dot = P[0] * l[0] + P[1] * l[1] + P[2] * l[2] + P[3] * l[3];
+
+    /* Directional: scaled by 1 / dot so w stays 1 */
+    float scale = 1.0f;
+    if (L.w == 0.0f) {
+        if (dot < SHADOW_MIN_ELEVATION) return 0;
+        scale = 1.0f / dot;
+    }
+    else if (dot <= 0.0f) {
+        return 0;
+    }
+
+    for (int col = 0; col < 4; col++) {
+        for (int row = 0; row < 4; row++) {
+            shadow->m[col * 4 + row] = ((row == col) ? dot : 0.0f) - l[row] * P[col];
+            shadow->m[col * 4 + row] *= scale;
+        }
+    }
+    return 1;
+}
+
+/* ============================================================
+ * Casters
+ * ============================================================ */
+
+/* Positions only: colors and UVs are left zero, as solid shadow
+ * triangles read neither */
+static ClipVertex_t* AllocFlattened(uint32_t count)
+{
+    ClipVertex_t* v = (ClipVertex_t*)Arena_Alloc(count * sizeof(ClipVertex_t), ARENA_DEFAULT_ALIGN);
+    if (v) memset(v, 0, count * sizeof(ClipVertex_t));
+    return v;
+}
+
+/* Coarse level of a static mesh, packed or not; returns triangles drawn */
+static uint32_t DrawStaticCaster(const MeshSlot_t* mesh, const Mat4* mvp, uint32_t lod)
+{
+    uint32_t index_count, vertex_count;
+    const uint16_t* indices = Mesh_GetLodIndices(mesh, lod, &index_count, &vertex_count);
+    if (!indices || index_count == 0) return 0;
+
+    uint64_t transform_start = Profile_Now();
+    ClipVertex_t* verts = AllocFlattened(vertex_count);
+    if (!verts) return 0;
+    const PackedVertex_t* packed = Mesh_GetPackedVertices(mesh);
+    if (packed) {
+        Mat4 dequant, packed_mvp;
+        Mesh_GetPackedDequant(&mesh->stat, &dequant);
+        Mat4_Multiply(&packed_mvp, mvp, &dequant);
+        Clip_TransformQuantized(&packed_mvp, &packed->x, sizeof(PackedVertex_t) / sizeof(int16_t),
+            vertex_count, verts);
+    }
+    else {
+        const float *x, *y, *z;
+        Mesh_GetPositions(mesh, &x, &y, &z);
+        if (!x) return 0;
+        Clip_TransformPositions(mvp, x, y, z, vertex_count, verts);
+    }
+    Rasterizer_AddStageTime(RASTER_STAGE_TRANSFORM, transform_start, Profile_Now());
+
+    Clip_DrawTrianglesSolidTo(Rasterizer_GetContext(), verts, vertex_count, indices, NULL,
+        index_count / 3, g_color);
+    return index_count / 3;
+}
+
+/* Coarse level of an MD2 model on the draw's pose. Levels index UV
+ * pairs; only their vertices matter here, so the indices are mapped
+ * back to the frame vertices. */
+static uint32_t DrawMD2Caster(const MeshSlot_t* mesh, const DrawCmd_t* cmd, const Mat4* mvp, uint32_t lod)
+{
+    uint32_t index_count, pair_count;
+    const uint16_t* indices = Mesh_GetLodIndices(mesh, lod, &index_count, &pair_count);
+    const MD2UV_t* uvs = Mesh_GetUVPairs(mesh);
+    if (!indices || !uvs || index_count == 0) return 0;
+
+    uint64_t transform_start = Profile_Now();
+    const MD2Pose_t* pose = Mesh_GetMD2Pose(cmd->mesh_id, cmd->anim_frame_a, cmd->anim_frame_b, cmd->anim_lerp);
+    if (!pose) return 0;
+    uint32_t count = pose->count;
+    ClipVertex_t* verts = AllocFlattened(count);
+    uint16_t* remapped = (uint16_t*)Arena_Alloc(index_count * sizeof(uint16_t), ARENA_DEFAULT_ALIGN);
+    if (!verts || !remapped) return 0;
+
+    pair_count = MIN(pair_count, (uint32_t)mesh->anim.uv_count);
+    for (uint32_t i = 0; i < index_count; i++) {
+        uint16_t vi = (indices[i] < pair_count) ? uvs[indices[i]].vertex : 0;
+        remapped[i] = (vi < count) ? vi : 0;
+    }
+    Clip_TransformPositions(mvp, pose->x, pose->y, pose->z, count, verts);
+    Rasterizer_AddStageTime(RASTER_STAGE_TRANSFORM, transform_start, Profile_Now());
+
+    Clip_DrawTrianglesSolidTo(Rasterizer_GetContext(), verts, count, remapped, NULL, index_count / 3, g_color);
+    return index_count / 3;
+}
+
+void Shadow_Draw(const DrawList_t* list, const RenderItem_t* items, uint32_t count)
+{
+    Mat4 shadow, shadow_vp;
+    uint32_t i = 0;
+    for (; i < count; i++) {
+        const DrawCmd_t* cmd = items[i].draw;
+        if ((cmd->flags & (DRAW_FLAG_CAST_SHADOW | DRAW_FLAG_TRANSPARENT)) == DRAW_FLAG_CAST_SHADOW) break;
+    }
+    if (i == count || !Shadow_GetMatrix(list, &shadow)) return;
+    Mat4_Multiply(&shadow_vp, &list->view_proj, &shadow);
+
+    uint32_t state = Rasterizer_GetState();
+    Rasterizer_SetState((state & RASTER_STATE_DEPTH_TEST) | RASTER_STATE_SHADOW);
+    g_shadow_stats.lists++;
+    for (; i < count; i++) {
+        const DrawCmd_t* cmd = items[i].draw;
+        if ((cmd->flags & (DRAW_FLAG_CAST_SHADOW | DRAW_FLAG_TRANSPARENT)) != DRAW_FLAG_CAST_SHADOW) continue;
+        if (items[i].impostor != IMPOSTOR_NONE) continue;
+        const MeshSlot_t* mesh = Mesh_Get(cmd->mesh_id);
+        if (!mesh) continue;
+
+        Mat4 mvp;
+        Mat4_Multiply(&mvp, &shadow_vp, &cmd->world);
+        uint32_t lod = cmd->lod + SHADOW_LOD_BIAS;
+        ArenaMark_t mark = Arena_Mark();
+        uint32_t drawn = 0;
+        if (mesh->type == 1) drawn = DrawStaticCaster(mesh, &mvp, lod);
+        else if (mesh->type == 2) drawn = DrawMD2Caster(mesh, cmd, &mvp, lod);
+        Arena_Release(mark);
+        if (drawn) {
+            g_shadow_stats.casters++;
+            g_shadow_stats.triangles += drawn;
+        }
+    }
+    Rasterizer_SetState(state);
+}
+
+void Shadow_GetStats(ShadowStats_t* stats)
+{
+    *stats = g_shadow_stats;
+}
@@ -0,0 +1,77 @@
+/**
+ * @file shadow.h
+ * @brief Planar Projected Shadows - NO MALLOC
+ *
+ * Draws flagged MeshRenderer_t cast_shadows (DRAW_FLAG_CAST_SHADOW)
+ * a second time, flattened onto one receiving plane: the shadow matrix
+ * projects every point along the list's light onto the plane, lifted
+ * SHADOW_LIFT above it so the shadow wins the depth test against the
+ * ground it lies on. The triangles go through RASTER_STATE_SHADOW
+ * (rasterizer.h): one solid color averaged into the opaque scene, depth
+ * tested, no depth write, and each screen pixel darkened once however
+ * many casters and folded-over triangles cover it. Nothing is lit or
+ * textured, and casters are drawn SHADOW_LOD_BIAS detail levels coarser
+ * than the draw itself (MD2 models on the pose the draw already decoded),
+ * so a character's shadow costs its transform at a coarse level plus a
+ * flat fill of its footprint.
+ *
+ * The light is the list's first directional light, else its first point
+ * or spot light (a shadow from its position, ignoring cone and range),
+ * else the default light straight down. A light under the plane, or
+ * within SHADOW_MIN_ELEVATION of grazing it, casts nothing. Shadows
+ * land on whatever is in front of the plane point they project to, and
+ * only casters in the list cast: one culled by the frustum, or drawn as
+ * an impostor, loses its shadow. MeshDraw_List() draws them between the
+ * opaque and the blended draws. On by default; only flagged draws cost
+ * anything.
+ */
+
+#ifndef SHADOW_H
+#define SHADOW_H
+
+#include <stdint.h>
+#include "math3d.h"
+#include "engine_config.h"
+#include "scenebuffer.h"
+#include "renderqueue.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SHADOW_LOD_BIAS         2       /* Caster levels past the draw's own, clamped to the coarsest */
+#define SHADOW_LIFT             0.02f   /* World units above the plane */
+#define SHADOW_MIN_ELEVATION    0.1f    /* Sine of the lowest directional light angle over the plane */
+
+typedef struct {
+    uint32_t lists;             /* Draw lists with shadows drawn */
+    uint32_t casters;
+    uint32_t triangles;         /* Caster triangles submitted */
+} ShadowStats_t;
+
+void Shadow_SetEnabled(int enabled);
+int Shadow_IsEnabled(void);
+
+/* Receiving plane, world space: points p with dot(normal, p) + d = 0,
+ * normal toward the side the casters stand on. Default y = 0. */
+void Shadow_SetPlane(Vec3 normal, float d);
+
+/* Averaged into the shaded scene; the default COLOR_BLACK halves it */
+void Shadow_SetColor(uint16_t color);
+
+/* World space to flattened world space for list's light; 0 when off or
+ * nothing is cast (e.g. for the redraw bounds of DRAW_FLAG_CAST_SHADOW
+ * draws) */
+int Shadow_GetMatrix(const DrawList_t* list, Mat4* shadow);
+
+/* Shadows of the opaque casters among a queue's items, into the screen
+ * context; the lights must already be set */
+void Shadow_Draw(const DrawList_t* list, const RenderItem_t* items, uint32_t count);
+
+void Shadow_GetStats(ShadowStats_t* stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SHADOW_H */
@@ -0,0 +1,293 @@
+/**
+ * @file spatial.cpp
+ * @brief Dynamic AABB Tree Implementation
+ */
+
+#include "spatial.h"
+#include <string.h>
+
+#define NULL_NODE       0xFFFF
+
+/* Slot states */
+#define SLOT_NONE       0
+#define SLOT_TREE       1
+#define SLOT_UNBOUNDED  2
+
+typedef struct {
+    Vec3 min, max;
+    uint16_t parent;
+    uint16_t child[2];      /* NULL_NODE for leaves */
+    uint16_t slot;          /* Entity slot of a leaf */
+} SpatialNode_t;
+
+static SpatialNode_t g_nodes[SPATIAL_MAX_NODES];
+static uint16_t g_free_list;
+static uint16_t g_root;
+
+/* Per entity slot */
+static uint8_t g_slot_state[MAX_ENTITIES];
+static uint16_t g_slot_leaf[MAX_ENTITIES];
+static uint32_t g_slot_id[MAX_ENTITIES];
+static Vec3 g_slot_center[MAX_ENTITIES];
+static float g_slot_radius[MAX_ENTITIES];
+static uint32_t g_count;
+static uint32_t g_unbounded_count;
+
+/* ============================================================
+ * Node Pool
+ * ============================================================ */
+
+static uint16_t AllocNode(void)
+{
+    uint16_t n = g_free_list;
+    if (n == NULL_NODE) return NULL_NODE;
+    g_free_list = g_nodes[n].parent;
+    g_nodes[n].parent = NULL_NODE;
+    g_nodes[n].child[0] = g_nodes[n].child[1] = NULL_NODE;
+    return n;
+}
+
+static void FreeNode(uint16_t n)
+{
+    g_nodes[n].parent = g_free_list;
+    g_free_list = n;
+}
+
+/* ============================================================
+ * Box Helpers
+ * ============================================================ */
+
+static inline float BoxArea(Vec3 mn, Vec3 mx)
+{
+    float dx = mx.x - mn.x, dy = mx.y - mn.y, dz = mx.z - mn.z;
+    return dx * dy + dy * dz + dz * dx;
+}
+
+static inline int BoxContainsSphere(const SpatialNode_t* n, Vec3 c, float r)
+{
+    return c.x - r >= n->min.x && c.y - r >= n->min.y && c.z - r >= n->min.z &&
+        c.x + r <= n->max.x && c.y + r <= n->max.y && c.z + r <= n->max.z;
+}
+
+static void FitToChildren(uint16_t n)
+{
+    SpatialNode_t* node = &g_nodes[n];
+    node->min = Vec3_Min(g_nodes[node->child[0]].min, g_nodes[node->child[1]].min);
+    node->max = Vec3_Max(g_nodes[node->child[0]].max, g_nodes[node->child[1]].max);
+}
+
+static void RefitUpward(uint16_t n)
+{
+    while (n != NULL_NODE) {
+        FitToChildren(n);
+        n = g_nodes[n].parent;
+    }
+}
+
+/* ============================================================
+ * Tree Maintenance
+ * ============================================================ */
+
+static void InsertLeaf(uint16_t leaf)
+{
+    if (g_root == NULL_NODE) {
+        g_root = leaf;
+        g_nodes[leaf].parent = NULL_NODE;
+        return;
+    }
+
+    /* Descend toward the child whose box grows the least */
+    Vec3 lmin = g_nodes[leaf].min, lmax = g_nodes[leaf].max;
+    uint16_t sibling = g_root;
+    while (g_nodes[sibling].child[0] != NULL_NODE) {
+        SpatialNode_t* s = &g_nodes[sibling];
+        float area = BoxArea(s->min, s->max);
+        float combined = BoxArea(Vec3_Min(s->min, lmin), Vec3_Max(s->max, lmax));
+
+        /* Cost of making a new parent here vs. pushing the leaf further down */
+        float cost_here = 2.0f * combined;
+        float inherit = 2.0f * (combined - area);
+
+        float cost_child[2];
+        for (int i = 0; i < 2; i++) {
+            SpatialNode_t* c = &g_nodes[s->child[i]];
+            float grown = BoxArea(Vec3_Min(c->min, lmin), Vec3_Max(c->max, lmax));
+            if (c->child[0] == NULL_NODE) cost_child[i] = grown + inherit;
+            else cost_child[i] = (grown - BoxArea(c->min, c->max)) + inherit;
+        }
+
+        if (cost_here < cost_child[0] && cost_here < cost_child[1]) break;
+        sibling = (cost_child[0] <= cost_child[1]) ? s->child[0] : s->child[1];
+    }
+
+    /* Replace sibling with a new parent of (sibling, leaf) */
+    uint16_t old_parent = g_nodes[sibling].parent;
+    uint16_t parent = AllocNode();
+    g_nodes[parent].parent = old_parent;
+    g_nodes[parent].child[0] = sibling;
+    g_nodes[parent].child[1] = leaf;
+    g_nodes[sibling].parent = parent;
+    g_nodes[leaf].parent = parent;
+
+    if (old_parent == NULL_NODE) g_root = parent;
+    else if (g_nodes[old_parent].child[0] == sibling) g_nodes[old_parent].child[0] = parent;
+    else g_nodes[old_parent].child[1] = parent;
+
+    RefitUpward(parent);
+}
+
+static void RemoveLeaf(uint16_t leaf)
+{
+    if (leaf == g_root) {
+        g_root = NULL_NODE;
+        return;
+    }
+
+    /* Collapse the parent: the sibling takes its place */
+    uint16_t parent = g_nodes[leaf].parent;
+    uint16_t grand = g_nodes[parent].parent;
+    uint16_t sibling = (g_nodes[parent].child[0] == leaf) ? g_nodes[parent].child[1] : g_nodes[parent].child[0];
+
+    g_nodes[sibling].parent = grand;
+    if (grand == NULL_NODE) g_root = sibling;
+    else {
+        if (g_nodes[grand].child[0] == parent) g_nodes[grand].child[0] = sibling;
+        else g_nodes[grand].child[1] = sibling;
+        RefitUpward(grand);
+    }
+    FreeNode(parent);
+}
+
+/* ============================================================
+ * Public API
+ * ============================================================ */
+
+void Spatial_Init(void)
+{
+    for (uint32_t i = 0; i < SPATIAL_MAX_NODES; i++) {
+        g_nodes[i].parent = (uint16_t)((i + 1 < SPATIAL_MAX_NODES) ? i + 1 : NULL_NODE);
+    }
+    g_free_list = 0;
+    g_root = NULL_NODE;
+    memset(g_slot_state, 0, sizeof(g_slot_state));
+    g_count = 0;
+    g_unbounded_count = 0;
+}
+
+void Spatial_Remove(uint32_t slot)
+{
+    if (slot >= MAX_ENTITIES || g_slot_state[slot] == SLOT_NONE) return;
+
+    if (g_slot_state[slot] == SLOT_TREE) {
+        uint16_t leaf = g_slot_leaf[slot];
+        RemoveLeaf(leaf);
+        FreeNode(leaf);
+    }
+    else {
+        g_unbounded_count--;
+    }
+    g_slot_state[slot] = SLOT_NONE;
+    g_count--;
+}
+
+void Spatial_Update(uint32_t slot, uint32_t id, Vec3 center, float radius)
+{
+    if (slot >= MAX_ENTITIES) return;
+
+    g_slot_id[slot] = id;
+    g_slot_center[slot] = center;
+    g_slot_radius[slot] = radius;
+
+    if (radius < 0.0f) {
+        Spatial_Remove(slot);
+        g_slot_state[slot] = SLOT_UNBOUNDED;
+        g_unbounded_count++;
+        g_count++;
+        return;
+    }
+
+    if (g_slot_state[slot] == SLOT_TREE) {
+        /* Still inside the fat box: the tree is unchanged */
+        uint16_t leaf = g_slot_leaf[slot];
+        if (BoxContainsSphere(&g_nodes[leaf], center, radius)) return;
+        RemoveLeaf(leaf);
+    }
+    else {
+        Spatial_Remove(slot);
+        uint16_t leaf = AllocNode();
+        if (leaf == NULL_NODE) return;
+        g_nodes[leaf].slot = (uint16_t)slot;
+        g_slot_leaf[slot] = leaf;
+        g_slot_state[slot] = SLOT_TREE;
+        g_count++;
+    }
+
+    uint16_t leaf = g_slot_leaf[slot];
+    float fat = radius * (1.0f + SPATIAL_MARGIN);
+    Vec3 ext = Vec3_Create(fat, fat, fat);
+    g_nodes[leaf].min = Vec3_Sub(center, ext);
+    g_nodes[leaf].max = Vec3_Add(center, ext);
+    g_nodes[leaf].child[0] = g_nodes[leaf].child[1] = NULL_NODE;
+    InsertLeaf(leaf);
+}
+
+uint32_t Spatial_QueryFrustum(const ClipFrustum_t* f, uint32_t* out_ids, uint32_t max)
+{
+    uint32_t count = 0;
+
+    /* Unbounded entities are always potentially visible */
+    for (uint32_t i = 0; g_unbounded_count > 0 && i < MAX_ENTITIES && count < max; i++) {
+        if (g_slot_state[i] == SLOT_UNBOUNDED) out_ids[count++] = g_slot_id[i];
+    }
+
+    if (g_root == NULL_NODE) return count;
+
+    /* Each stack entry carries the planes its box still straddles */
+    uint16_t stack[SPATIAL_MAX_NODES];
+    uint8_t masks[SPATIAL_MAX_NODES];
+    int sp = 0;
+    stack[sp] = g_root;
+    masks[sp++] = 0x3F;
+
+    while (sp > 0 && count < max) {
+        sp--;
+        const SpatialNode_t* n = &g_nodes[stack[sp]];
+        uint8_t mask = masks[sp];
+
+        Vec3 c = Vec3_Scale(Vec3_Add(n->min, n->max), 0.5f);
+        Vec3 e = Vec3_Scale(Vec3_Sub(n->max, n->min), 0.5f);
+        int outside = 0;
+        for (int p = 0; p < 6; p++) {
+            if (!(mask & (1 << p))) continue;
+            const Vec4* pl = &f->planes[p];
+            float s = pl->x * c.x + pl->y * c.y + pl->z * c.z + pl->w;
+            float r = e.x * fabsf(pl->x) + e.y * fabsf(pl->y) + e.z * fabsf(pl->z);
+            if (s < -r) { outside = 1; break; }
+            if (s >= r) mask &= (uint8_t)~(1 << p);
+        }
+        if (outside) continue;
+
+        if (n->child[0] == NULL_NODE) {
+            /* Leaf: exact sphere against the planes still in doubt */
+            uint32_t slot = n->slot;
+            Vec3 sc = g_slot_center[slot];
+            float sr = g_slot_radius[slot];
+            for (int p = 0; p < 6; p++) {
+                if (!(mask & (1 << p))) continue;
+                const Vec4* pl = &f->planes[p];
+                if (pl->x * sc.x + pl->y * sc.y + pl->z * sc.z + pl->w < -sr) { outside = 1; break; }
+            }
+            if (!outside) out_ids[count++] = g_slot_id[slot];
+            continue;
+        }
+
+        stack[sp] = n->child[0]; masks[sp++] = mask;
+        stack[sp] = n->child[1]; masks[sp++] = mask;
+    }
+    return count;
+}
+
+uint32_t Spatial_GetCount(void)
+{
+    return g_count;
+}
@@ -0,0 +1,49 @@
+/**
+ * @file spatial.h
+ * @brief Dynamic AABB Tree Over Entity Bounds - NO MALLOC
+ *
+ * One leaf per active mesh renderer, keyed by entity slot. Leaves hold
+ * a slightly enlarged ("fat") box around the world-space bounding
+ * sphere, so small movements only update the sphere; a leaf is
+ * re-inserted once the sphere leaves its fat box. Inserts pick the
+ * sibling with the least surface-area growth, and ancestors are refit
+ * on the way up.
+ *
+ * Entity_UpdateTransforms() keeps the tree in sync for dirty transforms;
+ * renderers query it with the camera frustum instead of walking every
+ * entity.
+ */
+
+#ifndef SPATIAL_H
+#define SPATIAL_H
+
+#include <stdint.h>
+#include "math3d.h"
+#include "engine_config.h"
+#include "clip.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SPATIAL_MAX_NODES       (2 * MAX_ENTITIES)
+#define SPATIAL_MARGIN          0.1f    /* Fat-box padding, in units of the sphere radius */
+
+void Spatial_Init(void);
+
+/* Insert or move the leaf of an entity slot. radius < 0 means unbounded:
+ * the entity is kept outside the tree and returned by every query. */
+void Spatial_Update(uint32_t slot, uint32_t id, Vec3 center, float radius);
+void Spatial_Remove(uint32_t slot);
+
+/* Entity IDs whose sphere intersects the frustum; returns the count */
+uint32_t Spatial_QueryFrustum(const ClipFrustum_t* f, uint32_t* out_ids, uint32_t max);
+
+/* Entities currently tracked (bounded and unbounded) */
+uint32_t Spatial_GetCount(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SPATIAL_H */
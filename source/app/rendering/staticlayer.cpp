@@ -0,0 +1,124 @@
+/**
+ * @file staticlayer.cpp
+ * @brief Static Layer Cache Implementation
+ */
+
+#include "staticlayer.h"
+#include "rasterizer.h"
+#include <string.h>
+
+PLACE_STATIC_LAYER static uint16_t g_layer_color[DISPLAY_WIDTH * DISPLAY_HEIGHT];
+PLACE_STATIC_LAYER static uint16_t g_layer_depth[DISPLAY_WIDTH * DISPLAY_HEIGHT];
+
+static int g_enabled = 0;
+static int g_valid = 0;             /* The layer holds the frame of g_key */
+static uint64_t g_key = 0;
+static StaticLayerStats_t g_stats;
+
+void StaticLayer_SetEnabled(int enabled)
+{
+    g_enabled = enabled ? 1 : 0;
+    g_valid = 0;
+}
+
+int StaticLayer_IsEnabled(void)
+{
+    return g_enabled;
+}
+
+void StaticLayer_Invalidate(void)
+{
+    g_valid = 0;
+}
+
+/* FNV-1a, 64-bit, continued from h */
+static uint64_t Hash(uint64_t h, const void* data, uint32_t size)
+{
+    const uint8_t* p = (const uint8_t*)data;
+    for (uint32_t i = 0; i < size; i++) h = (h ^ p[i]) * 0x100000001B3ull;
+    return h;
+}
+
+/* Everything the layer's pixels depend on, field by field so struct
+ * padding stays out; counts the static draws */
+static uint64_t LayerKey(const DrawList_t* list, uint16_t clear_color, MeshDrawMaterial_t material,
+    void* user, uint32_t* statics)
+{
+    uint64_t h = 0xCBF29CE484222325ull;
+    int res[2];
+    uint32_t state = Rasterizer_GetState();
+    Rasterizer_GetResolution(&res[0], &res[1]);
+    h = Hash(h, &list->view_proj, sizeof(list->view_proj));
+    h = Hash(h, &clear_color, sizeof(clear_color));
+    h = Hash(h, res, sizeof(res));
+    h = Hash(h, &state, sizeof(state));
+    h = Hash(h, &list->light_count, sizeof(list->light_count));
+    for (uint32_t i = 0; i < list->light_count; i++) {
+        const SceneLight_t* l = &list->lights[i];
+        h = Hash(h, &l->type, sizeof(l->type));
+        h = Hash(h, &l->position, sizeof(l->position));
+        h = Hash(h, &l->direction, sizeof(l->direction));
+        h = Hash(h, &l->color, sizeof(l->color));
+        h = Hash(h, &l->range, sizeof(l->range));
+        h = Hash(h, &l->cos_cone, sizeof(l->cos_cone));
+    }
+
+    *statics = 0;
+    for (uint32_t i = 0; i < list->count; i++) {
+        const DrawCmd_t* cmd = &list->cmds[i];
+        if (!(cmd->flags & DRAW_FLAG_STATIC)) continue;
+        uint16_t color = 0xFFFF;
+        uint32_t texture = 0xFFFFFFFF;
+        if (material) material(cmd, &color, &texture, user);
+        h = Hash(h, &cmd->entity, sizeof(cmd->entity));
+        h = Hash(h, &cmd->mesh_id, sizeof(cmd->mesh_id));
+        h = Hash(h, &cmd->material_id, sizeof(cmd->material_id));
+        h = Hash(h, &color, sizeof(color));
+        h = Hash(h, &texture, sizeof(texture));
+        h = Hash(h, &cmd->world, sizeof(cmd->world));
+        h = Hash(h, &cmd->lod, sizeof(cmd->lod));
+        h = Hash(h, &cmd->cluster_mask, sizeof(cmd->cluster_mask));
+        (*statics)++;
+    }
+    return h;
+}
+
+int StaticLayer_Draw(const DrawList_t* list, uint16_t clear_color, MeshDrawMaterial_t material, void* user)
+{
+    if (!g_enabled) return 0;
+    Rasterizer_AddCulledEntities(list->culled);
+
+    uint32_t statics;
+    uint64_t key = LayerKey(list, clear_color, material, user, &statics);
+    g_stats.frames++;
+    g_stats.static_draws = statics;
+
+    if (g_valid && key == g_key && Rasterizer_ClearToLayer(g_layer_color, g_layer_depth)) {
+        MeshDraw_ListFiltered(list, material, user, DRAW_FLAG_STATIC, 0);
+        return 1;
+    }
+
+    /* Rebuild: the static draws alone, stored, then the rest on top */
+    Rasterizer_Clear(clear_color);
+    g_valid = 0;
+    if (statics) {
+        g_stats.rebuilds++;
+        MeshDraw_ListFiltered(list, material, user, DRAW_FLAG_STATIC, DRAW_FLAG_STATIC);
+        g_valid = Rasterizer_StoreLayer(g_layer_color, g_layer_depth);
+        g_key = key;
+    }
+    MeshDraw_ListFiltered(list, material, user, DRAW_FLAG_STATIC, 0);
+    return 1;
+}
+
+void StaticLayer_GetStats(StaticLayerStats_t* stats)
+{
+    *stats = g_stats;
+}
+
+uint32_t StaticLayer_GetMemPools(MemPool_t* out, uint32_t max)
+{
+    uint32_t used = g_enabled ? sizeof(g_layer_color) : 0;
+    uint32_t n = MemMap_Add(out, 0, max, "static color", g_layer_color, sizeof(g_layer_color), used);
+    return MemMap_Add(out, n, max, "static depth", g_layer_depth, sizeof(g_layer_depth), used);
+}
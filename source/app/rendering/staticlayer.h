@@ -0,0 +1,57 @@
+/**
+ * @file staticlayer.h
+ * @brief Cached Color And Depth Of The Static Draws - NO MALLOC
+ *
+ * Draws flagged DRAW_FLAG_STATIC (MeshRenderer_t is_static: opaque, not
+ * animated) are rasterized once into a display-sized color and depth
+ * layer. Following frames start from a copy of it (DMA2D on the board,
+ * or per tile when binning) instead of a clear plus the static draws,
+ * and only the others are rasterized. The layer is keyed on everything
+ * that shapes it: camera, lights, clear color, render resolution and
+ * state, and each static draw's entity, mesh, material, look, world
+ * matrix, detail level and clusters; any change, a static draw coming
+ * or going included, rebuilds it on that frame. Changes outside the
+ * list, such as a texture's pixels, need StaticLayer_Invalidate().
+ */
+
+#ifndef STATICLAYER_H
+#define STATICLAYER_H
+
+#include <stdint.h>
+#include "engine_config.h"
+#include "scenebuffer.h"
+#include "meshdraw.h"
+#include "memmap.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+    uint32_t frames;            /* Drawn through the layer */
+    uint32_t rebuilds;          /* Of those, with the static draws rasterized */
+    uint32_t static_draws;      /* In the layer of the last frame */
+} StaticLayerStats_t;
+
+/* Disabled by default; enabling starts with a rebuild */
+void StaticLayer_SetEnabled(int enabled);
+int StaticLayer_IsEnabled(void);
+
+/* Rebuild on the next frame */
+void StaticLayer_Invalidate(void);
+
+/* In place of Rasterizer_Clear(clear_color) and MeshDraw_List(): clears
+ * or restores, and draws what the layer does not hold. Returns 0 with
+ * nothing done while disabled. Without a 16-bit screen depth buffer or
+ * while interlaced the layer is never stored, and every frame draws in
+ * full. Keep the scissor off. */
+int StaticLayer_Draw(const DrawList_t* list, uint16_t clear_color, MeshDrawMaterial_t material, void* user);
+
+void StaticLayer_GetStats(StaticLayerStats_t* stats);
+uint32_t StaticLayer_GetMemPools(MemPool_t* out, uint32_t max);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* STATICLAYER_H */
@@ -0,0 +1,496 @@
+/**
+ * @file stream.cpp
+ * @brief Asynchronous Asset Streaming Implementation
+ */
+
+#include "stream.h"
+#include "mesh.h"
+#include "texture.h"
+#include "profile.h"
+#include "dcache.h"
+#include <string.h>
+
+#ifdef SDL_PC
+#include "jobs.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#else
+#include "stm32h7xx.h"
+#endif
+
+#define NO_BUFFER       0xFF
+
+typedef struct {
+    char path[STREAM_PATH_LENGTH];
+    uint32_t kind;
+    uint32_t placeholder;
+    uint32_t id;                /* Loaded asset once STREAM_READY */
+    StreamDone_t done;
+    void* user;
+    uint32_t seq;               /* Request order; reads and decodes go oldest first */
+    uint32_t size;              /* Bytes staged */
+    uint8_t state;              /* 0 = free slot */
+    uint8_t buffer;             /* Staging buffer while reading or staged */
+} StreamRequest_t;
+
+PLACE_STREAM_STAGING CACHE_ALIGNED static uint8_t g_staging[STREAM_STAGING_BUFFERS][STREAM_STAGING_BYTES];
+
+static StreamRequest_t g_requests[STREAM_MAX_REQUESTS];
+static StreamRequest_t* g_buffer_owner[STREAM_STAGING_BUFFERS];
+static uint32_t g_seq;
+static StreamStats_t g_stream_stats;
+
+static inline int IsOpen(uint8_t state)
+{
+    return (state >= STREAM_QUEUED && state <= STREAM_STAGED) || state == STREAM_DECODED;
+}
+
+/* ============================================================
+ * Storage Backend (SDL_PC)
+ * ============================================================ */
+
+#ifdef SDL_PC
+
+/* One read per staging buffer, handed to the I/O thread */
+typedef struct {
+    const char* path;
+    void* dst;
+    uint32_t max;
+    bool pending;
+    std::atomic<int32_t> result;
+} IoRead_t;
+
+static IoRead_t g_io[STREAM_STAGING_BUFFERS];
+static std::thread* g_io_thread = NULL;
+static std::mutex g_io_mutex;
+static std::condition_variable g_io_wake;
+static bool g_io_quit = false;
+
+static int32_t ReadWhole(const char* path, void* dst, uint32_t max)
+{
+    FILE* f = fopen(path, "rb");
+    if (!f) return STREAM_READ_FAILED;
+
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+
+    int32_t result = STREAM_READ_FAILED;
+    if (size > 0 && (unsigned long)size <= max && fread(dst, 1, (size_t)size, f) == (size_t)size) {
+        result = (int32_t)size;
+    }
+    fclose(f);
+    return result;
+}
+
+static void IoThread(void)
+{
+    std::unique_lock<std::mutex> lk(g_io_mutex);
+    for (;;) {
+        IoRead_t* io = NULL;
+        for (uint32_t b = 0; b < STREAM_STAGING_BUFFERS && !io; b++) {
+            if (g_io[b].pending) io = &g_io[b];
+        }
+        if (!io) {
+            if (g_io_quit) break;
+            g_io_wake.wait(lk);
+            continue;
+        }
+
+        io->pending = false;
+        const char* path = io->path;
+        void* dst = io->dst;
+        uint32_t max = io->max;
+        lk.unlock();
+        io->result.store(ReadWhole(path, dst, max), std::memory_order_release);
+        lk.lock();
+    }
+}
+
+void Stream_PlatformInit(void)
+{
+    g_io_quit = false;
+    for (uint32_t b = 0; b < STREAM_STAGING_BUFFERS; b++) {
+        g_io[b].pending = false;
+        g_io[b].result.store(STREAM_READ_FAILED);
+    }
+    g_io_thread = new std::thread(IoThread);
+}
+
+void Stream_PlatformShutdown(void)
+{
+    if (!g_io_thread) return;
+    {
+        std::lock_guard<std::mutex> lk(g_io_mutex);
+        g_io_quit = true;
+        for (uint32_t b = 0; b < STREAM_STAGING_BUFFERS; b++) g_io[b].pending = false;
+    }
+    g_io_wake.notify_all();
+    g_io_thread->join();
+    delete g_io_thread;
+    g_io_thread = NULL;
+}
+
+void Stream_PlatformBeginRead(uint32_t buffer, const char* path, void* dst, uint32_t max)
+{
+    IoRead_t* io = &g_io[buffer];
+    {
+        std::lock_guard<std::mutex> lk(g_io_mutex);
+        io->path = path;
+        io->dst = dst;
+        io->max = max;
+        io->result.store(STREAM_READ_BUSY, std::memory_order_relaxed);
+        io->pending = true;
+    }
+    g_io_wake.notify_one();
+}
+
+int32_t Stream_PlatformPollRead(uint32_t buffer)
+{
+    return g_io[buffer].result.load(std::memory_order_acquire);
+}
+
+#endif
+
+/* ============================================================
+ * Queue
+ * ============================================================ */
+
+static StreamRequest_t* Oldest(uint8_t state)
+{
+    StreamRequest_t* best = NULL;
+    for (uint32_t i = 0; i < STREAM_MAX_REQUESTS; i++) {
+        StreamRequest_t* r = &g_requests[i];
+        if (r->state == state && (!best || r->seq < best->seq)) best = r;
+    }
+    return best;
+}
+
+static void ReleaseBuffer(StreamRequest_t* r)
+{
+    if (r->buffer != NO_BUFFER) g_buffer_owner[r->buffer] = NULL;
+    r->buffer = NO_BUFFER;
+}
+
+static void Finish(StreamRequest_t* r, uint32_t id)
+{
+    ReleaseBuffer(r);
+    r->id = id;
+    r->state = (id != STREAM_INVALID) ? STREAM_READY : STREAM_FAILED;
+    if (id != STREAM_INVALID) g_stream_stats.completed++;
+    else g_stream_stats.failed++;
+    if (r->done) r->done((uint32_t)(r - g_requests), id, r->user);
+}
+
+/* Oldest queued requests into the free staging buffers */
+static void StartReads(void)
+{
+    for (uint32_t b = 0; b < STREAM_STAGING_BUFFERS; b++) {
+        if (g_buffer_owner[b]) continue;
+        StreamRequest_t* r = Oldest(STREAM_QUEUED);
+        if (!r) return;
+
+        g_buffer_owner[b] = r;
+        r->buffer = (uint8_t)b;
+        r->state = STREAM_READING;
+        Stream_PlatformBeginRead(b, r->path, g_staging[b], STREAM_STAGING_BYTES);
+    }
+}
+
+static void PollReads(void)
+{
+    for (uint32_t b = 0; b < STREAM_STAGING_BUFFERS; b++) {
+        StreamRequest_t* r = g_buffer_owner[b];
+        if (!r || r->state != STREAM_READING) continue;
+
+        int32_t result = Stream_PlatformPollRead(b);
+        if (result == STREAM_READ_BUSY) continue;
+        if (result < 0) {
+            Finish(r, STREAM_INVALID);
+            continue;
+        }
+        /* DMA wrote behind the D-cache */
+        DCache_Invalidate(g_staging[b], (uint32_t)result);
+        r->size = (uint32_t)result;
+        r->state = STREAM_STAGED;
+        g_stream_stats.bytes_read += r->size;
+    }
+}
+
+static uint32_t Decode(const StreamRequest_t* r, const void* data)
+{
+    switch (r->kind) {
+    case STREAM_MESH_OBJ:    return Mesh_LoadOBJ(data, r->size);
+    case STREAM_MESH_MD2:    return Mesh_LoadMD2(data, r->size);
+    case STREAM_TEXTURE_BMP: return Texture_LoadBMP(data, r->size);
+    }
+    return STREAM_INVALID;
+}
+
+/* ============================================================
+ * Parallel Decode (SDL_PC)
+ * ============================================================ */
+
+#ifdef SDL_PC
+
+/* Decoded asset of one request; block holds all its arrays */
+typedef struct {
+    MeshStaging_t mesh;
+    TextureStaging_t texture;
+    void* block;
+    uint32_t bytes_read;        /* Read by the job, past the staging buffers */
+    int ok;
+} StreamDecoded_t;
+
+static StreamDecoded_t g_decoded[STREAM_MAX_REQUESTS];
+
+#define STAGE_BYTES(count, type)    (((size_t)(count) * sizeof(type) + 7) & ~(size_t)7)
+
+static void* Carve(uint8_t** p, size_t bytes)
+{
+    void* at = *p;
+    *p += bytes;
+    return at;
+}
+
+static void* ReadAlloc(const char* path, uint32_t* out_size)
+{
+    FILE* f = fopen(path, "rb");
+    if (!f) return NULL;
+
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+
+    void* data = NULL;
+    if (size > 0 && (data = malloc((size_t)size)) != NULL && fread(data, 1, (size_t)size, f) != (size_t)size) {
+        free(data);
+        data = NULL;
+    }
+    fclose(f);
+    *out_size = data ? (uint32_t)size : 0;
+    return data;
+}
+
+/* Sizing pass, one allocation, then the decode proper */
+static int DecodeStaged(uint32_t kind, const void* data, uint32_t size, StreamDecoded_t* d)
+{
+    if (kind == STREAM_TEXTURE_BMP) {
+        TextureStaging_t* t = &d->texture;
+        if (!Texture_DecodeBMP(data, size, t)) return 0;
+        d->block = malloc(t->words * sizeof(uint16_t));
+        if (!d->block) return 0;
+        t->data = (uint16_t*)d->block;
+        return Texture_DecodeBMP(data, size, t);
+    }
+
+    int (*decode)(const void*, uint32_t, MeshStaging_t*) =
+        (kind == STREAM_MESH_OBJ) ? Mesh_DecodeOBJ : (kind == STREAM_MESH_MD2) ? Mesh_DecodeMD2 : NULL;
+    MeshStaging_t* m = &d->mesh;
+    if (!decode || !decode(data, size, m)) return 0;
+
+    size_t bytes = STAGE_BYTES(m->vertex_count, Vertex_t) + STAGE_BYTES(m->frame_count, MD2FrameDesc_t) +
+        STAGE_BYTES(m->uv_count, MD2UV_t) + STAGE_BYTES(m->md2_vertex_count, MD2Vertex_t) +
+        STAGE_BYTES(m->index_count, uint16_t);
+    /* Zeroed, so struct padding in the pools (and cooked images) matches a direct load */
+    d->block = calloc(1, bytes ? bytes : 1);
+    if (!d->block) return 0;
+
+    uint8_t* p = (uint8_t*)d->block;
+    m->vertices = (Vertex_t*)Carve(&p, STAGE_BYTES(m->vertex_count, Vertex_t));
+    m->frames = (MD2FrameDesc_t*)Carve(&p, STAGE_BYTES(m->frame_count, MD2FrameDesc_t));
+    m->uvs = (MD2UV_t*)Carve(&p, STAGE_BYTES(m->uv_count, MD2UV_t));
+    m->md2_vertices = (MD2Vertex_t*)Carve(&p, STAGE_BYTES(m->md2_vertex_count, MD2Vertex_t));
+    m->indices = (uint16_t*)Carve(&p, STAGE_BYTES(m->index_count, uint16_t));
+    return decode(data, size, m);
+}
+
+/* Job: touches only its own request's staging and g_decoded entry */
+static void DecodeJob(uint32_t index, uint32_t thread, void* user)
+{
+    (void)thread;
+    StreamRequest_t* r = ((StreamRequest_t**)user)[index];
+    StreamDecoded_t* d = &g_decoded[r - g_requests];
+    memset(d, 0, sizeof(*d));
+
+    const void* data = NULL;
+    void* file = NULL;
+    uint32_t size = r->size;
+    if (r->state == STREAM_STAGED) {
+        data = g_staging[r->buffer];
+    }
+    else {
+        data = file = ReadAlloc(r->path, &size);
+        d->bytes_read = size;
+    }
+
+    d->ok = data && DecodeStaged(r->kind, data, size, d);
+    free(file);
+    if (!d->ok) {
+        free(d->block);
+        d->block = NULL;
+    }
+}
+
+static uint32_t CommitDecoded(StreamRequest_t* r)
+{
+    StreamDecoded_t* d = &g_decoded[r - g_requests];
+    uint32_t id = (r->kind == STREAM_TEXTURE_BMP) ? Texture_CommitStaged(&d->texture) : Mesh_CommitStaged(&d->mesh);
+    free(d->block);
+    d->block = NULL;
+    return id;
+}
+
+uint32_t Stream_DecodeQueued(void)
+{
+    PROFILE_ZONE("Stream_DecodeQueued");
+
+    /* Reads in flight land in their staging buffers first */
+    for (;;) {
+        PollReads();
+        if (!Oldest(STREAM_READING)) break;
+        std::this_thread::yield();
+    }
+
+    StreamRequest_t* batch[STREAM_MAX_REQUESTS];
+    uint32_t count = 0;
+    for (uint32_t i = 0; i < STREAM_MAX_REQUESTS; i++) {
+        uint8_t state = g_requests[i].state;
+        if (state == STREAM_STAGED || state == STREAM_QUEUED) batch[count++] = &g_requests[i];
+    }
+    if (count == 0) return 0;
+
+    Jobs_ParallelFor(count, DecodeJob, batch);
+
+    for (uint32_t k = 0; k < count; k++) {
+        StreamRequest_t* r = batch[k];
+        const StreamDecoded_t* d = &g_decoded[r - g_requests];
+        g_stream_stats.bytes_read += d->bytes_read;
+        if (d->ok) {
+            ReleaseBuffer(r);
+            r->state = STREAM_DECODED;
+        }
+        else {
+            Finish(r, STREAM_INVALID);
+        }
+    }
+    return count;
+}
+
+#endif
+
+void Stream_Init(void)
+{
+    memset(g_requests, 0, sizeof(g_requests));
+    memset(g_buffer_owner, 0, sizeof(g_buffer_owner));
+    memset(&g_stream_stats, 0, sizeof(g_stream_stats));
+    g_seq = 0;
+    Stream_PlatformInit();
+}
+
+void Stream_Shutdown(void)
+{
+    Stream_PlatformShutdown();
+#ifdef SDL_PC
+    for (uint32_t i = 0; i < STREAM_MAX_REQUESTS; i++) {
+        free(g_decoded[i].block);
+        g_decoded[i].block = NULL;
+    }
+#endif
+}
+
+uint32_t Stream_Request(const char* path, uint32_t kind, uint32_t placeholder,
+    StreamDone_t done, void* user)
+{
+    if (!path || strlen(path) >= STREAM_PATH_LENGTH) return STREAM_INVALID;
+
+    for (uint32_t i = 0; i < STREAM_MAX_REQUESTS; i++) {
+        StreamRequest_t* r = &g_requests[i];
+        if (r->state != 0) continue;
+
+        strcpy(r->path, path);
+        r->kind = kind;
+        r->placeholder = placeholder;
+        r->id = STREAM_INVALID;
+        r->done = done;
+        r->user = user;
+        r->seq = g_seq++;
+        r->size = 0;
+        r->buffer = NO_BUFFER;
+        r->state = STREAM_QUEUED;
+        g_stream_stats.requested++;
+
+        uint32_t pending = 0;
+        for (uint32_t k = 0; k < STREAM_MAX_REQUESTS; k++) {
+            if (IsOpen(g_requests[k].state)) pending++;
+        }
+        if (pending > g_stream_stats.max_pending) g_stream_stats.max_pending = pending;
+
+        /* Get the read going now rather than next frame */
+        StartReads();
+        return i;
+    }
+    return STREAM_INVALID;
+}
+
+uint32_t Stream_Update(void)
+{
+    PROFILE_ZONE("Stream_Update");
+    PollReads();
+
+    /* One decode (or commit of a decoded one) per call; its buffer is
+     * refilled right away */
+#ifdef SDL_PC
+    StreamRequest_t* r = Oldest(STREAM_DECODED);
+    if (r) Finish(r, CommitDecoded(r));
+    else r = Oldest(STREAM_STAGED);
+    if (r && r->state == STREAM_STAGED) Finish(r, Decode(r, g_staging[r->buffer]));
+#else
+    StreamRequest_t* r = Oldest(STREAM_STAGED);
+    if (r) Finish(r, Decode(r, g_staging[r->buffer]));
+#endif
+    StartReads();
+
+    uint32_t open = 0;
+    for (uint32_t i = 0; i < STREAM_MAX_REQUESTS; i++) {
+        if (IsOpen(g_requests[i].state)) open++;
+    }
+    return open;
+}
+
+uint32_t Stream_Get(uint32_t handle)
+{
+    if (handle >= STREAM_MAX_REQUESTS || g_requests[handle].state == 0) return STREAM_INVALID;
+    const StreamRequest_t* r = &g_requests[handle];
+    return (r->state == STREAM_READY) ? r->id : r->placeholder;
+}
+
+uint32_t Stream_GetState(uint32_t handle)
+{
+    return (handle < STREAM_MAX_REQUESTS) ? g_requests[handle].state : 0;
+}
+
+void Stream_Release(uint32_t handle)
+{
+    if (handle >= STREAM_MAX_REQUESTS) return;
+    StreamRequest_t* r = &g_requests[handle];
+    if (r->state == STREAM_READY || r->state == STREAM_FAILED || r->state == STREAM_QUEUED) r->state = 0;
+}
+
+void Stream_GetStats(StreamStats_t* stats)
+{
+    *stats = g_stream_stats;
+}
+
+uint32_t Stream_GetMemPools(MemPool_t* out, uint32_t max)
+{
+    uint32_t used = 0;
+    for (uint32_t b = 0; b < STREAM_STAGING_BUFFERS; b++) {
+        if (g_buffer_owner[b]) used += STREAM_STAGING_BYTES;
+    }
+    return MemMap_Add(out, 0, max, "stream staging", g_staging, sizeof(g_staging), used);
+}
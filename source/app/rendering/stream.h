@@ -0,0 +1,127 @@
+/**
+ * @file stream.h
+ * @brief Asynchronous Asset Streaming - NO MALLOC
+ *
+ * Loads are queued with Stream_Request() and complete over the following
+ * frames instead of blocking startup. Each file is read whole into one
+ * of STREAM_STAGING_BUFFERS staging buffers by the storage backend (an
+ * I/O thread on SDL_PC, SD or QSPI/OSPI DMA on the STM32), so the next
+ * file is already coming in while the previous one is decoded.
+ *
+ * Decoding (OBJ parse, MD2 convert, BMP convert/mip/tile) runs inside
+ * Stream_Update() on the caller's thread, at most one asset per call,
+ * which keeps the per-frame cost bounded. That thread must be the one
+ * that owns the mesh and texture pools (the pools take no locks and
+ * Mesh_Compact() moves them between frames); on the dual-core build
+ * that is the CM4 game loop.
+ *
+ * On SDL_PC, Stream_DecodeQueued() instead decodes every open request
+ * at once on the job pool, each into its own malloc'd staging
+ * (Mesh_DecodeOBJ/MD2, Texture_DecodeBMP); Stream_Update() then only
+ * copies them into the pools, one per call, in request order.
+ *
+ * Until an asset is ready its handle resolves to the placeholder id
+ * given with the request; the completion callback is where callers
+ * swap the real asset in.
+ */
+
+#ifndef STREAM_H
+#define STREAM_H
+
+#include <stdint.h>
+#include "engine_config.h"
+#include "memmap.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define STREAM_MAX_REQUESTS     32
+#define STREAM_PATH_LENGTH      96
+#define STREAM_STAGING_BUFFERS  2
+#ifndef STREAM_STAGING_BYTES
+#define STREAM_STAGING_BYTES    (512 * 1024)    /* Largest streamable file */
+#endif
+
+#define STREAM_INVALID          0xFFFFFFFF
+
+/* What the staged bytes are decoded with */
+#define STREAM_MESH_OBJ         0   /* Mesh_LoadOBJ() */
+#define STREAM_MESH_MD2         1   /* Mesh_LoadMD2() */
+#define STREAM_TEXTURE_BMP      2   /* Texture_LoadBMP() */
+
+/* Request states */
+#define STREAM_QUEUED           1
+#define STREAM_READING          2
+#define STREAM_STAGED           3   /* Read done, waiting for Stream_Update() */
+#define STREAM_READY            4
+#define STREAM_FAILED           5
+#define STREAM_DECODED          6   /* SDL_PC: decoded in staging, waiting for Stream_Update() */
+
+/* Runs in Stream_Update(); id is the new mesh/texture, STREAM_INVALID
+ * if the file could not be read or decoded */
+typedef void (*StreamDone_t)(uint32_t handle, uint32_t id, void* user);
+
+typedef struct {
+    uint32_t requested;
+    uint32_t completed;
+    uint32_t failed;
+    uint32_t bytes_read;
+    uint32_t max_pending;       /* Deepest the queue got */
+} StreamStats_t;
+
+void Stream_Init(void);
+
+/* Waits for reads in flight and stops the backend */
+void Stream_Shutdown(void);
+
+/* Queue a load; returns a handle, STREAM_INVALID if the queue is full */
+uint32_t Stream_Request(const char* path, uint32_t kind, uint32_t placeholder,
+    StreamDone_t done, void* user);
+
+/* Once per frame: starts reads into free staging buffers, then decodes
+ * at most one staged file. Returns the number of requests still open. */
+uint32_t Stream_Update(void);
+
+#ifdef SDL_PC
+/* Waits for reads in flight, then reads and decodes every staged and
+ * queued request in parallel, blocking; Stream_Update() commits them.
+ * Failures complete here. Returns the number of requests decoded. */
+uint32_t Stream_DecodeQueued(void);
+#endif
+
+/* Loaded id once STREAM_READY, the placeholder until then */
+uint32_t Stream_Get(uint32_t handle);
+uint32_t Stream_GetState(uint32_t handle);
+
+/* Forget a finished request (handle becomes invalid; the asset stays) */
+void Stream_Release(uint32_t handle);
+
+void Stream_GetStats(StreamStats_t* stats);
+uint32_t Stream_GetMemPools(MemPool_t* out, uint32_t max);
+
+/* ============================================================
+ * Storage Backend
+ * SDL_PC implements these in stream.cpp with an I/O thread. On the
+ * STM32 the board support provides them: open the file and read it
+ * whole into dst with SDMMC IDMA or OSPI + MDMA, without blocking.
+ * ============================================================ */
+
+#define STREAM_READ_BUSY        (-1)
+#define STREAM_READ_FAILED      (-2)
+
+void Stream_PlatformInit(void);
+void Stream_PlatformShutdown(void);
+
+/* Start reading `path` into staging buffer `buffer` (dst, max bytes) */
+void Stream_PlatformBeginRead(uint32_t buffer, const char* path, void* dst, uint32_t max);
+
+/* File size once the read is complete, STREAM_READ_BUSY while in
+ * flight, STREAM_READ_FAILED on error or if the file exceeds max */
+int32_t Stream_PlatformPollRead(uint32_t buffer);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* STREAM_H */
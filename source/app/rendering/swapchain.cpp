@@ -0,0 +1,139 @@
+/**
+ * @file swapchain.cpp
+ * @brief Double-Buffered Framebuffers With Asynchronous Present Implementation
+ */
+
+#include "swapchain.h"
+#include "rasterizer.h"
+#include "clear.h"
+#include "dcache.h"
+#include <string.h>
+
+#ifndef SDL_PC
+#include "stm32h7xx.h"
+#endif
+
+#if (FRAMEBUFFER_B_ADDR - FRAMEBUFFER_A_ADDR) < FRAMEBUFFER_SIZE
+#error "Framebuffers A and B overlap"
+#endif
+
+static SwapChainStats_t g_swap_stats;
+
+#ifdef SDL_PC
+
+void SwapChain_Init(void)
+{
+    memset(&g_swap_stats, 0, sizeof(g_swap_stats));
+}
+
+uint16_t* SwapChain_GetBackBuffer(void)
+{
+    return NULL;
+}
+
+uint16_t* SwapChain_GetFrontBuffer(void)
+{
+    return NULL;
+}
+
+void SwapChain_Present(void)
+{
+    g_swap_stats.presents++;
+}
+
+int SwapChain_IsPending(void)
+{
+    return 0;
+}
+
+void SwapChain_WaitBack(void)
+{
+}
+
+void SwapChain_IRQHandler(void)
+{
+}
+
+#else
+
+static uint16_t* const g_buffers[SWAPCHAIN_BUFFERS] = {
+    (uint16_t*)FRAMEBUFFER_A_ADDR,
+    (uint16_t*)FRAMEBUFFER_B_ADDR
+};
+static volatile uint32_t g_front = 0;
+static volatile int g_swap_pending = 0;
+
+void SwapChain_Init(void)
+{
+    memset(&g_swap_stats, 0, sizeof(g_swap_stats));
+    g_front = 0;
+    g_swap_pending = 0;
+
+    LTDC_Layer1->CFBAR = (uint32_t)g_buffers[0];
+    LTDC->SRCR = LTDC_SRCR_IMR;
+    LTDC->ICR = LTDC_ICR_CRRIF;
+    LTDC->IER |= LTDC_IER_RRIE;
+    NVIC_EnableIRQ(LTDC_IRQn);
+
+    Rasterizer_SetFrameBuffer(g_buffers[1]);
+}
+
+uint16_t* SwapChain_GetBackBuffer(void)
+{
+    return g_buffers[g_front ^ 1];
+}
+
+uint16_t* SwapChain_GetFrontBuffer(void)
+{
+    return g_buffers[g_front];
+}
+
+void SwapChain_Present(void)
+{
+    /* Two buffers: the previous swap must land before the next is queued */
+    SwapChain_WaitBack();
+    Clear_Wait();
+
+    uint16_t* back = g_buffers[g_front ^ 1];
+    DCache_Clean(back, FRAMEBUFFER_SIZE);
+
+    /* Shadow register: takes effect at the next vertical blanking */
+    LTDC_Layer1->CFBAR = (uint32_t)back;
+    g_swap_pending = 1;
+    LTDC->SRCR = LTDC_SRCR_VBR;
+
+    g_front ^= 1;
+    Rasterizer_SetFrameBuffer(g_buffers[g_front ^ 1]);
+    g_swap_stats.presents++;
+}
+
+int SwapChain_IsPending(void)
+{
+    return g_swap_pending;
+}
+
+void SwapChain_WaitBack(void)
+{
+    if (!g_swap_pending) return;
+    g_swap_stats.stalls++;
+
+    /* VBR is cleared by hardware once the reload happened; covers a masked IRQ */
+    while (LTDC->SRCR & LTDC_SRCR_VBR) {
+    }
+    g_swap_pending = 0;
+}
+
+void SwapChain_IRQHandler(void)
+{
+    if (LTDC->ISR & LTDC_ISR_RRIF) {
+        LTDC->ICR = LTDC_ICR_CRRIF;
+        g_swap_pending = 0;
+    }
+}
+
+#endif
+
+void SwapChain_GetStats(SwapChainStats_t* stats)
+{
+    *stats = g_swap_stats;
+}
@@ -0,0 +1,62 @@
+/**
+ * @file swapchain.h
+ * @brief Double-Buffered Framebuffers With Asynchronous Present
+ *
+ * Two RGB565 buffers at FRAMEBUFFER_A_ADDR and FRAMEBUFFER_B_ADDR: LTDC
+ * layer 1 scans out the front one while the rasterizer draws into the
+ * back one. SwapChain_Present() flushes the back buffer out of the
+ * D-cache, latches it as the layer address for the next vertical
+ * blanking and returns at once; the register-reload interrupt marks the
+ * swap done. The old front buffer may only be written after that, so
+ * the rasterizer calls SwapChain_WaitBack() right before it first
+ * touches the screen. With binning on, that is Rasterizer_Flush(), and
+ * the whole CPU side of the next frame overlaps the wait.
+ *
+ * SDL_PC presents through the Device surface; there these are no-ops.
+ */
+
+#ifndef SWAPCHAIN_H
+#define SWAPCHAIN_H
+
+#include <stdint.h>
+#include "engine_config.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SWAPCHAIN_BUFFERS       2
+
+typedef struct {
+    uint32_t presents;
+    uint32_t stalls;            /* Times the CPU had to wait for a pending swap */
+} SwapChainStats_t;
+
+/* Shows buffer A and points the rasterizer at buffer B */
+void SwapChain_Init(void);
+
+/* Buffer the rasterizer currently draws into; NULL on SDL_PC */
+uint16_t* SwapChain_GetBackBuffer(void);
+
+/* Buffer of the last present, on screen or about to be; NULL on SDL_PC */
+uint16_t* SwapChain_GetFrontBuffer(void);
+
+/* Queue the back buffer for scanout and retarget the rasterizer */
+void SwapChain_Present(void);
+
+/* Nonzero until the queued buffer is on screen */
+int SwapChain_IsPending(void);
+
+/* Block until the back buffer is no longer scanned out */
+void SwapChain_WaitBack(void);
+
+/* Called from LTDC_IRQHandler */
+void SwapChain_IRQHandler(void);
+
+void SwapChain_GetStats(SwapChainStats_t* stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SWAPCHAIN_H */
@@ -0,0 +1,151 @@
+/**
+ * @file systems.cpp
+ * @brief Entity System Scheduler Implementation
+ */
+
+#include "systems.h"
+#include "jobs.h"
+#include "profile.h"
+#include "engine_config.h"
+#include <string.h>
+
+typedef struct {
+    uint8_t system;
+    uint32_t first;
+    uint32_t count;
+} SystemJob_t;
+
+static System_t g_systems[SYSTEMS_MAX];
+static uint32_t g_wave[SYSTEMS_MAX];
+static uint32_t g_system_count = 0;
+static uint32_t g_wave_count = 0;
+
+static SystemStats_t g_system_stats[SYSTEMS_MAX];
+static uint64_t g_thread_ticks[SYSTEMS_MAX][JOB_MAX_THREADS];  /* Per system and thread; summed after the frame */
+
+static SystemJob_t g_jobs[SYSTEMS_MAX * SYSTEMS_MAX_CHUNKS];
+static float g_dt;
+
+static void AddJob(uint32_t* job_count, uint32_t system, uint32_t first, uint32_t count)
+{
+    SystemJob_t* job = &g_jobs[(*job_count)++];
+    job->system = (uint8_t)system;
+    job->first = first;
+    job->count = count;
+}
+
+static int Conflicts(const System_t* a, const System_t* b)
+{
+    return (a->writes & (b->reads | b->writes)) || (b->writes & a->reads);
+}
+
+/* ============================================================
+ * Registration
+ * ============================================================ */
+
+void Systems_Init(void)
+{
+    memset(g_systems, 0, sizeof(g_systems));
+    memset(g_system_stats, 0, sizeof(g_system_stats));
+    g_system_count = 0;
+    g_wave_count = 0;
+}
+
+int32_t Systems_Add(const System_t* system)
+{
+    if (!system || !system->run || g_system_count >= SYSTEMS_MAX) return -1;
+
+    uint32_t s = g_system_count++;
+    g_systems[s] = *system;
+
+    /* Right after the latest wave holding a conflicting system */
+    uint32_t wave = 0;
+    for (uint32_t i = 0; i < s; i++) {
+        if (Conflicts(&g_systems[i], system) && g_wave[i] + 1 > wave) wave = g_wave[i] + 1;
+    }
+    g_wave[s] = wave;
+    if (wave + 1 > g_wave_count) g_wave_count = wave + 1;
+    return (int32_t)s;
+}
+
+/* ============================================================
+ * Execution
+ * ============================================================ */
+
+static void RunJob(uint32_t index, uint32_t thread, void* user)
+{
+    (void)user;
+    const SystemJob_t* job = &g_jobs[index];
+    const System_t* s = &g_systems[job->system];
+
+    uint64_t start = Profile_Now();
+    s->run(job->first, job->count, g_dt, s->user);
+    uint64_t end = Profile_Now();
+
+    Profile_Record(s->name, start, end);
+    g_thread_ticks[job->system][thread] += end - start;
+}
+
+void Systems_Run(float dt)
+{
+    g_dt = dt;
+    memset(g_thread_ticks, 0, sizeof(g_thread_ticks));
+
+    for (uint32_t wave = 0; wave < g_wave_count; wave++) {
+        uint32_t job_count = 0;
+        for (uint32_t s = 0; s < g_system_count; s++) {
+            if (g_wave[s] != wave) continue;
+            const System_t* sys = &g_systems[s];
+            SystemStats_t* st = &g_system_stats[s];
+            st->wave = wave;
+
+            if (!sys->items) {
+                st->items = 1;
+                st->chunks = 1;
+                AddJob(&job_count, s, 0, 1);
+                continue;
+            }
+
+            /* SYSTEMS_CHUNK items per job, fewer jobs when there are many */
+            uint32_t items = sys->items(sys->user);
+            uint32_t chunk = (items + SYSTEMS_MAX_CHUNKS - 1) / SYSTEMS_MAX_CHUNKS;
+            if (chunk < SYSTEMS_CHUNK) chunk = SYSTEMS_CHUNK;
+            st->items = items;
+            st->chunks = 0;
+            for (uint32_t first = 0; first < items; first += chunk) {
+                AddJob(&job_count, s, first, MIN(chunk, items - first));
+                st->chunks++;
+            }
+        }
+
+        /* A lone job skips the wake-up of the workers */
+        if (job_count == 1) RunJob(0, 0, NULL);
+        else if (job_count > 1) Jobs_ParallelFor(job_count, RunJob, NULL);
+    }
+
+    for (uint32_t s = 0; s < g_system_count; s++) {
+        uint64_t ticks = 0;
+        for (uint32_t t = 0; t < JOB_MAX_THREADS; t++) ticks += g_thread_ticks[s][t];
+        g_system_stats[s].ticks = ticks;
+    }
+}
+
+/* ============================================================
+ * Queries
+ * ============================================================ */
+
+uint32_t Systems_GetCount(void)
+{
+    return g_system_count;
+}
+
+const char* Systems_GetName(uint32_t index)
+{
+    return (index < g_system_count) ? g_systems[index].name : NULL;
+}
+
+void Systems_GetStats(uint32_t index, SystemStats_t* stats)
+{
+    if (index < g_system_count) *stats = g_system_stats[index];
+    else memset(stats, 0, sizeof(*stats));
+}
@@ -0,0 +1,70 @@
+/**
+ * @file systems.h
+ * @brief Entity System Scheduler - NO MALLOC
+ *
+ * The per-frame entity work (transforms, animators, scene build) used to
+ * run back to back on the main thread, so its cost grew with every entity
+ * added. Each system now declares the component sets it reads and writes
+ * (COMP_* masks from entity.h) and Systems_Run() puts it in the earliest
+ * wave after every earlier system it conflicts with; two systems
+ * conflict when one writes what the other reads or writes. The systems
+ * of a wave, and the chunks of SYSTEMS_CHUNK items of each, run together
+ * on the job pool (jobs.h); waves run in order.
+ *
+ * A system with an item count is called with disjoint [first, first +
+ * count) ranges from several threads and must keep to its items; one
+ * without runs once, whole. Every chunk is recorded in the frame profile
+ * under the system's name.
+ *
+ * The job pool is not reentrant: call Systems_Run() where nothing else
+ * dispatches jobs (in FramePacer_Overlap() it runs beside present only,
+ * never beside Rasterizer_Flush()).
+ */
+
+#ifndef SYSTEMS_H
+#define SYSTEMS_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SYSTEMS_MAX             16
+#define SYSTEMS_CHUNK           64      /* Items per job, at least */
+#define SYSTEMS_MAX_CHUNKS      16      /* Jobs per system and wave, at most */
+
+typedef struct {
+    const char* name;           /* Profile zone; must outlive the scheduler */
+    uint32_t reads;             /* COMP_* mask */
+    uint32_t writes;            /* COMP_* mask */
+    uint32_t (*items)(void* user);  /* Items to split up; NULL = run once */
+    void (*run)(uint32_t first, uint32_t count, float dt, void* user);
+    void* user;
+} System_t;
+
+/* Totals of the most recent Systems_Run() */
+typedef struct {
+    uint64_t ticks;             /* Profile_Now() ticks summed over chunks */
+    uint32_t items;
+    uint32_t chunks;
+    uint32_t wave;
+} SystemStats_t;
+
+void Systems_Init(void);
+
+/* Appends a system after those already added; the order breaks ties
+ * between conflicting systems. Returns its index, -1 when full. */
+int32_t Systems_Add(const System_t* system);
+
+void Systems_Run(float dt);
+
+uint32_t Systems_GetCount(void);
+const char* Systems_GetName(uint32_t index);
+void Systems_GetStats(uint32_t index, SystemStats_t* stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SYSTEMS_H */
@@ -0,0 +1,545 @@
+/**
+ * @file telemetry.cpp
+ * @brief Live Performance Telemetry Implementation
+ */
+
+#include "telemetry.h"
+#include "dcache.h"
+#include <string.h>
+
+#ifdef SDL_PC
+#include <stdio.h>
+#else
+#include "stm32h7xx.h"
+#endif
+
+#define NAME_MASK           (TELEMETRY_MAX_NAMES - 1)
+#define NO_NAME             0xFFFF
+#define HEADER_BYTES        4
+#define CHECK_BYTES         2
+#define MAX_PAYLOAD         (8 + TELEMETRY_ZONES_PER_PACKET * 12)
+#define STATS_WORDS         (sizeof(RasterizerStats_t) / sizeof(uint32_t))
+
+static_assert(8 + MEMMAP_MAX_POOLS * 12 <= MAX_PAYLOAD, "POOLS packet must fit");
+static_assert(16 + sizeof(RasterizerStats_t) <= MAX_PAYLOAD, "STATS packet must fit");
+static_assert(HEADER_BYTES + MAX_PAYLOAD + CHECK_BYTES <= TELEMETRY_UART_BYTES, "a packet must fit a UART buffer");
+
+PLACE_TELEMETRY_BUFFER CACHE_ALIGNED static uint8_t g_uart[2][TELEMETRY_UART_BYTES];
+static uint32_t g_uart_fill;        /* Buffer gathering packets */
+static uint32_t g_uart_used;
+
+static uint8_t g_packet[HEADER_BYTES + MAX_PAYLOAD + CHECK_BYTES];
+static uint32_t g_packet_used;
+
+/* Interned names by pointer; the slot is the id on the wire */
+static const char* g_names[TELEMETRY_MAX_NAMES];
+
+static ProfileEvent_t g_zones[TELEMETRY_ZONES_PER_PACKET];
+static MemPool_t g_pools[MEMMAP_MAX_POOLS];
+
+static uint32_t g_sink = TELEMETRY_SINK_NONE;
+static uint32_t g_cursor;           /* Profile_Read() position */
+static TelemetryStats_t g_telemetry_stats;
+
+#ifdef SDL_PC
+static FILE* g_file;
+#endif
+
+/* ============================================================
+ * Sinks
+ * ============================================================ */
+
+#ifndef SDL_PC
+static int ItmListening(void)
+{
+    return (ITM->TCR & ITM_TCR_ITMENA_Msk) && (ITM->TER & (1u << TELEMETRY_ITM_PORT));
+}
+
+/* Words while they last; each waits for room in the stimulus FIFO */
+static void ItmWrite(const uint8_t* data, uint32_t bytes)
+{
+    volatile ITM_Type* itm = ITM;
+    for (; bytes >= 4; bytes -= 4, data += 4) {
+        uint32_t word;
+        memcpy(&word, data, sizeof(word));
+        while (itm->PORT[TELEMETRY_ITM_PORT].u32 == 0) {}
+        itm->PORT[TELEMETRY_ITM_PORT].u32 = word;
+    }
+    for (; bytes; bytes--, data++) {
+        while (itm->PORT[TELEMETRY_ITM_PORT].u32 == 0) {}
+        itm->PORT[TELEMETRY_ITM_PORT].u8 = *data;
+    }
+}
+#endif
+
+static void Send(const uint8_t* data, uint32_t bytes)
+{
+    int sent = 0;
+    switch (g_sink) {
+#ifdef SDL_PC
+    case TELEMETRY_SINK_FILE:
+        sent = fwrite(data, 1, bytes, g_file) == bytes;
+        break;
+#else
+    case TELEMETRY_SINK_ITM:
+        sent = ItmListening();
+        if (sent) ItmWrite(data, bytes);
+        break;
+#endif
+    case TELEMETRY_SINK_UART:
+        sent = g_uart_used + bytes <= TELEMETRY_UART_BYTES;
+        if (sent) {
+            memcpy(&g_uart[g_uart_fill][g_uart_used], data, bytes);
+            g_uart_used += bytes;
+        }
+        break;
+    }
+
+    if (sent) {
+        g_telemetry_stats.packets++;
+        g_telemetry_stats.bytes += bytes;
+    }
+    else {
+        g_telemetry_stats.dropped++;
+    }
+}
+
+/* Hands the gathered buffer to the DMA once the previous one is out */
+static void FlushUart(void)
+{
+#ifndef SDL_PC
+    if (g_sink != TELEMETRY_SINK_UART || g_uart_used == 0 || Telemetry_PlatformUartBusy()) return;
+    DCache_Clean(g_uart[g_uart_fill], g_uart_used);
+    Telemetry_PlatformUartSend(g_uart[g_uart_fill], g_uart_used);
+    g_uart_fill ^= 1;
+    g_uart_used = 0;
+#endif
+}
+
+/* ============================================================
+ * Packets
+ * ============================================================ */
+
+static uint16_t Fletcher16(const uint8_t* data, uint32_t bytes)
+{
+    uint32_t a = 0, b = 0;
+    for (uint32_t i = 0; i < bytes; i++) {
+        a = (a + data[i]) % 255;
+        b = (b + a) % 255;
+    }
+    return (uint16_t)((b << 8) | a);
+}
+
+static void Begin(uint32_t type)
+{
+    g_packet[0] = TELEMETRY_SYNC;
+    g_packet[1] = (uint8_t)type;
+    g_packet_used = HEADER_BYTES;
+}
+
+static void Put(const void* data, uint32_t bytes)
+{
+    memcpy(&g_packet[g_packet_used], data, bytes);
+    g_packet_used += bytes;
+}
+
+static void Put16(uint32_t v)
+{
+    uint16_t h = (uint16_t)v;
+    Put(&h, sizeof(h));
+}
+
+static void Put32(uint32_t v)
+{
+    Put(&v, sizeof(v));
+}
+
+static void Put64(uint64_t v)
+{
+    Put(&v, sizeof(v));
+}
+
+static void End(void)
+{
+    uint32_t payload = g_packet_used - HEADER_BYTES;
+    g_packet[2] = (uint8_t)payload;
+    g_packet[3] = (uint8_t)(payload >> 8);
+    uint16_t check = Fletcher16(&g_packet[1], g_packet_used - 1);
+    Put16(check);
+    Send(g_packet, g_packet_used);
+}
+
+static void SendName(uint32_t id)
+{
+    uint32_t length = (uint32_t)strlen(g_names[id]);
+    if (length > TELEMETRY_NAME_LENGTH - 1) length = TELEMETRY_NAME_LENGTH - 1;
+    Begin(TELEMETRY_NAME);
+    Put16(id);
+    Put(g_names[id], length);
+    End();
+}
+
+/* Id of a static name string, announced with a NAME packet on first
+ * use; NO_NAME once the table is full */
+static uint32_t NameId(const char* name)
+{
+    uint32_t slot = (uint32_t)(((uintptr_t)name >> 2) * 2654435761u) & NAME_MASK;
+    for (uint32_t probe = 0; probe < TELEMETRY_MAX_NAMES; probe++) {
+        if (g_names[slot] == name) return slot;
+        if (!g_names[slot]) {
+            g_names[slot] = name;
+            SendName(slot);
+            return slot;
+        }
+        slot = (slot + 1) & NAME_MASK;
+    }
+    return NO_NAME;
+}
+
+static void SendHello(void)
+{
+    Begin(TELEMETRY_HELLO);
+    Put32(TELEMETRY_MAGIC);
+    Put16(TELEMETRY_VERSION);
+    Put16((uint32_t)STATS_WORDS);
+    Put32((uint32_t)Profile_TicksPerSecond());
+    End();
+
+    for (uint32_t id = 0; id < TELEMETRY_MAX_NAMES; id++) {
+        if (g_names[id]) SendName(id);
+    }
+}
+
+/* One ZONES packet per batch read from the profiler ring */
+static void SendZones(void)
+{
+    uint32_t count;
+    while ((count = Profile_Read(&g_cursor, g_zones, TELEMETRY_ZONES_PER_PACKET,
+        &g_telemetry_stats.lost_zones)) > 0) {
+        uint64_t base = g_zones[0].start;
+        uint16_t ids[TELEMETRY_ZONES_PER_PACKET];
+        for (uint32_t i = 0; i < count; i++) {
+            if (g_zones[i].start < base) base = g_zones[i].start;
+            ids[i] = (uint16_t)NameId(g_zones[i].name);
+        }
+
+        Begin(TELEMETRY_ZONES);
+        Put64(base);
+        for (uint32_t i = 0; i < count; i++) {
+            uint64_t offset = g_zones[i].start - base;
+            Put16(ids[i]);
+            Put16(g_zones[i].thread);
+            Put32(offset > 0xFFFFFFFFull ? 0xFFFFFFFFu : (uint32_t)offset);
+            Put32(g_zones[i].duration);
+        }
+        End();
+    }
+}
+
+static void SendPools(uint64_t now)
+{
+    uint32_t count = MemMap_Collect(g_pools, MEMMAP_MAX_POOLS);
+    uint16_t ids[MEMMAP_MAX_POOLS];
+    for (uint32_t i = 0; i < count; i++) ids[i] = (uint16_t)NameId(g_pools[i].name);
+
+    Begin(TELEMETRY_POOLS);
+    Put64(now);
+    for (uint32_t i = 0; i < count; i++) {
+        Put16(ids[i]);
+        Put16(0);
+        Put32(g_pools[i].size);
+        Put32(g_pools[i].used);
+    }
+    End();
+}
+
+/* ============================================================
+ * Streaming
+ * ============================================================ */
+
+static void Reset(uint32_t sink)
+{
+    memset(g_names, 0, sizeof(g_names));
+    memset(&g_telemetry_stats, 0, sizeof(g_telemetry_stats));
+    g_uart_fill = 0;
+    g_uart_used = 0;
+    /* Only zones from now on */
+    uint32_t lost = 0;
+    while (Profile_Read(&g_cursor, g_zones, TELEMETRY_ZONES_PER_PACKET, &lost) > 0) {}
+    g_sink = sink;
+}
+
+int Telemetry_Start(uint32_t sink)
+{
+    Telemetry_Stop();
+#ifndef SDL_PC
+    if (sink == TELEMETRY_SINK_UART || (sink == TELEMETRY_SINK_ITM && ItmListening())) {
+        Reset(sink);
+        return 1;
+    }
+#endif
+    (void)sink;
+    return 0;
+}
+
+#ifdef SDL_PC
+int Telemetry_StartFile(const char* path)
+{
+    Telemetry_Stop();
+    g_file = fopen(path, "wb");
+    if (!g_file) return 0;
+    Reset(TELEMETRY_SINK_FILE);
+    return 1;
+}
+#endif
+
+void Telemetry_Stop(void)
+{
+#ifdef SDL_PC
+    if (g_file) fclose(g_file);
+    g_file = NULL;
+#else
+    if (g_sink == TELEMETRY_SINK_UART) {
+        while (Telemetry_PlatformUartBusy()) {}
+        FlushUart();
+        while (Telemetry_PlatformUartBusy()) {}
+    }
+#endif
+    g_sink = TELEMETRY_SINK_NONE;
+}
+
+int Telemetry_IsRunning(void)
+{
+    return g_sink != TELEMETRY_SINK_NONE;
+}
+
+void Telemetry_Frame(const RasterizerStats_t* stats)
+{
+    if (g_sink == TELEMETRY_SINK_NONE) return;
+
+    uint32_t frame = g_telemetry_stats.frames++;
+    if (frame % TELEMETRY_RESYNC_FRAMES == 0) SendHello();
+    SendZones();
+
+    uint64_t now = Profile_Now();
+    Begin(TELEMETRY_STATS);
+    Put64(now);
+    Put32(frame);
+    Put32(g_telemetry_stats.lost_zones);
+    Put(stats, sizeof(*stats));
+    End();
+
+    if (frame % TELEMETRY_POOL_FRAMES == 0) SendPools(now);
+    FlushUart();
+}
+
+void Telemetry_GetStats(TelemetryStats_t* stats)
+{
+    *stats = g_telemetry_stats;
+}
+
+uint32_t Telemetry_GetMemPools(MemPool_t* out, uint32_t max)
+{
+    uint32_t used = (g_sink == TELEMETRY_SINK_UART) ? (uint32_t)sizeof(g_uart) : 0;
+    return MemMap_Add(out, 0, max, "telemetry uart", g_uart, sizeof(g_uart), used);
+}
+
+/* ============================================================
+ * Decoder (SDL_PC)
+ * ============================================================ */
+
+#ifdef SDL_PC
+
+/* RasterizerStats_t in field order; stage ticks are shown in microseconds */
+static const char* const g_stat_names[] = {
+    "triangles submitted", "triangles culled", "triangles drawn", "triangles small",
+    "triangles micro culled", "pixels drawn", "hiz blocks culled", "pixels depth rejected",
+    "entities culled", "clusters culled", "pixels bbox", "pixels visited", "texels fetched",
+    "pixels resolved", "transform us", "clip us", "setup us", "raster us", "present us",
+};
+static_assert(sizeof(g_stat_names) / sizeof(g_stat_names[0]) == STATS_WORDS,
+    "stat names must follow RasterizerStats_t");
+#define STAT_FIRST_STAGE    (STATS_WORDS - RASTER_STAGE_COUNT)
+
+typedef struct {
+    ProfileTrace_t trace;
+    uint32_t packets;
+    double us_per_tick;         /* 0 until a HELLO */
+    uint32_t stats_words;
+    uint64_t origin;            /* Ticks at trace time 0 */
+    int has_origin;
+
+    /* Raw SWO: bytes left in the current ITM packet, and whether they
+     * belong to the chosen port */
+    int itm_port;
+    uint32_t itm_left;
+    int itm_keep;
+    int itm_continue;           /* Inside a timestamp or extension packet */
+
+    uint8_t packet[HEADER_BYTES + MAX_PAYLOAD + CHECK_BYTES];
+    uint32_t used;
+    char names[TELEMETRY_MAX_NAMES][TELEMETRY_NAME_LENGTH];
+} Decoder_t;
+
+static Decoder_t g_decoder;
+
+static uint16_t Get16(const uint8_t* p)
+{
+    uint16_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static uint32_t Get32(const uint8_t* p)
+{
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static uint64_t Get64(const uint8_t* p)
+{
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static double TraceTime(Decoder_t* d, uint64_t ticks)
+{
+    if (!d->has_origin) {
+        d->origin = ticks;
+        d->has_origin = 1;
+    }
+    return ((double)ticks - (double)d->origin) * d->us_per_tick;
+}
+
+static const char* DecodedName(const Decoder_t* d, uint32_t id)
+{
+    return (id < TELEMETRY_MAX_NAMES && d->names[id][0]) ? d->names[id] : "?";
+}
+
+static void HandlePacket(Decoder_t* d, uint32_t type, const uint8_t* p, uint32_t bytes)
+{
+    d->packets++;
+    if (type == TELEMETRY_HELLO && bytes >= 12 && Get32(p) == TELEMETRY_MAGIC) {
+        uint32_t ticks_per_second = Get32(p + 8);
+        d->stats_words = Get16(p + 6);
+        d->us_per_tick = ticks_per_second ? 1000000.0 / (double)ticks_per_second : 0.0;
+        return;
+    }
+    if (type == TELEMETRY_NAME && bytes >= 2) {
+        uint32_t id = Get16(p), length = bytes - 2;
+        if (id >= TELEMETRY_MAX_NAMES) return;
+        if (length > TELEMETRY_NAME_LENGTH - 1) length = TELEMETRY_NAME_LENGTH - 1;
+        memcpy(d->names[id], p + 2, length);
+        d->names[id][length] = 0;
+        return;
+    }
+    if (d->us_per_tick == 0.0) return;      /* Joined mid-stream, wait for a HELLO */
+
+    if (type == TELEMETRY_ZONES && bytes >= 8) {
+        uint64_t base = Get64(p);
+        for (uint32_t at = 8; at + 12 <= bytes; at += 12) {
+            Profile_TraceZone(&d->trace, DecodedName(d, Get16(p + at)), Get16(p + at + 2),
+                TraceTime(d, base + Get32(p + at + 4)), (double)Get32(p + at + 8) * d->us_per_tick);
+        }
+    }
+    else if (type == TELEMETRY_STATS && bytes >= 16) {
+        double ts = TraceTime(d, Get64(p));
+        Profile_TraceCounter(&d->trace, "zones lost", ts, (double)Get32(p + 12));
+        uint32_t words = MIN((bytes - 16) / 4, MIN(d->stats_words, (uint32_t)STATS_WORDS));
+        for (uint32_t i = 0; i < words; i++) {
+            double value = (double)Get32(p + 16 + i * 4);
+            if (i >= STAT_FIRST_STAGE) value *= d->us_per_tick;
+            Profile_TraceCounter(&d->trace, g_stat_names[i], ts, value);
+        }
+    }
+    else if (type == TELEMETRY_POOLS && bytes >= 8) {
+        double ts = TraceTime(d, Get64(p));
+        for (uint32_t at = 8; at + 12 <= bytes; at += 12) {
+            char name[TELEMETRY_NAME_LENGTH + 16];
+            snprintf(name, sizeof(name), "%s used", DecodedName(d, Get16(p + at)));
+            Profile_TraceCounter(&d->trace, name, ts, (double)Get32(p + at + 8));
+        }
+    }
+}
+
+/* Drops the first byte and everything up to the next sync */
+static void Resync(Decoder_t* d)
+{
+    uint32_t i = 1;
+    while (i < d->used && d->packet[i] != TELEMETRY_SYNC) i++;
+    memmove(d->packet, d->packet + i, d->used - i);
+    d->used -= i;
+}
+
+/* 1 if bytes were dropped and the rest needs another look */
+static int ParsePacket(Decoder_t* d)
+{
+    if (d->used < HEADER_BYTES) return 0;
+    uint32_t payload = d->packet[2] | ((uint32_t)d->packet[3] << 8);
+    if (payload > MAX_PAYLOAD) {
+        Resync(d);
+        return 1;
+    }
+    uint32_t total = HEADER_BYTES + payload + CHECK_BYTES;
+    if (d->used < total) return 0;
+
+    if (Fletcher16(&d->packet[1], HEADER_BYTES - 1 + payload) != Get16(&d->packet[HEADER_BYTES + payload])) {
+        Resync(d);
+        return 1;
+    }
+    HandlePacket(d, d->packet[1], &d->packet[HEADER_BYTES], payload);
+    d->used = 0;
+    return 0;
+}
+
+static void FeedPacket(Decoder_t* d, uint8_t byte)
+{
+    if (d->used == 0 && byte != TELEMETRY_SYNC) return;
+    d->packet[d->used++] = byte;
+    while (ParsePacket(d)) {}
+}
+
+/* ITM packets: a header whose low two bits give 1, 2 or 4 payload
+ * bytes (bit 2 clear for software stimulus, port in the top five bits);
+ * sync, overflow and timestamp packets carry nothing for us */
+static void FeedItm(Decoder_t* d, uint8_t byte)
+{
+    if (d->itm_left) {
+        d->itm_left--;
+        if (d->itm_keep) FeedPacket(d, byte);
+        return;
+    }
+    if (d->itm_continue) {
+        d->itm_continue = (byte & 0x80) != 0;
+        return;
+    }
+    if (byte & 0x03) {
+        static const uint8_t sizes[4] = { 0, 1, 2, 4 };
+        d->itm_left = sizes[byte & 0x03];
+        d->itm_keep = !(byte & 0x04) && (byte >> 3) == (uint32_t)d->itm_port;
+        return;
+    }
+    /* Sync zeros end with 0x80, which has no continuation */
+    d->itm_continue = byte != 0x80 && (byte & 0x80) != 0;
+}
+
+uint32_t Telemetry_Decode(const void* data, uint32_t size, int itm_port,
+    ProfileWrite_t write, void* user)
+{
+    Decoder_t* d = &g_decoder;
+    memset(d, 0, sizeof(*d));
+    d->itm_port = itm_port;
+
+    Profile_TraceBegin(&d->trace, write, user);
+    const uint8_t* bytes = (const uint8_t*)data;
+    for (uint32_t i = 0; i < size; i++) {
+        if (itm_port == TELEMETRY_DECODE_RAW) FeedPacket(d, bytes[i]);
+        else FeedItm(d, bytes[i]);
+    }
+    Profile_TraceEnd(&d->trace);
+    return d->packets;
+}
+
+#endif
@@ -0,0 +1,138 @@
+/**
+ * @file telemetry.h
+ * @brief Live Performance Telemetry Over SWO/ITM Or UART - NO MALLOC
+ *
+ * Telemetry_Frame() streams, once per frame, the frame's
+ * RasterizerStats_t, every profiler zone closed since the previous call
+ * and, every TELEMETRY_POOL_FRAMES frames, the MemMap_Collect() pool
+ * usage as compact binary packets through one sink:
+ *
+ *   ITM    stimulus port TELEMETRY_ITM_PORT, out of the SWO pin to any
+ *          SWO probe. Waits on the ITM FIFO, so run SWO fast; packets
+ *          are dropped while no debugger has the port enabled.
+ *   UART   for boards without a debugger: packets gather in one of two
+ *          DMA buffers, which the board support sends while the other
+ *          fills. Packets that do not fit are dropped and counted.
+ *   FILE   SDL_PC: the same packets into a file, to check the decoder.
+ *
+ * On PC, Telemetry_Decode() turns a recorded stream into the Chrome
+ * trace JSON of Profile_WriteTrace(): zones as "X" events on their
+ * threads, statistics and pool usage as counter tracks. From the
+ * command line: rasterizer --telemetry in.bin out.json [itm port].
+ *
+ * Packet, little-endian: TELEMETRY_SYNC, uint8 type, uint16 payload
+ * bytes, the payload, then a Fletcher-16 of type, length and payload.
+ * A decoder that joins mid-stream skips to the next sync whose checksum
+ * holds; HELLO and every NAME repeat each TELEMETRY_RESYNC_FRAMES, so
+ * it can name what follows.
+ *
+ *   HELLO  uint32 TELEMETRY_MAGIC, uint16 version, uint16 stats words,
+ *          uint32 Profile_TicksPerSecond()
+ *   NAME   uint16 id, then the name's characters, no terminator
+ *   ZONES  uint64 base ticks, then per zone uint16 name id, uint16
+ *          thread, uint32 start - base, uint32 duration
+ *   STATS  uint64 ticks, uint32 frame, uint32 zones lost so far, then
+ *          the RasterizerStats_t words
+ *   POOLS  uint64 ticks, then per pool uint16 name id, uint16 reserved,
+ *          uint32 size, uint32 used
+ */
+
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <stdint.h>
+#include "engine_config.h"
+#include "rasterizer.h"
+#include "profile.h"
+#include "memmap.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef TELEMETRY_ITM_PORT
+#define TELEMETRY_ITM_PORT      1       /* Port 0 is left to printf */
+#endif
+#ifndef TELEMETRY_UART_BYTES
+#define TELEMETRY_UART_BYTES    4096    /* Per DMA buffer, two of them */
+#endif
+#define TELEMETRY_RESYNC_FRAMES 60
+#define TELEMETRY_POOL_FRAMES   30
+#define TELEMETRY_MAX_NAMES     256     /* Zone and pool names; power of two */
+#define TELEMETRY_NAME_LENGTH   48      /* Longer names are cut */
+#define TELEMETRY_ZONES_PER_PACKET  64
+
+#define TELEMETRY_SYNC          0xA5
+#define TELEMETRY_MAGIC         0x4C455453u     /* "STEL" */
+#define TELEMETRY_VERSION       1
+
+/* Packet types */
+#define TELEMETRY_HELLO         1
+#define TELEMETRY_NAME          2
+#define TELEMETRY_ZONES         3
+#define TELEMETRY_STATS         4
+#define TELEMETRY_POOLS         5
+
+/* Sinks */
+#define TELEMETRY_SINK_NONE     0
+#define TELEMETRY_SINK_ITM      1
+#define TELEMETRY_SINK_UART     2
+#define TELEMETRY_SINK_FILE     3   /* SDL_PC, Telemetry_StartFile() */
+
+typedef struct {
+    uint32_t frames;
+    uint32_t packets;
+    uint32_t bytes;
+    uint32_t dropped;           /* Packets with no room or no listener */
+    uint32_t lost_zones;        /* Overwritten in the profiler ring before they were sent */
+} TelemetryStats_t;
+
+/* Streams through sink from the next Telemetry_Frame(); 0 if the sink
+ * is not available in this build, or ITM has no debugger listening.
+ * Boards fall back to TELEMETRY_SINK_UART then. */
+int Telemetry_Start(uint32_t sink);
+
+#ifdef SDL_PC
+/* Returns 0 if the file cannot be created */
+int Telemetry_StartFile(const char* path);
+#endif
+
+/* Sends what is buffered, then stops */
+void Telemetry_Stop(void);
+
+int Telemetry_IsRunning(void);
+
+/* Once per frame, between frames (no zones closing) */
+void Telemetry_Frame(const RasterizerStats_t* stats);
+
+void Telemetry_GetStats(TelemetryStats_t* stats);
+uint32_t Telemetry_GetMemPools(MemPool_t* out, uint32_t max);
+
+#ifdef SDL_PC
+#define TELEMETRY_DECODE_RAW    (-1)
+
+/* Chrome trace JSON of a recorded stream. itm_port picks one stimulus
+ * port out of a raw SWO capture (ITM packets); TELEMETRY_DECODE_RAW
+ * takes the bytes as sent (UART, FILE, or a probe's per-port export).
+ * Returns the packets decoded. */
+uint32_t Telemetry_Decode(const void* data, uint32_t size, int itm_port,
+    ProfileWrite_t write, void* user);
+#else
+/* ============================================================
+ * UART Backend
+ * The board support provides these: the USART, its pins and a TX DMA
+ * stream are set up at startup. The buffer is cleaned from the D-cache
+ * and stays untouched until the transfer is done.
+ * ============================================================ */
+
+void Telemetry_PlatformUartSend(const void* data, uint32_t bytes);
+
+/* Nonzero while a transfer is in flight */
+int Telemetry_PlatformUartBusy(void);
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TELEMETRY_H */
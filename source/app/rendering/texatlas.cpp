@@ -0,0 +1,184 @@
+/**
+ * @file texatlas.cpp
+ * @brief Texture Atlas Pages Implementation
+ */
+
+#include "texatlas.h"
+#include "texture.h"
+#include "mesh.h"
+#include <string.h>
+
+#define ATLAS_NONE          0xFFFF
+
+/* Per source of the current build: packing order and page position */
+static uint16_t g_atlas_order[TEXATLAS_MAX_SOURCES];
+static uint16_t g_atlas_x[TEXATLAS_MAX_SOURCES];
+static uint16_t g_atlas_y[TEXATLAS_MAX_SOURCES];
+static uint8_t g_atlas_placed[TEXATLAS_MAX_SOURCES];
+
+/* ============================================================
+ * Packing
+ * ============================================================ */
+
+/* Shelves across a size x size page for the sources of order[] not yet
+ * placed, tallest first; positions for those that fit when place is set.
+ * Returns how many fit. */
+static uint32_t PackShelves(const uint32_t* textures, uint32_t order_count, uint32_t size, int place)
+{
+    uint32_t x = 0, y = 0, shelf = 0, fitted = 0;
+    for (uint32_t i = 0; i < order_count; i++) {
+        uint32_t k = g_atlas_order[i];
+        if (g_atlas_placed[k]) continue;
+        const TextureSlot_t* t = Texture_Get(textures[k]);
+        if (x + t->width > size) {
+            x = 0;
+            y += shelf;
+            shelf = 0;
+        }
+        if (y + t->height > size) continue;
+        if (shelf == 0) shelf = t->height;
+        if (place) {
+            g_atlas_x[k] = (uint16_t)x;
+            g_atlas_y[k] = (uint16_t)y;
+        }
+        x += t->width;
+        fitted++;
+    }
+    return fitted;
+}
+
+/* Sources in a size x size page, sampled through Texture_SampleFast()
+ * so tiled and indexed ones read alike; level 0 only (texatlas.h) */
+static uint32_t FillPage(const uint32_t* textures, uint32_t order_count, uint32_t size)
+{
+    uint32_t page = Texture_Create((uint16_t)size, (uint16_t)size, TEXTURE_FORMAT_RGB565, 0);
+    if (page == 0xFFFFFFFF) return 0xFFFFFFFF;
+
+    uint16_t* pixels = Texture_GetPixels(page);
+    memset(pixels, 0, size * size * sizeof(uint16_t));
+    for (uint32_t i = 0; i < order_count; i++) {
+        uint32_t k = g_atlas_order[i];
+        if (g_atlas_placed[k] || g_atlas_x[k] == ATLAS_NONE) continue;
+        const TextureSlot_t* t = Texture_Get(textures[k]);
+        for (uint32_t ty = 0; ty < t->height; ty++) {
+            uint16_t* row = &pixels[(g_atlas_y[k] + ty) * size + g_atlas_x[k]];
+            for (uint32_t tx = 0; tx < t->width; tx++) row[tx] = Texture_SampleFast(textures[k], (int)tx, (int)ty);
+        }
+    }
+    Texture_Tile(page);
+    return page;
+}
+
+uint32_t TexAtlas_Build(const uint32_t* textures, uint32_t count, TexAtlasEntry_t* out)
+{
+    if (count > TEXATLAS_MAX_SOURCES) count = TEXATLAS_MAX_SOURCES;
+
+    /* Everything stays put until packed */
+    uint32_t order_count = 0;
+    for (uint32_t k = 0; k < count; k++) {
+        out[k].texture_id = textures[k];
+        out[k].u_scale = out[k].v_scale = 1.0f;
+        out[k].u_offset = out[k].v_offset = 0.0f;
+        g_atlas_placed[k] = 1;
+
+        const TextureSlot_t* t = Texture_Get(textures[k]);
+        if (!t || t->width > TEXATLAS_MAX_ENTRY || t->height > TEXATLAS_MAX_ENTRY) continue;
+        g_atlas_placed[k] = 0;
+
+        /* Insertion by height, then width, descending */
+        uint32_t i = order_count++;
+        while (i > 0) {
+            const TextureSlot_t* p = Texture_Get(textures[g_atlas_order[i - 1]]);
+            if (p->height > t->height || (p->height == t->height && p->width >= t->width)) break;
+            g_atlas_order[i] = g_atlas_order[i - 1];
+            i--;
+        }
+        g_atlas_order[i] = (uint16_t)k;
+    }
+
+    uint32_t pages = 0;
+    for (;;) {
+        /* Smallest page that takes every remaining source, else a full one */
+        uint32_t size = TEXATLAS_MIN_PAGE;
+        uint32_t remaining = 0;
+        for (uint32_t i = 0; i < order_count; i++) remaining += !g_atlas_placed[g_atlas_order[i]];
+        while (size < TEXATLAS_PAGE_SIZE && PackShelves(textures, order_count, size, 0) < remaining) size <<= 1;
+
+        for (uint32_t k = 0; k < count; k++) g_atlas_x[k] = ATLAS_NONE;
+        if (PackShelves(textures, order_count, size, 1) < 2) break;
+
+        uint32_t page = FillPage(textures, order_count, size);
+        if (page == 0xFFFFFFFF) break;
+        pages++;
+
+        /* Rectangles inset by half a texel */
+        for (uint32_t k = 0; k < count; k++) {
+            if (g_atlas_placed[k] || g_atlas_x[k] == ATLAS_NONE) continue;
+            const TextureSlot_t* t = Texture_Get(textures[k]);
+            out[k].texture_id = page;
+            out[k].u_scale = (float)(t->width - 1) / (float)size;
+            out[k].v_scale = (float)(t->height - 1) / (float)size;
+            out[k].u_offset = ((float)g_atlas_x[k] + 0.5f) / (float)size;
+            out[k].v_offset = ((float)g_atlas_y[k] + 0.5f) / (float)size;
+            g_atlas_placed[k] = 1;
+        }
+    }
+    return pages;
+}
+
+/* ============================================================
+ * UV Remapping
+ * ============================================================ */
+
+static inline int InUnitRange(float u, float v)
+{
+    return u >= 0.0f && u <= 1.0f && v >= 0.0f && v <= 1.0f;
+}
+
+int TexAtlas_CanRemap(uint32_t mesh_id)
+{
+    const MeshSlot_t* m = Mesh_Get(mesh_id);
+    if (!m || (m->flags & MESH_FLAG_BAKED)) return 0;
+
+    if (m->type == 1) {
+        const Vertex_t* verts = &g_vertex_pool[m->stat.vertex_start];
+        for (uint32_t i = 0; i < m->stat.vertex_count; i++) {
+            if (!InUnitRange(verts[i].texcoord.x, verts[i].texcoord.y)) return 0;
+        }
+        return 1;
+    }
+    if (m->type == 2) {
+        const MD2UV_t* uvs = &g_md2_uv_pool[m->anim.uv_start];
+        for (uint32_t i = 0; i < m->anim.uv_count; i++) {
+            if (!InUnitRange(uvs[i].u, uvs[i].v)) return 0;
+        }
+        return 1;
+    }
+    return 0;
+}
+
+int TexAtlas_RemapMesh(uint32_t mesh_id, const TexAtlasEntry_t* entry)
+{
+    if (!TexAtlas_CanRemap(mesh_id)) return 0;
+    MeshSlot_t* m = Mesh_Get(mesh_id);
+
+    if (m->type == 1) {
+        Vertex_t* verts = &g_vertex_pool[m->stat.vertex_start];
+        for (uint32_t i = 0; i < m->stat.vertex_count; i++) {
+            verts[i].texcoord.x = verts[i].texcoord.x * entry->u_scale + entry->u_offset;
+            verts[i].texcoord.y = verts[i].texcoord.y * entry->v_scale + entry->v_offset;
+        }
+        if (m->flags & MESH_FLAG_PACKED) {
+            m->flags &= ~MESH_FLAG_PACKED;
+            Mesh_PackStatic(mesh_id);
+        }
+        return 1;
+    }
+
+    MD2UV_t* uvs = &g_md2_uv_pool[m->anim.uv_start];
+    for (uint32_t i = 0; i < m->anim.uv_count; i++) {
+        uvs[i].u = uvs[i].u * entry->u_scale + entry->u_offset;
+        uvs[i].v = uvs[i].v * entry->v_scale + entry->v_offset;
+    }
+    return 1;
+}
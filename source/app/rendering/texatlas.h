@@ -0,0 +1,65 @@
+/**
+ * @file texatlas.h
+ * @brief Texture Atlas Pages For Small Textures - NO MALLOC
+ *
+ * Props with their own 32x32 or 64x64 texture each take a slot of
+ * MAX_TEXTURES, a block of g_pixel_pool and an entry of the texture
+ * cache, and every switch between them ends a render queue batch.
+ * TexAtlas_Build() copies such textures into shared RGB565 pages (the
+ * smallest power-of-two square that holds them, up to
+ * TEXATLAS_PAGE_SIZE, shelf-packed tallest first) and reports where
+ * each one went; TexAtlas_RemapMesh() then moves a mesh's UVs into its
+ * texture's rectangle, after which the caller points its materials at
+ * the page and frees the sources with Texture_Free().
+ * Resource_AtlasMaterials() (resource.h) does all of it for the
+ * materials of the scene's mesh renderers.
+ *
+ * Atlased UVs cannot wrap: meshes with UVs outside [0, 1] are refused.
+ * Rectangles are inset by half a texel so that bilinear filtering stays
+ * inside. Pages have no mip chain: the rectangles are packed without
+ * gutters, so any coarser level would blend neighbouring sources, and
+ * the small sources gain little from one. Indexed sources are expanded
+ * to RGB565.
+ */
+
+#ifndef TEXATLAS_H
+#define TEXATLAS_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define TEXATLAS_PAGE_SIZE      256     /* Largest page side */
+#define TEXATLAS_MIN_PAGE       32      /* Smallest page side tried */
+#define TEXATLAS_MAX_ENTRY      64      /* Sources up to this per side are packed */
+#define TEXATLAS_MAX_SOURCES    64
+
+/* Where a source ended up: uv' = uv * scale + offset on page texture_id.
+ * Sources left alone keep their own id and the identity transform. */
+typedef struct {
+    uint32_t texture_id;
+    float u_scale, v_scale;
+    float u_offset, v_offset;
+} TexAtlasEntry_t;
+
+/* Packs the qualifying textures of the list (loaded, at most
+ * TEXATLAS_MAX_ENTRY per side) into new pages; out[i] describes
+ * textures[i]. A page is only made for two sources or more. Returns the
+ * number of pages created; the sources stay loaded. */
+uint32_t TexAtlas_Build(const uint32_t* textures, uint32_t count, TexAtlasEntry_t* out);
+
+/* 1 if TexAtlas_RemapMesh() would take the mesh */
+int TexAtlas_CanRemap(uint32_t mesh_id);
+
+/* Moves the UVs of a static or MD2 pool mesh into the entry's rectangle
+ * (a packed static mesh is re-packed). 0, mesh untouched, for baked
+ * meshes and UVs outside [0, 1]. Apply once per mesh. */
+int TexAtlas_RemapMesh(uint32_t mesh_id, const TexAtlasEntry_t* entry);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TEXATLAS_H */
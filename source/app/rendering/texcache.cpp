@@ -0,0 +1,310 @@
+/**
+ * @file texcache.cpp
+ * @brief Hot Texture Residency In Fast SRAM Implementation
+ */
+
+#include "texcache.h"
+#include "texture.h"
+#include "pool.h"
+#include "dcache.h"
+#include <string.h>
+
+#ifndef SDL_PC
+#include "stm32h7xx.h"
+#endif
+
+/* Allocation unit: one 32-byte cache line, so no two copies share a line
+ * and the post-copy invalidate cannot hit a neighbour */
+#define LINE_PIXELS     16
+
+/* Entry states */
+#define ENTRY_EMPTY     0
+#define ENTRY_QUEUED    1   /* Space reserved, copy not started */
+#define ENTRY_COPYING   2
+#define ENTRY_RESIDENT  3
+
+typedef struct {
+    uint32_t texture_id;
+    uint32_t start;             /* Offset into g_cache_pixels */
+    uint32_t count;             /* Reserved texels, whole lines */
+    uint32_t last_used;         /* Frame of the last request or bind */
+    uint8_t state;
+} CacheEntry_t;
+
+PLACE_TEXTURE_CACHE CACHE_ALIGNED static uint16_t g_cache_pixels[TEXCACHE_PIXELS];
+
+static Pool_t g_cache_alloc;
+static CacheEntry_t g_entries[TEXCACHE_MAX_ENTRIES];
+static CacheEntry_t* g_copying = NULL;
+static uint32_t g_frame = 1;
+static TexCacheStats_t g_cache_stats;
+
+/* ============================================================
+ * Copy Engine
+ * ============================================================ */
+
+#ifdef SDL_PC
+
+static void CopyInit(void)
+{
+}
+
+static void CopyBegin(uint16_t* dst, const uint16_t* src, uint32_t bytes)
+{
+    memcpy(dst, src, bytes);
+}
+
+/* 1 done, 0 busy, -1 failed */
+static int CopyPoll(void)
+{
+    return 1;
+}
+
+#else
+
+/* BNDT is 17 bits; larger copies go out as consecutive blocks */
+#define DMA_CHUNK_BYTES     32768
+
+static uint8_t* g_dma_dst;
+static const uint8_t* g_dma_src;
+static uint32_t g_dma_left;
+static uint16_t* g_dma_base;
+static uint32_t g_dma_bytes;
+
+static void StartChunk(void)
+{
+    uint32_t bytes = (g_dma_left < DMA_CHUNK_BYTES) ? g_dma_left : DMA_CHUNK_BYTES;
+    MDMA_Channel_TypeDef* ch = MDMA_Channel0;
+
+    ch->CCR = 0;
+    ch->CIFCR = MDMA_CIFCR_CTEIF | MDMA_CIFCR_CCTCIF | MDMA_CIFCR_CBRTIF | MDMA_CIFCR_CBTIF | MDMA_CIFCR_CLTCIF;
+    /* Word-wide incrementing memory copy, one software-triggered block */
+    ch->CTCR = MDMA_CTCR_SWRM | MDMA_CTCR_TRGM_0 | (127u << MDMA_CTCR_TLEN_Pos) |
+        MDMA_CTCR_SINC_1 | MDMA_CTCR_DINC_1 | MDMA_CTCR_SSIZE_1 | MDMA_CTCR_DSIZE_1 |
+        MDMA_CTCR_SINCOS_1 | MDMA_CTCR_DINCOS_1;
+    ch->CBNDTR = bytes;
+    ch->CSAR = (uint32_t)g_dma_src;
+    ch->CDAR = (uint32_t)g_dma_dst;
+    ch->CBRUR = 0;
+    ch->CLAR = 0;
+    ch->CTBR = 0;                                   /* Both sides on AXI */
+    ch->CCR = MDMA_CCR_PL_0 | MDMA_CCR_EN;          /* Below display traffic */
+    ch->CCR |= MDMA_CCR_SWRQ;
+
+    g_dma_src += bytes;
+    g_dma_dst += bytes;
+    g_dma_left -= bytes;
+}
+
+static void CopyInit(void)
+{
+    RCC->AHB3ENR |= RCC_AHB3ENR_MDMAEN;
+}
+
+static void CopyBegin(uint16_t* dst, const uint16_t* src, uint32_t bytes)
+{
+    /* MDMA reads memory, not the D-cache: texels written at load time
+     * may still be dirty, and so may the slot's old contents, which
+     * would otherwise be evicted on top of the copy */
+    DCache_Clean(src, bytes);
+    DCache_CleanInvalidate(dst, bytes);
+
+    g_dma_base = dst;
+    g_dma_bytes = bytes;
+    g_dma_dst = (uint8_t*)dst;
+    g_dma_src = (const uint8_t*)src;
+    g_dma_left = bytes;
+    StartChunk();
+}
+
+static int CopyPoll(void)
+{
+    uint32_t isr = MDMA_Channel0->CISR;
+    if (isr & MDMA_CISR_TEIF) {
+        MDMA_Channel0->CCR = 0;
+        return -1;
+    }
+    if (!(isr & MDMA_CISR_CTCIF)) return 0;
+    if (g_dma_left) {
+        StartChunk();
+        return 0;
+    }
+    MDMA_Channel0->CIFCR = MDMA_CIFCR_CCTCIF;
+
+    /* Lines the CPU may have speculatively fetched during the copy */
+    DCache_Invalidate(g_dma_base, g_dma_bytes);
+    return 1;
+}
+
+#endif
+
+/* ============================================================
+ * Residency
+ * ============================================================ */
+
+static void ReleaseEntry(CacheEntry_t* e)
+{
+    Pool_Free(&g_cache_alloc, e->start, e->count);
+    e->state = ENTRY_EMPTY;
+}
+
+static void StartCopy(CacheEntry_t* e)
+{
+    const uint16_t* src = Texture_GetPixels(e->texture_id);
+    if (!src) {
+        ReleaseEntry(e);
+        return;
+    }
+    e->state = ENTRY_COPYING;
+    g_copying = e;
+    CopyBegin(&g_cache_pixels[e->start], src, Texture_GetPixelCount(e->texture_id) * sizeof(uint16_t));
+}
+
+/* Retire the copy in flight and start the next queued one */
+static void Pump(void)
+{
+    if (g_copying) {
+        int status = CopyPoll();
+        if (status == 0) return;
+
+        CacheEntry_t* e = g_copying;
+        g_copying = NULL;
+        if (status > 0) {
+            e->state = ENTRY_RESIDENT;
+            g_cache_stats.bytes_copied += Texture_GetPixelCount(e->texture_id) * sizeof(uint16_t);
+        }
+        else {
+            ReleaseEntry(e);
+        }
+    }
+
+    for (uint32_t i = 0; i < TEXCACHE_MAX_ENTRIES; i++) {
+        if (g_entries[i].state == ENTRY_QUEUED) {
+            StartCopy(&g_entries[i]);
+            if (g_copying) return;
+        }
+    }
+}
+
+static CacheEntry_t* FindEntry(uint32_t texture_id)
+{
+    for (uint32_t i = 0; i < TEXCACHE_MAX_ENTRIES; i++) {
+        if (g_entries[i].state != ENTRY_EMPTY && g_entries[i].texture_id == texture_id) return &g_entries[i];
+    }
+    return NULL;
+}
+
+static CacheEntry_t* FreeEntry(void)
+{
+    for (uint32_t i = 0; i < TEXCACHE_MAX_ENTRIES; i++) {
+        if (g_entries[i].state == ENTRY_EMPTY) return &g_entries[i];
+    }
+    return NULL;
+}
+
+/* Drop the least recently used resident texture not needed this frame */
+static int EvictOne(void)
+{
+    CacheEntry_t* victim = NULL;
+    for (uint32_t i = 0; i < TEXCACHE_MAX_ENTRIES; i++) {
+        CacheEntry_t* e = &g_entries[i];
+        if (e->state != ENTRY_RESIDENT || e->last_used >= g_frame) continue;
+        if (!victim || e->last_used < victim->last_used) victim = e;
+    }
+    if (!victim) return 0;
+    ReleaseEntry(victim);
+    g_cache_stats.evictions++;
+    return 1;
+}
+
+void TexCache_Init(void)
+{
+    memset(g_entries, 0, sizeof(g_entries));
+    memset(&g_cache_stats, 0, sizeof(g_cache_stats));
+    Pool_Init(&g_cache_alloc, TEXCACHE_PIXELS);
+    g_copying = NULL;
+    g_frame = 1;
+    CopyInit();
+}
+
+void TexCache_BeginFrame(void)
+{
+    g_frame++;
+    Pump();
+}
+
+void TexCache_Request(uint32_t texture_id)
+{
+    CacheEntry_t* e = FindEntry(texture_id);
+    if (e) {
+        e->last_used = g_frame;
+        Pump();
+        return;
+    }
+
+    uint32_t count = Texture_GetPixelCount(texture_id);
+    count = (count + LINE_PIXELS - 1) & ~(uint32_t)(LINE_PIXELS - 1);
+    if (count == 0 || count > TEXCACHE_PIXELS) return;
+
+    e = FreeEntry();
+    if (!e) {
+        if (!EvictOne()) return;
+        e = FreeEntry();
+    }
+
+    uint32_t start;
+    while ((start = Pool_Alloc(&g_cache_alloc, count)) == 0xFFFFFFFF) {
+        if (!EvictOne()) return;
+    }
+
+    e->texture_id = texture_id;
+    e->start = start;
+    e->count = count;
+    e->last_used = g_frame;
+    e->state = ENTRY_QUEUED;
+    g_cache_stats.loads++;
+    Pump();
+}
+
+int TexCache_GetRaster(uint32_t texture_id, Texture_t* out)
+{
+    if (!Texture_GetRaster(texture_id, out)) return 0;
+    Pump();
+
+    CacheEntry_t* e = FindEntry(texture_id);
+    if (e && e->state == ENTRY_RESIDENT) {
+        e->last_used = g_frame;
+        uint16_t* copy = &g_cache_pixels[e->start];
+        if (out->palette) out->palette = copy + (out->palette - out->pixels);
+        out->pixels = copy;
+        g_cache_stats.hits++;
+    }
+    else {
+        g_cache_stats.misses++;
+    }
+    return 1;
+}
+
+void TexCache_Sync(uint32_t texture_id)
+{
+    CacheEntry_t* e = FindEntry(texture_id);
+    while (e && e->state == ENTRY_COPYING) Pump();
+}
+
+void TexCache_Drop(uint32_t texture_id)
+{
+    TexCache_Sync(texture_id);
+    CacheEntry_t* e = FindEntry(texture_id);
+    if (e) ReleaseEntry(e);
+}
+
+void TexCache_GetStats(TexCacheStats_t* stats)
+{
+    *stats = g_cache_stats;
+}
+
+uint32_t TexCache_GetMemPools(MemPool_t* out, uint32_t max)
+{
+    uint32_t used = (TEXCACHE_PIXELS - Pool_GetFree(&g_cache_alloc)) * sizeof(uint16_t);
+    return MemMap_Add(out, 0, max, "texture cache", g_cache_pixels, sizeof(g_cache_pixels), used);
+}
@@ -0,0 +1,72 @@
+/**
+ * @file texcache.h
+ * @brief Hot Texture Residency In Fast SRAM - NO MALLOC
+ *
+ * g_pixel_pool lives in SDRAM. This keeps copies of the textures the
+ * frame actually samples in a fixed TEXCACHE_PIXELS budget of
+ * PLACE_TEXTURE_CACHE memory (AXI SRAM on the STM32). A whole mip chain
+ * is copied by MDMA channel 0 in the background once the render queue
+ * hints at it with TexCache_Request(); TexCache_GetRaster() hands out
+ * the resident copy when it is complete and the SDRAM original until
+ * then, so callers never wait on a copy.
+ *
+ * Eviction is least recently used and only touches textures not used
+ * in the current frame: binned triangles keep pointing at the copy
+ * until Rasterizer_Flush(), which is before TexCache_BeginFrame() runs
+ * again. On SDL_PC the copy is a synchronous memcpy.
+ */
+
+#ifndef TEXCACHE_H
+#define TEXCACHE_H
+
+#include <stdint.h>
+#include "engine_config.h"
+#include "rasterizer.h"
+#include "memmap.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Budget in RGB565 texels; fits one 256x256 skin with its full chain */
+#ifndef TEXCACHE_PIXELS
+#define TEXCACHE_PIXELS         (96 * 1024)
+#endif
+#define TEXCACHE_MAX_ENTRIES    16
+
+typedef struct {
+    uint32_t hits;              /* TexCache_GetRaster() served from the cache */
+    uint32_t misses;            /* ... served from SDRAM */
+    uint32_t loads;             /* Copies started */
+    uint32_t evictions;
+    uint32_t bytes_copied;
+} TexCacheStats_t;
+
+void TexCache_Init(void);
+
+/* Once per frame, before the render queue is built. Textures used
+ * in earlier frames become eligible for eviction. */
+void TexCache_BeginFrame(void);
+
+/* Hint that texture id is sampled this frame: marks it used and, if not
+ * resident yet, starts copying it when space can be made */
+void TexCache_Request(uint32_t texture_id);
+
+/* Texture_GetRaster() that prefers the resident copy */
+int TexCache_GetRaster(uint32_t texture_id, Texture_t* out);
+
+/* Wait for a copy of texture id in flight; Texture_Compact() calls it
+ * before moving the source. A finished copy stays valid. */
+void TexCache_Sync(uint32_t texture_id);
+
+/* Forget texture id; called by Texture_Free() */
+void TexCache_Drop(uint32_t texture_id);
+
+void TexCache_GetStats(TexCacheStats_t* stats);
+uint32_t TexCache_GetMemPools(MemPool_t* out, uint32_t max);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TEXCACHE_H */
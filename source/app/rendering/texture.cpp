@@ -5,6 +5,8 @@
 
 #include "texture.h"
 #include "platform.h"
+#include "pool.h"
+#include "texcache.h"
 #include <string.h>
 #include "engine_config.h"
 
@@ -12,15 +14,20 @@
   * Static Memory Pools
   * ============================================================ */
 
-#ifdef SDL_PC
-uint16_t g_pixel_pool[MAX_TEXTURE_PIXELS];
-#else
-uint16_t g_pixel_pool[MAX_TEXTURE_PIXELS] SECTION_SDRAM;
-#endif
+PLACE_TEXTURE_POOL uint16_t g_pixel_pool[MAX_TEXTURE_PIXELS];
 
-static uint32_t g_pixel_used = 0;
+static Pool_t g_pixel_alloc;
 static TextureSlot_t g_textures[MAX_TEXTURES];
 
+/* Per slot: the file it was loaded from and its holders past the first */
+typedef struct {
+    uint64_t hash;
+    uint32_t size;              /* 0 = no source file */
+    uint16_t extra_refs;        /* TEXTURE_MAX_REFS - 1 = saturated */
+} TextureSource_t;
+
+static TextureSource_t g_texture_sources[MAX_TEXTURES];
+
 /* ============================================================
  * Initialization
  * ============================================================ */
@@ -28,7 +35,8 @@ static TextureSlot_t g_textures[MAX_TEXTURES];
 void Texture_Init(void)
 {
     memset(g_textures, 0, sizeof(g_textures));
-    g_pixel_used = 0;
+    memset(g_texture_sources, 0, sizeof(g_texture_sources));
+    Pool_Init(&g_pixel_alloc, MAX_TEXTURE_PIXELS);
 }
 
 /* ============================================================
@@ -45,51 +53,96 @@ static uint32_t AllocTextureSlot(void)
 
 static uint32_t AllocPixels(uint32_t count)
 {
-    if (g_pixel_used + count > MAX_TEXTURE_PIXELS) return 0xFFFFFFFF;
-    uint32_t start = g_pixel_used;
-    g_pixel_used += count;
-    return start;
+    return Pool_Alloc(&g_pixel_alloc, count);
+}
+
+static uint32_t MipLevels(uint16_t w, uint16_t h, uint8_t flags)
+{
+    if (!(flags & TEXTURE_FLAG_MIPMAP) || (w & (w - 1)) || (h & (h - 1))) return 1;
+    uint32_t levels = 1;
+    while (w > 1 && h > 1 && levels < TEXTURE_MAX_LEVELS) {
+        w >>= 1; h >>= 1;
+        levels++;
+    }
+    return levels;
+}
+
+static uint32_t Log2(uint32_t n)
+{
+    uint32_t shift = 0;
+    while ((2u << shift) <= n) shift++;
+    return shift;
+}
+
+/* Words of the base level plus its mip chain */
+static uint32_t ChainWords(const TextureSlot_t* tex)
+{
+    uint32_t count = 0;
+    for (uint32_t k = 0; k < tex->levels; k++) {
+        count += Texture_LevelWords(tex->width >> k, tex->height >> k, tex->format);
+    }
+    return count;
+}
+
+/* Whole allocation of a texture: mip chain plus palette */
+static uint32_t SlotPixels(const TextureSlot_t* tex)
+{
+    return ChainWords(tex) + Texture_PaletteWords(tex->format);
+}
+
+/* Start of the allocation, pool or baked image */
+static inline uint16_t* SlotData(const TextureSlot_t* tex)
+{
+    return (tex->flags & TEXTURE_FLAG_BAKED) ? (uint16_t*)tex->image : &g_pixel_pool[tex->pixel_start];
 }
 
 /* ============================================================
  * Texture Creation
  * ============================================================ */
 
-uint32_t Texture_CreateSolid(uint16_t color, uint16_t w, uint16_t h)
+uint32_t Texture_Create(uint16_t w, uint16_t h, uint8_t format, uint8_t flags)
 {
     uint32_t slot = AllocTextureSlot();
     if (slot == 0xFFFFFFFF) return 0xFFFFFFFF;
 
-    uint32_t pixel_count = w * h;
-    uint32_t pixel_start = AllocPixels(pixel_count);
+    TextureSlot_t* tex = &g_textures[slot];
+    tex->width = w;
+    tex->height = h;
+    tex->width_mask = w - 1;
+    tex->height_mask = h - 1;
+    tex->format = format;
+    tex->levels = (uint8_t)MipLevels(w, h, flags);
+    tex->flags = (tex->levels > 1) ? flags : (uint8_t)(flags & ~TEXTURE_FLAG_MIPMAP);
+
+    uint32_t pixel_start = AllocPixels(SlotPixels(tex));
     if (pixel_start == 0xFFFFFFFF) return 0xFFFFFFFF;
 
-    uint16_t* pixels = &g_pixel_pool[pixel_start];
+    tex->pixel_start = pixel_start;
+    tex->image = NULL;
+    tex->in_use = 1;
+    return slot;
+}
+
+uint32_t Texture_CreateSolid(uint16_t color, uint16_t w, uint16_t h)
+{
+    uint32_t slot = Texture_Create(w, h, TEXTURE_FORMAT_RGB565, 0);
+    if (slot == 0xFFFFFFFF) return 0xFFFFFFFF;
+
+    uint16_t* pixels = &g_pixel_pool[g_textures[slot].pixel_start];
+    uint32_t pixel_count = w * h;
     for (uint32_t i = 0; i < pixel_count; i++) {
         pixels[i] = color;
     }
 
-    g_textures[slot].pixel_start = pixel_start;
-    g_textures[slot].width = w;
-    g_textures[slot].height = h;
-    g_textures[slot].width_mask = w - 1;
-    g_textures[slot].height_mask = h - 1;
-    g_textures[slot].in_use = 1;
-    g_textures[slot].flags = 0;
-
     return slot;
 }
 
 uint32_t Texture_CreateCheckerboard(uint16_t c1, uint16_t c2, uint16_t size)
 {
-    uint32_t slot = AllocTextureSlot();
+    uint32_t slot = Texture_Create(size, size, TEXTURE_FORMAT_RGB565, TEXTURE_FLAG_MIPMAP);
     if (slot == 0xFFFFFFFF) return 0xFFFFFFFF;
 
-    uint32_t pixel_count = size * size;
-    uint32_t pixel_start = AllocPixels(pixel_count);
-    if (pixel_start == 0xFFFFFFFF) return 0xFFFFFFFF;
-
-    uint16_t* pixels = &g_pixel_pool[pixel_start];
+    uint16_t* pixels = &g_pixel_pool[g_textures[slot].pixel_start];
     int check = size / 8;
     if (check < 1) check = 1;
 
@@ -100,14 +153,239 @@ uint32_t Texture_CreateCheckerboard(uint16_t c1, uint16_t c2, uint16_t size)
         }
     }
 
-    g_textures[slot].pixel_start = pixel_start;
-    g_textures[slot].width = size;
-    g_textures[slot].height = size;
-    g_textures[slot].width_mask = size - 1;
-    g_textures[slot].height_mask = size - 1;
-    g_textures[slot].in_use = 1;
-    g_textures[slot].flags = 0;
+    Texture_BuildMips(slot);
+    Texture_Tile(slot);
+    return slot;
+}
+
+/* ============================================================
+ * Mip Chain
+ * ============================================================ */
+
+/* Rounded per-channel average of a 2x2 RGB565 quad */
+static inline uint16_t Average565(uint16_t a, uint16_t b, uint16_t c, uint16_t d)
+{
+    uint32_t r = (((a >> 11) & 0x1F) + ((b >> 11) & 0x1F) + ((c >> 11) & 0x1F) + ((d >> 11) & 0x1F) + 2) >> 2;
+    uint32_t g = (((a >> 5) & 0x3F) + ((b >> 5) & 0x3F) + ((c >> 5) & 0x3F) + ((d >> 5) & 0x3F) + 2) >> 2;
+    uint32_t bl = ((a & 0x1F) + (b & 0x1F) + (c & 0x1F) + (d & 0x1F) + 2) >> 2;
+    return (uint16_t)((r << 11) | (g << 5) | bl);
+}
+
+static inline int ColorDistance(uint16_t a, uint16_t b)
+{
+    /* Channels scaled to 6 bits */
+    int dr = (int)((a >> 10) & 0x3E) - (int)((b >> 10) & 0x3E);
+    int dg = (int)((a >> 5) & 0x3F) - (int)((b >> 5) & 0x3F);
+    int db = (int)((a << 1) & 0x3E) - (int)((b << 1) & 0x3E);
+    return dr * dr + dg * dg + db * db;
+}
+
+static uint32_t NearestIndex(const uint16_t* palette, uint32_t entries, uint16_t color)
+{
+    uint32_t best = 0;
+    int best_d = ColorDistance(palette[0], color);
+    for (uint32_t i = 1; i < entries && best_d; i++) {
+        int d = ColorDistance(palette[i], color);
+        if (d < best_d) { best_d = d; best = i; }
+    }
+    return best;
+}
+
+/* Mip chain of a row-major allocation at data */
+static void BuildChain(const TextureSlot_t* tex, uint16_t* data, const uint16_t* palette)
+{
+    int format = tex->format;
+    uint16_t* src = data;
+    uint32_t sw = tex->width, sh = tex->height;
+    for (uint32_t k = 1; k < tex->levels; k++) {
+        uint16_t* dst = src + Texture_LevelWords(sw, sh, format);
+        uint32_t dw = sw >> 1, dh = sh >> 1;
+        for (uint32_t y = 0; y < dh; y++) {
+            uint32_t r0 = (y * 2) * sw;
+            uint32_t r1 = r0 + sw;
+            for (uint32_t x = 0; x < dw; x++) {
+                uint16_t c = Average565(
+                    Texture_Fetch(src, palette, r0 + x * 2, format), Texture_Fetch(src, palette, r0 + x * 2 + 1, format),
+                    Texture_Fetch(src, palette, r1 + x * 2, format), Texture_Fetch(src, palette, r1 + x * 2 + 1, format));
+                uint32_t value = (format == TEXTURE_FORMAT_RGB565) ? c :
+                    NearestIndex(palette, Texture_PaletteWords(format), c);
+                Texture_StoreRaw(dst, y * dw + x, value, format);
+            }
+        }
+        src = dst;
+        sw = dw; sh = dh;
+    }
+}
+
+void Texture_BuildMips(uint32_t id)
+{
+    TextureSlot_t* tex = Texture_Get(id);
+    if (!tex || (tex->flags & (TEXTURE_FLAG_TILED | TEXTURE_FLAG_BAKED))) return;
+    BuildChain(tex, &g_pixel_pool[tex->pixel_start], Texture_GetPalette(id));
+}
+
+/* ============================================================
+ * Tiled Layout
+ * ============================================================ */
+
+/* One row of blocks of the widest texture Texture_LoadBMP accepts */
+LOADER_SCRATCH static uint16_t g_tile_scratch[TEXTURE_TILE * 1024];
+
+/* A block row covers the same TEXTURE_TILE source rows, so it is
+ * reordered in place through the scratch copy */
+static void TileLevel(uint16_t* pixels, uint32_t w, uint32_t h, int format)
+{
+    for (uint32_t by = 0; by < h; by += TEXTURE_TILE) {
+        uint32_t row = by * w;
+        for (uint32_t i = 0; i < TEXTURE_TILE * w; i++) {
+            g_tile_scratch[i] = (uint16_t)Texture_FetchRaw(pixels, row + i, format);
+        }
+        for (uint32_t y = 0; y < TEXTURE_TILE; y++) {
+            for (uint32_t x = 0; x < w; x++) {
+                Texture_StoreRaw(pixels, row + Texture_TexelOffset(x, y, w, 1), g_tile_scratch[y * w + x], format);
+            }
+        }
+    }
+}
+
+/* Tiles every level of a row-major allocation at pixels; 0 for sizes
+ * that cannot be tiled */
+static int TileChain(const TextureSlot_t* tex, uint16_t* pixels)
+{
+    uint32_t w = tex->width, h = tex->height;
+    if ((w & (w - 1)) || (h & (h - 1)) || w < TEXTURE_TILE || h < TEXTURE_TILE ||
+        w > sizeof(g_tile_scratch) / sizeof(g_tile_scratch[0]) / TEXTURE_TILE) return 0;
+
+    for (uint32_t k = 0; k < tex->levels && w >= TEXTURE_TILE && h >= TEXTURE_TILE; k++) {
+        TileLevel(pixels, w, h, tex->format);
+        pixels += Texture_LevelWords(w, h, tex->format);
+        w >>= 1; h >>= 1;
+    }
+    return 1;
+}
 
+void Texture_Tile(uint32_t id)
+{
+    TextureSlot_t* tex = Texture_Get(id);
+    if (!tex || (tex->flags & (TEXTURE_FLAG_TILED | TEXTURE_FLAG_BAKED))) return;
+    if (TileChain(tex, &g_pixel_pool[tex->pixel_start])) tex->flags |= TEXTURE_FLAG_TILED;
+}
+
+/* ============================================================
+ * Staged Textures
+ * ============================================================ */
+
+/* Slot as Texture_Create() would describe the staged texture */
+static TextureSlot_t StagedSlot(const TextureStaging_t* st)
+{
+    TextureSlot_t probe;
+    memset(&probe, 0, sizeof(probe));
+    probe.width = st->width;
+    probe.height = st->height;
+    probe.format = st->format;
+    probe.levels = st->levels;
+    return probe;
+}
+
+void Texture_StagingLayout(TextureStaging_t* st)
+{
+    st->levels = (uint8_t)MipLevels(st->width, st->height, st->flags);
+    if (st->levels == 1) st->flags &= (uint8_t)~TEXTURE_FLAG_MIPMAP;
+    TextureSlot_t probe = StagedSlot(st);
+    st->palette = ChainWords(&probe);
+    st->words = SlotPixels(&probe);
+}
+
+void Texture_FinishStaged(TextureStaging_t* st)
+{
+    TextureSlot_t probe = StagedSlot(st);
+    const uint16_t* palette = (st->format == TEXTURE_FORMAT_RGB565) ? NULL : st->data + st->palette;
+    BuildChain(&probe, st->data, palette);
+    if (TileChain(&probe, st->data)) st->flags |= TEXTURE_FLAG_TILED;
+}
+
+uint32_t Texture_CommitStaged(const TextureStaging_t* st)
+{
+    uint32_t shared = Texture_FindSource(st->source_hash, st->source_size);
+    if (shared != 0xFFFFFFFF) return shared;
+
+    uint32_t slot = Texture_Create(st->width, st->height, st->format, (uint8_t)(st->flags & TEXTURE_FLAG_MIPMAP));
+    if (slot == 0xFFFFFFFF) return 0xFFFFFFFF;
+
+    TextureSlot_t* tex = &g_textures[slot];
+    if (SlotPixels(tex) != st->words) {
+        Texture_Free(slot);
+        return 0xFFFFFFFF;
+    }
+    memcpy(SlotData(tex), st->data, st->words * sizeof(uint16_t));
+    tex->flags |= (uint8_t)(st->flags & TEXTURE_FLAG_TILED);
+    Texture_SetSource(slot, st->source_hash, st->source_size);
+    return slot;
+}
+
+/* ============================================================
+ * Baked Images
+ * ============================================================ */
+
+uint32_t Texture_Bake(uint32_t id, void* out, uint32_t max)
+{
+    TextureSlot_t* tex = Texture_Get(id);
+    if (!tex) return 0;
+
+    TextureBakedHeader_t h;
+    memset(&h, 0, sizeof(h));
+    h.magic = TEXTURE_BAKED_MAGIC;
+    h.version = TEXTURE_BAKED_VERSION;
+    h.format = tex->format;
+    h.flags = tex->flags & (TEXTURE_FLAG_MIPMAP | TEXTURE_FLAG_TILED);
+    h.width = tex->width;
+    h.height = tex->height;
+    h.levels = tex->levels;
+    h.data_offset = (sizeof(h) + TEXTURE_BAKED_ALIGN - 1) & ~(uint32_t)(TEXTURE_BAKED_ALIGN - 1);
+    h.data_words = SlotPixels(tex);
+    h.image_size = h.data_offset + h.data_words * sizeof(uint16_t);
+
+    if (!out) return h.image_size;
+    if (h.image_size > max) return 0;
+
+    uint8_t* dst = (uint8_t*)out;
+    memset(dst, 0, h.data_offset);
+    memcpy(dst, &h, sizeof(h));
+    memcpy(dst + h.data_offset, SlotData(tex), h.data_words * sizeof(uint16_t));
+    return h.image_size;
+}
+
+uint32_t Texture_LoadBaked(const void* image, uint32_t size)
+{
+    if (!image || size < sizeof(TextureBakedHeader_t) || ((uintptr_t)image & 3)) return 0xFFFFFFFF;
+
+    const TextureBakedHeader_t* h = (const TextureBakedHeader_t*)image;
+    if (h->magic != TEXTURE_BAKED_MAGIC || h->version != TEXTURE_BAKED_VERSION) return 0xFFFFFFFF;
+    if (h->format > TEXTURE_FORMAT_INDEXED4 || h->width == 0 || h->height == 0) return 0xFFFFFFFF;
+    if (h->image_size > size || (h->data_offset & 3) || h->data_offset < sizeof(*h)) return 0xFFFFFFFF;
+
+    /* Same chain Texture_Create() would have allocated */
+    TextureSlot_t probe;
+    memset(&probe, 0, sizeof(probe));
+    probe.width = h->width;
+    probe.height = h->height;
+    probe.format = h->format;
+    probe.levels = h->levels;
+    if (h->levels == 0 || h->levels > MipLevels(h->width, h->height, TEXTURE_FLAG_MIPMAP)) return 0xFFFFFFFF;
+    if (h->data_words != SlotPixels(&probe) ||
+        h->data_offset + h->data_words * sizeof(uint16_t) > h->image_size) return 0xFFFFFFFF;
+
+    uint32_t slot = AllocTextureSlot();
+    if (slot == 0xFFFFFFFF) return 0xFFFFFFFF;
+
+    TextureSlot_t* tex = &g_textures[slot];
+    *tex = probe;
+    tex->width_mask = h->width - 1;
+    tex->height_mask = h->height - 1;
+    tex->flags = (uint8_t)((h->flags & (TEXTURE_FLAG_MIPMAP | TEXTURE_FLAG_TILED)) | TEXTURE_FLAG_BAKED);
+    tex->pixel_start = 0;
+    tex->image = (const uint16_t*)((const uint8_t*)image + h->data_offset);
+    tex->in_use = 1;
     return slot;
 }
 
@@ -121,10 +399,41 @@ TextureSlot_t* Texture_Get(uint32_t id)
     return &g_textures[id];
 }
 
+int Texture_GetRaster(uint32_t id, Texture_t* out)
+{
+    TextureSlot_t* t = Texture_Get(id);
+    if (!t) return 0;
+    out->width = t->width;
+    out->height = t->height;
+    out->width_mask = t->width_mask;
+    out->height_mask = t->height_mask;
+    out->levels = t->levels;
+    out->width_shift = (uint8_t)Log2(t->width);
+    out->height_shift = (uint8_t)Log2(t->height);
+    out->format = t->format;
+    out->palette = Texture_GetPalette(id);
+    out->tiled = (t->flags & TEXTURE_FLAG_TILED) ? 1 : 0;
+    out->pixels = SlotData(t);
+    return 1;
+}
+
 uint16_t* Texture_GetPixels(uint32_t id)
 {
     if (id >= MAX_TEXTURES || !g_textures[id].in_use) return NULL;
-    return &g_pixel_pool[g_textures[id].pixel_start];
+    return SlotData(&g_textures[id]);
+}
+
+uint16_t* Texture_GetPalette(uint32_t id)
+{
+    TextureSlot_t* t = Texture_Get(id);
+    if (!t || t->format == TEXTURE_FORMAT_RGB565) return NULL;
+    return SlotData(t) + ChainWords(t);
+}
+
+uint32_t Texture_GetPixelCount(uint32_t id)
+{
+    TextureSlot_t* t = Texture_Get(id);
+    return t ? SlotPixels(t) : 0;
 }
 
 
@@ -134,24 +443,102 @@ uint16_t Texture_SampleFast(uint32_t id, int u, int v)
     if (id >= MAX_TEXTURES || !g_textures[id].in_use) return 0xF81F;
 
     TextureSlot_t* tex = &g_textures[id];
-    int tx = u & tex->width_mask;
-    int ty = v & tex->height_mask;
+    uint32_t tx = (uint32_t)u & tex->width_mask;
+    uint32_t ty = (uint32_t)v & tex->height_mask;
 
-    return g_pixel_pool[tex->pixel_start + ty * tex->width + tx];
+    return Texture_Fetch(SlotData(tex), Texture_GetPalette(id),
+        Texture_TexelOffset(tx, ty, tex->width, (tex->flags & TEXTURE_FLAG_TILED) != 0), tex->format);
 }
 
 /* ============================================================
  * Cleanup
  * ============================================================ */
 
-void Texture_Free(uint32_t id)
+uint32_t Texture_FindSource(uint64_t hash, uint32_t size)
+{
+    if (size == 0) return 0xFFFFFFFF;
+    for (uint32_t i = 0; i < MAX_TEXTURES; i++) {
+        if (g_textures[i].in_use && g_texture_sources[i].size == size && g_texture_sources[i].hash == hash) {
+            Texture_Retain(i);
+            return i;
+        }
+    }
+    return 0xFFFFFFFF;
+}
+
+void Texture_SetSource(uint32_t id, uint64_t hash, uint32_t size)
 {
     if (id < MAX_TEXTURES) {
-        g_textures[id].in_use = 0;
+        g_texture_sources[id].hash = hash;
+        g_texture_sources[id].size = size;
+    }
+}
+
+void Texture_Retain(uint32_t id)
+{
+    if (id < MAX_TEXTURES && g_textures[id].in_use && g_texture_sources[id].extra_refs < TEXTURE_MAX_REFS - 1) {
+        g_texture_sources[id].extra_refs++;
+    }
+}
+
+uint32_t Texture_GetRefs(uint32_t id)
+{
+    return (id < MAX_TEXTURES && g_textures[id].in_use) ? g_texture_sources[id].extra_refs + 1u : 0;
+}
+
+void Texture_Free(uint32_t id)
+{
+    if (id < MAX_TEXTURES && g_textures[id].in_use) {
+        TextureSource_t* source = &g_texture_sources[id];
+        if (source->extra_refs > 0) {
+            if (source->extra_refs < TEXTURE_MAX_REFS - 1) source->extra_refs--;
+            return;
+        }
+        memset(source, 0, sizeof(*source));
+
+        TextureSlot_t* tex = &g_textures[id];
+        TexCache_Drop(id);
+        if (!(tex->flags & TEXTURE_FLAG_BAKED)) Pool_Free(&g_pixel_alloc, tex->pixel_start, SlotPixels(tex));
+        tex->in_use = 0;
+        tex->flags = 0;
+        tex->image = NULL;
     }
 }
 
 uint32_t Texture_GetFreePixels(void)
 {
-    return MAX_TEXTURE_PIXELS - g_pixel_used;
-}
\ No newline at end of file
+    return Pool_GetFree(&g_pixel_alloc);
+}
+
+uint32_t Texture_Compact(uint32_t max_moves)
+{
+    uint32_t moves = 0;
+    uint32_t hole, block;
+
+    while (moves < max_moves && Pool_FirstGap(&g_pixel_alloc, &hole, &block)) {
+        /* Texture that starts right after the lowest hole */
+        TextureSlot_t* tex = NULL;
+        for (uint32_t i = 0; i < MAX_TEXTURES; i++) {
+            if (g_textures[i].in_use && !(g_textures[i].flags & TEXTURE_FLAG_BAKED) &&
+                g_textures[i].pixel_start == block &&
+                SlotPixels(&g_textures[i]) > 0) {
+                tex = &g_textures[i];
+                break;
+            }
+        }
+        if (!tex) break;
+
+        TexCache_Sync((uint32_t)(tex - g_textures));
+        uint32_t count = SlotPixels(tex);
+        memmove(&g_pixel_pool[hole], &g_pixel_pool[block], count * sizeof(uint16_t));
+        tex->pixel_start = hole;
+        Pool_Move(&g_pixel_alloc, block, hole, count);
+        moves++;
+    }
+    return moves;
+}
+uint32_t Texture_GetMemPools(MemPool_t* out, uint32_t max)
+{
+    uint32_t used = (MAX_TEXTURE_PIXELS - Pool_GetFree(&g_pixel_alloc)) * sizeof(uint16_t);
+    return MemMap_Add(out, 0, max, "texture pixels", g_pixel_pool, sizeof(g_pixel_pool), used);
+}
@@ -6,6 +6,8 @@
 #ifndef TEXTURE_H
 #define TEXTURE_H
 #include "engine_config.h"
+#include "memmap.h"
+#include "rasterizer.h"
 
 #include <stdint.h>
 
@@ -14,14 +16,8 @@ extern "C" {
 #endif
 
 
-/* Pool configuration */
-#define MAX_TEXTURE_PIXELS      (256 * 256 * 4)  /* ~256KB for all textures */
-
-#ifdef SDL_PC
+/* Pool of MAX_TEXTURE_PIXELS words (engine_config.h) */
     extern uint16_t g_pixel_pool[MAX_TEXTURE_PIXELS];
-#else
-    extern uint16_t g_pixel_pool[MAX_TEXTURE_PIXELS] SECTION_SDRAM;
-#endif
 
 /* Texture descriptor */
 typedef struct {
@@ -31,9 +27,67 @@ typedef struct {
     uint16_t width_mask;        /* width - 1 for power-of-2 */
     uint16_t height_mask;
     uint8_t in_use;
-    uint8_t flags;
+    uint8_t flags;              /* TEXTURE_FLAG_* */
+    uint8_t levels;             /* Mip levels, 1 = base only */
+    uint8_t format;             /* TEXTURE_FORMAT_* (rasterizer.h) */
+    const uint16_t* image;      /* TEXTURE_FLAG_BAKED: chain + palette, in place */
 } TextureSlot_t;
 
+/* Reserve a mip chain after the base level (power-of-2 sizes only).
+ * Levels are packed smallest last: level k is (w >> k) x (h >> k),
+ * down to the first level with a side of 1. */
+#define TEXTURE_FLAG_MIPMAP     0x01
+#define TEXTURE_FLAG_TILED      0x02    /* Levels of TEXTURE_TILE or more are block-tiled */
+#define TEXTURE_FLAG_BAKED      0x04    /* Texels live in a baked image, not g_pixel_pool */
+#define TEXTURE_MAX_LEVELS      11      /* 1024 -> 1 */
+
+/* Indexed textures keep their palette right after the mip chain, inside
+ * the same allocation, so moving or copying the allocation keeps both */
+static inline uint32_t Texture_PaletteWords(int format)
+{
+    return (format == TEXTURE_FORMAT_INDEXED8) ? 256 : (format == TEXTURE_FORMAT_INDEXED4) ? 16 : 0;
+}
+
+/* Store a color or palette index as texel i, see Texture_FetchRaw() */
+static inline void Texture_StoreRaw(uint16_t* pixels, uint32_t i, uint32_t value, int format)
+{
+    if (format == TEXTURE_FORMAT_RGB565) {
+        pixels[i] = (uint16_t)value;
+        return;
+    }
+    uint8_t* bytes = (uint8_t*)pixels;
+    if (format == TEXTURE_FORMAT_INDEXED8) {
+        bytes[i] = (uint8_t)value;
+        return;
+    }
+    uint32_t shift = (i & 1) << 2;
+    bytes[i >> 1] = (uint8_t)((bytes[i >> 1] & ~(0xF << shift)) | ((value & 0xF) << shift));
+}
+
+/* Baked texture image: this header, then at data_offset the allocation
+ * exactly as g_pixel_pool holds it (mip chain, tiled, then the palette).
+ * Texture_LoadBaked() points a slot at it with no conversion or copy,
+ * so on the STM32 it can stay in memory-mapped QSPI/OSPI flash. Images
+ * come from Texture_Bake() (the PC build's --cook mode), native
+ * little-endian. */
+#define TEXTURE_BAKED_MAGIC     0x58455442u     /* "BTEX" */
+#define TEXTURE_BAKED_VERSION   1
+#define TEXTURE_BAKED_ALIGN     32
+
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint8_t format;             /* TEXTURE_FORMAT_* */
+    uint8_t flags;              /* TEXTURE_FLAG_MIPMAP | TEXTURE_FLAG_TILED */
+    uint16_t width;
+    uint16_t height;
+    uint8_t levels;
+    uint8_t reserved[3];
+    uint32_t data_offset;       /* From the start of the image, TEXTURE_BAKED_ALIGN aligned */
+    uint32_t data_words;        /* Texture_GetPixelCount() of the source */
+    uint32_t image_size;
+} TextureBakedHeader_t;
+
 /* RGB565 helpers */
 #define RGB565(r,g,b) ((((r)&0xF8)<<8)|(((g)&0xFC)<<3)|((b)>>3))
 
@@ -49,18 +103,102 @@ typedef struct {
 /* API */
 void Texture_Init(void);
 
+/* A file already loaded (same Name_HashData() and size) returns its
+ * slot with one more holder; Texture_CommitStaged() does the same */
 uint32_t Texture_LoadBMP(const void* data, uint32_t size);
 uint32_t Texture_CreateSolid(uint16_t color, uint16_t w, uint16_t h);
 uint32_t Texture_CreateCheckerboard(uint16_t c1, uint16_t c2, uint16_t size);
 
+/* Uninitialized texture; fill level 0 through Texture_GetPixels() (and
+ * the palette through Texture_GetPalette()), then call Texture_BuildMips()
+ * when created with TEXTURE_FLAG_MIPMAP */
+uint32_t Texture_Create(uint16_t w, uint16_t h, uint8_t format, uint8_t flags);
+
+/* A texture decoded outside the pool, on any thread: data is laid out
+ * as Texture_Create() would allocate it, mip chain then palette. */
+typedef struct {
+    uint16_t width;
+    uint16_t height;
+    uint8_t format;             /* TEXTURE_FORMAT_* */
+    uint8_t flags;              /* TEXTURE_FLAG_MIPMAP | TEXTURE_FLAG_TILED */
+    uint8_t levels;
+    uint16_t* data;
+    uint32_t words;             /* Of data */
+    uint32_t palette;           /* Offset of the palette in data */
+    uint64_t source_hash;       /* Of the file, set by the decoders; source_size 0 = none */
+    uint32_t source_size;
+} TextureStaging_t;
+
+/* From width, height, format and flags: sets levels, words and palette */
+void Texture_StagingLayout(TextureStaging_t* st);
+
+/* Texture_BuildMips() and Texture_Tile() on a filled level 0 in data */
+void Texture_FinishStaged(TextureStaging_t* st);
+
+/* Decode into out->data, finished as Texture_LoadBMP() would leave it.
+ * With out->data NULL only the layout is filled, to size the buffer.
+ * Returns 0 if the file is malformed. */
+int Texture_DecodeBMP(const void* data, uint32_t size, TextureStaging_t* out);
+
+/* Pool copy of a staged texture; call on the thread that owns the pool */
+uint32_t Texture_CommitStaged(const TextureStaging_t* st);
+
+/* Serialize a loaded texture. With out == NULL returns the image size;
+ * otherwise the bytes written, 0 if id is not loaded or max is too small. */
+uint32_t Texture_Bake(uint32_t id, void* out, uint32_t max);
+
+/* Texture slot referencing the image in place; it must stay mapped until
+ * Texture_Free() and must not be written through Texture_GetPixels().
+ * The base must be 4-byte aligned. 0xFFFFFFFF if the image is malformed
+ * or from another version. */
+uint32_t Texture_LoadBaked(const void* image, uint32_t size);
+
+/* Box-filter every level from the one above it; row-major textures only.
+ * Indexed levels take the closest palette entry to each average. */
+void Texture_BuildMips(uint32_t id);
+
+/* Reorder a filled row-major texture (all levels) into the tiled layout
+ * and set TEXTURE_FLAG_TILED; no-op for sizes that cannot be tiled */
+void Texture_Tile(uint32_t id);
+
 TextureSlot_t* Texture_Get(uint32_t id);
 uint16_t* Texture_GetPixels(uint32_t id);
 
+/* Palette of an indexed texture, NULL for RGB565 */
+uint16_t* Texture_GetPalette(uint32_t id);
+
+/* Texels of the whole allocation, mip chain included; 0 if not loaded */
+uint32_t Texture_GetPixelCount(uint32_t id);
+
+/* Rasterizer view of a texture; 0 if id is not loaded. Resolve once per
+ * batch: the pixel pointer moves when Texture_Compact() runs. */
+int Texture_GetRaster(uint32_t id, Texture_t* out);
+
+/* Level 0 color; honours TEXTURE_FLAG_TILED and the palette */
 uint16_t Texture_SampleFast(uint32_t id, int u, int v);
 
+/* Source files of loaded textures, for the loaders: the slot holding
+ * one, with one more holder, else 0xFFFFFFFF; and the record a loader
+ * leaves on the slot it filled */
+uint32_t Texture_FindSource(uint64_t hash, uint32_t size);
+void Texture_SetSource(uint32_t id, uint64_t hash, uint32_t size);
+
+/* Holders: a load, commit or create is the first. Texture_Free() drops
+ * one and releases the texels with the last; a count that reaches
+ * TEXTURE_MAX_REFS saturates and the texture stays. */
+#define TEXTURE_MAX_REFS        0x10000
+void Texture_Retain(uint32_t id);
+uint32_t Texture_GetRefs(uint32_t id);
 void Texture_Free(uint32_t id);
 uint32_t Texture_GetFreePixels(void);
 
+/* Slide up to max_moves textures down into free holes; call between
+ * frames. Returns the number moved, 0 once the pixel pool is compact. */
+uint32_t Texture_Compact(uint32_t max_moves);
+
+/* Pixel pool for MemMap_Print() */
+uint32_t Texture_GetMemPools(MemPool_t* out, uint32_t max);
+
 #ifdef __cplusplus
 }
 #endif